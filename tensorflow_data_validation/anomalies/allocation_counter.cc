@@ -0,0 +1,70 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "absl/strings/str_format.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+// Constant-initialized, so that they can be used by allocations made before
+// main().
+std::atomic<int64> num_allocations(0);
+std::atomic<int64> num_bytes(0);
+
+}  // namespace
+
+AllocationCounts GetAllocationCounts() {
+  AllocationCounts result;
+  result.num_allocations = num_allocations.load(std::memory_order_relaxed);
+  result.num_bytes = num_bytes.load(std::memory_order_relaxed);
+  return result;
+}
+
+void SetAllocationLabel(const AllocationCounts& start, int iters) {
+  const AllocationCounts end = GetAllocationCounts();
+  const double num_iters = iters > 0 ? iters : 1;
+  ::tensorflow::testing::SetLabel(absl::StrFormat(
+      "allocs/iter: %.1f bytes/iter: %.0f",
+      (end.num_allocations - start.num_allocations) / num_iters,
+      (end.num_bytes - start.num_bytes) / num_iters));
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+// The other forms of operator new and operator delete (arrays, sized and
+// nothrow) call these by default.
+void* operator new(std::size_t size) {
+  tensorflow::data_validation::num_allocations.fetch_add(
+      1, std::memory_order_relaxed);
+  tensorflow::data_validation::num_bytes.fetch_add(size,
+                                                   std::memory_order_relaxed);
+  void* result = std::malloc(size == 0 ? 1 : size);
+  if (result == nullptr) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
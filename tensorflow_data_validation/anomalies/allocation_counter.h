@@ -0,0 +1,47 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_ALLOCATION_COUNTER_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_ALLOCATION_COUNTER_H_
+
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// Linking this library replaces the global operator new and operator delete
+// with versions that count the allocations made by all threads. It is meant
+// for benchmarks only.
+
+// The allocations made since the start of the program.
+struct AllocationCounts {
+  int64 num_allocations = 0;
+  // The bytes requested by the allocations. Deallocations are not subtracted.
+  int64 num_bytes = 0;
+};
+
+AllocationCounts GetAllocationCounts();
+
+// Sets the label of the running benchmark to the number of allocations and
+// of bytes allocated per iteration since start, e.g.:
+//   const AllocationCounts start = GetAllocationCounts();
+//   for (int i = 0; i < iters; ++i) { ... }
+//   SetAllocationLabel(start, iters);
+void SetAllocationLabel(const AllocationCounts& start, int iters);
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_ALLOCATION_COUNTER_H_
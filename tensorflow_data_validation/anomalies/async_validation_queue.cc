@@ -0,0 +1,105 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/async_validation_queue.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+void AsyncValidationQueue::Handle::Cancel() {
+  mutex_lock lock(mu_);
+  cancelled_ = true;
+  if (deadline_) {
+    deadline_->Cancel();
+  }
+}
+
+const ValidationDeadline* AsyncValidationQueue::Handle::Start(
+    int64 timeout_micros) {
+  mutex_lock lock(mu_);
+  if (cancelled_) {
+    return nullptr;
+  }
+  deadline_.emplace(timeout_micros);
+  return &*deadline_;
+}
+
+bool AsyncValidationQueue::Handle::cancelled() const {
+  mutex_lock lock(mu_);
+  return cancelled_;
+}
+
+AsyncValidationQueue::AsyncValidationQueue(const string& name,
+                                           int num_threads, int max_pending)
+    : max_pending_(std::max(max_pending, 1)),
+      thread_pool_(absl::make_unique<thread::ThreadPool>(
+          Env::Default(), name, std::max(num_threads, 1))) {}
+
+AsyncValidationQueue::~AsyncValidationQueue() {}
+
+Status AsyncValidationQueue::Submit(
+    int64 timeout_micros,
+    std::function<Status(const ValidationDeadline* deadline)> validate,
+    std::function<void(const Status& status)> done,
+    std::shared_ptr<Handle>* handle) {
+  {
+    mutex_lock lock(mu_);
+    if (num_pending_ >= max_pending_) {
+      return errors::ResourceExhausted(
+          "Too many pending validations: ", num_pending_,
+          " are already queued or running.");
+    }
+    ++num_pending_;
+  }
+  *handle = std::make_shared<Handle>();
+  std::shared_ptr<Handle> task_handle = *handle;
+  thread_pool_->Schedule([this, timeout_micros, task_handle, validate,
+                          done]() {
+    Status status;
+    const ValidationDeadline* deadline = task_handle->Start(timeout_micros);
+    if (deadline != nullptr) {
+      status = validate(deadline);
+    }
+    // A validation cancelled while it runs returns the anomalies found so
+    // far, which are not what the caller asked for.
+    if (task_handle->cancelled()) {
+      status = errors::Cancelled("The validation was cancelled.");
+    }
+    {
+      mutex_lock lock(mu_);
+      --num_pending_;
+    }
+    done(status);
+  });
+  return Status::OK();
+}
+
+int AsyncValidationQueue::num_pending() const {
+  mutex_lock lock(mu_);
+  return num_pending_;
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
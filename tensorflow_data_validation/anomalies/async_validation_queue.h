@@ -0,0 +1,107 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_ASYNC_VALIDATION_QUEUE_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_ASYNC_VALIDATION_QUEUE_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "absl/types/optional.h"
+#include "tensorflow_data_validation/anomalies/validation_deadline.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// Runs validations in the background for callers that must not block while
+// they run (e.g., an event loop), and calls back when each one is done. At
+// most num_threads validations run at once, and at most max_pending are
+// queued or running: further submissions are rejected rather than waited for,
+// so that the caller never blocks. A submitted validation can be cancelled,
+// before it starts (it is then never run) or while it runs (through its
+// ValidationDeadline). Thread-safe.
+class AsyncValidationQueue {
+ public:
+  // Cancels a submitted validation. Thread-safe.
+  class Handle {
+   public:
+    Handle() = default;
+    Handle(const Handle&) = delete;
+    Handle& operator=(const Handle&) = delete;
+
+    // Cancels the validation if it is not done: its done callback gets a
+    // Cancelled status, whatever the validation returns.
+    void Cancel();
+
+   private:
+    friend class AsyncValidationQueue;
+
+    // Creates the deadline of the validation, unless it was cancelled, in
+    // which case returns null.
+    const ValidationDeadline* Start(int64 timeout_micros);
+
+    // True iff Cancel() was called.
+    bool cancelled() const;
+
+    mutable mutex mu_;
+    bool cancelled_ TF_GUARDED_BY(mu_) = false;
+    // Set when the validation starts.
+    absl::optional<ValidationDeadline> deadline_ TF_GUARDED_BY(mu_);
+  };
+
+  AsyncValidationQueue(const string& name, int num_threads, int max_pending);
+
+  // Waits for all the submitted validations to be done (and their callbacks
+  // to be called), so it must not be destroyed from a done callback.
+  ~AsyncValidationQueue();
+
+  AsyncValidationQueue(const AsyncValidationQueue&) = delete;
+  AsyncValidationQueue& operator=(const AsyncValidationQueue&) = delete;
+
+  // Queues validate, which is run on one of the threads with a deadline
+  // expiring timeout_micros after it starts (or never if timeout_micros is 0
+  // or less), or when *handle is cancelled. Then done is called, on the same
+  // thread, with the status of validate (or Cancelled). done is called exactly
+  // once for each accepted submission, and validate at most once. Returns
+  // ResourceExhausted, without queueing anything, if max_pending validations
+  // are already queued or running.
+  Status Submit(int64 timeout_micros,
+                std::function<Status(const ValidationDeadline* deadline)>
+                    validate,
+                std::function<void(const Status& status)> done,
+                std::shared_ptr<Handle>* handle);
+
+  // The number of validations queued or running.
+  int num_pending() const;
+
+ private:
+  const int max_pending_;
+
+  mutable mutex mu_;
+  int num_pending_ TF_GUARDED_BY(mu_) = 0;
+
+  // Destroyed first, waiting for its threads.
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+};
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_ASYNC_VALIDATION_QUEUE_H_
@@ -0,0 +1,204 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/async_validation_queue.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+// A flag that threads can wait for.
+class Signal {
+ public:
+  void Notify() {
+    mutex_lock lock(mu_);
+    notified_ = true;
+    changed_.notify_all();
+  }
+
+  void Wait() {
+    mutex_lock lock(mu_);
+    while (!notified_) {
+      changed_.wait(lock);
+    }
+  }
+
+ private:
+  mutex mu_;
+  condition_variable changed_;
+  bool notified_ = false;
+};
+
+// The statuses passed to the done callbacks, in the order they are done.
+class DoneStatuses {
+ public:
+  std::function<void(const Status&)> Callback() {
+    return [this](const Status& status) {
+      mutex_lock lock(mu_);
+      statuses_.push_back(status);
+      changed_.notify_all();
+    };
+  }
+
+  // Waits for num_done callbacks, and returns their statuses.
+  std::vector<Status> Wait(int num_done) {
+    mutex_lock lock(mu_);
+    while (statuses_.size() < static_cast<size_t>(num_done)) {
+      changed_.wait(lock);
+    }
+    return statuses_;
+  }
+
+ private:
+  mutex mu_;
+  condition_variable changed_;
+  std::vector<Status> statuses_;
+};
+
+TEST(AsyncValidationQueueTest, RunsAllValidations) {
+  DoneStatuses done;
+  AsyncValidationQueue queue("async_validation_queue_test", 4,
+                             /*max_pending=*/100);
+  for (int i = 0; i < 100; ++i) {
+    std::shared_ptr<AsyncValidationQueue::Handle> handle;
+    TF_ASSERT_OK(queue.Submit(
+        /*timeout_micros=*/0,
+        [i](const ValidationDeadline* deadline) {
+          EXPECT_FALSE(deadline->Expired());
+          return i % 2 == 0 ? Status::OK()
+                            : errors::InvalidArgument("odd");
+        },
+        done.Callback(), &handle));
+  }
+  const std::vector<Status> statuses = done.Wait(100);
+  int num_ok = 0;
+  for (const Status& status : statuses) {
+    if (status.ok()) {
+      ++num_ok;
+    } else {
+      EXPECT_TRUE(errors::IsInvalidArgument(status));
+    }
+  }
+  EXPECT_EQ(num_ok, 50);
+}
+
+TEST(AsyncValidationQueueTest, RejectsBeyondMaxPending) {
+  Signal release;
+  DoneStatuses done;
+  AsyncValidationQueue queue("async_validation_queue_test", 1,
+                             /*max_pending=*/2);
+  const auto wait_for_release = [&release](const ValidationDeadline*) {
+    release.Wait();
+    return Status::OK();
+  };
+  std::shared_ptr<AsyncValidationQueue::Handle> handle;
+  TF_ASSERT_OK(queue.Submit(/*timeout_micros=*/0, wait_for_release,
+                            done.Callback(), &handle));
+  TF_ASSERT_OK(queue.Submit(/*timeout_micros=*/0, wait_for_release,
+                            done.Callback(), &handle));
+  EXPECT_EQ(queue.num_pending(), 2);
+  EXPECT_TRUE(errors::IsResourceExhausted(queue.Submit(
+      /*timeout_micros=*/0, wait_for_release, done.Callback(), &handle)));
+  release.Notify();
+  for (const Status& status : done.Wait(2)) {
+    TF_EXPECT_OK(status);
+  }
+  // Room is made as validations are done.
+  TF_ASSERT_OK(queue.Submit(/*timeout_micros=*/0, wait_for_release,
+                            done.Callback(), &handle));
+  TF_EXPECT_OK(done.Wait(3)[2]);
+}
+
+TEST(AsyncValidationQueueTest, CancelsQueuedValidation) {
+  Signal release;
+  DoneStatuses done;
+  AsyncValidationQueue queue("async_validation_queue_test", 1,
+                             /*max_pending=*/2);
+  std::shared_ptr<AsyncValidationQueue::Handle> running;
+  TF_ASSERT_OK(queue.Submit(
+      /*timeout_micros=*/0,
+      [&release](const ValidationDeadline*) {
+        release.Wait();
+        return Status::OK();
+      },
+      done.Callback(), &running));
+  bool queued_ran = false;
+  std::shared_ptr<AsyncValidationQueue::Handle> queued;
+  TF_ASSERT_OK(queue.Submit(
+      /*timeout_micros=*/0,
+      [&queued_ran](const ValidationDeadline*) {
+        queued_ran = true;
+        return Status::OK();
+      },
+      done.Callback(), &queued));
+  queued->Cancel();
+  release.Notify();
+  const std::vector<Status> statuses = done.Wait(2);
+  TF_EXPECT_OK(statuses[0]);
+  EXPECT_TRUE(errors::IsCancelled(statuses[1]));
+  EXPECT_FALSE(queued_ran);
+}
+
+TEST(AsyncValidationQueueTest, CancelsRunningValidation) {
+  Signal started;
+  DoneStatuses done;
+  AsyncValidationQueue queue("async_validation_queue_test", 1,
+                             /*max_pending=*/1);
+  std::shared_ptr<AsyncValidationQueue::Handle> handle;
+  TF_ASSERT_OK(queue.Submit(
+      /*timeout_micros=*/0,
+      [&started](const ValidationDeadline* deadline) {
+        started.Notify();
+        while (!deadline->Expired()) {
+        }
+        // Like a validation returning the anomalies found so far.
+        return Status::OK();
+      },
+      done.Callback(), &handle));
+  started.Wait();
+  handle->Cancel();
+  EXPECT_TRUE(errors::IsCancelled(done.Wait(1)[0]));
+}
+
+TEST(AsyncValidationQueueTest, TimesOut) {
+  DoneStatuses done;
+  AsyncValidationQueue queue("async_validation_queue_test", 1,
+                             /*max_pending=*/1);
+  std::shared_ptr<AsyncValidationQueue::Handle> handle;
+  TF_ASSERT_OK(queue.Submit(
+      /*timeout_micros=*/1000,
+      [](const ValidationDeadline* deadline) {
+        while (!deadline->Expired()) {
+        }
+        return Status::OK();
+      },
+      done.Callback(), &handle));
+  // A validation that times out is not cancelled.
+  TF_EXPECT_OK(done.Wait(1)[0]);
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
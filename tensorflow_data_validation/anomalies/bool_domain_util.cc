@@ -79,13 +79,13 @@ std::vector<Description> UpdateBoolDomainSelf(
   if (bool_domain->has_true_value() && bool_domain->has_false_value() &&
       bool_domain->true_value() == bool_domain->false_value()) {
     bool_domain->clear_false_value();
-    return {
-        {tensorflow::metadata::v0::AnomalyInfo::INVALID_DOMAIN_SPECIFICATION,
-         "Malformed BoolDomain",
-         absl::StrCat("True and false value equal for BoolDomain:",
-                      bool_domain->true_value(),
-                      ". The suggested change is to clear the false_value, "
-                      "but a domain expert should review this change.")}};
+    return {Description::FromTemplate(
+        tensorflow::metadata::v0::AnomalyInfo::INVALID_DOMAIN_SPECIFICATION,
+        "Malformed BoolDomain",
+        "True and false value equal for BoolDomain:$0. The suggested change "
+        "is to clear the false_value, but a domain expert should review this "
+        "change.",
+        {bool_domain->true_value()})};
   }
   return {};
 }
@@ -191,21 +191,21 @@ std::vector<Description> UpdateBoolDomain(const FeatureStatsView& feature_stats,
         IntDomain* int_domain = feature->mutable_int_domain();
         int_domain->set_max(numeric_statistics.max());
         int_domain->set_min(numeric_statistics.min());
-        return {{tensorflow::metadata::v0::AnomalyInfo::BOOL_TYPE_SMALL_INT,
-                 kNonBooleanValues,
-                 absl::StrCat("Integers (such as ",
-                              absl::SixDigits(numeric_statistics.min()),
-                              ") not in {0, 1}: converting to an integer.")}};
+        return {Description::FromTemplate(
+            tensorflow::metadata::v0::AnomalyInfo::BOOL_TYPE_SMALL_INT,
+            kNonBooleanValues,
+            "Integers (such as $0) not in {0, 1}: converting to an integer.",
+            {numeric_statistics.min()})};
       }
       if (numeric_statistics.max() > 1.0) {
         IntDomain* int_domain = feature->mutable_int_domain();
         int_domain->set_max(numeric_statistics.max());
         int_domain->set_min(numeric_statistics.min());
-        return {{tensorflow::metadata::v0::AnomalyInfo::BOOL_TYPE_BIG_INT,
-                 kNonBooleanValues,
-                 absl::StrCat("Integers (such as ",
-                              absl::SixDigits(numeric_statistics.max()),
-                              ") not in {0, 1}: converting to an integer.")}};
+        return {Description::FromTemplate(
+            tensorflow::metadata::v0::AnomalyInfo::BOOL_TYPE_BIG_INT,
+            kNonBooleanValues,
+            "Integers (such as $0) not in {0, 1}: converting to an integer.",
+            {numeric_statistics.max()})};
       }
       return {};
     }
@@ -219,21 +219,19 @@ std::vector<Description> UpdateBoolDomain(const FeatureStatsView& feature_stats,
       };
       if (numeric_statistics.min() != 0.0 && numeric_statistics.min() != 1.0) {
         set_float_domain(numeric_statistics, feature);
-        return {
-            {tensorflow::metadata::v0::AnomalyInfo::BOOL_TYPE_UNEXPECTED_FLOAT,
-             kNonBooleanValues,
-             absl::StrCat("Floats (such as ",
-                          absl::SixDigits(numeric_statistics.min()),
-                          ") not in {0, 1}: converting to float_domain.")}};
+        return {Description::FromTemplate(
+            tensorflow::metadata::v0::AnomalyInfo::BOOL_TYPE_UNEXPECTED_FLOAT,
+            kNonBooleanValues,
+            "Floats (such as $0) not in {0, 1}: converting to float_domain.",
+            {numeric_statistics.min()})};
       }
       if (numeric_statistics.max() != 0.0 && numeric_statistics.max() != 1.0) {
         set_float_domain(numeric_statistics, feature);
-        return {
-            {tensorflow::metadata::v0::AnomalyInfo::BOOL_TYPE_UNEXPECTED_FLOAT,
-             kNonBooleanValues,
-             absl::StrCat("Floats (such as ",
-                          absl::SixDigits(numeric_statistics.max()),
-                          ") not in {0, 1}: converting to float_domain.")}};
+        return {Description::FromTemplate(
+            tensorflow::metadata::v0::AnomalyInfo::BOOL_TYPE_UNEXPECTED_FLOAT,
+            kNonBooleanValues,
+            "Floats (such as $0) not in {0, 1}: converting to float_domain.",
+            {numeric_statistics.max()})};
       }
       for (const auto& histogram : numeric_statistics.histograms()) {
         // Any non-empty boundary should include 0 or 1, otherwise the feature
@@ -242,11 +240,11 @@ std::vector<Description> UpdateBoolDomain(const FeatureStatsView& feature_stats,
         // not be detected.
         if (histogram.num_nan() > 0) {
           set_float_domain(numeric_statistics, feature);
-          return {{tensorflow::metadata::v0::AnomalyInfo::
-                       BOOL_TYPE_UNEXPECTED_FLOAT,
-                   kNonBooleanValues,
-                   absl::StrCat("Floats (such as NaN) not in {0, 1}: "
-                                "converting to float_domain.")}};
+          return {Description::FromTemplate(
+              tensorflow::metadata::v0::AnomalyInfo::BOOL_TYPE_UNEXPECTED_FLOAT,
+              kNonBooleanValues,
+              "Floats (such as NaN) not in {0, 1}: converting to float_domain.",
+              {})};
         }
         for (const auto& bucket : histogram.buckets()) {
           if (bucket.sample_count() <= 0) {
@@ -254,26 +252,30 @@ std::vector<Description> UpdateBoolDomain(const FeatureStatsView& feature_stats,
           }
           if (bucket.high_value() < 0) {
             set_float_domain(numeric_statistics, feature);
-            return {{tensorflow::metadata::v0::AnomalyInfo::
-                         BOOL_TYPE_UNEXPECTED_FLOAT,
-                     kNonBooleanValues,
-                     absl::StrCat("Float values < 0 not in {0, 1}: converting "
-                                  "to float_domain.")}};
+            return {Description::FromTemplate(
+                tensorflow::metadata::v0::AnomalyInfo::
+                    BOOL_TYPE_UNEXPECTED_FLOAT,
+                kNonBooleanValues,
+                "Float values < 0 not in {0, 1}: converting to float_domain.",
+                {})};
           } else if (bucket.low_value() > 1) {
             set_float_domain(numeric_statistics, feature);
-            return {{tensorflow::metadata::v0::AnomalyInfo::
-                         BOOL_TYPE_UNEXPECTED_FLOAT,
-                     kNonBooleanValues,
-                     absl::StrCat("Float values > 1 not in {0, 1}: converting "
-                                  "to float_domain.")}};
+            return {Description::FromTemplate(
+                tensorflow::metadata::v0::AnomalyInfo::
+                    BOOL_TYPE_UNEXPECTED_FLOAT,
+                kNonBooleanValues,
+                "Float values > 1 not in {0, 1}: converting to float_domain.",
+                {})};
           } else if (histogram.type() == metadata::v0::Histogram::QUANTILES &&
                      bucket.high_value() < 1 && bucket.low_value() > 0) {
             set_float_domain(numeric_statistics, feature);
-            return {{tensorflow::metadata::v0::AnomalyInfo::
-                         BOOL_TYPE_UNEXPECTED_FLOAT,
-                     kNonBooleanValues,
-                     absl::StrCat("Float values falling between 0 and 1: "
-                                  "converting to float_domain.")}};
+            return {Description::FromTemplate(
+                tensorflow::metadata::v0::AnomalyInfo::
+                    BOOL_TYPE_UNEXPECTED_FLOAT,
+                kNonBooleanValues,
+                "Float values falling between 0 and 1: converting to "
+                "float_domain.",
+                {})};
           }
         }
       }
@@ -288,15 +290,15 @@ std::vector<Description> UpdateBoolDomain(const FeatureStatsView& feature_stats,
         if (!ContainsKey(valid_strings, str)) {
           // We might be able to replace this with an enum, but since it is
           // in all likelihood an error, let's just wipe the bool_domain.
-          const string valid_strings_desc =
+          string valid_strings_desc =
               BoolDomainValidStringsDescription(bool_domain);
           // Note that this clears the oneof field domain_info.
           feature->clear_bool_domain();
-          return {{tensorflow::metadata::v0::AnomalyInfo::
-                       BOOL_TYPE_UNEXPECTED_STRING,
-                   kNonBooleanValues,
-                   absl::StrCat("Saw unexpected value \"", str,
-                                "\" instead of ", valid_strings_desc, ".")}};
+          return {Description::FromTemplate(
+              tensorflow::metadata::v0::AnomalyInfo::
+                  BOOL_TYPE_UNEXPECTED_STRING,
+              kNonBooleanValues, "Saw unexpected value \"$0\" instead of $1.",
+              {str, std::move(valid_strings_desc)})};
         }
       }
       return {};
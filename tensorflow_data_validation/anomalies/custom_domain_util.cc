@@ -49,6 +49,29 @@ bool ParseCustomDomainInfo(const string& domain_info,
   }
 }
 
+// Updates feature from the value of its only 'domain_info' custom stat.
+bool UpdateCustomDomain(const string& domain_info,
+                        tensorflow::metadata::v0::Feature* feature) {
+  if (domain_info.empty()) {
+    return false;
+  }
+  // Never override existing domain_infos with a custom domain_info for safety.
+  if (feature->domain_info_case() !=
+      tensorflow::metadata::v0::Feature::DOMAIN_INFO_NOT_SET) {
+    LOG(INFO) << "Valid custom domain_info: " << domain_info
+              << " ignored due to existing domain, for feature :"
+              << feature->DebugString();
+    return false;
+  }
+  if (!ParseCustomDomainInfo(domain_info, feature)) {
+    LOG(ERROR) << "Could not parse 'domain_info' custom_stat: " << domain_info
+               << ". It is expected to contain exactly one field of the "
+               << "Feature.domain_info oneof, e.g: 'mid_domain {}'.";
+    return false;
+  }
+  return true;
+}
+
 }  // namespace
 
 bool BestEffortUpdateCustomDomain(
@@ -66,24 +89,22 @@ bool BestEffortUpdateCustomDomain(
       }
     }
   }
-  if (domain_info.empty()) {
-    return false;
-  }
-  // Never override existing domain_infos with a custom domain_info for safety.
-  if (feature->domain_info_case() !=
-      tensorflow::metadata::v0::Feature::DOMAIN_INFO_NOT_SET) {
-    LOG(INFO) << "Valid custom domain_info: " << domain_info
-              << " ignored due to existing domain, for feature :"
-              << feature->DebugString();
+  return UpdateCustomDomain(domain_info, feature);
+}
+
+bool BestEffortUpdateCustomDomain(const FeatureStatsView& feature_stats_view,
+                                  tensorflow::metadata::v0::Feature* feature) {
+  const int count = feature_stats_view.GetCustomStatCount(kDomainInfo);
+  if (count == 0) {
     return false;
   }
-  if (!ParseCustomDomainInfo(domain_info, feature)) {
-    LOG(ERROR) << "Could not parse 'domain_info' custom_stat: " << domain_info
-               << ". It is expected to contain exactly one field of the "
-               << "Feature.domain_info oneof, e.g: 'mid_domain {}'.";
-    return false;
+  if (count > 1) {
+    // Rare, so the custom stats are copied to log the duplicates.
+    return BestEffortUpdateCustomDomain(feature_stats_view.custom_stats(),
+                                        feature);
   }
-  return true;
+  return UpdateCustomDomain(
+      feature_stats_view.GetCustomStatByName(kDomainInfo)->str(), feature);
 }
 
 }  // namespace data_validation
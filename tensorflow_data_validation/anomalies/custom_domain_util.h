@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <vector>
 
+#include "tensorflow_data_validation/anomalies/statistics_view.h"
 #include "tensorflow_metadata/proto/v0/schema.pb.h"
 #include "tensorflow_metadata/proto/v0/statistics.pb.h"
 
@@ -43,6 +44,11 @@ bool BestEffortUpdateCustomDomain(
     const std::vector<tensorflow::metadata::v0::CustomStatistic>& custom_stats,
     tensorflow::metadata::v0::Feature* feature);
 
+// Same as above, but looks up the 'domain_info' custom stat of a feature
+// through the view, without copying its custom stats.
+bool BestEffortUpdateCustomDomain(const FeatureStatsView& feature_stats_view,
+                                  tensorflow::metadata::v0::Feature* feature);
+
 }  // namespace data_validation
 }  // namespace tensorflow
 
@@ -84,26 +84,23 @@ std::vector<Description> UpdateNumExamplesComparatorDirect(
     double max_threshold = comparator->max_fraction_threshold();
     if (control_num_examples == 0) {
       comparator->clear_max_fraction_threshold();
-      descriptions.push_back(
-          {tensorflow::metadata::v0::AnomalyInfo::COMPARATOR_HIGH_NUM_EXAMPLES,
-           absl::StrCat("High num examples in current dataset versus the ",
-                        control_name, ", which has 0."),
-           absl::StrCat("The ", control_name,
-                        " has 0 examples, so there is a high number of "
-                        "examples in the current dataset versus the ",
-                        control_name, ".")});
+      descriptions.push_back(Description::FromTemplate(
+          tensorflow::metadata::v0::AnomalyInfo::COMPARATOR_HIGH_NUM_EXAMPLES,
+          absl::StrCat("High num examples in current dataset versus the ",
+                       control_name, ", which has 0."),
+          "The $0 has 0 examples, so there is a high number of examples in "
+          "the current dataset versus the $0.",
+          {control_name}));
     } else if (num_examples_ratio > max_threshold) {
       comparator->set_max_fraction_threshold(num_examples_ratio);
-      descriptions.push_back(
-          {tensorflow::metadata::v0::AnomalyInfo::COMPARATOR_HIGH_NUM_EXAMPLES,
-           absl::StrCat("High num examples in current dataset versus the ",
-                        control_name, "."),
-           absl::StrCat(
-               "The ratio of num examples in the current dataset versus the ",
-               control_name, " is ", absl::SixDigits(num_examples_ratio),
-               " (up to six significant digits), which is above the "
-               "threshold ",
-               absl::SixDigits(max_threshold), ".")});
+      descriptions.push_back(Description::FromTemplate(
+          tensorflow::metadata::v0::AnomalyInfo::COMPARATOR_HIGH_NUM_EXAMPLES,
+          absl::StrCat("High num examples in current dataset versus the ",
+                       control_name, "."),
+          "The ratio of num examples in the current dataset versus the $0 "
+          "is $1 (up to six significant digits), which is above the "
+          "threshold $2.",
+          {control_name, num_examples_ratio, max_threshold}));
     }
   }
   if (comparator->has_min_fraction_threshold()) {
@@ -111,15 +108,14 @@ std::vector<Description> UpdateNumExamplesComparatorDirect(
     if (control_num_examples != 0 &&
         num_examples_ratio < comparator->min_fraction_threshold()) {
       comparator->set_min_fraction_threshold(num_examples_ratio);
-      descriptions.push_back(
-          {tensorflow::metadata::v0::AnomalyInfo::COMPARATOR_LOW_NUM_EXAMPLES,
-           absl::StrCat("Low num examples in current dataset versus the ",
-                        control_name, "."),
-           absl::StrCat(
-               "The ratio of num examples in the current dataset versus the ",
-               control_name, " is ", absl::SixDigits(num_examples_ratio),
-               " (up to six significant digits), which is below the threshold ",
-               absl::SixDigits(min_threshold), ".")});
+      descriptions.push_back(Description::FromTemplate(
+          tensorflow::metadata::v0::AnomalyInfo::COMPARATOR_LOW_NUM_EXAMPLES,
+          absl::StrCat("Low num examples in current dataset versus the ",
+                       control_name, "."),
+          "The ratio of num examples in the current dataset versus the $0 "
+          "is $1 (up to six significant digits), which is below the "
+          "threshold $2.",
+          {control_name, num_examples_ratio, min_threshold}));
     }
   }
   return descriptions;
@@ -133,22 +129,22 @@ std::vector<Description> UpdateExamplesCount(
     const double num_present = stats.GetNumExamples();
     if (num_present < dataset_constraints->min_examples_count()) {
       dataset_constraints->set_min_examples_count(num_present);
-      descriptions.push_back(
-          {tensorflow::metadata::v0::AnomalyInfo::DATASET_LOW_NUM_EXAMPLES,
-           "Low num examples in dataset.",
-           absl::StrCat("The dataset has ", num_present,
-                        " examples, which is fewer than expected.")});
+      descriptions.push_back(Description::FromTemplate(
+          tensorflow::metadata::v0::AnomalyInfo::DATASET_LOW_NUM_EXAMPLES,
+          "Low num examples in dataset.",
+          "The dataset has $0 examples, which is fewer than expected.",
+          {num_present}));
     }
   }
   if (dataset_constraints->has_max_examples_count()) {
     const double num_present = stats.GetNumExamples();
     if (num_present > dataset_constraints->max_examples_count()) {
       dataset_constraints->set_max_examples_count(num_present);
-      descriptions.push_back(
-          {tensorflow::metadata::v0::AnomalyInfo::DATASET_HIGH_NUM_EXAMPLES,
-           "High num examples in dataset.",
-           absl::StrCat("The dataset has ", num_present,
-                        " examples, which is more than expected.")});
+      descriptions.push_back(Description::FromTemplate(
+          tensorflow::metadata::v0::AnomalyInfo::DATASET_HIGH_NUM_EXAMPLES,
+          "High num examples in dataset.",
+          "The dataset has $0 examples, which is more than expected.",
+          {num_present}));
     }
   }
   return descriptions;
@@ -15,15 +15,349 @@ limitations under the License.
 
 #include "tensorflow_data_validation/anomalies/diff_util.h"
 
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
 namespace data_validation {
 
-std::vector<tensorflow::metadata::v0::DiffRegion> ComputeDiff(
+namespace {
+
+using ::tensorflow::metadata::v0::DiffRegion;
+
+// Beyond this many differences, ComputeDiff() stops looking for the shortest
+// edit script, as the memory used grows with the square of the differences.
+constexpr int kMaxEditDistance = 4096;
+
+// An edit script, as pairs of ranges [left_start, left_end) and
+// [right_start, right_end) (counted from 0) that alternate between equal
+// lines and changed lines.
+struct Hunk {
+  bool equal;
+  int left_start;
+  int left_end;
+  int right_start;
+  int right_end;
+};
+
+// Appends a hunk to hunks, merging it with the last one if they are of the
+// same kind. Empty hunks are dropped.
+void AddHunk(const Hunk& hunk, std::vector<Hunk>* hunks) {
+  if (hunk.left_start == hunk.left_end &&
+      hunk.right_start == hunk.right_end) {
+    return;
+  }
+  if (!hunks->empty() && hunks->back().equal == hunk.equal &&
+      hunks->back().left_end == hunk.left_start &&
+      hunks->back().right_end == hunk.right_start) {
+    hunks->back().left_end = hunk.left_end;
+    hunks->back().right_end = hunk.right_end;
+    return;
+  }
+  hunks->push_back(hunk);
+}
+
+// Appends to hunks the shortest edit script turning a into b, using the
+// algorithm of "An O(ND) Difference Algorithm and Its Variations" (Myers,
+// 1986). The ranges of the hunks are offset by left_offset (in a) and
+// right_offset (in b).
+void AddEditScript(const absl::string_view* a, int a_size,
+                   const absl::string_view* b, int b_size, int left_offset,
+                   int right_offset, std::vector<Hunk>* hunks) {
+  // The common prefix and suffix are equal without looking further.
+  int prefix = 0;
+  while (prefix < a_size && prefix < b_size && a[prefix] == b[prefix]) {
+    ++prefix;
+  }
+  int suffix = 0;
+  while (suffix < a_size - prefix && suffix < b_size - prefix &&
+         a[a_size - 1 - suffix] == b[b_size - 1 - suffix]) {
+    ++suffix;
+  }
+  AddHunk({true, left_offset, left_offset + prefix, right_offset,
+           right_offset + prefix},
+          hunks);
+  a += prefix;
+  b += prefix;
+  const int n = a_size - prefix - suffix;
+  const int m = b_size - prefix - suffix;
+  left_offset += prefix;
+  right_offset += prefix;
+
+  // trace[d][k + d] is the furthest x reached on the diagonal k = x - y with
+  // d differences.
+  std::vector<std::vector<int>> trace;
+  bool found = false;
+  for (int d = 0; d <= std::min(n + m, kMaxEditDistance) && !found; ++d) {
+    std::vector<int> v(2 * d + 1);
+    for (int k = -d; k <= d; k += 2) {
+      int x = 0;
+      if (d > 0) {
+        const std::vector<int>& previous = trace.back();
+        if (k == -d ||
+            (k != d && previous[k - 1 + d - 1] < previous[k + 1 + d - 1])) {
+          x = previous[k + 1 + d - 1];
+        } else {
+          x = previous[k - 1 + d - 1] + 1;
+        }
+      }
+      int y = x - k;
+      while (x < n && y < m && a[x] == b[y]) {
+        ++x;
+        ++y;
+      }
+      v[k + d] = x;
+      if (x >= n && y >= m) {
+        found = true;
+        break;
+      }
+    }
+    trace.push_back(std::move(v));
+  }
+
+  std::vector<Hunk> middle;
+  if (!found) {
+    middle.push_back(
+        {false, left_offset, left_offset + n, right_offset, right_offset + m});
+  } else {
+    // Walks back from the end, collecting the hunks in reverse.
+    int x = n;
+    int y = m;
+    for (int d = trace.size() - 1; d >= 0; --d) {
+      const int k = x - y;
+      int previous_x = 0;
+      int previous_y = 0;
+      if (d > 0) {
+        const std::vector<int>& previous = trace[d - 1];
+        const int previous_k =
+            (k == -d ||
+             (k != d && previous[k - 1 + d - 1] < previous[k + 1 + d - 1]))
+                ? k + 1
+                : k - 1;
+        previous_x = previous[previous_k + d - 1];
+        previous_y = previous_x - previous_k;
+      }
+      // The snake following the difference.
+      const int snake_x = d > 0 ? (previous_x - previous_y == k + 1
+                                       ? previous_x
+                                       : previous_x + 1)
+                                : 0;
+      const int snake_length = x - snake_x;
+      middle.push_back({true, left_offset + x - snake_length,
+                        left_offset + x, right_offset + y - snake_length,
+                        right_offset + y});
+      x -= snake_length;
+      y -= snake_length;
+      if (d > 0) {
+        middle.push_back({false, left_offset + previous_x, left_offset + x,
+                          right_offset + previous_y, right_offset + y});
+        x = previous_x;
+        y = previous_y;
+      }
+    }
+    std::reverse(middle.begin(), middle.end());
+  }
+  for (const Hunk& hunk : middle) {
+    AddHunk(hunk, hunks);
+  }
+  AddHunk({true, left_offset + n, left_offset + n + suffix, right_offset + m,
+           right_offset + m + suffix},
+          hunks);
+}
+
+// Appends the lines [start, end) to contents.
+void AddContents(const std::vector<absl::string_view>& lines, int start,
+                 int end,
+                 ::tensorflow::protobuf::RepeatedPtrField<string>* contents) {
+  for (int i = start; i < end; ++i) {
+    contents->Add()->assign(lines[i].data(), lines[i].size());
+  }
+}
+
+// Appends to regions the unchanged lines [left_start, left_end) of
+// left_lines, which are [right_start, ...) in the right text. Only the first
+// context_before and the last context_after lines are shown, unless either is
+// negative, in which case all the lines are shown.
+void AddUnchanged(const std::vector<absl::string_view>& left_lines,
+                  int left_start, int left_end, int right_start,
+                  int context_before, int context_after,
+                  std::vector<DiffRegion>* regions) {
+  const int size = left_end - left_start;
+  if (size == 0) {
+    return;
+  }
+  const auto add_shown = [&](int start, int end) {
+    if (start == end) {
+      return;
+    }
+    regions->emplace_back();
+    tensorflow::metadata::v0::Unchanged& unchanged =
+        *regions->back().mutable_unchanged();
+    unchanged.set_left_start(start + 1);
+    unchanged.set_left_end(end);
+    unchanged.set_right_start(start - left_start + right_start + 1);
+    unchanged.set_right_end(end - left_start + right_start);
+    AddContents(left_lines, start, end, unchanged.mutable_contents());
+  };
+  if (context_before < 0 || context_after < 0 ||
+      size <= context_before + context_after) {
+    add_shown(left_start, left_end);
+    return;
+  }
+  add_shown(left_start, left_start + context_before);
+  regions->emplace_back();
+  tensorflow::metadata::v0::HiddenRegion& hidden =
+      *regions->back().mutable_hidden();
+  const int hidden_start = left_start + context_before;
+  const int hidden_end = left_end - context_after;
+  hidden.set_left_start(hidden_start + 1);
+  hidden.set_left_end(hidden_end);
+  hidden.set_right_start(hidden_start - left_start + right_start + 1);
+  hidden.set_right_end(hidden_end - left_start + right_start);
+  add_shown(hidden_end, left_end);
+}
+
+// Appends to regions the changed lines [left_start, left_end) of left_lines,
+// replaced by the lines [right_start, right_end) of right_lines.
+void AddChanged(const std::vector<absl::string_view>& left_lines,
+                int left_start, int left_end,
+                const std::vector<absl::string_view>& right_lines,
+                int right_start, int right_end, int right_offset,
+                std::vector<DiffRegion>* regions) {
+  regions->emplace_back();
+  DiffRegion& region = regions->back();
+  if (right_start == right_end) {
+    tensorflow::metadata::v0::Removed& removed = *region.mutable_removed();
+    removed.set_start(left_start + 1);
+    removed.set_end(left_end);
+    AddContents(left_lines, left_start, left_end, removed.mutable_contents());
+  } else if (left_start == left_end) {
+    tensorflow::metadata::v0::Added& added = *region.mutable_added();
+    added.set_start(right_offset + right_start + 1);
+    added.set_end(right_offset + right_end);
+    AddContents(right_lines, right_start, right_end, added.mutable_contents());
+  } else {
+    tensorflow::metadata::v0::ChangedRegion& changed =
+        *region.mutable_changed();
+    changed.set_left_start(left_start + 1);
+    changed.set_left_end(left_end);
+    changed.set_right_start(right_offset + right_start + 1);
+    changed.set_right_end(right_offset + right_end);
+    AddContents(left_lines, left_start, left_end,
+                changed.mutable_left_contents());
+    AddContents(right_lines, right_start, right_end,
+                changed.mutable_right_contents());
+  }
+}
+
+// A hunk of ComputeDiffWithEdits(), in which the right lines are either the
+// same as the left lines (if equal), or lines of right_lines, offset so that
+// right_start - right_offset is an index in right_lines.
+struct EditHunk {
+  Hunk hunk;
+  const std::vector<absl::string_view>* right_lines;
+  int right_offset;
+};
+
+}  // namespace
+
+std::vector<DiffRegion> ComputeDiff(
     const std::vector<absl::string_view>& a_lines,
     const std::vector<absl::string_view>& b_lines) {
-  CHECK(false) << "Schema diff is currently not supported.";
+  std::vector<Hunk> hunks;
+  AddEditScript(a_lines.data(), a_lines.size(), b_lines.data(),
+                b_lines.size(), /*left_offset=*/0, /*right_offset=*/0,
+                &hunks);
+  std::vector<DiffRegion> regions;
+  for (const Hunk& hunk : hunks) {
+    if (hunk.equal) {
+      AddUnchanged(a_lines, hunk.left_start, hunk.left_end, hunk.right_start,
+                   /*context_before=*/-1, /*context_after=*/-1, &regions);
+    } else {
+      AddChanged(a_lines, hunk.left_start, hunk.left_end, b_lines,
+                 hunk.right_start, hunk.right_end, /*right_offset=*/0,
+                 &regions);
+    }
+  }
+  return regions;
+}
+
+std::vector<DiffRegion> ComputeDiffWithEdits(
+    const std::vector<absl::string_view>& left_lines,
+    const std::vector<LineEdit>& edits, int context_lines) {
+  // The views of the right lines of each edit.
+  std::vector<std::vector<absl::string_view>> edit_right_lines(edits.size());
+  std::vector<EditHunk> edit_hunks;
+  const auto add_equal = [&](int left_start, int left_end, int right_start) {
+    if (left_start == left_end) {
+      return;
+    }
+    if (!edit_hunks.empty() && edit_hunks.back().hunk.equal) {
+      edit_hunks.back().hunk.left_end = left_end;
+      edit_hunks.back().hunk.right_end += left_end - left_start;
+      return;
+    }
+    edit_hunks.push_back({{true, left_start, left_end, right_start,
+                           right_start + left_end - left_start},
+                          nullptr, 0});
+  };
+  // The number of right lines minus the number of left lines so far.
+  int delta = 0;
+  int left_position = 0;
+  for (int i = 0; i < edits.size(); ++i) {
+    const LineEdit& edit = edits[i];
+    CHECK_LE(left_position, edit.left_start) << "Edits overlap.";
+    CHECK_LE(edit.left_start, edit.left_end);
+    CHECK_LE(edit.left_end, static_cast<int>(left_lines.size()));
+    add_equal(left_position, edit.left_start, left_position + delta);
+    std::vector<absl::string_view>& right_lines = edit_right_lines[i];
+    right_lines.assign(edit.right_lines.begin(), edit.right_lines.end());
+    const int right_offset = edit.left_start + delta;
+    std::vector<Hunk> hunks;
+    AddEditScript(left_lines.data() + edit.left_start,
+                  edit.left_end - edit.left_start, right_lines.data(),
+                  right_lines.size(), edit.left_start, right_offset, &hunks);
+    for (const Hunk& hunk : hunks) {
+      if (hunk.equal) {
+        add_equal(hunk.left_start, hunk.left_end, hunk.right_start);
+      } else {
+        edit_hunks.push_back({hunk, &right_lines, right_offset});
+      }
+    }
+    delta += static_cast<int>(right_lines.size()) -
+             (edit.left_end - edit.left_start);
+    left_position = edit.left_end;
+  }
+  add_equal(left_position, left_lines.size(), left_position + delta);
+
+  std::vector<DiffRegion> regions;
+  for (int i = 0; i < edit_hunks.size(); ++i) {
+    const Hunk& hunk = edit_hunks[i].hunk;
+    if (hunk.equal) {
+      // No context is needed before the first change or after the last one.
+      const bool show_all = context_lines < 0;
+      AddUnchanged(left_lines, hunk.left_start, hunk.left_end,
+                   hunk.right_start,
+                   /*context_before=*/i == 0 && !show_all ? 0 : context_lines,
+                   /*context_after=*/i + 1 == edit_hunks.size() && !show_all
+                       ? 0
+                       : context_lines,
+                   &regions);
+    } else {
+      const int right_offset = edit_hunks[i].right_offset;
+      AddChanged(left_lines, hunk.left_start, hunk.left_end,
+                 *edit_hunks[i].right_lines, hunk.right_start - right_offset,
+                 hunk.right_end - right_offset, right_offset, &regions);
+    }
+  }
+  return regions;
 }
 
 }  // namespace data_validation
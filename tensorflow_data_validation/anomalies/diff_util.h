@@ -16,20 +16,49 @@ limitations under the License.
 #ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_DIFF_UTIL_H_
 #define TENSORFLOW_DATA_VALIDATION_ANOMALIES_DIFF_UTIL_H_
 
+#include <string>
 #include <vector>
 
 #include "absl/strings/string_view.h"
+#include "tensorflow/core/platform/types.h"
 #include "tensorflow_metadata/proto/v0/anomalies.pb.h"
 
 namespace tensorflow {
 namespace data_validation {
 
-// The schema diff computation functionality is currently not supported.
-// Tracked in https://github.com/tensorflow/data-validation/issues/39
+// In the diff regions below, line numbers start at 1, and the end lines are
+// included. Removed regions are numbered as lines of the left (old) text, and
+// added regions as lines of the right (new) text.
+
+// Computes the diff regions between two texts, given as lines. Every line is
+// in a region, so the unchanged lines are all in Unchanged regions, with their
+// contents. Uses the O(ND) algorithm of Myers, so the cost is small when the
+// texts are similar. If the texts have more than a few thousand differences,
+// the lines between their common prefix and suffix are reported as a single
+// changed region.
 std::vector<tensorflow::metadata::v0::DiffRegion> ComputeDiff(
     const std::vector<absl::string_view>& a_lines,
     const std::vector<absl::string_view>& b_lines);
 
+// A change to a text: replaces the lines [left_start, left_end) (counted from
+// 0) of the text with right_lines.
+struct LineEdit {
+  int left_start;
+  int left_end;
+  std::vector<string> right_lines;
+};
+
+// Computes the diff regions between left_lines and the text obtained by
+// applying edits to it, without building that text. The edits must be sorted
+// by left_start, and must not overlap. Only the lines of the edits are
+// compared (using ComputeDiff()), so the cost does not depend on the number of
+// unchanged lines between edits. Those are in Unchanged regions if they are
+// at most context_lines away from a change, and in HiddenRegions otherwise.
+// If context_lines is negative, all the unchanged lines are shown.
+std::vector<tensorflow::metadata::v0::DiffRegion> ComputeDiffWithEdits(
+    const std::vector<absl::string_view>& left_lines,
+    const std::vector<LineEdit>& edits, int context_lines);
+
 }  // namespace data_validation
 }  // namespace tensorflow
 #endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_DIFF_UTIL_H_
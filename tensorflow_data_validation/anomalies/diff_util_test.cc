@@ -0,0 +1,168 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/diff_util.h"
+
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "absl/strings/string_view.h"
+#include "tensorflow_data_validation/anomalies/test_util.h"
+#include "tensorflow_metadata/proto/v0/anomalies.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::DiffRegion;
+using testing::EqualsProto;
+
+TEST(DiffUtilTest, ComputeDiffSame) {
+  EXPECT_THAT(ComputeDiff({"a", "b"}, {"a", "b"}),
+              ::testing::ElementsAre(EqualsProto(R"(
+                unchanged {
+                  left_start: 1
+                  left_end: 2
+                  right_start: 1
+                  right_end: 2
+                  contents: "a"
+                  contents: "b"
+                })")));
+  EXPECT_TRUE(ComputeDiff({}, {}).empty());
+}
+
+TEST(DiffUtilTest, ComputeDiff) {
+  const std::vector<DiffRegion> regions =
+      ComputeDiff({"a", "b", "c", "d", "e"}, {"b", "c", "x", "e", "f"});
+  ASSERT_EQ(regions.size(), 5);
+  EXPECT_THAT(regions[0], EqualsProto(R"(
+                removed { start: 1 end: 1 contents: "a" })"));
+  EXPECT_THAT(regions[1], EqualsProto(R"(
+                unchanged {
+                  left_start: 2
+                  left_end: 3
+                  right_start: 1
+                  right_end: 2
+                  contents: "b"
+                  contents: "c"
+                })"));
+  EXPECT_THAT(regions[2], EqualsProto(R"(
+                changed {
+                  left_start: 4
+                  left_end: 4
+                  right_start: 3
+                  right_end: 3
+                  left_contents: "d"
+                  right_contents: "x"
+                })"));
+  EXPECT_THAT(regions[3], EqualsProto(R"(
+                unchanged {
+                  left_start: 5
+                  left_end: 5
+                  right_start: 4
+                  right_end: 4
+                  contents: "e"
+                })"));
+  EXPECT_THAT(regions[4], EqualsProto(R"(
+                added { start: 5 end: 5 contents: "f" })"));
+}
+
+TEST(DiffUtilTest, ComputeDiffWithEdits) {
+  std::vector<absl::string_view> left_lines;
+  const std::vector<string> numbers = {"0", "1", "2", "3", "4", "5",
+                                       "6", "7", "8", "9"};
+  for (const string& number : numbers) {
+    left_lines.push_back(number);
+  }
+  // Replaces 2 and 3 by 2 and x, and inserts y before 8.
+  const std::vector<LineEdit> edits = {{2, 4, {"2", "x"}}, {8, 8, {"y"}}};
+  EXPECT_THAT(
+      ComputeDiffWithEdits(left_lines, edits, /*context_lines=*/1),
+      ::testing::ElementsAre(
+          EqualsProto(R"(hidden {
+                           left_start: 1
+                           left_end: 2
+                           right_start: 1
+                           right_end: 2
+                         })"),
+          EqualsProto(R"(unchanged {
+                           left_start: 3
+                           left_end: 3
+                           right_start: 3
+                           right_end: 3
+                           contents: "2"
+                         })"),
+          EqualsProto(R"(changed {
+                           left_start: 4
+                           left_end: 4
+                           right_start: 4
+                           right_end: 4
+                           left_contents: "3"
+                           right_contents: "x"
+                         })"),
+          EqualsProto(R"(unchanged {
+                           left_start: 5
+                           left_end: 5
+                           right_start: 5
+                           right_end: 5
+                           contents: "4"
+                         })"),
+          EqualsProto(R"(hidden {
+                           left_start: 6
+                           left_end: 7
+                           right_start: 6
+                           right_end: 7
+                         })"),
+          EqualsProto(R"(unchanged {
+                           left_start: 8
+                           left_end: 8
+                           right_start: 8
+                           right_end: 8
+                           contents: "7"
+                         })"),
+          EqualsProto(R"(added { start: 9 end: 9 contents: "y" })"),
+          EqualsProto(R"(unchanged {
+                           left_start: 9
+                           left_end: 9
+                           right_start: 10
+                           right_end: 10
+                           contents: "8"
+                         })"),
+          EqualsProto(R"(hidden {
+                           left_start: 10
+                           left_end: 10
+                           right_start: 11
+                           right_end: 11
+                         })")));
+}
+
+TEST(DiffUtilTest, ComputeDiffWithEditsShowsAllLines) {
+  const std::vector<absl::string_view> left_lines = {"a", "b", "c"};
+  const std::vector<LineEdit> edits = {{1, 2, {"x"}}};
+  const std::vector<DiffRegion> actual =
+      ComputeDiffWithEdits(left_lines, edits, /*context_lines=*/-1);
+  const std::vector<DiffRegion> expected =
+      ComputeDiff(left_lines, {"a", "x", "c"});
+  ASSERT_EQ(actual.size(), expected.size());
+  for (int i = 0; i < actual.size(); ++i) {
+    EXPECT_THAT(actual[i], EqualsProto(expected[i]));
+  }
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -0,0 +1,135 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Benchmarks of the update of the domains of features.
+// Run with --benchmarks=all.
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow_data_validation/anomalies/allocation_counter.h"
+#include "tensorflow_data_validation/anomalies/float_domain_util.h"
+#include "tensorflow_data_validation/anomalies/int_domain_util.h"
+#include "tensorflow_data_validation/anomalies/internal_types.h"
+#include "tensorflow_data_validation/anomalies/proto/feature_statistics_to_proto.pb.h"
+#include "tensorflow_data_validation/anomalies/schema.h"
+#include "tensorflow_data_validation/anomalies/statistics_view_test_util.h"
+#include "tensorflow_data_validation/anomalies/string_domain_util.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+#include "tensorflow_metadata/proto/v0/statistics.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::FeatureNameStatistics;
+using ::tensorflow::metadata::v0::FloatDomain;
+using ::tensorflow::metadata::v0::IntDomain;
+using ::tensorflow::metadata::v0::StringDomain;
+
+// Gets the statistics of a string feature with num_values values, which are
+// the decimal representations of 0, 1, ..., num_values - 1 after prefix.
+FeatureNameStatistics GetStatisticsWithValues(int num_values,
+                                              const string& prefix) {
+  FeatureNameStatistics statistics;
+  statistics.set_name("string");
+  statistics.set_type(FeatureNameStatistics::STRING);
+  auto* string_stats = statistics.mutable_string_stats();
+  string_stats->mutable_common_stats()->set_num_non_missing(num_values);
+  string_stats->mutable_common_stats()->set_tot_num_values(num_values);
+  string_stats->set_unique(num_values);
+  auto* rank_histogram = string_stats->mutable_rank_histogram();
+  for (int i = 0; i < num_values; ++i) {
+    auto* bucket = rank_histogram->add_buckets();
+    bucket->set_label(absl::StrCat(prefix, i));
+    bucket->set_sample_count(1);
+  }
+  return statistics;
+}
+
+// Updates a string domain of num_values / 2 values. If all_in_domain, the
+// statistics have the values of the domain, and otherwise they have
+// num_values values, half of which are missing from the domain. The
+// off-domain values are allowed, so that the domain never changes.
+void RunUpdateStringDomain(int iters, int num_values, bool all_in_domain) {
+  ::tensorflow::testing::StopTiming();
+  const testing::DatasetForTesting dataset(GetStatisticsWithValues(
+      all_in_domain ? num_values / 2 : num_values, "value_"));
+  StringDomain string_domain;
+  for (int i = 0; i < num_values / 2; ++i) {
+    string_domain.add_value(absl::StrCat("value_", all_in_domain ? i : 2 * i));
+  }
+  const Schema::Updater updater((FeatureStatisticsToProtoConfig()));
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    const UpdateSummary summary =
+        UpdateStringDomain(updater, dataset.feature_stats_view(),
+                           /*max_off_domain=*/1.0, &string_domain);
+    CHECK(!summary.clear_field);
+  }
+  SetAllocationLabel(start, iters);
+}
+
+void BM_UpdateStringDomain(int iters, int num_values) {
+  RunUpdateStringDomain(iters, num_values, /*all_in_domain=*/true);
+}
+BENCHMARK(BM_UpdateStringDomain)->Range(10, 100000);
+
+void BM_UpdateStringDomainOffDomain(int iters, int num_values) {
+  RunUpdateStringDomain(iters, num_values, /*all_in_domain=*/false);
+}
+BENCHMARK(BM_UpdateStringDomainOffDomain)->Range(10, 100000);
+
+// Checks that the num_values values of a string feature are all integers.
+void BM_UpdateIntDomain(int iters, int num_values) {
+  ::tensorflow::testing::StopTiming();
+  const testing::DatasetForTesting dataset(
+      GetStatisticsWithValues(num_values, ""));
+  IntDomain int_domain;
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    const UpdateSummary summary =
+        UpdateIntDomain(dataset.feature_stats_view(), &int_domain);
+    CHECK(!summary.clear_field);
+  }
+  SetAllocationLabel(start, iters);
+}
+BENCHMARK(BM_UpdateIntDomain)->Range(10, 100000);
+
+// Checks that the num_values values of a string feature are all floats.
+void BM_UpdateFloatDomain(int iters, int num_values) {
+  ::tensorflow::testing::StopTiming();
+  const testing::DatasetForTesting dataset(
+      GetStatisticsWithValues(num_values, "0."));
+  FloatDomain float_domain;
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    const UpdateSummary summary =
+        UpdateFloatDomain(dataset.feature_stats_view(), &float_domain);
+    CHECK(!summary.clear_field);
+  }
+  SetAllocationLabel(start, iters);
+}
+BENCHMARK(BM_UpdateFloatDomain)->Range(10, 100000);
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -0,0 +1,366 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/example_validator.h"
+
+#include <cmath>
+#include <utility>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow_data_validation/anomalies/feature_util.h"
+#include "tensorflow_data_validation/anomalies/path.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+namespace {
+
+using ::tensorflow::metadata::v0::Feature;
+using ::tensorflow::metadata::v0::FeatureType;
+
+// Returns the number of values of a feature of an example.
+int GetNumValues(const ::tensorflow::Feature& feature) {
+  switch (feature.kind_case()) {
+    case ::tensorflow::Feature::kBytesList:
+      return feature.bytes_list().value_size();
+    case ::tensorflow::Feature::kFloatList:
+      return feature.float_list().value_size();
+    case ::tensorflow::Feature::kInt64List:
+      return feature.int64_list().value_size();
+    case ::tensorflow::Feature::KIND_NOT_SET:
+      return 0;
+  }
+  return 0;
+}
+
+// Returns true if the values of a feature of an example have the type.
+bool HasType(const ::tensorflow::Feature& feature, FeatureType type) {
+  switch (type) {
+    case tensorflow::metadata::v0::BYTES:
+      return feature.kind_case() == ::tensorflow::Feature::kBytesList;
+    case tensorflow::metadata::v0::INT:
+      return feature.kind_case() == ::tensorflow::Feature::kInt64List;
+    case tensorflow::metadata::v0::FLOAT:
+      return feature.kind_case() == ::tensorflow::Feature::kFloatList;
+    default:
+      return true;
+  }
+}
+
+}  // namespace
+
+bool ExampleValidationResult::ok() const {
+  for (const uint32 anomalies : feature_anomalies) {
+    if (anomalies != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+ExampleValidator::ExampleValidator(std::shared_ptr<const IndexedSchema> schema,
+                                   const absl::optional<string>& environment)
+    : schema_(std::move(schema)) {
+  for (const Feature& feature : schema_->schema().feature()) {
+    if (feature_indices_.contains(feature.name())) {
+      // Like the lookups in Schema, only the first feature with a name is
+      // checked.
+      continue;
+    }
+    const Path path({feature.name()});
+    if (schema_->FeatureIsDeprecated(path) ||
+        !schema_->FeatureIsInEnvironment(path, environment) ||
+        feature.type() == tensorflow::metadata::v0::STRUCT) {
+      feature_indices_[feature.name()] = -1;
+      continue;
+    }
+    feature_indices_[feature.name()] = checks_.size();
+    checks_.push_back(Compile(feature));
+    feature_names_.push_back(feature.name());
+  }
+}
+
+ExampleValidator::FeatureChecks ExampleValidator::Compile(
+    const Feature& feature) {
+  FeatureChecks checks;
+  checks.name = feature.name();
+  checks.type = feature.type();
+  checks.required =
+      feature.has_presence() && feature.presence().min_fraction() >= 1.0;
+  if (feature.has_shape()) {
+    int64 num_values = 1;
+    for (const auto& dim : feature.shape().dim()) {
+      num_values *= dim.size();
+    }
+    checks.min_num_values = num_values;
+    checks.max_num_values = num_values;
+  } else if (feature.has_value_count() ||
+             (feature.has_value_counts() &&
+              feature.value_counts().value_count_size() == 1)) {
+    // The values of an example are not nested, so only a single level of
+    // value counts applies.
+    const tensorflow::metadata::v0::ValueCount& value_count =
+        feature.has_value_count() ? feature.value_count()
+                                  : feature.value_counts().value_count(0);
+    if (value_count.has_min()) {
+      checks.min_num_values = value_count.min();
+    }
+    if (value_count.has_max()) {
+      checks.max_num_values = value_count.max();
+    }
+  }
+  const bool check_string_domain =
+      GetMaxOffDomain(feature.distribution_constraints()) <= 0.0;
+  checks.domain_case = feature.domain_info_case();
+  switch (feature.domain_info_case()) {
+    case Feature::kIntDomain:
+      checks.int_domain = &feature.int_domain();
+      break;
+    case Feature::kFloatDomain:
+      checks.float_domain = &feature.float_domain();
+      break;
+    case Feature::kBoolDomain:
+      checks.bool_domain = &feature.bool_domain();
+      break;
+    case Feature::kStringDomain:
+    case Feature::kDomain:
+      // A missing domain is an anomaly of the schema, not of the examples.
+      if (check_string_domain) {
+        checks.string_domain_values =
+            schema_->GetFeatureStringDomainValues(Path({feature.name()}));
+      }
+      break;
+    default:
+      // The other domains only have constraints on datasets.
+      checks.domain_case = Feature::DOMAIN_INFO_NOT_SET;
+      break;
+  }
+  return checks;
+}
+
+bool ExampleValidator::Validate(const ::tensorflow::Example& example,
+                                ExampleValidationResult* result) const {
+  return Validate(example.features(), result);
+}
+
+bool ExampleValidator::Validate(const ::tensorflow::Features& features,
+                                ExampleValidationResult* result) const {
+  result->feature_anomalies.assign(checks_.size(), 0);
+  bool ok = true;
+  int num_found = 0;
+  for (int i = 0; i < checks_.size(); ++i) {
+    bool found;
+    const uint32 anomalies = CheckFeatureIn(checks_[i], features, &found);
+    num_found += found;
+    result->feature_anomalies[i] = anomalies;
+    ok = ok && anomalies == 0;
+  }
+  // Only look for the unknown features when some feature was not found, as
+  // the lookups of the schema features already account for the others.
+  result->num_unknown_features = num_found < features.feature().size()
+                                     ? CountUnknownFeatures(features)
+                                     : 0;
+  return ok;
+}
+
+bool ExampleValidator::ValidateBatch(
+    const std::vector<const ::tensorflow::Example*>& examples,
+    BatchValidationResult* result) const {
+  const int num_examples = examples.size();
+  result->num_examples = num_examples;
+  result->feature_anomalies.assign(checks_.size() * num_examples, 0);
+  result->examples_with_anomalies.assign((num_examples + 63) / 64, 0);
+  result->num_examples_with_anomalies.assign(checks_.size(), 0);
+  result->num_unknown_features = 0;
+  // The features of the schema found in each example are not kept, so the
+  // unknown features are counted apart.
+  for (const ::tensorflow::Example* example : examples) {
+    result->num_unknown_features += CountUnknownFeatures(example->features());
+  }
+  for (int i = 0; i < checks_.size(); ++i) {
+    const FeatureChecks& checks = checks_[i];
+    uint32* const column = &result->feature_anomalies[i * num_examples];
+    int64 num_examples_with_anomalies = 0;
+    for (int j = 0; j < num_examples; ++j) {
+      bool found;
+      const uint32 anomalies =
+          CheckFeatureIn(checks, examples[j]->features(), &found);
+      column[j] = anomalies;
+      if (anomalies != 0) {
+        ++num_examples_with_anomalies;
+        result->examples_with_anomalies[j / 64] |= uint64{1} << (j % 64);
+      }
+    }
+    result->num_examples_with_anomalies[i] = num_examples_with_anomalies;
+  }
+  for (const uint64 word : result->examples_with_anomalies) {
+    if (word != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32 ExampleValidator::CheckFeatureIn(const FeatureChecks& checks,
+                                        const ::tensorflow::Features& features,
+                                        bool* found) const {
+  const auto it = features.feature().find(checks.name);
+  *found = it != features.feature().end();
+  // A feature without values of any kind is missing, as when examples are
+  // decoded.
+  if (!*found ||
+      it->second.kind_case() == ::tensorflow::Feature::KIND_NOT_SET) {
+    return checks.required ? kExampleFeatureMissing : 0;
+  }
+  return CheckFeature(checks, it->second);
+}
+
+int ExampleValidator::CountUnknownFeatures(
+    const ::tensorflow::Features& features) const {
+  int result = 0;
+  for (const auto& entry : features.feature()) {
+    if (!feature_indices_.contains(entry.first)) {
+      ++result;
+    }
+  }
+  return result;
+}
+
+uint32 ExampleValidator::CheckFeature(
+    const FeatureChecks& checks, const ::tensorflow::Feature& feature) const {
+  if (!HasType(feature, checks.type)) {
+    // The values cannot be checked against the domain of another type.
+    return kExampleUnexpectedType;
+  }
+  uint32 anomalies = 0;
+  const int num_values = GetNumValues(feature);
+  if (checks.min_num_values && num_values < *checks.min_num_values) {
+    anomalies |= kExampleTooFewValues;
+  }
+  if (checks.max_num_values && num_values > *checks.max_num_values) {
+    anomalies |= kExampleTooManyValues;
+  }
+  if (checks.domain_case == Feature::DOMAIN_INFO_NOT_SET) {
+    return anomalies;
+  }
+  switch (feature.kind_case()) {
+    case ::tensorflow::Feature::kBytesList:
+      for (const string& value : feature.bytes_list().value()) {
+        anomalies |= CheckString(checks, value);
+      }
+      break;
+    case ::tensorflow::Feature::kFloatList:
+      for (const float value : feature.float_list().value()) {
+        anomalies |= CheckFloat(checks, value);
+      }
+      break;
+    case ::tensorflow::Feature::kInt64List:
+      for (const int64 value : feature.int64_list().value()) {
+        anomalies |= CheckInt(checks, value);
+      }
+      break;
+    case ::tensorflow::Feature::KIND_NOT_SET:
+      break;
+  }
+  return anomalies;
+}
+
+uint32 ExampleValidator::CheckInt(const FeatureChecks& checks,
+                                  int64 value) const {
+  switch (checks.domain_case) {
+    case Feature::kIntDomain:
+      if ((checks.int_domain->has_min() && value < checks.int_domain->min()) ||
+          (checks.int_domain->has_max() && value > checks.int_domain->max())) {
+        return kExampleIntOutOfDomain;
+      }
+      return 0;
+    case Feature::kBoolDomain:
+      return value == 0 || value == 1 ? 0 : kExampleNotBool;
+    case Feature::kStringDomain:
+    case Feature::kDomain:
+      // The values of a categorical INT feature are compared as strings.
+      // AlphaNum formats them in a buffer of its own, without allocating.
+      return CheckString(checks, absl::AlphaNum(value).Piece());
+    default:
+      return 0;
+  }
+}
+
+uint32 ExampleValidator::CheckFloat(const FeatureChecks& checks,
+                                    float value) const {
+  switch (checks.domain_case) {
+    case Feature::kFloatDomain: {
+      const tensorflow::metadata::v0::FloatDomain& domain =
+          *checks.float_domain;
+      if (std::isnan(value)) {
+        return domain.disallow_nan() ? kExampleNan : 0;
+      }
+      uint32 anomalies = 0;
+      if (domain.disallow_inf() && std::isinf(value)) {
+        anomalies |= kExampleInf;
+      }
+      if ((domain.has_min() && value < domain.min()) ||
+          (domain.has_max() && value > domain.max())) {
+        anomalies |= kExampleFloatOutOfDomain;
+      }
+      return anomalies;
+    }
+    case Feature::kBoolDomain:
+      return value == 0.0f || value == 1.0f ? 0 : kExampleNotBool;
+    default:
+      return 0;
+  }
+}
+
+uint32 ExampleValidator::CheckString(const FeatureChecks& checks,
+                                     absl::string_view value) const {
+  switch (checks.domain_case) {
+    case Feature::kIntDomain: {
+      int64 int_value;
+      if (!absl::SimpleAtoi(value, &int_value)) {
+        return kExampleIntOutOfDomain;
+      }
+      return CheckInt(checks, int_value);
+    }
+    case Feature::kFloatDomain: {
+      float float_value;
+      if (!absl::SimpleAtof(value, &float_value)) {
+        return kExampleFloatOutOfDomain;
+      }
+      return CheckFloat(checks, float_value);
+    }
+    case Feature::kBoolDomain: {
+      const tensorflow::metadata::v0::BoolDomain& domain = *checks.bool_domain;
+      if ((domain.has_true_value() && value == domain.true_value()) ||
+          (domain.has_false_value() && value == domain.false_value())) {
+        return 0;
+      }
+      return kExampleNotBool;
+    }
+    case Feature::kStringDomain:
+    case Feature::kDomain:
+      if (checks.string_domain_values != nullptr &&
+          !checks.string_domain_values->contains(value)) {
+        return kExampleStringOutOfDomain;
+      }
+      return 0;
+    default:
+      return 0;
+  }
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
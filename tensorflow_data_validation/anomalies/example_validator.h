@@ -0,0 +1,210 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_EXAMPLE_VALIDATOR_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_EXAMPLE_VALIDATOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "tensorflow_data_validation/anomalies/schema.h"
+#include "tensorflow/core/example/example.pb.h"
+#include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// The ways a feature of a single example can violate the schema. A feature
+// can have several of them, so they are bits.
+enum ExampleAnomaly : uint32 {
+  // The feature is required in every example, but is missing.
+  kExampleFeatureMissing = 1 << 0,
+  // The values of the feature do not have the type of the feature.
+  kExampleUnexpectedType = 1 << 1,
+  // The feature has fewer values than its value count or shape allows.
+  kExampleTooFewValues = 1 << 2,
+  // The feature has more values than its value count or shape allows.
+  kExampleTooManyValues = 1 << 3,
+  // An int (or a string representing an int) is out of the int domain, or a
+  // string does not represent an int.
+  kExampleIntOutOfDomain = 1 << 4,
+  // A float (or a string representing a float) is out of the float domain,
+  // or a string does not represent a float.
+  kExampleFloatOutOfDomain = 1 << 5,
+  // A float is NaN, which the float domain disallows.
+  kExampleNan = 1 << 6,
+  // A float is infinite, which the float domain disallows.
+  kExampleInf = 1 << 7,
+  // A value is not in the string domain.
+  kExampleStringOutOfDomain = 1 << 8,
+  // A value is not one of the values of the bool domain.
+  kExampleNotBool = 1 << 9,
+};
+
+// The result of validating an example, reused across examples so that
+// validating one does not allocate.
+struct ExampleValidationResult {
+  // For each feature of ExampleValidator::feature_names(), the bitwise or of
+  // its ExampleAnomaly values, or 0 if it conforms to the schema.
+  std::vector<uint32> feature_anomalies;
+  // The number of features of the example that are not in the schema.
+  int num_unknown_features = 0;
+
+  // Returns true if the example has no anomaly. Unknown features are not
+  // anomalies, as they would be at the level of a dataset.
+  bool ok() const;
+};
+
+// The result of validating a batch of examples, reused across batches so
+// that validating one only allocates when the batch is larger than before.
+struct BatchValidationResult {
+  int num_examples = 0;
+  // The ExampleAnomaly values of each feature of ExampleValidator::
+  // feature_names() in each example, by feature then example (i.e., the
+  // column of a feature is contiguous). See anomalies().
+  std::vector<uint32> feature_anomalies;
+  // A bitmap of the examples that have an anomaly: bit i % 64 of word i / 64
+  // is set if example i has one.
+  std::vector<uint64> examples_with_anomalies;
+  // For each feature of ExampleValidator::feature_names(), the number of
+  // examples in which it has an anomaly.
+  std::vector<int64> num_examples_with_anomalies;
+  // The number of features of the examples that are not in the schema,
+  // summed over the examples.
+  int64 num_unknown_features = 0;
+
+  // The anomalies of a feature in an example.
+  uint32 anomalies(int feature_index, int example_index) const {
+    return feature_anomalies[feature_index * num_examples + example_index];
+  }
+
+  // Returns true if the example has an anomaly.
+  bool ExampleHasAnomaly(int example_index) const {
+    return (examples_with_anomalies[example_index / 64] >>
+            (example_index % 64)) &
+           1;
+  }
+};
+
+// Validates single examples against the top-level features of a schema, in
+// an environment, for requests that must be rejected inline (e.g., when
+// serving) rather than once their statistics are computed. The checks of
+// each feature are compiled once, and validating an example makes no heap
+// allocation once its result has the size of feature_names().
+//
+// The checks follow the semantics of the validation of statistics made by
+// Schema::Update(), restricted to what one example can violate: the type,
+// the value count or fixed shape, and the int, float, string and bool
+// domains, which are checked as by int_domain_util.h, float_domain_util.h,
+// string_domain_util.h and bool_domain_util.h (e.g., the strings of a BYTES
+// feature with an int domain must represent ints in the domain). Constraints
+// that only a dataset can violate are relaxed accordingly: a feature is only
+// required if its presence has a min_fraction of 1, and its values are only
+// checked against a string domain if its distribution constraints allow no
+// value out of the domain. Deprecated features, features that are not in the
+// environment, and STRUCT features are not checked. Thread-safe.
+class ExampleValidator {
+ public:
+  ExampleValidator(std::shared_ptr<const IndexedSchema> schema,
+                   const absl::optional<string>& environment);
+
+  ExampleValidator(const ExampleValidator&) = delete;
+  ExampleValidator& operator=(const ExampleValidator&) = delete;
+
+  // The names of the features checked, in the order of the schema.
+  const std::vector<absl::string_view>& feature_names() const {
+    return feature_names_;
+  }
+
+  // Validates an example, and returns true if it has no anomaly (see
+  // ExampleValidationResult::ok()).
+  bool Validate(const ::tensorflow::Example& example,
+                ExampleValidationResult* result) const;
+
+  // Same as above, given the features of the example.
+  bool Validate(const ::tensorflow::Features& features,
+                ExampleValidationResult* result) const;
+
+  // Validates a batch of examples one feature at a time, so that the checks
+  // of a feature run over all the examples in a tight loop. Returns true if
+  // no example has an anomaly.
+  bool ValidateBatch(const std::vector<const ::tensorflow::Example*>& examples,
+                     BatchValidationResult* result) const;
+
+ private:
+  // The checks of a feature, with their parameters extracted from the
+  // schema.
+  struct FeatureChecks {
+    string name;
+    tensorflow::metadata::v0::FeatureType type =
+        tensorflow::metadata::v0::TYPE_UNKNOWN;
+    bool required = false;
+    // The bounds on the number of values in the example.
+    absl::optional<int64> min_num_values;
+    absl::optional<int64> max_num_values;
+    tensorflow::metadata::v0::Feature::DomainInfoCase domain_case =
+        tensorflow::metadata::v0::Feature::DOMAIN_INFO_NOT_SET;
+    // The domain of the feature, pointing into the schema.
+    const tensorflow::metadata::v0::IntDomain* int_domain = nullptr;
+    const tensorflow::metadata::v0::FloatDomain* float_domain = nullptr;
+    const tensorflow::metadata::v0::BoolDomain* bool_domain = nullptr;
+    // The values of the string domain, if they are checked.
+    const StringDomainValueSet* string_domain_values = nullptr;
+  };
+
+  // Compiles the checks of a feature of the schema.
+  FeatureChecks Compile(const tensorflow::metadata::v0::Feature& feature);
+
+  // Returns the anomalies of a feature in the features of an example, and
+  // sets found if the example has the feature.
+  uint32 CheckFeatureIn(const FeatureChecks& checks,
+                        const ::tensorflow::Features& features,
+                        bool* found) const;
+
+  // Returns the number of features that are not in the schema.
+  int CountUnknownFeatures(const ::tensorflow::Features& features) const;
+
+  // Returns the anomalies of the values of a feature.
+  uint32 CheckFeature(const FeatureChecks& checks,
+                      const ::tensorflow::Feature& feature) const;
+
+  // Returns the anomalies of a value, as an int, against the domain.
+  uint32 CheckInt(const FeatureChecks& checks, int64 value) const;
+
+  // Returns the anomalies of a value, as a float, against the domain.
+  uint32 CheckFloat(const FeatureChecks& checks, float value) const;
+
+  // Returns the anomalies of a value, as a string, against the domain.
+  uint32 CheckString(const FeatureChecks& checks,
+                     absl::string_view value) const;
+
+  // The schema, which the checks point into.
+  const std::shared_ptr<const IndexedSchema> schema_;
+  std::vector<FeatureChecks> checks_;
+  std::vector<absl::string_view> feature_names_;
+  // The indices of the features of the schema in checks_, or -1 for the
+  // ones that are not checked.
+  absl::flat_hash_map<string, int> feature_indices_;
+};
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_EXAMPLE_VALIDATOR_H_
@@ -0,0 +1,115 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Benchmarks of the validation of single examples.
+// Run with --benchmarks=all.
+
+#include "tensorflow_data_validation/anomalies/example_validator.h"
+
+#include <memory>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "tensorflow_data_validation/anomalies/allocation_counter.h"
+#include "tensorflow_data_validation/anomalies/schema.h"
+#include "tensorflow/core/example/example.pb.h"
+#include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::Schema;
+
+// Sets schema and example to num_features features of each of the types INT,
+// FLOAT and BYTES, with 10 values each in the example, and their value counts
+// and domains in the schema.
+void GetSchemaAndExample(int num_features, Schema* schema,
+                         ::tensorflow::Example* example) {
+  auto& feature_map = *example->mutable_features()->mutable_feature();
+  for (int i = 0; i < num_features; ++i) {
+    tensorflow::metadata::v0::Feature* int_feature = schema->add_feature();
+    int_feature->set_name(absl::StrCat("int_", i));
+    int_feature->set_type(tensorflow::metadata::v0::INT);
+    int_feature->mutable_presence()->set_min_fraction(1.0);
+    int_feature->mutable_value_count()->set_min(1);
+    int_feature->mutable_int_domain()->set_min(0);
+    tensorflow::metadata::v0::Feature* float_feature = schema->add_feature();
+    float_feature->set_name(absl::StrCat("float_", i));
+    float_feature->set_type(tensorflow::metadata::v0::FLOAT);
+    float_feature->mutable_float_domain()->set_disallow_nan(true);
+    tensorflow::metadata::v0::Feature* string_feature = schema->add_feature();
+    string_feature->set_name(absl::StrCat("string_", i));
+    string_feature->set_type(tensorflow::metadata::v0::BYTES);
+    for (int j = 0; j < 10; ++j) {
+      string_feature->mutable_string_domain()->add_value(
+          absl::StrCat("value_", j));
+      feature_map[int_feature->name()].mutable_int64_list()->add_value(j);
+      feature_map[float_feature->name()].mutable_float_list()->add_value(j);
+      feature_map[string_feature->name()].mutable_bytes_list()->add_value(
+          absl::StrCat("value_", j));
+    }
+  }
+}
+
+// Validates the example of GetSchemaAndExample().
+void BM_ValidateExample(int iters, int num_features) {
+  ::tensorflow::testing::StopTiming();
+  Schema schema;
+  ::tensorflow::Example example;
+  GetSchemaAndExample(num_features, &schema, &example);
+  const ExampleValidator validator(
+      std::make_shared<const IndexedSchema>(schema), absl::nullopt);
+  ExampleValidationResult result;
+  // Sizes the result.
+  CHECK(validator.Validate(example, &result));
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    CHECK(validator.Validate(example, &result));
+  }
+  SetAllocationLabel(start, iters);
+}
+BENCHMARK(BM_ValidateExample)->Range(1, 100);
+
+// Validates batches of 1000 copies of the example of GetSchemaAndExample().
+void BM_ValidateBatch(int iters, int num_features) {
+  ::tensorflow::testing::StopTiming();
+  Schema schema;
+  ::tensorflow::Example example;
+  GetSchemaAndExample(num_features, &schema, &example);
+  const ExampleValidator validator(
+      std::make_shared<const IndexedSchema>(schema), absl::nullopt);
+  const std::vector<const ::tensorflow::Example*> batch(1000, &example);
+  BatchValidationResult result;
+  // Sizes the result.
+  CHECK(validator.ValidateBatch(batch, &result));
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    CHECK(validator.ValidateBatch(batch, &result));
+  }
+  SetAllocationLabel(start, iters);
+}
+BENCHMARK(BM_ValidateBatch)->Range(1, 100);
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
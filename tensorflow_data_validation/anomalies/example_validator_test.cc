@@ -0,0 +1,339 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/example_validator.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "absl/types/optional.h"
+#include "tensorflow_data_validation/anomalies/schema.h"
+#include "tensorflow_data_validation/anomalies/test_util.h"
+#include "tensorflow/core/example/example.pb.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using testing::ParseTextProtoOrDie;
+
+// Returns the anomalies of each feature of example against schema, or of the
+// features ok if they are all valid.
+std::vector<uint32> GetAnomalies(const string& schema, const string& example,
+                                 const absl::optional<string>& environment) {
+  const ExampleValidator validator(
+      std::make_shared<const IndexedSchema>(
+          ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(schema)),
+      environment);
+  ExampleValidationResult result;
+  const bool ok = validator.Validate(
+      ParseTextProtoOrDie<::tensorflow::Example>(example), &result);
+  EXPECT_EQ(ok, result.ok());
+  return result.feature_anomalies;
+}
+
+std::vector<uint32> GetAnomalies(const string& schema,
+                                 const string& example) {
+  return GetAnomalies(schema, example, absl::nullopt);
+}
+
+TEST(ExampleValidatorTest, ValidExample) {
+  const ExampleValidator validator(
+      std::make_shared<const IndexedSchema>(
+          ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"(
+            feature {
+              name: "int"
+              type: INT
+              presence { min_fraction: 1 }
+              value_count { min: 1 max: 2 }
+              int_domain { min: 0 max: 10 }
+            }
+            feature {
+              name: "float"
+              type: FLOAT
+              shape { dim { size: 2 } }
+              float_domain { min: 0 max: 1 disallow_nan: true }
+            }
+            feature {
+              name: "string"
+              type: BYTES
+              string_domain { value: "a" value: "b" }
+            })")),
+      absl::nullopt);
+  EXPECT_EQ(validator.feature_names(),
+            std::vector<absl::string_view>({"int", "float", "string"}));
+  ExampleValidationResult result;
+  EXPECT_TRUE(validator.Validate(
+      ParseTextProtoOrDie<::tensorflow::Example>(R"(
+        features {
+          feature {
+            key: "int"
+            value { int64_list { value: [ 1, 10 ] } }
+          }
+          feature {
+            key: "float"
+            value { float_list { value: [ 0, 0.5 ] } }
+          }
+          feature {
+            key: "string"
+            value { bytes_list { value: "b" } }
+          }
+          feature {
+            key: "other"
+            value { bytes_list { value: "c" } }
+          }
+        })"),
+      &result));
+  EXPECT_EQ(result.feature_anomalies, std::vector<uint32>({0, 0, 0}));
+  EXPECT_EQ(result.num_unknown_features, 1);
+}
+
+TEST(ExampleValidatorTest, Presence) {
+  const string schema = R"(
+    feature { name: "required" type: INT presence { min_fraction: 1 } }
+    feature { name: "optional" type: INT presence { min_fraction: 0.5 } })";
+  EXPECT_EQ(GetAnomalies(schema, ""),
+            std::vector<uint32>({kExampleFeatureMissing, 0}));
+  // A feature without values of any kind is missing.
+  EXPECT_EQ(GetAnomalies(schema, R"(
+              features { feature { key: "required" value {} } })"),
+            std::vector<uint32>({kExampleFeatureMissing, 0}));
+  EXPECT_EQ(GetAnomalies(schema, R"(
+              features {
+                feature { key: "required" value { int64_list {} } }
+              })"),
+            std::vector<uint32>({0, 0}));
+}
+
+TEST(ExampleValidatorTest, TypeAndValueCounts) {
+  const string schema = R"(
+    feature { name: "count" type: INT value_count { min: 2 max: 3 } }
+    feature { name: "shape" type: FLOAT shape { dim { size: 2 } } }
+    feature { name: "bytes" type: BYTES })";
+  EXPECT_EQ(GetAnomalies(schema, R"(
+              features {
+                feature { key: "count" value { int64_list { value: 1 } } }
+                feature {
+                  key: "shape"
+                  value { float_list { value: [ 1, 2, 3 ] } }
+                }
+                feature { key: "bytes" value { int64_list { value: 1 } } }
+              })"),
+            std::vector<uint32>({kExampleTooFewValues, kExampleTooManyValues,
+                                 kExampleUnexpectedType}));
+}
+
+TEST(ExampleValidatorTest, IntDomain) {
+  const string schema = R"(
+    feature { name: "int" type: INT int_domain { min: 0 max: 5 } }
+    feature { name: "string" type: BYTES int_domain { min: 0 max: 5 } })";
+  EXPECT_EQ(GetAnomalies(schema, R"(
+              features {
+                feature { key: "int" value { int64_list { value: [ 0, 5 ] } } }
+                feature { key: "string" value { bytes_list { value: "3" } } }
+              })"),
+            std::vector<uint32>({0, 0}));
+  EXPECT_EQ(GetAnomalies(schema, R"(
+              features {
+                feature { key: "int" value { int64_list { value: 6 } } }
+                feature { key: "string" value { bytes_list { value: "a" } } }
+              })"),
+            std::vector<uint32>(
+                {kExampleIntOutOfDomain, kExampleIntOutOfDomain}));
+}
+
+TEST(ExampleValidatorTest, FloatDomain) {
+  const string schema = R"(
+    feature {
+      name: "float"
+      type: FLOAT
+      float_domain { max: 1 disallow_nan: true disallow_inf: true }
+    }
+    feature { name: "string" type: BYTES float_domain { min: 0 } }
+    feature { name: "nan" type: FLOAT float_domain { max: 1 } })";
+  EXPECT_EQ(GetAnomalies(schema, R"(
+              features {
+                feature {
+                  key: "float"
+                  value { float_list { value: [ nan, -inf, 2 ] } }
+                }
+                feature {
+                  key: "string"
+                  value { bytes_list { value: [ "0.5", "-1" ] } }
+                }
+                feature { key: "nan" value { float_list { value: nan } } }
+              })"),
+            std::vector<uint32>(
+                {kExampleNan | kExampleInf | kExampleFloatOutOfDomain,
+                 kExampleFloatOutOfDomain, 0}));
+}
+
+TEST(ExampleValidatorTest, StringDomain) {
+  const string schema = R"(
+    string_domain { name: "shared" value: "x" }
+    feature { name: "inline" type: BYTES string_domain { value: "a" } }
+    feature { name: "shared" type: BYTES domain: "shared" }
+    feature { name: "categorical" type: INT string_domain { value: "7" } }
+    feature {
+      name: "tolerant"
+      type: BYTES
+      string_domain { value: "a" }
+      distribution_constraints { min_domain_mass: 0.5 }
+    })";
+  EXPECT_EQ(GetAnomalies(schema, R"(
+              features {
+                feature { key: "inline" value { bytes_list { value: "a" } } }
+                feature { key: "shared" value { bytes_list { value: "y" } } }
+                feature {
+                  key: "categorical"
+                  value { int64_list { value: [ 7, 8 ] } }
+                }
+                feature { key: "tolerant" value { bytes_list { value: "b" } } }
+              })"),
+            std::vector<uint32>(
+                {0, kExampleStringOutOfDomain, kExampleStringOutOfDomain, 0}));
+}
+
+TEST(ExampleValidatorTest, BoolDomain) {
+  const string schema = R"(
+    feature { name: "int" type: INT bool_domain {} }
+    feature { name: "float" type: FLOAT bool_domain {} }
+    feature {
+      name: "string"
+      type: BYTES
+      bool_domain { true_value: "yes" false_value: "no" }
+    })";
+  EXPECT_EQ(GetAnomalies(schema, R"(
+              features {
+                feature { key: "int" value { int64_list { value: [ 0, 1 ] } } }
+                feature { key: "float" value { float_list { value: 1 } } }
+                feature { key: "string" value { bytes_list { value: "no" } } }
+              })"),
+            std::vector<uint32>({0, 0, 0}));
+  EXPECT_EQ(GetAnomalies(schema, R"(
+              features {
+                feature { key: "int" value { int64_list { value: 2 } } }
+                feature { key: "float" value { float_list { value: 0.5 } } }
+                feature { key: "string" value { bytes_list { value: "1" } } }
+              })"),
+            std::vector<uint32>(
+                {kExampleNotBool, kExampleNotBool, kExampleNotBool}));
+}
+
+TEST(ExampleValidatorTest, SkipsDeprecatedAndOtherEnvironments) {
+  const string schema = R"(
+    default_environment: "TRAINING"
+    default_environment: "SERVING"
+    feature {
+      name: "label"
+      type: INT
+      presence { min_fraction: 1 }
+      not_in_environment: "SERVING"
+    }
+    feature {
+      name: "deprecated"
+      type: INT
+      presence { min_fraction: 1 }
+      lifecycle_stage: DEPRECATED
+    }
+    feature { name: "int" type: INT presence { min_fraction: 1 } })";
+  EXPECT_EQ(GetAnomalies(schema, "", string("TRAINING")),
+            std::vector<uint32>(
+                {kExampleFeatureMissing, kExampleFeatureMissing}));
+  EXPECT_EQ(GetAnomalies(schema, "", string("SERVING")),
+            std::vector<uint32>({kExampleFeatureMissing}));
+  // The features that are not checked are not unknown.
+  const ExampleValidator validator(
+      std::make_shared<const IndexedSchema>(
+          ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(schema)),
+      string("SERVING"));
+  ExampleValidationResult result;
+  EXPECT_TRUE(validator.Validate(
+      ParseTextProtoOrDie<::tensorflow::Example>(R"(
+        features {
+          feature { key: "int" value { int64_list { value: 1 } } }
+          feature { key: "label" value { int64_list { value: 1 } } }
+          feature { key: "deprecated" value { int64_list { value: 1 } } }
+        })"),
+      &result));
+  EXPECT_EQ(result.num_unknown_features, 0);
+}
+
+TEST(ExampleValidatorTest, ValidateBatch) {
+  const ExampleValidator validator(
+      std::make_shared<const IndexedSchema>(
+          ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"(
+            feature { name: "int" type: INT int_domain { max: 5 } }
+            feature {
+              name: "string"
+              type: BYTES
+              presence { min_fraction: 1 }
+            })")),
+      absl::nullopt);
+  std::vector<::tensorflow::Example> examples;
+  // Example 0 is valid, example 1 misses "string", and example 2 has an
+  // unknown feature and an int out of the domain.
+  examples.push_back(ParseTextProtoOrDie<::tensorflow::Example>(R"(
+    features {
+      feature { key: "int" value { int64_list { value: 1 } } }
+      feature { key: "string" value { bytes_list { value: "a" } } }
+    })"));
+  examples.push_back(ParseTextProtoOrDie<::tensorflow::Example>(R"(
+    features { feature { key: "int" value { int64_list { value: 1 } } } })"));
+  examples.push_back(ParseTextProtoOrDie<::tensorflow::Example>(R"(
+    features {
+      feature { key: "int" value { int64_list { value: 6 } } }
+      feature { key: "string" value { bytes_list { value: "a" } } }
+      feature { key: "other" value { bytes_list { value: "a" } } }
+    })"));
+  std::vector<const ::tensorflow::Example*> batch;
+  for (const ::tensorflow::Example& example : examples) {
+    batch.push_back(&example);
+  }
+  BatchValidationResult result;
+  EXPECT_FALSE(validator.ValidateBatch(batch, &result));
+  EXPECT_EQ(result.num_examples, 3);
+  EXPECT_EQ(result.feature_anomalies,
+            std::vector<uint32>({0, 0, kExampleIntOutOfDomain, 0,
+                                 kExampleFeatureMissing, 0}));
+  EXPECT_EQ(result.anomalies(1, 1), kExampleFeatureMissing);
+  EXPECT_FALSE(result.ExampleHasAnomaly(0));
+  EXPECT_TRUE(result.ExampleHasAnomaly(1));
+  EXPECT_TRUE(result.ExampleHasAnomaly(2));
+  EXPECT_EQ(result.num_examples_with_anomalies, std::vector<int64>({1, 1}));
+  EXPECT_EQ(result.num_unknown_features, 1);
+
+  // The result is the same as validating the examples one at a time.
+  for (int i = 0; i < examples.size(); ++i) {
+    ExampleValidationResult example_result;
+    EXPECT_EQ(validator.Validate(examples[i], &example_result),
+              !result.ExampleHasAnomaly(i));
+    EXPECT_EQ(example_result.feature_anomalies,
+              std::vector<uint32>(
+                  {result.anomalies(0, i), result.anomalies(1, i)}));
+  }
+
+  batch.resize(1);
+  EXPECT_TRUE(validator.ValidateBatch(batch, &result));
+  EXPECT_EQ(result.num_unknown_features, 0);
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -0,0 +1,294 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/feature_check_program.h"
+
+#include <climits>
+#include <cmath>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "tensorflow_data_validation/anomalies/feature_util.h"
+#include "tensorflow_metadata/proto/v0/statistics.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::Feature;
+using ::tensorflow::metadata::v0::FeatureNameStatistics;
+using ::tensorflow::metadata::v0::ValueCount;
+using Op = FeatureCheckProgram::Op;
+
+// As in custom_domain_util.cc.
+constexpr char kDomainInfo[] = "domain_info";
+
+// Returns true if Schema::UpdateFeatureSelf() leaves the value count as is.
+bool ValueCountIsValid(const ValueCount& value_count) {
+  return value_count.min() >= 0 &&
+         !(value_count.has_max() && value_count.max() < value_count.min());
+}
+
+void AddNumValuesOp(int level, const ValueCount& value_count,
+                    std::vector<Op>* ops) {
+  if (!value_count.has_min() && !value_count.has_max()) {
+    return;
+  }
+  Op op(Op::kNumValues);
+  op.level = level;
+  op.has_min = value_count.has_min();
+  op.has_max = value_count.has_max();
+  op.int_min = value_count.min();
+  op.int_max = value_count.max();
+  ops->push_back(op);
+}
+
+// Same conditions as UpdateIntDomain(), for INT statistics.
+bool IntRangePasses(const Op& op, const FeatureStatsView& view) {
+  if (view.type() != FeatureNameStatistics::INT ||
+      !view.GetStringValueTable().empty()) {
+    return false;
+  }
+  const double min = view.num_stats().min();
+  const double max = view.num_stats().max();
+  if (min < LLONG_MIN || max > LLONG_MAX) {
+    return false;
+  }
+  return !(op.has_min && op.int_min > static_cast<int64>(min)) &&
+         !(op.has_max && op.int_max < static_cast<int64>(max));
+}
+
+// Same conditions as UpdateFloatDomain(), for FLOAT statistics.
+bool FloatRangePasses(const Op& op, const FeatureStatsView& view) {
+  if (view.type() != FeatureNameStatistics::FLOAT) {
+    return false;
+  }
+  const float min = static_cast<float>(view.num_stats().min());
+  const float max = static_cast<float>(view.num_stats().max());
+  return !(op.has_min && min < op.float_min) &&
+         !(op.has_max && max > op.float_max) &&
+         !(op.disallow_inf && (std::isinf(min) || std::isinf(max)));
+}
+
+bool NoNanPasses(const FeatureStatsView& view) {
+  if (view.type() != FeatureNameStatistics::FLOAT) {
+    return false;
+  }
+  for (const auto& histogram : view.num_stats().histograms()) {
+    if (histogram.num_nan() > 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+std::unique_ptr<const FeatureCheckProgram> FeatureCheckProgram::Compile(
+    const Feature& feature) {
+  // Schema::UpdateFeatureSelf() would report these.
+  if (FeatureIsDeprecated(feature) || !feature.has_name() ||
+      !feature.has_type() ||
+      feature.type() == tensorflow::metadata::v0::TYPE_UNKNOWN ||
+      feature.presence().min_fraction() < 0.0 ||
+      feature.presence().min_fraction() > 1.0 ||
+      !ValueCountIsValid(feature.value_count())) {
+    return nullptr;
+  }
+  for (const ValueCount& value_count : feature.value_counts().value_count()) {
+    if (!ValueCountIsValid(value_count)) {
+      return nullptr;
+    }
+  }
+  if (feature.has_shape() || feature.has_unique_constraints()) {
+    return nullptr;
+  }
+  switch (feature.domain_info_case()) {
+    case Feature::DOMAIN_INFO_NOT_SET:
+      break;
+    case Feature::kIntDomain:
+      if (feature.type() != tensorflow::metadata::v0::INT ||
+          feature.has_distribution_constraints()) {
+        return nullptr;
+      }
+      break;
+    case Feature::kFloatDomain:
+      if (feature.type() != tensorflow::metadata::v0::FLOAT ||
+          feature.has_distribution_constraints()) {
+        return nullptr;
+      }
+      break;
+    default:
+      return nullptr;
+  }
+
+  auto program = absl::WrapUnique(new FeatureCheckProgram());
+  std::vector<Op>& ops = program->ops_;
+  ops.push_back(Op(Op::kPresent));
+  Op type(Op::kType);
+  type.type = feature.type();
+  ops.push_back(type);
+
+  if (feature.has_value_count()) {
+    Op num_levels(Op::kNumLevels);
+    num_levels.level = 1;
+    ops.push_back(num_levels);
+    AddNumValuesOp(0, feature.value_count(), &ops);
+  } else if (feature.has_value_counts()) {
+    Op num_levels(Op::kNumLevels);
+    num_levels.level = feature.value_counts().value_count_size();
+    ops.push_back(num_levels);
+    for (int i = 0; i < feature.value_counts().value_count_size(); ++i) {
+      AddNumValuesOp(i, feature.value_counts().value_count(i), &ops);
+    }
+  }
+
+  if (feature.has_presence()) {
+    if (feature.presence().has_min_count()) {
+      Op min_count(Op::kMinCount);
+      min_count.threshold = feature.presence().min_count();
+      ops.push_back(min_count);
+    }
+    if (feature.presence().has_min_fraction()) {
+      Op min_fraction(Op::kMinFraction);
+      min_fraction.threshold = feature.presence().min_fraction();
+      ops.push_back(min_fraction);
+      if (feature.presence().min_fraction() == 1.0) {
+        ops.push_back(Op(Op::kNoMissing));
+      }
+    }
+  }
+
+  switch (feature.domain_info_case()) {
+    case Feature::kIntDomain:
+      if (feature.int_domain().has_min() || feature.int_domain().has_max()) {
+        Op int_range(Op::kIntRange);
+        int_range.has_min = feature.int_domain().has_min();
+        int_range.has_max = feature.int_domain().has_max();
+        int_range.int_min = feature.int_domain().min();
+        int_range.int_max = feature.int_domain().max();
+        ops.push_back(int_range);
+      }
+      break;
+    case Feature::kFloatDomain: {
+      const auto& float_domain = feature.float_domain();
+      if (float_domain.disallow_nan()) {
+        ops.push_back(Op(Op::kNoNan));
+      }
+      if (float_domain.has_min() || float_domain.has_max() ||
+          float_domain.disallow_inf()) {
+        Op float_range(Op::kFloatRange);
+        float_range.has_min = float_domain.has_min();
+        float_range.has_max = float_domain.has_max();
+        float_range.float_min = float_domain.min();
+        float_range.float_max = float_domain.max();
+        float_range.disallow_inf = float_domain.disallow_inf();
+        ops.push_back(float_range);
+      }
+      break;
+    }
+    default:
+      // As in Schema::UpdateFeature(), a domain_info custom stat can only
+      // update a feature without domain.
+      ops.push_back(Op(Op::kNoCustomDomain));
+      break;
+  }
+
+  if (feature.has_drift_comparator() || feature.has_skew_comparator()) {
+    ops.push_back(Op(Op::kNoComparators));
+  }
+  return std::move(program);
+}
+
+bool FeatureCheckProgram::Passes(const FeatureStatsView& view,
+                                 bool skip_comparators) const {
+  // Set by kNumLevels, which comes before the kNumValues ops.
+  std::vector<std::pair<int, int>> min_max_num_values;
+  for (const Op& op : ops_) {
+    switch (op.kind) {
+      case Op::kPresent:
+        if (view.GetNumPresent() == 0) {
+          return false;
+        }
+        break;
+      case Op::kType:
+        if (view.GetFeatureType() != op.type) {
+          return false;
+        }
+        break;
+      case Op::kMinCount:
+        if (view.GetNumPresent() < op.threshold) {
+          return false;
+        }
+        break;
+      case Op::kMinFraction: {
+        const absl::optional<double> fraction_present =
+            view.GetFractionPresent();
+        if (fraction_present && *fraction_present < op.threshold) {
+          return false;
+        }
+        break;
+      }
+      case Op::kNoMissing:
+        if (view.GetNumMissing() != 0.0) {
+          return false;
+        }
+        break;
+      case Op::kNumLevels:
+        min_max_num_values = view.GetMinMaxNumValues();
+        if (static_cast<int>(min_max_num_values.size()) != op.level) {
+          return false;
+        }
+        break;
+      case Op::kNumValues: {
+        const std::pair<int, int>& min_max = min_max_num_values[op.level];
+        if ((op.has_min && min_max.first < op.int_min) ||
+            (op.has_max && min_max.second > op.int_max)) {
+          return false;
+        }
+        break;
+      }
+      case Op::kIntRange:
+        if (!IntRangePasses(op, view)) {
+          return false;
+        }
+        break;
+      case Op::kFloatRange:
+        if (!FloatRangePasses(op, view)) {
+          return false;
+        }
+        break;
+      case Op::kNoNan:
+        if (!NoNanPasses(view)) {
+          return false;
+        }
+        break;
+      case Op::kNoCustomDomain:
+        if (view.GetCustomStatCount(kDomainInfo) != 0) {
+          return false;
+        }
+        break;
+      case Op::kNoComparators:
+        if (!skip_comparators) {
+          return false;
+        }
+        break;
+    }
+  }
+  return true;
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -0,0 +1,113 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_FEATURE_CHECK_PROGRAM_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_FEATURE_CHECK_PROGRAM_H_
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// The checks that Schema::UpdateFeature() makes for a feature, compiled once
+// per schema into a flat list of ops with their parameters extracted from the
+// feature. Running the program over the statistics of a feature tells whether
+// they certainly pass all the checks, without reading the schema and without
+// copying it into an overlay, which is only needed when an anomaly fires.
+//
+// The program is conservative: if it does not pass, Schema::UpdateFeature()
+// must still be called to find the anomalies, if any. Only the common
+// constraints are compiled (presence, value counts, type, int and float
+// domains, comparators); Compile() returns null for the other features.
+//
+// A program does not check whether the feature is in the environment of the
+// statistics, which IndexedSchema knows (see
+// IndexedSchema::FeatureChecksPass()).
+class FeatureCheckProgram {
+ public:
+  // A check of the statistics, with its parameters.
+  struct Op {
+    enum Kind {
+      // The feature is present in some example.
+      kPresent,
+      // The statistics have the type.
+      kType,
+      // The feature is present in at least threshold examples.
+      kMinCount,
+      // The feature is present in at least a fraction threshold of the
+      // examples.
+      kMinFraction,
+      // The feature is not missing in any example.
+      kNoMissing,
+      // The values are nested in exactly level levels.
+      kNumLevels,
+      // The numbers of values at the level are within the int bounds.
+      kNumValues,
+      // The ints are within the int bounds.
+      kIntRange,
+      // The floats are within the float bounds, and are not infinite if
+      // disallow_inf.
+      kFloatRange,
+      // The floats are not NaN.
+      kNoNan,
+      // The statistics have no domain_info custom stat.
+      kNoCustomDomain,
+      // The comparators are skipped.
+      kNoComparators,
+    };
+
+    explicit Op(Kind kind) : kind(kind) {}
+
+    Kind kind;
+    tensorflow::metadata::v0::FeatureType type =
+        tensorflow::metadata::v0::TYPE_UNKNOWN;
+    int level = 0;
+    double threshold = 0.0;
+    bool has_min = false;
+    bool has_max = false;
+    int64 int_min = 0;
+    int64 int_max = 0;
+    double float_min = 0.0;
+    double float_max = 0.0;
+    bool disallow_inf = false;
+  };
+
+  // Compiles the checks of the feature, or returns null if some of its
+  // constraints are not compiled.
+  static std::unique_ptr<const FeatureCheckProgram> Compile(
+      const tensorflow::metadata::v0::Feature& feature);
+
+  // Returns true if the statistics pass all the checks, so that
+  // Schema::UpdateFeature() would return no description and no drift or skew
+  // measurement for them (within the environment of the feature).
+  bool Passes(const FeatureStatsView& view, bool skip_comparators) const;
+
+  const std::vector<Op>& ops() const { return ops_; }
+
+ private:
+  FeatureCheckProgram() = default;
+
+  std::vector<Op> ops_;
+};
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_FEATURE_CHECK_PROGRAM_H_
@@ -0,0 +1,241 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/feature_check_program.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow_data_validation/anomalies/schema.h"
+#include "tensorflow_data_validation/anomalies/statistics_view_test_util.h"
+#include "tensorflow_data_validation/anomalies/test_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/anomalies.pb.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+#include "tensorflow_metadata/proto/v0/statistics.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::Feature;
+using ::tensorflow::metadata::v0::FeatureNameStatistics;
+using testing::DatasetForTesting;
+using testing::ParseTextProtoOrDie;
+
+TEST(FeatureCheckProgramTest, CompileUnsupported) {
+  for (const string& feature : {
+           "name: 'f' type: INT shape { dim { size: 1 } }",
+           "name: 'f' type: INT unique_constraints { min: 1 max: 2 }",
+           "name: 'f' type: BYTES string_domain { value: 'a' }",
+           "name: 'f' type: BYTES domain: 'd'",
+           "name: 'f' type: BYTES int_domain { min: 1 }",
+           "name: 'f' type: INT deprecated: true",
+           "name: 'f' type: INT presence { min_fraction: 2.0 }",
+           "name: 'f' type: INT value_count { min: 2 max: 1 }",
+           "name: 'f'",
+       }) {
+    EXPECT_EQ(
+        FeatureCheckProgram::Compile(ParseTextProtoOrDie<Feature>(feature)),
+        nullptr)
+        << feature;
+  }
+}
+
+TEST(FeatureCheckProgramTest, Compile) {
+  const std::unique_ptr<const FeatureCheckProgram> program =
+      FeatureCheckProgram::Compile(ParseTextProtoOrDie<Feature>(R"(
+        name: 'f'
+        type: INT
+        presence { min_count: 1 min_fraction: 1.0 }
+        value_count { min: 1 max: 1 }
+        int_domain { min: 0 max: 10 }
+        drift_comparator { infinity_norm { threshold: 0.1 } })"));
+  ASSERT_NE(program, nullptr);
+  std::vector<FeatureCheckProgram::Op::Kind> kinds;
+  for (const FeatureCheckProgram::Op& op : program->ops()) {
+    kinds.push_back(op.kind);
+  }
+  EXPECT_EQ(kinds, std::vector<FeatureCheckProgram::Op::Kind>(
+                       {FeatureCheckProgram::Op::kPresent,
+                        FeatureCheckProgram::Op::kType,
+                        FeatureCheckProgram::Op::kNumLevels,
+                        FeatureCheckProgram::Op::kNumValues,
+                        FeatureCheckProgram::Op::kMinCount,
+                        FeatureCheckProgram::Op::kMinFraction,
+                        FeatureCheckProgram::Op::kNoMissing,
+                        FeatureCheckProgram::Op::kIntRange,
+                        FeatureCheckProgram::Op::kNoComparators}));
+}
+
+struct PassesTest {
+  const string name;
+  const string feature;
+  const string stats;
+  const bool passes;
+};
+
+std::vector<PassesTest> GetPassesTests() {
+  const string int_stats = R"(
+      name: 'f'
+      type: INT
+      num_stats {
+        common_stats {
+          num_non_missing: 10
+          num_missing: 0
+          min_num_values: 1
+          max_num_values: 1
+        }
+        min: 2
+        max: 8
+      })";
+  const string float_stats = R"(
+      name: 'f'
+      type: FLOAT
+      num_stats {
+        common_stats {
+          num_non_missing: 10
+          num_missing: 2
+          min_num_values: 1
+          max_num_values: 3
+        }
+        min: 0.5
+        max: 1.5
+        histograms { num_nan: 1 }
+      })";
+  return {
+      {"int_in_range",
+       "name: 'f' type: INT presence { min_count: 1 min_fraction: 1.0 } "
+       "value_count { min: 1 max: 1 } int_domain { min: 0 max: 10 }",
+       int_stats, true},
+      {"int_too_small", "name: 'f' type: INT int_domain { min: 3 }",
+       int_stats, false},
+      {"int_too_big", "name: 'f' type: INT int_domain { max: 7 }", int_stats,
+       false},
+      {"too_few_present", "name: 'f' type: INT presence { min_count: 11 }",
+       int_stats, false},
+      {"too_many_values", "name: 'f' type: FLOAT value_count { max: 2 }",
+       float_stats, false},
+      {"nested_values", "name: 'f' type: INT value_counts { value_count {} "
+       "value_count {} }", int_stats, false},
+      {"missing", "name: 'f' type: FLOAT presence { min_fraction: 1.0 }",
+       float_stats, false},
+      {"wrong_type", "name: 'f' type: FLOAT", int_stats, false},
+      {"float_in_range",
+       "name: 'f' type: FLOAT presence { min_fraction: 0.5 } "
+       "float_domain { min: 0.0 max: 2.0 disallow_inf: true }",
+       float_stats, true},
+      {"float_too_small", "name: 'f' type: FLOAT float_domain { min: 1.0 }",
+       float_stats, false},
+      {"float_nan", "name: 'f' type: FLOAT float_domain { disallow_nan: true }",
+       float_stats, false},
+      {"comparator",
+       "name: 'f' type: INT skew_comparator { infinity_norm { threshold: 0.1 "
+       "} }",
+       int_stats, false},
+      {"custom_domain", "name: 'f' type: INT",
+       int_stats + " custom_stats { name: 'domain_info' str: 'mid_domain {}' }",
+       false},
+  };
+}
+
+TEST(FeatureCheckProgramTest, Passes) {
+  for (const PassesTest& test : GetPassesTests()) {
+    const Feature feature = ParseTextProtoOrDie<Feature>(test.feature);
+    const std::unique_ptr<const FeatureCheckProgram> program =
+        FeatureCheckProgram::Compile(feature);
+    ASSERT_NE(program, nullptr) << test.name;
+    const DatasetForTesting dataset(
+        ParseTextProtoOrDie<FeatureNameStatistics>(test.stats));
+    EXPECT_EQ(program->Passes(dataset.feature_stats_view(),
+                              /*skip_comparators=*/false),
+              test.passes)
+        << test.name;
+
+    // A program that passes agrees with Schema::UpdateFeature().
+    if (test.passes) {
+      tensorflow::metadata::v0::Schema schema_proto;
+      *schema_proto.add_feature() = feature;
+      Schema schema;
+      TF_ASSERT_OK(schema.Init(schema_proto));
+      std::vector<Description> descriptions;
+      absl::optional<tensorflow::metadata::v0::DriftSkewInfo> drift_skew_info;
+      tensorflow::metadata::v0::AnomalyInfo::Severity severity;
+      TF_ASSERT_OK(schema.UpdateFeature(
+          Schema::Updater(FeatureStatisticsToProtoConfig()),
+          dataset.feature_stats_view(), &descriptions, &drift_skew_info,
+          &severity));
+      EXPECT_TRUE(descriptions.empty()) << test.name;
+      EXPECT_FALSE(drift_skew_info) << test.name;
+    }
+  }
+}
+
+TEST(FeatureCheckProgramTest, PassesWithSkippedComparators) {
+  const std::unique_ptr<const FeatureCheckProgram> program =
+      FeatureCheckProgram::Compile(ParseTextProtoOrDie<Feature>(
+          "name: 'f' type: INT "
+          "drift_comparator { infinity_norm { threshold: 0.1 } }"));
+  ASSERT_NE(program, nullptr);
+  const DatasetForTesting dataset(ParseTextProtoOrDie<FeatureNameStatistics>(
+      "name: 'f' type: INT num_stats { common_stats { num_non_missing: 1 "
+      "min_num_values: 1 max_num_values: 1 } }"));
+  EXPECT_FALSE(program->Passes(dataset.feature_stats_view(),
+                               /*skip_comparators=*/false));
+  EXPECT_TRUE(program->Passes(dataset.feature_stats_view(),
+                              /*skip_comparators=*/true));
+}
+
+TEST(FeatureCheckProgramTest, IndexedSchemaFeatureChecksPass) {
+  const IndexedSchema schema(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"(
+        feature { name: 'f' type: INT not_in_environment: 'SERVING' }
+        feature { name: 'g' type: INT }
+        sparse_feature { name: 'g' }
+      )"));
+  const tensorflow::metadata::v0::DatasetFeatureStatistics stats =
+      ParseTextProtoOrDie<tensorflow::metadata::v0::DatasetFeatureStatistics>(
+          R"(
+            num_examples: 1
+            features {
+              name: 'f'
+              type: INT
+              num_stats { common_stats { num_non_missing: 1 } }
+            }
+            features {
+              name: 'g'
+              type: INT
+              num_stats { common_stats { num_non_missing: 1 } }
+            })");
+  const DatasetStatsView view(stats);
+  EXPECT_TRUE(schema.FeatureChecksPass(*view.GetByPath(Path({"f"})),
+                                       /*skip_comparators=*/false));
+  // The sparse feature is checked instead.
+  EXPECT_FALSE(schema.FeatureChecksPass(*view.GetByPath(Path({"g"})),
+                                        /*skip_comparators=*/false));
+
+  // The feature is added to the environment.
+  const DatasetStatsView serving_view(stats, /*by_weight=*/false, "SERVING",
+                                      nullptr, nullptr, nullptr);
+  EXPECT_FALSE(schema.FeatureChecksPass(*serving_view.GetByPath(Path({"f"})),
+                                        /*skip_comparators=*/false));
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -15,16 +15,41 @@ limitations under the License.
 
 #include "tensorflow_data_validation/anomalies/feature_statistics_validator.h"
 
+#include <algorithm>
+#include <limits>
+#include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <vector>
 
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "tensorflow_data_validation/anomalies/feature_util.h"
+#include "tensorflow_data_validation/anomalies/internal_types.h"
+#include "tensorflow_data_validation/anomalies/metrics.h"
+#include "tensorflow_data_validation/anomalies/monotonic_arena.h"
+#include "tensorflow_data_validation/anomalies/path.h"
+#include "tensorflow_data_validation/anomalies/proto/validation_metadata.pb.h"
 #include "tensorflow_data_validation/anomalies/schema.h"
+#include "tensorflow_data_validation/anomalies/rolling_drift_state.h"
 #include "tensorflow_data_validation/anomalies/schema_anomalies.h"
+#include "tensorflow_data_validation/anomalies/schema_snapshot.h"
+#include "tensorflow_data_validation/anomalies/serialized_output.h"
+#include "tensorflow_data_validation/anomalies/statistics_merger.h"
 #include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow_data_validation/anomalies/statistics_view_cache.h"
+#include "tensorflow_data_validation/anomalies/validation_deadline.h"
+#include "tensorflow_data_validation/anomalies/validation_profile.h"
+#include "tensorflow_data_validation/anomalies/validation_result_cache.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_metadata/proto/v0/schema.pb.h"
 
@@ -35,8 +60,584 @@ namespace data_validation {
 
 namespace {
 const int64 kDefaultEnumThreshold = 400;
+
+// Parses a serialized proto directly from the memory viewed by serialized.
+bool ParseFromStringView(absl::string_view serialized,
+                         tensorflow::protobuf::MessageLite* proto) {
+  return proto->ParseFromArray(serialized.data(), serialized.size());
+}
+
+// Maps the file at path in memory, and views its contents in *contents, which
+// remain valid as long as *region. An empty path means an absent input, and is
+// viewed as an empty string (as are empty files, which cannot be mapped).
+tensorflow::Status MapFile(const string& path,
+                           std::unique_ptr<ReadOnlyMemoryRegion>* region,
+                           absl::string_view* contents) {
+  *contents = absl::string_view();
+  if (path.empty()) {
+    return tensorflow::Status::OK();
+  }
+  Env* env = Env::Default();
+  uint64 size;
+  TF_RETURN_IF_ERROR(env->GetFileSize(path, &size));
+  if (size == 0) {
+    return tensorflow::Status::OK();
+  }
+  // Protos larger than 2GB cannot be parsed.
+  if (size > static_cast<uint64>(std::numeric_limits<int>::max())) {
+    return tensorflow::errors::InvalidArgument(
+        path, " is too large to be parsed as a proto.");
+  }
+  TF_RETURN_IF_ERROR(env->NewReadOnlyMemoryRegionFromFile(path, region));
+  *contents = absl::string_view(static_cast<const char*>((*region)->data()),
+                                (*region)->length());
+  return tensorflow::Status::OK();
+}
+
+// Gets the FeatureStatisticsToProtoConfig used to validate statistics with
+// validation_config.
+FeatureStatisticsToProtoConfig GetFeatureStatisticsToProtoConfig(
+    const ValidationConfig& validation_config) {
+  FeatureStatisticsToProtoConfig feature_statistics_to_proto_config;
+  feature_statistics_to_proto_config.set_enum_threshold(kDefaultEnumThreshold);
+  feature_statistics_to_proto_config.set_new_features_are_warnings(
+      validation_config.new_features_are_warnings());
+  feature_statistics_to_proto_config.set_only_validate_features_needed(
+      validation_config.only_validate_features_needed());
+  feature_statistics_to_proto_config.set_approximate_infinity_norm(
+      validation_config.approximate_infinity_norm());
+  feature_statistics_to_proto_config.set_numeric_infinity_norm(
+      validation_config.numeric_infinity_norm());
+  feature_statistics_to_proto_config.set_fail_fast(
+      validation_config.fail_fast());
+  *feature_statistics_to_proto_config.mutable_severity_overrides() =
+      validation_config.severity_overrides();
+  return feature_statistics_to_proto_config;
+}
+
+// Parses a serialized FeaturesNeededProto. If features_needed_string is empty
+// or has no features, sets *result to nullopt.
+tensorflow::Status ParseFeaturesNeeded(
+    absl::string_view features_needed_string,
+    absl::optional<FeaturesNeeded>* result) {
+  *result = absl::nullopt;
+  if (!features_needed_string.empty()) {
+    FeaturesNeededProto parsed_proto;
+    if (!ParseFromStringView(features_needed_string, &parsed_proto)) {
+      return tensorflow::errors::InvalidArgument(
+          "Failed to parse FeaturesNeeded");
+    }
+
+    FeaturesNeeded parsed_feature_needed;
+    TF_RETURN_IF_ERROR(
+        FromFeaturesNeededProto(parsed_proto, &parsed_feature_needed));
+    if (!parsed_feature_needed.empty()) {
+      *result = std::move(parsed_feature_needed);
+    }
+  }
+  return tensorflow::Status::OK();
+}
+
+// Returns a shared_ptr that points to statistics without owning it. The caller
+// must ensure statistics outlives all the copies of the result.
+std::shared_ptr<const DatasetFeatureStatistics> Unowned(
+    const DatasetFeatureStatistics& statistics) {
+  return std::shared_ptr<const DatasetFeatureStatistics>(
+      std::shared_ptr<const DatasetFeatureStatistics>(), &statistics);
+}
+
+// A SerializedOutput that forwards to another one, and remembers what was
+// written to it.
+class RecordingOutput : public SerializedOutput {
+ public:
+  explicit RecordingOutput(SerializedOutput* output) : output_(output) {}
+
+  char* Allocate(size_t size) override {
+    data_ = output_->Allocate(size);
+    size_ = data_ != nullptr ? size : 0;
+    return data_;
+  }
+
+  // The serialized proto, once it is written.
+  absl::string_view written() const { return absl::string_view(data_, size_); }
+
+ private:
+  SerializedOutput* const output_;
+  char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// Some statistics, either parsed, lazily parsed, or (for control statistics)
+// serialized with their view in a cache. At most one of parsed, lazy and
+// view_cache is set, and the statistics are absent if none is.
+struct StatisticsSource {
+  const DatasetFeatureStatistics* parsed = nullptr;
+  std::shared_ptr<const LazyDatasetFeatureStatistics> lazy;
+  // If not null, the view of serialized is taken from view_cache (see
+  // StatisticsViewCache::GetControlView()).
+  StatisticsViewCache* view_cache = nullptr;
+  absl::string_view serialized;
+
+  bool present() const {
+    return parsed != nullptr || lazy != nullptr || view_cache != nullptr;
+  }
+
+  // All the fields of the statistics, except (possibly) features. The
+  // statistics must be parsed or lazily parsed.
+  const DatasetFeatureStatistics& header() const {
+    return lazy ? lazy->header() : *parsed;
+  }
+
+  // Creates a view of the statistics, that does not copy them. The statistics
+  // must be present.
+  DatasetStatsView View(bool by_weight,
+                        const absl::optional<string>& environment,
+                        std::shared_ptr<DatasetStatsView> previous_span,
+                        std::shared_ptr<DatasetStatsView> serving,
+                        std::shared_ptr<DatasetStatsView> previous_version)
+      const {
+    if (lazy) {
+      return DatasetStatsView(lazy, by_weight, environment,
+                              std::move(previous_span), std::move(serving),
+                              std::move(previous_version));
+    }
+    return DatasetStatsView(Unowned(*parsed), by_weight, environment,
+                            std::move(previous_span), std::move(serving),
+                            std::move(previous_version));
+  }
+};
+
+// Returns the source of some control statistics given to Validator::Validate,
+// or an absent source if the statistics are absent or not used by the schema.
+StatisticsSource GetControlStatistics(
+    const absl::optional<DatasetFeatureStatistics>& statistics, bool used) {
+  StatisticsSource result;
+  if (used && statistics) {
+    result.parsed = &statistics.value();
+  }
+  return result;
+}
+
+// Like GetControlStatistics(), but for serialized statistics. As only the
+// features with comparators are read from control statistics, they are
+// parsed lazily.
+tensorflow::Status ParseControlStatistics(absl::string_view proto_string,
+                                          bool used,
+                                          StatisticsSource* result) {
+  *result = StatisticsSource();
+  if (used && !proto_string.empty()) {
+    return LazyDatasetFeatureStatistics::Create(proto_string, &result->lazy);
+  }
+  return tensorflow::Status::OK();
+}
+
+// Like ParseControlStatistics(), but the view of the statistics is taken from
+// view_cache once their by_weight is known (see MakeControlView()).
+void GetCachedControlStatistics(absl::string_view proto_string, bool used,
+                                StatisticsViewCache* view_cache,
+                                StatisticsSource* result) {
+  *result = StatisticsSource();
+  if (used && !proto_string.empty()) {
+    result->view_cache = view_cache;
+    result->serialized = proto_string;
+  }
+}
+
+// Parses the serialized statistics of a validation against schema. If lazy is
+// true, only the features that are accessed are parsed from
+// feature_statistics_proto_string. Otherwise, it is parsed on arena. Control
+// statistics that the schema does not use are not even parsed. If view_cache
+// is not null, all the statistics are taken from it instead (and lazily
+// parsed).
+tensorflow::Status ParseSerializedStatistics(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    const IndexedSchema& schema, bool lazy, protobuf::Arena* arena,
+    StatisticsViewCache* view_cache, StatisticsSource* feature_statistics,
+    StatisticsSource* previous_span_statistics,
+    StatisticsSource* serving_statistics,
+    StatisticsSource* previous_version_statistics) {
+  *feature_statistics = StatisticsSource();
+  if (view_cache != nullptr) {
+    TF_RETURN_IF_ERROR(view_cache->GetStatistics(
+        feature_statistics_proto_string, &feature_statistics->lazy));
+    GetCachedControlStatistics(previous_span_statistics_proto_string,
+                               schema.UsesPreviousSpan(), view_cache,
+                               previous_span_statistics);
+    GetCachedControlStatistics(serving_statistics_proto_string,
+                               schema.UsesServing(), view_cache,
+                               serving_statistics);
+    GetCachedControlStatistics(previous_version_statistics_proto_string,
+                               schema.UsesPreviousVersion(), view_cache,
+                               previous_version_statistics);
+    return tensorflow::Status::OK();
+  }
+  if (lazy) {
+    TF_RETURN_IF_ERROR(LazyDatasetFeatureStatistics::Create(
+        feature_statistics_proto_string, &feature_statistics->lazy));
+  } else {
+    DatasetFeatureStatistics* parsed =
+        protobuf::Arena::CreateMessage<DatasetFeatureStatistics>(arena);
+    if (!ParseFromStringView(feature_statistics_proto_string, parsed)) {
+      return tensorflow::errors::InvalidArgument(
+          "Failed to parse DatasetFeatureStatistics proto.");
+    }
+    feature_statistics->parsed = parsed;
+  }
+  TF_RETURN_IF_ERROR(ParseControlStatistics(
+      previous_span_statistics_proto_string, schema.UsesPreviousSpan(),
+      previous_span_statistics));
+  TF_RETURN_IF_ERROR(ParseControlStatistics(serving_statistics_proto_string,
+                                            schema.UsesServing(),
+                                            serving_statistics));
+  return ParseControlStatistics(previous_version_statistics_proto_string,
+                                schema.UsesPreviousVersion(),
+                                previous_version_statistics);
+}
+
+// Creates a view of some control statistics, or sets *result to nullptr if
+// statistics is absent. The view does not copy statistics, unless they are
+// serialized (and then copied once into their cache).
+tensorflow::Status MakeControlView(const StatisticsSource& statistics,
+                                   bool by_weight,
+                                   const absl::optional<string>& environment,
+                                   std::shared_ptr<DatasetStatsView>* result) {
+  *result = nullptr;
+  if (statistics.view_cache != nullptr) {
+    return statistics.view_cache->GetControlView(
+        statistics.serialized, by_weight, environment, result);
+  }
+  if (statistics.present()) {
+    *result = std::make_shared<DatasetStatsView>(
+        statistics.View(by_weight, environment, /* previous_span= */ nullptr,
+                        /* serving= */ nullptr,
+                        /* previous_version= */ nullptr));
+  }
+  return tensorflow::Status::OK();
+}
+
+// An estimate of the memory used by statistics once parsed, in bytes. The
+// views of statistics in a StatisticsViewCache outlive the validation, and
+// are not counted.
+int64 GetParsedBytes(const StatisticsSource& statistics) {
+  if (statistics.lazy != nullptr) {
+    return statistics.lazy->GetMemoryUsage();
+  }
+  if (statistics.parsed != nullptr) {
+    return statistics.parsed->SpaceUsedLong();
+  }
+  return 0;
+}
+
+// Creates the memory account of a validation, or returns absl::nullopt if the
+// memory is neither profiled nor budgeted.
+absl::optional<ValidationMemoryAccount> MakeMemoryAccount(
+    const ValidationProfile* profile, int64 memory_budget_bytes) {
+  if (profile == nullptr && memory_budget_bytes <= 0) {
+    return absl::nullopt;
+  }
+  return absl::make_optional<ValidationMemoryAccount>(memory_budget_bytes);
+}
+
+// Returns true if the (present) statistics are to be validated by weight.
+bool UseWeightedStatistics(const StatisticsSource& feature_statistics) {
+  // Checking weighted_num_examples first avoids indexing the features when
+  // there cannot be weighted statistics.
+  return feature_statistics.header().weighted_num_examples() != 0.0 &&
+         feature_statistics
+             .View(/*by_weight=*/false, /*environment=*/absl::nullopt,
+                   /* previous_span= */ nullptr,
+                   /* serving= */ nullptr,
+                   /* previous_version= */ nullptr)
+             .WeightedStatisticsExist();
+}
+
+// Adds the anomalies and the comparator evaluations of anomalies to the
+// counts of profile.
+void AddResultCounts(const tensorflow::metadata::v0::Anomalies& anomalies,
+                     ValidationProfile* profile) {
+  int64 num_comparator_evaluations = 0;
+  for (const auto& drift_skew_info : anomalies.drift_skew_info()) {
+    num_comparator_evaluations += drift_skew_info.drift_measurements_size() +
+                                  drift_skew_info.skew_measurements_size();
+  }
+  profile->set_num_anomalies(profile->num_anomalies() +
+                             anomalies.anomaly_info_size() +
+                             (anomalies.has_dataset_anomaly_info() ? 1 : 0));
+  profile->set_num_comparator_evaluations(
+      profile->num_comparator_evaluations() + num_comparator_evaluations);
+}
+
+// Implements ValidateFeatureStatistics(...) once the schema has been indexed
+// and the updater has been created, so that these can be shared by many
+// validations. feature_statistics must be present. If by_weight is set, the
+// statistics are viewed by weight or not as it says, instead of by weight iff
+// they have weighted statistics. None of the statistics are copied, so they
+// may live on an arena. If sink is not null, the anomalies are
+// passed to it. Otherwise, if delta is not null, they are written to delta.
+// Otherwise, they are written to result. If profile is not null, the stages
+// and the counts of the validation are added to it (the anomalies passed to a
+// sink are not counted), along with the num_slowest_features most expensive
+// checks of single features. If max_anomalies is greater than 0, only that
+// many feature anomalies are kept (see ValidationConfig.max_anomalies). If
+// deadline is not null, the features not checked before it expires are
+// reported instead (see ValidationConfig.deadline_micros). If memory is not
+// null, the memory of the validation is accounted for in it, and the result is
+// degraded (or an error is returned) if it is over its budget.
+tensorflow::Status ValidateFeatureStatisticsWithIndexedSchema(
+    const StatisticsSource& feature_statistics,
+    const std::shared_ptr<const IndexedSchema>& schema,
+    const absl::optional<string>& environment,
+    const absl::optional<bool>& by_weight,
+    const StatisticsSource& prev_span_feature_statistics,
+    const StatisticsSource& serving_feature_statistics,
+    const StatisticsSource& prev_version_feature_statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    const Schema::Updater& updater, int num_threads, bool enable_diff_regions,
+    FeatureValidationCache* cache, AnomaliesSink* sink, AnomaliesDelta* delta,
+    tensorflow::metadata::v0::Anomalies* result, ValidationProfile* profile,
+    int num_slowest_features, int max_anomalies,
+    const ValidationDeadline* deadline, ValidationMemoryAccount* memory) {
+  const auto account_for_inputs = [&]() {
+    memory->set_input_bytes(GetParsedBytes(feature_statistics) +
+                            GetParsedBytes(prev_span_feature_statistics) +
+                            GetParsedBytes(serving_feature_statistics) +
+                            GetParsedBytes(prev_version_feature_statistics));
+  };
+  if (memory != nullptr) {
+    account_for_inputs();
+    TF_RETURN_IF_ERROR(memory->CheckBudget("parse"));
+  }
+  if (feature_statistics.header().num_examples() == 0) {
+    if (sink != nullptr) {
+      return sink->OnDataMissing();
+    }
+    if (delta != nullptr) {
+      delta->set_baseline_fingerprint(schema->fingerprint());
+      delta->mutable_anomalies()->set_data_missing(true);
+      return tensorflow::Status::OK();
+    }
+    *result->mutable_baseline() = schema->schema();
+    result->set_data_missing(true);
+  } else {
+    // The many small objects of the traversal are freed at once at the end of
+    // the call.
+    MonotonicArena arena;
+    SchemaAnomalies schema_anomalies(schema, &arena);
+    schema_anomalies.set_profile(profile);
+    schema_anomalies.set_max_anomalies(max_anomalies);
+    schema_anomalies.set_deadline(deadline);
+    absl::optional<FeatureCostTracker> feature_cost_tracker;
+    if (profile != nullptr && num_slowest_features > 0) {
+      feature_cost_tracker.emplace(num_slowest_features);
+      schema_anomalies.set_feature_cost_tracker(&*feature_cost_tracker);
+    }
+    absl::optional<DatasetStatsView> training;
+    {
+      const ScopedValidationStage stage("build_views", profile);
+      const bool view_by_weight =
+          by_weight ? *by_weight : UseWeightedStatistics(feature_statistics);
+      std::shared_ptr<DatasetStatsView> previous_span;
+      std::shared_ptr<DatasetStatsView> serving;
+      std::shared_ptr<DatasetStatsView> previous_version;
+      TF_RETURN_IF_ERROR(MakeControlView(prev_span_feature_statistics,
+                                         view_by_weight, environment,
+                                         &previous_span));
+      TF_RETURN_IF_ERROR(MakeControlView(serving_feature_statistics,
+                                         view_by_weight, environment,
+                                         &serving));
+      TF_RETURN_IF_ERROR(MakeControlView(prev_version_feature_statistics,
+                                         view_by_weight, environment,
+                                         &previous_version));
+      training.emplace(feature_statistics.View(
+          view_by_weight, environment, std::move(previous_span),
+          std::move(serving), std::move(previous_version)));
+    }
+    if (memory != nullptr) {
+      memory->set_view_bytes(training->GetMemoryUsage());
+      TF_RETURN_IF_ERROR(memory->CheckBudget("build_views"));
+    }
+    TF_RETURN_IF_ERROR(schema_anomalies.FindChanges(
+        *training, features_needed, updater, num_threads, enable_diff_regions,
+        cache, sink));
+    // A feature that failed to parse was checked without its histograms.
+    TF_RETURN_IF_ERROR(training->GetParseStatus());
+    if (feature_cost_tracker) {
+      feature_cost_tracker->AddTo(profile);
+    }
+    if (memory != nullptr) {
+      // Features may have been parsed, and cached in the views, since.
+      account_for_inputs();
+      memory->set_view_bytes(training->GetMemoryUsage());
+      memory->set_anomaly_bytes(schema_anomalies.GetMemoryUsage());
+      TF_RETURN_IF_ERROR(memory->CheckBudget("find_changes"));
+    }
+    if (sink != nullptr) {
+      return tensorflow::Status::OK();
+    }
+    if (delta != nullptr) {
+      const ScopedValidationStage stage("get_anomalies_delta", profile);
+      *delta = schema_anomalies.GetAnomaliesDelta(enable_diff_regions);
+      if (profile != nullptr) {
+        *profile->mutable_num_dropped_anomalies() =
+            delta->num_dropped_anomalies();
+      }
+      if (memory != nullptr) {
+        memory->set_output_bytes(delta->SpaceUsedLong());
+        if (memory->OverBudget() && enable_diff_regions) {
+          *delta = schema_anomalies.GetAnomaliesDelta(
+              /*enable_diff_regions=*/false);
+          memory->set_diff_regions_dropped();
+          memory->set_output_bytes(delta->SpaceUsedLong());
+        }
+        if (memory->OverBudget()) {
+          delta->clear_schema_changes();
+          delta->clear_dataset_schema_changes();
+          delta->set_schema_changes_dropped(true);
+          memory->set_schema_changes_dropped();
+          memory->set_output_bytes(delta->SpaceUsedLong());
+        }
+        TF_RETURN_IF_ERROR(memory->CheckBudget("get_anomalies_delta"));
+      }
+    } else {
+      const ScopedValidationStage stage("get_schema_diff", profile);
+      schema_anomalies.GetSchemaDiff(enable_diff_regions, result);
+      if (profile != nullptr) {
+        const std::map<string, int64> num_dropped_anomalies =
+            schema_anomalies.GetNumDroppedAnomalies();
+        profile->mutable_num_dropped_anomalies()->insert(
+            num_dropped_anomalies.begin(), num_dropped_anomalies.end());
+      }
+      if (memory != nullptr) {
+        memory->set_output_bytes(result->SpaceUsedLong());
+        if (memory->OverBudget() && enable_diff_regions) {
+          schema_anomalies.GetSchemaDiff(/*enable_diff_regions=*/false,
+                                         result);
+          memory->set_diff_regions_dropped();
+          memory->set_output_bytes(result->SpaceUsedLong());
+        }
+        TF_RETURN_IF_ERROR(memory->CheckBudget("get_schema_diff"));
+      }
+    }
+  }
+  if (profile != nullptr) {
+    AddResultCounts(delta != nullptr ? delta->anomalies() : *result, profile);
+  }
+
+  return tensorflow::Status::OK();
+}
+
+// Implements Validator::ComputeDrift(...) once the schema has been indexed.
+// feature_statistics and all the previous spans must be present. None of the
+// statistics are copied.
+tensorflow::Status ComputeDriftWithIndexedSchema(
+    const StatisticsSource& feature_statistics, const IndexedSchema& schema,
+    const std::vector<StatisticsSource>& prev_span_feature_statistics,
+    bool approximate_infinity_norm, bool numeric_infinity_norm,
+    std::vector<tensorflow::metadata::v0::Anomalies>* results) {
+  const bool by_weight = UseWeightedStatistics(feature_statistics);
+  const DatasetStatsView current = feature_statistics.View(
+      by_weight, /*environment=*/absl::nullopt, /* previous_span= */ nullptr,
+      /* serving= */ nullptr, /* previous_version= */ nullptr);
+  std::vector<DatasetStatsView> previous_spans;
+  previous_spans.reserve(prev_span_feature_statistics.size());
+  for (const StatisticsSource& statistics : prev_span_feature_statistics) {
+    previous_spans.push_back(statistics.View(
+        by_weight, /*environment=*/absl::nullopt, /* previous_span= */ nullptr,
+        /* serving= */ nullptr, /* previous_version= */ nullptr));
+  }
+  results->assign(previous_spans.size(),
+                  tensorflow::metadata::v0::Anomalies());
+  for (const FeatureStatsView& feature_stats_view : current.features()) {
+    const Path path = feature_stats_view.GetPath();
+    const tensorflow::metadata::v0::Feature* feature = schema.GetFeature(path);
+    if (feature == nullptr || !feature->has_drift_comparator() ||
+        schema.FeatureIsDeprecated(path)) {
+      continue;
+    }
+    const FeatureDistribution distribution(feature_stats_view);
+    for (int i = 0; i < previous_spans.size(); ++i) {
+      const absl::optional<FeatureStatsView> control_stats =
+          previous_spans[i].GetByPath(path);
+      if (!control_stats) {
+        continue;
+      }
+      std::vector<tensorflow::metadata::v0::DriftSkewInfo::Measurement>
+          measurements = GetComparatorMeasurements(
+              distribution, FeatureDistribution(*control_stats),
+              FeatureComparatorType::DRIFT, approximate_infinity_norm,
+              numeric_infinity_norm, feature->drift_comparator());
+      if (measurements.empty()) {
+        continue;
+      }
+      tensorflow::metadata::v0::DriftSkewInfo* drift_skew_info =
+          (*results)[i].add_drift_skew_info();
+      *drift_skew_info->mutable_path() = path.AsProto();
+      for (auto& measurement : measurements) {
+        *drift_skew_info->add_drift_measurements() = std::move(measurement);
+      }
+    }
+  }
+  TF_RETURN_IF_ERROR(current.GetParseStatus());
+  for (const DatasetStatsView& previous_span : previous_spans) {
+    TF_RETURN_IF_ERROR(previous_span.GetParseStatus());
+  }
+  return tensorflow::Status::OK();
 }
 
+// The cache used by ValidateFeatureStatisticsWithSerializedInputs(...).
+struct ProcessValidationResultCache {
+  mutex mu;
+  std::shared_ptr<ValidationResultCache> cache TF_GUARDED_BY(mu);
+};
+
+ProcessValidationResultCache& GetProcessValidationResultCache() {
+  static ProcessValidationResultCache* result =
+      new ProcessValidationResultCache();
+  return *result;
+}
+
+// Returns the paths that an update of schema with statistics must consider,
+// if schema was last updated with previous_statistics: the features whose
+// statistics changed or that are not in schema, along with their ancestors
+// (as an update only visits the children of the features it considers), the
+// features that are only in previous_statistics, and the required features of
+// schema that are in neither (schema may have been edited since it was last
+// updated).
+std::vector<Path> GetChangedPaths(const DatasetStatsView& previous_statistics,
+                                  const DatasetStatsView& statistics,
+                                  Schema* schema) {
+  std::set<Path> changed_paths;
+  for (const FeatureStatsView& feature : statistics.features()) {
+    const Path& path = feature.GetPath();
+    const bool changed =
+        !schema->FeatureExists(path) || !previous_statistics.HasPath(path) ||
+        previous_statistics.GetByPath(path)->GetFingerprint() !=
+            feature.GetFingerprint();
+    if (!changed) {
+      continue;
+    }
+    // Once an ancestor is in changed_paths, so are all of its ancestors.
+    for (Path ancestor = path;
+         !ancestor.empty() && changed_paths.insert(ancestor).second;
+         ancestor = ancestor.GetParent()) {
+    }
+  }
+  for (const FeatureStatsView& feature : previous_statistics.features()) {
+    if (!statistics.HasPath(feature.GetPath())) {
+      changed_paths.insert(feature.GetPath());
+    }
+  }
+  for (const Path& path : schema->GetMissingPaths(statistics)) {
+    changed_paths.insert(path);
+  }
+  return std::vector<Path>(changed_paths.begin(), changed_paths.end());
+}
+
+}  // namespace
+
 FeatureStatisticsToProtoConfig GetDefaultFeatureStatisticsToProtoConfig() {
   FeatureStatisticsToProtoConfig feature_statistics_to_proto_config;
   feature_statistics_to_proto_config.set_enum_threshold(kDefaultEnumThreshold);
@@ -44,12 +645,31 @@ FeatureStatisticsToProtoConfig GetDefaultFeatureStatisticsToProtoConfig() {
 }
 
 
-tensorflow::Status InferSchema(const string& feature_statistics_proto_string,
-                               const int max_string_domain_size,
-                               const bool infer_feature_shape,
-                               string* schema_proto_string) {
+tensorflow::Status InferSchema(
+    absl::string_view feature_statistics_proto_string,
+    const int max_string_domain_size, const bool infer_feature_shape,
+    string* schema_proto_string) {
+  return InferSchema(feature_statistics_proto_string, max_string_domain_size,
+                     infer_feature_shape, /*num_threads=*/1,
+                     schema_proto_string);
+}
+
+tensorflow::Status InferSchema(
+    absl::string_view feature_statistics_proto_string,
+    const int max_string_domain_size, const bool infer_feature_shape,
+    const int num_threads, string* schema_proto_string) {
+  StringOutput output(schema_proto_string);
+  return InferSchema(feature_statistics_proto_string, max_string_domain_size,
+                     infer_feature_shape, num_threads, &output);
+}
+
+tensorflow::Status InferSchema(
+    absl::string_view feature_statistics_proto_string,
+    const int max_string_domain_size, const bool infer_feature_shape,
+    const int num_threads, SerializedOutput* schema_output) {
   tensorflow::metadata::v0::DatasetFeatureStatistics feature_statistics;
-  if (!feature_statistics.ParseFromString(feature_statistics_proto_string)) {
+  if (!ParseFromStringView(feature_statistics_proto_string,
+                           &feature_statistics)) {
     return tensorflow::errors::InvalidArgument(
         "Failed to parse DatasetFeatureStatistics proto.");
   }
@@ -57,45 +677,124 @@ tensorflow::Status InferSchema(const string& feature_statistics_proto_string,
   feature_statistics_to_proto_config.set_enum_threshold(max_string_domain_size);
   feature_statistics_to_proto_config.set_infer_feature_shape(
       infer_feature_shape);
+  feature_statistics_to_proto_config.set_num_threads(num_threads);
   tensorflow::metadata::v0::Schema schema;
   TF_RETURN_IF_ERROR(
       UpdateSchema(feature_statistics_to_proto_config,
                    schema, feature_statistics,
                    /* paths_to_consider= */ gtl::nullopt,
                    /* environment= */ gtl::nullopt, &schema));
-  if (!schema.SerializeToString(schema_proto_string)) {
-    return tensorflow::errors::Internal(
-        "Could not serialize Schema output proto to string.");
-  }
-  return tensorflow::Status::OK();
+  return SerializeToOutput(schema, "Schema", schema_output);
+}
+
+tensorflow::Status UpdateSchema(
+    absl::string_view schema_proto_string,
+    absl::string_view feature_statistics_proto_string,
+    const int max_string_domain_size, string* output_schema_proto_string) {
+  return UpdateSchema(schema_proto_string, feature_statistics_proto_string,
+                      max_string_domain_size, /*num_threads=*/1,
+                      output_schema_proto_string);
+}
+
+tensorflow::Status UpdateSchema(
+    absl::string_view schema_proto_string,
+    absl::string_view feature_statistics_proto_string,
+    const int max_string_domain_size, const int num_threads,
+    string* output_schema_proto_string) {
+  StringOutput output(output_schema_proto_string);
+  return UpdateSchema(schema_proto_string, feature_statistics_proto_string,
+                      max_string_domain_size, num_threads, &output);
 }
 
-tensorflow::Status UpdateSchema(const string& schema_proto_string,
-                                const string& feature_statistics_proto_string,
-                                const int max_string_domain_size,
-                                string* output_schema_proto_string) {
+tensorflow::Status UpdateSchema(
+    absl::string_view schema_proto_string,
+    absl::string_view feature_statistics_proto_string,
+    const int max_string_domain_size, const int num_threads,
+    SerializedOutput* schema_output) {
   tensorflow::metadata::v0::Schema schema;
-  if (!schema.ParseFromString(schema_proto_string)) {
+  if (!ParseFromStringView(schema_proto_string, &schema)) {
     return tensorflow::errors::InvalidArgument("Failed to parse Schema proto.");
   }
   tensorflow::metadata::v0::DatasetFeatureStatistics feature_statistics;
-  if (!feature_statistics.ParseFromString(feature_statistics_proto_string)) {
+  if (!ParseFromStringView(feature_statistics_proto_string,
+                           &feature_statistics)) {
     return tensorflow::errors::InvalidArgument(
         "Failed to parse DatasetFeatureStatistics proto.");
   }
   FeatureStatisticsToProtoConfig feature_statistics_to_proto_config;
   feature_statistics_to_proto_config.set_enum_threshold(max_string_domain_size);
+  feature_statistics_to_proto_config.set_num_threads(num_threads);
   tensorflow::metadata::v0::Schema output_schema;
   TF_RETURN_IF_ERROR(
       UpdateSchema(feature_statistics_to_proto_config,
                    schema, feature_statistics,
                    /* paths_to_consider= */ gtl::nullopt,
                    /* environment= */ gtl::nullopt, &output_schema));
-  if (!output_schema.SerializeToString(output_schema_proto_string)) {
-    return tensorflow::errors::Internal(
-        "Could not serialize Schema output proto to string.");
+  return SerializeToOutput(output_schema, "Schema", schema_output);
+}
+
+tensorflow::Status UpdateSchemaIncrementally(
+    absl::string_view schema_proto_string,
+    absl::string_view previous_feature_statistics_proto_string,
+    absl::string_view feature_statistics_proto_string,
+    const int max_string_domain_size, const int num_threads,
+    string* output_schema_proto_string) {
+  StringOutput output(output_schema_proto_string);
+  return UpdateSchemaIncrementally(
+      schema_proto_string, previous_feature_statistics_proto_string,
+      feature_statistics_proto_string, max_string_domain_size, num_threads,
+      &output);
+}
+
+tensorflow::Status UpdateSchemaIncrementally(
+    absl::string_view schema_proto_string,
+    absl::string_view previous_feature_statistics_proto_string,
+    absl::string_view feature_statistics_proto_string,
+    const int max_string_domain_size, const int num_threads,
+    SerializedOutput* schema_output) {
+  tensorflow::metadata::v0::Schema schema_proto;
+  if (!ParseFromStringView(schema_proto_string, &schema_proto)) {
+    return tensorflow::errors::InvalidArgument("Failed to parse Schema proto.");
   }
-  return tensorflow::Status::OK();
+  tensorflow::metadata::v0::DatasetFeatureStatistics previous_statistics;
+  if (!ParseFromStringView(previous_feature_statistics_proto_string,
+                           &previous_statistics)) {
+    return tensorflow::errors::InvalidArgument(
+        "Failed to parse previous DatasetFeatureStatistics proto.");
+  }
+  tensorflow::metadata::v0::DatasetFeatureStatistics statistics;
+  if (!ParseFromStringView(feature_statistics_proto_string, &statistics)) {
+    return tensorflow::errors::InvalidArgument(
+        "Failed to parse DatasetFeatureStatistics proto.");
+  }
+  FeatureStatisticsToProtoConfig feature_statistics_to_proto_config;
+  feature_statistics_to_proto_config.set_enum_threshold(max_string_domain_size);
+  feature_statistics_to_proto_config.set_num_threads(num_threads);
+
+  const bool by_weight = DatasetStatsView(statistics).WeightedStatisticsExist();
+  const DatasetStatsView view(statistics, by_weight,
+                              /* environment= */ absl::nullopt,
+                              /* previous_span= */ nullptr,
+                              /* serving= */ nullptr,
+                              /* previous_version= */ nullptr);
+  const DatasetStatsView previous_view(previous_statistics, by_weight,
+                                       /* environment= */ absl::nullopt,
+                                       /* previous_span= */ nullptr,
+                                       /* serving= */ nullptr,
+                                       /* previous_version= */ nullptr);
+  Schema schema;
+  TF_RETURN_IF_ERROR(schema.Init(schema_proto));
+  // The presence of every feature is relative to the number of examples.
+  if (previous_view.WeightedStatisticsExist() != by_weight ||
+      previous_view.GetNumExamples() != view.GetNumExamples()) {
+    TF_RETURN_IF_ERROR(
+        schema.Update(view, feature_statistics_to_proto_config));
+  } else {
+    TF_RETURN_IF_ERROR(
+        schema.Update(view, feature_statistics_to_proto_config,
+                      GetChangedPaths(previous_view, view, &schema)));
+  }
+  return SerializeToOutput(schema.GetSchema(), "Schema", schema_output);
 }
 
 tensorflow::Status ValidateFeatureStatistics(
@@ -112,155 +811,1076 @@ tensorflow::Status ValidateFeatureStatistics(
     const absl::optional<FeaturesNeeded>& features_needed,
     const ValidationConfig& validation_config, bool enable_diff_regions,
     tensorflow::metadata::v0::Anomalies* result) {
+  return ValidateFeatureStatistics(
+      feature_statistics, schema_proto, environment,
+      prev_span_feature_statistics, serving_feature_statistics,
+      prev_version_feature_statistics, features_needed, validation_config,
+      enable_diff_regions, result, /*profile=*/nullptr);
+}
+
+tensorflow::Status ValidateFeatureStatistics(
+    const tensorflow::metadata::v0::DatasetFeatureStatistics&
+        feature_statistics,
+    const tensorflow::metadata::v0::Schema& schema_proto,
+    const absl::optional<string>& environment,
+    const absl::optional<tensorflow::metadata::v0::DatasetFeatureStatistics>&
+        prev_span_feature_statistics,
+    const absl::optional<tensorflow::metadata::v0::DatasetFeatureStatistics>&
+        serving_feature_statistics,
+    const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+        prev_version_feature_statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    const ValidationConfig& validation_config, bool enable_diff_regions,
+    tensorflow::metadata::v0::Anomalies* result, ValidationProfile* profile) {
+  return ValidateFeatureStatistics(
+      feature_statistics, schema_proto, environment,
+      prev_span_feature_statistics, serving_feature_statistics,
+      prev_version_feature_statistics, features_needed, validation_config,
+      enable_diff_regions, result, profile, /*deadline=*/nullptr);
+}
+
+tensorflow::Status ValidateFeatureStatistics(
+    const tensorflow::metadata::v0::DatasetFeatureStatistics&
+        feature_statistics,
+    const tensorflow::metadata::v0::Schema& schema_proto,
+    const absl::optional<string>& environment,
+    const absl::optional<tensorflow::metadata::v0::DatasetFeatureStatistics>&
+        prev_span_feature_statistics,
+    const absl::optional<tensorflow::metadata::v0::DatasetFeatureStatistics>&
+        serving_feature_statistics,
+    const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+        prev_version_feature_statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    const ValidationConfig& validation_config, bool enable_diff_regions,
+    tensorflow::metadata::v0::Anomalies* result, ValidationProfile* profile,
+    const ValidationDeadline* deadline) {
   // TODO(b/113295423): Clean up the optional conversions.
   const absl::optional<string> maybe_environment =
       environment ? absl::optional<string>(*environment)
                   : absl::optional<string>();
-  FeatureStatisticsToProtoConfig feature_statistics_to_proto_config;
-  feature_statistics_to_proto_config.set_enum_threshold(kDefaultEnumThreshold);
-  feature_statistics_to_proto_config.set_new_features_are_warnings(
-      validation_config.new_features_are_warnings());
-  *feature_statistics_to_proto_config.mutable_severity_overrides() =
-      validation_config.severity_overrides();
+  return Validator(schema_proto, maybe_environment, validation_config)
+      .Validate(feature_statistics, prev_span_feature_statistics,
+                serving_feature_statistics, prev_version_feature_statistics,
+                features_needed, enable_diff_regions, result, profile,
+                deadline);
+}
 
-  const bool by_weight =
-      DatasetStatsView(feature_statistics).WeightedStatisticsExist();
-  if (feature_statistics.num_examples() == 0) {
-    *result->mutable_baseline() = schema_proto;
-    result->set_data_missing(true);
-  } else {
-    SchemaAnomalies schema_anomalies(schema_proto);
-    std::shared_ptr<DatasetStatsView> previous_span =
-        (prev_span_feature_statistics)
-            ? std::make_shared<DatasetStatsView>(
-                  prev_span_feature_statistics.value(), by_weight,
-                  maybe_environment,
-                  /* previous_span= */ nullptr,
-                  /* serving= */ nullptr,
-                  /* previous_version= */ nullptr)
-            : nullptr;
-
-    std::shared_ptr<DatasetStatsView> serving =
-        (serving_feature_statistics) ? std::make_shared<DatasetStatsView>(
-                                           serving_feature_statistics.value(),
-                                           by_weight, maybe_environment,
-                                           /* previous_span= */ nullptr,
-                                           /* serving= */ nullptr,
-                                           /* previous_version= */ nullptr)
-                                     : nullptr;
-
-    std::shared_ptr<DatasetStatsView> previous_version =
-        (prev_version_feature_statistics)
-            ? std::make_shared<DatasetStatsView>(
-                  prev_version_feature_statistics.value(), by_weight,
-                  maybe_environment,
-                  /* previous_span= */ nullptr,
-                  /* serving= */ nullptr,
-                  /* previous_version= */ nullptr)
-            : nullptr;
-
-    const DatasetStatsView training =
-        DatasetStatsView(feature_statistics, by_weight, maybe_environment,
-                         previous_span, serving, previous_version);
-    TF_RETURN_IF_ERROR(
-        schema_anomalies.FindChanges(training, features_needed,
-                                     feature_statistics_to_proto_config));
-    *result = schema_anomalies.GetSchemaDiff(enable_diff_regions);
-  }
+tensorflow::Status ComputeDriftAgainstPreviousSpans(
+    const DatasetFeatureStatistics& feature_statistics,
+    const tensorflow::metadata::v0::Schema& schema_proto,
+    const std::vector<DatasetFeatureStatistics>& prev_span_feature_statistics,
+    std::vector<tensorflow::metadata::v0::Anomalies>* results) {
+  return Validator(schema_proto, /*environment=*/absl::nullopt,
+                   ValidationConfig())
+      .ComputeDrift(feature_statistics, prev_span_feature_statistics, results);
+}
 
-  return tensorflow::Status::OK();
+tensorflow::Status ComputeDriftAgainstRollingState(
+    const DatasetFeatureStatistics& feature_statistics,
+    const tensorflow::metadata::v0::Schema& schema_proto,
+    RollingDriftState* state, tensorflow::metadata::v0::Anomalies* result) {
+  return Validator(schema_proto, /*environment=*/absl::nullopt,
+                   ValidationConfig())
+      .ComputeRollingDrift(feature_statistics, state, result);
 }
 
 tensorflow::Status ValidateFeatureStatisticsWithSerializedInputs(
-    const string& feature_statistics_proto_string,
-    const string& schema_proto_string, const string& environment,
-    const string& previous_span_statistics_proto_string,
-    const string& serving_statistics_proto_string,
-    const string& previous_version_statistics_proto_string,
-    const string& features_needed_string,
-    const string& validation_config_string, const bool enable_diff_regions,
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view schema_proto_string, const string& environment,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
     string* anomalies_proto_string) {
+  return ValidateFeatureStatisticsWithSerializedInputs(
+      feature_statistics_proto_string, schema_proto_string, environment,
+      previous_span_statistics_proto_string, serving_statistics_proto_string,
+      previous_version_statistics_proto_string, features_needed_string,
+      validation_config_string, enable_diff_regions, anomalies_proto_string,
+      /*profile=*/nullptr);
+}
+
+tensorflow::Status ValidateFeatureStatisticsWithSerializedInputs(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view schema_proto_string, const string& environment,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
+    string* anomalies_proto_string, ValidationProfile* profile) {
+  StringOutput output(anomalies_proto_string);
+  return ValidateFeatureStatisticsWithSerializedInputs(
+      feature_statistics_proto_string, schema_proto_string, environment,
+      previous_span_statistics_proto_string, serving_statistics_proto_string,
+      previous_version_statistics_proto_string, features_needed_string,
+      validation_config_string, enable_diff_regions, &output, profile);
+}
+
+tensorflow::Status ValidateFeatureStatisticsWithSerializedInputs(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view schema_proto_string, const string& environment,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
+    SerializedOutput* anomalies_output, ValidationProfile* profile) {
+  const std::shared_ptr<ValidationResultCache> cache =
+      GetValidationResultCache();
+  Fprint128 key;
+  if (cache != nullptr) {
+    const ScopedValidationStage stage("cache_lookup", profile);
+    key = ValidationResultCache::GetKey(
+        {feature_statistics_proto_string, schema_proto_string, environment,
+         previous_span_statistics_proto_string, serving_statistics_proto_string,
+         previous_version_statistics_proto_string, features_needed_string,
+         validation_config_string, enable_diff_regions ? "1" : "0"});
+    string cached;
+    if (cache->Get(key, &cached)) {
+      return CopyToOutput(cached, anomalies_output);
+    }
+  }
+  // Remembers the result, to add it to the cache.
+  RecordingOutput recording_output(anomalies_output);
+  std::unique_ptr<Validator> validator;
+  {
+    const ScopedValidationStage stage("create_validator", profile);
+    TF_RETURN_IF_ERROR(Validator::Create(schema_proto_string, environment,
+                                         validation_config_string,
+                                         &validator));
+  }
+  // Once the deadline expires, the validation returns the anomalies found so
+  // far, which depend on when it expired and must not be cached.
+  absl::optional<ValidationDeadline> deadline;
+  if (validator->deadline_micros() > 0) {
+    deadline.emplace(validator->deadline_micros());
+  }
+  TF_RETURN_IF_ERROR(validator->ValidateWithSerializedInputs(
+      feature_statistics_proto_string, previous_span_statistics_proto_string,
+      serving_statistics_proto_string,
+      previous_version_statistics_proto_string, features_needed_string,
+      enable_diff_regions, &recording_output, profile,
+      deadline ? &*deadline : nullptr));
+  if (cache != nullptr && !(deadline && deadline->Expired())) {
+    cache->Put(key, string(recording_output.written()));
+  }
+  return tensorflow::Status::OK();
+}
+
+tensorflow::Status ValidateFeatureStatisticsFromFiles(
+    const string& feature_statistics_path, const string& schema_path,
+    const string& environment, const string& previous_span_statistics_path,
+    const string& serving_statistics_path,
+    const string& previous_version_statistics_path,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
+    string* anomalies_proto_string) {
+  StringOutput output(anomalies_proto_string);
+  return ValidateFeatureStatisticsFromFiles(
+      feature_statistics_path, schema_path, environment,
+      previous_span_statistics_path, serving_statistics_path,
+      previous_version_statistics_path, features_needed_string,
+      validation_config_string, enable_diff_regions, &output,
+      /*profile=*/nullptr);
+}
+
+tensorflow::Status ValidateFeatureStatisticsFromFiles(
+    const string& feature_statistics_path, const string& schema_path,
+    const string& environment, const string& previous_span_statistics_path,
+    const string& serving_statistics_path,
+    const string& previous_version_statistics_path,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
+    SerializedOutput* anomalies_output, ValidationProfile* profile) {
+  if (feature_statistics_path.empty()) {
+    return tensorflow::errors::InvalidArgument(
+        "The path of the statistics to validate is empty.");
+  }
+  std::unique_ptr<ReadOnlyMemoryRegion> regions[5];
+  absl::string_view feature_statistics_proto_string;
+  absl::string_view schema_proto_string;
+  absl::string_view previous_span_statistics_proto_string;
+  absl::string_view serving_statistics_proto_string;
+  absl::string_view previous_version_statistics_proto_string;
+  {
+    const ScopedValidationStage stage("map_files", profile);
+    TF_RETURN_IF_ERROR(MapFile(feature_statistics_path, &regions[0],
+                               &feature_statistics_proto_string));
+    TF_RETURN_IF_ERROR(
+        MapFile(schema_path, &regions[1], &schema_proto_string));
+    TF_RETURN_IF_ERROR(MapFile(previous_span_statistics_path, &regions[2],
+                               &previous_span_statistics_proto_string));
+    TF_RETURN_IF_ERROR(MapFile(serving_statistics_path, &regions[3],
+                               &serving_statistics_proto_string));
+    TF_RETURN_IF_ERROR(MapFile(previous_version_statistics_path, &regions[4],
+                               &previous_version_statistics_proto_string));
+  }
+  return ValidateFeatureStatisticsWithSerializedInputs(
+      feature_statistics_proto_string, schema_proto_string, environment,
+      previous_span_statistics_proto_string, serving_statistics_proto_string,
+      previous_version_statistics_proto_string, features_needed_string,
+      validation_config_string, enable_diff_regions, anomalies_output,
+      profile);
+}
+
+void SetValidationResultCache(std::shared_ptr<ValidationResultCache> cache) {
+  ProcessValidationResultCache& process_cache =
+      GetProcessValidationResultCache();
+  mutex_lock lock(process_cache.mu);
+  process_cache.cache = std::move(cache);
+}
+
+std::shared_ptr<ValidationResultCache> GetValidationResultCache() {
+  ProcessValidationResultCache& process_cache =
+      GetProcessValidationResultCache();
+  mutex_lock lock(process_cache.mu);
+  return process_cache.cache;
+}
+
+tensorflow::Status Validator::Create(absl::string_view schema_proto_string,
+                                     const string& environment,
+                                     absl::string_view validation_config_string,
+                                     std::unique_ptr<Validator>* result) {
   tensorflow::metadata::v0::Schema schema;
-  if (!schema.ParseFromString(schema_proto_string)) {
+  if (!ParseFromStringView(schema_proto_string, &schema)) {
     return tensorflow::errors::InvalidArgument("Failed to parse Schema proto.");
   }
 
-  tensorflow::metadata::v0::DatasetFeatureStatistics feature_statistics;
-  if (!feature_statistics.ParseFromString(feature_statistics_proto_string)) {
+  absl::optional<string> may_be_environment;
+  if (!environment.empty()) {
+    may_be_environment = environment;
+  }
+
+  data_validation::ValidationConfig validation_config;
+  if (!ParseFromStringView(validation_config_string, &validation_config)) {
     return tensorflow::errors::InvalidArgument(
-        "Failed to parse DatasetFeatureStatistics proto.");
+        "Failed to parse ValidationConfig");
   }
 
-  absl::optional<tensorflow::metadata::v0::DatasetFeatureStatistics>
-      previous_span_statistics = tensorflow::gtl::nullopt;
-  if (!previous_span_statistics_proto_string.empty()) {
-    tensorflow::metadata::v0::DatasetFeatureStatistics tmp_stats;
-    if (!tmp_stats.ParseFromString(previous_span_statistics_proto_string)) {
-      return tensorflow::errors::InvalidArgument(
-          "Failed to parse DatasetFeatureStatistics proto.");
+  *result =
+      absl::make_unique<Validator>(schema, may_be_environment,
+                                   validation_config);
+  return tensorflow::Status::OK();
+}
+
+tensorflow::Status Validator::CreateFromSchemaSnapshot(
+    const string& schema_snapshot_path, const string& environment,
+    absl::string_view validation_config_string,
+    std::unique_ptr<Validator>* result) {
+  std::shared_ptr<const IndexedSchema> schema;
+  TF_RETURN_IF_ERROR(ReadSchemaSnapshot(schema_snapshot_path, &schema));
+
+  absl::optional<string> may_be_environment;
+  if (!environment.empty()) {
+    may_be_environment = environment;
+  }
+
+  data_validation::ValidationConfig validation_config;
+  if (!ParseFromStringView(validation_config_string, &validation_config)) {
+    return tensorflow::errors::InvalidArgument(
+        "Failed to parse ValidationConfig");
+  }
+
+  *result = absl::make_unique<Validator>(std::move(schema), may_be_environment,
+                                         validation_config, /*cache=*/nullptr);
+  return tensorflow::Status::OK();
+}
+
+Validator::Validator(const tensorflow::metadata::v0::Schema& schema_proto,
+                     const absl::optional<string>& environment,
+                     const ValidationConfig& validation_config)
+    : Validator(schema_proto, environment, validation_config,
+                /*cache=*/nullptr) {}
+
+Validator::Validator(const tensorflow::metadata::v0::Schema& schema_proto,
+                     const absl::optional<string>& environment,
+                     const ValidationConfig& validation_config,
+                     std::shared_ptr<FeatureValidationCache> cache)
+    : Validator(std::make_shared<const IndexedSchema>(schema_proto),
+                environment, validation_config, std::move(cache)) {}
+
+Validator::Validator(std::shared_ptr<const IndexedSchema> schema,
+                     const absl::optional<string>& environment,
+                     const ValidationConfig& validation_config,
+                     std::shared_ptr<FeatureValidationCache> cache)
+    : schema_(std::move(schema)),
+      environment_(environment),
+      updater_(GetFeatureStatisticsToProtoConfig(validation_config)),
+      num_threads_(validation_config.num_threads()),
+      num_slowest_features_profiled_(
+          validation_config.num_slowest_features_profiled()),
+      memory_budget_bytes_(validation_config.memory_budget_bytes()),
+      delta_encoded_anomalies_(validation_config.delta_encoded_anomalies()),
+      max_anomalies_(validation_config.max_anomalies()),
+      deadline_micros_(validation_config.deadline_micros()),
+      cache_(std::move(cache)),
+      view_cache_(validation_config.max_cached_statistics() > 0
+                      ? std::make_shared<StatisticsViewCache>(
+                            validation_config.max_cached_statistics())
+                      : nullptr) {}
+
+tensorflow::Status Validator::Validate(
+    const DatasetFeatureStatistics& feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>&
+        prev_span_feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>& serving_feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>&
+        prev_version_feature_statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    bool enable_diff_regions,
+    tensorflow::metadata::v0::Anomalies* result) const {
+  return Validate(feature_statistics, prev_span_feature_statistics,
+                  serving_feature_statistics, prev_version_feature_statistics,
+                  features_needed, enable_diff_regions, result,
+                  /*profile=*/nullptr);
+}
+
+tensorflow::Status Validator::Validate(
+    const DatasetFeatureStatistics& feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>&
+        prev_span_feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>& serving_feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>&
+        prev_version_feature_statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    bool enable_diff_regions, tensorflow::metadata::v0::Anomalies* result,
+    ValidationProfile* profile) const {
+  return Validate(feature_statistics, prev_span_feature_statistics,
+                  serving_feature_statistics, prev_version_feature_statistics,
+                  features_needed, enable_diff_regions, result, profile,
+                  /*deadline=*/nullptr);
+}
+
+tensorflow::Status Validator::Validate(
+    const DatasetFeatureStatistics& feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>&
+        prev_span_feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>& serving_feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>&
+        prev_version_feature_statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    bool enable_diff_regions, tensorflow::metadata::v0::Anomalies* result,
+    ValidationProfile* profile, const ValidationDeadline* deadline) const {
+  absl::optional<ValidationDeadline> config_deadline;
+  if (deadline == nullptr && deadline_micros_ > 0) {
+    config_deadline.emplace(deadline_micros_);
+    deadline = &*config_deadline;
+  }
+  StatisticsSource statistics_to_validate;
+  statistics_to_validate.parsed = &feature_statistics;
+  absl::optional<ValidationMemoryAccount> memory =
+      MakeMemoryAccount(profile, memory_budget_bytes_);
+  // Control statistics that the schema does not use are ignored.
+  const tensorflow::Status status = ValidateFeatureStatisticsWithIndexedSchema(
+      statistics_to_validate, schema_, environment_,
+      /*by_weight=*/absl::nullopt,
+      GetControlStatistics(prev_span_feature_statistics,
+                           schema_->UsesPreviousSpan()),
+      GetControlStatistics(serving_feature_statistics,
+                           schema_->UsesServing()),
+      GetControlStatistics(prev_version_feature_statistics,
+                           schema_->UsesPreviousVersion()),
+      features_needed, updater_, num_threads_, enable_diff_regions,
+      cache_.get(), /*sink=*/nullptr, /*delta=*/nullptr, result, profile,
+      num_slowest_features_profiled_, max_anomalies_, deadline,
+      memory ? &*memory : nullptr);
+  if (profile != nullptr) {
+    *profile->mutable_memory() = memory->memory();
+  }
+  return status;
+}
+
+tensorflow::Status Validator::ValidateInEnvironments(
+    const DatasetFeatureStatistics& feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>&
+        prev_span_feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>& serving_feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>&
+        prev_version_feature_statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    const std::vector<absl::optional<string>>& environments,
+    bool enable_diff_regions,
+    std::vector<tensorflow::metadata::v0::Anomalies>* results) const {
+  // The deadline bounds the validation in all the environments.
+  absl::optional<ValidationDeadline> deadline;
+  if (deadline_micros_ > 0) {
+    deadline.emplace(deadline_micros_);
+  }
+  StatisticsSource statistics_to_validate;
+  statistics_to_validate.parsed = &feature_statistics;
+  const StatisticsSource previous_span_statistics = GetControlStatistics(
+      prev_span_feature_statistics, schema_->UsesPreviousSpan());
+  const StatisticsSource serving_statistics =
+      GetControlStatistics(serving_feature_statistics, schema_->UsesServing());
+  const StatisticsSource previous_version_statistics = GetControlStatistics(
+      prev_version_feature_statistics, schema_->UsesPreviousVersion());
+  // The anomalies of the root features that do not depend on the environment
+  // are found in the first environment, and then looked up in this cache.
+  InMemoryFeatureValidationCache environments_cache;
+  FeatureValidationCache* cache =
+      cache_ != nullptr ? cache_.get() : &environments_cache;
+  results->assign(environments.size(), tensorflow::metadata::v0::Anomalies());
+  for (int i = 0; i < environments.size(); ++i) {
+    absl::optional<ValidationMemoryAccount> memory =
+        MakeMemoryAccount(/*profile=*/nullptr, memory_budget_bytes_);
+    const tensorflow::Status status =
+        ValidateFeatureStatisticsWithIndexedSchema(
+            statistics_to_validate, schema_, environments[i],
+            /*by_weight=*/absl::nullopt, previous_span_statistics,
+            serving_statistics, previous_version_statistics, features_needed,
+            updater_, num_threads_, enable_diff_regions, cache,
+            /*sink=*/nullptr,
+            /*delta=*/nullptr, &(*results)[i], /*profile=*/nullptr,
+            /*num_slowest_features=*/0, max_anomalies_,
+            deadline ? &*deadline : nullptr, memory ? &*memory : nullptr);
+    if (!status.ok()) {
+      results->clear();
+      return status;
     }
-    previous_span_statistics = tmp_stats;
   }
+  return tensorflow::Status::OK();
+}
 
-  absl::optional<tensorflow::metadata::v0::DatasetFeatureStatistics>
-      serving_statistics = tensorflow::gtl::nullopt;
-  if (!serving_statistics_proto_string.empty()) {
-    tensorflow::metadata::v0::DatasetFeatureStatistics tmp_stats;
-    if (!tmp_stats.ParseFromString(serving_statistics_proto_string)) {
-      return tensorflow::errors::InvalidArgument(
-          "Failed to parse DatasetFeatureStatistics proto.");
+tensorflow::Status Validator::ValidateWithAndWithoutWeights(
+    const DatasetFeatureStatistics& feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>&
+        prev_span_feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>& serving_feature_statistics,
+    const absl::optional<DatasetFeatureStatistics>&
+        prev_version_feature_statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    bool enable_diff_regions,
+    tensorflow::metadata::v0::Anomalies* unweighted_result,
+    tensorflow::metadata::v0::Anomalies* weighted_result) const {
+  // The deadline bounds the validation in both modes.
+  absl::optional<ValidationDeadline> deadline;
+  if (deadline_micros_ > 0) {
+    deadline.emplace(deadline_micros_);
+  }
+  StatisticsSource statistics_to_validate;
+  statistics_to_validate.parsed = &feature_statistics;
+  const StatisticsSource previous_span_statistics = GetControlStatistics(
+      prev_span_feature_statistics, schema_->UsesPreviousSpan());
+  const StatisticsSource serving_statistics =
+      GetControlStatistics(serving_feature_statistics, schema_->UsesServing());
+  const StatisticsSource previous_version_statistics = GetControlStatistics(
+      prev_version_feature_statistics, schema_->UsesPreviousVersion());
+  // The anomalies of the root features that do not depend on the weights are
+  // found without weights, and then looked up in this cache.
+  InMemoryFeatureValidationCache weights_cache;
+  FeatureValidationCache* cache =
+      cache_ != nullptr ? cache_.get() : &weights_cache;
+  const bool has_weighted_statistics =
+      UseWeightedStatistics(statistics_to_validate);
+  for (const bool by_weight : {false, true}) {
+    if (by_weight && !has_weighted_statistics) {
+      *weighted_result = *unweighted_result;
+      break;
+    }
+    absl::optional<ValidationMemoryAccount> memory =
+        MakeMemoryAccount(/*profile=*/nullptr, memory_budget_bytes_);
+    TF_RETURN_IF_ERROR(ValidateFeatureStatisticsWithIndexedSchema(
+        statistics_to_validate, schema_, environment_, by_weight,
+        previous_span_statistics, serving_statistics,
+        previous_version_statistics, features_needed, updater_, num_threads_,
+        enable_diff_regions, cache, /*sink=*/nullptr, /*delta=*/nullptr,
+        by_weight ? weighted_result : unweighted_result, /*profile=*/nullptr,
+        /*num_slowest_features=*/0, max_anomalies_,
+        deadline ? &*deadline : nullptr, memory ? &*memory : nullptr));
+  }
+  return tensorflow::Status::OK();
+}
+
+tensorflow::Status Validator::ValidateInEnvironmentsWithSerializedInputs(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string,
+    const std::vector<string>& environments, bool enable_diff_regions,
+    std::vector<string>* anomalies_proto_strings) const {
+  // See ValidateInEnvironments().
+  absl::optional<ValidationDeadline> deadline;
+  if (deadline_micros_ > 0) {
+    deadline.emplace(deadline_micros_);
+  }
+  absl::optional<FeaturesNeeded> features_needed;
+  TF_RETURN_IF_ERROR(
+      ParseFeaturesNeeded(features_needed_string, &features_needed));
+  // The statistics are parsed once, and shared by all the environments.
+  protobuf::Arena arena;
+  StatisticsSource feature_statistics;
+  StatisticsSource previous_span_statistics;
+  StatisticsSource serving_statistics;
+  StatisticsSource previous_version_statistics;
+  TF_RETURN_IF_ERROR(ParseSerializedStatistics(
+      feature_statistics_proto_string, previous_span_statistics_proto_string,
+      serving_statistics_proto_string,
+      previous_version_statistics_proto_string, *schema_,
+      /*lazy=*/features_needed.has_value(), &arena, view_cache_.get(),
+      &feature_statistics, &previous_span_statistics, &serving_statistics,
+      &previous_version_statistics));
+  // See ValidateInEnvironments().
+  InMemoryFeatureValidationCache environments_cache;
+  FeatureValidationCache* cache =
+      cache_ != nullptr ? cache_.get() : &environments_cache;
+  anomalies_proto_strings->assign(environments.size(), string());
+  for (int i = 0; i < environments.size(); ++i) {
+    const absl::optional<string> environment =
+        environments[i].empty() ? absl::nullopt
+                                : absl::make_optional(environments[i]);
+    absl::optional<ValidationMemoryAccount> memory =
+        MakeMemoryAccount(/*profile=*/nullptr, memory_budget_bytes_);
+    // The result of each environment is freed once it is serialized.
+    tensorflow::metadata::v0::Anomalies anomalies;
+    absl::optional<AnomaliesDelta> delta;
+    if (delta_encoded_anomalies_) {
+      delta.emplace();
+    }
+    StringOutput output(&(*anomalies_proto_strings)[i]);
+    tensorflow::Status status = ValidateFeatureStatisticsWithIndexedSchema(
+        feature_statistics, schema_, environment, /*by_weight=*/absl::nullopt,
+        previous_span_statistics, serving_statistics,
+        previous_version_statistics, features_needed, updater_, num_threads_,
+        enable_diff_regions, cache, /*sink=*/nullptr,
+        delta ? &*delta : nullptr, &anomalies, /*profile=*/nullptr,
+        /*num_slowest_features=*/0, max_anomalies_,
+        deadline ? &*deadline : nullptr, memory ? &*memory : nullptr);
+    if (status.ok()) {
+      status = delta ? SerializeToOutput(*delta, "AnomaliesDelta", &output)
+                     : SerializeToOutput(anomalies, "Anomalies", &output);
+    }
+    if (!status.ok()) {
+      anomalies_proto_strings->clear();
+      return status;
     }
-    serving_statistics = tmp_stats;
   }
+  return tensorflow::Status::OK();
+}
 
-  absl::optional<tensorflow::metadata::v0::DatasetFeatureStatistics>
-      previous_version_statistics = tensorflow::gtl::nullopt;
-  if (!previous_version_statistics_proto_string.empty()) {
-    tensorflow::metadata::v0::DatasetFeatureStatistics tmp_stats;
-    if (!tmp_stats.ParseFromString(previous_version_statistics_proto_string)) {
+tensorflow::Status Validator::ValidateShardsWithSerializedInputs(
+    const std::vector<absl::string_view>& shard_proto_strings,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string, bool enable_diff_regions,
+    string* anomalies_proto_string) const {
+  // The deadline includes the parsing and the merging.
+  absl::optional<ValidationDeadline> deadline;
+  if (deadline_micros_ > 0) {
+    deadline.emplace(deadline_micros_);
+  }
+  absl::optional<FeaturesNeeded> features_needed;
+  TF_RETURN_IF_ERROR(
+      ParseFeaturesNeeded(features_needed_string, &features_needed));
+  // The shards, the merged statistics and the result live on this arena.
+  protobuf::Arena arena;
+  const int num_shards = shard_proto_strings.size();
+  std::vector<DatasetFeatureStatistics*> shards(num_shards);
+  for (int i = 0; i < num_shards; ++i) {
+    shards[i] =
+        protobuf::Arena::CreateMessage<DatasetFeatureStatistics>(&arena);
+  }
+  std::vector<bool> parsed(num_shards);
+  const auto parse_shard = [&shard_proto_strings, &shards, &parsed](int i) {
+    parsed[i] = ParseFromStringView(shard_proto_strings[i], shards[i]);
+  };
+  if (num_threads_ > 1 && num_shards > 1) {
+    thread::ThreadPool thread_pool(Env::Default(), "parse_shards",
+                                   std::min(num_threads_, num_shards));
+    for (int i = 0; i < num_shards; ++i) {
+      thread_pool.Schedule([&parse_shard, i]() { parse_shard(i); });
+    }
+    // The destructor of thread_pool waits for all the scheduled work.
+  } else {
+    for (int i = 0; i < num_shards; ++i) {
+      parse_shard(i);
+    }
+  }
+  for (int i = 0; i < num_shards; ++i) {
+    if (!parsed[i]) {
       return tensorflow::errors::InvalidArgument(
-          "Failed to parse DatasetFeatureStatistics proto.");
+          "Failed to parse DatasetFeatureStatistics proto of shard ", i, ".");
     }
-    previous_version_statistics = tmp_stats;
   }
+  DatasetFeatureStatistics* merged =
+      protobuf::Arena::CreateMessage<DatasetFeatureStatistics>(&arena);
+  TF_RETURN_IF_ERROR(MergeDatasetFeatureStatistics(
+      std::vector<const DatasetFeatureStatistics*>(shards.begin(),
+                                                   shards.end()),
+      num_threads_, merged));
 
-  absl::optional<string> may_be_environment =
-      tensorflow::gtl::nullopt;
-  if (!environment.empty()) {
-    may_be_environment = environment;
+  StatisticsSource feature_statistics;
+  feature_statistics.parsed = merged;
+  StatisticsSource previous_span_statistics;
+  StatisticsSource serving_statistics;
+  StatisticsSource previous_version_statistics;
+  if (view_cache_ != nullptr) {
+    GetCachedControlStatistics(previous_span_statistics_proto_string,
+                               schema_->UsesPreviousSpan(), view_cache_.get(),
+                               &previous_span_statistics);
+    GetCachedControlStatistics(serving_statistics_proto_string,
+                               schema_->UsesServing(), view_cache_.get(),
+                               &serving_statistics);
+    GetCachedControlStatistics(previous_version_statistics_proto_string,
+                               schema_->UsesPreviousVersion(),
+                               view_cache_.get(), &previous_version_statistics);
+  } else {
+    TF_RETURN_IF_ERROR(ParseControlStatistics(
+        previous_span_statistics_proto_string, schema_->UsesPreviousSpan(),
+        &previous_span_statistics));
+    TF_RETURN_IF_ERROR(ParseControlStatistics(serving_statistics_proto_string,
+                                              schema_->UsesServing(),
+                                              &serving_statistics));
+    TF_RETURN_IF_ERROR(ParseControlStatistics(
+        previous_version_statistics_proto_string,
+        schema_->UsesPreviousVersion(), &previous_version_statistics));
   }
 
-  absl::optional<FeaturesNeeded> features_needed = gtl::nullopt;
-  if (!features_needed_string.empty()) {
-    FeaturesNeededProto parsed_proto;
-    if (!parsed_proto.ParseFromString(features_needed_string)) {
-      return tensorflow::errors::InvalidArgument(
-          "Failed to parse FeaturesNeeded");
+  absl::optional<ValidationMemoryAccount> memory =
+      MakeMemoryAccount(/*profile=*/nullptr, memory_budget_bytes_);
+  tensorflow::metadata::v0::Anomalies* anomalies =
+      protobuf::Arena::CreateMessage<tensorflow::metadata::v0::Anomalies>(
+          &arena);
+  AnomaliesDelta* delta =
+      delta_encoded_anomalies_
+          ? protobuf::Arena::CreateMessage<AnomaliesDelta>(&arena)
+          : nullptr;
+  TF_RETURN_IF_ERROR(ValidateFeatureStatisticsWithIndexedSchema(
+      feature_statistics, schema_, environment_, /*by_weight=*/absl::nullopt,
+      previous_span_statistics, serving_statistics,
+      previous_version_statistics, features_needed, updater_, num_threads_,
+      enable_diff_regions, cache_.get(), /*sink=*/nullptr, delta, anomalies,
+      /*profile=*/nullptr, /*num_slowest_features=*/0, max_anomalies_,
+      deadline ? &*deadline : nullptr, memory ? &*memory : nullptr));
+  StringOutput output(anomalies_proto_string);
+  return delta != nullptr
+             ? SerializeToOutput(*delta, "AnomaliesDelta", &output)
+             : SerializeToOutput(*anomalies, "Anomalies", &output);
+}
+
+tensorflow::Status Validator::ComputeDrift(
+    const DatasetFeatureStatistics& feature_statistics,
+    const std::vector<DatasetFeatureStatistics>& prev_span_feature_statistics,
+    std::vector<tensorflow::metadata::v0::Anomalies>* results) const {
+  StatisticsSource statistics;
+  statistics.parsed = &feature_statistics;
+  std::vector<StatisticsSource> previous_spans(
+      prev_span_feature_statistics.size());
+  for (int i = 0; i < previous_spans.size(); ++i) {
+    previous_spans[i].parsed = &prev_span_feature_statistics[i];
+  }
+  return ComputeDriftWithIndexedSchema(
+      statistics, *schema_, previous_spans,
+      updater_.config().approximate_infinity_norm(),
+      updater_.config().numeric_infinity_norm(), results);
+}
+
+tensorflow::Status Validator::ComputeRollingDrift(
+    const DatasetFeatureStatistics& feature_statistics,
+    RollingDriftState* state,
+    tensorflow::metadata::v0::Anomalies* result) const {
+  StatisticsSource statistics;
+  statistics.parsed = &feature_statistics;
+  const DatasetStatsView view = statistics.View(
+      UseWeightedStatistics(statistics), /*environment=*/absl::nullopt,
+      /* previous_span= */ nullptr, /* serving= */ nullptr,
+      /* previous_version= */ nullptr);
+  return UpdateRollingDriftState(view, *schema_, state, result);
+}
+
+tensorflow::Status Validator::ComputeDriftWithSerializedInputs(
+    absl::string_view feature_statistics_proto_string,
+    const std::vector<absl::string_view>&
+        previous_span_statistics_proto_strings,
+    std::vector<string>* anomalies_proto_strings) const {
+  // The parsed statistics live on this arena.
+  protobuf::Arena arena;
+  StatisticsSource statistics;
+  DatasetFeatureStatistics* parsed =
+      protobuf::Arena::CreateMessage<DatasetFeatureStatistics>(&arena);
+  if (!ParseFromStringView(feature_statistics_proto_string, parsed)) {
+    return tensorflow::errors::InvalidArgument(
+        "Failed to parse DatasetFeatureStatistics proto.");
+  }
+  statistics.parsed = parsed;
+  std::vector<StatisticsSource> previous_spans(
+      previous_span_statistics_proto_strings.size());
+  for (int i = 0; i < previous_spans.size(); ++i) {
+    TF_RETURN_IF_ERROR(LazyDatasetFeatureStatistics::Create(
+        previous_span_statistics_proto_strings[i], &previous_spans[i].lazy));
+  }
+  std::vector<tensorflow::metadata::v0::Anomalies> results;
+  TF_RETURN_IF_ERROR(ComputeDriftWithIndexedSchema(
+      statistics, *schema_, previous_spans,
+      updater_.config().approximate_infinity_norm(),
+      updater_.config().numeric_infinity_norm(), &results));
+  anomalies_proto_strings->assign(results.size(), string());
+  for (int i = 0; i < results.size(); ++i) {
+    if (!results[i].SerializeToString(&(*anomalies_proto_strings)[i])) {
+      anomalies_proto_strings->clear();
+      return tensorflow::errors::Internal(
+          "Could not serialize Anomalies output proto to string.");
     }
+  }
+  return tensorflow::Status::OK();
+}
 
-    FeaturesNeeded parsed_feature_needed;
+tensorflow::Status Validator::ValidateWithSerializedInputs(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string, bool enable_diff_regions,
+    string* anomalies_proto_string) const {
+  return ValidateWithSerializedInputs(
+      feature_statistics_proto_string, previous_span_statistics_proto_string,
+      serving_statistics_proto_string,
+      previous_version_statistics_proto_string, features_needed_string,
+      enable_diff_regions, anomalies_proto_string, /*profile=*/nullptr);
+}
+
+tensorflow::Status Validator::ValidateWithSerializedInputs(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string, bool enable_diff_regions,
+    string* anomalies_proto_string, ValidationProfile* profile) const {
+  StringOutput output(anomalies_proto_string);
+  return ValidateWithSerializedInputs(
+      feature_statistics_proto_string, previous_span_statistics_proto_string,
+      serving_statistics_proto_string,
+      previous_version_statistics_proto_string, features_needed_string,
+      enable_diff_regions, &output, profile);
+}
+
+tensorflow::Status Validator::ValidateWithSerializedInputs(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string, bool enable_diff_regions,
+    SerializedOutput* anomalies_output, ValidationProfile* profile) const {
+  return ValidateWithSerializedInputs(
+      feature_statistics_proto_string, previous_span_statistics_proto_string,
+      serving_statistics_proto_string,
+      previous_version_statistics_proto_string, features_needed_string,
+      enable_diff_regions, anomalies_output, profile, /*deadline=*/nullptr);
+}
+
+tensorflow::Status Validator::ValidateWithSerializedInputs(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string, bool enable_diff_regions,
+    SerializedOutput* anomalies_output, ValidationProfile* profile,
+    const ValidationDeadline* deadline) const {
+  absl::optional<FeaturesNeeded> features_needed;
+  {
+    const ScopedValidationStage stage("parse_features_needed", profile);
     TF_RETURN_IF_ERROR(
-        FromFeaturesNeededProto(parsed_proto, &parsed_feature_needed));
-    if (!parsed_feature_needed.empty()) {
-      features_needed = parsed_feature_needed;
+        ParseFeaturesNeeded(features_needed_string, &features_needed));
+  }
+  return ValidateSerializedStatistics(
+      feature_statistics_proto_string, previous_span_statistics_proto_string,
+      serving_statistics_proto_string,
+      previous_version_statistics_proto_string, features_needed,
+      enable_diff_regions, /*sink=*/nullptr, anomalies_output, profile,
+      deadline);
+}
+
+tensorflow::Status Validator::ValidateWithSerializedInputs(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    bool enable_diff_regions, string* anomalies_proto_string) const {
+  StringOutput output(anomalies_proto_string);
+  return ValidateSerializedStatistics(
+      feature_statistics_proto_string, previous_span_statistics_proto_string,
+      serving_statistics_proto_string,
+      previous_version_statistics_proto_string, features_needed,
+      enable_diff_regions, /*sink=*/nullptr, &output, /*profile=*/nullptr,
+      /*deadline=*/nullptr);
+}
+
+tensorflow::Status Validator::ValidateWithSerializedInputs(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string, bool enable_diff_regions,
+    AnomaliesSink* sink) const {
+  absl::optional<FeaturesNeeded> features_needed;
+  TF_RETURN_IF_ERROR(
+      ParseFeaturesNeeded(features_needed_string, &features_needed));
+  return ValidateWithSerializedInputs(
+      feature_statistics_proto_string, previous_span_statistics_proto_string,
+      serving_statistics_proto_string,
+      previous_version_statistics_proto_string, features_needed,
+      enable_diff_regions, sink);
+}
+
+tensorflow::Status Validator::ValidateWithSerializedInputs(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    bool enable_diff_regions, AnomaliesSink* sink) const {
+  return ValidateSerializedStatistics(
+      feature_statistics_proto_string, previous_span_statistics_proto_string,
+      serving_statistics_proto_string,
+      previous_version_statistics_proto_string, features_needed,
+      enable_diff_regions, sink, /*anomalies_output=*/nullptr,
+      /*profile=*/nullptr, /*deadline=*/nullptr);
+}
+
+tensorflow::Status Validator::ValidateSerializedStatistics(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    bool enable_diff_regions, AnomaliesSink* sink,
+    SerializedOutput* anomalies_output, ValidationProfile* profile,
+    const ValidationDeadline* deadline) const {
+  // The deadline includes the parsing.
+  absl::optional<ValidationDeadline> config_deadline;
+  if (deadline == nullptr && deadline_micros_ > 0) {
+    config_deadline.emplace(deadline_micros_);
+    deadline = &*config_deadline;
+  }
+  // All the parsed statistics and the result live on this arena, and are
+  // freed at once at the end of the call.
+  protobuf::Arena arena;
+  StatisticsSource feature_statistics;
+  StatisticsSource previous_span_statistics;
+  StatisticsSource serving_statistics;
+  StatisticsSource previous_version_statistics;
+  {
+    const ScopedValidationStage stage("parse", profile);
+    // If only some of the features may be needed, only the features that are
+    // accessed are parsed.
+    TF_RETURN_IF_ERROR(ParseSerializedStatistics(
+        feature_statistics_proto_string, previous_span_statistics_proto_string,
+        serving_statistics_proto_string,
+        previous_version_statistics_proto_string, *schema_,
+        /*lazy=*/features_needed.has_value(), &arena, view_cache_.get(),
+        &feature_statistics, &previous_span_statistics, &serving_statistics,
+        &previous_version_statistics));
+  }
+
+  absl::optional<ValidationMemoryAccount> memory =
+      MakeMemoryAccount(profile, memory_budget_bytes_);
+  // The memory account is copied to the profile however this returns.
+  const auto add_memory_to_profile = [profile, &memory]() {
+    if (profile != nullptr) {
+      *profile->mutable_memory() = memory->memory();
     }
+  };
+  tensorflow::metadata::v0::Anomalies* anomalies =
+      protobuf::Arena::CreateMessage<tensorflow::metadata::v0::Anomalies>(
+          &arena);
+  AnomaliesDelta* delta =
+      delta_encoded_anomalies_
+          ? protobuf::Arena::CreateMessage<AnomaliesDelta>(&arena)
+          : nullptr;
+  const tensorflow::Status status = ValidateFeatureStatisticsWithIndexedSchema(
+      feature_statistics, schema_, environment_, /*by_weight=*/absl::nullopt,
+      previous_span_statistics, serving_statistics,
+      previous_version_statistics, features_needed, updater_, num_threads_,
+      enable_diff_regions, cache_.get(), sink, delta, anomalies, profile,
+      num_slowest_features_profiled_, max_anomalies_, deadline,
+      memory ? &*memory : nullptr);
+  if (!status.ok() || sink != nullptr) {
+    add_memory_to_profile();
+    return status;
+  }
+
+  {
+    const ScopedValidationStage stage("serialize", profile);
+    TF_RETURN_IF_ERROR(
+        delta != nullptr
+            ? SerializeToOutput(*delta, "AnomaliesDelta", anomalies_output)
+            : SerializeToOutput(*anomalies, "Anomalies", anomalies_output));
+  }
+  if (memory) {
+    // The result and its serialization coexist until the arena is freed.
+    memory->set_output_bytes(
+        memory->memory().output_bytes() +
+        (delta != nullptr ? delta->GetCachedSize()
+                          : anomalies->GetCachedSize()));
+  }
+  add_memory_to_profile();
+  return tensorflow::Status::OK();
+}
+
+tensorflow::Status ValidateFeatureStatisticsBatch(
+    absl::string_view schema_proto_string, const string& environment,
+    const std::vector<absl::string_view>& feature_statistics_proto_strings,
+    const std::vector<absl::string_view>&
+        previous_span_statistics_proto_strings,
+    const std::vector<absl::string_view>& serving_statistics_proto_strings,
+    const std::vector<absl::string_view>&
+        previous_version_statistics_proto_strings,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
+    std::vector<string>* anomalies_proto_strings) {
+  const int num_items = feature_statistics_proto_strings.size();
+  for (const std::vector<absl::string_view>* control_proto_strings :
+       {&previous_span_statistics_proto_strings,
+        &serving_statistics_proto_strings,
+        &previous_version_statistics_proto_strings}) {
+    if (!control_proto_strings->empty() &&
+        control_proto_strings->size() != num_items) {
+      return tensorflow::errors::InvalidArgument(
+          "Expected either no control statistics or one per statistics, got ",
+          control_proto_strings->size(), " for ", num_items, " statistics.");
+    }
+  }
+
+  // The setup (parsing and indexing the schema, parsing the configurations)
+  // is done once, and shared by all the items.
+  tensorflow::metadata::v0::Schema schema_proto;
+  if (!ParseFromStringView(schema_proto_string, &schema_proto)) {
+    return tensorflow::errors::InvalidArgument("Failed to parse Schema proto.");
+  }
+
+  absl::optional<string> may_be_environment;
+  if (!environment.empty()) {
+    may_be_environment = environment;
   }
 
+  absl::optional<FeaturesNeeded> features_needed;
+  TF_RETURN_IF_ERROR(
+      ParseFeaturesNeeded(features_needed_string, &features_needed));
+
   data_validation::ValidationConfig validation_config;
-  if (!validation_config.ParseFromString(validation_config_string)) {
+  if (!ParseFromStringView(validation_config_string, &validation_config)) {
     return tensorflow::errors::InvalidArgument(
         "Failed to parse ValidationConfig");
   }
+  // The items are validated in parallel, so each item uses only one thread.
+  ValidationConfig item_validation_config = validation_config;
+  item_validation_config.clear_num_threads();
+  // Root features with the same statistics (and control statistics) in many
+  // items, e.g., global features in slices, are validated once, and their
+  // anomalies are looked up in this cache for the other items (see
+  // FeatureValidationCache for what the results are keyed by).
+  const Validator validator(
+      schema_proto, may_be_environment, item_validation_config,
+      num_items > 1 ? std::make_shared<InMemoryFeatureValidationCache>()
+                    : nullptr);
+
+  // Returns the control statistics of the i-th item, or "" if there are none.
+  const auto get_control =
+      [](const std::vector<absl::string_view>& proto_strings,
+         int i) -> absl::string_view {
+    return proto_strings.empty() ? absl::string_view() : proto_strings[i];
+  };
+  const auto validate_item = [&](int i) -> tensorflow::Status {
+    return validator.ValidateWithSerializedInputs(
+        feature_statistics_proto_strings[i],
+        get_control(previous_span_statistics_proto_strings, i),
+        get_control(serving_statistics_proto_strings, i),
+        get_control(previous_version_statistics_proto_strings, i),
+        features_needed, enable_diff_regions, &(*anomalies_proto_strings)[i]);
+  };
+
+  anomalies_proto_strings->assign(num_items, string());
+  std::vector<tensorflow::Status> statuses(num_items);
+  if (validation_config.num_threads() > 1 && num_items > 1) {
+    thread::ThreadPool thread_pool(
+        Env::Default(), "validate_batch",
+        std::min(validation_config.num_threads(), num_items));
+    for (int i = 0; i < num_items; ++i) {
+      thread_pool.Schedule([&statuses, &validate_item, i]() {
+        statuses[i] = validate_item(i);
+      });
+    }
+    // The destructor of thread_pool waits for all the scheduled work.
+  } else {
+    for (int i = 0; i < num_items; ++i) {
+      statuses[i] = validate_item(i);
+    }
+  }
+  for (int i = 0; i < num_items; ++i) {
+    if (!statuses[i].ok()) {
+      anomalies_proto_strings->clear();
+      return statuses[i];
+    }
+  }
+  return tensorflow::Status::OK();
+}
+
+tensorflow::Status ValidateFeatureStatisticsList(
+    absl::string_view schema_proto_string, const string& environment,
+    absl::string_view feature_statistics_list_proto_string,
+    absl::string_view previous_span_statistics_list_proto_string,
+    absl::string_view serving_statistics_list_proto_string,
+    absl::string_view previous_version_statistics_list_proto_string,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
+    std::map<string, string>* anomalies_proto_strings) {
+  anomalies_proto_strings->clear();
+  // The slices are not parsed here, only located.
+  std::vector<absl::string_view> slices;
+  std::vector<string> slice_names;
+  TF_RETURN_IF_ERROR(SplitDatasetFeatureStatisticsList(
+      feature_statistics_list_proto_string, &slices, &slice_names));
+  std::map<string, int> slice_indices;
+  for (int i = 0; i < slice_names.size(); ++i) {
+    if (!slice_indices.emplace(slice_names[i], i).second) {
+      return tensorflow::errors::InvalidArgument(
+          "Duplicate slice in DatasetFeatureStatisticsList: ", slice_names[i]);
+    }
+  }
 
-  tensorflow::metadata::v0::Anomalies anomalies;
-  TF_RETURN_IF_ERROR(ValidateFeatureStatistics(
-      feature_statistics, schema, may_be_environment, previous_span_statistics,
-      serving_statistics, previous_version_statistics, features_needed,
-      validation_config, enable_diff_regions, &anomalies));
+  // Gets the control statistics of each slice, by name, or an empty vector if
+  // there are none at all.
+  const auto get_controls =
+      [&](absl::string_view list_proto_string,
+          std::vector<absl::string_view>* controls) -> tensorflow::Status {
+    controls->clear();
+    std::vector<absl::string_view> control_slices;
+    std::vector<string> control_names;
+    TF_RETURN_IF_ERROR(SplitDatasetFeatureStatisticsList(
+        list_proto_string, &control_slices, &control_names));
+    if (control_slices.empty()) {
+      return tensorflow::Status::OK();
+    }
+    controls->resize(slices.size());
+    for (int i = 0; i < control_slices.size(); ++i) {
+      const auto iter = slice_indices.find(control_names[i]);
+      if (iter != slice_indices.end()) {
+        (*controls)[iter->second] = control_slices[i];
+      }
+    }
+    return tensorflow::Status::OK();
+  };
+  std::vector<absl::string_view> previous_span_slices;
+  TF_RETURN_IF_ERROR(get_controls(previous_span_statistics_list_proto_string,
+                                  &previous_span_slices));
+  std::vector<absl::string_view> serving_slices;
+  TF_RETURN_IF_ERROR(
+      get_controls(serving_statistics_list_proto_string, &serving_slices));
+  std::vector<absl::string_view> previous_version_slices;
+  TF_RETURN_IF_ERROR(get_controls(
+      previous_version_statistics_list_proto_string, &previous_version_slices));
 
-  if (!anomalies.SerializeToString(anomalies_proto_string)) {
-    return tensorflow::errors::Internal(
-        "Could not serialize Anomalies output proto to string.");
+  std::vector<string> slice_anomalies;
+  TF_RETURN_IF_ERROR(ValidateFeatureStatisticsBatch(
+      schema_proto_string, environment, slices, previous_span_slices,
+      serving_slices, previous_version_slices, features_needed_string,
+      validation_config_string, enable_diff_regions, &slice_anomalies));
+  for (int i = 0; i < slice_names.size(); ++i) {
+    (*anomalies_proto_strings)[slice_names[i]] = std::move(slice_anomalies[i]);
   }
   return tensorflow::Status::OK();
 }
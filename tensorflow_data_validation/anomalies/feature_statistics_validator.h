@@ -19,15 +19,25 @@ limitations under the License.
 #ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_FEATURE_STATISTICS_VALIDATOR_H_
 #define TENSORFLOW_DATA_VALIDATION_ANOMALIES_FEATURE_STATISTICS_VALIDATOR_H_
 
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
 
+#include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "tensorflow_data_validation/anomalies/features_needed.h"
 #include "tensorflow_data_validation/anomalies/path.h"
 #include "tensorflow_data_validation/anomalies/proto/feature_statistics_to_proto.pb.h"
 #include "tensorflow_data_validation/anomalies/proto/validation_config.pb.h"
+#include "tensorflow_data_validation/anomalies/proto/validation_metadata.pb.h"
+#include "tensorflow_data_validation/anomalies/schema.h"
+#include "tensorflow_data_validation/anomalies/schema_anomalies.h"
+#include "tensorflow_data_validation/anomalies/serialized_output.h"
+#include "tensorflow_data_validation/anomalies/statistics_view_cache.h"
+#include "tensorflow_data_validation/anomalies/validation_deadline.h"
+#include "tensorflow_data_validation/anomalies/validation_result_cache.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/gtl/optional.h"
 #include "tensorflow/core/platform/types.h"
@@ -49,21 +59,68 @@ FeatureStatisticsToProtoConfig GetDefaultFeatureStatisticsToProtoConfig();
 // a string feature in order to be interpreted as a categorical feature.
 // if `infer_feature_shape` is true, then it will try inferring a fixed shape
 // from a feature's statistics.
-Status InferSchema(const string& feature_statistics_proto_string,
+Status InferSchema(absl::string_view feature_statistics_proto_string,
                    int max_string_domain_size, bool infer_feature_shape,
                    string* schema_proto_string);
 
+// Same as above, but if num_threads is greater than 1, the features are
+// inferred in parallel using this many threads. The schema is the same.
+Status InferSchema(absl::string_view feature_statistics_proto_string,
+                   int max_string_domain_size, bool infer_feature_shape,
+                   int num_threads, string* schema_proto_string);
+
+// Same as above, but serializes the schema to schema_output.
+Status InferSchema(absl::string_view feature_statistics_proto_string,
+                   int max_string_domain_size, bool infer_feature_shape,
+                   int num_threads, SerializedOutput* schema_output);
+
 // Updates the input schema to match the data characteristics in the input
 // feature statistics. This method will take as input the serialized input
 // schema proto string, the serialized statistics proto string and will output
 // the serialized updated schema proto string.
 // max_string_domain_size argument refers to the maximum size of the domain of
 // a string feature in order to be interpreted as a categorical feature.
-Status UpdateSchema(const string& schema_proto_string,
-                    const string& feature_statistics_proto_string,
+Status UpdateSchema(absl::string_view schema_proto_string,
+                    absl::string_view feature_statistics_proto_string,
                     const int max_string_domain_size,
                     string* output_schema_proto_string);
 
+// Same as above, but if num_threads is greater than 1, the features are
+// updated in parallel using this many threads. The schema is the same.
+Status UpdateSchema(absl::string_view schema_proto_string,
+                    absl::string_view feature_statistics_proto_string,
+                    int max_string_domain_size, int num_threads,
+                    string* output_schema_proto_string);
+
+// Same as above, but serializes the updated schema to schema_output.
+Status UpdateSchema(absl::string_view schema_proto_string,
+                    absl::string_view feature_statistics_proto_string,
+                    int max_string_domain_size, int num_threads,
+                    SerializedOutput* schema_output);
+
+// Same as UpdateSchema(...) above, but only updates the features whose
+// statistics differ from previous_feature_statistics_proto_string, which are
+// the statistics the schema was last updated with (using the same
+// max_string_domain_size). The other features already match their statistics,
+// so the result is the same as a full update. Features that are not in the
+// schema, features that are in only one of the statistics, and required
+// features of the schema that are in neither, are also updated. If the previous statistics have a different number of examples, or
+// only one of the statistics is weighted, every feature is updated.
+Status UpdateSchemaIncrementally(
+    absl::string_view schema_proto_string,
+    absl::string_view previous_feature_statistics_proto_string,
+    absl::string_view feature_statistics_proto_string,
+    int max_string_domain_size, int num_threads,
+    string* output_schema_proto_string);
+
+// Same as above, but serializes the updated schema to schema_output.
+Status UpdateSchemaIncrementally(
+    absl::string_view schema_proto_string,
+    absl::string_view previous_feature_statistics_proto_string,
+    absl::string_view feature_statistics_proto_string,
+    int max_string_domain_size, int num_threads,
+    SerializedOutput* schema_output);
+
 // Validates the statistics in <feature_statistics> with respect to the
 // <schema_proto> and returns a schema diff proto which captures the
 // changes that need to be made to <schema_proto> to make the statistics
@@ -92,18 +149,483 @@ Status ValidateFeatureStatistics(
     const ValidationConfig& validation_config, bool enable_diff_regions,
     metadata::v0::Anomalies* result);
 
+// Same as above, but if profile is not null, adds the time of each stage of
+// the validation, and the work it did, to profile. The result is the same.
+Status ValidateFeatureStatistics(
+    const metadata::v0::DatasetFeatureStatistics& feature_statistics,
+    const metadata::v0::Schema& schema_proto,
+    const absl::optional<string>& environment,
+    const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+        prev_span_feature_statistics,
+    const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+        serving_feature_statistics,
+    const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+        prev_version_feature_statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    const ValidationConfig& validation_config, bool enable_diff_regions,
+    metadata::v0::Anomalies* result, ValidationProfile* profile);
+
+// Same as above, but if deadline is not null, it is used instead of
+// ValidationConfig.deadline_micros, so that the validation can also be
+// cancelled from another thread. Features not checked before it expires are
+// added to profile.unchecked_feature if profile is not null.
+Status ValidateFeatureStatistics(
+    const metadata::v0::DatasetFeatureStatistics& feature_statistics,
+    const metadata::v0::Schema& schema_proto,
+    const absl::optional<string>& environment,
+    const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+        prev_span_feature_statistics,
+    const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+        serving_feature_statistics,
+    const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+        prev_version_feature_statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    const ValidationConfig& validation_config, bool enable_diff_regions,
+    metadata::v0::Anomalies* result, ValidationProfile* profile,
+    const ValidationDeadline* deadline);
+
 // Similar to the above, but takes all the proto parameters as serialized
 // strings. This method is called by the Python code using PyBind11.
 Status ValidateFeatureStatisticsWithSerializedInputs(
-    const string& feature_statistics_proto_string,
-    const string& schema_proto_string, const string& environment,
-    const string& previous_span_statistics_proto_string,
-    const string& serving_statistics_proto_string,
-    const string& previous_version_statistics_proto_string,
-    const string& features_needed_string,
-    const string& validation_config_string, const bool enable_diff_regions,
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view schema_proto_string, const string& environment,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
+    string* anomalies_proto_string);
+
+// Same as above, but if profile is not null, adds the time of each stage of
+// the validation (including parsing and serializing), and the work it did, to
+// profile. If the result is found in the cache (see below), only the
+// "cache_lookup" stage is added.
+Status ValidateFeatureStatisticsWithSerializedInputs(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view schema_proto_string, const string& environment,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
+    string* anomalies_proto_string, ValidationProfile* profile);
+
+// Same as above, but serializes the anomalies to anomalies_output.
+Status ValidateFeatureStatisticsWithSerializedInputs(
+    absl::string_view feature_statistics_proto_string,
+    absl::string_view schema_proto_string, const string& environment,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
+    SerializedOutput* anomalies_output, ValidationProfile* profile);
+
+// Same as ValidateFeatureStatisticsWithSerializedInputs(...), but reads the
+// serialized statistics and schema from the files at the given paths (an empty
+// path meaning the input is absent, except for feature_statistics_path). The
+// files are mapped in memory and parsed directly from the mapping, so they are
+// never copied (and never pass through the Python heap when called from
+// Python).
+Status ValidateFeatureStatisticsFromFiles(
+    const string& feature_statistics_path, const string& schema_path,
+    const string& environment, const string& previous_span_statistics_path,
+    const string& serving_statistics_path,
+    const string& previous_version_statistics_path,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
     string* anomalies_proto_string);
 
+// Same as above, but serializes the anomalies to anomalies_output, and if
+// profile is not null, adds the time of each stage of the validation to it
+// (including mapping the files, as the "map_files" stage).
+Status ValidateFeatureStatisticsFromFiles(
+    const string& feature_statistics_path, const string& schema_path,
+    const string& environment, const string& previous_span_statistics_path,
+    const string& serving_statistics_path,
+    const string& previous_version_statistics_path,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
+    SerializedOutput* anomalies_output, ValidationProfile* profile);
+
+// Sets the cache of the results of
+// ValidateFeatureStatisticsWithSerializedInputs(...). If cache is not null,
+// the result of a call is looked up in cache, by a fingerprint of all its
+// inputs, and returned without parsing the inputs if it is found. Otherwise,
+// the result is added to cache, unless the deadline of the validation (see
+// ValidationConfig.deadline_micros) expired, as only some of the features may
+// have been checked. A null cache (the default) disables caching.
+void SetValidationResultCache(std::shared_ptr<ValidationResultCache> cache);
+
+// Gets the cache set by SetValidationResultCache(...), which may be null.
+std::shared_ptr<ValidationResultCache> GetValidationResultCache();
+
+// Validates many statistics against the same schema. This is equivalent to
+// calling ValidateFeatureStatisticsWithSerializedInputs(...) once for each of
+// feature_statistics_proto_strings, but the schema and the configs are parsed
+// and prepared only once. Each of the control statistics vectors must be
+// either empty or of the same size as feature_statistics_proto_strings; an
+// empty string means that item has no such control statistics. If
+// validation_config.num_threads is greater than 1, the items are validated in
+// parallel. The root features whose statistics (and control statistics) are
+// the same in many items with the same numbers of examples are only validated
+// once. On success, the i-th element of anomalies_proto_strings holds the
+// serialized anomalies of the i-th statistics. Otherwise, the error of the
+// first item that failed is returned.
+Status ValidateFeatureStatisticsBatch(
+    absl::string_view schema_proto_string, const string& environment,
+    const std::vector<absl::string_view>& feature_statistics_proto_strings,
+    const std::vector<absl::string_view>&
+        previous_span_statistics_proto_strings,
+    const std::vector<absl::string_view>& serving_statistics_proto_strings,
+    const std::vector<absl::string_view>&
+        previous_version_statistics_proto_strings,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
+    std::vector<string>* anomalies_proto_strings);
+
+// Validates each dataset (e.g., slice) of a serialized
+// DatasetFeatureStatisticsList against the same schema, like
+// ValidateFeatureStatisticsBatch(...): the schema and the configs are prepared
+// once for all the slices (so that, e.g., the string domains of the schema are
+// only indexed once), and the slices are validated in parallel if
+// validation_config.num_threads is greater than 1. The slices are not copied
+// out of feature_statistics_list_proto_string. Each of the control statistics
+// is either empty or a serialized DatasetFeatureStatisticsList, whose datasets
+// are the control statistics of the slices with the same names. On success,
+// anomalies_proto_strings maps the name of each slice to its serialized
+// anomalies. The slices must have distinct names.
+Status ValidateFeatureStatisticsList(
+    absl::string_view schema_proto_string, const string& environment,
+    absl::string_view feature_statistics_list_proto_string,
+    absl::string_view previous_span_statistics_list_proto_string,
+    absl::string_view serving_statistics_list_proto_string,
+    absl::string_view previous_version_statistics_list_proto_string,
+    absl::string_view features_needed_string,
+    absl::string_view validation_config_string, const bool enable_diff_regions,
+    std::map<string, string>* anomalies_proto_strings);
+
+// Computes the drift of the statistics in <feature_statistics> against each of
+// <prev_span_feature_statistics> (e.g., the previous spans of a window), for
+// the drift comparators in <schema_proto>. The features are traversed once:
+// each feature with a drift comparator is compared with all the previous
+// spans, and its side of the comparisons is prepared only once. On success,
+// the i-th element of results holds the drift_skew_info of the features
+// against the i-th previous span, with one measurement per threshold of the
+// comparator. Nothing else is set in the results, and the comparators are not
+// updated. A feature that is missing from a previous span is not measured
+// against it.
+Status ComputeDriftAgainstPreviousSpans(
+    const metadata::v0::DatasetFeatureStatistics& feature_statistics,
+    const metadata::v0::Schema& schema_proto,
+    const std::vector<metadata::v0::DatasetFeatureStatistics>&
+        prev_span_feature_statistics,
+    std::vector<metadata::v0::Anomalies>* results);
+
+// Computes the drift of the statistics in <feature_statistics> against the
+// average distributions of the previous spans kept in <state>, for the drift
+// comparators in <schema_proto>, and then adds the statistics to <state> as
+// its most recent span (see UpdateRollingDriftState()). Unlike
+// ComputeDriftAgainstPreviousSpans(...), this takes time proportional to the
+// size of one span, so that <state> can hold a long window. On success,
+// result holds the drift_skew_info of the features, as in
+// ComputeDriftAgainstPreviousSpans(...). <state> may be reused with the
+// statistics of the next span once serialized and parsed back.
+Status ComputeDriftAgainstRollingState(
+    const metadata::v0::DatasetFeatureStatistics& feature_statistics,
+    const metadata::v0::Schema& schema_proto, RollingDriftState* state,
+    metadata::v0::Anomalies* result);
+
+// Validates statistics against a fixed schema, environment and
+// ValidationConfig. The schema is indexed and the config is compiled once, when
+// the Validator is created, so that a Validator can be reused for many
+// statistics. Validate(...) is thread-safe.
+class Validator {
+ public:
+  // Creates a validator from a serialized schema and a serialized
+  // ValidationConfig. If environment is empty, all the features are validated.
+  static Status Create(absl::string_view schema_proto_string,
+                       const string& environment,
+                       absl::string_view validation_config_string,
+                       std::unique_ptr<Validator>* result);
+
+  // Same as above, but reads the schema from the schema snapshot at
+  // schema_snapshot_path (see WriteSchemaSnapshot()), which is faster than
+  // parsing a serialized schema.
+  static Status CreateFromSchemaSnapshot(
+      const string& schema_snapshot_path, const string& environment,
+      absl::string_view validation_config_string,
+      std::unique_ptr<Validator>* result);
+
+  Validator(const metadata::v0::Schema& schema_proto,
+            const absl::optional<string>& environment,
+            const ValidationConfig& validation_config);
+
+  // Same as above, but validates incrementally: the anomalies of the features
+  // are looked up in cache, which may be shared by many validators (see
+  // SchemaAnomalies::FindChanges()).
+  Validator(const metadata::v0::Schema& schema_proto,
+            const absl::optional<string>& environment,
+            const ValidationConfig& validation_config,
+            std::shared_ptr<FeatureValidationCache> cache);
+
+  // Same as above, but with an indexed schema, which may be shared by many
+  // validators.
+  Validator(std::shared_ptr<const IndexedSchema> schema,
+            const absl::optional<string>& environment,
+            const ValidationConfig& validation_config,
+            std::shared_ptr<FeatureValidationCache> cache);
+
+  // Equivalent to ValidateFeatureStatistics(...) with the schema, environment
+  // and validation config of this validator.
+  Status Validate(
+      const metadata::v0::DatasetFeatureStatistics& feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          prev_span_feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          serving_feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          prev_version_feature_statistics,
+      const absl::optional<FeaturesNeeded>& features_needed,
+      bool enable_diff_regions, metadata::v0::Anomalies* result) const;
+
+  // Same as above, but if profile is not null, adds the time of each stage of
+  // the validation, and the work it did, to profile.
+  Status Validate(
+      const metadata::v0::DatasetFeatureStatistics& feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          prev_span_feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          serving_feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          prev_version_feature_statistics,
+      const absl::optional<FeaturesNeeded>& features_needed,
+      bool enable_diff_regions, metadata::v0::Anomalies* result,
+      ValidationProfile* profile) const;
+
+  // Same as above, but if deadline is not null, it is used instead of
+  // ValidationConfig.deadline_micros (see ValidateFeatureStatistics(...)).
+  Status Validate(
+      const metadata::v0::DatasetFeatureStatistics& feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          prev_span_feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          serving_feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          prev_version_feature_statistics,
+      const absl::optional<FeaturesNeeded>& features_needed,
+      bool enable_diff_regions, metadata::v0::Anomalies* result,
+      ValidationProfile* profile, const ValidationDeadline* deadline) const;
+
+  // Same as Validate(...), but validates against each of environments
+  // (absl::nullopt meaning no environment) instead of the environment of this
+  // validator. On success, the i-th element of results holds the anomalies in
+  // the i-th environment. Otherwise, the error of the first environment that
+  // failed is returned. The statistics are viewed and traversed once per
+  // environment, but the anomalies of a root feature only depend on the
+  // environment if it (or one of its descendants) is not in the environment,
+  // so the anomalies of the other root features are found once and shared by
+  // all the environments (through the cache of this validator, if any).
+  Status ValidateInEnvironments(
+      const metadata::v0::DatasetFeatureStatistics& feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          prev_span_feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          serving_feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          prev_version_feature_statistics,
+      const absl::optional<FeaturesNeeded>& features_needed,
+      const std::vector<absl::optional<string>>& environments,
+      bool enable_diff_regions,
+      std::vector<metadata::v0::Anomalies>* results) const;
+
+  // Similar to the above, but takes all the proto parameters as serialized
+  // strings, which are parsed once for all the environments, and serializes
+  // the results (like ValidateWithSerializedInputs(...)). An empty
+  // environment means no environment.
+  Status ValidateInEnvironmentsWithSerializedInputs(
+      absl::string_view feature_statistics_proto_string,
+      absl::string_view previous_span_statistics_proto_string,
+      absl::string_view serving_statistics_proto_string,
+      absl::string_view previous_version_statistics_proto_string,
+      absl::string_view features_needed_string,
+      const std::vector<string>& environments, bool enable_diff_regions,
+      std::vector<string>* anomalies_proto_strings) const;
+
+  // Same as Validate(...), but validates both the unweighted and the weighted
+  // statistics: on success, unweighted_result and weighted_result hold the
+  // anomalies with the statistics viewed without weights and by weight. If
+  // there are no weighted statistics, both are the anomalies without weights.
+  // The statistics are viewed and traversed once per mode, but the anomalies
+  // of a root feature only depend on the weights if the schema checks its
+  // weighted counts or distributions (e.g., its presence, string domain or
+  // comparators), so the anomalies of the other root features (e.g., with
+  // only type, value count and numeric range checks) are found once and
+  // shared by both modes (through the cache of this validator, if any).
+  Status ValidateWithAndWithoutWeights(
+      const metadata::v0::DatasetFeatureStatistics& feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          prev_span_feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          serving_feature_statistics,
+      const absl::optional<metadata::v0::DatasetFeatureStatistics>&
+          prev_version_feature_statistics,
+      const absl::optional<FeaturesNeeded>& features_needed,
+      bool enable_diff_regions, metadata::v0::Anomalies* unweighted_result,
+      metadata::v0::Anomalies* weighted_result) const;
+
+  // Similar to ValidateWithSerializedInputs(...), but the statistics are given
+  // as serialized shards of the same dataset, which are parsed and merged
+  // (see MergeDatasetFeatureStatistics(...)) with the threads of this
+  // validator. The merged statistics are validated without being serialized
+  // again.
+  Status ValidateShardsWithSerializedInputs(
+      const std::vector<absl::string_view>& shard_proto_strings,
+      absl::string_view previous_span_statistics_proto_string,
+      absl::string_view serving_statistics_proto_string,
+      absl::string_view previous_version_statistics_proto_string,
+      absl::string_view features_needed_string, bool enable_diff_regions,
+      string* anomalies_proto_string) const;
+
+  // Equivalent to ComputeDriftAgainstPreviousSpans(...) with the schema of
+  // this validator.
+  Status ComputeDrift(
+      const metadata::v0::DatasetFeatureStatistics& feature_statistics,
+      const std::vector<metadata::v0::DatasetFeatureStatistics>&
+          prev_span_feature_statistics,
+      std::vector<metadata::v0::Anomalies>* results) const;
+
+  // Equivalent to ComputeDriftAgainstRollingState(...) with the schema of this
+  // validator.
+  Status ComputeRollingDrift(
+      const metadata::v0::DatasetFeatureStatistics& feature_statistics,
+      RollingDriftState* state, metadata::v0::Anomalies* result) const;
+
+  // Similar to ComputeDrift(...), but takes the statistics as serialized
+  // strings, and serializes the results. Only the features with drift
+  // comparators are parsed from the previous spans.
+  Status ComputeDriftWithSerializedInputs(
+      absl::string_view feature_statistics_proto_string,
+      const std::vector<absl::string_view>&
+          previous_span_statistics_proto_strings,
+      std::vector<string>* anomalies_proto_strings) const;
+
+  // Similar to the above, but takes all the proto parameters as serialized
+  // strings. An empty string means the corresponding input is absent. If the
+  // validation config has delta_encoded_anomalies, the result is a serialized
+  // AnomaliesDelta instead of a serialized Anomalies.
+  Status ValidateWithSerializedInputs(
+      absl::string_view feature_statistics_proto_string,
+      absl::string_view previous_span_statistics_proto_string,
+      absl::string_view serving_statistics_proto_string,
+      absl::string_view previous_version_statistics_proto_string,
+      absl::string_view features_needed_string, bool enable_diff_regions,
+      string* anomalies_proto_string) const;
+
+  // Same as above, but if profile is not null, adds the time of each stage of
+  // the validation, and the work it did, to profile.
+  Status ValidateWithSerializedInputs(
+      absl::string_view feature_statistics_proto_string,
+      absl::string_view previous_span_statistics_proto_string,
+      absl::string_view serving_statistics_proto_string,
+      absl::string_view previous_version_statistics_proto_string,
+      absl::string_view features_needed_string, bool enable_diff_regions,
+      string* anomalies_proto_string, ValidationProfile* profile) const;
+
+  // Same as above, but serializes the anomalies to anomalies_output.
+  Status ValidateWithSerializedInputs(
+      absl::string_view feature_statistics_proto_string,
+      absl::string_view previous_span_statistics_proto_string,
+      absl::string_view serving_statistics_proto_string,
+      absl::string_view previous_version_statistics_proto_string,
+      absl::string_view features_needed_string, bool enable_diff_regions,
+      SerializedOutput* anomalies_output, ValidationProfile* profile) const;
+
+  // Same as above, but if deadline is not null, it is used instead of
+  // ValidationConfig.deadline_micros (see ValidateFeatureStatistics(...)),
+  // e.g., to cancel the validation from another thread.
+  Status ValidateWithSerializedInputs(
+      absl::string_view feature_statistics_proto_string,
+      absl::string_view previous_span_statistics_proto_string,
+      absl::string_view serving_statistics_proto_string,
+      absl::string_view previous_version_statistics_proto_string,
+      absl::string_view features_needed_string, bool enable_diff_regions,
+      SerializedOutput* anomalies_output, ValidationProfile* profile,
+      const ValidationDeadline* deadline) const;
+
+  // Same as above, but with features_needed already parsed. All the parsed
+  // statistics and the result are allocated on one arena per call. If
+  // features_needed is set, the statistics of each feature in
+  // feature_statistics_proto_string are only parsed if they are accessed.
+  Status ValidateWithSerializedInputs(
+      absl::string_view feature_statistics_proto_string,
+      absl::string_view previous_span_statistics_proto_string,
+      absl::string_view serving_statistics_proto_string,
+      absl::string_view previous_version_statistics_proto_string,
+      const absl::optional<FeaturesNeeded>& features_needed,
+      bool enable_diff_regions, string* anomalies_proto_string) const;
+
+  // Same as above, but passes the anomalies to sink as soon as they are known
+  // (see SchemaAnomalies::FindChanges()), instead of serializing them all
+  // together. If there are no examples, only sink->OnDataMissing() is called.
+  Status ValidateWithSerializedInputs(
+      absl::string_view feature_statistics_proto_string,
+      absl::string_view previous_span_statistics_proto_string,
+      absl::string_view serving_statistics_proto_string,
+      absl::string_view previous_version_statistics_proto_string,
+      absl::string_view features_needed_string, bool enable_diff_regions,
+      AnomaliesSink* sink) const;
+
+  // Same as above, but with features_needed already parsed.
+  Status ValidateWithSerializedInputs(
+      absl::string_view feature_statistics_proto_string,
+      absl::string_view previous_span_statistics_proto_string,
+      absl::string_view serving_statistics_proto_string,
+      absl::string_view previous_version_statistics_proto_string,
+      const absl::optional<FeaturesNeeded>& features_needed,
+      bool enable_diff_regions, AnomaliesSink* sink) const;
+
+  // See ValidationConfig.deadline_micros.
+  int64 deadline_micros() const { return deadline_micros_; }
+
+ private:
+  // Implements ValidateWithSerializedInputs(...): if sink is not null, the
+  // anomalies are passed to it. Otherwise, they are serialized to
+  // anomalies_output. profile may be null. If deadline is null, the validation
+  // gets the deadline of ValidationConfig.deadline_micros, if any.
+  Status ValidateSerializedStatistics(
+      absl::string_view feature_statistics_proto_string,
+      absl::string_view previous_span_statistics_proto_string,
+      absl::string_view serving_statistics_proto_string,
+      absl::string_view previous_version_statistics_proto_string,
+      const absl::optional<FeaturesNeeded>& features_needed,
+      bool enable_diff_regions, AnomaliesSink* sink,
+      SerializedOutput* anomalies_output, ValidationProfile* profile,
+      const ValidationDeadline* deadline) const;
+
+  // The schema to validate against, indexed once.
+  const std::shared_ptr<const IndexedSchema> schema_;
+  const absl::optional<string> environment_;
+  // Created from the validation config (including its severity overrides).
+  const Schema::Updater updater_;
+  const int num_threads_;
+  // See ValidationConfig.num_slowest_features_profiled.
+  const int num_slowest_features_profiled_;
+  // See ValidationConfig.memory_budget_bytes.
+  const int64 memory_budget_bytes_;
+  // See ValidationConfig.delta_encoded_anomalies.
+  const bool delta_encoded_anomalies_;
+  // See ValidationConfig.max_anomalies.
+  const int max_anomalies_;
+  // See ValidationConfig.deadline_micros.
+  const int64 deadline_micros_;
+  // If not null, used for incremental validation.
+  const std::shared_ptr<FeatureValidationCache> cache_;
+  // If not null, the statistics validated recently (see
+  // ValidationConfig.max_cached_statistics).
+  const std::shared_ptr<StatisticsViewCache> view_cache_;
+};
+
 // Updates an existing schema to match the data characteristics in
 // <feature_statistics>, but only on the paths_to_consider.
 // An empty schema_to_update is a valid input schema.
@@ -0,0 +1,347 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// End-to-end benchmarks of the validation of statistics, and of the inference
+// and the update of schemas, on synthetic statistics.
+// Run with --benchmarks=all.
+
+#include "tensorflow_data_validation/anomalies/feature_statistics_validator.h"
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "tensorflow_data_validation/anomalies/allocation_counter.h"
+#include "tensorflow_data_validation/anomalies/proto/validation_config.pb.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/anomalies.pb.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+#include "tensorflow_metadata/proto/v0/statistics.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::Anomalies;
+using ::tensorflow::metadata::v0::CommonStatistics;
+using ::tensorflow::metadata::v0::DatasetFeatureStatistics;
+using ::tensorflow::metadata::v0::Feature;
+using ::tensorflow::metadata::v0::FeatureNameStatistics;
+using ::tensorflow::metadata::v0::Histogram;
+using ::tensorflow::metadata::v0::Path;
+using ::tensorflow::metadata::v0::Schema;
+using ::tensorflow::protobuf::RepeatedPtrField;
+
+// The number of leaf features under each (chain of) structs.
+constexpr int kFeaturesPerStruct = 10;
+
+// The parameters of synthetic statistics.
+struct SyntheticStatisticsOptions {
+  // The number of features that are not structs. One third of them are INT,
+  // one third FLOAT and one third STRING.
+  int num_features = 1000;
+  // The number of nested structs above each feature that is not a struct.
+  int depth = 0;
+  // The number of values of each STRING feature.
+  int vocabulary_size = 10;
+  // The number of buckets of each histogram of an INT or FLOAT feature.
+  int num_buckets = 10;
+  // Shifts the distributions of the features, and the values of the STRING
+  // features, so that the statistics of a control dataset differ.
+  int offset = 0;
+};
+
+void SetCommonStatistics(int64 num_examples, CommonStatistics* common_stats) {
+  common_stats->set_num_non_missing(num_examples);
+  common_stats->set_min_num_values(1);
+  common_stats->set_max_num_values(1);
+  common_stats->set_avg_num_values(1);
+  common_stats->set_tot_num_values(num_examples);
+}
+
+void AddHistogram(const SyntheticStatisticsOptions& options,
+                  int64 num_examples, Histogram::HistogramType type,
+                  Histogram* histogram) {
+  histogram->set_type(type);
+  for (int i = 0; i < options.num_buckets; ++i) {
+    Histogram::Bucket* bucket = histogram->add_buckets();
+    bucket->set_low_value(options.offset + i);
+    bucket->set_high_value(options.offset + i + 1);
+    bucket->set_sample_count(
+        type == Histogram::QUANTILES
+            ? static_cast<double>(num_examples) / options.num_buckets
+            : 1 + (i + options.offset) % 7);
+  }
+}
+
+// Gets synthetic statistics, whose features have paths. Each struct of depth
+// 1 has a chain of options.depth - 1 nested structs, the last of which has
+// kFeaturesPerStruct features.
+DatasetFeatureStatistics GetSyntheticStatistics(
+    const SyntheticStatisticsOptions& options) {
+  DatasetFeatureStatistics statistics;
+  const int64 num_examples = 1000 + options.offset;
+  statistics.set_num_examples(num_examples);
+  Path parent;
+  for (int i = 0; i < options.num_features; ++i) {
+    if (options.depth > 0 && i % kFeaturesPerStruct == 0) {
+      parent.Clear();
+      for (int level = 0; level < options.depth; ++level) {
+        parent.add_step(absl::StrCat("struct_", i, "_", level));
+        FeatureNameStatistics* feature = statistics.add_features();
+        *feature->mutable_path() = parent;
+        feature->set_type(FeatureNameStatistics::STRUCT);
+        SetCommonStatistics(
+            num_examples,
+            feature->mutable_struct_stats()->mutable_common_stats());
+      }
+    }
+    FeatureNameStatistics* feature = statistics.add_features();
+    *feature->mutable_path() = parent;
+    feature->mutable_path()->add_step(absl::StrCat("feature_", i));
+    switch (i % 3) {
+      case 0:
+      case 1: {
+        feature->set_type(i % 3 == 0 ? FeatureNameStatistics::INT
+                                     : FeatureNameStatistics::FLOAT);
+        auto* num_stats = feature->mutable_num_stats();
+        SetCommonStatistics(num_examples, num_stats->mutable_common_stats());
+        num_stats->set_min(options.offset);
+        num_stats->set_max(options.offset + options.num_buckets);
+        num_stats->set_mean(options.offset + options.num_buckets / 2.0);
+        num_stats->set_std_dev(options.num_buckets / 4.0);
+        AddHistogram(options, num_examples, Histogram::STANDARD,
+                     num_stats->add_histograms());
+        AddHistogram(options, num_examples, Histogram::QUANTILES,
+                     num_stats->add_histograms());
+        break;
+      }
+      default: {
+        feature->set_type(FeatureNameStatistics::STRING);
+        auto* string_stats = feature->mutable_string_stats();
+        SetCommonStatistics(num_examples,
+                            string_stats->mutable_common_stats());
+        string_stats->set_unique(options.vocabulary_size);
+        string_stats->set_avg_length(8);
+        auto* rank_histogram = string_stats->mutable_rank_histogram();
+        for (int j = 0; j < options.vocabulary_size; ++j) {
+          auto* bucket = rank_histogram->add_buckets();
+          bucket->set_low_rank(j);
+          bucket->set_high_rank(j);
+          bucket->set_label(absl::StrCat("value_", j + options.offset));
+          bucket->set_sample_count(1 + (j + options.offset) % 7);
+        }
+        break;
+      }
+    }
+  }
+  return statistics;
+}
+
+// Adds drift and skew comparators to feature.
+void AddComparators(Feature* feature) {
+  if (feature->type() == metadata::v0::BYTES) {
+    feature->mutable_drift_comparator()->mutable_infinity_norm()->set_threshold(
+        0.01);
+    feature->mutable_skew_comparator()->mutable_infinity_norm()->set_threshold(
+        0.01);
+  } else {
+    feature->mutable_drift_comparator()
+        ->mutable_jensen_shannon_divergence()
+        ->set_threshold(0.01);
+    feature->mutable_skew_comparator()
+        ->mutable_jensen_shannon_divergence()
+        ->set_threshold(0.01);
+  }
+}
+
+// Gets a schema that matches GetSyntheticStatistics(options) for an offset of
+// 0. The STRING features have string domains of all their values. If
+// with_comparators, the features that are not structs have drift and skew
+// comparators, and the number of examples has drift and version comparators.
+Schema GetSyntheticSchema(const SyntheticStatisticsOptions& options,
+                          bool with_comparators) {
+  Schema schema;
+  RepeatedPtrField<Feature>* parent = schema.mutable_feature();
+  for (int i = 0; i < options.num_features; ++i) {
+    if (options.depth > 0 && i % kFeaturesPerStruct == 0) {
+      parent = schema.mutable_feature();
+      for (int level = 0; level < options.depth; ++level) {
+        Feature* feature = parent->Add();
+        feature->set_name(absl::StrCat("struct_", i, "_", level));
+        feature->set_type(metadata::v0::STRUCT);
+        feature->mutable_presence()->set_min_count(1);
+        parent = feature->mutable_struct_domain()->mutable_feature();
+      }
+    }
+    Feature* feature = parent->Add();
+    feature->set_name(absl::StrCat("feature_", i));
+    feature->mutable_presence()->set_min_fraction(1);
+    feature->mutable_presence()->set_min_count(1);
+    feature->mutable_value_count()->set_min(1);
+    feature->mutable_value_count()->set_max(1);
+    switch (i % 3) {
+      case 0:
+        feature->set_type(metadata::v0::INT);
+        break;
+      case 1:
+        feature->set_type(metadata::v0::FLOAT);
+        break;
+      default: {
+        feature->set_type(metadata::v0::BYTES);
+        feature->set_domain(feature->name());
+        metadata::v0::StringDomain* string_domain = schema.add_string_domain();
+        string_domain->set_name(feature->name());
+        for (int j = 0; j < options.vocabulary_size; ++j) {
+          string_domain->add_value(absl::StrCat("value_", j));
+        }
+        break;
+      }
+    }
+    if (with_comparators) {
+      AddComparators(feature);
+    }
+  }
+  if (with_comparators) {
+    schema.mutable_dataset_constraints()
+        ->mutable_num_examples_drift_comparator()
+        ->set_max_fraction_threshold(1.5);
+    schema.mutable_dataset_constraints()
+        ->mutable_num_examples_version_comparator()
+        ->set_max_fraction_threshold(1.5);
+  }
+  return schema;
+}
+
+// Validates statistics generated with the options against the matching
+// schema. If with_controls, the schema has comparators, and the statistics
+// are compared to those of a previous span, of serving and of a previous
+// version, which are generated with other offsets.
+void RunValidateFeatureStatistics(int iters,
+                                  const SyntheticStatisticsOptions& options,
+                                  bool with_controls) {
+  ::tensorflow::testing::StopTiming();
+  const DatasetFeatureStatistics statistics = GetSyntheticStatistics(options);
+  const Schema schema = GetSyntheticSchema(options, with_controls);
+  absl::optional<DatasetFeatureStatistics> previous_span;
+  absl::optional<DatasetFeatureStatistics> serving;
+  absl::optional<DatasetFeatureStatistics> previous_version;
+  if (with_controls) {
+    SyntheticStatisticsOptions control_options = options;
+    control_options.offset = 1;
+    previous_span = GetSyntheticStatistics(control_options);
+    control_options.offset = 2;
+    serving = GetSyntheticStatistics(control_options);
+    control_options.offset = 3;
+    previous_version = GetSyntheticStatistics(control_options);
+  }
+  const ValidationConfig validation_config;
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    Anomalies anomalies;
+    TF_CHECK_OK(ValidateFeatureStatistics(
+        statistics, schema, /*environment=*/absl::nullopt, previous_span,
+        serving, previous_version, /*features_needed=*/absl::nullopt,
+        validation_config, /*enable_diff_regions=*/false, &anomalies));
+  }
+  SetAllocationLabel(start, iters);
+}
+
+void BM_ValidateFeatureStatistics(int iters, int num_features) {
+  SyntheticStatisticsOptions options;
+  options.num_features = num_features;
+  RunValidateFeatureStatistics(iters, options, /*with_controls=*/false);
+}
+BENCHMARK(BM_ValidateFeatureStatistics)->Arg(1000)->Arg(10000)->Arg(200000);
+
+void BM_ValidateFeatureStatisticsWithControls(int iters, int num_features) {
+  SyntheticStatisticsOptions options;
+  options.num_features = num_features;
+  RunValidateFeatureStatistics(iters, options, /*with_controls=*/true);
+}
+BENCHMARK(BM_ValidateFeatureStatisticsWithControls)
+    ->Arg(1000)
+    ->Arg(10000)
+    ->Arg(200000);
+
+void BM_ValidateFeatureStatisticsNested(int iters, int depth) {
+  SyntheticStatisticsOptions options;
+  options.num_features = 10000;
+  options.depth = depth;
+  RunValidateFeatureStatistics(iters, options, /*with_controls=*/false);
+}
+BENCHMARK(BM_ValidateFeatureStatisticsNested)->Arg(1)->Arg(4)->Arg(16);
+
+void BM_ValidateFeatureStatisticsVocabulary(int iters, int vocabulary_size) {
+  SyntheticStatisticsOptions options;
+  options.vocabulary_size = vocabulary_size;
+  RunValidateFeatureStatistics(iters, options, /*with_controls=*/true);
+}
+BENCHMARK(BM_ValidateFeatureStatisticsVocabulary)->Range(10, 10000);
+
+void BM_ValidateFeatureStatisticsBuckets(int iters, int num_buckets) {
+  SyntheticStatisticsOptions options;
+  options.num_buckets = num_buckets;
+  RunValidateFeatureStatistics(iters, options, /*with_controls=*/true);
+}
+BENCHMARK(BM_ValidateFeatureStatisticsBuckets)->Range(10, 1000);
+
+// Infers a schema from serialized statistics, as the Python API does.
+void BM_InferSchema(int iters, int num_features) {
+  ::tensorflow::testing::StopTiming();
+  SyntheticStatisticsOptions options;
+  options.num_features = num_features;
+  const string statistics = GetSyntheticStatistics(options).SerializeAsString();
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    string schema;
+    TF_CHECK_OK(InferSchema(statistics, /*max_string_domain_size=*/100,
+                            /*infer_feature_shape=*/true, &schema));
+  }
+  SetAllocationLabel(start, iters);
+}
+BENCHMARK(BM_InferSchema)->Arg(1000)->Arg(10000);
+
+// Updates a schema with serialized statistics whose STRING features have new
+// values, as the Python API does.
+void BM_UpdateSchema(int iters, int num_features) {
+  ::tensorflow::testing::StopTiming();
+  SyntheticStatisticsOptions options;
+  options.num_features = num_features;
+  const string schema =
+      GetSyntheticSchema(options, /*with_comparators=*/false)
+          .SerializeAsString();
+  options.offset = 5;
+  const string statistics = GetSyntheticStatistics(options).SerializeAsString();
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    string updated_schema;
+    TF_CHECK_OK(UpdateSchema(schema, statistics,
+                             /*max_string_domain_size=*/100, &updated_schema));
+  }
+  SetAllocationLabel(start, iters);
+}
+BENCHMARK(BM_UpdateSchema)->Arg(1000)->Arg(10000);
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -16,13 +16,25 @@ limitations under the License.
 #include "tensorflow_data_validation/anomalies/feature_statistics_validator.h"
 
 #include <map>
+#include <memory>
+#include <set>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "tensorflow_data_validation/anomalies/path.h"
 #include "tensorflow_data_validation/anomalies/proto/validation_config.pb.h"
+#include "tensorflow_data_validation/anomalies/schema_snapshot.h"
 #include "tensorflow_data_validation/anomalies/test_util.h"
+#include "tensorflow_data_validation/anomalies/validation_deadline.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_metadata/proto/v0/anomalies.pb.h"
 #include "tensorflow_metadata/proto/v0/schema.pb.h"
@@ -34,9 +46,11 @@ namespace {
 
 using ::tensorflow::metadata::v0::AnomalyInfo;
 using ::tensorflow::metadata::v0::DatasetFeatureStatistics;
+using ::tensorflow::metadata::v0::DatasetFeatureStatisticsList;
 using ::tensorflow::metadata::v0::Schema;
 using ::tensorflow::metadata::v0::DriftSkewInfo;
 using testing::EqualsProto;
+using testing::ExpectSameAnomalies;
 using testing::ParseTextProtoOrDie;
 
 void TestSchemaUpdate(const ValidationConfig& config,
@@ -532,6 +546,147 @@ TEST(FeatureStatisticsValidatorTest, UpdateSchemaWithColumnsToConsider) {
   EXPECT_THAT(got, EqualsProto(want));
 }
 
+TEST(FeatureStatisticsValidatorTest, UpdateSchemaIncrementally) {
+  const DatasetFeatureStatistics previous_statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'same'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        }
+        features: {
+          name: 'changed'
+          type: STRING
+          string_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+            unique: 1
+            rank_histogram: { buckets: { label: "A" sample_count: 10 } }
+          }
+        }
+        features: {
+          name: 'dropped'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'same'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        }
+        features: {
+          name: 'changed'
+          type: STRING
+          string_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+            unique: 2
+            rank_histogram: {
+              buckets: { label: "A" sample_count: 5 }
+              buckets: { label: "B" sample_count: 5 }
+            }
+          }
+        }
+        features: {
+          name: 'new'
+          type: FLOAT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })");
+  string schema;
+  TF_ASSERT_OK(InferSchema(previous_statistics.SerializeAsString(),
+                           /*max_string_domain_size=*/10,
+                           /*infer_feature_shape=*/true, &schema));
+
+  string full_update;
+  TF_ASSERT_OK(UpdateSchema(schema, statistics.SerializeAsString(),
+                            /*max_string_domain_size=*/10, &full_update));
+  string incremental_update;
+  TF_ASSERT_OK(UpdateSchemaIncrementally(
+      schema, previous_statistics.SerializeAsString(),
+      statistics.SerializeAsString(), /*max_string_domain_size=*/10,
+      /*num_threads=*/1, &incremental_update));
+  Schema want;
+  ASSERT_TRUE(want.ParseFromString(full_update));
+  Schema got;
+  ASSERT_TRUE(got.ParseFromString(incremental_update));
+  EXPECT_THAT(got, EqualsProto(want));
+  EXPECT_NE(full_update, schema);
+
+  // Features whose statistics did not change are not updated, even if they do
+  // not match the schema.
+  Schema stale;
+  ASSERT_TRUE(stale.ParseFromString(schema));
+  stale.mutable_feature(0)->set_type(tensorflow::metadata::v0::BYTES);
+  string update;
+  TF_ASSERT_OK(UpdateSchemaIncrementally(
+      stale.SerializeAsString(), previous_statistics.SerializeAsString(),
+      previous_statistics.SerializeAsString(), /*max_string_domain_size=*/10,
+      /*num_threads=*/1, &update));
+  Schema updated;
+  ASSERT_TRUE(updated.ParseFromString(update));
+  EXPECT_THAT(updated, EqualsProto(stale));
+
+  // A required feature added to the schema since the previous statistics is
+  // missing from both statistics, and is updated as by a full update.
+  Schema edited;
+  ASSERT_TRUE(edited.ParseFromString(schema));
+  *edited.add_feature() =
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Feature>(R"(
+        name: 'required'
+        type: INT
+        presence: { min_fraction: 1 min_count: 1 })");
+  string full_update_of_edited;
+  TF_ASSERT_OK(UpdateSchema(edited.SerializeAsString(),
+                            previous_statistics.SerializeAsString(),
+                            /*max_string_domain_size=*/10,
+                            &full_update_of_edited));
+  string incremental_update_of_edited;
+  TF_ASSERT_OK(UpdateSchemaIncrementally(
+      edited.SerializeAsString(), previous_statistics.SerializeAsString(),
+      previous_statistics.SerializeAsString(), /*max_string_domain_size=*/10,
+      /*num_threads=*/1, &incremental_update_of_edited));
+  Schema want_edited;
+  ASSERT_TRUE(want_edited.ParseFromString(full_update_of_edited));
+  Schema got_edited;
+  ASSERT_TRUE(got_edited.ParseFromString(incremental_update_of_edited));
+  EXPECT_THAT(got_edited, EqualsProto(want_edited));
+  EXPECT_NE(full_update_of_edited, edited.SerializeAsString());
+}
+
 TEST(FeatureStatisticsValidatorTest, UseWeightedStatistics) {
   // Those missing have weight zero.
   // Also, (impossibly) there is an E for the weighted and a D for the
@@ -869,6 +1024,1793 @@ TEST(FeatureStatisticsValidatorTest,
       /*expected_drift_skew_infos=*/{});
 }
 
+TEST(FeatureStatisticsValidatorTest, ValidateFeatureStatisticsBatch) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      presence: { min_count: 1 min_fraction: 1.0 }
+      value_count: { min: 1 max: 1 }
+      type: INT
+    })");
+  const std::vector<DatasetFeatureStatistics> statistics = {
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'foo'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })"),
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'foo'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_missing: 3
+              num_non_missing: 7
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        }
+        features: {
+          name: 'bar'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })"),
+      ParseTextProtoOrDie<DatasetFeatureStatistics>("num_examples: 0")};
+  std::vector<string> serialized_statistics;
+  for (const DatasetFeatureStatistics& stats : statistics) {
+    serialized_statistics.push_back(stats.SerializeAsString());
+  }
+  const std::vector<absl::string_view> statistics_proto_strings(
+      serialized_statistics.begin(), serialized_statistics.end());
+  const string schema_proto_string = schema.SerializeAsString();
+  for (const int num_threads : {1, 2}) {
+    ValidationConfig validation_config;
+    validation_config.set_num_threads(num_threads);
+    const string validation_config_string =
+        validation_config.SerializeAsString();
+    std::vector<string> batch_results;
+    TF_ASSERT_OK(ValidateFeatureStatisticsBatch(
+        schema_proto_string, /*environment=*/"", statistics_proto_strings,
+        /*previous_span_statistics_proto_strings=*/{},
+        /*serving_statistics_proto_strings=*/{},
+        /*previous_version_statistics_proto_strings=*/{},
+        /*features_needed_string=*/"", validation_config_string,
+        /*enable_diff_regions=*/false, &batch_results));
+    ASSERT_EQ(batch_results.size(), statistics_proto_strings.size());
+    for (int i = 0; i < statistics_proto_strings.size(); ++i) {
+      string single_result;
+      TF_ASSERT_OK(ValidateFeatureStatisticsWithSerializedInputs(
+          statistics_proto_strings[i], schema_proto_string,
+          /*environment=*/"",
+          /*previous_span_statistics_proto_string=*/"",
+          /*serving_statistics_proto_string=*/"",
+          /*previous_version_statistics_proto_string=*/"",
+          /*features_needed_string=*/"", validation_config_string,
+          /*enable_diff_regions=*/false, &single_result));
+      tensorflow::metadata::v0::Anomalies expected;
+      ASSERT_TRUE(expected.ParseFromString(single_result));
+      tensorflow::metadata::v0::Anomalies actual;
+      ASSERT_TRUE(actual.ParseFromString(batch_results[i]));
+      EXPECT_EQ(actual.data_missing(), expected.data_missing());
+      ExpectSameAnomalies(actual, expected);
+    }
+    EXPECT_EQ(batch_results.size(), 3);
+  }
+}
+
+TEST(FeatureStatisticsValidatorTest,
+     ValidateFeatureStatisticsBatchWithIdenticalFeatures) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "global"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    }
+    feature {
+      name: "local"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    })");
+  // global is the same in all the slices, so its anomaly is found once and
+  // shared by all of them, while local only has an anomaly in one slice.
+  const auto make_statistics = [](int local_max_num_values) {
+    DatasetFeatureStatistics statistics =
+        ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+          num_examples: 10
+          features: {
+            name: 'global'
+            type: INT
+            num_stats: {
+              common_stats: {
+                num_non_missing: 10
+                min_num_values: 1
+                max_num_values: 2
+              }
+            }
+          }
+          features: {
+            name: 'local'
+            type: INT
+            num_stats: {
+              common_stats: {
+                num_non_missing: 10
+                min_num_values: 1
+              }
+            }
+          })");
+    statistics.mutable_features(1)
+        ->mutable_num_stats()
+        ->mutable_common_stats()
+        ->set_max_num_values(local_max_num_values);
+    return statistics.SerializeAsString();
+  };
+  const std::vector<string> serialized_statistics = {
+      make_statistics(1), make_statistics(2), make_statistics(1)};
+  const std::vector<absl::string_view> statistics_proto_strings(
+      serialized_statistics.begin(), serialized_statistics.end());
+  std::vector<string> batch_results;
+  TF_ASSERT_OK(ValidateFeatureStatisticsBatch(
+      schema.SerializeAsString(), /*environment=*/"", statistics_proto_strings,
+      /*previous_span_statistics_proto_strings=*/{},
+      /*serving_statistics_proto_strings=*/{},
+      /*previous_version_statistics_proto_strings=*/{},
+      /*features_needed_string=*/"", ValidationConfig().SerializeAsString(),
+      /*enable_diff_regions=*/false, &batch_results));
+  ASSERT_EQ(batch_results.size(), 3);
+  for (int i = 0; i < batch_results.size(); ++i) {
+    tensorflow::metadata::v0::Anomalies actual;
+    ASSERT_TRUE(actual.ParseFromString(batch_results[i]));
+    EXPECT_EQ(actual.anomaly_info().count("global"), 1);
+    EXPECT_EQ(actual.anomaly_info().count("local"), i == 1 ? 1 : 0);
+    EXPECT_THAT(actual.baseline(), EqualsProto(schema));
+  }
+}
+
+TEST(FeatureStatisticsValidatorTest,
+     ValidateFeatureStatisticsBatchWrongNumberOfControlStatistics) {
+  const string statistics_proto_string =
+      DatasetFeatureStatistics().SerializeAsString();
+  std::vector<string> batch_results;
+  EXPECT_FALSE(ValidateFeatureStatisticsBatch(
+                   Schema().SerializeAsString(), /*environment=*/"",
+                   {statistics_proto_string, statistics_proto_string},
+                   /*previous_span_statistics_proto_strings=*/{""},
+                   /*serving_statistics_proto_strings=*/{},
+                   /*previous_version_statistics_proto_strings=*/{},
+                   /*features_needed_string=*/"",
+                   ValidationConfig().SerializeAsString(),
+                   /*enable_diff_regions=*/false, &batch_results)
+                   .ok());
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidateFeatureStatisticsFromFiles) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      value_count: { max: 1 }
+      type: INT
+    })");
+  // There is at most one anomaly, so the serialization is deterministic.
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features {
+          name: "foo"
+          type: INT
+          num_stats: { common_stats: { num_non_missing: 10 max_num_values: 2 } }
+        })");
+  const DatasetFeatureStatistics serving_statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features {
+          name: "foo"
+          type: INT
+          num_stats: { common_stats: { num_non_missing: 10 max_num_values: 1 } }
+        })");
+  const string directory = ::tensorflow::testing::TmpDir();
+  const string statistics_path =
+      io::JoinPath(directory, "validate_from_files_statistics");
+  const string schema_path =
+      io::JoinPath(directory, "validate_from_files_schema");
+  const string serving_statistics_path =
+      io::JoinPath(directory, "validate_from_files_serving_statistics");
+  Env* env = Env::Default();
+  TF_ASSERT_OK(WriteStringToFile(env, statistics_path,
+                                 statistics.SerializeAsString()));
+  TF_ASSERT_OK(
+      WriteStringToFile(env, schema_path, schema.SerializeAsString()));
+  TF_ASSERT_OK(WriteStringToFile(env, serving_statistics_path,
+                                 serving_statistics.SerializeAsString()));
+
+  string expected;
+  TF_ASSERT_OK(ValidateFeatureStatisticsWithSerializedInputs(
+      statistics.SerializeAsString(), schema.SerializeAsString(),
+      /*environment=*/"", /*previous_span_statistics_proto_string=*/"",
+      serving_statistics.SerializeAsString(),
+      /*previous_version_statistics_proto_string=*/"",
+      /*features_needed_string=*/"", ValidationConfig().SerializeAsString(),
+      /*enable_diff_regions=*/false, &expected));
+  string actual;
+  TF_ASSERT_OK(ValidateFeatureStatisticsFromFiles(
+      statistics_path, schema_path, /*environment=*/"",
+      /*previous_span_statistics_path=*/"", serving_statistics_path,
+      /*previous_version_statistics_path=*/"", /*features_needed_string=*/"",
+      ValidationConfig().SerializeAsString(), /*enable_diff_regions=*/false,
+      &actual));
+  EXPECT_EQ(actual, expected);
+
+  EXPECT_FALSE(ValidateFeatureStatisticsFromFiles(
+                   io::JoinPath(directory, "validate_from_files_missing"),
+                   schema_path, /*environment=*/"",
+                   /*previous_span_statistics_path=*/"",
+                   /*serving_statistics_path=*/"",
+                   /*previous_version_statistics_path=*/"",
+                   /*features_needed_string=*/"",
+                   ValidationConfig().SerializeAsString(),
+                   /*enable_diff_regions=*/false, &actual)
+                   .ok());
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidateFeatureStatisticsList) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      type: BYTES
+      drift_comparator { infinity_norm { threshold: 0.1 } }
+    })");
+  const DatasetFeatureStatisticsList statistics_list =
+      ParseTextProtoOrDie<DatasetFeatureStatisticsList>(R"(
+        datasets {
+          name: "a"
+          num_examples: 2
+          features: {
+            name: 'foo'
+            type: STRING
+            string_stats: {
+              common_stats: { num_non_missing: 2 max_num_values: 1 }
+              rank_histogram { buckets { label: "x" sample_count: 2 } }
+            }
+          }
+        }
+        datasets {
+          name: "b"
+          num_examples: 2
+          features: {
+            name: 'foo'
+            type: STRING
+            string_stats: {
+              common_stats: { num_non_missing: 2 max_num_values: 1 }
+              rank_histogram { buckets { label: "x" sample_count: 2 } }
+            }
+          }
+        })");
+  // Only slice b, and a slice that is not validated, have previous spans.
+  const DatasetFeatureStatisticsList previous_span_list =
+      ParseTextProtoOrDie<DatasetFeatureStatisticsList>(R"(
+        datasets {
+          name: "c"
+          num_examples: 2
+        }
+        datasets {
+          name: "b"
+          num_examples: 2
+          features: {
+            name: 'foo'
+            type: STRING
+            string_stats: {
+              common_stats: { num_non_missing: 2 max_num_values: 1 }
+              rank_histogram { buckets { label: "y" sample_count: 2 } }
+            }
+          }
+        })");
+  const string schema_proto_string = schema.SerializeAsString();
+  const string validation_config_string =
+      ValidationConfig().SerializeAsString();
+  std::map<string, string> results;
+  TF_ASSERT_OK(ValidateFeatureStatisticsList(
+      schema_proto_string, /*environment=*/"",
+      statistics_list.SerializeAsString(),
+      previous_span_list.SerializeAsString(),
+      /*serving_statistics_list_proto_string=*/"",
+      /*previous_version_statistics_list_proto_string=*/"",
+      /*features_needed_string=*/"", validation_config_string,
+      /*enable_diff_regions=*/false, &results));
+  ASSERT_EQ(results.size(), 2);
+  for (int i = 0; i < statistics_list.datasets_size(); ++i) {
+    const string& name = statistics_list.datasets(i).name();
+    // Same as validating the slice alone, against its own previous span.
+    const string previous_span_proto_string =
+        name == "b" ? previous_span_list.datasets(1).SerializeAsString() : "";
+    string expected_proto_string;
+    TF_ASSERT_OK(ValidateFeatureStatisticsWithSerializedInputs(
+        statistics_list.datasets(i).SerializeAsString(),
+        schema_proto_string, /*environment=*/"", previous_span_proto_string,
+        /*serving_statistics_proto_string=*/"",
+        /*previous_version_statistics_proto_string=*/"",
+        /*features_needed_string=*/"", validation_config_string,
+        /*enable_diff_regions=*/false, &expected_proto_string));
+    tensorflow::metadata::v0::Anomalies expected;
+    ASSERT_TRUE(expected.ParseFromString(expected_proto_string));
+    ASSERT_EQ(results.count(name), 1);
+    tensorflow::metadata::v0::Anomalies actual;
+    ASSERT_TRUE(actual.ParseFromString(results.at(name)));
+    // There is at most one anomaly, so the serialization is deterministic.
+    EXPECT_THAT(actual, EqualsProto(expected));
+  }
+  tensorflow::metadata::v0::Anomalies drifted;
+  ASSERT_TRUE(drifted.ParseFromString(results.at("b")));
+  EXPECT_EQ(drifted.anomaly_info_size(), 1);
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidateFeatureStatisticsListDuplicates) {
+  const DatasetFeatureStatisticsList statistics_list =
+      ParseTextProtoOrDie<DatasetFeatureStatisticsList>(R"(
+        datasets { name: "a" num_examples: 1 }
+        datasets { name: "a" num_examples: 2 })");
+  std::map<string, string> results;
+  EXPECT_EQ(ValidateFeatureStatisticsList(
+                Schema().SerializeAsString(), /*environment=*/"",
+                statistics_list.SerializeAsString(),
+                /*previous_span_statistics_list_proto_string=*/"",
+                /*serving_statistics_list_proto_string=*/"",
+                /*previous_version_statistics_list_proto_string=*/"",
+                /*features_needed_string=*/"",
+                ValidationConfig().SerializeAsString(),
+                /*enable_diff_regions=*/false, &results)
+                .code(),
+            error::INVALID_ARGUMENT);
+  EXPECT_FALSE(ValidateFeatureStatisticsList(
+                   Schema().SerializeAsString(), /*environment=*/"",
+                   "not a proto",
+                   /*previous_span_statistics_list_proto_string=*/"",
+                   /*serving_statistics_list_proto_string=*/"",
+                   /*previous_version_statistics_list_proto_string=*/"",
+                   /*features_needed_string=*/"",
+                   ValidationConfig().SerializeAsString(),
+                   /*enable_diff_regions=*/false, &results)
+                   .ok());
+}
+
+TEST(FeatureStatisticsValidatorTest, ComputeDriftAgainstPreviousSpans) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      type: BYTES
+      drift_comparator { infinity_norm { threshold: 0.1 } }
+    }
+    feature { name: "bar" type: BYTES })");
+  // Gets statistics where foo has the given counts of its values.
+  const auto get_statistics =
+      [](const std::map<string, double>& foo_value_counts) {
+        DatasetFeatureStatistics result =
+            ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+              num_examples: 2
+              features: {
+                name: 'foo'
+                type: STRING
+                string_stats: { common_stats: { num_non_missing: 2 } }
+              }
+              features: {
+                name: 'bar'
+                type: STRING
+                string_stats: {
+                  common_stats: { num_non_missing: 2 }
+                  rank_histogram { buckets { label: "x" sample_count: 2 } }
+                }
+              })");
+        for (const auto& pair : foo_value_counts) {
+          auto* bucket = result.mutable_features(0)
+                             ->mutable_string_stats()
+                             ->mutable_rank_histogram()
+                             ->add_buckets();
+          bucket->set_label(pair.first);
+          bucket->set_sample_count(pair.second);
+        }
+        return result;
+      };
+  const DatasetFeatureStatistics statistics =
+      get_statistics({{"a", 1}, {"b", 1}});
+  const std::vector<DatasetFeatureStatistics> previous_spans = {
+      get_statistics({{"a", 2}}), get_statistics({{"a", 1}, {"b", 1}}),
+      ParseTextProtoOrDie<DatasetFeatureStatistics>("num_examples: 2")};
+  std::vector<tensorflow::metadata::v0::Anomalies> results;
+  TF_ASSERT_OK(ComputeDriftAgainstPreviousSpans(statistics, schema,
+                                                previous_spans, &results));
+  ASSERT_EQ(results.size(), previous_spans.size());
+  // Each result has the measurements that validating against that previous
+  // span reports.
+  for (int i = 0; i < 2; ++i) {
+    tensorflow::metadata::v0::Anomalies expected;
+    TF_ASSERT_OK(ValidateFeatureStatistics(
+        statistics, schema, /*environment=*/absl::nullopt, previous_spans[i],
+        /*serving_feature_statistics=*/absl::nullopt,
+        /*prev_version_feature_statistics=*/absl::nullopt,
+        /*features_needed=*/absl::nullopt, ValidationConfig(),
+        /*enable_diff_regions=*/false, &expected));
+    ASSERT_EQ(expected.drift_skew_info_size(), 1);
+    ASSERT_EQ(results[i].drift_skew_info_size(), 1);
+    EXPECT_THAT(results[i].drift_skew_info(0),
+                EqualsProto(expected.drift_skew_info(0)));
+  }
+  EXPECT_EQ(results[0].drift_skew_info(0).drift_measurements(0).value(), 0.5);
+  EXPECT_EQ(results[1].drift_skew_info(0).drift_measurements(0).value(), 0.0);
+  // The last previous span has no statistics for foo.
+  EXPECT_EQ(results[2].drift_skew_info_size(), 0);
+
+  // The same, with serialized inputs.
+  std::unique_ptr<Validator> validator;
+  TF_ASSERT_OK(Validator::Create(schema.SerializeAsString(),
+                                 /*environment=*/"",
+                                 ValidationConfig().SerializeAsString(),
+                                 &validator));
+  std::vector<string> serialized_previous_spans;
+  for (const DatasetFeatureStatistics& previous_span : previous_spans) {
+    serialized_previous_spans.push_back(previous_span.SerializeAsString());
+  }
+  std::vector<string> serialized_results;
+  TF_ASSERT_OK(validator->ComputeDriftWithSerializedInputs(
+      statistics.SerializeAsString(),
+      std::vector<absl::string_view>(serialized_previous_spans.begin(),
+                                     serialized_previous_spans.end()),
+      &serialized_results));
+  ASSERT_EQ(serialized_results.size(), results.size());
+  for (int i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(serialized_results[i], results[i].SerializeAsString());
+  }
+}
+
+TEST(FeatureStatisticsValidatorTest, ComputeDriftAgainstRollingState) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      type: BYTES
+      drift_comparator { infinity_norm { threshold: 0.1 } }
+    })");
+  const DatasetFeatureStatistics previous_span =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 2
+        features: {
+          name: 'foo'
+          type: STRING
+          string_stats: {
+            common_stats: { num_non_missing: 2 }
+            rank_histogram { buckets { label: "a" sample_count: 2 } }
+          }
+        })");
+  DatasetFeatureStatistics statistics = previous_span;
+  statistics.mutable_features(0)
+      ->mutable_string_stats()
+      ->mutable_rank_histogram()
+      ->mutable_buckets(0)
+      ->set_label("b");
+  RollingDriftState state;
+  state.set_max_spans(1);
+  tensorflow::metadata::v0::Anomalies result;
+  TF_ASSERT_OK(
+      ComputeDriftAgainstRollingState(previous_span, schema, &state, &result));
+  EXPECT_EQ(result.drift_skew_info_size(), 0);
+  TF_ASSERT_OK(
+      ComputeDriftAgainstRollingState(statistics, schema, &state, &result));
+
+  // With one span in the state, the drift is the one against that span.
+  std::vector<tensorflow::metadata::v0::Anomalies> expected;
+  TF_ASSERT_OK(ComputeDriftAgainstPreviousSpans(statistics, schema,
+                                                {previous_span}, &expected));
+  ASSERT_EQ(expected.size(), 1);
+  EXPECT_THAT(result, EqualsProto(expected[0]));
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorIsReusable) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      presence: { min_count: 1 min_fraction: 1.0 }
+      value_count: { min: 1 max: 1 }
+      type: INT
+    })");
+  const DatasetFeatureStatistics good_statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'foo'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })");
+  const DatasetFeatureStatistics bad_statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'foo'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        })");
+  std::unique_ptr<Validator> validator;
+  TF_ASSERT_OK(Validator::Create(schema.SerializeAsString(),
+                                 /*environment=*/"",
+                                 ValidationConfig().SerializeAsString(),
+                                 &validator));
+  for (const DatasetFeatureStatistics& statistics :
+       {bad_statistics, good_statistics, bad_statistics}) {
+    tensorflow::metadata::v0::Anomalies expected;
+    TF_ASSERT_OK(ValidateFeatureStatistics(
+        statistics, schema, /*environment=*/absl::nullopt,
+        /*prev_span_feature_statistics=*/absl::nullopt,
+        /*serving_feature_statistics=*/absl::nullopt,
+        /*prev_version_feature_statistics=*/absl::nullopt,
+        /*features_needed=*/absl::nullopt, ValidationConfig(),
+        /*enable_diff_regions=*/false, &expected));
+    string actual_proto_string;
+    TF_ASSERT_OK(validator->ValidateWithSerializedInputs(
+        statistics.SerializeAsString(),
+        /*previous_span_statistics_proto_string=*/"",
+        /*serving_statistics_proto_string=*/"",
+        /*previous_version_statistics_proto_string=*/"",
+        /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+        &actual_proto_string));
+    tensorflow::metadata::v0::Anomalies actual;
+    ASSERT_TRUE(actual.ParseFromString(actual_proto_string));
+    // There is at most one anomaly, so the serialization is deterministic.
+    EXPECT_THAT(actual, EqualsProto(expected));
+  }
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorFromSchemaSnapshot) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      value_count: { max: 1 }
+      type: INT
+      not_in_environment: "SERVING"
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features {
+          name: "foo"
+          type: INT
+          num_stats: { common_stats: { num_non_missing: 10 max_num_values: 2 } }
+        })");
+  const string path = io::JoinPath(::tensorflow::testing::TmpDir(),
+                                   "validator_from_schema_snapshot");
+  TF_ASSERT_OK(WriteSchemaSnapshot(schema, path));
+  for (const string& environment : {"", "SERVING"}) {
+    std::unique_ptr<Validator> expected_validator;
+    TF_ASSERT_OK(Validator::Create(schema.SerializeAsString(), environment,
+                                   ValidationConfig().SerializeAsString(),
+                                   &expected_validator));
+    std::unique_ptr<Validator> validator;
+    TF_ASSERT_OK(Validator::CreateFromSchemaSnapshot(
+        path, environment, ValidationConfig().SerializeAsString(),
+        &validator));
+    tensorflow::metadata::v0::Anomalies expected;
+    TF_ASSERT_OK(expected_validator->Validate(
+        statistics, /*prev_span_feature_statistics=*/absl::nullopt,
+        /*serving_feature_statistics=*/absl::nullopt,
+        /*prev_version_feature_statistics=*/absl::nullopt,
+        /*features_needed=*/absl::nullopt, /*enable_diff_regions=*/false,
+        &expected));
+    tensorflow::metadata::v0::Anomalies actual;
+    TF_ASSERT_OK(validator->Validate(
+        statistics, /*prev_span_feature_statistics=*/absl::nullopt,
+        /*serving_feature_statistics=*/absl::nullopt,
+        /*prev_version_feature_statistics=*/absl::nullopt,
+        /*features_needed=*/absl::nullopt, /*enable_diff_regions=*/false,
+        &actual));
+    EXPECT_THAT(actual, EqualsProto(expected));
+  }
+  std::unique_ptr<Validator> validator;
+  EXPECT_FALSE(Validator::CreateFromSchemaSnapshot(
+                   io::JoinPath(::tensorflow::testing::TmpDir(),
+                                "missing_schema_snapshot"),
+                   /*environment=*/"", ValidationConfig().SerializeAsString(),
+                   &validator)
+                   .ok());
+}
+
+TEST(FeatureStatisticsValidatorTest,
+     ValidateFeatureStatisticsWithResultCache) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "feature"
+      presence: { min_count: 1 }
+      type: INT
+    })");
+  const string schema_proto_string = schema.SerializeAsString();
+  const string validation_config_string =
+      ValidationConfig().SerializeAsString();
+  const auto validate = [&](absl::string_view statistics_proto_string,
+                            string* result) {
+    return ValidateFeatureStatisticsWithSerializedInputs(
+        statistics_proto_string, schema_proto_string, /*environment=*/"",
+        /*previous_span_statistics_proto_string=*/"",
+        /*serving_statistics_proto_string=*/"",
+        /*previous_version_statistics_proto_string=*/"",
+        /*features_needed_string=*/"", validation_config_string,
+        /*enable_diff_regions=*/false, result);
+  };
+  const string statistics_proto_string =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>("num_examples: 10")
+          .SerializeAsString();
+  string expected;
+  TF_ASSERT_OK(validate(statistics_proto_string, &expected));
+
+  const auto cache = std::make_shared<ValidationResultCache>(
+      /*max_bytes=*/1 << 20, /*directory=*/"");
+  SetValidationResultCache(cache);
+  string result;
+  TF_ASSERT_OK(validate(statistics_proto_string, &result));
+  EXPECT_EQ(result, expected);
+  TF_ASSERT_OK(validate(statistics_proto_string, &result));
+  EXPECT_EQ(result, expected);
+  // Invalid inputs are not cached.
+  EXPECT_FALSE(validate("not a proto", &result).ok());
+  EXPECT_FALSE(validate("not a proto", &result).ok());
+  SetValidationResultCache(nullptr);
+
+  const ValidationResultCache::Stats stats = cache->GetStats();
+  EXPECT_EQ(stats.memory_hits, 1);
+  EXPECT_EQ(stats.misses, 3);
+}
+
+TEST(FeatureStatisticsValidatorTest,
+     ValidateFeatureStatisticsWithResultCacheAndDeadline) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "feature"
+      presence: { min_count: 1 }
+      type: INT
+    })");
+  ValidationConfig validation_config;
+  // Expires before the validation is done.
+  validation_config.set_deadline_micros(1);
+  const string statistics_proto_string =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'feature'
+          type: INT
+          num_stats: { common_stats: { num_non_missing: 10 } }
+        })")
+          .SerializeAsString();
+  const auto cache = std::make_shared<ValidationResultCache>(
+      /*max_bytes=*/1 << 20, /*directory=*/"");
+  SetValidationResultCache(cache);
+  for (int i = 0; i < 2; ++i) {
+    string result;
+    TF_ASSERT_OK(ValidateFeatureStatisticsWithSerializedInputs(
+        statistics_proto_string, schema.SerializeAsString(),
+        /*environment=*/"", /*previous_span_statistics_proto_string=*/"",
+        /*serving_statistics_proto_string=*/"",
+        /*previous_version_statistics_proto_string=*/"",
+        /*features_needed_string=*/"", validation_config.SerializeAsString(),
+        /*enable_diff_regions=*/false, &result));
+  }
+  SetValidationResultCache(nullptr);
+
+  // The result of a validation cut short by its deadline is not cached, so
+  // the second call validates again.
+  const ValidationResultCache::Stats stats = cache->GetStats();
+  EXPECT_EQ(stats.memory_hits, 0);
+  EXPECT_EQ(stats.disk_hits, 0);
+  EXPECT_EQ(stats.misses, 2);
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorWithFeaturesNeeded) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'foo'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        }
+        features: {
+          name: 'bar'
+          type: STRING
+          string_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        }
+        features: {
+          name: 'baz'
+          type: STRING
+          string_stats: { common_stats: { num_missing: 10 } }
+        })");
+  ReasonFeatureNeeded reason;
+  reason.set_comment("needed");
+  const FeaturesNeeded features_needed({{Path({"foo"}), {reason}}});
+  const Validator validator(schema, /*environment=*/absl::nullopt,
+                            ValidationConfig());
+  tensorflow::metadata::v0::Anomalies expected;
+  TF_ASSERT_OK(validator.Validate(
+      statistics, /*prev_span_feature_statistics=*/absl::nullopt,
+      /*serving_feature_statistics=*/absl::nullopt,
+      /*prev_version_feature_statistics=*/absl::nullopt, features_needed,
+      /*enable_diff_regions=*/false, &expected));
+  ASSERT_EQ(expected.anomaly_info_size(), 1);
+
+  // The statistics are parsed lazily when features_needed is set.
+  string actual_proto_string;
+  TF_ASSERT_OK(validator.ValidateWithSerializedInputs(
+      statistics.SerializeAsString(),
+      /*previous_span_statistics_proto_string=*/"",
+      /*serving_statistics_proto_string=*/"",
+      /*previous_version_statistics_proto_string=*/"", features_needed,
+      /*enable_diff_regions=*/false, &actual_proto_string));
+  tensorflow::metadata::v0::Anomalies actual;
+  ASSERT_TRUE(actual.ParseFromString(actual_proto_string));
+  // There is one anomaly, so the serialization is deterministic.
+  EXPECT_THAT(actual, EqualsProto(expected));
+}
+
+// Keeps the anomalies passed to an AnomaliesSink.
+class AnomaliesCollector : public AnomaliesSink {
+ public:
+  Status OnAnomalyInfo(const string& path,
+                       const AnomalyInfo& anomaly_info) override {
+    (*anomalies.mutable_anomaly_info())[path] = anomaly_info;
+    return Status::OK();
+  }
+
+  Status OnDriftSkewInfo(const DriftSkewInfo& drift_skew_info) override {
+    *anomalies.add_drift_skew_info() = drift_skew_info;
+    return Status::OK();
+  }
+
+  Status OnDatasetAnomalyInfo(const AnomalyInfo& anomaly_info) override {
+    *anomalies.mutable_dataset_anomaly_info() = anomaly_info;
+    return Status::OK();
+  }
+
+  Status OnDataMissing() override {
+    anomalies.set_data_missing(true);
+    return Status::OK();
+  }
+
+  tensorflow::metadata::v0::Anomalies anomalies;
+};
+
+TEST(FeatureStatisticsValidatorTest, ValidatorWithSink) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'foo'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        })");
+  const Validator validator(schema, /*environment=*/absl::nullopt,
+                            ValidationConfig());
+  tensorflow::metadata::v0::Anomalies expected;
+  TF_ASSERT_OK(validator.Validate(
+      statistics, /*prev_span_feature_statistics=*/absl::nullopt,
+      /*serving_feature_statistics=*/absl::nullopt,
+      /*prev_version_feature_statistics=*/absl::nullopt,
+      /*features_needed=*/absl::nullopt, /*enable_diff_regions=*/false,
+      &expected));
+  ASSERT_EQ(expected.anomaly_info_size(), 1);
+
+  AnomaliesCollector collector;
+  TF_ASSERT_OK(validator.ValidateWithSerializedInputs(
+      statistics.SerializeAsString(),
+      /*previous_span_statistics_proto_string=*/"",
+      /*serving_statistics_proto_string=*/"",
+      /*previous_version_statistics_proto_string=*/"",
+      /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+      &collector));
+  // The sink does not get the baseline.
+  *collector.anomalies.mutable_baseline() = schema;
+  collector.anomalies.set_anomaly_name_format(expected.anomaly_name_format());
+  EXPECT_THAT(collector.anomalies, EqualsProto(expected));
+
+  AnomaliesCollector missing_collector;
+  TF_ASSERT_OK(validator.ValidateWithSerializedInputs(
+      DatasetFeatureStatistics().SerializeAsString(),
+      /*previous_span_statistics_proto_string=*/"",
+      /*serving_statistics_proto_string=*/"",
+      /*previous_version_statistics_proto_string=*/"",
+      /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+      &missing_collector));
+  EXPECT_THAT(missing_collector.anomalies, EqualsProto("data_missing: true"));
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorWithDeltaEncodedAnomalies) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'foo'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        })");
+  tensorflow::metadata::v0::Anomalies expected;
+  TF_ASSERT_OK(Validator(schema, /*environment=*/absl::nullopt,
+                         ValidationConfig())
+                   .Validate(statistics,
+                             /*prev_span_feature_statistics=*/absl::nullopt,
+                             /*serving_feature_statistics=*/absl::nullopt,
+                             /*prev_version_feature_statistics=*/absl::nullopt,
+                             /*features_needed=*/absl::nullopt,
+                             /*enable_diff_regions=*/false, &expected));
+  expected.clear_baseline();
+
+  ValidationConfig validation_config;
+  validation_config.set_delta_encoded_anomalies(true);
+  const Validator validator(schema, /*environment=*/absl::nullopt,
+                            validation_config);
+  string delta_string;
+  TF_ASSERT_OK(validator.ValidateWithSerializedInputs(
+      statistics.SerializeAsString(),
+      /*previous_span_statistics_proto_string=*/"",
+      /*serving_statistics_proto_string=*/"",
+      /*previous_version_statistics_proto_string=*/"",
+      /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+      &delta_string));
+  AnomaliesDelta delta;
+  ASSERT_TRUE(delta.ParseFromString(delta_string));
+  EXPECT_THAT(delta.anomalies(), EqualsProto(expected));
+  EXPECT_EQ(delta.baseline_fingerprint(), IndexedSchema(schema).fingerprint());
+  ASSERT_EQ(delta.schema_changes_size(), 1);
+  EXPECT_EQ(delta.schema_changes().at("foo").feature(0).value_count().max(),
+            2);
+
+  TF_ASSERT_OK(validator.ValidateWithSerializedInputs(
+      DatasetFeatureStatistics().SerializeAsString(),
+      /*previous_span_statistics_proto_string=*/"",
+      /*serving_statistics_proto_string=*/"",
+      /*previous_version_statistics_proto_string=*/"",
+      /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+      &delta_string));
+  ASSERT_TRUE(delta.ParseFromString(delta_string));
+  EXPECT_TRUE(delta.anomalies().data_missing());
+  EXPECT_FALSE(delta.anomalies().has_baseline());
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorIgnoresUnusedControlStatistics) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      type: BYTES
+      drift_comparator { infinity_norm { threshold: 0.01 } }
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 2
+        features: {
+          name: 'foo'
+          type: STRING
+          string_stats: {
+            common_stats: { num_non_missing: 2 max_num_values: 1 }
+            rank_histogram {
+              buckets { label: "a" sample_count: 1 }
+              buckets { label: "b" sample_count: 1 }
+            }
+          }
+        })");
+  const DatasetFeatureStatistics prev_span_statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 4
+        features: {
+          name: 'foo'
+          type: STRING
+          string_stats: {
+            common_stats: { num_non_missing: 4 max_num_values: 1 }
+            rank_histogram {
+              buckets { label: "a" sample_count: 3 }
+              buckets { label: "b" sample_count: 1 }
+            }
+          }
+        })");
+  const Validator validator(schema, /*environment=*/absl::nullopt,
+                            ValidationConfig());
+  tensorflow::metadata::v0::Anomalies expected;
+  TF_ASSERT_OK(validator.Validate(
+      statistics, prev_span_statistics,
+      /*serving_feature_statistics=*/absl::nullopt,
+      /*prev_version_feature_statistics=*/absl::nullopt,
+      /*features_needed=*/absl::nullopt, /*enable_diff_regions=*/false,
+      &expected));
+  ASSERT_EQ(expected.anomaly_info_size(), 1);
+
+  // Only the previous span statistics are used by the schema, so the others
+  // are not even parsed.
+  string actual_proto_string;
+  TF_ASSERT_OK(validator.ValidateWithSerializedInputs(
+      statistics.SerializeAsString(), prev_span_statistics.SerializeAsString(),
+      /*serving_statistics_proto_string=*/"not a proto",
+      /*previous_version_statistics_proto_string=*/"not a proto",
+      /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+      &actual_proto_string));
+  tensorflow::metadata::v0::Anomalies actual;
+  ASSERT_TRUE(actual.ParseFromString(actual_proto_string));
+  // There is one anomaly, so the serialization is deterministic.
+  EXPECT_THAT(actual, EqualsProto(expected));
+
+  EXPECT_FALSE(validator
+                   .ValidateWithSerializedInputs(
+                       statistics.SerializeAsString(),
+                       /*previous_span_statistics_proto_string=*/"not a proto",
+                       /*serving_statistics_proto_string=*/"",
+                       /*previous_version_statistics_proto_string=*/"",
+                       /*features_needed_string=*/"",
+                       /*enable_diff_regions=*/false, &actual_proto_string)
+                   .ok());
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorWithFailFast) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      type: BYTES
+      drift_comparator { infinity_norm { threshold: 0.01 } }
+    }
+    feature {
+      name: "bar"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    })");
+  const DatasetFeatureStatistics prev_span_statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 4
+        features: {
+          name: 'foo'
+          type: STRING
+          string_stats: {
+            common_stats: { num_non_missing: 4 max_num_values: 1 }
+            rank_histogram {
+              buckets { label: "a" sample_count: 3 }
+              buckets { label: "b" sample_count: 1 }
+            }
+          }
+        })");
+  DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 2
+        features: {
+          name: 'foo'
+          type: STRING
+          string_stats: {
+            common_stats: { num_non_missing: 2 max_num_values: 1 }
+            rank_histogram {
+              buckets { label: "a" sample_count: 1 }
+              buckets { label: "b" sample_count: 1 }
+            }
+          }
+        }
+        features: {
+          name: 'bar'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 2
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        })");
+  ValidationConfig validation_config;
+  validation_config.set_delta_encoded_anomalies(true);
+  validation_config.set_fail_fast(true);
+  const Validator validator(schema, /*environment=*/absl::nullopt,
+                            validation_config);
+  const auto validate = [&](AnomaliesDelta* delta) {
+    string delta_string;
+    TF_RETURN_IF_ERROR(validator.ValidateWithSerializedInputs(
+        statistics.SerializeAsString(),
+        prev_span_statistics.SerializeAsString(),
+        /*serving_statistics_proto_string=*/"",
+        /*previous_version_statistics_proto_string=*/"",
+        /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+        &delta_string));
+    if (!delta->ParseFromString(delta_string)) {
+      return tensorflow::errors::Internal("Failed to parse AnomaliesDelta");
+    }
+    return Status::OK();
+  };
+
+  // The drift of foo is only checked once the cheap checks of all the
+  // features pass, so the value count of bar is the first error.
+  AnomaliesDelta delta;
+  TF_ASSERT_OK(validate(&delta));
+  EXPECT_TRUE(delta.partial());
+  ASSERT_EQ(delta.anomalies().anomaly_info_size(), 1);
+  EXPECT_EQ(delta.anomalies().anomaly_info().count("bar"), 1);
+  EXPECT_EQ(delta.anomalies().drift_skew_info_size(), 0);
+
+  // Without errors in the cheap checks, the result is the same as without
+  // fail_fast.
+  statistics.mutable_features(1)
+      ->mutable_num_stats()
+      ->mutable_common_stats()
+      ->set_max_num_values(1);
+  tensorflow::metadata::v0::Anomalies expected;
+  TF_ASSERT_OK(Validator(schema, /*environment=*/absl::nullopt,
+                         ValidationConfig())
+                   .Validate(statistics, prev_span_statistics,
+                             /*serving_feature_statistics=*/absl::nullopt,
+                             /*prev_version_feature_statistics=*/absl::nullopt,
+                             /*features_needed=*/absl::nullopt,
+                             /*enable_diff_regions=*/false, &expected));
+  expected.clear_baseline();
+  ASSERT_EQ(expected.anomaly_info_size(), 1);
+  ASSERT_EQ(expected.drift_skew_info_size(), 1);
+  TF_ASSERT_OK(validate(&delta));
+  EXPECT_THAT(delta.anomalies(), EqualsProto(expected));
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorWithMaxAnomalies) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      presence: { min_count: 1 }
+      type: INT
+    }
+    feature {
+      name: "bar"
+      presence: { min_count: 1 }
+      type: INT
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10)");
+  ValidationConfig validation_config;
+  validation_config.set_max_anomalies(1);
+  const Validator validator(schema, /*environment=*/absl::nullopt,
+                            validation_config);
+  tensorflow::metadata::v0::Anomalies result;
+  ValidationProfile profile;
+  TF_ASSERT_OK(validator.Validate(
+      statistics, /*prev_span_feature_statistics=*/absl::nullopt,
+      /*serving_feature_statistics=*/absl::nullopt,
+      /*prev_version_feature_statistics=*/absl::nullopt,
+      /*features_needed=*/absl::nullopt, /*enable_diff_regions=*/false,
+      &result, &profile));
+  ASSERT_EQ(result.anomaly_info_size(), 1);
+  EXPECT_EQ(result.anomaly_info().count("bar"), 1);
+  EXPECT_EQ(profile.num_anomalies(), 1);
+  ASSERT_EQ(profile.num_dropped_anomalies_size(), 1);
+  EXPECT_EQ(profile.num_dropped_anomalies().at("SCHEMA_MISSING_COLUMN"), 1);
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorWithDeadline) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    }
+    feature {
+      name: "missing"
+      presence: { min_count: 1 }
+      type: INT
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 2
+        features: {
+          name: 'foo'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 2
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        })");
+
+  // A cancelled deadline leaves only the cheap checks of the dataset.
+  ValidationDeadline cancelled;
+  cancelled.Cancel();
+  tensorflow::metadata::v0::Anomalies result;
+  ValidationProfile profile;
+  TF_ASSERT_OK(Validator(schema, /*environment=*/absl::nullopt,
+                         ValidationConfig())
+                   .Validate(statistics,
+                             /*prev_span_feature_statistics=*/absl::nullopt,
+                             /*serving_feature_statistics=*/absl::nullopt,
+                             /*prev_version_feature_statistics=*/absl::nullopt,
+                             /*features_needed=*/absl::nullopt,
+                             /*enable_diff_regions=*/false, &result, &profile,
+                             &cancelled));
+  ASSERT_EQ(result.anomaly_info_size(), 1);
+  EXPECT_EQ(result.anomaly_info().count("missing"), 1);
+  EXPECT_TRUE(profile.partial());
+  ASSERT_EQ(profile.unchecked_feature_size(), 1);
+  EXPECT_EQ(Path(profile.unchecked_feature(0)), Path({"foo"}));
+
+  // A deadline that does not expire checks everything.
+  ValidationConfig validation_config;
+  validation_config.set_delta_encoded_anomalies(true);
+  validation_config.set_deadline_micros(3600LL * 1000 * 1000);
+  string delta_string;
+  TF_ASSERT_OK(
+      Validator(schema, /*environment=*/absl::nullopt, validation_config)
+          .ValidateWithSerializedInputs(
+              statistics.SerializeAsString(),
+              /*previous_span_statistics_proto_string=*/"",
+              /*serving_statistics_proto_string=*/"",
+              /*previous_version_statistics_proto_string=*/"",
+              /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+              &delta_string));
+  AnomaliesDelta delta;
+  ASSERT_TRUE(delta.ParseFromString(delta_string));
+  EXPECT_FALSE(delta.partial());
+  EXPECT_EQ(delta.unchecked_feature_size(), 0);
+  EXPECT_EQ(delta.anomalies().anomaly_info_size(), 2);
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorWithCachedStatistics) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      type: BYTES
+      drift_comparator { infinity_norm { threshold: 0.01 } }
+    })");
+  const auto make_statistics = [](int num_a, int num_b) {
+    DatasetFeatureStatistics statistics =
+        ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+          features: {
+            name: 'foo'
+            type: STRING
+            string_stats: {
+              common_stats: { max_num_values: 1 }
+              rank_histogram {
+                buckets { label: "a" }
+                buckets { label: "b" }
+              }
+            }
+          })");
+    statistics.set_num_examples(num_a + num_b);
+    tensorflow::metadata::v0::StringStatistics* string_stats =
+        statistics.mutable_features(0)->mutable_string_stats();
+    string_stats->mutable_common_stats()->set_num_non_missing(num_a + num_b);
+    tensorflow::metadata::v0::RankHistogram* histogram =
+        string_stats->mutable_rank_histogram();
+    histogram->mutable_buckets(0)->set_sample_count(num_a);
+    histogram->mutable_buckets(1)->set_sample_count(num_b);
+    return statistics.SerializeAsString();
+  };
+  // Each span is the previous span of the next one.
+  const std::vector<string> spans = {make_statistics(3, 1),
+                                     make_statistics(1, 1),
+                                     make_statistics(1, 3)};
+  ValidationConfig validation_config;
+  const Validator validator(schema, /*environment=*/absl::nullopt,
+                            validation_config);
+  validation_config.set_max_cached_statistics(2);
+  const Validator cached_validator(schema, /*environment=*/absl::nullopt,
+                                   validation_config);
+  for (int i = 1; i < spans.size(); ++i) {
+    string expected;
+    TF_ASSERT_OK(validator.ValidateWithSerializedInputs(
+        spans[i], spans[i - 1], /*serving_statistics_proto_string=*/"",
+        /*previous_version_statistics_proto_string=*/"",
+        /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+        &expected));
+    string result;
+    TF_ASSERT_OK(cached_validator.ValidateWithSerializedInputs(
+        spans[i], spans[i - 1], /*serving_statistics_proto_string=*/"",
+        /*previous_version_statistics_proto_string=*/"",
+        /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+        &result));
+    tensorflow::metadata::v0::Anomalies expected_anomalies;
+    ASSERT_TRUE(expected_anomalies.ParseFromString(expected));
+    ASSERT_EQ(expected_anomalies.drift_skew_info_size(), 1);
+    tensorflow::metadata::v0::Anomalies anomalies;
+    ASSERT_TRUE(anomalies.ParseFromString(result));
+    EXPECT_THAT(anomalies, EqualsProto(expected_anomalies));
+  }
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorWithProfile) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      type: BYTES
+      drift_comparator { infinity_norm { threshold: 0.01 } }
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 2
+        features: {
+          name: 'foo'
+          type: STRING
+          string_stats: {
+            common_stats: { num_non_missing: 2 max_num_values: 1 }
+            rank_histogram {
+              buckets { label: "a" sample_count: 1 }
+              buckets { label: "b" sample_count: 1 }
+            }
+          }
+        })");
+  const DatasetFeatureStatistics prev_span_statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 4
+        features: {
+          name: 'foo'
+          type: STRING
+          string_stats: {
+            common_stats: { num_non_missing: 4 max_num_values: 1 }
+            rank_histogram {
+              buckets { label: "a" sample_count: 3 }
+              buckets { label: "b" sample_count: 1 }
+            }
+          }
+        })");
+  const Validator validator(schema, /*environment=*/absl::nullopt,
+                            ValidationConfig());
+  tensorflow::metadata::v0::Anomalies expected;
+  TF_ASSERT_OK(validator.Validate(
+      statistics, prev_span_statistics,
+      /*serving_feature_statistics=*/absl::nullopt,
+      /*prev_version_feature_statistics=*/absl::nullopt,
+      /*features_needed=*/absl::nullopt, /*enable_diff_regions=*/false,
+      &expected));
+  ASSERT_EQ(expected.anomaly_info_size(), 1);
+
+  // Profiling does not change the result. There is one anomaly, so the
+  // serialization is deterministic.
+  tensorflow::metadata::v0::Anomalies actual;
+  ValidationProfile profile;
+  TF_ASSERT_OK(validator.Validate(
+      statistics, prev_span_statistics,
+      /*serving_feature_statistics=*/absl::nullopt,
+      /*prev_version_feature_statistics=*/absl::nullopt,
+      /*features_needed=*/absl::nullopt, /*enable_diff_regions=*/false,
+      &actual, &profile));
+  EXPECT_THAT(actual, EqualsProto(expected));
+  EXPECT_EQ(profile.num_features_visited(), 1);
+  EXPECT_EQ(profile.num_anomalies(), 1);
+  EXPECT_EQ(profile.num_comparator_evaluations(), 1);
+  EXPECT_GT(profile.num_schema_copies(), 0);
+
+  string actual_proto_string;
+  profile.Clear();
+  TF_ASSERT_OK(validator.ValidateWithSerializedInputs(
+      statistics.SerializeAsString(), prev_span_statistics.SerializeAsString(),
+      /*serving_statistics_proto_string=*/"",
+      /*previous_version_statistics_proto_string=*/"",
+      /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+      &actual_proto_string, &profile));
+  std::vector<string> stage_names;
+  for (const ValidationProfile::Stage& stage : profile.stage()) {
+    EXPECT_GE(stage.wall_time_micros(), 0);
+    EXPECT_GE(stage.cpu_time_micros(), 0);
+    stage_names.push_back(stage.name());
+  }
+  EXPECT_EQ(stage_names,
+            std::vector<string>({"parse_features_needed", "parse",
+                                 "build_views", "find_feature_changes",
+                                 "find_missing_features",
+                                 "find_dataset_changes", "get_schema_diff",
+                                 "serialize"}));
+  EXPECT_EQ(profile.num_anomalies(), 1);
+  EXPECT_EQ(profile.num_comparator_evaluations(), 1);
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorWithSlowestFeatures) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      type: BYTES
+      drift_comparator { infinity_norm { threshold: 0.01 } }
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 2
+        features: {
+          name: 'foo'
+          type: STRING
+          string_stats: {
+            common_stats: { num_non_missing: 2 max_num_values: 1 }
+            rank_histogram { buckets { label: "a" sample_count: 2 } }
+          }
+        })");
+  ValidationConfig validation_config;
+  validation_config.set_num_slowest_features_profiled(10);
+  const Validator validator(schema, /*environment=*/absl::nullopt,
+                            validation_config);
+  tensorflow::metadata::v0::Anomalies result;
+  ValidationProfile profile;
+  TF_ASSERT_OK(validator.Validate(
+      statistics, /*prev_span_feature_statistics=*/statistics,
+      /*serving_feature_statistics=*/absl::nullopt,
+      /*prev_version_feature_statistics=*/absl::nullopt,
+      /*features_needed=*/absl::nullopt, /*enable_diff_regions=*/false,
+      &result, &profile));
+  // The update of "foo" includes its drift comparator.
+  ASSERT_EQ(profile.slowest_feature_size(), 2);
+  std::set<string> stages;
+  for (const ValidationProfile::FeatureCost& cost :
+       profile.slowest_feature()) {
+    EXPECT_EQ(Path(cost.path()), Path({"foo"}));
+    EXPECT_GT(cost.input_size(), 0);
+    stages.insert(cost.stage());
+  }
+  EXPECT_EQ(stages, std::set<string>({"update", "drift_comparator"}));
+  EXPECT_GE(profile.slowest_feature(0).wall_time_nanos(),
+            profile.slowest_feature(1).wall_time_nanos());
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorWithMemoryBudget) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      type: BYTES
+      drift_comparator { infinity_norm { threshold: 0.01 } }
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 2
+        features: {
+          name: 'foo'
+          type: STRING
+          string_stats: {
+            common_stats: { num_non_missing: 2 max_num_values: 1 }
+            rank_histogram { buckets { label: "a" sample_count: 2 } }
+          }
+        })");
+  const DatasetFeatureStatistics prev_span_statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 2
+        features: {
+          name: 'foo'
+          type: STRING
+          string_stats: {
+            common_stats: { num_non_missing: 2 max_num_values: 1 }
+            rank_histogram { buckets { label: "b" sample_count: 2 } }
+          }
+        })");
+  const auto validate = [&](int64 memory_budget_bytes,
+                            bool enable_diff_regions,
+                            tensorflow::metadata::v0::Anomalies* result,
+                            ValidationProfile* profile) {
+    ValidationConfig validation_config;
+    validation_config.set_memory_budget_bytes(memory_budget_bytes);
+    const Validator validator(schema, /*environment=*/absl::nullopt,
+                              validation_config);
+    return validator.Validate(
+        statistics, prev_span_statistics,
+        /*serving_feature_statistics=*/absl::nullopt,
+        /*prev_version_feature_statistics=*/absl::nullopt,
+        /*features_needed=*/absl::nullopt, enable_diff_regions, result,
+        profile);
+  };
+
+  // Without a budget, the memory is only profiled.
+  tensorflow::metadata::v0::Anomalies with_diff_regions;
+  ValidationProfile profile;
+  TF_ASSERT_OK(validate(/*memory_budget_bytes=*/0,
+                        /*enable_diff_regions=*/true, &with_diff_regions,
+                        &profile));
+  const ValidationProfile::Memory& memory = profile.memory();
+  EXPECT_GT(memory.input_bytes(), 0);
+  EXPECT_GT(memory.view_bytes(), 0);
+  EXPECT_GT(memory.anomaly_bytes(), 0);
+  EXPECT_GT(memory.output_bytes(), 0);
+  EXPECT_EQ(memory.peak_bytes(), memory.input_bytes() + memory.view_bytes() +
+                                     memory.anomaly_bytes() +
+                                     memory.output_bytes());
+  EXPECT_FALSE(memory.diff_regions_dropped());
+  ASSERT_EQ(with_diff_regions.anomaly_info_size(), 1);
+  const AnomalyInfo& anomaly_info =
+      with_diff_regions.anomaly_info().begin()->second;
+  ASSERT_GT(anomaly_info.diff_regions_size(), 0);
+
+  tensorflow::metadata::v0::Anomalies without_diff_regions;
+  ValidationProfile profile_without_diff_regions;
+  TF_ASSERT_OK(validate(/*memory_budget_bytes=*/0,
+                        /*enable_diff_regions=*/false, &without_diff_regions,
+                        &profile_without_diff_regions));
+
+  // A budget that only fits the result without diff regions drops them. There
+  // is one anomaly, so the serialization is deterministic.
+  tensorflow::metadata::v0::Anomalies actual;
+  TF_ASSERT_OK(validate(profile_without_diff_regions.memory().peak_bytes(),
+                        /*enable_diff_regions=*/true, &actual,
+                        /*profile=*/nullptr));
+  EXPECT_THAT(actual, EqualsProto(without_diff_regions));
+
+  // A budget that does not even fit the inputs fails the validation, and the
+  // profile shows where the memory went.
+  profile.Clear();
+  const Status status = validate(/*memory_budget_bytes=*/1,
+                                 /*enable_diff_regions=*/true, &actual,
+                                 &profile);
+  EXPECT_EQ(status.code(), error::RESOURCE_EXHAUSTED);
+  EXPECT_GT(profile.memory().input_bytes(), 0);
+  EXPECT_EQ(profile.memory().view_bytes(), 0);
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorInEnvironments) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    default_environment: "TRAINING"
+    default_environment: "SERVING"
+    feature {
+      name: "foo"
+      presence: { min_count: 1 }
+      type: INT
+    }
+    feature {
+      name: "label"
+      presence: { min_count: 1 }
+      not_in_environment: "SERVING"
+      type: INT
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'foo'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        }
+        features: {
+          name: 'label'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })");
+  const std::vector<absl::optional<string>> environments = {
+      string("TRAINING"), string("SERVING"), absl::nullopt};
+  const Validator validator(schema, /*environment=*/absl::nullopt,
+                            ValidationConfig());
+  std::vector<tensorflow::metadata::v0::Anomalies> actual;
+  TF_ASSERT_OK(validator.ValidateInEnvironments(
+      statistics, /*prev_span_feature_statistics=*/absl::nullopt,
+      /*serving_feature_statistics=*/absl::nullopt,
+      /*prev_version_feature_statistics=*/absl::nullopt,
+      /*features_needed=*/absl::nullopt, environments,
+      /*enable_diff_regions=*/false, &actual));
+  std::vector<string> actual_proto_strings;
+  TF_ASSERT_OK(validator.ValidateInEnvironmentsWithSerializedInputs(
+      statistics.SerializeAsString(),
+      /*previous_span_statistics_proto_string=*/"",
+      /*serving_statistics_proto_string=*/"",
+      /*previous_version_statistics_proto_string=*/"",
+      /*features_needed_string=*/"", {"TRAINING", "SERVING", ""},
+      /*enable_diff_regions=*/false, &actual_proto_strings));
+  ASSERT_EQ(actual.size(), environments.size());
+  ASSERT_EQ(actual_proto_strings.size(), environments.size());
+  for (int i = 0; i < environments.size(); ++i) {
+    // Same as validating in each environment separately. There is at most one
+    // anomaly, so the serialization is deterministic.
+    tensorflow::metadata::v0::Anomalies expected;
+    const Validator environment_validator(schema, environments[i],
+                                          ValidationConfig());
+    TF_ASSERT_OK(environment_validator.Validate(
+        statistics, /*prev_span_feature_statistics=*/absl::nullopt,
+        /*serving_feature_statistics=*/absl::nullopt,
+        /*prev_version_feature_statistics=*/absl::nullopt,
+        /*features_needed=*/absl::nullopt, /*enable_diff_regions=*/false,
+        &expected));
+    EXPECT_THAT(actual[i], EqualsProto(expected));
+    tensorflow::metadata::v0::Anomalies parsed;
+    ASSERT_TRUE(parsed.ParseFromString(actual_proto_strings[i]));
+    EXPECT_THAT(parsed, EqualsProto(expected));
+  }
+  // label is found in SERVING, where it is not expected.
+  EXPECT_EQ(actual[0].anomaly_info_size(), 0);
+  EXPECT_EQ(actual[1].anomaly_info_size(), 1);
+  EXPECT_EQ(actual[2].anomaly_info_size(), 0);
+}
+
+// Counts the results that are found in the cache.
+class CountingFeatureValidationCache : public InMemoryFeatureValidationCache {
+ public:
+  bool Get(uint64 fingerprint, FeatureValidationResult* result) override {
+    if (InMemoryFeatureValidationCache::Get(fingerprint, result)) {
+      ++hits;
+      return true;
+    }
+    return false;
+  }
+
+  int hits = 0;
+};
+
+TEST(FeatureStatisticsValidatorTest, ValidateWithAndWithoutWeights) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "present"
+      presence: { min_fraction: 1 min_count: 1 }
+      type: INT
+    }
+    feature {
+      name: "typed"
+      value_count: { min: 1 max: 1 }
+      int_domain: { min: 0 max: 10 }
+      type: INT
+    })");
+  // "present" is in every example, but not by weight. The anomaly of
+  // "typed" does not depend on the weights.
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        weighted_num_examples: 6
+        features: {
+          name: 'present'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+              weighted_common_stats: { num_non_missing: 3 num_missing: 3 }
+            }
+          }
+        }
+        features: {
+          name: 'typed'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+              weighted_common_stats: { num_non_missing: 6 }
+            }
+            min: 0
+            max: 20
+          }
+        })");
+  auto cache = std::make_shared<CountingFeatureValidationCache>();
+  const Validator validator(schema, /*environment=*/absl::nullopt,
+                            ValidationConfig(), cache);
+  tensorflow::metadata::v0::Anomalies unweighted;
+  tensorflow::metadata::v0::Anomalies weighted;
+  TF_ASSERT_OK(validator.ValidateWithAndWithoutWeights(
+      statistics, /*prev_span_feature_statistics=*/absl::nullopt,
+      /*serving_feature_statistics=*/absl::nullopt,
+      /*prev_version_feature_statistics=*/absl::nullopt,
+      /*features_needed=*/absl::nullopt, /*enable_diff_regions=*/false,
+      &unweighted, &weighted));
+  // The anomalies of "typed" are found once.
+  EXPECT_EQ(cache->hits, 1);
+
+  // Same as validating the statistics by weight, and without their weights.
+  tensorflow::metadata::v0::Anomalies expected_weighted;
+  TF_ASSERT_OK(ValidateFeatureStatistics(
+      statistics, schema, /*environment=*/absl::nullopt,
+      /*prev_span_feature_statistics=*/absl::nullopt,
+      /*serving_feature_statistics=*/absl::nullopt,
+      /*prev_version_feature_statistics=*/absl::nullopt,
+      /*features_needed=*/absl::nullopt, ValidationConfig(),
+      /*enable_diff_regions=*/false, &expected_weighted));
+  ExpectSameAnomalies(weighted, expected_weighted);
+  DatasetFeatureStatistics unweighted_statistics = statistics;
+  unweighted_statistics.clear_weighted_num_examples();
+  for (auto& feature : *unweighted_statistics.mutable_features()) {
+    feature.mutable_num_stats()
+        ->mutable_common_stats()
+        ->clear_weighted_common_stats();
+  }
+  tensorflow::metadata::v0::Anomalies expected_unweighted;
+  TF_ASSERT_OK(ValidateFeatureStatistics(
+      unweighted_statistics, schema, /*environment=*/absl::nullopt,
+      /*prev_span_feature_statistics=*/absl::nullopt,
+      /*serving_feature_statistics=*/absl::nullopt,
+      /*prev_version_feature_statistics=*/absl::nullopt,
+      /*features_needed=*/absl::nullopt, ValidationConfig(),
+      /*enable_diff_regions=*/false, &expected_unweighted));
+  ExpectSameAnomalies(unweighted, expected_unweighted);
+  EXPECT_EQ(unweighted.anomaly_info().count("present"), 0);
+  EXPECT_EQ(weighted.anomaly_info().count("present"), 1);
+  EXPECT_EQ(unweighted.anomaly_info().count("typed"), 1);
+  EXPECT_EQ(weighted.anomaly_info().count("typed"), 1);
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidateShards) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      presence: { min_fraction: 1 min_count: 1 }
+      value_count: { min: 1 max: 1 }
+      type: INT
+    })");
+  // foo is in every example of the first shard, but missing from the second.
+  const DatasetFeatureStatistics first_shard =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 5
+        features: {
+          name: 'foo'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 5
+              min_num_values: 1
+              max_num_values: 1
+              tot_num_values: 5
+            }
+          }
+        })");
+  const DatasetFeatureStatistics second_shard =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 5)");
+  const string first_shard_proto_string = first_shard.SerializeAsString();
+  const string second_shard_proto_string = second_shard.SerializeAsString();
+  for (const int num_threads : {1, 4}) {
+    ValidationConfig validation_config;
+    validation_config.set_num_threads(num_threads);
+    const Validator validator(schema, /*environment=*/absl::nullopt,
+                              validation_config);
+    string anomalies_proto_string;
+    TF_ASSERT_OK(validator.ValidateShardsWithSerializedInputs(
+        {first_shard_proto_string},
+        /*previous_span_statistics_proto_string=*/"",
+        /*serving_statistics_proto_string=*/"",
+        /*previous_version_statistics_proto_string=*/"",
+        /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+        &anomalies_proto_string));
+    tensorflow::metadata::v0::Anomalies anomalies;
+    ASSERT_TRUE(anomalies.ParseFromString(anomalies_proto_string));
+    EXPECT_EQ(anomalies.anomaly_info_size(), 0);
+
+    TF_ASSERT_OK(validator.ValidateShardsWithSerializedInputs(
+        {first_shard_proto_string, second_shard_proto_string},
+        /*previous_span_statistics_proto_string=*/"",
+        /*serving_statistics_proto_string=*/"",
+        /*previous_version_statistics_proto_string=*/"",
+        /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+        &anomalies_proto_string));
+    ASSERT_TRUE(anomalies.ParseFromString(anomalies_proto_string));
+    EXPECT_EQ(anomalies.anomaly_info_size(), 1);
+    EXPECT_EQ(anomalies.anomaly_info().count("foo"), 1);
+
+    EXPECT_FALSE(validator
+                     .ValidateShardsWithSerializedInputs(
+                         {first_shard_proto_string, "not a proto"},
+                         /*previous_span_statistics_proto_string=*/"",
+                         /*serving_statistics_proto_string=*/"",
+                         /*previous_version_statistics_proto_string=*/"",
+                         /*features_needed_string=*/"",
+                         /*enable_diff_regions=*/false,
+                         &anomalies_proto_string)
+                     .ok());
+  }
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorIsThreadSafe) {
+  Schema schema;
+  DatasetFeatureStatistics statistics;
+  statistics.set_num_examples(10);
+  for (int i = 0; i < 100; ++i) {
+    const string name = absl::StrCat("feature_", i);
+    auto* feature = schema.add_feature();
+    feature->set_name(name);
+    feature->set_type(tensorflow::metadata::v0::INT);
+    feature->mutable_presence()->set_min_fraction(1.0);
+    auto* feature_stats = statistics.add_features();
+    feature_stats->set_name(name);
+    feature_stats->set_type(
+        tensorflow::metadata::v0::FeatureNameStatistics::INT);
+    auto* common_stats =
+        feature_stats->mutable_num_stats()->mutable_common_stats();
+    common_stats->set_num_non_missing(6 + i % 5);
+    common_stats->set_num_missing(4 - i % 5);
+    common_stats->set_min_num_values(1);
+    common_stats->set_max_num_values(1);
+  }
+  const Validator validator(schema, /*environment=*/absl::nullopt,
+                            ValidationConfig());
+  tensorflow::metadata::v0::Anomalies expected;
+  TF_ASSERT_OK(validator.Validate(
+      statistics, /*prev_span_feature_statistics=*/absl::nullopt,
+      /*serving_feature_statistics=*/absl::nullopt,
+      /*prev_version_feature_statistics=*/absl::nullopt,
+      /*features_needed=*/absl::nullopt, /*enable_diff_regions=*/false,
+      &expected));
+  EXPECT_EQ(expected.anomaly_info_size(), 80);
+
+  std::vector<tensorflow::metadata::v0::Anomalies> results(16);
+  std::vector<Status> statuses(results.size());
+  {
+    thread::ThreadPool thread_pool(Env::Default(), "validator_test", 4);
+    for (int i = 0; i < results.size(); ++i) {
+      thread_pool.Schedule([&, i]() {
+        statuses[i] = validator.Validate(
+            statistics, /*prev_span_feature_statistics=*/absl::nullopt,
+            /*serving_feature_statistics=*/absl::nullopt,
+            /*prev_version_feature_statistics=*/absl::nullopt,
+            /*features_needed=*/absl::nullopt, /*enable_diff_regions=*/false,
+            &results[i]);
+      });
+    }
+  }
+  for (int i = 0; i < results.size(); ++i) {
+    TF_ASSERT_OK(statuses[i]);
+    ExpectSameAnomalies(results[i], expected);
+  }
+}
+
+TEST(FeatureStatisticsValidatorTest, ValidatorFailsOnInvalidSchema) {
+  std::unique_ptr<Validator> validator;
+  EXPECT_FALSE(Validator::Create("invalid schema", /*environment=*/"",
+                                 ValidationConfig().SerializeAsString(),
+                                 &validator)
+                   .ok());
+}
+
 TEST(FeatureStatisticsValidatorUpdateSchema, TestLargeStringDomain) {
   DatasetFeatureStatistics statistics =
       ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
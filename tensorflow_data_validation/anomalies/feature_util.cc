@@ -18,7 +18,7 @@ limitations under the License.
 #include <string>
 
 #include "absl/strings/str_cat.h"
-#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "tensorflow_data_validation/anomalies/metrics.h"
 #include "tensorflow/core/lib/core/errors.h"
@@ -34,6 +34,7 @@ using absl::optional;
 using ::tensorflow::metadata::v0::AnomalyInfo;
 using ::tensorflow::metadata::v0::Feature;
 using ::tensorflow::metadata::v0::FeatureComparator;
+using ::tensorflow::metadata::v0::Histogram;
 using ::tensorflow::metadata::v0::SparseFeature;
 using ::tensorflow::metadata::v0::ValueCount;
 using ::tensorflow::metadata::v0::WeightedFeature;
@@ -187,11 +188,11 @@ std::vector<Description> UpdateValueCounts(
     if (feature->value_counts().value_count(i).has_min() &&
         min_max_num_values[i].first <
             feature->value_counts().value_count(i).min()) {
-      description.push_back(
-          {AnomalyInfo::FEATURE_TYPE_LOW_NUMBER_VALUES, kMissingValues,
-           absl::StrCat("Some examples have fewer values than expected at "
-                        "nestedness level ",
-                        i, ".")});
+      description.push_back(Description::FromTemplate(
+          AnomalyInfo::FEATURE_TYPE_LOW_NUMBER_VALUES, kMissingValues,
+          "Some examples have fewer values than expected at nestedness level "
+          "$0.",
+          {i}));
       if (min_max_num_values[i].first == 0) {
         feature->mutable_value_counts()->mutable_value_count(i)->clear_min();
       } else {
@@ -202,11 +203,11 @@ std::vector<Description> UpdateValueCounts(
     if (feature->mutable_value_counts()->mutable_value_count(i)->has_max() &&
         min_max_num_values[i].second >
             feature->value_counts().value_count(i).max()) {
-      description.push_back(
-          {AnomalyInfo::FEATURE_TYPE_HIGH_NUMBER_VALUES, kSuperfluousValues,
-           absl::StrCat("Some examples have more values than expected at "
-                        "nestedness level ",
-                        i, ".")});
+      description.push_back(Description::FromTemplate(
+          AnomalyInfo::FEATURE_TYPE_HIGH_NUMBER_VALUES, kSuperfluousValues,
+          "Some examples have more values than expected at nestedness level "
+          "$0.",
+          {i}));
       feature->mutable_value_counts()->mutable_value_count(i)->set_max(
           min_max_num_values[i].second);
     }
@@ -283,20 +284,53 @@ struct SingleFeatureComparisonResult {
 // If the comparator contains an infinity norm threshold, checks whether the
 // L-infinity distance between the stats and control stats is within that
 // threshold. If not, updates the comparator and returns a description of the
-// anomaly.
+// anomaly. If approximate is true, the distance is approximated from the
+// top-K values of the stats (see ApproximateLInftyDistance(...)). If
+// numeric is true, the distance of numeric features, which have no string
+// values, is the Kolmogorov-Smirnov distance between their QUANTILES
+// histograms (see GetQuantilesDistances(...)).
 SingleFeatureComparisonResult UpdateInfinityNormComparator(
-    const FeatureStatsView& stats, const FeatureStatsView& control_stats,
-    const ComparatorContext& context,
+    const FeatureDistribution& stats,
+    const FeatureDistribution& control_stats, const ComparatorContext& context,
+    bool approximate, bool numeric,
     tensorflow::metadata::v0::FeatureComparator* comparator) {
   SingleFeatureComparisonResult result;
   if (!comparator->infinity_norm().has_threshold()) {
     return result;
   }
   const double linf_threshold = comparator->infinity_norm().threshold();
-  const std::pair<std::string, double> linf_distance =
-      LInftyDistance(stats, control_stats);
-  const std::string max_difference_value = linf_distance.first;
-  const double stats_infinity_norm = linf_distance.second;
+  absl::string_view max_difference_value;
+  double stats_infinity_norm;
+  string error_description;
+  string numeric_max_difference_value;
+  const Histogram* quantiles =
+      numeric ? stats.stats().GetQuantilesHistogramOrNull() : nullptr;
+  const Histogram* control_quantiles =
+      numeric ? control_stats.stats().GetQuantilesHistogramOrNull() : nullptr;
+  QuantilesDistances quantiles_distances;
+  if (stats.stats().GetStringValueTable().empty() &&
+      control_stats.stats().GetStringValueTable().empty() &&
+      quantiles != nullptr && control_quantiles != nullptr &&
+      GetQuantilesDistances(*quantiles, *control_quantiles,
+                            &quantiles_distances)
+          .ok()) {
+    numeric_max_difference_value =
+        absl::StrCat(quantiles_distances.kolmogorov_smirnov_value);
+    max_difference_value = numeric_max_difference_value;
+    stats_infinity_norm = quantiles_distances.kolmogorov_smirnov;
+  } else if (approximate) {
+    const ApproximateDistance linf_distance =
+        ApproximateLInftyDistance(stats, control_stats, linf_threshold);
+    max_difference_value = linf_distance.value;
+    stats_infinity_norm = linf_distance.distance;
+    error_description = absl::StrCat(" within ",
+                                     absl::SixDigits(linf_distance.error));
+  } else {
+    const std::pair<absl::string_view, double> linf_distance =
+        LInftyDistance(stats, control_stats);
+    max_difference_value = linf_distance.first;
+    stats_infinity_norm = linf_distance.second;
+  }
   result.measurement.emplace();
   result.measurement->set_value(stats_infinity_norm);
   result.measurement->set_threshold(linf_threshold);
@@ -305,21 +339,16 @@ SingleFeatureComparisonResult UpdateInfinityNormComparator(
   if (stats_infinity_norm <= linf_threshold) {
     return result;
   }
-  // TODO(b/68711199): Add support for Linf with numeric features, or log a
-  // warning where the user has specified an infinity_norm threshold for a
-  // numeric feature.
   comparator->mutable_infinity_norm()->set_threshold(stats_infinity_norm);
-  result.description = Description(
-      {tensorflow::metadata::v0::AnomalyInfo::COMPARATOR_L_INFTY_HIGH,
-       absl::StrCat("High Linfty distance between ", context.treatment_name,
-                    " and ", context.control_name),
-       absl::StrCat("The Linfty distance between ", context.treatment_name,
-                    " and ", context.control_name, " is ",
-                    absl::SixDigits(stats_infinity_norm),
-                    " (up to six significant digits), above the threshold ",
-                    absl::SixDigits(linf_threshold),
-                    ". The feature value with maximum difference is: ",
-                    max_difference_value)});
+  result.description = Description::FromTemplate(
+      tensorflow::metadata::v0::AnomalyInfo::COMPARATOR_L_INFTY_HIGH,
+      absl::StrCat("High Linfty distance between ", context.treatment_name,
+                   " and ", context.control_name),
+      "The Linfty distance between $0 and $1 is $2 (up to six significant "
+      "digits$3), above the threshold $4. The feature value with maximum "
+      "difference is: $5",
+      {context.treatment_name, context.control_name, stats_infinity_norm,
+       std::move(error_description), linf_threshold, max_difference_value});
   return result;
 }
 
@@ -328,8 +357,8 @@ SingleFeatureComparisonResult UpdateInfinityNormComparator(
 // control stats is within that threshold. If not, updates the comparator and
 // returns a description of the anomaly.
 SingleFeatureComparisonResult UpdateJensenShannonDivergenceComparator(
-    const FeatureStatsView& stats, const FeatureStatsView& control_stats,
-    const ComparatorContext& context,
+    const FeatureDistribution& stats,
+    const FeatureDistribution& control_stats, const ComparatorContext& context,
     tensorflow::metadata::v0::FeatureComparator* comparator) {
   SingleFeatureComparisonResult result;
   if (!comparator->jensen_shannon_divergence().has_threshold()) {
@@ -347,23 +376,22 @@ SingleFeatureComparisonResult UpdateJensenShannonDivergenceComparator(
     result.measurement->set_type(
         metadata::v0::DriftSkewInfo_Measurement_Type_JENSEN_SHANNON_DIVERGENCE);
     if (jensen_shannon_divergence > jensen_shannon_threshold) {
-      result.description = Description(
-          {tensorflow::metadata::v0::AnomalyInfo::
-               COMPARATOR_JENSEN_SHANNON_DIVERGENCE_HIGH,
-           absl::StrCat("High approximate Jensen-Shannon divergence between ",
-                        context.treatment_name, " and ", context.control_name),
-           absl::StrCat("The approximate Jensen-Shannon divergence between ",
-                        context.treatment_name, " and ", context.control_name,
-                        " is ", absl::SixDigits(jensen_shannon_divergence),
-                        " (up to six significant digits), above the threshold ",
-                        absl::SixDigits(jensen_shannon_threshold), ".")});
+      result.description = Description::FromTemplate(
+          tensorflow::metadata::v0::AnomalyInfo::
+              COMPARATOR_JENSEN_SHANNON_DIVERGENCE_HIGH,
+          absl::StrCat("High approximate Jensen-Shannon divergence between ",
+                       context.treatment_name, " and ", context.control_name),
+          "The approximate Jensen-Shannon divergence between $0 and $1 is $2 "
+          "(up to six significant digits), above the threshold $3.",
+          {context.treatment_name, context.control_name,
+           jensen_shannon_divergence, jensen_shannon_threshold});
       comparator->mutable_jensen_shannon_divergence()->set_threshold(
           jensen_shannon_divergence);
     }
   } else {
     // TODO(b/68711199): Add support for using JSD with categorical features.
     LOG(WARNING) << "A jensen_shannon_divergence threshold for feature "
-                 << stats.GetPath().Serialize()
+                 << stats.stats().GetPath().Serialize()
                  << ", but the stats for this feature do not include a "
                     "histogram from which the divergence can be analyzed. The "
                     "jensen_shannon_divergence can be specified for a "
@@ -401,6 +429,19 @@ bool WeightedFeatureIsDeprecated(const WeightedFeature& weighted_feature) {
 FeatureComparisonResult UpdateFeatureComparatorDirect(
     const FeatureStatsView& stats, const FeatureComparatorType comparator_type,
     tensorflow::metadata::v0::FeatureComparator* comparator) {
+  return UpdateFeatureComparatorDirect(FeatureDistribution(stats),
+                                       comparator_type,
+                                       /*approximate_infinity_norm=*/false,
+                                       /*numeric_infinity_norm=*/false,
+                                       comparator);
+}
+
+FeatureComparisonResult UpdateFeatureComparatorDirect(
+    const FeatureDistribution& distribution,
+    const FeatureComparatorType comparator_type,
+    bool approximate_infinity_norm, bool numeric_infinity_norm,
+    tensorflow::metadata::v0::FeatureComparator* comparator) {
+  const FeatureStatsView& stats = distribution.stats();
   FeatureComparisonResult result;
   if (!comparator->infinity_norm().has_threshold() &&
       !comparator->jensen_shannon_divergence().has_threshold()) {
@@ -411,8 +452,11 @@ FeatureComparisonResult UpdateFeatureComparatorDirect(
   const absl::optional<FeatureStatsView> control_stats =
       GetControlStats(stats, comparator_type);
   if (control_stats) {
+    const FeatureDistribution control_distribution(control_stats.value());
     const SingleFeatureComparisonResult linfty_result =
-        UpdateInfinityNormComparator(stats, control_stats.value(), context,
+        UpdateInfinityNormComparator(distribution, control_distribution,
+                                     context, approximate_infinity_norm,
+                                     numeric_infinity_norm,
                                      comparator);
     if (linfty_result.description) {
       result.descriptions.push_back(*linfty_result.description);
@@ -421,8 +465,8 @@ FeatureComparisonResult UpdateFeatureComparatorDirect(
       result.measurements.push_back(*linfty_result.measurement);
     }
     const SingleFeatureComparisonResult jensen_shannon_result =
-        UpdateJensenShannonDivergenceComparator(stats, control_stats.value(),
-                                                context, comparator);
+        UpdateJensenShannonDivergenceComparator(
+            distribution, control_distribution, context, comparator);
     if (jensen_shannon_result.description) {
       result.descriptions.push_back(*jensen_shannon_result.description);
     }
@@ -441,10 +485,10 @@ FeatureComparisonResult UpdateFeatureComparatorDirect(
     if (comparator->jensen_shannon_divergence().has_threshold()) {
       comparator->mutable_jensen_shannon_divergence()->clear_threshold();
     }
-    result.descriptions = {
-        {AnomalyInfo::COMPARATOR_CONTROL_DATA_MISSING,
-         absl::StrCat(context.control_name, " data missing"),
-         absl::StrCat(context.control_name, " data is missing.")}};
+    result.descriptions = {Description::FromTemplate(
+        AnomalyInfo::COMPARATOR_CONTROL_DATA_MISSING,
+        absl::StrCat(context.control_name, " data missing"),
+        "$0 data is missing.", {context.control_name})};
     return result;
   }
   // If there is no control dataset at all, return without generating an
@@ -452,6 +496,32 @@ FeatureComparisonResult UpdateFeatureComparatorDirect(
   return result;
 }
 
+std::vector<tensorflow::metadata::v0::DriftSkewInfo::Measurement>
+GetComparatorMeasurements(
+    const FeatureDistribution& distribution,
+    const FeatureDistribution& control_distribution,
+    const FeatureComparatorType comparator_type,
+    bool approximate_infinity_norm, bool numeric_infinity_norm,
+    const tensorflow::metadata::v0::FeatureComparator& comparator) {
+  std::vector<tensorflow::metadata::v0::DriftSkewInfo::Measurement> result;
+  const ComparatorContext& context = GetContext(comparator_type);
+  // The comparators update their copy, which is then discarded.
+  tensorflow::metadata::v0::FeatureComparator updated_comparator = comparator;
+  for (const SingleFeatureComparisonResult& comparison_result :
+       {UpdateInfinityNormComparator(distribution, control_distribution,
+                                     context, approximate_infinity_norm,
+                                     numeric_infinity_norm,
+                                     &updated_comparator),
+        UpdateJensenShannonDivergenceComparator(
+            distribution, control_distribution, context,
+            &updated_comparator)}) {
+    if (comparison_result.measurement) {
+      result.push_back(*comparison_result.measurement);
+    }
+  }
+  return result;
+}
+
 double GetMaxOffDomain(const tensorflow::metadata::v0::DistributionConstraints&
                            distribution_constraints) {
   return distribution_constraints.has_min_domain_mass()
@@ -557,12 +627,11 @@ std::vector<Description> UpdateFeatureShape(
              "nested level) or its value lengths vary."}};
   } else if (actual_fixed_value_counts != expected_fixed_value_counts) {
     feature->clear_shape();
-    return {
-        {AnomalyInfo::INVALID_FEATURE_SHAPE,
-         "Feature shape dropped",
-         absl::StrCat("The feature has fixed value length ",
-                      actual_fixed_value_counts,
-                      " but it's not compatible with the specified shape.")}};
+    return {Description::FromTemplate(
+        AnomalyInfo::INVALID_FEATURE_SHAPE, "Feature shape dropped",
+        "The feature has fixed value length $0 but it's not compatible with "
+        "the specified shape.",
+        {actual_fixed_value_counts})};
   }
 
   return {};
@@ -577,11 +646,11 @@ std::vector<Description> UpdatePresence(
     if (*num_present < presence->min_count()) {
       int64 original_min_count = presence->min_count();
       presence->set_min_count(*num_present);
-      descriptions.push_back(
-          {AnomalyInfo::FEATURE_TYPE_LOW_NUMBER_PRESENT, kDropped,
-           absl::StrFormat("The feature was present in fewer examples than "
-                           "expected: minimum count = %d, actual = %d",
-                           original_min_count, presence->min_count())});
+      descriptions.push_back(Description::FromTemplate(
+          AnomalyInfo::FEATURE_TYPE_LOW_NUMBER_PRESENT, kDropped,
+          "The feature was present in fewer examples than expected: minimum "
+          "count = $0, actual = $1",
+          {original_min_count, presence->min_count()}));
     }
   }
   const optional<double> fraction_present =
@@ -590,11 +659,12 @@ std::vector<Description> UpdatePresence(
     if (*fraction_present < presence->min_fraction()) {
       float original_min_fraction = presence->min_fraction();
       presence->set_min_fraction(*fraction_present);
-      descriptions.push_back(
-          {AnomalyInfo::FEATURE_TYPE_LOW_FRACTION_PRESENT, kDropped,
-           absl::StrFormat("The feature was present in fewer examples than "
-                           "expected: minimum fraction = %f, actual = %f",
-                           original_min_fraction, presence->min_fraction())});
+      descriptions.push_back(Description::FromTemplate(
+          AnomalyInfo::FEATURE_TYPE_LOW_FRACTION_PRESENT, kDropped,
+          "The feature was present in fewer examples than expected: minimum "
+          "fraction = $0, actual = $1",
+          {DescriptionArg::Fixed(original_min_fraction),
+           DescriptionArg::Fixed(presence->min_fraction())}));
     }
     if (presence->min_fraction() == 1.0) {
       if (feature_stats_view.GetNumMissing() != 0.0) {
@@ -604,11 +674,11 @@ std::vector<Description> UpdatePresence(
         // 1.0.
         // TODO(b/148429185): update the anomaly type here to be unique.
         presence->set_min_fraction(0.9999);
-        descriptions.push_back(
-            {AnomalyInfo::FEATURE_TYPE_LOW_FRACTION_PRESENT, kDropped,
-             absl::StrCat(
-                 "The feature was expected everywhere, but was missing in ",
-                 feature_stats_view.GetNumMissing(), " examples.")});
+        descriptions.push_back(Description::FromTemplate(
+            AnomalyInfo::FEATURE_TYPE_LOW_FRACTION_PRESENT, kDropped,
+            "The feature was expected everywhere, but was missing in $0 "
+            "examples.",
+            {feature_stats_view.GetNumMissing()}));
       }
     }
   }
@@ -622,29 +692,25 @@ std::vector<Description> UpdateUniqueConstraints(
   const absl::optional<int> num_unique = feature_stats_view.GetNumUnique();
   if (num_unique) {
     if (num_unique < feature->unique_constraints().min()) {
-      descriptions.push_back(
-          {AnomalyInfo::FEATURE_TYPE_LOW_UNIQUE, "Low number of unique values",
-           absl::StrCat(
-               "Expected at least ", feature->unique_constraints().min(),
-               " unique values but found only ", num_unique.value(), ".")});
+      descriptions.push_back(Description::FromTemplate(
+          AnomalyInfo::FEATURE_TYPE_LOW_UNIQUE, "Low number of unique values",
+          "Expected at least $0 unique values but found only $1.",
+          {feature->unique_constraints().min(), num_unique.value()}));
       feature->mutable_unique_constraints()->set_min(num_unique.value());
     }
     if (num_unique > feature->unique_constraints().max()) {
-      descriptions.push_back(
-          {AnomalyInfo::FEATURE_TYPE_HIGH_UNIQUE,
-           "High number of unique values",
-           absl::StrCat("Expected no more than ",
-                        feature->unique_constraints().max(),
-                        " unique values but found ", num_unique.value(), ".")});
+      descriptions.push_back(Description::FromTemplate(
+          AnomalyInfo::FEATURE_TYPE_HIGH_UNIQUE, "High number of unique values",
+          "Expected no more than $0 unique values but found $1.",
+          {feature->unique_constraints().max(), num_unique.value()}));
       feature->mutable_unique_constraints()->set_max(num_unique.value());
     }
   } else {
-    descriptions.push_back(
-        {AnomalyInfo::FEATURE_TYPE_NO_UNIQUE, "No unique values",
-         absl::StrCat(
-             "UniqueConstraints specified for the feature, but unique values "
-             "were not counted (i.e., feature is not string or "
-             "categorical).")});
+    descriptions.push_back(Description::FromTemplate(
+        AnomalyInfo::FEATURE_TYPE_NO_UNIQUE, "No unique values",
+        "UniqueConstraints specified for the feature, but unique values were "
+        "not counted (i.e., feature is not string or categorical).",
+        {}));
     feature->clear_unique_constraints();
   }
   return descriptions;
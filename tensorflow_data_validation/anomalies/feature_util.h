@@ -21,6 +21,7 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow_data_validation/anomalies/internal_types.h"
+#include "tensorflow_data_validation/anomalies/metrics.h"
 #include "tensorflow_data_validation/anomalies/statistics_view.h"
 #include "tensorflow_metadata/proto/v0/schema.pb.h"
 #include "tensorflow_metadata/proto/v0/anomalies.pb.h"
@@ -71,6 +72,30 @@ FeatureComparisonResult UpdateFeatureComparatorDirect(
     const FeatureStatsView& stats, const FeatureComparatorType comparator_type,
     tensorflow::metadata::v0::FeatureComparator* comparator);
 
+// As above, sharing the prepared distribution of the feature with other
+// comparisons. If approximate_infinity_norm is true, the L-infinity distance
+// is approximated from the top-K values of the features (see
+// ApproximateLInftyDistance(...)). If numeric_infinity_norm is true, the
+// L-infinity distance of numeric features with QUANTILES histograms is their
+// Kolmogorov-Smirnov distance (see ValidationConfig.numeric_infinity_norm).
+FeatureComparisonResult UpdateFeatureComparatorDirect(
+    const FeatureDistribution& distribution,
+    const FeatureComparatorType comparator_type,
+    bool approximate_infinity_norm, bool numeric_infinity_norm,
+    tensorflow::metadata::v0::FeatureComparator* comparator);
+
+// Gets the measurements of the distances between distribution and
+// control_distribution that comparator has thresholds for. Unlike
+// UpdateFeatureComparatorDirect(...), this does not update the comparator, so
+// the same comparator can be measured against many controls.
+std::vector<tensorflow::metadata::v0::DriftSkewInfo::Measurement>
+GetComparatorMeasurements(
+    const FeatureDistribution& distribution,
+    const FeatureDistribution& control_distribution,
+    const FeatureComparatorType comparator_type,
+    bool approximate_infinity_norm, bool numeric_infinity_norm,
+    const tensorflow::metadata::v0::FeatureComparator& comparator);
+
 // Initializes presence and shape constraints (value counts or fixed shape)
 // given stats.
 // If `infer_fixed_shape` is true, try inferring a fixed shape for the feature,
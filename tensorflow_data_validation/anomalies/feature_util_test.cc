@@ -50,7 +50,7 @@ std::string DescriptionsToString(const std::vector<Description>& descriptions) {
   std::string result;
   for (const Description& description : descriptions) {
     absl::StrAppend(&result, "short:", description.short_description, "\n");
-    absl::StrAppend(&result, "long:", description.long_description, "\n");
+    absl::StrAppend(&result, "long:", description.GetLongDescription(), "\n");
   }
   return result;
 }
@@ -248,6 +248,71 @@ TEST(FeatureUtilTest, UpdateComparatorProposeNewThreshold) {
   }
 }
 
+TEST(FeatureUtilTest, UpdateComparatorNumericInfinityNormFromQuantiles) {
+  DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 4
+        features {
+          name: "num_feature"
+          type: FLOAT
+          num_stats {
+            common_stats {}
+            histograms {
+              buckets { low_value: 0.0 high_value: 1.0 sample_count: 2.0 }
+              buckets { low_value: 1.0 high_value: 2.0 sample_count: 2.0 }
+              type: QUANTILES
+            }
+          }
+        })");
+  DatasetFeatureStatistics previous_statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 4
+        features {
+          name: "num_feature"
+          type: FLOAT
+          num_stats {
+            common_stats {}
+            histograms {
+              buckets { low_value: 1.0 high_value: 2.0 sample_count: 2.0 }
+              buckets { low_value: 2.0 high_value: 3.0 sample_count: 2.0 }
+              type: QUANTILES
+            }
+          }
+        })");
+  DatasetStatsView stats_view(
+      statistics, false, "environment_name",
+      std::make_shared<DatasetStatsView>(previous_statistics),
+      std::shared_ptr<DatasetStatsView>(), std::shared_ptr<DatasetStatsView>());
+  const FeatureStatsView feature_stats_view =
+      stats_view.GetByPath(Path({"num_feature"})).value();
+  FeatureComparator comparator = ParseTextProtoOrDie<FeatureComparator>(R"(
+    infinity_norm: { threshold: 0.1 })");
+
+  // By default, the distance between numeric features is 0, as they have no
+  // string values.
+  auto result = UpdateFeatureComparatorDirect(
+      feature_stats_view, FeatureComparatorType::DRIFT, &comparator);
+  EXPECT_DOUBLE_EQ(comparator.infinity_norm().threshold(), 0.1);
+  EXPECT_TRUE(result.descriptions.empty());
+  ASSERT_EQ(result.measurements.size(), 1);
+  EXPECT_THAT(result.measurements[0],
+              EqualsProto("type: L_INFTY value: 0 threshold: 0.1"));
+
+  result = UpdateFeatureComparatorDirect(
+      FeatureDistribution(feature_stats_view), FeatureComparatorType::DRIFT,
+      /*approximate_infinity_norm=*/false, /*numeric_infinity_norm=*/true,
+      &comparator);
+  // Half of the values are below 1 in the current span, and none in the
+  // previous one.
+  EXPECT_DOUBLE_EQ(comparator.infinity_norm().threshold(), 0.5);
+  ASSERT_EQ(result.descriptions.size(), 1);
+  EXPECT_EQ(result.descriptions[0].type,
+            AnomalyInfo::COMPARATOR_L_INFTY_HIGH);
+  ASSERT_EQ(result.measurements.size(), 1);
+  EXPECT_THAT(result.measurements[0],
+              EqualsProto("type: L_INFTY value: 0.5 threshold: 0.1"));
+}
+
 TEST(FeatureUtilTest,
      UpdateComparatorWithoutControlFeatureStatsClearsThreshold) {
   DatasetFeatureStatistics statistics =
@@ -336,7 +401,7 @@ TEST(FeatureUtilTest,
       actual_descriptions[0].type,
       tensorflow::metadata::v0::AnomalyInfo::COMPARATOR_CONTROL_DATA_MISSING);
   EXPECT_EQ(actual_descriptions[0].short_description, "previous data missing");
-  EXPECT_EQ(actual_descriptions[0].long_description,
+  EXPECT_EQ(actual_descriptions[0].GetLongDescription(),
             "previous data is missing.");
   // Confirm that missing control data clears the comparator threshold.
   EXPECT_FALSE(comparator.infinity_norm().has_threshold());
@@ -521,11 +586,11 @@ TEST(FeatureUtilTest, UpdateUniqueConstraintsNumUniquesOutsideRange) {
 
   EXPECT_THAT(categorical_feature, EqualsProto(expected_categorical_feature));
   EXPECT_EQ(actual_categorical_descriptions.size(), 1);
-  EXPECT_EQ(actual_categorical_descriptions.at(0).long_description,
+  EXPECT_EQ(actual_categorical_descriptions.at(0).GetLongDescription(),
             "Expected no more than 2 unique values but found 5.");
   EXPECT_THAT(string_feature, EqualsProto(expected_string_feature));
   EXPECT_EQ(actual_string_descriptions.size(), 1);
-  EXPECT_EQ(actual_string_descriptions.at(0).long_description,
+  EXPECT_EQ(actual_string_descriptions.at(0).GetLongDescription(),
             "Expected at least 2 unique values but found only 1.");
 }
 
@@ -565,7 +630,7 @@ TEST(FeatureUtilTest, UpdateUniqueConstraintsNotStringOrCategorical) {
   // The unique_constraints are cleared, and an anomaly is generated.
   EXPECT_THAT(numeric_feature, EqualsProto(expected_numeric_feature));
   EXPECT_EQ(actual_numeric_descriptions.size(), 1);
-  EXPECT_EQ(actual_numeric_descriptions.at(0).long_description,
+  EXPECT_EQ(actual_numeric_descriptions.at(0).GetLongDescription(),
             "UniqueConstraints specified for the feature, but unique values "
             "were not counted (i.e., feature is not string or categorical).");
 }
@@ -1880,7 +1945,7 @@ TEST(FeatureTypeTest, RareMissingFeatureUnweighted) {
       UpdatePresence(*feature_stats_view, to_modify.mutable_presence());
   ASSERT_EQ(desc.size(), 1);
   EXPECT_EQ(
-      desc.at(0).long_description,
+      desc.at(0).GetLongDescription(),
       "The feature was expected everywhere, but was missing in 1 examples.");
 }
 
@@ -1927,7 +1992,7 @@ TEST(FeatureTypeTest, RareMissingFeatureWeighted) {
       UpdatePresence(*feature_stats_view, to_modify.mutable_presence());
   ASSERT_EQ(desc.size(), 1);
   EXPECT_EQ(
-      desc.at(0).long_description,
+      desc.at(0).GetLongDescription(),
       "The feature was expected everywhere, but was missing in 1 examples.");
 }
 
@@ -20,7 +20,6 @@ limitations under the License.
 #include <vector>
 
 #include "absl/strings/numbers.h"
-#include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
 #include "absl/types/variant.h"
 #include "tensorflow_data_validation/anomalies/internal_types.h"
@@ -129,9 +128,9 @@ void CheckFloatNans(const FeatureStatsView& stats,
       break;
   }
   if (has_nans) {
-    update_summary->descriptions.push_back(
-        {tensorflow::metadata::v0::AnomalyInfo::FLOAT_TYPE_HAS_NAN,
-         kInvalidValues, absl::StrCat("Float feature has NaN values.")});
+    update_summary->descriptions.push_back(Description::FromTemplate(
+        tensorflow::metadata::v0::AnomalyInfo::FLOAT_TYPE_HAS_NAN,
+        kInvalidValues, "Float feature has NaN values.", {}));
     float_domain->set_disallow_nan(false);
   }
 }
@@ -148,44 +147,39 @@ UpdateSummary UpdateFloatDomain(
   if (result) {
     const variant<FloatInterval, ExampleStringNotFloat> actual_result = *result;
     if (holds_alternative<ExampleStringNotFloat>(actual_result)) {
-      update_summary.descriptions.push_back(
-          {tensorflow::metadata::v0::AnomalyInfo::FLOAT_TYPE_STRING_NOT_FLOAT,
-           kInvalidValues,
-           absl::StrCat(
-               "String values that were not floats were found, such as \"",
-               *absl::get_if<ExampleStringNotFloat>(&actual_result), "\".")});
+      update_summary.descriptions.push_back(Description::FromTemplate(
+          tensorflow::metadata::v0::AnomalyInfo::FLOAT_TYPE_STRING_NOT_FLOAT,
+          kInvalidValues,
+          "String values that were not floats were found, such as \"$0\".",
+          {*absl::get_if<ExampleStringNotFloat>(&actual_result)}));
       update_summary.clear_field = true;
       return update_summary;
     }
     if (holds_alternative<FloatInterval>(actual_result)) {
       const FloatInterval range = *absl::get_if<FloatInterval>(&actual_result);
       if (float_domain->has_min() && range.min < float_domain->min()) {
-        update_summary.descriptions.push_back(
-            {tensorflow::metadata::v0::AnomalyInfo::FLOAT_TYPE_SMALL_FLOAT,
-             kOutOfRangeValues,
-             absl::StrCat(
-                 "Unexpectedly low values: ", absl::SixDigits(range.min), "<",
-                 absl::SixDigits(float_domain->min()),
-                 "(upto six significant digits)")});
+        update_summary.descriptions.push_back(Description::FromTemplate(
+            tensorflow::metadata::v0::AnomalyInfo::FLOAT_TYPE_SMALL_FLOAT,
+            kOutOfRangeValues,
+            "Unexpectedly low values: $0<$1(upto six significant digits)",
+            {range.min, float_domain->min()}));
         float_domain->set_min(range.min);
       }
 
       if (float_domain->has_max() && range.max > float_domain->max()) {
-        update_summary.descriptions.push_back(
-            {tensorflow::metadata::v0::AnomalyInfo::FLOAT_TYPE_BIG_FLOAT,
-             kOutOfRangeValues,
-             absl::StrCat(
-                 "Unexpectedly high value: ", absl::SixDigits(range.max), ">",
-                 absl::SixDigits(float_domain->max()),
-                 "(upto six significant digits)")});
+        update_summary.descriptions.push_back(Description::FromTemplate(
+            tensorflow::metadata::v0::AnomalyInfo::FLOAT_TYPE_BIG_FLOAT,
+            kOutOfRangeValues,
+            "Unexpectedly high value: $0>$1(upto six significant digits)",
+            {range.max, float_domain->max()}));
         float_domain->set_max(range.max);
       }
 
       if (float_domain->disallow_inf() &&
           (std::isinf(abs(range.min)) || std::isinf(abs(range.max)))) {
-        update_summary.descriptions.push_back(
-            {tensorflow::metadata::v0::AnomalyInfo::FLOAT_TYPE_HAS_INF,
-             kInvalidValues, absl::StrCat("Float feature has Inf values.")});
+        update_summary.descriptions.push_back(Description::FromTemplate(
+            tensorflow::metadata::v0::AnomalyInfo::FLOAT_TYPE_HAS_INF,
+            kInvalidValues, "Float feature has Inf values.", {}));
         float_domain->set_disallow_inf(false);
       }
     }
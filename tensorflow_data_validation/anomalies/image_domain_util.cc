@@ -19,7 +19,6 @@ limitations under the License.
 #include <string>
 #include <vector>
 
-#include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "tensorflow_data_validation/anomalies/internal_types.h"
 #include "tensorflow_data_validation/anomalies/map_util.h"
@@ -67,17 +66,15 @@ std::vector<Description> UpdateImageDomain(
           original_minimum_supported_image_fraction) {
         feature->mutable_image_domain()->set_minimum_supported_image_fraction(
             supported_image_fraction);
-        results.push_back(
-            {tensorflow::metadata::v0::AnomalyInfo::
-                 LOW_SUPPORTED_IMAGE_FRACTION,
-             "Low supported image fraction",
-             absl::StrCat(
-                 "Fraction of values containing TensorFlow supported "
-                 "images: ",
-                 std::to_string(supported_image_fraction),
-                 " is lower than the threshold set in the Schema: ",
-                 std::to_string(original_minimum_supported_image_fraction),
-                 ".")});
+        results.push_back(Description::FromTemplate(
+            tensorflow::metadata::v0::AnomalyInfo::
+                LOW_SUPPORTED_IMAGE_FRACTION,
+            "Low supported image fraction",
+            "Fraction of values containing TensorFlow supported images: $0 "
+            "is lower than the threshold set in the Schema: $1.",
+            {DescriptionArg::Fixed(supported_image_fraction),
+             DescriptionArg::Fixed(
+                 original_minimum_supported_image_fraction)}));
       }
     } else {
       LOG(WARNING)
@@ -96,12 +93,11 @@ std::vector<Description> UpdateImageDomain(
     const int64_t max_allowed_bytes = image_domain.max_image_byte_size();
     if (max_bytes_stat > max_allowed_bytes) {
       feature->mutable_image_domain()->set_max_image_byte_size(max_bytes_stat);
-      results.push_back(
-          {tensorflow::metadata::v0::AnomalyInfo::MAX_IMAGE_BYTE_SIZE_EXCEEDED,
-           "Num bytes exceeds the max byte size.",
-           absl::StrCat("The largest image has bytes: ", max_bytes_stat,
-                        ". The max allowed byte size is: ", max_allowed_bytes,
-                        ".")});
+      results.push_back(Description::FromTemplate(
+          tensorflow::metadata::v0::AnomalyInfo::MAX_IMAGE_BYTE_SIZE_EXCEEDED,
+          "Num bytes exceeds the max byte size.",
+          "The largest image has bytes: $0. The max allowed byte size is: $1.",
+          {max_bytes_stat, max_allowed_bytes}));
     }
   }
   return results;
@@ -0,0 +1,85 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/internal_types.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+DescriptionArg DescriptionArg::Fixed(double value) {
+  return DescriptionArg(FixedDouble{value});
+}
+
+void DescriptionArg::AppendTo(string* output) const {
+  if (const FixedDouble* fixed = absl::get_if<FixedDouble>(&value_)) {
+    absl::StrAppendFormat(output, "%f", fixed->value);
+    return;
+  }
+  if (const double* value = absl::get_if<double>(&value_)) {
+    absl::StrAppend(output, absl::SixDigits(*value));
+    return;
+  }
+  if (const int64* value = absl::get_if<int64>(&value_)) {
+    absl::StrAppend(output, *value);
+    return;
+  }
+  if (const uint64* value = absl::get_if<uint64>(&value_)) {
+    absl::StrAppend(output, *value);
+    return;
+  }
+  output->append(absl::get<string>(value_));
+}
+
+Description Description::FromTemplate(
+    tensorflow::metadata::v0::AnomalyInfo::Type type,
+    string short_description, const char* long_template,
+    std::vector<DescriptionArg> args) {
+  Description result = {type, std::move(short_description)};
+  result.long_template = long_template;
+  result.args = std::move(args);
+  return result;
+}
+
+string Description::GetLongDescription() const {
+  if (long_template == nullptr) {
+    return long_description;
+  }
+  string result;
+  for (const char* p = long_template; *p != '\0'; ++p) {
+    if (p[0] == '$' && absl::ascii_isdigit(p[1])) {
+      const int index = p[1] - '0';
+      DCHECK_LT(index, args.size()) << "In template: " << long_template;
+      if (index < args.size()) {
+        args[index].AppendTo(&result);
+      }
+      ++p;
+    } else {
+      result.push_back(*p);
+    }
+  }
+  return result;
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
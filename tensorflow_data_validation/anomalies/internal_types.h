@@ -17,27 +17,88 @@ limitations under the License.
 #define TENSORFLOW_DATA_VALIDATION_ANOMALIES_INTERNAL_TYPES_H_
 
 #include <string>
+#include <type_traits>
 #include <vector>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/variant.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_metadata/proto/v0/anomalies.pb.h"
 
 namespace tensorflow {
 namespace data_validation {
 
+// An argument of the long form of a Description, kept typed until the
+// description is rendered. It is rendered like absl::StrCat() renders it.
+class DescriptionArg {
+ public:
+  // Integers and enums.
+  template <typename T,
+            typename std::enable_if<(std::is_integral<T>::value &&
+                                     std::is_signed<T>::value) ||
+                                        std::is_enum<T>::value,
+                                    int>::type = 0>
+  DescriptionArg(T value) : value_(static_cast<int64>(value)) {}
+  template <typename T,
+            typename std::enable_if<std::is_integral<T>::value &&
+                                        !std::is_signed<T>::value,
+                                    int>::type = 0>
+  DescriptionArg(T value) : value_(static_cast<uint64>(value)) {}
+  // Rendered with six significant digits, like absl::SixDigits().
+  DescriptionArg(double value) : value_(value) {}
+  DescriptionArg(const char* value) : value_(string(value)) {}
+  DescriptionArg(absl::string_view value) : value_(string(value)) {}
+  DescriptionArg(const string& value) : value_(value) {}
+  DescriptionArg(string&& value) : value_(std::move(value)) {}
+
+  // Rendered like printf("%f", value).
+  static DescriptionArg Fixed(double value);
+
+  // Appends the rendered argument to output.
+  void AppendTo(string* output) const;
+
+ private:
+  struct FixedDouble {
+    double value;
+  };
+
+  explicit DescriptionArg(FixedDouble value) : value_(value) {}
+
+  absl::variant<int64, uint64, double, FixedDouble, string> value_;
+};
+
 // Represents the description of an anomaly, in short and long form.
+// The long form is either given rendered, in long_description, or as a
+// template with typed arguments (see FromTemplate()), which is only rendered
+// when an AnomalyInfo is created (so that the anomalies that are never
+// materialized, or whose descriptions are not needed, cost no rendering).
 struct Description {
   tensorflow::metadata::v0::AnomalyInfo::Type type;
   string short_description, long_description;
+  // If not null, the template of the long form, where $0 to $9 stand for the
+  // args. It must outlive the description (e.g., a string literal), and
+  // long_description is then empty.
+  const char* long_template;
+  std::vector<DescriptionArg> args;
+
+  // Creates a description whose long form is rendered from long_template and
+  // args when needed.
+  static Description FromTemplate(
+      tensorflow::metadata::v0::AnomalyInfo::Type type,
+      string short_description, const char* long_template,
+      std::vector<DescriptionArg> args);
+
+  // Returns the long form, rendering it if there is a template.
+  string GetLongDescription() const;
 
   friend bool operator==(const Description& a, const Description& b) {
     return (a.type == b.type && a.short_description == b.short_description &&
-            a.long_description == b.long_description);
+            a.GetLongDescription() == b.GetLongDescription());
   }
 
   friend std::ostream& operator<<(std::ostream& strm, const Description& a) {
     return (strm << "{" << a.type << ", " << a.short_description << ", " <<
-            a.long_description << "}");
+            a.GetLongDescription() << "}");
   }
 };
 
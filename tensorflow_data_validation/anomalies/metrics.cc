@@ -17,14 +17,16 @@ limitations under the License.
 
 #include <algorithm>
 #include <cmath>
+#include <iterator>
 #include <limits>
-#include <map>
 #include <numeric>
 #include <string>
 #include <vector>
 
-#include "tensorflow_data_validation/anomalies/map_util.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_metadata/proto/v0/statistics.pb.h"
 
@@ -34,68 +36,32 @@ namespace {
 
 using ::tensorflow::metadata::v0::Histogram;
 
-// Gets the L-infty norm of a vector, represented as a map.
-// This is the largest absolute value of any value.
-// For convenience, the associated key is also returned.
-std::pair<string, double> GetLInftyNorm(const std::map<string, double>& vec) {
-  std::pair<string, double> best_so_far;
-  for (const auto& pair : vec) {
-    const string& key = pair.first;
-    const double value = std::abs(pair.second);
-    if (value >= best_so_far.second) {
-      best_so_far = {key, value};
-    }
-  }
-  return best_so_far;
-}
-
-// Appends a bucket representing nans to `histogram`.
-void AddNanBucket(Histogram& histogram) {
-  const double nan_count = histogram.num_nan();
-  Histogram::Bucket* nan_bucket = histogram.add_buckets();
-  nan_bucket->set_low_value(std::numeric_limits<double>::quiet_NaN());
-  nan_bucket->set_high_value(std::numeric_limits<double>::quiet_NaN());
-  nan_bucket->set_sample_count(nan_count);
-}
-
-// Returns a set of all of the bucket boundaries in the input histogram.
-std::set<double> GetHistogramBoundaries(const Histogram& histogram) {
-  std::set<double> boundaries;
+// Sets `boundaries` to the sorted, distinct bucket boundaries of `histogram`.
+// The buckets of a histogram are sorted, in which case this takes linear time.
+void GetBoundaries(const Histogram& histogram,
+                   std::vector<double>& boundaries) {
+  boundaries.clear();
+  boundaries.reserve(2 * histogram.buckets_size());
   for (const auto& bucket : histogram.buckets()) {
-    boundaries.insert(bucket.low_value());
-    boundaries.insert(bucket.high_value());
+    boundaries.push_back(bucket.low_value());
+    boundaries.push_back(bucket.high_value());
   }
-  return boundaries;
-}
-
-// Adds new buckets to the histogram that are specified by the
-// bucket_boundaries.
-// To calculate the sample counts for each new bucket, this function assumes
-// a uniform distribution of the total_sample_count values across the
-// total_range_covered.
-void AddBucketsToHistogram(std::vector<double> bucket_boundaries,
-                           double total_sample_count,
-                           double total_range_covered, Histogram& histogram) {
-  int num_new_buckets = bucket_boundaries.size() - 1;
-  for (int i = 0; i < num_new_buckets; ++i) {
-    Histogram::Bucket* new_bucket = histogram.add_buckets();
-    new_bucket->set_low_value(bucket_boundaries[i]);
-    new_bucket->set_high_value(bucket_boundaries[i + 1]);
-    const double new_bucket_sample_count =
-        ((bucket_boundaries[i + 1] - bucket_boundaries[i]) /
-         total_range_covered) *
-        total_sample_count;
-    new_bucket->set_sample_count(new_bucket_sample_count);
+  if (!std::is_sorted(boundaries.begin(), boundaries.end())) {
+    std::sort(boundaries.begin(), boundaries.end());
   }
+  boundaries.erase(std::unique(boundaries.begin(), boundaries.end()),
+                   boundaries.end());
 }
 
-// Rebuckets `histogram` so that its value counts are redistributed into new
+// Sets `counts` to the sample counts of `histogram`, redistributed into new
 // buckets that are defined by the specified boundaries. This function assumes a
 // uniform distribution of values within a given bucket in the original
 // histogram.
-void RebucketHistogram(
-    const std::vector<double>& boundaries, Histogram& histogram) {
-  Histogram rebucketed_histogram;
+void RebucketHistogram(const std::vector<double>& boundaries,
+                       const Histogram& histogram,
+                       std::vector<double>& counts) {
+  counts.clear();
+  counts.reserve(boundaries.size() - 1);
   const int max_boundaries_index = boundaries.size() - 1;
   int index = 0;
   for (const auto& bucket : histogram.buckets()) {
@@ -105,66 +71,76 @@ void RebucketHistogram(
     // Fill in empty buckets up to the first bucket in the existing histogram.
     while (low_value > boundaries[index]) {
       CHECK_LE(index + 1, max_boundaries_index);
-      Histogram::Bucket* new_bucket = rebucketed_histogram.add_buckets();
-      new_bucket->set_low_value(boundaries[index]);
+      counts.push_back(0);
       ++index;
-      new_bucket->set_high_value(boundaries[index]);
-      new_bucket->set_sample_count(0);
     }
     if ((low_value == high_value) && (low_value == boundaries[index])) {
-      Histogram::Bucket* new_bucket = rebucketed_histogram.add_buckets();
-      new_bucket->set_low_value(boundaries[index]);
+      counts.push_back(sample_count);
       ++index;
-      new_bucket->set_high_value(boundaries[index]);
-      new_bucket->set_sample_count(sample_count);
       continue;
     }
     // Once the current position in boundaries is covered by a bucket in the
     // existing histogram, divide that bucket up based on the boundaries that it
-    // covers.
-    std::vector<double> covered_boundaries;
+    // covers, from boundaries[first_index] to boundaries[index].
+    const int first_index = index;
     while (high_value > boundaries[index]) {
-      covered_boundaries.push_back(boundaries[index]);
       ++index;
     }
-    // Add the last boundary to covered_boundaries, so it can be used as the
-    // high_value for the last bucket.
-    covered_boundaries.push_back(boundaries[index]);
-    // Divide the current bucket into new buckets defined by covered_boundaries.
-    if (covered_boundaries.size() > 1) {
-      AddBucketsToHistogram(covered_boundaries, sample_count,
-                            high_value - low_value, rebucketed_histogram);
+    const double total_range_covered = high_value - low_value;
+    for (int i = first_index; i < index; ++i) {
+      counts.push_back(((boundaries[i + 1] - boundaries[i]) /
+                        total_range_covered) *
+                       sample_count);
     }
   }
   // Add additional buckets if there are still boundaries for which new
   // buckets have not already been added.
   for (int i = index; i < max_boundaries_index; ++i) {
-    Histogram::Bucket* new_bucket = rebucketed_histogram.add_buckets();
-    new_bucket->set_low_value(boundaries[i]);
-    new_bucket->set_high_value(boundaries[i + 1]);
-    new_bucket->set_sample_count(0);
+    counts.push_back(0);
+  }
+}
+
+// Returns the sample counts of the buckets of `histogram`.
+std::vector<double> GetSampleCounts(const Histogram& histogram) {
+  std::vector<double> counts;
+  counts.reserve(histogram.buckets_size());
+  for (const auto& bucket : histogram.buckets()) {
+    counts.push_back(bucket.sample_count());
   }
-  histogram = std::move(rebucketed_histogram);
+  return counts;
 }
 
-// Aligns histogram_1 and histogram_2 so that they have the same bucket
-// boundaries. This function assumes a uniform distribution of values within a
-// given bucket in the original histogram.
-void AlignHistograms(Histogram& histogram_1, Histogram& histogram_2) {
-  const std::set<double> histogram_1_boundaries =
-      GetHistogramBoundaries(histogram_1);
-  const std::set<double> histogram_2_boundaries =
-      GetHistogramBoundaries(histogram_2);
+// Sets counts_1 and counts_2 to the sample counts of the standard histograms
+// of distribution_1 and distribution_2, aligned so that they have the same
+// bucket boundaries. This function assumes a uniform distribution of values
+// within a given bucket in the original histogram. Returns true if the
+// histograms had to be rebucketed.
+bool AlignHistograms(const FeatureDistribution& distribution_1,
+                     const FeatureDistribution& distribution_2,
+                     std::vector<double>& counts_1,
+                     std::vector<double>& counts_2) {
+  const std::vector<double>& histogram_1_boundaries =
+      distribution_1.GetHistogramBoundaries();
+  const std::vector<double>& histogram_2_boundaries =
+      distribution_2.GetHistogramBoundaries();
   // If the histograms have the same bucket boundaries, there is no need to
-  // rebucket them. Just return the original histograms.
+  // rebucket them. Just return the original counts.
   if (histogram_1_boundaries == histogram_2_boundaries) {
-    return;
+    counts_1 = distribution_1.GetHistogramCounts();
+    counts_2 = distribution_2.GetHistogramCounts();
+    return false;
   }
-  std::set<double> boundaries_set;
+  const Histogram& histogram_1 =
+      *distribution_1.stats().GetStandardHistogramOrNull();
+  const Histogram& histogram_2 =
+      *distribution_2.stats().GetStandardHistogramOrNull();
+  // Both lists of boundaries are sorted, so their union is a linear merge.
+  std::vector<double> boundaries;
+  boundaries.reserve(histogram_1_boundaries.size() +
+                     histogram_2_boundaries.size() + 1);
   std::set_union(histogram_1_boundaries.begin(), histogram_1_boundaries.end(),
                  histogram_2_boundaries.begin(), histogram_2_boundaries.end(),
-                 std::inserter(boundaries_set, boundaries_set.end()));
-  std::vector<double> boundaries(boundaries_set.begin(), boundaries_set.end());
+                 std::back_inserter(boundaries));
   if (histogram_1_boundaries.size() == 1 ||
       histogram_2_boundaries.size() == 1) {
     // If one of the histograms contains only a single value, add that value
@@ -180,108 +156,466 @@ void AlignHistograms(Histogram& histogram_1, Histogram& histogram_2) {
         std::upper_bound(boundaries.begin(), boundaries.end(), bucket_value);
     boundaries.insert(it, bucket_value);
   }
-  RebucketHistogram(boundaries, histogram_1);
-  RebucketHistogram(boundaries, histogram_2);
+  RebucketHistogram(boundaries, histogram_1, counts_1);
+  RebucketHistogram(boundaries, histogram_2, counts_2);
+  return true;
 }
 
-// Normalizes `histogram` so that the sum of all sample counts in the histogram
-// equals 1.
-Status NormalizeHistogram(Histogram& histogram) {
-  Histogram normalized_histogram;
-  double total_sample_count = 0;
-  for (const auto& bucket : histogram.buckets()) {
-    total_sample_count += bucket.sample_count();
+// Normalizes `counts` so that they sum to 1.
+Status NormalizeCounts(std::vector<double>& counts) {
+  double total_count = 0;
+  for (const double count : counts) {
+    total_count += count;
   }
-  if (total_sample_count == 0) {
+  if (total_count == 0) {
     return tensorflow::errors::InvalidArgument(
         "Unable to normalize an empty histogram");
   }
-  for (const auto& bucket : histogram.buckets()) {
-    Histogram::Bucket* new_bucket = normalized_histogram.add_buckets();
-    new_bucket->set_low_value(bucket.low_value());
-    new_bucket->set_high_value(bucket.high_value());
-    new_bucket->set_sample_count(bucket.sample_count() / total_sample_count);
+  for (double& count : counts) {
+    count /= total_count;
   }
-  histogram = std::move(normalized_histogram);
   return Status::OK();
 }
 
 // Returns an approximate Kullback-Leibler divergence
 // (https://en.wikipedia.org/wiki/Kullback%E2%80%93Leibler_divergence) measuring
-// how histogram_2 differs from histogram_1.
-double KullbackLeiblerDivergence(const Histogram& histogram_1,
-                                 const Histogram& histogram_2) {
+// how the distribution q differs from the distribution p.
+double KullbackLeiblerDivergence(const std::vector<double>& p,
+                                 const std::vector<double>& q) {
   double result = 0;
-  CHECK_EQ(histogram_1.buckets_size(), histogram_2.buckets_size());
-  for (int i = 0; i < histogram_1.buckets_size(); ++i) {
-    double p = histogram_1.buckets().at(i).sample_count();
-    double q = histogram_2.buckets().at(i).sample_count();
-    if (p > 0 && q > 0) {
-      result += p * std::log2(p / q);
+  CHECK_EQ(p.size(), q.size());
+  for (int i = 0; i < p.size(); ++i) {
+    if (p[i] > 0 && q[i] > 0) {
+      result += p[i] * std::log2(p[i] / q[i]);
     }
   }
   return result;
 }
 
+// A point of the cumulative distribution of a histogram, with its limits
+// from the left and from the right (which differ where a bucket holds a
+// single value). The distribution is linear between consecutive knots.
+struct CdfKnot {
+  double value;
+  double left;
+  double right;
+};
+
+// Returns the knots of the cumulative distribution of `histogram`, normalized
+// by the total count of its buckets, which must be positive.
+std::vector<CdfKnot> GetCdfKnots(const Histogram& histogram,
+                                 double total_count) {
+  std::vector<CdfKnot> knots;
+  knots.reserve(2 * histogram.buckets_size());
+  double cumulative = 0;
+  const auto add_knot = [&knots](double value, double left, double right) {
+    if (!knots.empty() && knots.back().value == value) {
+      knots.back().right = right;
+    } else {
+      knots.push_back({value, left, right});
+    }
+  };
+  for (const Histogram::Bucket& bucket : histogram.buckets()) {
+    const double before = cumulative;
+    cumulative += bucket.sample_count() / total_count;
+    if (bucket.low_value() == bucket.high_value()) {
+      add_knot(bucket.low_value(), before, cumulative);
+    } else {
+      add_knot(bucket.low_value(), before, before);
+      add_knot(bucket.high_value(), cumulative, cumulative);
+    }
+  }
+  return knots;
+}
+
+// Walks the knots of a cumulative distribution by increasing value.
+class CdfCursor {
+ public:
+  explicit CdfCursor(const std::vector<CdfKnot>& knots) : knots_(knots) {}
+
+  // The value of the next knot, or infinity if there is none.
+  double NextValue() const {
+    return next_ < knots_.size() ? knots_[next_].value
+                                 : std::numeric_limits<double>::infinity();
+  }
+
+  // Sets the limits of the distribution at value, which must be at most
+  // NextValue(), and moves past the next knot if it is at value.
+  void Visit(double value, double& left, double& right) {
+    if (next_ < knots_.size() && knots_[next_].value == value) {
+      left = knots_[next_].left;
+      right = knots_[next_].right;
+      ++next_;
+      return;
+    }
+    if (next_ == 0) {
+      left = right = 0.0;
+    } else if (next_ == knots_.size()) {
+      left = right = 1.0;
+    } else {
+      const CdfKnot& previous = knots_[next_ - 1];
+      const CdfKnot& next = knots_[next_];
+      left = right = previous.right + (next.left - previous.right) *
+                                          (value - previous.value) /
+                                          (next.value - previous.value);
+    }
+  }
+
+ private:
+  const std::vector<CdfKnot>& knots_;
+  size_t next_ = 0;
+};
+
+// The sum of the sample counts of the buckets of `histogram`.
+double GetTotalSampleCount(const Histogram& histogram) {
+  double total = 0;
+  for (const Histogram::Bucket& bucket : histogram.buckets()) {
+    total += bucket.sample_count();
+  }
+  return total;
+}
+
 }  // namespace
 
-std::pair<string, double> LInftyDistance(
-    const std::map<string, double>& counts_a,
-    const std::map<string, double>& counts_b) {
-  return GetLInftyNorm(GetDifference(Normalize(counts_a), Normalize(counts_b)));
+double FeatureDistribution::GetStringValuesTotal() const {
+  if (!string_values_total_) {
+    double total = 0.0;
+    for (const StringValueTable::Entry& entry : stats_.GetStringValueTable()) {
+      total += entry.second;
+    }
+    string_values_total_ = total;
+  }
+  return *string_values_total_;
+}
+
+double FeatureDistribution::GetTotalValueCount() const {
+  return std::max(stats_.GetTotalValueCountInExamples(),
+                  GetStringValuesTotal());
+}
+
+const std::vector<StringValueTable::Entry>&
+FeatureDistribution::GetValuesByCount() const {
+  if (!values_by_count_) {
+    const StringValueTable& table = stats_.GetStringValueTable();
+    values_by_count_.emplace(table.begin(), table.end());
+    const auto by_decreasing_count = [](const StringValueTable::Entry& a,
+                                        const StringValueTable::Entry& b) {
+      return a.second > b.second;
+    };
+    std::stable_sort(values_by_count_->begin(), values_by_count_->end(),
+                     by_decreasing_count);
+  }
+  return *values_by_count_;
 }
 
-std::pair<string, double> LInftyDistance(const FeatureStatsView& a,
-                                         const FeatureStatsView& b) {
-  const std::map<string, double> prob_a =
-      Normalize(a.GetStringValuesWithCounts());
-  const std::map<string, double> prob_b =
-      Normalize(b.GetStringValuesWithCounts());
+const std::vector<double>& FeatureDistribution::GetHistogramBoundaries()
+    const {
+  if (!histogram_boundaries_) {
+    histogram_boundaries_.emplace();
+    GetBoundaries(*CHECK_NOTNULL(stats_.GetStandardHistogramOrNull()),
+                  *histogram_boundaries_);
+  }
+  return *histogram_boundaries_;
+}
+
+const std::vector<double>& FeatureDistribution::GetHistogramCounts() const {
+  if (!histogram_counts_) {
+    histogram_counts_ =
+        GetSampleCounts(*CHECK_NOTNULL(stats_.GetStandardHistogramOrNull()));
+  }
+  return *histogram_counts_;
+}
 
-  return GetLInftyNorm(GetDifference(prob_a, prob_b));
+std::pair<absl::string_view, double> LInftyDistance(
+    const FeatureStatsView& a, const FeatureStatsView& b) {
+  return LInftyDistance(FeatureDistribution(a), FeatureDistribution(b));
+}
+
+std::pair<absl::string_view, double> LInftyDistance(
+    const FeatureDistribution& a, const FeatureDistribution& b) {
+  // Merges the sorted value tables, normalizing each count as it is
+  // compared, so nothing is allocated.
+  const StringValueTable& table_a = a.stats().GetStringValueTable();
+  const StringValueTable& table_b = b.stats().GetStringValueTable();
+  // Counts that sum to zero are left as they are.
+  const double sum_a =
+      a.GetStringValuesTotal() == 0.0 ? 1.0 : a.GetStringValuesTotal();
+  const double sum_b =
+      b.GetStringValuesTotal() == 0.0 ? 1.0 : b.GetStringValuesTotal();
+  absl::string_view best_key;
+  double best_value = 0.0;
+  auto iter_a = table_a.begin();
+  auto iter_b = table_b.begin();
+  while (iter_a != table_a.end() || iter_b != table_b.end()) {
+    absl::string_view key;
+    double difference = 0.0;
+    if (iter_b == table_b.end() ||
+        (iter_a != table_a.end() && iter_a->first < iter_b->first)) {
+      key = iter_a->first;
+      difference = iter_a->second / sum_a;
+      ++iter_a;
+    } else if (iter_a == table_a.end() || iter_b->first < iter_a->first) {
+      key = iter_b->first;
+      difference = -(iter_b->second / sum_b);
+      ++iter_b;
+    } else {
+      key = iter_a->first;
+      difference = iter_a->second / sum_a - iter_b->second / sum_b;
+      ++iter_a;
+      ++iter_b;
+    }
+    // Ties go to the last value.
+    if (std::abs(difference) >= best_value) {
+      best_key = key;
+      best_value = std::abs(difference);
+    }
+  }
+  return {best_key, best_value};
+}
+
+ApproximateDistance ApproximateLInftyDistance(
+    const FeatureDistribution& a, const FeatureDistribution& b,
+    absl::optional<double> threshold) {
+  const StringValueTable& table_a = a.stats().GetStringValueTable();
+  const StringValueTable& table_b = b.stats().GetStringValueTable();
+  const std::vector<StringValueTable::Entry>& by_count_a =
+      a.GetValuesByCount();
+  const std::vector<StringValueTable::Entry>& by_count_b =
+      b.GetValuesByCount();
+  // Counts that sum to zero are left as they are.
+  const double total_a =
+      a.GetTotalValueCount() == 0.0 ? 1.0 : a.GetTotalValueCount();
+  const double total_b =
+      b.GetTotalValueCount() == 0.0 ? 1.0 : b.GetTotalValueCount();
+  // Gets the largest possible (normalized) count of a value that is not in
+  // the table of a distribution.
+  const auto get_unlisted_bound =
+      [](const FeatureDistribution& distribution,
+         const std::vector<StringValueTable::Entry>& by_count, double total) {
+        const double unlisted =
+            distribution.GetTotalValueCount() -
+            distribution.GetStringValuesTotal();
+        if (unlisted <= 0.0) {
+          return 0.0;
+        }
+        if (by_count.empty()) {
+          return unlisted / total;
+        }
+        return std::min(unlisted, by_count.back().second) / total;
+      };
+  const double unlisted_a = get_unlisted_bound(a, by_count_a, total_a);
+  const double unlisted_b = get_unlisted_bound(b, by_count_b, total_b);
+
+  ApproximateDistance result;
+  double lower = 0.0;
+  double upper = 0.0;
+  // Updates the bounds with the difference of value, which is known exactly
+  // only if value is in both tables (or if there are no unlisted values).
+  const auto visit = [&](absl::string_view value) {
+    const double* count_a = table_a.Find(value);
+    const double* count_b = table_b.Find(value);
+    const double min_a = count_a == nullptr ? 0.0 : *count_a / total_a;
+    const double max_a = count_a == nullptr ? unlisted_a : min_a;
+    const double min_b = count_b == nullptr ? 0.0 : *count_b / total_b;
+    const double max_b = count_b == nullptr ? unlisted_b : min_b;
+    const double low_difference = min_a - max_b;
+    const double high_difference = max_a - min_b;
+    upper = std::max(
+        upper, std::max(std::abs(low_difference), std::abs(high_difference)));
+    const double value_lower =
+        low_difference <= 0.0 && high_difference >= 0.0
+            ? 0.0
+            : std::min(std::abs(low_difference), std::abs(high_difference));
+    if (value_lower >= lower) {
+      result.value = value;
+      lower = value_lower;
+    }
+  };
+  int index_a = 0;
+  int index_b = 0;
+  double rest = 0.0;
+  while (true) {
+    // The difference of a value that has not been visited is at most its
+    // largest possible count.
+    const double next_a = index_a < by_count_a.size()
+                              ? by_count_a[index_a].second / total_a
+                              : unlisted_a;
+    const double next_b = index_b < by_count_b.size()
+                              ? by_count_b[index_b].second / total_b
+                              : unlisted_b;
+    rest = std::max(next_a, next_b);
+    if (index_a == by_count_a.size() && index_b == by_count_b.size()) {
+      break;
+    }
+    if (rest <= lower) {
+      // The values left cannot change the bounds.
+      break;
+    }
+    if (threshold && std::max(upper, rest) <= *threshold) {
+      // The distance cannot exceed the threshold.
+      break;
+    }
+    if (index_b == by_count_b.size() ||
+        (index_a < by_count_a.size() && next_a >= next_b)) {
+      visit(by_count_a[index_a++].first);
+    } else {
+      visit(by_count_b[index_b++].first);
+    }
+  }
+  upper = std::max(upper, rest);
+  result.distance = (lower + upper) / 2;
+  result.error = (upper - lower) / 2;
+  return result;
+}
+
+Status JensenShannonDivergence(std::vector<double> counts_1,
+                               std::vector<double> counts_2, double& result) {
+  if (counts_1.size() != counts_2.size()) {
+    return tensorflow::errors::InvalidArgument(
+        "The histograms must have the same number of buckets.");
+  }
+  TF_RETURN_IF_ERROR(NormalizeCounts(counts_1));
+  TF_RETURN_IF_ERROR(NormalizeCounts(counts_2));
+
+  // JSD(P||Q) = (D(P||M) + D(Q||M))/2
+  // where D(P||Q) is the Kullback-Leibler divergence, and M = (P + Q)/2.
+  std::vector<double> average_distribution(counts_1.size());
+  for (int i = 0; i < counts_1.size(); ++i) {
+    average_distribution[i] = (counts_1[i] + counts_2[i]) / 2;
+  }
+  result = ((KullbackLeiblerDivergence(counts_1, average_distribution) +
+             KullbackLeiblerDivergence(counts_2, average_distribution)) /
+            2);
+  return Status::OK();
+}
+
+std::vector<double> GetCountsOnBoundaries(
+    const Histogram& histogram, const std::vector<double>& boundaries) {
+  CHECK_GE(boundaries.size(), 2);
+  const int num_buckets = boundaries.size() - 1;
+  std::vector<double> counts(num_buckets, 0.0);
+  for (const auto& bucket : histogram.buckets()) {
+    const double low_value = bucket.low_value();
+    const double high_value = bucket.high_value();
+    const double sample_count = bucket.sample_count();
+    if (high_value <= boundaries.front()) {
+      counts.front() += sample_count;
+      continue;
+    }
+    if (low_value >= boundaries.back()) {
+      counts.back() += sample_count;
+      continue;
+    }
+    // The first bucket whose high boundary is above low_value.
+    const int first_index =
+        std::upper_bound(boundaries.begin() + 1, boundaries.end() - 1,
+                         low_value) -
+        (boundaries.begin() + 1);
+    if (low_value == high_value) {
+      counts[first_index] += sample_count;
+      continue;
+    }
+    const double total_range_covered = high_value - low_value;
+    counts.front() += std::max(0.0, boundaries.front() - low_value) /
+                      total_range_covered * sample_count;
+    counts.back() += std::max(0.0, high_value - boundaries.back()) /
+                     total_range_covered * sample_count;
+    for (int i = first_index; i < num_buckets && boundaries[i] < high_value;
+         ++i) {
+      const double covered = std::min(high_value, boundaries[i + 1]) -
+                             std::max(low_value, boundaries[i]);
+      if (covered > 0) {
+        counts[i] += covered / total_range_covered * sample_count;
+      }
+    }
+  }
+  return counts;
+}
+
+Status GetQuantilesDistances(const Histogram& a, const Histogram& b,
+                             QuantilesDistances* result) {
+  const double total_a = GetTotalSampleCount(a);
+  const double total_b = GetTotalSampleCount(b);
+  if (total_a <= 0 || total_b <= 0) {
+    return tensorflow::errors::InvalidArgument(
+        "Unable to compute the distances between the quantiles of an empty "
+        "histogram");
+  }
+  const std::vector<CdfKnot> knots_a = GetCdfKnots(a, total_a);
+  const std::vector<CdfKnot> knots_b = GetCdfKnots(b, total_b);
+  CdfCursor cursor_a(knots_a);
+  CdfCursor cursor_b(knots_b);
+  *result = QuantilesDistances();
+  // The difference between the distributions, and its value, just right of
+  // the previous knot.
+  absl::optional<double> previous_value;
+  double previous_difference = 0.0;
+  while (true) {
+    const double value = std::min(cursor_a.NextValue(), cursor_b.NextValue());
+    if (value == std::numeric_limits<double>::infinity()) {
+      break;
+    }
+    double left_a, right_a, left_b, right_b;
+    cursor_a.Visit(value, left_a, right_a);
+    cursor_b.Visit(value, left_b, right_b);
+    const double left_difference = left_a - left_b;
+    const double right_difference = right_a - right_b;
+    for (const double difference : {left_difference, right_difference}) {
+      if (std::abs(difference) > result->kolmogorov_smirnov) {
+        result->kolmogorov_smirnov = std::abs(difference);
+        result->kolmogorov_smirnov_value = value;
+      }
+    }
+    if (previous_value) {
+      // Integrates the absolute value of the linear difference between the
+      // knots, which may cross zero once.
+      const double width = value - *previous_value;
+      const double d0 = std::abs(previous_difference);
+      const double d1 = std::abs(left_difference);
+      if (previous_difference * left_difference >= 0) {
+        result->wasserstein += (d0 + d1) / 2 * width;
+      } else {
+        result->wasserstein += (d0 * d0 + d1 * d1) / (2 * (d0 + d1)) * width;
+      }
+    }
+    previous_value = value;
+    previous_difference = right_difference;
+  }
+  return Status::OK();
 }
 
 Status UpdateJensenShannonDivergenceResult(const FeatureStatsView& a,
                                            const FeatureStatsView& b,
                                            double& result) {
-  const absl::optional<Histogram> maybe_histogram_1 = a.GetStandardHistogram();
-  const absl::optional<Histogram> maybe_histogram_2 = b.GetStandardHistogram();
-  if (!maybe_histogram_1 || !maybe_histogram_2) {
+  return UpdateJensenShannonDivergenceResult(FeatureDistribution(a),
+                                             FeatureDistribution(b), result);
+}
+
+Status UpdateJensenShannonDivergenceResult(const FeatureDistribution& a,
+                                           const FeatureDistribution& b,
+                                           double& result) {
+  const Histogram* standard_histogram_1 =
+      a.stats().GetStandardHistogramOrNull();
+  const Histogram* standard_histogram_2 =
+      b.stats().GetStandardHistogramOrNull();
+  if (standard_histogram_1 == nullptr || standard_histogram_2 == nullptr) {
     return tensorflow::errors::InvalidArgument(
         "Both input statistics must have a standard histogram in order to "
         "calculate the Jensen-Shannon divergence.");
   }
-  // Generate new histograms with the same bucket boundaries.
-  Histogram histogram_1 = std::move(maybe_histogram_1.value());
-  Histogram histogram_2 = std::move(maybe_histogram_2.value());
-  AlignHistograms(histogram_1, histogram_2);
-  // If one or more of histograms have NaN values, add a NaN bucket.
-  if (histogram_1.num_nan() > 0 || histogram_2.num_nan() > 0) {
-    AddNanBucket(histogram_1);
-    AddNanBucket(histogram_2);
-  }
-  TF_RETURN_IF_ERROR(NormalizeHistogram(histogram_1));
-  TF_RETURN_IF_ERROR(NormalizeHistogram(histogram_2));
-
-  // JSD(P||Q) = (D(P||M) + D(Q||M))/2
-  // where D(P||Q) is the Kullback-Leibler divergence, and M = (P + Q)/2.
-  Histogram average_distribution_histogram;
-  CHECK_EQ(histogram_1.buckets_size(), histogram_2.buckets_size());
-  Histogram::Bucket* new_bucket;
-  for (int i = 0; i < histogram_1.buckets_size(); ++i) {
-    new_bucket = average_distribution_histogram.add_buckets();
-    new_bucket->set_low_value(histogram_1.buckets().at(i).low_value());
-    new_bucket->set_high_value(histogram_1.buckets().at(i).high_value());
-    new_bucket->set_sample_count((histogram_1.buckets().at(i).sample_count() +
-                                  histogram_2.buckets().at(i).sample_count()) /
-                                 2);
+  // Get the counts of both histograms with the same bucket boundaries.
+  std::vector<double> counts_1;
+  std::vector<double> counts_2;
+  const bool rebucketed = AlignHistograms(a, b, counts_1, counts_2);
+  // If one or more of histograms have NaN values, add a NaN bucket. The NaN
+  // counts are not carried over when the histograms are rebucketed.
+  if (!rebucketed && (standard_histogram_1->num_nan() > 0 ||
+                      standard_histogram_2->num_nan() > 0)) {
+    counts_1.push_back(standard_histogram_1->num_nan());
+    counts_2.push_back(standard_histogram_2->num_nan());
   }
-  result =
-      ((KullbackLeiblerDivergence(histogram_1, average_distribution_histogram) +
-        KullbackLeiblerDivergence(histogram_2,
-                                  average_distribution_histogram)) /
-       2);
-  return Status::OK();
+  return JensenShannonDivergence(std::move(counts_1), std::move(counts_2),
+                                 result);
 }
 
 }  // namespace data_validation
@@ -16,28 +16,139 @@ limitations under the License.
 #ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_METRICS_H_
 #define TENSORFLOW_DATA_VALIDATION_ANOMALIES_METRICS_H_
 
-#include <map>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "tensorflow_data_validation/anomalies/statistics_view.h"
 #include "tensorflow/core/platform/types.h"
 
 namespace tensorflow {
 namespace data_validation {
 
+// The (weighted) distributions of the values of a feature, as compared by the
+// distances below. Comparing a feature with several others (e.g., with the
+// previous span for drift, and with serving for skew) through one
+// FeatureDistribution prepares its side of the comparisons only once. Each
+// part is prepared the first time it is needed.
+// Not thread-safe.
+class FeatureDistribution {
+ public:
+  explicit FeatureDistribution(const FeatureStatsView& stats) : stats_(stats) {}
+
+  FeatureDistribution(const FeatureDistribution&) = delete;
+  FeatureDistribution& operator=(const FeatureDistribution&) = delete;
+
+  const FeatureStatsView& stats() const { return stats_; }
+
+  // The sum of the counts of stats().GetStringValueTable().
+  double GetStringValuesTotal() const;
+
+  // The total count of the values of the feature. This is at least
+  // GetStringValuesTotal(), and more if stats().GetStringValueTable() only
+  // holds the most frequent values (e.g., from a truncated rank histogram).
+  double GetTotalValueCount() const;
+
+  // The entries of stats().GetStringValueTable(), by decreasing count.
+  const std::vector<StringValueTable::Entry>& GetValuesByCount() const;
+
+  // The sorted, distinct bucket boundaries of the standard histogram, which
+  // must exist.
+  const std::vector<double>& GetHistogramBoundaries() const;
+
+  // The sample counts of the buckets of the standard histogram, which must
+  // exist.
+  const std::vector<double>& GetHistogramCounts() const;
+
+ private:
+  const FeatureStatsView stats_;
+  mutable absl::optional<double> string_values_total_;
+  mutable absl::optional<std::vector<StringValueTable::Entry>>
+      values_by_count_;
+  mutable absl::optional<std::vector<double>> histogram_boundaries_;
+  mutable absl::optional<std::vector<double>> histogram_counts_;
+};
+
 // Computes the L-infinity distance between the (weighted) histograms of the
 // features.
 // Only takes into account how many times the feature are present,
 // and scales the histograms so that they sum to 1.
-// The first value returned is the element with highest deviation, and
-// the second value returned is the L infinity distance itself.
-std::pair<string, double> LInftyDistance(const FeatureStatsView& a,
-                                         const FeatureStatsView& b);
+// The first value returned is the element with highest deviation (pointing
+// into the statistics of a or b), and the second value returned is the L
+// infinity distance itself.
+std::pair<absl::string_view, double> LInftyDistance(const FeatureStatsView& a,
+                                                    const FeatureStatsView& b);
 
-std::pair<string, double> LInftyDistance(
-    const std::map<string, double>& counts_a,
-    const std::map<string, double>& counts_b);
+std::pair<absl::string_view, double> LInftyDistance(
+    const FeatureDistribution& a, const FeatureDistribution& b);
+
+// Bounds on a distance: the distance is within error of distance.
+struct ApproximateDistance {
+  // The value with the largest lower bound on its difference (pointing into
+  // the statistics of a or b).
+  absl::string_view value;
+  double distance = 0.0;
+  double error = 0.0;
+};
+
+// Approximates the L-infinity distance between the (weighted) distributions
+// of the values of the features, when the counts of their values may only be
+// known for their top-K values. Unlike LInftyDistance(...), the values that
+// are not in the top-K of a feature are not taken to be absent: the counts
+// are normalized by the total count of the values of the feature, and the
+// count of any other value is at most both the count of the values that are
+// not in the top-K and the smallest count in the top-K. The values are
+// visited by decreasing count, and the computation stops as soon as the
+// values left cannot change the bounds or, if threshold is set, as soon as
+// the distance is proven to be at most threshold (in which case the error
+// may be larger). The result is exact if both top-K hold all the values.
+ApproximateDistance ApproximateLInftyDistance(
+    const FeatureDistribution& a, const FeatureDistribution& b,
+    absl::optional<double> threshold);
+
+// Computes the approximate Jensen-Shannon divergence
+// (https://en.wikipedia.org/wiki/Jensen%E2%80%93Shannon_divergence) between
+// two histograms with the same buckets, given the sample counts of their
+// buckets. The counts are normalized to sum to 1.
+Status JensenShannonDivergence(std::vector<double> counts_1,
+                               std::vector<double> counts_2, double& result);
+
+// Returns the sample counts of histogram redistributed into the buckets between
+// consecutive boundaries, which must be sorted and distinct (there must be at
+// least two). Like the rebucketing of the histograms compared by
+// UpdateJensenShannonDivergenceResult(...), this assumes a uniform
+// distribution of the values within each bucket of histogram. The counts
+// below the first boundary go to the first bucket, and the ones above the
+// last boundary to the last bucket.
+std::vector<double> GetCountsOnBoundaries(
+    const tensorflow::metadata::v0::Histogram& histogram,
+    const std::vector<double>& boundaries);
+
+// Distances between the cumulative distributions of two histograms.
+struct QuantilesDistances {
+  // The approximate Wasserstein-1 (earth mover's) distance, in the units of
+  // the values of the feature.
+  double wasserstein = 0.0;
+  // The approximate Kolmogorov-Smirnov distance, i.e., the largest absolute
+  // difference between the cumulative distributions, in [0, 1].
+  double kolmogorov_smirnov = 0.0;
+  // A value at which the Kolmogorov-Smirnov distance is reached.
+  double kolmogorov_smirnov_value = 0.0;
+};
+
+// Computes the approximate Wasserstein-1 and Kolmogorov-Smirnov distances
+// between two histograms, such as the QUANTILES histograms of numeric
+// features, in one pass over their sorted buckets. Like
+// GetCountsOnBoundaries(...), this assumes a uniform distribution of the
+// values within each bucket, so the cumulative distributions are piecewise
+// linear and no rebucketing is needed. The buckets of each histogram must be
+// sorted and must not overlap. NaN counts are ignored. Returns an error if
+// either histogram has no samples.
+Status GetQuantilesDistances(const tensorflow::metadata::v0::Histogram& a,
+                             const tensorflow::metadata::v0::Histogram& b,
+                             QuantilesDistances* result);
 
 // Computes the approximate Jensen-Shannon divergence
 // (https://en.wikipedia.org/wiki/Jensen%E2%80%93Shannon_divergence) between the
@@ -46,6 +157,10 @@ Status UpdateJensenShannonDivergenceResult(const FeatureStatsView& a,
                                            const FeatureStatsView& b,
                                            double& result);
 
+Status UpdateJensenShannonDivergenceResult(const FeatureDistribution& a,
+                                           const FeatureDistribution& b,
+                                           double& result);
+
 }  // namespace data_validation
 }  // namespace tensorflow
 
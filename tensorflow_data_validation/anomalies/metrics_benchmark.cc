@@ -0,0 +1,121 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Benchmarks of the distances between the statistics of two features.
+// Run with --benchmarks=all.
+
+#include "tensorflow_data_validation/anomalies/metrics.h"
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow_data_validation/anomalies/allocation_counter.h"
+#include "tensorflow_data_validation/anomalies/statistics_view_test_util.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/statistics.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::FeatureNameStatistics;
+using ::tensorflow::metadata::v0::Histogram;
+
+// Gets the statistics of a float feature with a standard histogram of
+// num_buckets buckets of width 1, starting at offset.
+FeatureNameStatistics GetStatisticsWithHistogram(int num_buckets,
+                                                 double offset) {
+  FeatureNameStatistics statistics;
+  statistics.set_name("float");
+  statistics.set_type(FeatureNameStatistics::FLOAT);
+  Histogram* histogram = statistics.mutable_num_stats()->add_histograms();
+  histogram->set_type(Histogram::STANDARD);
+  for (int i = 0; i < num_buckets; ++i) {
+    Histogram::Bucket* bucket = histogram->add_buckets();
+    bucket->set_low_value(offset + i);
+    bucket->set_high_value(offset + i + 1);
+    bucket->set_sample_count(1 + i % 7);
+  }
+  return statistics;
+}
+
+void RunJensenShannonDivergence(int iters, int num_buckets, double offset) {
+  ::tensorflow::testing::StopTiming();
+  const testing::DatasetForTesting dataset_1(
+      GetStatisticsWithHistogram(num_buckets, 0));
+  const testing::DatasetForTesting dataset_2(
+      GetStatisticsWithHistogram(num_buckets, offset));
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    double result;
+    TF_CHECK_OK(UpdateJensenShannonDivergenceResult(
+        dataset_1.feature_stats_view(), dataset_2.feature_stats_view(),
+        result));
+  }
+  SetAllocationLabel(start, iters);
+}
+
+// Both histograms have the same buckets.
+void BM_JensenShannonDivergenceAligned(int iters, int num_buckets) {
+  RunJensenShannonDivergence(iters, num_buckets, /*offset=*/0);
+}
+BENCHMARK(BM_JensenShannonDivergenceAligned)->Range(10, 10000);
+
+// The buckets of the histograms overlap, so both have to be rebucketed.
+void BM_JensenShannonDivergenceRebucketed(int iters, int num_buckets) {
+  RunJensenShannonDivergence(iters, num_buckets, /*offset=*/0.5);
+}
+BENCHMARK(BM_JensenShannonDivergenceRebucketed)->Range(10, 10000);
+
+// Gets the statistics of a string feature with num_values values, every other
+// one of which starts with prefix.
+FeatureNameStatistics GetStatisticsWithValues(int num_values,
+                                              const string& prefix) {
+  FeatureNameStatistics statistics;
+  statistics.set_name("string");
+  statistics.set_type(FeatureNameStatistics::STRING);
+  auto* rank_histogram =
+      statistics.mutable_string_stats()->mutable_rank_histogram();
+  for (int i = 0; i < num_values; ++i) {
+    auto* bucket = rank_histogram->add_buckets();
+    bucket->set_label(absl::StrCat(i % 2 == 0 ? prefix : "value_", i));
+    bucket->set_sample_count(1 + i % 7);
+  }
+  return statistics;
+}
+
+void BM_LInftyDistance(int iters, int num_values) {
+  ::tensorflow::testing::StopTiming();
+  const testing::DatasetForTesting dataset_1(
+      GetStatisticsWithValues(num_values, "training_"));
+  const testing::DatasetForTesting dataset_2(
+      GetStatisticsWithValues(num_values, "serving_"));
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    CHECK_GE(LInftyDistance(dataset_1.feature_stats_view(),
+                            dataset_2.feature_stats_view())
+                 .second,
+             0.0);
+  }
+  SetAllocationLabel(start, iters);
+}
+BENCHMARK(BM_LInftyDistance)->Range(10, 100000);
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -17,9 +17,13 @@ limitations under the License.
 
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 #include "tensorflow_data_validation/anomalies/statistics_view_test_util.h"
 #include "tensorflow_data_validation/anomalies/test_util.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
@@ -33,6 +37,7 @@ namespace data_validation {
 namespace {
 
 using tensorflow::metadata::v0::FeatureNameStatistics;
+using tensorflow::metadata::v0::Histogram;
 using testing::DatasetForTesting;
 using testing::ParseTextProtoOrDie;
 
@@ -68,22 +73,27 @@ struct LInftyDistanceExample {
   std::map<string, double> training;
   std::map<string, double> serving;
   double expected;
+  // The value with the largest difference.
+  string expected_value;
 };
 
 std::vector<LInftyDistanceExample> GetLInftyDistanceTests() {
-  return {{"Two empty maps", {}, {}, 0.0},
+  return {{"Two empty maps", {}, {}, 0.0, ""},
           {"Normal distribution.",
            {{"hello", 0.1}, {"world", 0.9}},
            {{"hello", 0.3}, {"world", 0.7}},
-           0.2},
+           0.2,
+           "world"},
           {"Missing value in both.",
            {{"b", 0.9}, {"c", 0.1}},
            {{"a", 0.3}, {"b", 0.7}},
-           0.3},
+           0.3,
+           "a"},
           {"Missing value in both, flipped.",
            {{"a", 0.3}, {"b", 0.7}},
            {{"b", 0.9}, {"c", 0.1}},
-           0.3}};
+           0.3,
+           "a"}};
 }
 
 TEST(LInftyDistanceTest, All) {
@@ -92,13 +102,22 @@ TEST(LInftyDistanceTest, All) {
         GetFeatureNameStatisticsWithTokens(test.training));
     const DatasetForTesting serving(
         GetFeatureNameStatisticsWithTokens(test.serving));
-    const double result = LInftyDistance(training.feature_stats_view(),
-                                         serving.feature_stats_view())
-                              .second;
-    EXPECT_NEAR(result, test.expected, 1e-5) << test.name;
+    const std::pair<absl::string_view, double> result = LInftyDistance(
+        training.feature_stats_view(), serving.feature_stats_view());
+    EXPECT_NEAR(result.second, test.expected, 1e-5) << test.name;
+    EXPECT_EQ(result.first, test.expected_value) << test.name;
   }
 }
 
+TEST(JensenShannonDivergence, SampleCounts) {
+  double result;
+  TF_ASSERT_OK(JensenShannonDivergence({1, 1}, {2, 0}, result));
+  // M = (0.75, 0.25), D(P||M) = 0.2075187, and D(Q||M) = 0.4150375.
+  EXPECT_NEAR(result, 0.3112781, 1e-6);
+  EXPECT_FALSE(JensenShannonDivergence({1, 1}, {2}, result).ok());
+  EXPECT_FALSE(JensenShannonDivergence({0, 0}, {1, 1}, result).ok());
+}
+
 TEST(JensenShannonDivergence, SameStatistics) {
   const DatasetForTesting dataset(ParseTextProtoOrDie<FeatureNameStatistics>(R"(
     name: 'float'
@@ -348,6 +367,207 @@ TEST(JensenShannonDivergence, WithNaNs) {
   EXPECT_NEAR(result, 0.13792538096, 1e-5);
 }
 
+// Gets the statistics of a string feature with tot_num_values values, of which
+// rank_histogram holds the top-K.
+FeatureNameStatistics GetStringStatistics(double tot_num_values,
+                                          const string& rank_histogram) {
+  return ParseTextProtoOrDie<FeatureNameStatistics>(absl::StrCat(
+      "name: 'string' type: STRING string_stats { common_stats { "
+      "tot_num_values: ",
+      tot_num_values, " } rank_histogram { ", rank_histogram, " } }"));
+}
+
+TEST(GetCountsOnBoundaries, Rebuckets) {
+  const Histogram histogram = ParseTextProtoOrDie<Histogram>(R"(
+    buckets { low_value: -1.0 high_value: 1.0 sample_count: 4.0 }
+    buckets { low_value: 1.0 high_value: 3.0 sample_count: 2.0 }
+    buckets { low_value: 2.5 high_value: 2.5 sample_count: 1.0 }
+    buckets { low_value: 5.0 high_value: 6.0 sample_count: 3.0 })");
+  // The counts below 0 go to the first bucket, and the ones above 4 to the
+  // last one.
+  EXPECT_EQ(GetCountsOnBoundaries(histogram, {0.0, 2.0, 4.0}),
+            std::vector<double>({5.0, 5.0}));
+}
+
+TEST(GetQuantilesDistances, DisjointBuckets) {
+  const Histogram a = ParseTextProtoOrDie<Histogram>(R"(
+    buckets { low_value: 0.0 high_value: 1.0 sample_count: 5.0 }
+    type: QUANTILES)");
+  const Histogram b = ParseTextProtoOrDie<Histogram>(R"(
+    buckets { low_value: 1.0 high_value: 2.0 sample_count: 2.0 }
+    type: QUANTILES)");
+  QuantilesDistances result;
+  TF_ASSERT_OK(GetQuantilesDistances(a, b, &result));
+  EXPECT_DOUBLE_EQ(result.wasserstein, 1.0);
+  EXPECT_DOUBLE_EQ(result.kolmogorov_smirnov, 1.0);
+  EXPECT_DOUBLE_EQ(result.kolmogorov_smirnov_value, 1.0);
+}
+
+TEST(GetQuantilesDistances, PointBuckets) {
+  const Histogram uniform = ParseTextProtoOrDie<Histogram>(R"(
+    buckets { low_value: 0.0 high_value: 2.0 sample_count: 4.0 }
+    type: QUANTILES)");
+  const Histogram point = ParseTextProtoOrDie<Histogram>(R"(
+    buckets { low_value: 1.0 high_value: 1.0 sample_count: 3.0 }
+    type: QUANTILES)");
+  QuantilesDistances result;
+  TF_ASSERT_OK(GetQuantilesDistances(uniform, point, &result));
+  EXPECT_DOUBLE_EQ(result.wasserstein, 0.5);
+  EXPECT_DOUBLE_EQ(result.kolmogorov_smirnov, 0.5);
+  EXPECT_DOUBLE_EQ(result.kolmogorov_smirnov_value, 1.0);
+
+  // The difference between the distributions changes sign within the
+  // bucket of `uniform`.
+  const Histogram ends = ParseTextProtoOrDie<Histogram>(R"(
+    buckets { low_value: 0.0 high_value: 0.0 sample_count: 1.0 }
+    buckets { low_value: 2.0 high_value: 2.0 sample_count: 1.0 }
+    type: QUANTILES)");
+  TF_ASSERT_OK(GetQuantilesDistances(uniform, ends, &result));
+  EXPECT_DOUBLE_EQ(result.wasserstein, 0.5);
+  EXPECT_DOUBLE_EQ(result.kolmogorov_smirnov, 0.5);
+  EXPECT_DOUBLE_EQ(result.kolmogorov_smirnov_value, 0.0);
+}
+
+TEST(GetQuantilesDistances, SameHistogram) {
+  const Histogram a = ParseTextProtoOrDie<Histogram>(R"(
+    buckets { low_value: 0.0 high_value: 1.0 sample_count: 1.0 }
+    buckets { low_value: 1.0 high_value: 4.0 sample_count: 1.0 }
+    type: QUANTILES)");
+  QuantilesDistances result;
+  TF_ASSERT_OK(GetQuantilesDistances(a, a, &result));
+  EXPECT_DOUBLE_EQ(result.wasserstein, 0.0);
+  EXPECT_DOUBLE_EQ(result.kolmogorov_smirnov, 0.0);
+}
+
+TEST(GetQuantilesDistances, EmptyHistogram) {
+  const Histogram a = ParseTextProtoOrDie<Histogram>(R"(
+    buckets { low_value: 0.0 high_value: 1.0 sample_count: 1.0 })");
+  QuantilesDistances result;
+  EXPECT_FALSE(GetQuantilesDistances(a, Histogram(), &result).ok());
+}
+
+TEST(ApproximateLInftyDistance, ExactWithAllValues) {
+  const DatasetForTesting dataset_a(GetStringStatistics(
+      8, "buckets { label: 'a' sample_count: 6 } "
+         "buckets { label: 'b' sample_count: 2 }"));
+  const DatasetForTesting dataset_b(GetStringStatistics(
+      8, "buckets { label: 'a' sample_count: 2 } "
+         "buckets { label: 'b' sample_count: 2 } "
+         "buckets { label: 'c' sample_count: 2 } "
+         "buckets { label: 'd' sample_count: 2 }"));
+  const ApproximateDistance result = ApproximateLInftyDistance(
+      FeatureDistribution(dataset_a.feature_stats_view()),
+      FeatureDistribution(dataset_b.feature_stats_view()),
+      /*threshold=*/absl::nullopt);
+  const std::pair<absl::string_view, double> expected = LInftyDistance(
+      dataset_a.feature_stats_view(), dataset_b.feature_stats_view());
+  EXPECT_EQ(result.distance, expected.second);
+  EXPECT_EQ(result.error, 0.0);
+  EXPECT_EQ(result.value, expected.first);
+  EXPECT_EQ(result.value, "a");
+}
+
+TEST(ApproximateLInftyDistance, TopK) {
+  // Each side has 2 values that are not in its top-K, so any other value has
+  // a count of at most 2.
+  const DatasetForTesting dataset_a(GetStringStatistics(
+      10, "buckets { label: 'a' sample_count: 5 } "
+          "buckets { label: 'b' sample_count: 3 }"));
+  const DatasetForTesting dataset_b(GetStringStatistics(
+      10, "buckets { label: 'a' sample_count: 4 } "
+          "buckets { label: 'c' sample_count: 4 }"));
+  const FeatureDistribution distribution_a(dataset_a.feature_stats_view());
+  const FeatureDistribution distribution_b(dataset_b.feature_stats_view());
+  EXPECT_EQ(distribution_a.GetTotalValueCount(), 10.0);
+  // The difference of c is within [0.2, 0.4], which bounds all the others.
+  const ApproximateDistance result = ApproximateLInftyDistance(
+      distribution_a, distribution_b, /*threshold=*/absl::nullopt);
+  EXPECT_NEAR(result.distance, 0.3, 1.0e-9);
+  EXPECT_NEAR(result.error, 0.1, 1.0e-9);
+  EXPECT_EQ(result.value, "c");
+
+  // No difference is above 0.5, which is known before visiting any value.
+  const ApproximateDistance bounded = ApproximateLInftyDistance(
+      distribution_a, distribution_b, /*threshold=*/0.5);
+  EXPECT_LE(bounded.distance + bounded.error, 0.5);
+  EXPECT_GE(bounded.distance + bounded.error, 0.4);
+  EXPECT_LE(bounded.distance - bounded.error, 0.2);
+}
+
+TEST(FeatureDistribution, SharedByHistogramComparisons) {
+  const auto get_statistics = [](double offset, double count) {
+    FeatureNameStatistics statistics;
+    statistics.set_name("float");
+    statistics.set_type(FeatureNameStatistics::FLOAT);
+    Histogram* histogram = statistics.mutable_num_stats()->add_histograms();
+    histogram->set_type(Histogram::STANDARD);
+    for (int i = 0; i < 3; ++i) {
+      Histogram::Bucket* bucket = histogram->add_buckets();
+      bucket->set_low_value(offset + i);
+      bucket->set_high_value(offset + i + 1);
+      bucket->set_sample_count(count + i);
+    }
+    return statistics;
+  };
+  const DatasetForTesting current(get_statistics(0.0, 1.0));
+  const DatasetForTesting aligned(get_statistics(0.0, 3.0));
+  const DatasetForTesting shifted(get_statistics(0.5, 2.0));
+  const FeatureDistribution distribution(current.feature_stats_view());
+  EXPECT_EQ(distribution.GetHistogramBoundaries(),
+            std::vector<double>({0.0, 1.0, 2.0, 3.0}));
+  EXPECT_EQ(distribution.GetHistogramCounts(),
+            std::vector<double>({1.0, 2.0, 3.0}));
+  for (const DatasetForTesting* other : {&aligned, &shifted}) {
+    double result;
+    TF_ASSERT_OK(UpdateJensenShannonDivergenceResult(
+        distribution, FeatureDistribution(other->feature_stats_view()),
+        result));
+    double expected;
+    TF_ASSERT_OK(UpdateJensenShannonDivergenceResult(
+        current.feature_stats_view(), other->feature_stats_view(), expected));
+    EXPECT_EQ(result, expected);
+  }
+}
+
+TEST(FeatureDistribution, SharedByStringComparisons) {
+  const DatasetForTesting current(
+      ParseTextProtoOrDie<FeatureNameStatistics>(R"(
+        name: 'string'
+        type: STRING
+        string_stats: {
+          rank_histogram {
+            buckets { label: "a" sample_count: 1 }
+            buckets { label: "b" sample_count: 2 }
+          }
+        })"));
+  const DatasetForTesting previous(
+      ParseTextProtoOrDie<FeatureNameStatistics>(R"(
+        name: 'string'
+        type: STRING
+        string_stats: {
+          rank_histogram {
+            buckets { label: "a" sample_count: 3 }
+          }
+        })"));
+  const DatasetForTesting serving(
+      ParseTextProtoOrDie<FeatureNameStatistics>(R"(
+        name: 'string'
+        type: STRING
+        string_stats: {
+          rank_histogram {
+            buckets { label: "b" sample_count: 1 }
+          }
+        })"));
+  const FeatureDistribution distribution(current.feature_stats_view());
+  EXPECT_EQ(distribution.GetStringValuesTotal(), 3.0);
+  for (const DatasetForTesting* other : {&previous, &serving}) {
+    EXPECT_EQ(LInftyDistance(distribution,
+                             FeatureDistribution(other->feature_stats_view())),
+              LInftyDistance(current.feature_stats_view(),
+                             other->feature_stats_view()));
+  }
+}
+
 }  // namespace
 
 }  // namespace data_validation
@@ -0,0 +1,96 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/monotonic_arena.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+constexpr size_t MonotonicArena::kDefaultInitialBlockSize;
+constexpr size_t MonotonicArena::kMaxBlockSize;
+constexpr int MonotonicArena::kNumShards;
+
+namespace {
+
+// The shard of an arena used by the current thread. Threads get consecutive
+// indices, so that up to kNumShards threads use distinct shards.
+int GetShardIndex() {
+  static std::atomic<int> next_thread_index(0);
+  thread_local const int thread_index = next_thread_index.fetch_add(1);
+  return thread_index % MonotonicArena::kNumShards;
+}
+
+}  // namespace
+
+MonotonicArena::MonotonicArena(size_t initial_block_size) {
+  for (Shard& shard : shards_) {
+    mutex_lock lock(shard.mu);
+    shard.next_block_size = std::max<size_t>(initial_block_size, 1);
+  }
+}
+
+void* MonotonicArena::Allocate(size_t bytes, size_t alignment) {
+  DCHECK_EQ(alignment & (alignment - 1), 0);
+  Shard& shard = shards_[GetShardIndex()];
+  mutex_lock lock(shard.mu);
+  uintptr_t start = (reinterpret_cast<uintptr_t>(shard.next) + alignment - 1) &
+                    ~(alignment - 1);
+  if (shard.next == nullptr ||
+      start + bytes > reinterpret_cast<uintptr_t>(shard.end)) {
+    AddBlock(bytes + alignment - 1, &shard);
+    start = (reinterpret_cast<uintptr_t>(shard.next) + alignment - 1) &
+            ~(alignment - 1);
+  }
+  shard.next = reinterpret_cast<char*>(start + bytes);
+  shard.bytes_allocated += bytes;
+  return reinterpret_cast<void*>(start);
+}
+
+void MonotonicArena::AddBlock(size_t min_bytes, Shard* shard) {
+  const size_t size = std::max(shard->next_block_size, min_bytes);
+  shard->next_block_size = std::min(shard->next_block_size * 2, kMaxBlockSize);
+  shard->blocks.emplace_back(new char[size]);
+  shard->next = shard->blocks.back().get();
+  shard->end = shard->next + size;
+  shard->bytes_reserved += size;
+}
+
+int64 MonotonicArena::bytes_allocated() const {
+  int64 result = 0;
+  for (const Shard& shard : shards_) {
+    mutex_lock lock(shard.mu);
+    result += shard.bytes_allocated;
+  }
+  return result;
+}
+
+int64 MonotonicArena::bytes_reserved() const {
+  int64 result = 0;
+  for (const Shard& shard : shards_) {
+    mutex_lock lock(shard.mu);
+    result += shard.bytes_reserved;
+  }
+  return result;
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
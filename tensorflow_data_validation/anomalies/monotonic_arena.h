@@ -0,0 +1,136 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_MONOTONIC_ARENA_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_MONOTONIC_ARENA_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// A region of memory for the many small objects of one call (e.g., the nodes
+// of the maps of a SchemaAnomalies). Allocations bump a pointer in the current
+// block, and all the blocks are freed at once when the arena is destroyed.
+// The arena never reclaims memory: deallocations are no-ops, so a container
+// that grows (e.g., an ArenaVector that is not reserved up front) leaves each
+// of its previous buffers behind. Thread-safe: each thread allocates from one
+// of kNumShards shards (with their own blocks and lock), so that threads
+// allocating concurrently (e.g., parallel validation tasks) rarely contend.
+class MonotonicArena {
+ public:
+  MonotonicArena() : MonotonicArena(kDefaultInitialBlockSize) {}
+
+  // The first block of each shard has initial_block_size bytes, and each next
+  // block twice as many as the previous one (up to kMaxBlockSize).
+  explicit MonotonicArena(size_t initial_block_size);
+
+  MonotonicArena(const MonotonicArena&) = delete;
+  MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+  // Returns bytes of memory aligned to alignment (a power of 2), which lives
+  // as long as the arena.
+  void* Allocate(size_t bytes, size_t alignment);
+
+  // The bytes returned by Allocate(...) so far.
+  int64 bytes_allocated() const;
+
+  // The bytes of all the blocks, including the unused ones.
+  int64 bytes_reserved() const;
+
+  static constexpr size_t kDefaultInitialBlockSize = 4096;
+  static constexpr size_t kMaxBlockSize = 1 << 20;
+  static constexpr int kNumShards = 8;
+
+ private:
+  // The blocks used by some of the threads. Aligned so that the shards used
+  // by different threads do not share cache lines.
+  struct alignas(64) Shard {
+    mutable mutex mu;
+    std::vector<std::unique_ptr<char[]>> blocks TF_GUARDED_BY(mu);
+    // The free part of the current block.
+    char* next TF_GUARDED_BY(mu) = nullptr;
+    char* end TF_GUARDED_BY(mu) = nullptr;
+    size_t next_block_size TF_GUARDED_BY(mu) = 0;
+    int64 bytes_allocated TF_GUARDED_BY(mu) = 0;
+    int64 bytes_reserved TF_GUARDED_BY(mu) = 0;
+  };
+
+  // Makes a block of at least min_bytes the current one of shard.
+  static void AddBlock(size_t min_bytes, Shard* shard)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(shard->mu);
+
+  Shard shards_[kNumShards];
+};
+
+// An allocator for standard containers that allocates on a MonotonicArena, or
+// on the heap if the arena is null. The arena must outlive the containers.
+template <typename T>
+class ArenaAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  ArenaAllocator() : arena_(nullptr) {}
+  explicit ArenaAllocator(MonotonicArena* arena) : arena_(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+  T* allocate(size_t n) {
+    if (arena_ == nullptr) {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, size_t n) {
+    if (arena_ == nullptr) {
+      ::operator delete(p);
+    }
+  }
+
+  MonotonicArena* arena() const { return arena_; }
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return arena_ == other.arena();
+  }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const {
+    return arena_ != other.arena();
+  }
+
+ private:
+  MonotonicArena* arena_;
+};
+
+// A vector on a MonotonicArena (or on the heap).
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_MONOTONIC_ARENA_H_
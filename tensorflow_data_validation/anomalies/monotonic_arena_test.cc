@@ -0,0 +1,113 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/monotonic_arena.h"
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+TEST(MonotonicArenaTest, AllocationsAreAlignedAndDistinct) {
+  MonotonicArena arena(/*initial_block_size=*/64);
+  char* previous = nullptr;
+  for (int i = 0; i < 100; ++i) {
+    const size_t alignment = size_t{1} << (i % 4);
+    char* p = static_cast<char*>(arena.Allocate(3, alignment));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % alignment, 0);
+    // Writing to every byte would be caught by sanitizers if blocks overlap.
+    p[0] = p[1] = p[2] = static_cast<char>(i);
+    EXPECT_NE(p, previous);
+    previous = p;
+  }
+  EXPECT_EQ(arena.bytes_allocated(), 300);
+  EXPECT_GE(arena.bytes_reserved(), arena.bytes_allocated());
+}
+
+TEST(MonotonicArenaTest, LargeAllocationGetsItsOwnBlock) {
+  MonotonicArena arena(/*initial_block_size=*/16);
+  void* p = arena.Allocate(1000, 8);
+  EXPECT_NE(p, nullptr);
+  EXPECT_EQ(arena.bytes_allocated(), 1000);
+  EXPECT_GE(arena.bytes_reserved(), 1000);
+}
+
+TEST(MonotonicArenaTest, ConcurrentAllocationsAreDistinct) {
+  MonotonicArena arena(/*initial_block_size=*/64);
+  constexpr int kNumThreads = 2 * MonotonicArena::kNumShards;
+  constexpr int kNumAllocations = 1000;
+  std::vector<std::vector<int64*>> allocations(kNumThreads);
+  {
+    thread::ThreadPool thread_pool(Env::Default(), "allocate", kNumThreads);
+    for (int i = 0; i < kNumThreads; ++i) {
+      thread_pool.Schedule([&arena, &allocations, i]() {
+        for (int j = 0; j < kNumAllocations; ++j) {
+          int64* p = static_cast<int64*>(
+              arena.Allocate(sizeof(int64), alignof(int64)));
+          *p = i * kNumAllocations + j;
+          allocations[i].push_back(p);
+        }
+      });
+    }
+  }
+  for (int i = 0; i < kNumThreads; ++i) {
+    for (int j = 0; j < kNumAllocations; ++j) {
+      EXPECT_EQ(*allocations[i][j], i * kNumAllocations + j);
+    }
+  }
+  EXPECT_EQ(arena.bytes_allocated(),
+            kNumThreads * kNumAllocations * sizeof(int64));
+  EXPECT_GE(arena.bytes_reserved(), arena.bytes_allocated());
+}
+
+TEST(ArenaAllocatorTest, ContainersAllocateOnArena) {
+  MonotonicArena arena;
+  {
+    std::map<int, string, std::less<int>,
+             ArenaAllocator<std::pair<const int, string>>>
+        map((ArenaAllocator<std::pair<const int, string>>(&arena)));
+    ArenaVector<int> vector((ArenaAllocator<int>(&arena)));
+    for (int i = 0; i < 100; ++i) {
+      map[i] = "value";
+      vector.push_back(i);
+    }
+    EXPECT_EQ(map.size(), 100);
+    EXPECT_EQ(vector[99], 99);
+  }
+  EXPECT_GT(arena.bytes_allocated(), 100 * sizeof(int));
+}
+
+TEST(ArenaAllocatorTest, NullArenaUsesHeap) {
+  ArenaVector<int> vector;
+  for (int i = 0; i < 100; ++i) {
+    vector.push_back(i);
+  }
+  EXPECT_EQ(vector.get_allocator().arena(), nullptr);
+  EXPECT_EQ(vector[99], 99);
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
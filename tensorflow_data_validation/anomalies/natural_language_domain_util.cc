@@ -15,15 +15,13 @@ limitations under the License.
 
 #include "tensorflow_data_validation/anomalies/natural_language_domain_util.h"
 
-#include <map>
 #include <set>
 #include <string>
 #include <vector>
 
-#include "google/protobuf/any.pb.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
-#include "absl/types/variant.h"
+#include "absl/strings/string_view.h"
 #include "tensorflow_data_validation/anomalies/internal_types.h"
 #include "tensorflow_data_validation/anomalies/map_util.h"
 #include "tensorflow_data_validation/anomalies/statistics_view.h"
@@ -37,7 +35,6 @@ namespace tensorflow {
 namespace data_validation {
 namespace {
 
-using ::tensorflow::metadata::v0::CustomStatistic;
 using ::tensorflow::metadata::v0::Feature;
 using ::tensorflow::metadata::v0::NaturalLanguageDomain;
 using ::tensorflow::metadata::v0::NaturalLanguageStatistics;
@@ -48,26 +45,26 @@ void VerifyCoverageConstraints(const NaturalLanguageStatistics& nl_stats,
                                std::vector<Description>* result) {
   if (nl_domain->coverage().has_min_coverage() &&
       (nl_domain->coverage().min_coverage() > nl_stats.feature_coverage())) {
-    result->push_back(
-        {tensorflow::metadata::v0::AnomalyInfo::FEATURE_COVERAGE_TOO_LOW,
-         "Feature coverage is too low.",
-         absl::StrCat("Fraction of tokens in the vocabulary: ",
-                      nl_stats.feature_coverage(),
-                      " is lower than the threshold set in the Schema: ",
-                      nl_domain->coverage().min_coverage(), ".")});
+    result->push_back(Description::FromTemplate(
+        tensorflow::metadata::v0::AnomalyInfo::FEATURE_COVERAGE_TOO_LOW,
+        "Feature coverage is too low.",
+        "Fraction of tokens in the vocabulary: $0 is lower than the "
+        "threshold set in the Schema: $1.",
+        {nl_stats.feature_coverage(), nl_domain->coverage().min_coverage()}));
     nl_domain->mutable_coverage()->set_min_coverage(
         nl_stats.feature_coverage());
   }
   if (nl_domain->coverage().has_min_avg_token_length() &&
       (nl_stats.avg_token_length() <
        nl_domain->coverage().min_avg_token_length())) {
-    result->push_back(
-        {tensorflow::metadata::v0::AnomalyInfo ::
-             FEATURE_COVERAGE_TOO_SHORT_AVG_TOKEN_LENGTH,
-         "Average token length is too short.",
-         absl::StrCat("Average token length is: ", nl_stats.avg_token_length(),
-                      " which is lower than the threshold set in the Schema:",
-                      " ", nl_domain->coverage().min_avg_token_length(), ".")});
+    result->push_back(Description::FromTemplate(
+        tensorflow::metadata::v0::AnomalyInfo ::
+            FEATURE_COVERAGE_TOO_SHORT_AVG_TOKEN_LENGTH,
+        "Average token length is too short.",
+        "Average token length is: $0 which is lower than the threshold set in "
+        "the Schema: $1.",
+        {nl_stats.avg_token_length(),
+         nl_domain->coverage().min_avg_token_length()}));
     nl_domain->mutable_coverage()->set_min_avg_token_length(
         nl_stats.avg_token_length());
   }
@@ -80,15 +77,14 @@ void VerifyTokenConstraints(
   if (constraint->has_min_fraction_of_sequences() &&
       (constraint->min_fraction_of_sequences() >
        token_stats.fraction_of_sequences())) {
-    result->push_back(
-        {tensorflow::metadata::v0::AnomalyInfo ::
-             SEQUENCE_VALUE_TOO_SMALL_FRACTION,
-         "Value occurs in too small a fraction of sequences.",
-         absl::StrCat("Fraction of sequences with value: ", token_string,
-                      " is: ", token_stats.fraction_of_sequences(),
-                      " which is lower than the threshold set in the "
-                      "Schema: ",
-                      constraint->min_fraction_of_sequences(), ".")});
+    result->push_back(Description::FromTemplate(
+        tensorflow::metadata::v0::AnomalyInfo ::
+            SEQUENCE_VALUE_TOO_SMALL_FRACTION,
+        "Value occurs in too small a fraction of sequences.",
+        "Fraction of sequences with value: $0 is: $1 which is lower than the "
+        "threshold set in the Schema: $2.",
+        {token_string, token_stats.fraction_of_sequences(),
+         constraint->min_fraction_of_sequences()}));
     constraint->set_min_fraction_of_sequences(
         token_stats.fraction_of_sequences());
   }
@@ -96,15 +92,14 @@ void VerifyTokenConstraints(
   if (constraint->has_max_fraction_of_sequences() &&
       (constraint->max_fraction_of_sequences() <
        token_stats.fraction_of_sequences())) {
-    result->push_back(
-        {tensorflow::metadata::v0::AnomalyInfo ::
-             SEQUENCE_VALUE_TOO_LARGE_FRACTION,
-         "Value occurs in too large a fraction of sequences.",
-         absl::StrCat("Fraction of sequences with value: ", token_string,
-                      " is: ", token_stats.fraction_of_sequences(),
-                      " which is higher than the threshold set in the "
-                      "Schema: ",
-                      constraint->max_fraction_of_sequences(), ".")});
+    result->push_back(Description::FromTemplate(
+        tensorflow::metadata::v0::AnomalyInfo ::
+            SEQUENCE_VALUE_TOO_LARGE_FRACTION,
+        "Value occurs in too large a fraction of sequences.",
+        "Fraction of sequences with value: $0 is: $1 which is higher than the "
+        "threshold set in the Schema: $2.",
+        {token_string, token_stats.fraction_of_sequences(),
+         constraint->max_fraction_of_sequences()}));
     constraint->set_max_fraction_of_sequences(
         token_stats.fraction_of_sequences());
   }
@@ -112,30 +107,28 @@ void VerifyTokenConstraints(
   if (constraint->has_min_per_sequence() &&
       (constraint->min_per_sequence() >
        token_stats.per_sequence_min_frequency())) {
-    result->push_back(
-        {tensorflow::metadata::v0::AnomalyInfo ::
-             SEQUENCE_VALUE_TOO_FEW_OCCURRENCES,
-         "Value has too few per-sequence occurrences.",
-         absl::StrCat("Value: ", token_string, " occurs at least: ",
-                      token_stats.per_sequence_min_frequency(),
-                      " times within a sequence, which is lower than the "
-                      "threshold set in the Schema: ",
-                      constraint->min_per_sequence(), ".")});
+    result->push_back(Description::FromTemplate(
+        tensorflow::metadata::v0::AnomalyInfo ::
+            SEQUENCE_VALUE_TOO_FEW_OCCURRENCES,
+        "Value has too few per-sequence occurrences.",
+        "Value: $0 occurs at least: $1 times within a sequence, which is "
+        "lower than the threshold set in the Schema: $2.",
+        {token_string, token_stats.per_sequence_min_frequency(),
+         constraint->min_per_sequence()}));
     constraint->set_min_per_sequence(token_stats.per_sequence_min_frequency());
   }
 
   if (constraint->has_max_per_sequence() &&
       (constraint->max_per_sequence() <
        token_stats.per_sequence_max_frequency())) {
-    result->push_back(
-        {tensorflow::metadata::v0::AnomalyInfo ::
-             SEQUENCE_VALUE_TOO_MANY_OCCURRENCES,
-         "Value has too many per-sequence occurrences.",
-         absl::StrCat("Value: ", token_string, " occurs at most: ",
-                      token_stats.per_sequence_max_frequency(),
-                      " times within a sequence, which is higher than the "
-                      "threshold set in the Schema: ",
-                      constraint->max_per_sequence(), ".")});
+    result->push_back(Description::FromTemplate(
+        tensorflow::metadata::v0::AnomalyInfo ::
+            SEQUENCE_VALUE_TOO_MANY_OCCURRENCES,
+        "Value has too many per-sequence occurrences.",
+        "Value: $0 occurs at most: $1 times within a sequence, which is "
+        "higher than the threshold set in the Schema: $2.",
+        {token_string, token_stats.per_sequence_max_frequency(),
+         constraint->max_per_sequence()}));
     constraint->set_max_per_sequence(token_stats.per_sequence_max_frequency());
   }
 }
@@ -146,20 +139,15 @@ std::vector<Description> UpdateNaturalLanguageDomain(
     const FeatureStatsView& feature_stats, Feature* feature) {
   std::vector<Description> result;
 
-  const CustomStatistic* nl_custom_stats =
-      feature_stats.GetCustomStatByName("nl_statistics");
-
-  NaturalLanguageStatistics nl_stats;
-  bool found_nl_stats = false;
-  if (nl_custom_stats) {
-    if (!nl_custom_stats->any().UnpackTo(&nl_stats)) {
-      LOG(WARNING) << "nl_statistics for feature " << feature->name()
-                   << "do not have the expected "
-                   << "NaturalLanguageStatistics message format.";
-      return result;
-    }
-    found_nl_stats = true;
+  const NaturalLanguageStatsTable& nl_stats_table =
+      feature_stats.GetNaturalLanguageStatsTable();
+  if (nl_stats_table.found() && !nl_stats_table.decoded()) {
+    LOG(WARNING) << "nl_statistics for feature " << feature->name()
+                 << "do not have the expected "
+                 << "NaturalLanguageStatistics message format.";
+    return result;
   }
+  const bool found_nl_stats = nl_stats_table.found();
 
   static const auto& kMissingStatsDescription = *new Description{
       tensorflow::metadata::v0::AnomalyInfo::STATS_NOT_AVAILABLE,
@@ -177,44 +165,28 @@ std::vector<Description> UpdateNaturalLanguageDomain(
     return result;
   }
 
-  VerifyCoverageConstraints(nl_stats, nl_domain, &result);
-
-  std::map<absl::variant<std::string, int>,
-           const NaturalLanguageStatistics::TokenStatistics&>
-      token_stats_map;
-
-  for (auto& token_stats : nl_stats.token_statistics()) {
-    if (token_stats.token_case() ==
-        NaturalLanguageStatistics::TokenStatistics::TokenCase::kIntToken) {
-      token_stats_map.emplace(token_stats.int_token(), token_stats);
-    } else if (token_stats.token_case() ==
-               NaturalLanguageStatistics::TokenStatistics::TokenCase::
-                   kStringToken) {
-      token_stats_map.emplace(token_stats.string_token(), token_stats);
-    }
-  }
+  VerifyCoverageConstraints(nl_stats_table.stats(), nl_domain, &result);
 
   for (auto& constraint : *nl_domain->mutable_token_constraints()) {
-    absl::variant<string, int> constraint_name;
+    const NaturalLanguageStatistics::TokenStatistics* token_stats = nullptr;
     std::string token_string;
     if (constraint.has_int_value()) {
-      constraint_name = constraint.int_value();
+      token_stats = nl_stats_table.FindToken(constraint.int_value());
       token_string = absl::StrCat(constraint.int_value());
-
     } else if (constraint.has_string_value()) {
-      constraint_name = constraint.string_value();
+      token_stats = nl_stats_table.FindToken(
+          absl::string_view(constraint.string_value()));
       token_string = constraint.string_value();
     } else {
       continue;
     }
 
-    auto iter = token_stats_map.find(constraint_name);
-    if (iter == token_stats_map.end()) {
+    if (token_stats == nullptr) {
       result.push_back(kMissingStatsDescription);
       feature->clear_natural_language_domain();
       return result;
     }
-    VerifyTokenConstraints(iter->second, token_string, &constraint, &result);
+    VerifyTokenConstraints(*token_stats, token_string, &constraint, &result);
   }
   return result;
 }
@@ -16,9 +16,9 @@ limitations under the License.
 #include "tensorflow_data_validation/anomalies/path.h"
 
 #include <algorithm>
+#include <utility>
 
-#include "absl/strings/str_cat.h"
-#include "absl/strings/str_join.h"
+#include "absl/hash/hash.h"
 #include "absl/strings/str_replace.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
@@ -30,13 +30,6 @@ namespace tensorflow {
 namespace data_validation {
 namespace {
 
-// This matches a standard step.
-// Standard steps include any proto steps (extensions and regular fields).
-// Standard steps either begin or end with parentheses with none on the inside
-// or they have no parentheses, dot, or single quotes.
-static const LazyRE2 kStandardStep = {R"((\([^()]*\))|([^().']+))",
-                                      RE2::Latin1};
-
 // This matches a serialized step with quotes.
 // This begins and ends with a single quote, and all internal single quotes are
 // doubled.
@@ -47,19 +40,38 @@ static const LazyRE2 kSerializedWithQuotes = {"'(('')|[^'])*'", RE2::Latin1};
 static const LazyRE2 kSerializedStepAndDot = {
     R"(((('(('')|[^'])*')|(\([^()]*\))|([^()'.]+))\.))", RE2::Latin1};
 
+// Returns true if str is a standard step, which is serialized as is.
+// Standard steps include any proto steps (extensions and regular fields).
 // Returns true if:
 // str is nonempty and has no ".", "(", ")", or "'", OR:
 // str starts with "(", ends with ")", and has no "(" or ")" in the interior.
-bool IsStandardStep(const string& str) {
-  return RE2::FullMatch(str, *kStandardStep);
+// This is a single pass over str, rather than a match of the regex
+// (\([^()]*\))|([^().']+).
+bool IsStandardStep(absl::string_view str) {
+  if (str.empty()) {
+    return false;
+  }
+  if (str.size() >= 2 && str.front() == '(' && str.back() == ')') {
+    return str.substr(1, str.size() - 2).find_first_of("()") ==
+           absl::string_view::npos;
+  }
+  return str.find_first_of(".()'") == absl::string_view::npos;
 }
 
-string SerializeStep(const string& str) {
-  if (IsStandardStep(str)) {
-    return str;
+void AppendSerializedStep(absl::string_view step, string* result) {
+  if (IsStandardStep(step)) {
+    result->append(step.data(), step.size());
+    return;
+  }
+  // Double any single quotes in the step, and encapsulate with single quotes.
+  result->push_back('\'');
+  for (const char c : step) {
+    if (c == '\'') {
+      result->push_back('\'');
+    }
+    result->push_back(c);
   }
-  // Double any single quotes in the string, and encapsulate with single quotes.
-  return absl::StrCat("'", absl::StrReplaceAll(str, {{"'", "''"}}), "'");
+  result->push_back('\'');
 }
 
 // Deserialize a step in-place.
@@ -94,6 +106,28 @@ struct StepDelimiter {
     if (pos >= text.size()) {
       return absl::string_view(text.end(), 0);
     }
+    // Steps without quotes are matched without the regex: a step in
+    // parentheses ends at the first parenthesis after the opening one, and
+    // any other step at the first dot, parenthesis or quote. Either way, the
+    // step must be followed by a dot.
+    if (text[pos] != '\'') {
+      size_t end = absl::string_view::npos;
+      if (text[pos] == '(') {
+        end = text.find_first_of("()", pos + 1);
+        if (end != absl::string_view::npos && text[end] == ')') {
+          ++end;
+        } else {
+          end = absl::string_view::npos;
+        }
+      } else if (text[pos] != ')' && text[pos] != '.') {
+        end = text.find_first_of(".()'", pos);
+      }
+      if (end != absl::string_view::npos && end < text.size() &&
+          text[end] == '.') {
+        return text.substr(end, 1);
+      }
+      return absl::string_view(text.end(), 0);
+    }
     absl::string_view remaining_string = text.substr(pos);
     absl::string_view solution;
     // Regex captures a serialized step followed by a dot.
@@ -151,12 +185,14 @@ bool operator<=(const Path& a, const Path& b) { return a.Compare(b) <= 0; }
 bool operator!=(const Path& a, const Path& b) { return a.Compare(b) != 0; }
 
 string Path::Serialize() const {
-  const string separator = ".";
-  std::vector<string> serialized_steps;
-  for (const string& step : step_) {
-    serialized_steps.push_back(SerializeStep(step));
+  string result;
+  for (int i = 0; i < step_.size(); ++i) {
+    if (i > 0) {
+      result.push_back('.');
+    }
+    AppendSerializedStep(step_[i], &result);
   }
-  return absl::StrJoin(serialized_steps, separator);
+  return result;
 }
 
 tensorflow::metadata::v0::Path Path::AsProto() const {
@@ -196,5 +232,71 @@ void PrintTo(const Path& p, std::ostream* o) {
   (*o) << p.Serialize();
 }
 
+constexpr PathId PathInterner::kEmptyPathId;
+constexpr PathId PathInterner::kNoPathId;
+
+PathInterner::PathInterner() {
+  entries_.emplace_back();
+  entries_.back().hash = absl::Hash<absl::string_view>()("");
+}
+
+PathId PathInterner::Intern(const Path& path) {
+  PathId id = kEmptyPathId;
+  for (const string& step : path.step_) {
+    id = InternChild(id, step);
+  }
+  return id;
+}
+
+PathId PathInterner::InternChild(PathId parent, absl::string_view last_step) {
+  const auto iter = children_.find(std::make_pair(parent, last_step));
+  if (iter != children_.end()) {
+    return iter->second;
+  }
+  const PathId id = entries_.size();
+  entries_.emplace_back();
+  Entry& entry = entries_.back();
+  entry.path = entries_[parent].path.GetChild(last_step);
+  entry.parent = parent;
+  entry.hash = absl::Hash<std::pair<size_t, absl::string_view>>()(
+      std::make_pair(entries_[parent].hash, last_step));
+  children_.emplace(std::make_pair(parent, absl::string_view(
+                                               entry.path.last_step())),
+                    id);
+  return id;
+}
+
+PathId PathInterner::Find(const Path& path) const {
+  PathId id = kEmptyPathId;
+  for (const string& step : path.step_) {
+    const auto iter =
+        children_.find(std::make_pair(id, absl::string_view(step)));
+    if (iter == children_.end()) {
+      return kNoPathId;
+    }
+    id = iter->second;
+  }
+  return id;
+}
+
+const string& PathInterner::GetSerializedPath(PathId id) const {
+  const Entry& entry = entries_[id];
+  absl::call_once(entry.serialized_once,
+                  [&entry]() { entry.serialized = entry.path.Serialize(); });
+  return entry.serialized;
+}
+
+size_t PathInterner::GetMemoryUsage() const {
+  size_t result = entries_.size() * sizeof(Entry) +
+                  children_.capacity() * sizeof(*children_.begin());
+  for (const Entry& entry : entries_) {
+    result += entry.path.step_.capacity() * sizeof(string);
+    for (const string& step : entry.path.step_) {
+      result += step.capacity();
+    }
+  }
+  return result;
+}
+
 }  // namespace data_validation
 }  // namespace tensorflow
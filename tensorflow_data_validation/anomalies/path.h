@@ -16,11 +16,16 @@ limitations under the License.
 #ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_PATH_H_
 #define TENSORFLOW_DATA_VALIDATION_ANOMALIES_PATH_H_
 
+#include <deque>
 #include <iosfwd>
 #include <string>
+#include <utility>
 #include <vector>
+#include "absl/base/call_once.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/types.h"
 #include "tensorflow_metadata/proto/v0/path.pb.h"
 
 namespace tensorflow {
@@ -106,7 +111,15 @@ class Path {
   // Path({"foo", "rest", "of", "path"}).
   std::pair<string, Path> PopHead() const;
 
+  // Allows Path to be used as a key of absl hash containers.
+  template <typename H>
+  friend H AbslHashValue(H h, const Path& path) {
+    return H::combine(std::move(h), path.step_);
+  }
+
  private:
+  friend class PathInterner;
+
   // Returns true iff this is equal to p.
   // Part of the implementation of Compare().
   bool Equals(const Path& p) const;
@@ -131,6 +144,76 @@ bool operator<=(const Path& a, const Path& b);
 // gUnit uses this function to pretty print a Path.
 void PrintTo(const Path& p, std::ostream*);
 
+// A dense handle to a path of a PathInterner.
+using PathId = int32;
+
+// Hands out a PathId for each path: equal paths get the same id, and the ids
+// are 0, 1, 2, ... in the order in which the paths are first interned, so
+// that containers can be vectors (or hash maps) keyed by id instead of maps
+// keyed by Path, and a path is only converted back (e.g. serialized) when a
+// result is built. The parent and the hash of each path are computed when it
+// is interned, so neither needs to look at its steps.
+// Intern() and InternChild() are not thread-safe. The other methods are.
+class PathInterner {
+ public:
+  // The id of the empty path, which is always interned.
+  static constexpr PathId kEmptyPathId = 0;
+  // Not the id of any path.
+  static constexpr PathId kNoPathId = -1;
+
+  PathInterner();
+
+  // Not copyable, as the index points into entries_.
+  PathInterner(const PathInterner&) = delete;
+  PathInterner& operator=(const PathInterner&) = delete;
+
+  // Returns the id of path, interning it (and its ancestors) if necessary.
+  PathId Intern(const Path& path);
+
+  // Returns the id of the child of parent with last_step. Takes time
+  // proportional to the size of last_step.
+  PathId InternChild(PathId parent, absl::string_view last_step);
+
+  // Returns the id of path, or kNoPathId if it was never interned. Does not
+  // allocate.
+  PathId Find(const Path& path) const;
+
+  // The number of paths interned, including the empty path.
+  int size() const { return entries_.size(); }
+
+  const Path& GetPath(PathId id) const { return entries_[id].path; }
+
+  // Returns the id of the parent of a path, or kNoPathId for the empty path.
+  PathId GetParent(PathId id) const { return entries_[id].parent; }
+
+  // A hash of the path, computed from the hash of its parent and its last
+  // step.
+  size_t GetHash(PathId id) const { return entries_[id].hash; }
+
+  // Same as GetPath(id).Serialize(), computed the first time it is needed.
+  const string& GetSerializedPath(PathId id) const;
+
+  // An estimate of the memory used by the interned paths, in bytes (not
+  // counting their serializations).
+  size_t GetMemoryUsage() const;
+
+ private:
+  struct Entry {
+    Path path;
+    PathId parent = kNoPathId;
+    size_t hash = 0;
+    mutable absl::once_flag serialized_once;
+    mutable string serialized;
+  };
+
+  // A deque, since an Entry can be neither copied nor moved, and so that the
+  // keys of children_ stay valid.
+  std::deque<Entry> entries_;
+  // The id of each path other than the empty path, by the ids of its parent
+  // and its last step (which points into the Entry of the path).
+  absl::flat_hash_map<std::pair<PathId, absl::string_view>, PathId> children_;
+};
+
 }  // namespace data_validation
 }  // namespace tensorflow
 
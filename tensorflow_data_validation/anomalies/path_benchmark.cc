@@ -0,0 +1,112 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Benchmarks of the serialization of paths.
+// Run with --benchmarks=all.
+
+#include "tensorflow_data_validation/anomalies/path.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow_data_validation/anomalies/allocation_counter.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+// Gets 1000 paths of num_steps steps. If quoted, every other step has to be
+// quoted when serialized.
+std::vector<Path> GetPaths(int num_steps, bool quoted) {
+  std::vector<Path> result;
+  for (int i = 0; i < 1000; ++i) {
+    std::vector<string> steps;
+    for (int j = 0; j < num_steps; ++j) {
+      if (j % 2 == 1) {
+        steps.push_back(absl::StrCat(quoted ? "feature's." : "(extension.",
+                                     i, quoted ? "" : ")"));
+      } else {
+        steps.push_back(absl::StrCat("feature_", i, "_", j));
+      }
+    }
+    result.emplace_back(std::move(steps));
+  }
+  return result;
+}
+
+void RunSerialize(int iters, int num_steps, bool quoted) {
+  ::tensorflow::testing::StopTiming();
+  const std::vector<Path> paths = GetPaths(num_steps, quoted);
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    for (const Path& path : paths) {
+      CHECK(!path.Serialize().empty());
+    }
+  }
+  SetAllocationLabel(start, iters);
+  ::tensorflow::testing::ItemsProcessed(static_cast<int64>(iters) *
+                                        paths.size());
+}
+
+void RunDeserialize(int iters, int num_steps, bool quoted) {
+  ::tensorflow::testing::StopTiming();
+  std::vector<string> serialized_paths;
+  for (const Path& path : GetPaths(num_steps, quoted)) {
+    serialized_paths.push_back(path.Serialize());
+  }
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    for (const string& serialized_path : serialized_paths) {
+      Path path;
+      TF_CHECK_OK(Path::Deserialize(serialized_path, &path));
+    }
+  }
+  SetAllocationLabel(start, iters);
+  ::tensorflow::testing::ItemsProcessed(static_cast<int64>(iters) *
+                                        serialized_paths.size());
+}
+
+// Unquoted steps, half of which are extensions in parentheses.
+void BM_Serialize(int iters, int num_steps) {
+  RunSerialize(iters, num_steps, /*quoted=*/false);
+}
+BENCHMARK(BM_Serialize)->Arg(2)->Arg(8);
+
+// Half of the steps are quoted.
+void BM_SerializeQuoted(int iters, int num_steps) {
+  RunSerialize(iters, num_steps, /*quoted=*/true);
+}
+BENCHMARK(BM_SerializeQuoted)->Arg(2)->Arg(8);
+
+void BM_Deserialize(int iters, int num_steps) {
+  RunDeserialize(iters, num_steps, /*quoted=*/false);
+}
+BENCHMARK(BM_Deserialize)->Arg(2)->Arg(8);
+
+void BM_DeserializeQuoted(int iters, int num_steps) {
+  RunDeserialize(iters, num_steps, /*quoted=*/true);
+}
+BENCHMARK(BM_DeserializeQuoted)->Arg(2)->Arg(8);
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -108,9 +108,13 @@ TEST(Path, Serialize) {
 }
 
 TEST(Path, Deserialize) {
-  std::vector<Path> paths_to_check = {Path({"a", ".b", "'c'"}),
-                                      Path({"a", "(b'.d)", "((c)"}), Path({""}),
-                                      Path()};
+  std::vector<Path> paths_to_check = {
+      Path({"a", ".b", "'c'"}),
+      Path({"a", "(b'.d)", "((c)"}),
+      Path({""}),
+      Path(),
+      Path({"()", "(a.b)", "(a", "a)", ")", ".", "'"}),
+      Path({"(a)(b)", "a(b)", "(a)b", "a.b", "(a.b).c"})};
   for (const Path& path : paths_to_check) {
     Path result;
     TF_ASSERT_OK(Path::Deserialize(path.Serialize(), &result))
@@ -131,7 +135,8 @@ TEST(Path, DeserializeSillyQuotes) {
 // Deserialize works anyway.
 TEST(Path, DeserializeBad) {
   const std::vector<string> bad_serializations = {
-      "a'", "'a", "(b", "c'd", "'c'd'", "''cd'", "'c'''d'"};
+      "a'", "'a", "(b", "c'd", "'c'd'", "''cd'", "'c'''d'",
+      "(a)b.c", "a..b", ".a", "a.", ")a", "(a(b)).c"};
   for (const string& bad : bad_serializations) {
     Path dummy;
     tensorflow::Status status = Path::Deserialize(bad, &dummy);
@@ -176,6 +181,33 @@ TEST(Path, PrintTo) {
   EXPECT_EQ(p.Serialize(), os.str());
 }
 
+TEST(PathInterner, Intern) {
+  PathInterner interner;
+  EXPECT_EQ(interner.Find(Path()), PathInterner::kEmptyPathId);
+  EXPECT_EQ(interner.GetParent(PathInterner::kEmptyPathId),
+            PathInterner::kNoPathId);
+  EXPECT_EQ(interner.Find(Path({"a"})), PathInterner::kNoPathId);
+
+  const PathId abc = interner.Intern(Path({"a", "b", "c"}));
+  // The ancestors are interned first.
+  EXPECT_EQ(interner.size(), 4);
+  EXPECT_EQ(abc, 3);
+  const PathId ab = interner.Find(Path({"a", "b"}));
+  EXPECT_EQ(ab, 2);
+  EXPECT_EQ(interner.GetParent(abc), ab);
+  EXPECT_EQ(interner.Intern(Path({"a", "b", "c"})), abc);
+  EXPECT_EQ(interner.InternChild(ab, "c"), abc);
+  EXPECT_THAT(interner.GetPath(abc), EqualsPath(Path({"a", "b", "c"})));
+  EXPECT_EQ(interner.GetSerializedPath(abc), "a.b.c");
+
+  const PathId abd = interner.InternChild(ab, "d'");
+  EXPECT_EQ(abd, 4);
+  EXPECT_EQ(interner.Find(Path({"a", "b", "d'"})), abd);
+  EXPECT_EQ(interner.GetSerializedPath(abd), "a.b.'d'''");
+  EXPECT_NE(interner.GetHash(abc), interner.GetHash(abd));
+  EXPECT_EQ(interner.Find(Path({"b"})), PathInterner::kNoPathId);
+}
+
 }  // namespace
 }  // namespace data_validation
 }  // namespace tensorflow
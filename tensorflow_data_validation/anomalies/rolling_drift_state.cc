@@ -0,0 +1,259 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/rolling_drift_state.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow_data_validation/anomalies/metrics.h"
+#include "tensorflow_data_validation/anomalies/path.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+#include "tensorflow_metadata/proto/v0/statistics.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::DriftSkewInfo;
+using FeatureState = RollingDriftState::Feature;
+
+int GetNumBuckets(const FeatureState& feature) {
+  return feature.boundary_size() > 0 ? feature.boundary_size() - 1
+                                     : feature.value_size();
+}
+
+// Checks that the sizes of the arrays of feature are consistent.
+Status CheckFeatureState(const FeatureState& feature, int max_spans) {
+  const int num_buckets = GetNumBuckets(feature);
+  if (feature.total_mass_size() != num_buckets ||
+      feature.span_mass_size() != num_buckets * max_spans ||
+      feature.num_present_size() != max_spans) {
+    return errors::InvalidArgument(
+        "Inconsistent rolling drift state for feature ",
+        Path(feature.path()).Serialize());
+  }
+  return Status::OK();
+}
+
+// Starts the state of a feature first seen in view: categorical if it has
+// string values, numeric if it has a standard histogram with at least one
+// bucket. Returns false if it has neither.
+bool InitFeatureState(const FeatureStatsView& view, int max_spans,
+                      FeatureState* feature) {
+  *feature->mutable_path() = view.GetPath().AsProto();
+  if (view.GetStringValueTable().empty()) {
+    if (view.GetStandardHistogramOrNull() == nullptr) {
+      return false;
+    }
+    const std::vector<double>& boundaries =
+        FeatureDistribution(view).GetHistogramBoundaries();
+    if (boundaries.size() < 2) {
+      return false;
+    }
+    for (const double boundary : boundaries) {
+      feature->add_boundary(boundary);
+    }
+  }
+  const int num_buckets = GetNumBuckets(*feature);
+  feature->mutable_total_mass()->Resize(num_buckets, 0.0);
+  feature->mutable_span_mass()->Resize(num_buckets * max_spans, 0.0);
+  feature->mutable_num_present()->Resize(max_spans, 0.0);
+  return true;
+}
+
+// Returns the distribution of view over the buckets of feature, normalized to
+// sum to 1, or an empty vector if view has no values in them. The values of a
+// categorical feature that are new are added to feature.
+std::vector<double> GetSpanMass(const FeatureStatsView& view, int max_spans,
+                                FeatureState* feature) {
+  std::vector<double> mass;
+  if (feature->boundary_size() > 0) {
+    const tensorflow::metadata::v0::Histogram* histogram =
+        view.GetStandardHistogramOrNull();
+    if (histogram == nullptr) {
+      return {};
+    }
+    mass = GetCountsOnBoundaries(
+        *histogram, std::vector<double>(feature->boundary().begin(),
+                                        feature->boundary().end()));
+  } else {
+    // The keys point into feature, whose strings do not move.
+    absl::flat_hash_map<absl::string_view, int> buckets;
+    buckets.reserve(feature->value_size());
+    for (int i = 0; i < feature->value_size(); ++i) {
+      buckets.emplace(feature->value(i), i);
+    }
+    mass.assign(feature->value_size(), 0.0);
+    for (const StringValueTable::Entry& entry : view.GetStringValueTable()) {
+      const auto inserted = buckets.emplace(entry.first, mass.size());
+      if (inserted.second) {
+        feature->add_value(string(entry.first));
+        feature->add_total_mass(0.0);
+        for (int slot = 0; slot < max_spans; ++slot) {
+          feature->add_span_mass(0.0);
+        }
+        mass.push_back(0.0);
+      }
+      mass[inserted.first->second] += entry.second;
+    }
+  }
+  double total = 0.0;
+  for (const double count : mass) {
+    total += count;
+  }
+  if (total <= 0.0) {
+    return {};
+  }
+  for (double& count : mass) {
+    count /= total;
+  }
+  return mass;
+}
+
+// Adds the measurements of the drift of mass against the average of the spans
+// of feature to drift_skew_info. Does nothing if the feature is in none of the
+// spans.
+void MeasureDrift(const FeatureState& feature, const std::vector<double>& mass,
+                  const tensorflow::metadata::v0::FeatureComparator& comparator,
+                  DriftSkewInfo* drift_skew_info) {
+  int num_spans_present = 0;
+  for (const double num_present : feature.num_present()) {
+    if (num_present > 0.0) {
+      ++num_spans_present;
+    }
+  }
+  if (num_spans_present == 0 || mass.empty()) {
+    return;
+  }
+  std::vector<double> baseline(feature.total_mass().begin(),
+                               feature.total_mass().end());
+  for (double& count : baseline) {
+    count /= num_spans_present;
+  }
+  if (feature.boundary_size() == 0 &&
+      comparator.infinity_norm().has_threshold()) {
+    double distance = 0.0;
+    for (int i = 0; i < mass.size(); ++i) {
+      distance = std::max(distance, std::abs(mass[i] - baseline[i]));
+    }
+    DriftSkewInfo::Measurement* measurement =
+        drift_skew_info->add_drift_measurements();
+    measurement->set_type(DriftSkewInfo::Measurement::L_INFTY);
+    measurement->set_value(distance);
+    measurement->set_threshold(comparator.infinity_norm().threshold());
+  }
+  double divergence;
+  if (feature.boundary_size() > 0 &&
+      comparator.jensen_shannon_divergence().has_threshold() &&
+      JensenShannonDivergence(mass, std::move(baseline), divergence).ok()) {
+    DriftSkewInfo::Measurement* measurement =
+        drift_skew_info->add_drift_measurements();
+    measurement->set_type(
+        DriftSkewInfo::Measurement::JENSEN_SHANNON_DIVERGENCE);
+    measurement->set_value(divergence);
+    measurement->set_threshold(
+        comparator.jensen_shannon_divergence().threshold());
+  }
+}
+
+// Replaces the span of feature in slot with mass (the feature is absent from
+// the span if mass is empty).
+void SetSpan(int slot, int max_spans, const std::vector<double>& mass,
+             double num_present, FeatureState* feature) {
+  for (int bucket = 0; bucket < feature->total_mass_size(); ++bucket) {
+    double& span_mass =
+        *feature->mutable_span_mass()->Mutable(bucket * max_spans + slot);
+    const double new_mass = mass.empty() ? 0.0 : mass[bucket];
+    // The total never goes below zero through rounding errors.
+    feature->set_total_mass(
+        bucket,
+        std::max(0.0, feature->total_mass(bucket) - span_mass + new_mass));
+    span_mass = new_mass;
+  }
+  feature->set_num_present(slot, mass.empty() ? 0.0 : num_present);
+}
+
+}  // namespace
+
+Status UpdateRollingDriftState(const DatasetStatsView& statistics,
+                               const IndexedSchema& schema,
+                               RollingDriftState* state,
+                               tensorflow::metadata::v0::Anomalies* result) {
+  const int max_spans = state->max_spans();
+  if (max_spans <= 0) {
+    return errors::InvalidArgument(
+        "The max_spans of a rolling drift state must be positive: ",
+        max_spans);
+  }
+  absl::flat_hash_map<Path, int> features;
+  features.reserve(state->feature_size());
+  for (int i = 0; i < state->feature_size(); ++i) {
+    TF_RETURN_IF_ERROR(CheckFeatureState(state->feature(i), max_spans));
+    features.emplace(Path(state->feature(i).path()), i);
+  }
+  const int slot = state->num_spans() % max_spans;
+  // Whether each feature of state is in statistics.
+  std::vector<bool> updated(state->feature_size(), false);
+  for (const FeatureStatsView& view : statistics.features()) {
+    const Path& path = view.GetPath();
+    const tensorflow::metadata::v0::Feature* feature = schema.GetFeature(path);
+    if (feature == nullptr || !feature->has_drift_comparator() ||
+        schema.FeatureIsDeprecated(path)) {
+      continue;
+    }
+    FeatureState* feature_state;
+    const auto iter = features.find(path);
+    if (iter != features.end()) {
+      feature_state = state->mutable_feature(iter->second);
+      updated[iter->second] = true;
+    } else {
+      FeatureState new_feature_state;
+      if (!InitFeatureState(view, max_spans, &new_feature_state)) {
+        continue;
+      }
+      feature_state = state->add_feature();
+      *feature_state = std::move(new_feature_state);
+    }
+    const std::vector<double> mass =
+        GetSpanMass(view, max_spans, feature_state);
+    DriftSkewInfo drift_skew_info;
+    MeasureDrift(*feature_state, mass, feature->drift_comparator(),
+                 &drift_skew_info);
+    if (drift_skew_info.drift_measurements_size() > 0) {
+      *drift_skew_info.mutable_path() = path.AsProto();
+      *result->add_drift_skew_info() = std::move(drift_skew_info);
+    }
+    SetSpan(slot, max_spans, mass, view.GetNumPresent(), feature_state);
+  }
+  // The features that are not in statistics are absent from its span.
+  for (int i = 0; i < updated.size(); ++i) {
+    if (!updated[i]) {
+      SetSpan(slot, max_spans, /*mass=*/{}, /*num_present=*/0.0,
+              state->mutable_feature(i));
+    }
+  }
+  state->set_num_spans(state->num_spans() + 1);
+  return Status::OK();
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
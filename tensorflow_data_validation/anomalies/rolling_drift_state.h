@@ -0,0 +1,51 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_ROLLING_DRIFT_STATE_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_ROLLING_DRIFT_STATE_H_
+
+#include "tensorflow_data_validation/anomalies/proto/validation_metadata.pb.h"
+#include "tensorflow_data_validation/anomalies/schema.h"
+#include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow_metadata/proto/v0/anomalies.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// Computes the drift of the features of statistics that have a drift
+// comparator in schema against their average distribution over the spans of
+// state, and then adds statistics to state as its most recent span (replacing
+// the oldest one if state already has state.max_spans() spans). On success,
+// result holds one drift_skew_info per feature measured, with one measurement
+// per threshold of its comparator: L_INFTY for the infinity_norm of a
+// categorical feature, and JENSEN_SHANNON_DIVERGENCE for the
+// jensen_shannon_divergence of a numeric feature. Nothing else is set in
+// result, and the comparators are not updated. A feature that is in none of
+// the spans of state is not measured.
+//
+// Takes time proportional to the size of statistics and of the distributions
+// in state, whatever the number of spans in state. A numeric feature keeps the
+// buckets of the first span where it was seen, and the later spans are
+// rebucketed into them.
+Status UpdateRollingDriftState(const DatasetStatsView& statistics,
+                               const IndexedSchema& schema,
+                               RollingDriftState* state,
+                               tensorflow::metadata::v0::Anomalies* result);
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_ROLLING_DRIFT_STATE_H_
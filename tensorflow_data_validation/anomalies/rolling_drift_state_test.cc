@@ -0,0 +1,185 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/rolling_drift_state.h"
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow_data_validation/anomalies/proto/validation_metadata.pb.h"
+#include "tensorflow_data_validation/anomalies/schema.h"
+#include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow_data_validation/anomalies/test_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/anomalies.pb.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+#include "tensorflow_metadata/proto/v0/statistics.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::Anomalies;
+using ::tensorflow::metadata::v0::DatasetFeatureStatistics;
+using ::tensorflow::metadata::v0::DriftSkewInfo;
+using testing::EqualsProto;
+using testing::ParseTextProtoOrDie;
+
+DatasetFeatureStatistics GetCategoricalStatistics(
+    const std::map<string, double>& counts) {
+  DatasetFeatureStatistics result = ParseTextProtoOrDie<
+      DatasetFeatureStatistics>(R"(
+    num_examples: 10
+    features {
+      name: 'c'
+      type: STRING
+      string_stats { common_stats { num_non_missing: 10 max_num_values: 1 } }
+    })");
+  tensorflow::metadata::v0::RankHistogram* histogram =
+      result.mutable_features(0)
+          ->mutable_string_stats()
+          ->mutable_rank_histogram();
+  for (const auto& pair : counts) {
+    tensorflow::metadata::v0::RankHistogram::Bucket* bucket =
+        histogram->add_buckets();
+    bucket->set_label(pair.first);
+    bucket->set_sample_count(pair.second);
+  }
+  return result;
+}
+
+// Adds the categorical statistics to state, and returns the L_INFTY drift
+// measured, or -1 if there is none.
+double GetCategoricalDrift(const IndexedSchema& schema,
+                           const std::map<string, double>& counts,
+                           RollingDriftState* state) {
+  const DatasetStatsView view(GetCategoricalStatistics(counts));
+  Anomalies result;
+  TF_CHECK_OK(UpdateRollingDriftState(view, schema, state, &result));
+  if (result.drift_skew_info_size() == 0) {
+    return -1.0;
+  }
+  CHECK_EQ(result.drift_skew_info(0).drift_measurements_size(), 1);
+  const DriftSkewInfo::Measurement& measurement =
+      result.drift_skew_info(0).drift_measurements(0);
+  CHECK_EQ(measurement.type(), DriftSkewInfo::Measurement::L_INFTY);
+  CHECK_EQ(measurement.threshold(), 0.1);
+  return measurement.value();
+}
+
+TEST(RollingDriftStateTest, Categorical) {
+  const IndexedSchema schema(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"(
+        feature {
+          name: 'c'
+          type: BYTES
+          drift_comparator { infinity_norm { threshold: 0.1 } }
+        })"));
+  RollingDriftState state;
+  state.set_max_spans(2);
+  // There is no previous span yet.
+  EXPECT_EQ(GetCategoricalDrift(schema, {{"a", 30}, {"b", 10}}, &state), -1.0);
+  EXPECT_NEAR(GetCategoricalDrift(schema, {{"a", 20}}, &state), 0.25, 1e-9);
+  // Against the average of (0.75, 0.25) and (1, 0).
+  EXPECT_NEAR(GetCategoricalDrift(schema, {{"b", 20}}, &state), 0.875, 1e-9);
+  // The first span was dropped: against the average of (1, 0) and (0, 1).
+  EXPECT_NEAR(GetCategoricalDrift(schema, {{"a", 10}}, &state), 0.5, 1e-9);
+  // A new value is added to all the spans.
+  EXPECT_NEAR(GetCategoricalDrift(schema, {{"d", 10}}, &state), 1.0, 1e-9);
+  EXPECT_EQ(state.num_spans(), 5);
+  ASSERT_EQ(state.feature_size(), 1);
+  EXPECT_EQ(state.feature(0).value_size(), 3);
+  EXPECT_EQ(state.feature(0).span_mass_size(), 6);
+}
+
+TEST(RollingDriftStateTest, Numeric) {
+  const IndexedSchema schema(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"(
+        feature {
+          name: 'n'
+          type: FLOAT
+          drift_comparator { jensen_shannon_divergence { threshold: 0.1 } }
+        })"));
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 20
+        features {
+          name: 'n'
+          type: FLOAT
+          num_stats {
+            common_stats { num_non_missing: 20 max_num_values: 1 }
+            histograms {
+              type: STANDARD
+              buckets { low_value: 0 high_value: 1 sample_count: 10 }
+              buckets { low_value: 1 high_value: 2 sample_count: 10 }
+            }
+          }
+        })");
+  DatasetFeatureStatistics shifted = statistics;
+  for (auto& bucket : *shifted.mutable_features(0)
+                           ->mutable_num_stats()
+                           ->mutable_histograms(0)
+                           ->mutable_buckets()) {
+    bucket.set_low_value(bucket.low_value() + 1.0);
+    bucket.set_high_value(bucket.high_value() + 1.0);
+  }
+  RollingDriftState state;
+  state.set_max_spans(30);
+  Anomalies result;
+  TF_ASSERT_OK(UpdateRollingDriftState(DatasetStatsView(statistics), schema,
+                                       &state, &result));
+  EXPECT_EQ(result.drift_skew_info_size(), 0);
+  TF_ASSERT_OK(UpdateRollingDriftState(DatasetStatsView(statistics), schema,
+                                       &state, &result));
+  EXPECT_THAT(result, EqualsProto(R"(
+    drift_skew_info {
+      path { step: 'n' }
+      drift_measurements {
+        type: JENSEN_SHANNON_DIVERGENCE
+        value: 0
+        threshold: 0.1
+      }
+    })"));
+
+  // The state can be serialized between spans. The shifted span is
+  // rebucketed into the buckets of the first one.
+  RollingDriftState parsed;
+  ASSERT_TRUE(parsed.ParseFromString(state.SerializeAsString()));
+  Anomalies shifted_result;
+  TF_ASSERT_OK(UpdateRollingDriftState(DatasetStatsView(shifted), schema,
+                                       &parsed, &shifted_result));
+  ASSERT_EQ(shifted_result.drift_skew_info_size(), 1);
+  // Against (0.5, 0.5), the shifted span is (0, 1).
+  EXPECT_NEAR(shifted_result.drift_skew_info(0).drift_measurements(0).value(),
+              0.311278, 1e-6);
+}
+
+TEST(RollingDriftStateTest, InvalidState) {
+  const IndexedSchema schema((tensorflow::metadata::v0::Schema()));
+  RollingDriftState state;
+  Anomalies result;
+  EXPECT_FALSE(UpdateRollingDriftState(
+                   DatasetStatsView(DatasetFeatureStatistics()), schema,
+                   &state, &result)
+                   .ok());
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
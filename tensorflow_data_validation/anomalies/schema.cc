@@ -15,32 +15,45 @@ limitations under the License.
 
 #include "tensorflow_data_validation/anomalies/schema.h"
 
+#include <algorithm>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
 #include "absl/types/optional.h"
 #include "tensorflow_data_validation/anomalies/bool_domain_util.h"
 #include "tensorflow_data_validation/anomalies/custom_domain_util.h"
 #include "tensorflow_data_validation/anomalies/dataset_constraints_util.h"
+#include "tensorflow_data_validation/anomalies/diff_util.h"
+#include "tensorflow_data_validation/anomalies/feature_check_program.h"
 #include "tensorflow_data_validation/anomalies/feature_util.h"
 #include "tensorflow_data_validation/anomalies/float_domain_util.h"
 #include "tensorflow_data_validation/anomalies/image_domain_util.h"
 #include "tensorflow_data_validation/anomalies/int_domain_util.h"
 #include "tensorflow_data_validation/anomalies/internal_types.h"
 #include "tensorflow_data_validation/anomalies/map_util.h"
+#include "tensorflow_data_validation/anomalies/metrics.h"
 #include "tensorflow_data_validation/anomalies/natural_language_domain_util.h"
 #include "tensorflow_data_validation/anomalies/path.h"
 #include "tensorflow_data_validation/anomalies/schema_util.h"
 #include "tensorflow_data_validation/anomalies/statistics_view.h"
 #include "tensorflow_data_validation/anomalies/string_domain_util.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_metadata/proto/v0/anomalies.pb.h"
 #include "tensorflow_metadata/proto/v0/schema.pb.h"
@@ -173,6 +186,139 @@ SparseFeature* GetExistingSparseFeatureHelper(
   return nullptr;
 }
 
+// Returns the value for key, or null if there is none.
+template <typename Map, typename Key>
+typename Map::mapped_type FindPtrOrNull(const Map& map, const Key& key) {
+  auto iter = map.find(key);
+  if (iter == map.end()) {
+    return nullptr;
+  }
+  return iter->second;
+}
+
+// Returns a pointer to the value for key, or null if there is none.
+template <typename Map, typename Key>
+const typename Map::mapped_type* FindOrNull(const Map& map, const Key& key) {
+  auto iter = map.find(key);
+  if (iter == map.end()) {
+    return nullptr;
+  }
+  return &iter->second;
+}
+
+// Overwrites the first element of result with the same name as an element of
+// overlay, or appends the element of overlay if there is no such element.
+template <typename T>
+void MergeByName(const tensorflow::protobuf::RepeatedPtrField<T>& overlay,
+                 tensorflow::protobuf::RepeatedPtrField<T>* result) {
+  std::map<string, int> index_by_name;
+  for (int i = result->size() - 1; i >= 0; --i) {
+    index_by_name[result->Get(i).name()] = i;
+  }
+  for (const T& element : overlay) {
+    auto iter = index_by_name.find(element.name());
+    if (iter == index_by_name.end()) {
+      *result->Add() = element;
+    } else {
+      *result->Mutable(iter->second) = element;
+    }
+  }
+}
+
+// Indexes the elements of a repeated field by name, to overwrite the first
+// element with the same name as another element (or append it if there is no
+// such element), as MergeByName() does, in constant time.
+template <typename T>
+class NameIndex {
+ public:
+  explicit NameIndex(tensorflow::protobuf::RepeatedPtrField<T>* elements)
+      : elements_(elements) {
+    Reindex();
+  }
+
+  // Must be called after elements are removed other than by Merge().
+  void Reindex() {
+    index_by_name_.clear();
+    num_indexed_ = 0;
+    IndexAdded();
+  }
+
+  // Must be called after elements are added other than by Merge().
+  void IndexAdded() {
+    for (; num_indexed_ < elements_->size(); ++num_indexed_) {
+      index_by_name_.emplace(elements_->Get(num_indexed_).name(),
+                             num_indexed_);
+    }
+  }
+
+  bool Contains(const string& name) const {
+    return index_by_name_.contains(name);
+  }
+
+  void Merge(const T& element) {
+    const auto inserted =
+        index_by_name_.emplace(element.name(), elements_->size());
+    if (inserted.second) {
+      *elements_->Add() = element;
+      ++num_indexed_;
+    } else {
+      *elements_->Mutable(inserted.first->second) = element;
+    }
+  }
+
+ private:
+  tensorflow::protobuf::RepeatedPtrField<T>* elements_;
+  absl::flat_hash_map<string, int> index_by_name_;
+  int num_indexed_ = 0;
+};
+
+// Adds to result the elements of overlay that differ from the element with the
+// same name in the baseline (as returned by get_baseline), or that are not in
+// the baseline.
+template <typename T, typename GetBaseline>
+void AddChangedByName(const tensorflow::protobuf::RepeatedPtrField<T>& overlay,
+                      const GetBaseline& get_baseline,
+                      tensorflow::protobuf::RepeatedPtrField<T>* result) {
+  for (const T& element : overlay) {
+    const T* baseline_element = get_baseline(element.name());
+    if (baseline_element == nullptr ||
+        baseline_element->SerializeAsString() != element.SerializeAsString()) {
+      *result->Add() = element;
+    }
+  }
+}
+
+// Returns the name of an entry of a top-level field of a schema, i.e., its name
+// field if it is an entry of a repeated field and has one, or the empty string
+// otherwise.
+string GetEntryName(const tensorflow::protobuf::FieldDescriptor& field,
+                    const tensorflow::protobuf::Message& entry) {
+  const tensorflow::protobuf::FieldDescriptor* name_field =
+      entry.GetDescriptor()->FindFieldByName("name");
+  if (!field.is_repeated() || name_field == nullptr ||
+      name_field->is_repeated() ||
+      name_field->cpp_type() !=
+          tensorflow::protobuf::FieldDescriptor::CPPTYPE_STRING) {
+    return "";
+  }
+  return entry.GetReflection()->GetString(entry, name_field);
+}
+
+// Gets the lines of an entry of a top-level field of a schema, as they are in
+// the text format of the schema.
+std::vector<string> GetEntryLines(const string& field_name,
+                                  const tensorflow::protobuf::Message& entry) {
+  string text;
+  CHECK(tensorflow::protobuf::TextFormat::PrintToString(entry, &text));
+  std::vector<string> lines = {absl::StrCat(field_name, " {")};
+  for (const absl::string_view line :
+       absl::StrSplit(text, '\n', absl::SkipEmpty())) {
+    lines.push_back(absl::StrCat("  ", line));
+  }
+  lines.push_back("}");
+  return lines;
+}
+
 // absl::nullopt is the set of all paths.
 bool ContainsPath(const absl::optional<std::set<Path>>& paths_to_consider,
                   const Path& path) {
@@ -193,8 +339,347 @@ absl::string_view GetDomainInfoName(const Feature& feature) {
   return "UNSET";
 }
 
+// Implements Schema::IsFeatureInEnvironment(), where default_environments are
+// the default environments of the schema.
+bool IsFeatureInEnvironment(
+    const Feature& feature,
+    const ::tensorflow::protobuf::RepeatedPtrField<string>&
+        default_environments,
+    const absl::optional<string>& environment) {
+  if (environment) {
+    if (ContainsValue(feature.in_environment(), *environment)) {
+      return true;
+    }
+    if (ContainsValue(feature.not_in_environment(), *environment)) {
+      return false;
+    }
+    if (ContainsValue(default_environments, *environment)) {
+      return true;
+    }
+    return false;
+  }
+  // If environment is not set, then the feature is considered in the
+  // environment by default.
+  return true;
+}
+
 }  // namespace
 
+IndexedSchema::IndexedSchema(const tensorflow::metadata::v0::Schema& schema)
+    : schema_(schema) {
+  IndexFeatures(Path(), schema_.feature(), schema_.sparse_feature(),
+                /*index=*/true, /*deprecated=*/false);
+  IndexEnvironments();
+  for (const WeightedFeature& weighted_feature : schema_.weighted_feature()) {
+    weighted_features_.emplace(weighted_feature.name(), &weighted_feature);
+  }
+  for (const StringDomain& string_domain : schema_.string_domain()) {
+    if (!string_domains_.contains(string_domain.name())) {
+      string_domains_.emplace(
+          string_domain.name(),
+          absl::make_unique<const IndexedStringDomain>(&string_domain));
+    }
+  }
+  CompileCheckPrograms();
+}
+
+void IndexedSchema::IndexFeatures(
+    const Path& parent,
+    const tensorflow::protobuf::RepeatedPtrField<Feature>& features,
+    const tensorflow::protobuf::RepeatedPtrField<SparseFeature>&
+        sparse_features,
+    bool index, bool deprecated) {
+  for (const Feature& feature : features) {
+    const Path path = parent.GetChild(feature.name());
+    const int id = features_by_id_.size();
+    features_by_id_.push_back(&feature);
+    const bool index_feature = index && features_.emplace(path, id).second;
+    if (index_feature) {
+      has_drift_comparator_ =
+          has_drift_comparator_ || feature.has_drift_comparator();
+      if (feature.has_skew_comparator()) {
+        skew_comparator_paths_.push_back(path);
+      }
+    }
+    // Like Schema::GetAllRequiredFeatures(), ignores the features under a
+    // deprecated feature.
+    const bool feature_deprecated =
+        deprecated ||
+        ::tensorflow::data_validation::FeatureIsDeprecated(feature);
+    if (!feature_deprecated && (feature.presence().min_count() > 0 ||
+                                feature.presence().min_fraction() > 0.0)) {
+      required_features_.push_back({path, &feature, id});
+    }
+    IndexFeatures(path, feature.struct_domain().feature(),
+                  feature.struct_domain().sparse_feature(), index_feature,
+                  feature_deprecated);
+  }
+  if (!index) {
+    return;
+  }
+  for (const SparseFeature& sparse_feature : sparse_features) {
+    sparse_features_.emplace(parent.GetChild(sparse_feature.name()),
+                             &sparse_feature);
+  }
+}
+
+void IndexedSchema::IndexEnvironments() {
+  std::vector<string> names(schema_.default_environment().begin(),
+                            schema_.default_environment().end());
+  for (const Feature* feature : features_by_id_) {
+    names.insert(names.end(), feature->in_environment().begin(),
+                 feature->in_environment().end());
+    names.insert(names.end(), feature->not_in_environment().begin(),
+                 feature->not_in_environment().end());
+  }
+  std::vector<absl::optional<string>> environments = {absl::nullopt,
+                                                      absl::nullopt};
+  for (const string& name : names) {
+    if (environment_ids_.emplace(name, environments.size()).second) {
+      environments.push_back(name);
+    }
+  }
+  const int num_features = features_by_id_.size();
+  environments_.resize(environments.size());
+  for (int environment_id = 0; environment_id < environments.size();
+       ++environment_id) {
+    EnvironmentFeatures& environment = environments_[environment_id];
+    environment.in_environment.resize(num_features, environment_id == 0);
+    environment.required.resize(num_features, false);
+    // No feature is in an environment that is not in the schema.
+    if (environment_id == 1) {
+      continue;
+    }
+    for (int id = 0; id < num_features; ++id) {
+      const Feature& feature = *features_by_id_[id];
+      environment.in_environment[id] =
+          ::tensorflow::data_validation::IsFeatureInEnvironment(
+              feature, schema_.default_environment(),
+              environments[environment_id]);
+    }
+  }
+  for (const RequiredFeature& required : required_features_) {
+    for (EnvironmentFeatures& environment : environments_) {
+      environment.required[required.id] =
+          environment.in_environment[required.id];
+    }
+  }
+}
+
+void IndexedSchema::CompileCheckPrograms() {
+  check_programs_.resize(features_by_id_.size());
+  for (const auto& path_and_id : features_) {
+    // Schema::UpdateFeature() checks the sparse or weighted feature instead.
+    if (GetSparseFeature(path_and_id.first) != nullptr ||
+        GetWeightedFeature(path_and_id.first) != nullptr) {
+      continue;
+    }
+    check_programs_[path_and_id.second] =
+        FeatureCheckProgram::Compile(*features_by_id_[path_and_id.second]);
+  }
+}
+
+bool IndexedSchema::FeatureChecksPass(const FeatureStatsView& view,
+                                      bool skip_comparators) const {
+  const auto iter = features_.find(view.GetPath());
+  if (iter == features_.end()) {
+    return false;
+  }
+  const FeatureCheckProgram* program = check_programs_[iter->second].get();
+  return program != nullptr &&
+         FeatureIdIsInEnvironment(iter->second,
+                                  GetEnvironmentId(view.environment())) &&
+         program->Passes(view, skip_comparators);
+}
+
+int IndexedSchema::GetEnvironmentId(
+    const absl::optional<string>& environment) const {
+  if (!environment) {
+    return 0;
+  }
+  const auto iter = environment_ids_.find(*environment);
+  return iter == environment_ids_.end() ? 1 : iter->second;
+}
+
+const Feature* IndexedSchema::GetFeature(const Path& path) const {
+  const auto iter = features_.find(path);
+  return iter == features_.end() ? nullptr : features_by_id_[iter->second];
+}
+
+const SparseFeature* IndexedSchema::GetSparseFeature(const Path& path) const {
+  return FindPtrOrNull(sparse_features_, path);
+}
+
+const WeightedFeature* IndexedSchema::GetWeightedFeature(
+    const Path& path) const {
+  if (path.size() != 1) {
+    // Weighted features are always top-level features with single-step paths.
+    return nullptr;
+  }
+  return FindPtrOrNull(weighted_features_, path.last_step());
+}
+
+const StringDomain* IndexedSchema::GetStringDomain(const string& name) const {
+  const auto iter = string_domains_.find(name);
+  return iter == string_domains_.end() ? nullptr : iter->second->string_domain;
+}
+
+const StringDomainValueSet* IndexedSchema::GetStringDomainValues(
+    const string& name) const {
+  const auto iter = string_domains_.find(name);
+  if (iter == string_domains_.end()) {
+    return nullptr;
+  }
+  absl::call_once(string_pool_once_, [this]() { InternStringDomains(); });
+  return &iter->second->values;
+}
+
+const StringDomainValueSet* IndexedSchema::GetFeatureStringDomainValues(
+    const Path& path) const {
+  const auto iter = features_.find(path);
+  if (iter == features_.end()) {
+    return nullptr;
+  }
+  const Feature& feature = *features_by_id_[iter->second];
+  switch (feature.domain_info_case()) {
+    case Feature::kStringDomain:
+      absl::call_once(string_pool_once_, [this]() { InternStringDomains(); });
+      return inline_string_domains_[iter->second].get();
+    case Feature::kDomain:
+      return GetStringDomainValues(feature.domain());
+    default:
+      return nullptr;
+  }
+}
+
+void IndexedSchema::InternStringDomains() const {
+  // The domains are interned in the order of the schema, so that the ids do
+  // not depend on the order of the maps.
+  for (const StringDomain& string_domain : schema_.string_domain()) {
+    const IndexedStringDomain& domain =
+        *string_domains_.at(string_domain.name());
+    if (domain.string_domain == &string_domain) {
+      domain.values = InternStrings(string_domain.value(), &string_pool_);
+    }
+  }
+  std::vector<bool> indexed(features_by_id_.size());
+  for (const auto& path_and_id : features_) {
+    indexed[path_and_id.second] = true;
+  }
+  inline_string_domains_.resize(features_by_id_.size());
+  for (int id = 0; id < features_by_id_.size(); ++id) {
+    const Feature& feature = *features_by_id_[id];
+    if (indexed[id] && feature.has_string_domain()) {
+      inline_string_domains_[id] =
+          absl::make_unique<const StringDomainValueSet>(InternStrings(
+              feature.string_domain().value(), &string_pool_));
+    }
+  }
+}
+
+bool IndexedSchema::FeatureExists(const Path& path) const {
+  return GetFeature(path) != nullptr || GetSparseFeature(path) != nullptr ||
+         GetWeightedFeature(path) != nullptr;
+}
+
+bool IndexedSchema::FeatureIsDeprecated(const Path& path) const {
+  const Feature* feature = GetFeature(path);
+  if (feature == nullptr) {
+    const SparseFeature* sparse_feature = GetSparseFeature(path);
+    if (sparse_feature != nullptr) {
+      return ::tensorflow::data_validation::SparseFeatureIsDeprecated(
+          *sparse_feature);
+    }
+    // Here, the result is undefined.
+    return false;
+  }
+  return ::tensorflow::data_validation::FeatureIsDeprecated(*feature);
+}
+
+bool IndexedSchema::FeatureIsInEnvironment(
+    const Path& path, const absl::optional<string>& environment) const {
+  const auto iter = features_.find(path);
+  return iter == features_.end() ||
+         FeatureIdIsInEnvironment(iter->second, GetEnvironmentId(environment));
+}
+
+bool IndexedSchema::UsesPreviousSpan() const {
+  return has_drift_comparator_ ||
+         schema_.dataset_constraints().has_num_examples_drift_comparator();
+}
+
+bool IndexedSchema::UsesPreviousVersion() const {
+  return schema_.dataset_constraints().has_num_examples_version_comparator();
+}
+
+SchemaText::SchemaText(const tensorflow::metadata::v0::Schema& schema) {
+  CHECK(tensorflow::protobuf::TextFormat::PrintToString(schema, &text));
+  lines = absl::StrSplit(text, '\n');
+  if (!lines.empty() && lines.back().empty()) {
+    lines.pop_back();
+  }
+  const tensorflow::protobuf::Descriptor& descriptor = *schema.GetDescriptor();
+  const tensorflow::protobuf::Reflection& reflection = *schema.GetReflection();
+  // The number of entries of each field seen so far.
+  std::map<int, int> num_entries;
+  // In the text format, each top-level entry starts on a line that is not
+  // indented, and an entry that is a message ends on the next line that is
+  // "}", as its fields are indented.
+  int start = 0;
+  while (start < lines.size()) {
+    const absl::string_view line = lines[start];
+    int end = start + 1;
+    if (absl::EndsWith(line, " {")) {
+      while (end < lines.size() && lines[end] != "}") {
+        ++end;
+      }
+      end = std::min<int>(end + 1, lines.size());
+    }
+    const tensorflow::protobuf::FieldDescriptor* field =
+        descriptor.FindFieldByName(
+            string(line.substr(0, line.find_first_of(": "))));
+    if (field != nullptr) {
+      const auto inserted =
+          fields.emplace(field->number(), LineRange(start, end));
+      inserted.first->second.second = end;
+      if (field->cpp_type() ==
+          tensorflow::protobuf::FieldDescriptor::CPPTYPE_MESSAGE) {
+        const int index = num_entries[field->number()]++;
+        const tensorflow::protobuf::Message& entry =
+            field->is_repeated()
+                ? reflection.GetRepeatedMessage(schema, field, index)
+                : reflection.GetMessage(schema, field);
+        entries[field->number()].emplace(GetEntryName(*field, entry),
+                                         LineRange(start, end));
+      }
+    }
+    start = end;
+  }
+}
+
+IndexedSchema::IndexedSchema(const tensorflow::metadata::v0::Schema& schema,
+                             uint64 fingerprint)
+    : IndexedSchema(schema) {
+  absl::call_once(fingerprint_once_,
+                  [this, fingerprint]() { fingerprint_ = fingerprint; });
+}
+
+uint64 IndexedSchema::fingerprint() const {
+  absl::call_once(fingerprint_once_, [this]() {
+    string serialized;
+    CHECK(SerializeToStringDeterministic(schema_, &serialized));
+    fingerprint_ = Fingerprint64(serialized);
+  });
+  return fingerprint_;
+}
+
+const SchemaText& IndexedSchema::text() const {
+  absl::call_once(text_once_, [this]() {
+    text_ = absl::make_unique<const SchemaText>(schema_);
+  });
+  return *text_;
+}
+
 Status Schema::Init(const tensorflow::metadata::v0::Schema& input) {
   if (!IsEmpty()) {
     return InvalidArgument("Schema is not empty when Init() called.");
@@ -203,6 +688,14 @@ Status Schema::Init(const tensorflow::metadata::v0::Schema& input) {
   return Status::OK();
 }
 
+Status Schema::InitOverlay(std::shared_ptr<const IndexedSchema> baseline) {
+  if (!IsEmpty()) {
+    return InvalidArgument("Schema is not empty when InitOverlay() called.");
+  }
+  baseline_ = CHECK_NOTNULL(std::move(baseline));
+  return Status::OK();
+}
+
 Status Schema::Update(const DatasetStatsView& dataset_stats,
                       const FeatureStatisticsToProtoConfig& config) {
   return Update(dataset_stats, Updater(config), absl::nullopt);
@@ -221,7 +714,31 @@ tensorflow::Status Schema::UpdateFeature(
     std::vector<Description>* descriptions,
     absl::optional<tensorflow::metadata::v0::DriftSkewInfo>* drift_skew_info,
     tensorflow::metadata::v0::AnomalyInfo::Severity* severity) {
+  return UpdateFeature(updater, feature_stats_view, descriptions,
+                       drift_skew_info, severity, /*tracker=*/nullptr);
+}
+
+tensorflow::Status Schema::UpdateFeature(
+    const Updater& updater, const FeatureStatsView& feature_stats_view,
+    std::vector<Description>* descriptions,
+    absl::optional<tensorflow::metadata::v0::DriftSkewInfo>* drift_skew_info,
+    tensorflow::metadata::v0::AnomalyInfo::Severity* severity,
+    FeatureCostTracker* tracker) {
+  bool comparators_skipped;
+  return UpdateFeature(updater, feature_stats_view, descriptions,
+                       drift_skew_info, severity, tracker, /*deadline=*/nullptr,
+                       &comparators_skipped);
+}
+
+tensorflow::Status Schema::UpdateFeature(
+    const Updater& updater, const FeatureStatsView& feature_stats_view,
+    std::vector<Description>* descriptions,
+    absl::optional<tensorflow::metadata::v0::DriftSkewInfo>* drift_skew_info,
+    tensorflow::metadata::v0::AnomalyInfo::Severity* severity,
+    FeatureCostTracker* tracker, const ValidationDeadline* deadline,
+    bool* comparators_skipped) {
   *severity = tensorflow::metadata::v0::AnomalyInfo::UNKNOWN;
+  *comparators_skipped = false;
 
   Feature* feature = GetExistingFeature(feature_stats_view.GetPath());
   SparseFeature* sparse_feature =
@@ -274,7 +791,8 @@ tensorflow::Status Schema::UpdateFeature(
 
   if (feature != nullptr) {
     UpdateFeatureInternal(updater, feature_stats_view, feature, descriptions,
-                          drift_skew_info);
+                          drift_skew_info, tracker, deadline,
+                          comparators_skipped);
     updater.UpdateSeverityForAnomaly(*descriptions, severity);
     return Status::OK();
   } else {
@@ -345,6 +863,22 @@ Schema::Updater::Updater(const FeatureStatisticsToProtoConfig& config)
       grouped_enums_[Path(column_path)] = constraint.enum_name();
     }
   }
+  using ::tensorflow::metadata::v0::AnomalyInfo;
+  // By default, all anomalies are ERROR level.
+  severity_by_type_.assign(AnomalyInfo::Type_ARRAYSIZE, AnomalyInfo::ERROR);
+  if (config.new_features_are_warnings()) {
+    LOG(WARNING) << "new_features_are_warnings is deprecated. Use "
+                    "severity_overrides";
+    severity_by_type_[AnomalyInfo::SCHEMA_NEW_COLUMN] = AnomalyInfo::WARNING;
+  }
+  // Later overrides of the same type take precedence.
+  for (const auto& severity_override : config.severity_overrides()) {
+    if (severity_override.type() >= 0 &&
+        severity_override.type() < severity_by_type_.size()) {
+      severity_by_type_[severity_override.type()] =
+          severity_override.severity();
+    }
+  }
 }
 
 // Sets the severity based on anomaly descriptions, possibly using severity
@@ -353,22 +887,10 @@ void Schema::Updater::UpdateSeverityForAnomaly(
     const std::vector<Description>& descriptions,
     tensorflow::metadata::v0::AnomalyInfo::Severity* severity) const {
   for (const auto& description : descriptions) {
-    // By default, all anomalies are ERROR level.
-    tensorflow::metadata::v0::AnomalyInfo::Severity severity_for_anomaly =
-        tensorflow::metadata::v0::AnomalyInfo::ERROR;
-
-    if (config_.new_features_are_warnings() &&
-        (description.type ==
-         tensorflow::metadata::v0::AnomalyInfo::SCHEMA_NEW_COLUMN)) {
-      LOG(WARNING) << "new_features_are_warnings is deprecated. Use "
-                      "severity_overrides";
-      severity_for_anomaly = tensorflow::metadata::v0::AnomalyInfo::WARNING;
-    }
-    for (const auto& severity_override : config_.severity_overrides()) {
-      if (severity_override.type() == description.type) {
-        severity_for_anomaly = severity_override.severity();
-      }
-    }
+    const tensorflow::metadata::v0::AnomalyInfo::Severity severity_for_anomaly =
+        description.type >= 0 && description.type < severity_by_type_.size()
+            ? severity_by_type_[description.type]
+            : tensorflow::metadata::v0::AnomalyInfo::ERROR;
     *severity = MaxSeverity(*severity, severity_for_anomaly);
   }
 }
@@ -386,16 +908,14 @@ Status Schema::Updater::CreateColumn(
   feature->set_type(feature_stats_view.GetFeatureType());
   InitPresenceAndShape(feature_stats_view, config_.infer_feature_shape(),
                        feature);
-  if (ContainsKey(columns_to_ignore_,
-                  feature_stats_view.GetPath().Serialize())) {
+  if (ContainsKey(columns_to_ignore_, feature_stats_view.GetSerializedPath())) {
     ::tensorflow::data_validation::DeprecateFeature(feature);
     return Status::OK();
   }
 
-  if (BestEffortUpdateCustomDomain(feature_stats_view.custom_stats(),
-                                   feature)) {
+  if (BestEffortUpdateCustomDomain(feature_stats_view, feature)) {
     return Status::OK();
-  } else if (ContainsKey(grouped_enums_, feature_stats_view.GetPath())) {
+  } else if (grouped_enums_.contains(feature_stats_view.GetPath())) {
     const string& enum_name = grouped_enums_.at(feature_stats_view.GetPath());
     StringDomain* result = schema->GetExistingStringDomain(enum_name);
     if (result == nullptr) {
@@ -418,7 +938,7 @@ Status Schema::Updater::CreateColumn(
   } else if (IsStringDomainCandidate(feature_stats_view,
                                      config_.enum_threshold())) {
     StringDomain* string_domain =
-        schema->GetNewStringDomain(feature_stats_view.GetPath().Serialize());
+        schema->GetNewStringDomain(feature_stats_view.GetSerializedPath());
     UpdateStringDomain(*this, feature_stats_view, 0, string_domain);
     *feature->mutable_domain() = string_domain->name();
     return Status::OK();
@@ -436,19 +956,48 @@ bool Schema::Updater::string_domain_too_big(int size) const {
 }
 
 bool Schema::IsEmpty() const {
+  if (baseline_ != nullptr && (!baseline_->schema().feature().empty() ||
+                               !baseline_->schema().string_domain().empty())) {
+    return false;
+  }
   return schema_.feature().empty() && schema_.string_domain().empty();
 }
 
-void Schema::Clear() { schema_.Clear(); }
+size_t Schema::GetMemoryUsage() const {
+  size_t result = sizeof(*this) + schema_.SpaceUsedLong() - sizeof(schema_);
+  for (const string& domain_name : cleared_string_domains_) {
+    result += domain_name.capacity();
+  }
+  return result;
+}
+
+void Schema::Clear() {
+  schema_.Clear();
+  baseline_.reset();
+  cleared_string_domains_.clear();
+}
+
+const tensorflow::metadata::v0::Schema& Schema::root_schema() const {
+  return baseline_ != nullptr ? baseline_->schema() : schema_;
+}
 
 StringDomain* Schema::GetNewStringDomain(const string& candidate_name) {
-  std::set<string> names;
-  for (const StringDomain& string_domain : schema_.string_domain()) {
-    names.insert(string_domain.name());
-  }
+  // For an overlay, the names of the string domains of the baseline are
+  // taken too, unless they were cleared.
+  auto is_taken = [this](const string& name) {
+    UseStringDomainName(name);
+    for (const StringDomain& string_domain : schema_.string_domain()) {
+      if (string_domain.name() == name) {
+        return true;
+      }
+    }
+    return baseline_ != nullptr &&
+           baseline_->GetStringDomain(name) != nullptr &&
+           !ContainsKey(cleared_string_domains_, name);
+  };
   string new_name = candidate_name;
   int index = 1;
-  while (ContainsKey(names, new_name)) {
+  while (is_taken(new_name)) {
     ++index;
     new_name = absl::StrCat(candidate_name, index);
   }
@@ -458,38 +1007,78 @@ StringDomain* Schema::GetNewStringDomain(const string& candidate_name) {
 }
 
 StringDomain* Schema::GetExistingStringDomain(const string& name) {
+  UseStringDomainName(name);
   for (int i = 0; i < schema_.string_domain_size(); ++i) {
     StringDomain* possible = schema_.mutable_string_domain(i);
     if (possible->name() == name) {
       return possible;
     }
   }
+  if (baseline_ != nullptr && !ContainsKey(cleared_string_domains_, name)) {
+    const StringDomain* baseline_string_domain =
+        baseline_->GetStringDomain(name);
+    if (baseline_string_domain != nullptr) {
+      StringDomain* result = schema_.add_string_domain();
+      *result = *baseline_string_domain;
+      return result;
+    }
+  }
 
   // If there is no match, return nullptr.
   return nullptr;
 }
 
+void Schema::UseStringDomainName(const string& name) const {
+  if (string_domain_names_ != nullptr) {
+    string_domain_names_->used.insert(name);
+  }
+}
+
+const StringDomainValueSet* Schema::GetBaselineStringDomainValues(
+    const string& name) const {
+  UseStringDomainName(name);
+  if (baseline_ == nullptr || ContainsKey(cleared_string_domains_, name)) {
+    return nullptr;
+  }
+  for (const StringDomain& string_domain : schema_.string_domain()) {
+    if (string_domain.name() == name) {
+      return nullptr;
+    }
+  }
+  return baseline_->GetStringDomainValues(name);
+}
+
+Feature* Schema::GetExistingTopLevelFeature(const string& name) {
+  Feature* feature = GetExistingFeatureHelper(name, schema_.mutable_feature());
+  if (feature != nullptr || baseline_ == nullptr) {
+    return feature;
+  }
+  const Feature* baseline_feature = baseline_->GetFeature(Path({name}));
+  if (baseline_feature == nullptr) {
+    return nullptr;
+  }
+  feature = schema_.add_feature();
+  *feature = *baseline_feature;
+  // The copy must not refer to string domains already cleared in the overlay.
+  for (const string& domain_name : cleared_string_domains_) {
+    ClearStringDomainHelper(domain_name, schema_.mutable_feature());
+  }
+  return feature;
+}
+
 std::vector<std::set<string>> Schema::SimilarEnumTypes(
     const EnumsSimilarConfig& config) const {
-  std::vector<bool> used(schema_.string_domain_size(), false);
+  const std::vector<std::vector<int>> similar_domains =
+      GetSimilarStringDomains(schema_.string_domain(), config);
   std::vector<std::set<string>> result;
   for (int index_a = 0; index_a < schema_.string_domain_size(); ++index_a) {
-    if (!used[index_a]) {
-      const StringDomain& string_domain_a = schema_.string_domain(index_a);
+    if (!similar_domains[index_a].empty()) {
       std::set<string> similar;
-      for (int index_b = index_a + 1; index_b < schema_.string_domain_size();
-           ++index_b) {
-        if (!used[index_b]) {
-          const StringDomain& string_domain_b = schema_.string_domain(index_b);
-          if (IsSimilarStringDomain(string_domain_a, string_domain_b, config)) {
-            similar.insert(string_domain_b.name());
-          }
-        }
-      }
-      if (!similar.empty()) {
-        similar.insert(string_domain_a.name());
-        result.push_back(similar);
+      for (const int index_b : similar_domains[index_a]) {
+        similar.insert(schema_.string_domain(index_b).name());
       }
+      similar.insert(schema_.string_domain(index_a).name());
+      result.push_back(similar);
     }
   }
   return result;
@@ -521,15 +1110,84 @@ std::vector<Path> Schema::GetAllRequiredFeatures(
 
 std::vector<Path> Schema::GetMissingPaths(
     const DatasetStatsView& dataset_stats) {
-  std::set<Path> paths_present;
-  for (const FeatureStatsView& feature_stats_view : dataset_stats.features()) {
-    paths_present.insert(feature_stats_view.GetPath());
-  }
+  const absl::optional<string>& environment = dataset_stats.environment();
   std::vector<Path> paths_absent;
+  // An overlay to which no feature was added uses the required features
+  // precomputed by its baseline.
+  if (baseline_ != nullptr && schema_.feature().empty()) {
+    const int environment_id = baseline_->GetEnvironmentId(environment);
+    for (const IndexedSchema::RequiredFeature& required :
+         baseline_->required_features()) {
+      if (baseline_->FeatureIdIsRequired(required.id, environment_id) &&
+          !dataset_stats.HasPath(required.path)) {
+        paths_absent.push_back(required.path);
+      }
+    }
+    return paths_absent;
+  }
 
-  for (const Path& path : GetAllRequiredFeatures(Path(), schema_.feature(),
-                                                 dataset_stats.environment())) {
-    if (!ContainsKey(paths_present, path)) {
+  // An overlay only holds the features that have been looked up, so it is
+  // only materialized if some features have been copied.
+  const std::vector<Path> required_paths =
+      (baseline_ == nullptr)
+          ? GetAllRequiredFeatures(Path(), schema_.feature(), environment)
+          : GetAllRequiredFeatures(Path(), GetSchema().feature(), environment);
+  for (const Path& path : required_paths) {
+    if (!dataset_stats.HasPath(path)) {
+      paths_absent.push_back(path);
+    }
+  }
+  return paths_absent;
+}
+
+std::vector<Path> Schema::GetMissingPaths(const DatasetStatsView& dataset_stats,
+                                          const std::set<Path>& paths) {
+  // Looks up the features in the index of the baseline if possible, so that
+  // the schema is neither materialized nor walked.
+  std::unique_ptr<const IndexedSchema> materialized;
+  const IndexedSchema* index = baseline_.get();
+  if (baseline_ == nullptr) {
+    materialized = absl::make_unique<const IndexedSchema>(schema_);
+    index = materialized.get();
+  } else if (!schema_.feature().empty()) {
+    materialized = absl::make_unique<const IndexedSchema>(GetSchema());
+    index = materialized.get();
+  }
+  const absl::optional<string>& environment = dataset_stats.environment();
+  std::set<Path> required_paths;
+  for (const Path& path : paths) {
+    // Like GetAllRequiredFeatures(...), ignores the features under a
+    // deprecated feature.
+    std::vector<Path> prefixes;
+    for (Path prefix = path; !prefix.empty(); prefix = prefix.GetParent()) {
+      prefixes.push_back(prefix);
+    }
+    std::reverse(prefixes.begin(), prefixes.end());
+    const Feature* feature = nullptr;
+    for (const Path& prefix : prefixes) {
+      if (feature != nullptr &&
+          ::tensorflow::data_validation::FeatureIsDeprecated(*feature)) {
+        feature = nullptr;
+        break;
+      }
+      feature = index->GetFeature(prefix);
+      if (feature == nullptr) {
+        break;
+      }
+      if (IsExistenceRequired(*feature, environment)) {
+        required_paths.insert(prefix);
+      }
+    }
+    if (feature != nullptr &&
+        !::tensorflow::data_validation::FeatureIsDeprecated(*feature)) {
+      const std::vector<Path> descendants = GetAllRequiredFeatures(
+          path, feature->struct_domain().feature(), environment);
+      required_paths.insert(descendants.begin(), descendants.end());
+    }
+  }
+  std::vector<Path> paths_absent;
+  for (const Path& path : required_paths) {
+    if (!dataset_stats.HasPath(path)) {
       paths_absent.push_back(path);
     }
   }
@@ -555,10 +1213,18 @@ Status Schema::Update(const DatasetStatsView& dataset_stats,
   std::vector<Description> descriptions;
   tensorflow::metadata::v0::AnomalyInfo::Severity severity;
 
-  for (const auto& feature_stats_view : dataset_stats.GetRootFeatures()) {
-    TF_RETURN_IF_ERROR(UpdateRecursively(updater, feature_stats_view,
-                                         paths_to_consider, &descriptions,
-                                         &severity));
+  const std::vector<FeatureStatsView> root_features =
+      dataset_stats.GetRootFeatures();
+  const int num_threads = updater.config().num_threads();
+  if (num_threads > 1 && root_features.size() > 1 && baseline_ == nullptr) {
+    TF_RETURN_IF_ERROR(UpdateRootFeaturesInParallel(
+        updater, root_features, paths_to_consider, num_threads));
+  } else {
+    for (const auto& feature_stats_view : root_features) {
+      TF_RETURN_IF_ERROR(UpdateRecursively(updater, feature_stats_view,
+                                           paths_to_consider, &descriptions,
+                                           &severity));
+    }
   }
   for (const Path& missing_path : GetMissingPaths(dataset_stats)) {
     if (ContainsPath(paths_to_consider, missing_path)) {
@@ -568,6 +1234,133 @@ Status Schema::Update(const DatasetStatsView& dataset_stats,
   return Status::OK();
 }
 
+Status Schema::UpdateRootFeaturesInParallel(
+    const Updater& updater, const std::vector<FeatureStatsView>& root_features,
+    const absl::optional<std::set<Path>>& paths_to_consider,
+    int num_threads) {
+  // Each root feature is first updated in its own overlay on the schema as it
+  // was before any update. Only its own top-level feature (or sparse or
+  // weighted feature) and the string domains are shared with the updates of
+  // the other root features. So if the update did not use a string domain
+  // that the updates of the earlier root features changed, it is the same as
+  // if the root features were updated one after another.
+  struct PartialUpdate {
+    Schema schema;
+    StringDomainNames string_domain_names;
+    Status status;
+  };
+  const auto baseline = std::make_shared<const IndexedSchema>(schema_);
+  std::vector<PartialUpdate> partial_updates(root_features.size());
+  {
+    thread::ThreadPool thread_pool(
+        Env::Default(), "update_schema",
+        std::min<int>(num_threads, root_features.size()));
+    for (int i = 0; i < root_features.size(); ++i) {
+      thread_pool.Schedule([&, i]() {
+        PartialUpdate& partial_update = partial_updates[i];
+        partial_update.schema.string_domain_names_ =
+            &partial_update.string_domain_names;
+        partial_update.status = partial_update.schema.InitOverlay(baseline);
+        if (partial_update.status.ok()) {
+          std::vector<Description> descriptions;
+          tensorflow::metadata::v0::AnomalyInfo::Severity severity;
+          partial_update.status = partial_update.schema.UpdateRecursively(
+              updater, root_features[i], paths_to_consider, &descriptions,
+              &severity);
+        }
+      });
+    }
+    // The destructor of thread_pool waits for all the scheduled work.
+  }
+
+  // The updates are merged in the order of the root features. An update that
+  // depends on an earlier one is done again, on the merged schema.
+  NameIndex<Feature> features(schema_.mutable_feature());
+  NameIndex<SparseFeature> sparse_features(schema_.mutable_sparse_feature());
+  NameIndex<WeightedFeature> weighted_features(
+      schema_.mutable_weighted_feature());
+  NameIndex<StringDomain> string_domains(schema_.mutable_string_domain());
+  std::set<string> root_names;
+  // The string domains changed (or cleared) by the updates merged so far.
+  std::set<string> changed_string_domains;
+  // The string domains cleared by the updates merged so far, and not added
+  // again. References to them are cleared from the later updates too.
+  std::set<string> cleared_string_domains;
+  for (int i = 0; i < root_features.size(); ++i) {
+    PartialUpdate& partial_update = partial_updates[i];
+    TF_RETURN_IF_ERROR(partial_update.status);
+    bool independent =
+        root_names.insert(root_features[i].GetSerializedPath()).second;
+    for (const string& name : partial_update.string_domain_names.used) {
+      if (ContainsKey(changed_string_domains, name)) {
+        independent = false;
+        break;
+      }
+    }
+    if (!independent) {
+      StringDomainNames string_domain_names;
+      string_domain_names_ = &string_domain_names;
+      std::vector<Description> descriptions;
+      tensorflow::metadata::v0::AnomalyInfo::Severity severity;
+      const Status status =
+          UpdateRecursively(updater, root_features[i], paths_to_consider,
+                            &descriptions, &severity);
+      string_domain_names_ = nullptr;
+      TF_RETURN_IF_ERROR(status);
+      changed_string_domains.insert(string_domain_names.used.begin(),
+                                    string_domain_names.used.end());
+      cleared_string_domains.insert(string_domain_names.cleared.begin(),
+                                    string_domain_names.cleared.end());
+      features.IndexAdded();
+      if (string_domain_names.cleared.empty()) {
+        string_domains.IndexAdded();
+      } else {
+        string_domains.Reindex();
+      }
+      for (auto iter = cleared_string_domains.begin();
+           iter != cleared_string_domains.end();) {
+        if (string_domains.Contains(*iter)) {
+          iter = cleared_string_domains.erase(iter);
+        } else {
+          ++iter;
+        }
+      }
+      continue;
+    }
+
+    SchemaChanges changes = partial_update.schema.GetChanges();
+    for (const string& name : changes.removed_string_domain()) {
+      ClearStringDomain(name);
+      changed_string_domains.insert(name);
+      cleared_string_domains.insert(name);
+    }
+    if (!changes.removed_string_domain().empty()) {
+      string_domains.Reindex();
+    }
+    for (const StringDomain& string_domain : changes.string_domain()) {
+      changed_string_domains.insert(string_domain.name());
+      cleared_string_domains.erase(string_domain.name());
+    }
+    for (const string& name : cleared_string_domains) {
+      ClearStringDomainHelper(name, changes.mutable_feature());
+    }
+    for (const Feature& feature : changes.feature()) {
+      features.Merge(feature);
+    }
+    for (const SparseFeature& sparse_feature : changes.sparse_feature()) {
+      sparse_features.Merge(sparse_feature);
+    }
+    for (const WeightedFeature& weighted_feature :
+         changes.weighted_feature()) {
+      weighted_features.Merge(weighted_feature);
+    }
+    for (const StringDomain& string_domain : changes.string_domain()) {
+      string_domains.Merge(string_domain);
+    }
+  }
+  return Status::OK();
+}
+
 // TODO(b/114757721): expose this.
 Status Schema::GetRelatedEnums(const DatasetStatsView& dataset_stats,
                                FeatureStatisticsToProtoConfig* config) {
@@ -603,7 +1396,167 @@ Status Schema::GetRelatedEnums(const DatasetStatsView& dataset_stats,
   return Status::OK();
 }
 
-tensorflow::metadata::v0::Schema Schema::GetSchema() const { return schema_; }
+tensorflow::metadata::v0::Schema Schema::GetSchema() const {
+  if (baseline_ == nullptr) {
+    return schema_;
+  }
+  tensorflow::metadata::v0::Schema result = baseline_->schema();
+  for (const string& domain_name : cleared_string_domains_) {
+    ClearStringDomainHelper(domain_name, result.mutable_feature());
+    RemoveIf(result.mutable_string_domain(),
+             [&domain_name](const StringDomain* string_domain) {
+               return (string_domain->name() == domain_name);
+             });
+  }
+  MergeByName(schema_.feature(), result.mutable_feature());
+  MergeByName(schema_.sparse_feature(), result.mutable_sparse_feature());
+  MergeByName(schema_.weighted_feature(), result.mutable_weighted_feature());
+  MergeByName(schema_.string_domain(), result.mutable_string_domain());
+  if (schema_.has_dataset_constraints()) {
+    *result.mutable_dataset_constraints() = schema_.dataset_constraints();
+  }
+  return result;
+}
+
+SchemaChanges Schema::GetChanges() const {
+  SchemaChanges result;
+  const IndexedSchema* baseline = baseline_.get();
+  AddChangedByName(
+      schema_.feature(),
+      [baseline](const string& name) -> const Feature* {
+        return baseline ? baseline->GetFeature(Path({name})) : nullptr;
+      },
+      result.mutable_feature());
+  AddChangedByName(
+      schema_.sparse_feature(),
+      [baseline](const string& name) -> const SparseFeature* {
+        return baseline ? baseline->GetSparseFeature(Path({name})) : nullptr;
+      },
+      result.mutable_sparse_feature());
+  AddChangedByName(
+      schema_.weighted_feature(),
+      [baseline](const string& name) -> const WeightedFeature* {
+        return baseline ? baseline->GetWeightedFeature(Path({name})) : nullptr;
+      },
+      result.mutable_weighted_feature());
+  // A string domain that was cleared and then added again is both removed and
+  // added, so that the references to the old one are removed.
+  AddChangedByName(
+      schema_.string_domain(),
+      [this, baseline](const string& name) -> const StringDomain* {
+        return baseline && !ContainsKey(cleared_string_domains_, name)
+                   ? baseline->GetStringDomain(name)
+                   : nullptr;
+      },
+      result.mutable_string_domain());
+  for (const string& domain_name : cleared_string_domains_) {
+    result.add_removed_string_domain(domain_name);
+  }
+  if (schema_.has_dataset_constraints() &&
+      (baseline == nullptr ||
+       baseline->schema().dataset_constraints().SerializeAsString() !=
+           schema_.dataset_constraints().SerializeAsString())) {
+    *result.mutable_dataset_constraints() = schema_.dataset_constraints();
+  }
+  return result;
+}
+
+std::vector<tensorflow::metadata::v0::DiffRegion> Schema::GetDiffRegions(
+    const tensorflow::metadata::v0::Schema& original,
+    int context_lines) const {
+  std::unique_ptr<const SchemaText> rendered_original;
+  if (baseline_ == nullptr) {
+    rendered_original = absl::make_unique<const SchemaText>(original);
+  }
+  const SchemaText& original_text =
+      baseline_ != nullptr ? baseline_->text() : *rendered_original;
+  std::vector<LineEdit> edits;
+  if (baseline_ == nullptr || !cleared_string_domains_.empty()) {
+    // Clearing a string domain also changes the features of the baseline
+    // that use it, so then the whole texts are compared.
+    const SchemaText new_text(GetSchema());
+    edits.push_back({0, static_cast<int>(original_text.lines.size()),
+                     std::vector<string>(new_text.lines.begin(),
+                                         new_text.lines.end())});
+    return ComputeDiffWithEdits(original_text.lines, edits, context_lines);
+  }
+
+  // The fields of SchemaChanges have the names of the fields of Schema that
+  // they change. As in GetSchema(), a changed entry replaces the entry of the
+  // baseline with the same name, and the other entries are added after the
+  // entries of the same field. Since the text format has the fields in the
+  // order of their numbers, an entry of a field that the baseline does not
+  // have is added before the entries of the next field.
+  const SchemaChanges changes = GetChanges();
+  const tensorflow::protobuf::Descriptor& descriptor =
+      *tensorflow::metadata::v0::Schema::descriptor();
+  std::map<int, const tensorflow::protobuf::FieldDescriptor*> changed_fields;
+  for (int i = 0; i < changes.GetDescriptor()->field_count(); ++i) {
+    const tensorflow::protobuf::FieldDescriptor* changes_field =
+        changes.GetDescriptor()->field(i);
+    const tensorflow::protobuf::FieldDescriptor* field =
+        descriptor.FindFieldByName(changes_field->name());
+    if (field != nullptr) {
+      changed_fields[field->number()] = changes_field;
+    }
+  }
+  const tensorflow::protobuf::Reflection& reflection =
+      *changes.GetReflection();
+  for (const auto& pair : changed_fields) {
+    const int number = pair.first;
+    const tensorflow::protobuf::FieldDescriptor& changes_field = *pair.second;
+    std::vector<const tensorflow::protobuf::Message*> changed_entries;
+    if (changes_field.is_repeated()) {
+      for (int i = 0; i < reflection.FieldSize(changes, &changes_field); ++i) {
+        changed_entries.push_back(
+            &reflection.GetRepeatedMessage(changes, &changes_field, i));
+      }
+    } else if (reflection.HasField(changes, &changes_field)) {
+      changed_entries.push_back(
+          &reflection.GetMessage(changes, &changes_field));
+    }
+    // The entries added to this field, after all of its entries.
+    LineEdit added;
+    const auto field_iter = original_text.fields.find(number);
+    if (field_iter != original_text.fields.end()) {
+      added.left_start = field_iter->second.second;
+    } else {
+      const auto next_field_iter = original_text.fields.upper_bound(number);
+      added.left_start = next_field_iter != original_text.fields.end()
+                             ? next_field_iter->second.first
+                             : original_text.lines.size();
+    }
+    added.left_end = added.left_start;
+    const absl::flat_hash_map<string, SchemaText::LineRange>* entries =
+        FindOrNull(original_text.entries, number);
+    for (const tensorflow::protobuf::Message* entry : changed_entries) {
+      std::vector<string> lines =
+          GetEntryLines(changes_field.name(), *entry);
+      const SchemaText::LineRange* range =
+          entries == nullptr
+              ? nullptr
+              : FindOrNull(*entries, GetEntryName(changes_field, *entry));
+      if (range != nullptr) {
+        edits.push_back({range->first, range->second, std::move(lines)});
+      } else {
+        added.right_lines.insert(added.right_lines.end(),
+                                 std::make_move_iterator(lines.begin()),
+                                 std::make_move_iterator(lines.end()));
+      }
+    }
+    if (!added.right_lines.empty()) {
+      edits.push_back(std::move(added));
+    }
+  }
+  // The edits of each field are sorted, and an addition comes before a
+  // replacement that starts on the same line (of the next field).
+  std::stable_sort(edits.begin(), edits.end(),
+                   [](const LineEdit& a, const LineEdit& b) {
+                     return std::make_pair(a.left_start, a.left_end) <
+                            std::make_pair(b.left_start, b.left_end);
+                   });
+  return ComputeDiffWithEdits(original_text.lines, edits, context_lines);
+}
 
 bool Schema::FeatureExists(const Path& path) {
   return GetExistingFeature(path) != nullptr ||
@@ -613,8 +1566,7 @@ bool Schema::FeatureExists(const Path& path) {
 
 Feature* Schema::GetExistingFeature(const Path& path) {
   if (path.size() == 1) {
-    return GetExistingFeatureHelper(path.last_step(),
-                                    schema_.mutable_feature());
+    return GetExistingTopLevelFeature(path.last_step());
   } else {
     Path parent = path.GetParent();
     Feature* parent_feature = GetExistingFeature(parent);
@@ -634,8 +1586,17 @@ Feature* Schema::GetExistingFeature(const Path& path) {
 SparseFeature* Schema::GetExistingSparseFeature(const Path& path) {
   CHECK(!path.empty());
   if (path.size() == 1) {
-    return GetExistingSparseFeatureHelper(path.last_step(),
-                                          schema_.mutable_sparse_feature());
+    SparseFeature* sparse_feature = GetExistingSparseFeatureHelper(
+        path.last_step(), schema_.mutable_sparse_feature());
+    if (sparse_feature == nullptr && baseline_ != nullptr) {
+      const SparseFeature* baseline_sparse_feature =
+          baseline_->GetSparseFeature(path);
+      if (baseline_sparse_feature != nullptr) {
+        sparse_feature = schema_.add_sparse_feature();
+        *sparse_feature = *baseline_sparse_feature;
+      }
+    }
+    return sparse_feature;
   } else {
     Feature* parent_feature = GetExistingFeature(path.GetParent());
     if (parent_feature == nullptr) {
@@ -663,6 +1624,15 @@ WeightedFeature* Schema::GetExistingWeightedFeature(const Path& path) {
       return &weighted_feature;
     }
   }
+  if (baseline_ != nullptr) {
+    const WeightedFeature* baseline_weighted_feature =
+        baseline_->GetWeightedFeature(path);
+    if (baseline_weighted_feature != nullptr) {
+      WeightedFeature* result = schema_.add_weighted_feature();
+      *result = *baseline_weighted_feature;
+      return result;
+    }
+  }
   return nullptr;
 }
 
@@ -683,6 +1653,11 @@ Feature* Schema::GetNewFeature(const Path& path) {
 
 ::tensorflow::metadata::v0::DatasetConstraints*
 Schema::GetExistingDatasetConstraints() {
+  if (!schema_.has_dataset_constraints() && baseline_ != nullptr &&
+      baseline_->schema().has_dataset_constraints()) {
+    *schema_.mutable_dataset_constraints() =
+        baseline_->schema().dataset_constraints();
+  }
   if (schema_.has_dataset_constraints()) {
     return schema_.mutable_dataset_constraints();
   }
@@ -691,21 +1666,8 @@ Schema::GetExistingDatasetConstraints() {
 
 bool Schema::IsFeatureInEnvironment(
     const Feature& feature, const absl::optional<string>& environment) const {
-  if (environment) {
-    if (ContainsValue(feature.in_environment(), *environment)) {
-      return true;
-    }
-    if (ContainsValue(feature.not_in_environment(), *environment)) {
-      return false;
-    }
-    if (ContainsValue(schema_.default_environment(), *environment)) {
-      return true;
-    }
-    return false;
-  }
-  // If environment is not set, then the feature is considered in the
-  // environment by default.
-  return true;
+  return ::tensorflow::data_validation::IsFeatureInEnvironment(
+      feature, root_schema().default_environment(), environment);
 }
 
 bool Schema::IsExistenceRequired(
@@ -784,22 +1746,20 @@ std::vector<Description> Schema::UpdateFeatureSelf(Feature* feature) {
   for (int i = 0; i < feature->value_counts().value_count_size(); ++i) {
     if (feature->value_counts().value_count(i).min() < 0) {
       feature->mutable_value_counts()->mutable_value_count(i)->clear_min();
-      descriptions.push_back(
-          {tensorflow::metadata::v0::AnomalyInfo::INVALID_SCHEMA_SPECIFICATION,
-           "ValueCounts.min should not be negative",
-           absl::StrCat("ValueCounts.min at level ", i,
-                        " should not be negative.")});
+      descriptions.push_back(Description::FromTemplate(
+          tensorflow::metadata::v0::AnomalyInfo::INVALID_SCHEMA_SPECIFICATION,
+          "ValueCounts.min should not be negative",
+          "ValueCounts.min at level $0 should not be negative.", {i}));
     }
     if (feature->value_counts().value_count(i).has_max() &&
         feature->value_counts().value_count(i).max() <
             feature->value_counts().value_count(i).min()) {
       feature->mutable_value_counts()->mutable_value_count(i)->set_max(
           feature->value_counts().value_count(i).min());
-      descriptions.push_back(
-          {tensorflow::metadata::v0::AnomalyInfo::INVALID_SCHEMA_SPECIFICATION,
-           "ValueCounts.max should not be less than min",
-           absl::StrCat("ValueCounts.max at level ", i,
-                        " should not be less than min.")});
+      descriptions.push_back(Description::FromTemplate(
+          tensorflow::metadata::v0::AnomalyInfo::INVALID_SCHEMA_SPECIFICATION,
+          "ValueCounts.max should not be less than min",
+          "ValueCounts.max at level $0 should not be less than min.", {i}));
     }
   }
 
@@ -814,13 +1774,12 @@ std::vector<Description> Schema::UpdateFeatureSelf(Feature* feature) {
   }
   if (!ContainsKey(AllowedFeatureTypes(feature->domain_info_case()),
                    feature->type())) {
-    descriptions.push_back(
-        {tensorflow::metadata::v0::AnomalyInfo::DOMAIN_INVALID_FOR_TYPE,
-         "The domain does not match the type",
-         absl::StrCat(
-             "The domain \"", GetDomainInfoName(*feature),
-             "\" does not match the type: ",
-             tensorflow::metadata::v0::FeatureType_Name(feature->type()))});
+    descriptions.push_back(Description::FromTemplate(
+        tensorflow::metadata::v0::AnomalyInfo::DOMAIN_INVALID_FOR_TYPE,
+        "The domain does not match the type",
+        "The domain \"$0\" does not match the type: $1",
+        {GetDomainInfoName(*feature),
+         tensorflow::metadata::v0::FeatureType_Name(feature->type())}));
     // Note that this clears the oneof field domain_info.
     ::tensorflow::data_validation::ClearDomain(feature);
   }
@@ -922,17 +1881,26 @@ FeatureComparisonResult Schema::UpdateSkewComparator(
 }
 
 void Schema::ClearStringDomain(const string& domain_name) {
+  UseStringDomainName(domain_name);
+  if (string_domain_names_ != nullptr) {
+    string_domain_names_->cleared.insert(domain_name);
+  }
   ClearStringDomainHelper(domain_name, schema_.mutable_feature());
   RemoveIf(schema_.mutable_string_domain(),
            [domain_name](const StringDomain* string_domain) {
              return (string_domain->name() == domain_name);
            });
+  if (baseline_ != nullptr) {
+    cleared_string_domains_.insert(domain_name);
+  }
 }
 
 void Schema::UpdateFeatureInternal(
     const Updater& updater, const FeatureStatsView& view, Feature* feature,
     std::vector<Description>* descriptions,
-    absl::optional<tensorflow::metadata::v0::DriftSkewInfo>* drift_skew_info) {
+    absl::optional<tensorflow::metadata::v0::DriftSkewInfo>* drift_skew_info,
+    FeatureCostTracker* tracker, const ValidationDeadline* deadline,
+    bool* comparators_skipped) {
   *descriptions = UpdateFeatureSelf(feature);
 
   // feature can be deprecated inside of UpdateFeatureSelf.
@@ -978,13 +1946,12 @@ void Schema::UpdateFeatureInternal(
     if (!IsFeatureInEnvironment(*feature, view.environment())) {
       feature->add_in_environment(view_environment);
     }
-    descriptions->push_back(
-        {tensorflow::metadata::v0::AnomalyInfo::SCHEMA_NEW_COLUMN,
-         "Column missing in environment",
-         absl::StrCat("New column ", view.GetPath().Serialize(),
-                      " found in data but not in the "
-                      "environment ",
-                      view_environment, " in the schema.")});
+    descriptions->push_back(Description::FromTemplate(
+        tensorflow::metadata::v0::AnomalyInfo::SCHEMA_NEW_COLUMN,
+        "Column missing in environment",
+        "New column $0 found in data but not in the environment $1 in the "
+        "schema.",
+        {view.GetPath().Serialize(), view_environment}));
   }
 
   auto add_to_descriptions =
@@ -1058,12 +2025,26 @@ void Schema::UpdateFeatureInternal(
   }
   switch (feature->domain_info_case()) {
     case Feature::kDomain: {
+      const double max_off_domain =
+          ::tensorflow::data_validation::GetMaxOffDomain(
+              feature->distribution_constraints());
+      const string& domain_name = feature->domain();
+      // A string domain of the baseline is shared by all the features that
+      // refer to it, and is only copied into the overlay if it changes.
+      const StringDomainValueSet* baseline_values =
+          GetBaselineStringDomainValues(domain_name);
       UpdateSummary update_summary =
-          ::tensorflow::data_validation::UpdateStringDomain(
-              updater, view,
-              ::tensorflow::data_validation::GetMaxOffDomain(
-                  feature->distribution_constraints()),
-              CHECK_NOTNULL(GetExistingStringDomain(feature->domain())));
+          baseline_values != nullptr
+              ? ::tensorflow::data_validation::UpdateSharedStringDomain(
+                    updater, view, max_off_domain,
+                    *baseline_->GetStringDomain(domain_name), *baseline_values,
+                    [this, &domain_name]() {
+                      return CHECK_NOTNULL(
+                          GetExistingStringDomain(domain_name));
+                    })
+              : ::tensorflow::data_validation::UpdateStringDomain(
+                    updater, view, max_off_domain,
+                    CHECK_NOTNULL(GetExistingStringDomain(domain_name)));
 
       add_to_descriptions(update_summary.descriptions);
       if (update_summary.clear_field) {
@@ -1113,12 +2094,12 @@ void Schema::UpdateFeatureInternal(
     case Feature::DOMAIN_INFO_NOT_SET:
       // If the domain_info is not set, it is safe to try best-effort
       // semantic type update.
-      if (BestEffortUpdateCustomDomain(view.custom_stats(), feature)) {
-        descriptions->push_back(
-            {tensorflow::metadata::v0::AnomalyInfo::SEMANTIC_DOMAIN_UPDATE,
-             "Updated semantic domain",
-             absl::StrCat("Updated semantic domain for feature: ",
-                          feature->name())});
+      if (BestEffortUpdateCustomDomain(view, feature)) {
+        descriptions->push_back(Description::FromTemplate(
+            tensorflow::metadata::v0::AnomalyInfo::SEMANTIC_DOMAIN_UPDATE,
+            "Updated semantic domain",
+            "Updated semantic domain for feature: $0",
+            {feature->name()}));
       }
       break;
     default:
@@ -1133,14 +2114,34 @@ void Schema::UpdateFeatureInternal(
     add_to_descriptions(UpdateUniqueConstraints(view, feature));
   }
 
+  if (updater.config().skip_comparators()) {
+    return;
+  }
+
   const std::vector<FeatureComparatorType> all_comparator_types = {
       FeatureComparatorType::DRIFT, FeatureComparatorType::SKEW};
-  // Handle comparators here.
+  // Handle comparators here. The distribution of the feature is shared by
+  // all of them.
+  const FeatureDistribution distribution(view);
   for (const auto& comparator_type : all_comparator_types) {
     if (FeatureHasComparator(*feature, comparator_type)) {
-      auto feature_comparison_result = UpdateFeatureComparatorDirect(
-          view, comparator_type,
-          GetFeatureComparator(feature, comparator_type));
+      if (deadline != nullptr && deadline->Expired()) {
+        *comparators_skipped = true;
+        return;
+      }
+      FeatureComparisonResult feature_comparison_result;
+      {
+        const ScopedFeatureCost cost(
+            comparator_type == FeatureComparatorType::DRIFT
+                ? "drift_comparator"
+                : "skew_comparator",
+            view, tracker);
+        feature_comparison_result = UpdateFeatureComparatorDirect(
+            distribution, comparator_type,
+            updater.config().approximate_infinity_norm(),
+            updater.config().numeric_infinity_norm(),
+            GetFeatureComparator(feature, comparator_type));
+      }
       add_to_descriptions(feature_comparison_result.descriptions);
       if (!feature_comparison_result.measurements.empty()) {
         if (!drift_skew_info->has_value()) {
@@ -1166,28 +2167,30 @@ void Schema::UpdateFeatureInternal(
 std::vector<Description> Schema::UpdateSparseFeature(
     const FeatureStatsView& view, SparseFeature* sparse_feature) {
   std::vector<Description> descriptions;
-  for (const tensorflow::metadata::v0::CustomStatistic& custom_stat :
-       view.custom_stats()) {
+  for (const tensorflow::metadata::v0::CustomStatistic* custom_stat_ptr :
+       view.GetCustomStatsByNames({kMissingSparseValue, kMissingSparseIndex,
+                                   kMaxLengthDiff, kMinLengthDiff})) {
+    const tensorflow::metadata::v0::CustomStatistic& custom_stat =
+        *custom_stat_ptr;
     const string& stat_name = custom_stat.name();
     // Stat names should be in-sync with the sparse_feature_stats_generator.
     if (stat_name == kMissingSparseValue && custom_stat.num() != 0) {
-      descriptions.push_back(
-          {tensorflow::metadata::v0::AnomalyInfo::SPARSE_FEATURE_MISSING_VALUE,
-           "Missing value feature",
-           absl::StrCat("Found ", custom_stat.num(),
-                        " examples missing value feature")});
+      descriptions.push_back(Description::FromTemplate(
+          tensorflow::metadata::v0::AnomalyInfo::SPARSE_FEATURE_MISSING_VALUE,
+          "Missing value feature", "Found $0 examples missing value feature",
+          {custom_stat.num()}));
     } else if (stat_name == kMissingSparseIndex) {
       for (const auto& bucket : custom_stat.rank_histogram().buckets()) {
         // This represents the index_feature name of this sparse feature.
         const string& index_feature_name = bucket.label();
         const int freq = bucket.sample_count();
         if (freq != 0) {
-          descriptions.push_back(
-              {tensorflow::metadata::v0::AnomalyInfo::
-                   SPARSE_FEATURE_MISSING_INDEX,
-               "Missing index feature",
-               absl::StrCat("Found ", freq, " examples missing index feature: ",
-                            index_feature_name)});
+          descriptions.push_back(Description::FromTemplate(
+              tensorflow::metadata::v0::AnomalyInfo::
+                  SPARSE_FEATURE_MISSING_INDEX,
+              "Missing index feature",
+              "Found $0 examples missing index feature: $1",
+              {freq, index_feature_name}));
         }
       }
     } else if (stat_name == kMaxLengthDiff || stat_name == kMinLengthDiff) {
@@ -1196,18 +2199,18 @@ std::vector<Description> Schema::UpdateSparseFeature(
           // This represents the index_feature name of this sparse feature.
           const string& index_feature_name = bucket.label();
           const int difference = bucket.sample_count();
-          descriptions.push_back(
-              {tensorflow::metadata::v0::AnomalyInfo::
-                   SPARSE_FEATURE_LENGTH_MISMATCH,
-               "Length mismatch between value and index feature",
-               absl::StrCat(
-                   "Mismatch between index feature: ", index_feature_name,
-                   " and value column, with ", stat_name, " = ", difference)});
+          descriptions.push_back(Description::FromTemplate(
+              tensorflow::metadata::v0::AnomalyInfo::
+                  SPARSE_FEATURE_LENGTH_MISMATCH,
+              "Length mismatch between value and index feature",
+              "Mismatch between index feature: $0 and value column, with $1 = "
+              "$2",
+              {index_feature_name, stat_name, difference}));
         }
       }
     }
-    // Intentionally not generating anomalies for unknown custom stats for
-    // forward compatibility.
+    // Unknown custom stats are not looked up, and intentionally do not
+    // generate anomalies, for forward compatibility.
   }
   if (!descriptions.empty()) {
     ::tensorflow::data_validation::DeprecateSparseFeature(sparse_feature);
@@ -1220,24 +2223,26 @@ std::vector<Description> Schema::UpdateWeightedFeature(
   std::vector<Description> descriptions;
   int min_weight_length_diff = 0;
   int max_weight_length_diff = 0;
-  for (const tensorflow::metadata::v0::CustomStatistic& custom_stat :
-       view.custom_stats()) {
+  for (const tensorflow::metadata::v0::CustomStatistic* custom_stat_ptr :
+       view.GetCustomStatsByNames({kMissingWeightedValue, kMissingWeight,
+                                   kMinWeightLengthDiff,
+                                   kMaxWeightLengthDiff})) {
+    const tensorflow::metadata::v0::CustomStatistic& custom_stat =
+        *custom_stat_ptr;
     const string& stat_name = custom_stat.name();
     // Stat names should be in-sync with the weighted_feature_stats_generator.
     if (stat_name == kMissingWeightedValue && custom_stat.num() != 0) {
-      descriptions.push_back(
-          {tensorflow::metadata::v0::AnomalyInfo::
-               WEIGHTED_FEATURE_MISSING_VALUE,
-           "Missing value feature",
-           absl::StrCat("Found ", custom_stat.num(),
-                        " examples missing value feature.")});
+      descriptions.push_back(Description::FromTemplate(
+          tensorflow::metadata::v0::AnomalyInfo::
+              WEIGHTED_FEATURE_MISSING_VALUE,
+          "Missing value feature", "Found $0 examples missing value feature.",
+          {custom_stat.num()}));
     } else if (stat_name == kMissingWeight && custom_stat.num() != 0) {
-      descriptions.push_back(
-          {tensorflow::metadata::v0::AnomalyInfo::
-               WEIGHTED_FEATURE_MISSING_WEIGHT,
-           "Missing weight feature",
-           absl::StrCat("Found ", custom_stat.num(),
-                        " examples missing weight feature.")});
+      descriptions.push_back(Description::FromTemplate(
+          tensorflow::metadata::v0::AnomalyInfo::
+              WEIGHTED_FEATURE_MISSING_WEIGHT,
+          "Missing weight feature", "Found $0 examples missing weight feature.",
+          {custom_stat.num()}));
     } else if (stat_name == kMinWeightLengthDiff && custom_stat.num() != 0) {
       min_weight_length_diff = custom_stat.num();
     } else if (stat_name == kMaxWeightLengthDiff && custom_stat.num() != 0) {
@@ -1245,14 +2250,13 @@ std::vector<Description> Schema::UpdateWeightedFeature(
     }
   }
   if (min_weight_length_diff != 0 || max_weight_length_diff != 0) {
-    descriptions.push_back(
-        {tensorflow::metadata::v0::AnomalyInfo::
-             WEIGHTED_FEATURE_LENGTH_MISMATCH,
-         "Length mismatch between value and weight feature",
-         absl::StrCat("Mismatch between weight and value feature with ",
-                      kMinWeightLengthDiff, " = ", min_weight_length_diff,
-                      " and ", kMaxWeightLengthDiff, " = ",
-                      max_weight_length_diff, ".")});
+    descriptions.push_back(Description::FromTemplate(
+        tensorflow::metadata::v0::AnomalyInfo::
+            WEIGHTED_FEATURE_LENGTH_MISMATCH,
+        "Length mismatch between value and weight feature",
+        "Mismatch between weight and value feature with $0 = $1 and $2 = $3.",
+        {kMinWeightLengthDiff, min_weight_length_diff, kMaxWeightLengthDiff,
+         max_weight_length_diff}));
   }
   if (!descriptions.empty()) {
     ::tensorflow::data_validation::DeprecateWeightedFeature(weighted_feature);
@@ -1294,10 +2298,11 @@ std::vector<Description> Schema::UpdateDatasetConstraints(
 bool Schema::generate_legacy_feature_spec() const {
   // This field is not available in the OSS TFMD schema, so we use proto
   // reflection to get its value to avoid compilation errors.
+  const tensorflow::metadata::v0::Schema& schema = root_schema();
   const auto* field_desc =
-      schema_.GetDescriptor()->FindFieldByName("generate_legacy_feature_spec");
+      schema.GetDescriptor()->FindFieldByName("generate_legacy_feature_spec");
   if (!field_desc) return false;
-  return schema_.GetReflection()->GetBool(schema_, field_desc);
+  return schema.GetReflection()->GetBool(schema, field_desc);
 }
 
 }  // namespace data_validation
@@ -20,15 +20,25 @@ limitations under the License.
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/base/call_once.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "tensorflow_data_validation/anomalies/feature_check_program.h"
 #include "tensorflow_data_validation/anomalies/feature_util.h"
 #include "tensorflow_data_validation/anomalies/internal_types.h"
 #include "tensorflow_data_validation/anomalies/path.h"
 #include "tensorflow_data_validation/anomalies/proto/feature_statistics_to_proto.pb.h"
 #include "tensorflow_data_validation/anomalies/proto/validation_config.pb.h"
+#include "tensorflow_data_validation/anomalies/proto/validation_metadata.pb.h"
 #include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow_data_validation/anomalies/string_pool.h"
+#include "tensorflow_data_validation/anomalies/validation_deadline.h"
+#include "tensorflow_data_validation/anomalies/validation_profile.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/types.h"
@@ -39,6 +49,249 @@ limitations under the License.
 namespace tensorflow {
 namespace data_validation {
 
+// The text format of a schema proto, split into lines, with the lines of each
+// of its top-level entries (e.g., of each feature), so that the text of a
+// changed schema can be diffed one entry at a time (see
+// Schema::GetDiffRegions()).
+struct SchemaText {
+  // The lines [first, second), counted from 0.
+  using LineRange = std::pair<int, int>;
+
+  explicit SchemaText(const tensorflow::metadata::v0::Schema& schema);
+
+  // Not copyable, as lines point into text.
+  SchemaText(const SchemaText&) = delete;
+  SchemaText& operator=(const SchemaText&) = delete;
+
+  string text;
+  // The lines of text, without the newlines.
+  std::vector<absl::string_view> lines;
+  // For each top-level field that is set, by field number: the lines of all
+  // its entries.
+  std::map<int, LineRange> fields;
+  // For each top-level message field that is set, by field number: the lines
+  // of its first entry with each name. Singular fields have an empty name.
+  std::map<int, absl::flat_hash_map<string, LineRange>> entries;
+};
+
+// The values of a string domain, interned in a pool shared by all the string
+// domains of a schema.
+using StringDomainValueSet = StringIdSet;
+
+// An immutable schema proto, indexed so that its features, sparse features,
+// weighted features and string domains can be looked up in constant time.
+// It is built once per validation and shared by all the Schema overlays
+// created from it (see Schema::InitOverlay()).
+class IndexedSchema {
+ public:
+  explicit IndexedSchema(const tensorflow::metadata::v0::Schema& schema);
+
+  // Same as above, but with a fingerprint() already known (e.g., stored with
+  // the schema, see ReadSchemaSnapshot()), so that it is not computed again.
+  IndexedSchema(const tensorflow::metadata::v0::Schema& schema,
+                uint64 fingerprint);
+
+  // Not copyable, as the index points into schema_.
+  IndexedSchema(const IndexedSchema&) = delete;
+  IndexedSchema& operator=(const IndexedSchema&) = delete;
+
+  const tensorflow::metadata::v0::Schema& schema() const { return schema_; }
+
+  // Gets a feature, or returns null if it doesn't exist.
+  const tensorflow::metadata::v0::Feature* GetFeature(const Path& path) const;
+
+  // Gets a sparse feature, or returns null if it doesn't exist.
+  const tensorflow::metadata::v0::SparseFeature* GetSparseFeature(
+      const Path& path) const;
+
+  // Gets a weighted feature, or returns null if it doesn't exist.
+  const tensorflow::metadata::v0::WeightedFeature* GetWeightedFeature(
+      const Path& path) const;
+
+  // Gets a StringDomain, or returns null if it doesn't exist.
+  const tensorflow::metadata::v0::StringDomain* GetStringDomain(
+      const string& name) const;
+
+  // Gets the values of a StringDomain as a set, or returns null if it doesn't
+  // exist. The set is shared by all the features that refer to the domain by
+  // name. Thread-safe.
+  const StringDomainValueSet* GetStringDomainValues(const string& name) const;
+
+  // Gets the values of the string domain of a feature, whether it is inline
+  // or shared by name, or returns null if the feature doesn't exist or has
+  // no string domain. Thread-safe.
+  const StringDomainValueSet* GetFeatureStringDomainValues(
+      const Path& path) const;
+
+  // Returns true iff there is a feature corresponding to the path.
+  // Same as Schema::FeatureExists().
+  bool FeatureExists(const Path& path) const;
+
+  // Returns true if the feature corresponding to the path is deprecated.
+  // Same as Schema::FeatureIsDeprecated().
+  bool FeatureIsDeprecated(const Path& path) const;
+
+  // Returns true if there is no feature corresponding to the path, or if it is
+  // in the environment (see Schema::IsFeatureInEnvironment()).
+  bool FeatureIsInEnvironment(const Path& path,
+                              const absl::optional<string>& environment) const;
+
+  // Returns an id for an environment, to pass to FeatureIdIsInEnvironment()
+  // and FeatureIdIsRequired(). Environments that are not in the schema share
+  // an id, as no feature is in them.
+  int GetEnvironmentId(const absl::optional<string>& environment) const;
+
+  // Returns true if the statistics of a feature certainly have no anomaly and
+  // no drift or skew measurement, so that Schema::UpdateFeature() does not
+  // need to be called for them: the feature is in their environment, and
+  // they pass its FeatureCheckProgram. Returns false if the feature has no
+  // program (see FeatureCheckProgram::Compile()).
+  bool FeatureChecksPass(const FeatureStatsView& view,
+                         bool skip_comparators) const;
+
+  // Returns true if the feature with the id (see RequiredFeature) is in the
+  // environment. Same as Schema::IsFeatureInEnvironment().
+  bool FeatureIdIsInEnvironment(int feature_id, int environment_id) const {
+    return environments_[environment_id].in_environment[feature_id];
+  }
+
+  // Returns true if the existence of the feature with the id is required in
+  // the environment. Same as Schema::IsExistenceRequired().
+  bool FeatureIdIsRequired(int feature_id, int environment_id) const {
+    return environments_[environment_id].required[feature_id];
+  }
+
+  // A feature whose existence may be required: it has a minimum count or
+  // fraction, and neither it nor any of its ancestors is deprecated. Every
+  // feature of the schema, including the ones with the same path as an
+  // earlier feature, has an id.
+  struct RequiredFeature {
+    Path path;
+    const tensorflow::metadata::v0::Feature* feature;
+    int id;
+  };
+
+  // Returns the features whose existence may be required, parents before
+  // children, as Schema::GetMissingPaths() considers them. Whether they are
+  // required depends on the environment (see FeatureIdIsRequired()).
+  const std::vector<RequiredFeature>& required_features() const {
+    return required_features_;
+  }
+
+  // Returns true if validating against this schema can use the previous span
+  // statistics, i.e., if a feature has a drift comparator or the dataset
+  // constraints have a num examples drift comparator.
+  bool UsesPreviousSpan() const;
+
+  // Returns true if validating against this schema can use the serving
+  // statistics, i.e., if a feature has a skew comparator.
+  bool UsesServing() const { return !skew_comparator_paths_.empty(); }
+
+  // Returns true if some indexed feature has a drift or a skew comparator, so
+  // that checking the features without their comparators can miss anomalies.
+  bool HasFeatureComparators() const {
+    return has_drift_comparator_ || !skew_comparator_paths_.empty();
+  }
+
+  // Returns the paths of the indexed features with a skew comparator, in the
+  // order of the schema.
+  const std::vector<Path>& skew_comparator_paths() const {
+    return skew_comparator_paths_;
+  }
+
+  // Returns true if validating against this schema can use the previous
+  // version statistics, i.e., if the dataset constraints have a num examples
+  // version comparator.
+  bool UsesPreviousVersion() const;
+
+  // Returns a fingerprint of the schema, which is the same for schemas that
+  // are equal. Computed on the first call.
+  uint64 fingerprint() const;
+
+  // Returns the text of the schema. Computed on the first call.
+  const SchemaText& text() const;
+
+ private:
+  // Gives ids to features and all of their descendants, and adds the ones
+  // that may be required to required_features_. If index, also adds them and
+  // sparse_features to the index. Like the lookups in Schema, only the first
+  // entry with a given name is indexed (but they all have ids). If
+  // deprecated, an ancestor of the features is deprecated.
+  void IndexFeatures(
+      const Path& parent,
+      const ::tensorflow::protobuf::RepeatedPtrField<
+          tensorflow::metadata::v0::Feature>& features,
+      const ::tensorflow::protobuf::RepeatedPtrField<
+          tensorflow::metadata::v0::SparseFeature>& sparse_features,
+      bool index, bool deprecated);
+
+  // Computes environments_ from the features with ids.
+  void IndexEnvironments();
+
+  // Computes check_programs_ from the indexed features.
+  void CompileCheckPrograms();
+
+  // Interns the values of all the string domains of the schema (shared by
+  // name, or inline in an indexed feature) into string_pool_, so that a value
+  // that is in many domains is only stored once. Called once, the first time
+  // the values of a domain are needed.
+  void InternStringDomains() const;
+
+  const tensorflow::metadata::v0::Schema schema_;
+  // All the features, by id.
+  std::vector<const tensorflow::metadata::v0::Feature*> features_by_id_;
+  // The ids of the indexed features.
+  absl::flat_hash_map<Path, int> features_;
+  absl::flat_hash_map<Path, const tensorflow::metadata::v0::SparseFeature*>
+      sparse_features_;
+  // Weighted features are always top-level features, so they are indexed by
+  // name.
+  absl::flat_hash_map<string, const tensorflow::metadata::v0::WeightedFeature*>
+      weighted_features_;
+  // A string domain, and the set of its values, built on demand (see
+  // InternStringDomains()).
+  struct IndexedStringDomain {
+    explicit IndexedStringDomain(
+        const tensorflow::metadata::v0::StringDomain* string_domain)
+        : string_domain(string_domain) {}
+
+    const tensorflow::metadata::v0::StringDomain* const string_domain;
+    mutable StringDomainValueSet values;
+  };
+  absl::flat_hash_map<string, std::unique_ptr<const IndexedStringDomain>>
+      string_domains_;
+  // The values of all the string domains, pointing into schema_.
+  mutable absl::once_flag string_pool_once_;
+  mutable StringPool string_pool_;
+  // The values of the inline string domains of the indexed features, by
+  // feature id. Null for the other features.
+  mutable std::vector<std::unique_ptr<const StringDomainValueSet>>
+      inline_string_domains_;
+  std::vector<RequiredFeature> required_features_;
+  // The check programs of the indexed features, by feature id. Null for the
+  // features that are not indexed or not compiled, and for the ones with the
+  // same path as a sparse or weighted feature.
+  std::vector<std::unique_ptr<const FeatureCheckProgram>> check_programs_;
+  // Which features are in an environment, and which are required in it, by
+  // feature id.
+  struct EnvironmentFeatures {
+    std::vector<bool> in_environment;
+    std::vector<bool> required;
+  };
+  // By environment id: no environment, then the environments not in the
+  // schema, then the ones in environment_ids_.
+  std::vector<EnvironmentFeatures> environments_;
+  absl::flat_hash_map<string, int> environment_ids_;
+  // Whether any indexed feature has a drift comparator.
+  bool has_drift_comparator_ = false;
+  // See skew_comparator_paths().
+  std::vector<Path> skew_comparator_paths_;
+  mutable absl::once_flag fingerprint_once_;
+  mutable uint64 fingerprint_ = 0;
+  mutable absl::once_flag text_once_;
+  mutable std::unique_ptr<const SchemaText> text_;
+};
+
 // This class is used to generate schemas, and to check the validity of data,
 // and to update schemas.
 // See https://github.com/tensorflow/metadata/blob/master/tensorflow_metadata/proto/v0/schema.proto
@@ -81,13 +334,19 @@ class Schema {
     // should be deleted.
     bool string_domain_too_big(int size) const;
 
+    const FeatureStatisticsToProtoConfig& config() const { return config_; }
+
    private:
     // The config being used to create the schema.
     const FeatureStatisticsToProtoConfig config_;
+    // The severity of each AnomalyInfo::Type, indexed by type, compiled from
+    // the new_features_are_warnings and severity_overrides of config_.
+    std::vector<tensorflow::metadata::v0::AnomalyInfo::Severity>
+        severity_by_type_;
     // The columns to ignore, extracted from config_.
-    const std::set<string> columns_to_ignore_;
+    const absl::flat_hash_set<string> columns_to_ignore_;
     // A map from a key to an enum, extracted from config_.
-    std::map<Path, string> grouped_enums_;
+    absl::flat_hash_map<Path, string> grouped_enums_;
   };
 
   // This creates an empty schema. In order to populate it, either call
@@ -101,6 +360,16 @@ class Schema {
   // InvalidArgumentException.
   tensorflow::Status Init(const tensorflow::metadata::v0::Schema& input);
 
+  // Initializes a schema as a copy-on-write overlay on top of baseline.
+  // Top-level features, sparse features, weighted features and string domains
+  // of the baseline are only copied into this schema when they are first
+  // looked up, so that many schemas can share one baseline without copying
+  // all of it. GetSchema() returns the baseline with the changes made to this
+  // schema applied.
+  // Schema must be empty (i.e. it was just created), or the method will return
+  // an InvalidArgumentException.
+  tensorflow::Status InitOverlay(std::shared_ptr<const IndexedSchema> baseline);
+
   // Updates Schema given new data. If you have a new, previously unseen column,
   // then config is used to create it.
   tensorflow::Status Update(const DatasetStatsView& dataset_stats,
@@ -134,6 +403,21 @@ class Schema {
   // Gets the schema that represents the proto.
   tensorflow::metadata::v0::Schema GetSchema() const;
 
+  // Gets the changes that GetSchema() makes to the baseline of an overlay (see
+  // InitOverlay()), without copying the baseline. Entries of the baseline
+  // that were looked up but not changed are left out. If this is not an
+  // overlay, the baseline is an empty schema.
+  SchemaChanges GetChanges() const;
+
+  // Gets the diff regions between the text formats of original and of
+  // GetSchema() (see ComputeDiffWithEdits()). For an overlay, original must be
+  // the baseline, whose text is only rendered once, and only the entries in
+  // GetChanges() are rendered and compared, so the cost depends on the size of
+  // the changes rather than on the size of the schema.
+  std::vector<tensorflow::metadata::v0::DiffRegion> GetDiffRegions(
+      const tensorflow::metadata::v0::Schema& original,
+      int context_lines) const;
+
   // Populates FeatureStatisticsToProtoConfig with groups of enums that seem
   // similar. config is the original config, and dataset_stats has
   // the relevant data.
@@ -144,6 +428,10 @@ class Schema {
   // Returns true if there are no enum types and no feature types.
   bool IsEmpty() const;
 
+  // An estimate of the memory used by this schema, in bytes. For an overlay,
+  // the baseline is not counted.
+  size_t GetMemoryUsage() const;
+
   // Check if there are any issues with a single column.
   tensorflow::Status UpdateFeature(
       const Updater& updater, const FeatureStatsView& feature_stats_view,
@@ -151,6 +439,26 @@ class Schema {
       absl::optional<tensorflow::metadata::v0::DriftSkewInfo>* drift_skew_info,
       tensorflow::metadata::v0::AnomalyInfo::Severity* severity);
 
+  // Same as above, but if tracker is not null, adds the cost of each
+  // comparator of the feature to tracker.
+  tensorflow::Status UpdateFeature(
+      const Updater& updater, const FeatureStatsView& feature_stats_view,
+      std::vector<Description>* descriptions,
+      absl::optional<tensorflow::metadata::v0::DriftSkewInfo>* drift_skew_info,
+      tensorflow::metadata::v0::AnomalyInfo::Severity* severity,
+      FeatureCostTracker* tracker);
+
+  // Same as above, but if deadline is not null and has expired before a
+  // comparator of the feature, that comparator and the next ones are skipped,
+  // and *comparators_skipped is set to true (it is set to false otherwise).
+  tensorflow::Status UpdateFeature(
+      const Updater& updater, const FeatureStatsView& feature_stats_view,
+      std::vector<Description>* descriptions,
+      absl::optional<tensorflow::metadata::v0::DriftSkewInfo>* drift_skew_info,
+      tensorflow::metadata::v0::AnomalyInfo::Severity* severity,
+      FeatureCostTracker* tracker, const ValidationDeadline* deadline,
+      bool* comparators_skipped);
+
   // A method for updating the skew comparator.
   FeatureComparisonResult UpdateSkewComparator(
       const FeatureStatsView& feature_stats_view);
@@ -162,6 +470,12 @@ class Schema {
   // (i.e., no FeatureNameStatistics).
   std::vector<Path> GetMissingPaths(const DatasetStatsView& dataset_stats);
 
+  // Same as above, but only considers the features in paths, their ancestors
+  // and their descendants. Takes time proportional to the number of features
+  // considered, if this is an overlay to which no feature was added.
+  std::vector<Path> GetMissingPaths(const DatasetStatsView& dataset_stats,
+                                    const std::set<Path>& paths);
+
   // Updates dataset-level constraints.
   std::vector<Description> UpdateDatasetConstraints(
       const DatasetStatsView& dataset_stats_view);
@@ -179,6 +493,28 @@ class Schema {
       const DatasetStatsView& dataset_stats, const Updater& updater,
       const absl::optional<std::set<Path>>& paths_to_consider);
 
+  // The names of the string domains that an update used, recorded while
+  // string_domain_names_ is set.
+  struct StringDomainNames {
+    // Looked up, added or cleared.
+    std::set<string> used;
+    // Cleared.
+    std::set<string> cleared;
+  };
+
+  // Calls UpdateRecursively() on each of root_features, using num_threads
+  // threads, with the same result as calling it on each one in order.
+  // Must not be called on an overlay.
+  tensorflow::Status UpdateRootFeaturesInParallel(
+      const Updater& updater,
+      const std::vector<FeatureStatsView>& root_features,
+      const absl::optional<std::set<Path>>& paths_to_consider,
+      int num_threads);
+
+  // Records that the string domain with this name is looked up, added or
+  // cleared, if string_domain_names_ is set.
+  void UseStringDomainName(const string& name) const;
+
   // Gets a map from a simple enum name to the columns that are using it.
   // Used in GetRelatedEnums().
   std::map<string, std::set<Path>> EnumNameToPaths() const;
@@ -196,6 +532,20 @@ class Schema {
   // Gets an existing StringDomain. If it does not already exist, returns null.
   StringDomain* GetExistingStringDomain(const string& name);
 
+  // For an overlay, gets the values of the StringDomain of the baseline with
+  // this name, unless the overlay has already copied (or cleared) it, so that
+  // it can be checked without copying it. Otherwise, returns null.
+  const StringDomainValueSet* GetBaselineStringDomainValues(
+      const string& name) const;
+
+  // Gets an existing top-level feature, or returns null if it doesn't exist.
+  // For an overlay, copies the feature from the baseline if necessary.
+  Feature* GetExistingTopLevelFeature(const string& name);
+
+  // Returns the proto holding the schema-wide fields, such as
+  // default_environment.
+  const tensorflow::metadata::v0::Schema& root_schema() const;
+
   // Finds all names and of features in the environment.
   std::vector<Path> GetAllRequiredFeatures(
       const Path& prefix,
@@ -241,10 +591,13 @@ class Schema {
   // Gets a new feature. Assumes that the feature does not already exist.
   Feature* GetNewFeature(const Path& path);
 
+  // tracker and deadline may be null.
   void UpdateFeatureInternal(
       const Updater& updater, const FeatureStatsView& view, Feature* feature,
       std::vector<Description>* descriptions,
-      absl::optional<tensorflow::metadata::v0::DriftSkewInfo>* drift_skew_info);
+      absl::optional<tensorflow::metadata::v0::DriftSkewInfo>* drift_skew_info,
+      FeatureCostTracker* tracker, const ValidationDeadline* deadline,
+      bool* comparators_skipped);
 
   // Validates the dataset_stats of a sparse feature:
   // - Ensures that referred features are either all present, or all absent.
@@ -268,7 +621,21 @@ class Schema {
 
   // Note: do not manually add string_domains or features.
   // Call GetNewEnum() or GetNewFeature().
+  // For an overlay, only holds the entries copied from (or added to)
+  // baseline_.
   tensorflow::metadata::v0::Schema schema_;
+
+  // The schema this schema is an overlay on, or null if schema_ holds the
+  // whole schema. See InitOverlay().
+  std::shared_ptr<const IndexedSchema> baseline_;
+
+  // The names of the string domains deleted by ClearStringDomain() while
+  // baseline_ was set. These are deleted from baseline_ in GetSchema().
+  std::set<string> cleared_string_domains_;
+
+  // If not null, records the string domains used by the update of a root
+  // feature (see UpdateRootFeaturesInParallel()).
+  StringDomainNames* string_domain_names_ = nullptr;
 };
 
 }  // namespace data_validation
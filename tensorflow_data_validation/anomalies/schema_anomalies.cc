@@ -18,14 +18,16 @@ limitations under the License.
 #include <algorithm>
 #include <map>
 #include <memory>
-#include <numeric>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "tensorflow_data_validation/anomalies/diff_util.h"
+#include "tensorflow_data_validation/anomalies/feature_util.h"
+#include "absl/base/casts.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow_data_validation/anomalies/internal_types.h"
@@ -34,8 +36,11 @@ limitations under the License.
 #include "tensorflow_data_validation/anomalies/schema.h"
 #include "tensorflow_data_validation/anomalies/schema_util.h"
 #include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow_data_validation/anomalies/validation_profile.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/types.h"
@@ -47,12 +52,22 @@ namespace data_validation {
 
 namespace {
 using ::tensorflow::Status;
+using ::tensorflow::metadata::v0::Feature;
+using ::tensorflow::metadata::v0::FeatureNameStatistics;
 
 // LINT.IfChange
 constexpr char kMultipleErrors[] = "Multiple errors";
 // LINT.ThenChange(../utils/anomalies_util.py)
 constexpr char kColumnDropped[] = "Column dropped";
 
+// The number of unchanged lines of the schema shown around each change in the
+// diff regions of an anomaly.
+constexpr int kDiffContextLines = 3;
+
+// The number of sibling features checked by one task in a parallel traversal.
+// A feature with more children than this splits them into several tasks.
+constexpr int kChildrenPerTask = 64;
+
 // For internal use only.
 int NumericalSeverity(tensorflow::metadata::v0::AnomalyInfo::Severity a) {
   switch (a) {
@@ -77,40 +92,279 @@ bool AllSchemaNewColumn(const std::vector<Description>& descriptions) {
   return true;
 }
 
-// Handles multiple SchemaNewColumn descriptions as a single one.
-// Otherwise, leaves descriptions unchanged.
-std::vector<Description> FilterDescriptions(
-    const std::vector<Description>& descriptions) {
+// Handles multiple SchemaNewColumn descriptions as a single one: returns the
+// number of descriptions kept, which are the first ones.
+// Otherwise, keeps all the descriptions.
+int NumFilteredDescriptions(const std::vector<Description>& descriptions) {
   if (!descriptions.empty() && AllSchemaNewColumn(descriptions)) {
-    return {descriptions[0]};
+    return 1;
   }
-  return descriptions;
+  return descriptions.size();
 }
 
-// Aggregates the descriptions into a single description.
+// Aggregates the first num_descriptions descriptions, whose long forms are
+// rendered in long_descriptions, into the forms of a single description.
 // Eventually, unification can happen in the front end.
-Description UnifyDescriptions(const std::vector<Description>& descriptions) {
-  return std::accumulate(
-      descriptions.begin(), descriptions.end(), Description(),
-      [](const Description& description_a, const Description& description_b) {
-        if (description_a.long_description.empty()) {
-          return description_b;
-        } else if (description_b.long_description.empty()) {
-          return description_a;
-        } else {
-          Description output;
-          // The actual type of the aggregate anomaly is ignored.
-          output.type = tensorflow::metadata::v0::AnomalyInfo::MULTIPLE_REASONS;
-          absl::StrAppend(&output.long_description,
-                          description_a.long_description, " ",
-                          description_b.long_description);
-          output.short_description = kMultipleErrors;
-          return output;
-        }
-      });
+void UnifyDescriptions(const std::vector<Description>& descriptions,
+                       int num_descriptions,
+                       const std::vector<string>& long_descriptions,
+                       string* short_description, string* long_description) {
+  std::vector<int> non_empty;
+  for (int i = 0; i < num_descriptions; ++i) {
+    if (!long_descriptions[i].empty()) {
+      non_empty.push_back(i);
+    }
+  }
+  if (non_empty.size() > 1) {
+    // The long forms are concatenated once, rather than pairwise.
+    *long_description = absl::StrJoin(
+        non_empty, " ", [&long_descriptions](string* output, int i) {
+          output->append(long_descriptions[i]);
+        });
+    *short_description = kMultipleErrors;
+  } else if (non_empty.size() == 1) {
+    *long_description = long_descriptions[non_empty[0]];
+    *short_description = descriptions[non_empty[0]].short_description;
+  } else {
+    long_description->clear();
+    *short_description = num_descriptions > 0
+                             ? descriptions[num_descriptions - 1]
+                                   .short_description
+                             : "";
+  }
 }
 // LINT.ThenChange(../utils/anomalies_util.py)
 
+// A feature anomaly, ranked to cap the anomalies that are materialized (see
+// SchemaAnomalies::set_max_anomalies()).
+struct RankedAnomaly {
+  tensorflow::metadata::v0::AnomalyInfo::Severity severity;
+  tensorflow::metadata::v0::AnomalyInfo::Type type;
+  // The serialized path of the feature.
+  string path;
+};
+
+// Orders the anomalies by decreasing severity, then by type, then by path.
+bool HasHigherPriority(const RankedAnomaly& a, const RankedAnomaly& b) {
+  if (a.severity != b.severity) {
+    return NumericalSeverity(a.severity) > NumericalSeverity(b.severity);
+  }
+  if (a.type != b.type) {
+    return a.type < b.type;
+  }
+  return a.path < b.path;
+}
+
+// Returns true if no two features have the same path.
+bool HasDistinctPaths(const ArenaVector<FeatureStatsView>& features) {
+  std::set<Path> paths;
+  for (const FeatureStatsView& feature : features) {
+    if (!paths.insert(feature.GetPath()).second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns a fingerprint of everything the anomalies under a root feature
+// depend on, except for the statistics of the root feature and its
+// descendants, for the environment (see GetEnvironmentFingerprint()), and for
+// the weights (see GetWeightFingerprint()).
+uint64 GetContextFingerprint(
+    const IndexedSchema& schema,
+    const absl::optional<std::set<Path>>& features_needed,
+    const Schema::Updater& updater, bool enable_diff_regions) {
+  string config;
+  CHECK(SerializeToStringDeterministic(updater.config(), &config));
+  uint64 fingerprint =
+      FingerprintCat64(schema.fingerprint(), Fingerprint64(config));
+  if (features_needed) {
+    fingerprint = FingerprintCat64(fingerprint, features_needed->size() + 1);
+    for (const Path& path : *features_needed) {
+      fingerprint =
+          FingerprintCat64(fingerprint, Fingerprint64(path.Serialize()));
+    }
+  } else {
+    fingerprint = FingerprintCat64(fingerprint, 0);
+  }
+  return FingerprintCat64(fingerprint, enable_diff_regions);
+}
+
+// Returns a fingerprint of the statistics of a feature and its descendants,
+// and of the same features in the control statistics.
+uint64 GetFeatureTreeFingerprint(const FeatureStatsView& feature) {
+  uint64 fingerprint = FingerprintCat64(
+      Fingerprint64(feature.GetSerializedPath()), feature.GetFingerprint());
+  for (const absl::optional<FeatureStatsView>& control :
+       {feature.GetPreviousSpan(), feature.GetServing()}) {
+    fingerprint = FingerprintCat64(
+        fingerprint, control ? FingerprintCat64(1, control->GetFingerprint())
+                             : 0);
+  }
+  const std::vector<FeatureStatsView> children = feature.GetChildren();
+  fingerprint = FingerprintCat64(fingerprint, children.size());
+  for (const FeatureStatsView& child : children) {
+    fingerprint =
+        FingerprintCat64(fingerprint, GetFeatureTreeFingerprint(child));
+  }
+  return fingerprint;
+}
+
+// Returns true if a feature and all its descendants are either in their
+// environment or absent from the schema.
+bool FeatureTreeIsInEnvironment(const IndexedSchema& schema,
+                                const FeatureStatsView& feature) {
+  if (!schema.FeatureIsInEnvironment(feature.GetPath(),
+                                     feature.environment())) {
+    return false;
+  }
+  for (const FeatureStatsView& child : feature.GetChildren()) {
+    if (!FeatureTreeIsInEnvironment(schema, child)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns a fingerprint of the environment, as far as the anomalies under a
+// root feature depend on it. They only do if the root feature or one of its
+// descendants is not in the environment, so the anomalies of the other root
+// features are shared by all environments.
+uint64 GetEnvironmentFingerprint(const IndexedSchema& schema,
+                                 const FeatureStatsView& root_feature) {
+  if (FeatureTreeIsInEnvironment(schema, root_feature)) {
+    return 0;
+  }
+  // Without an environment, all the features are in the environment.
+  return FingerprintCat64(1, Fingerprint64(*root_feature.environment()));
+}
+
+// Returns true if the anomalies of a feature (but not of its descendants) are
+// the same whether its statistics are viewed by weight or not: its checks in
+// the schema only read the statistics that are never weighted (the type, the
+// numbers of values, the range of the numbers, the number of unique values,
+// the custom statistics), and whether its counts are zero, which they are by
+// weight exactly when they are without weights. Features that are not in the
+// schema are inferred from their counts, and sparse and weighted features
+// are checked against the counts of their components.
+bool FeatureIsWeightIndependent(const IndexedSchema& schema,
+                                const FeatureStatsView& feature) {
+  const Path& path = feature.GetPath();
+  const Feature* schema_feature = schema.GetFeature(path);
+  if (schema_feature == nullptr || schema.GetSparseFeature(path) != nullptr ||
+      schema.GetWeightedFeature(path) != nullptr ||
+      schema_feature->has_presence() ||
+      schema_feature->has_distribution_constraints() ||
+      schema_feature->has_drift_comparator() ||
+      schema_feature->has_skew_comparator() ||
+      !feature.WeightedCountsHaveSameZeros()) {
+    return false;
+  }
+  switch (schema_feature->domain_info_case()) {
+    case Feature::kIntDomain:
+    case Feature::kFloatDomain:
+      // The numbers of a string feature are parsed from the values of its
+      // (weighted) rank histogram.
+      return feature.type() != FeatureNameStatistics::STRING &&
+             feature.type() != FeatureNameStatistics::BYTES;
+    case Feature::kStructDomain:
+    case Feature::kMidDomain:
+    case Feature::kUrlDomain:
+    case Feature::kTimeDomain:
+    case Feature::DOMAIN_INFO_NOT_SET:
+      return true;
+    default:
+      // String, bool, image and natural language domains read the
+      // (weighted) counts of the values.
+      return false;
+  }
+}
+
+// Returns true if a feature and all its descendants are weight independent
+// (see FeatureIsWeightIndependent()).
+bool FeatureTreeIsWeightIndependent(const IndexedSchema& schema,
+                                    const FeatureStatsView& feature) {
+  if (!FeatureIsWeightIndependent(schema, feature)) {
+    return false;
+  }
+  for (const FeatureStatsView& child : feature.GetChildren()) {
+    if (!FeatureTreeIsWeightIndependent(schema, child)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns a fingerprint of whether statistics are viewed by weight, and of
+// their (weighted) numbers of examples. The anomalies under a root feature
+// only depend on it if the root feature or one of its descendants is not
+// weight independent (see FeatureTreeIsWeightIndependent()), so the
+// anomalies of the other root features are shared by the validations by
+// weight and without weights.
+uint64 GetWeightFingerprint(const DatasetStatsView& statistics) {
+  uint64 fingerprint = FingerprintCat64(
+      statistics.by_weight() ? 2 : 1,
+      absl::bit_cast<uint64>(statistics.GetNumExamples()));
+  for (const absl::optional<DatasetStatsView>& control :
+       {statistics.GetPreviousSpan(), statistics.GetServing(),
+        statistics.GetPreviousVersion()}) {
+    fingerprint = FingerprintCat64(
+        fingerprint,
+        control ? FingerprintCat64(
+                      1, absl::bit_cast<uint64>(control->GetNumExamples()))
+                : 0);
+  }
+  return fingerprint;
+}
+
+// Serializes the calls to an AnomaliesSink, so that root features can be
+// checked in parallel.
+class LockedAnomaliesSink : public AnomaliesSink {
+ public:
+  explicit LockedAnomaliesSink(AnomaliesSink* sink) : sink_(sink) {}
+
+  tensorflow::Status OnAnomalyInfo(
+      const string& path,
+      const tensorflow::metadata::v0::AnomalyInfo& anomaly_info) override {
+    mutex_lock lock(mu_);
+    return sink_->OnAnomalyInfo(path, anomaly_info);
+  }
+
+  tensorflow::Status OnDriftSkewInfo(
+      const tensorflow::metadata::v0::DriftSkewInfo& drift_skew_info)
+      override {
+    mutex_lock lock(mu_);
+    return sink_->OnDriftSkewInfo(drift_skew_info);
+  }
+
+  tensorflow::Status OnDatasetAnomalyInfo(
+      const tensorflow::metadata::v0::AnomalyInfo& anomaly_info) override {
+    mutex_lock lock(mu_);
+    return sink_->OnDatasetAnomalyInfo(anomaly_info);
+  }
+
+  tensorflow::Status OnDataMissing() override {
+    mutex_lock lock(mu_);
+    return sink_->OnDataMissing();
+  }
+
+ private:
+  mutex mu_;
+  AnomaliesSink* const sink_;
+};
+
+// Passes the anomalies in a FeatureValidationResult to sink.
+tensorflow::Status SendFeatureValidationResult(
+    const FeatureValidationResult& result, AnomaliesSink* sink) {
+  for (const auto& pair : result.anomaly_info()) {
+    TF_RETURN_IF_ERROR(sink->OnAnomalyInfo(pair.first, pair.second));
+  }
+  for (const auto& drift_skew_info : result.drift_skew_info()) {
+    TF_RETURN_IF_ERROR(sink->OnDriftSkewInfo(drift_skew_info));
+  }
+  return Status::OK();
+}
+
 bool ShouldCreateFeature(const absl::optional<std::set<Path>>& features_needed,
                          const FeatureStatsView& feature) {
   return !features_needed ||
@@ -142,53 +396,71 @@ tensorflow::Status SchemaAnomalyBase::InitSchema(
   return schema_->Init(schema);
 }
 
+tensorflow::Status SchemaAnomalyBase::InitSchema(
+    std::shared_ptr<const IndexedSchema> baseline) {
+  schema_ = absl::make_unique<Schema>();
+  return schema_->InitOverlay(std::move(baseline));
+}
+
 void SchemaAnomalyBase::UpgradeSeverity(
     tensorflow::metadata::v0::AnomalyInfo::Severity new_severity) {
   severity_ = MaxSeverity(severity_, new_severity);
 }
 
+size_t SchemaAnomalyBase::GetMemoryUsage() const {
+  size_t result = descriptions_.capacity() * sizeof(Description);
+  if (schema_ != nullptr) {
+    result += schema_->GetMemoryUsage();
+  }
+  return result;
+}
+
 tensorflow::metadata::v0::AnomalyInfo SchemaAnomalyBase::GetAnomalyInfo(
     const tensorflow::metadata::v0::Schema& baseline,
     bool enable_diff_regions) const {
-  const tensorflow::metadata::v0::Schema new_schema = schema_->GetSchema();
   tensorflow::metadata::v0::AnomalyInfo anomaly_info;
   if (enable_diff_regions) {
-    // Find diff regions.
-    const string baseline_text = baseline.DebugString();
-    const std::vector<absl::string_view> existing_schema_lines =
-        absl::StrSplit(baseline_text, '\n');
-
-    const string new_schema_text = new_schema.DebugString();
-    const std::vector<absl::string_view> new_schema_lines =
-        absl::StrSplit(new_schema_text, '\n');
-
+    // Find diff regions. For an overlay, only the entries of the schema that
+    // changed are rendered and compared.
     std::vector<tensorflow::metadata::v0::DiffRegion> diff_regions_vec =
-        ComputeDiff(existing_schema_lines, new_schema_lines);
+        schema_->GetDiffRegions(baseline, kDiffContextLines);
 
     copy(diff_regions_vec.begin(), diff_regions_vec.end(),
          ::tensorflow::protobuf::RepeatedPtrFieldBackInserter(
              anomaly_info.mutable_diff_regions()));
   }
-  const std::vector<Description> filtered_descriptions =
-      FilterDescriptions(descriptions_);
-  for (const Description& description : filtered_descriptions) {
+  // The long forms are only rendered here, once each.
+  const int num_descriptions = NumFilteredDescriptions(descriptions_);
+  std::vector<string> long_descriptions;
+  long_descriptions.reserve(num_descriptions);
+  for (int i = 0; i < num_descriptions; ++i) {
+    const Description& description = descriptions_[i];
+    long_descriptions.push_back(description.GetLongDescription());
     tensorflow::metadata::v0::AnomalyInfo::Reason& reason =
         *anomaly_info.add_reason();
     reason.set_type(description.type);
     reason.set_short_description(description.short_description);
-    reason.set_description(description.long_description);
+    reason.set_description(long_descriptions.back());
   }
   {
     // Set description of entire anomaly.
-    const Description unified_description =
-        UnifyDescriptions(filtered_descriptions);
-    anomaly_info.set_description(unified_description.long_description);
-    anomaly_info.set_short_description(unified_description.short_description);
+    UnifyDescriptions(descriptions_, num_descriptions, long_descriptions,
+                      anomaly_info.mutable_short_description(),
+                      anomaly_info.mutable_description());
     anomaly_info.set_severity(severity_);
   }
   return anomaly_info;
 }
 
+tensorflow::metadata::v0::AnomalyInfo::Type SchemaAnomalyBase::GetType()
+    const {
+  if (descriptions_.empty()) {
+    return tensorflow::metadata::v0::AnomalyInfo::UNKNOWN_TYPE;
+  }
+  // NumFilteredDescriptions(...) always keeps the first description.
+  return descriptions_[0].type;
+}
+
 SchemaAnomaly::SchemaAnomaly() : SchemaAnomalyBase() {}
 
 SchemaAnomaly::SchemaAnomaly(SchemaAnomaly&& schema_anomaly)
@@ -216,13 +488,30 @@ void SchemaAnomaly::ObserveMissing(const Schema::Updater& updater) {
 tensorflow::Status SchemaAnomaly::Update(
     const Schema::Updater& updater,
     const FeatureStatsView& feature_stats_view) {
+  return Update(updater, feature_stats_view, /*tracker=*/nullptr);
+}
+
+tensorflow::Status SchemaAnomaly::Update(
+    const Schema::Updater& updater, const FeatureStatsView& feature_stats_view,
+    FeatureCostTracker* tracker) {
+  bool comparators_skipped;
+  return Update(updater, feature_stats_view, tracker, /*deadline=*/nullptr,
+                &comparators_skipped);
+}
+
+tensorflow::Status SchemaAnomaly::Update(
+    const Schema::Updater& updater, const FeatureStatsView& feature_stats_view,
+    FeatureCostTracker* tracker, const ValidationDeadline* deadline,
+    bool* comparators_skipped) {
+  const ScopedFeatureCost cost("update", feature_stats_view, tracker);
   std::vector<Description> new_descriptions;
   tensorflow::metadata::v0::AnomalyInfo::Severity new_severity;
-  TF_RETURN_IF_ERROR(schema_->UpdateFeature(updater, feature_stats_view,
-                                            &new_descriptions,
-                                            &drift_skew_info_, &new_severity));
-  descriptions_.insert(descriptions_.end(), new_descriptions.begin(),
-                       new_descriptions.end());
+  TF_RETURN_IF_ERROR(schema_->UpdateFeature(
+      updater, feature_stats_view, &new_descriptions, &drift_skew_info_,
+      &new_severity, tracker, deadline, comparators_skipped));
+  descriptions_.insert(descriptions_.end(),
+                       std::make_move_iterator(new_descriptions.begin()),
+                       std::make_move_iterator(new_descriptions.end()));
   UpgradeSeverity(new_severity);
   return tensorflow::Status::OK();
 }
@@ -240,8 +529,9 @@ tensorflow::Status SchemaAnomaly::CreateNewField(
   UpgradeSeverity(new_severity);
   // Having a recursive column creates multiple descriptions.
   // Instead, we just push the first one.
-  descriptions_.insert(descriptions_.end(), new_descriptions.begin(),
-                       new_descriptions.end());
+  descriptions_.insert(descriptions_.end(),
+                       std::make_move_iterator(new_descriptions.begin()),
+                       std::make_move_iterator(new_descriptions.end()));
   return Status::OK();
 }
 
@@ -252,9 +542,10 @@ void SchemaAnomaly::UpdateSkewComparator(
   if (!feature_comparison_result.descriptions.empty()) {
     UpgradeSeverity(tensorflow::metadata::v0::AnomalyInfo::ERROR);
   }
-  descriptions_.insert(descriptions_.end(),
-                       feature_comparison_result.descriptions.begin(),
-                       feature_comparison_result.descriptions.end());
+  descriptions_.insert(
+      descriptions_.end(),
+      std::make_move_iterator(feature_comparison_result.descriptions.begin()),
+      std::make_move_iterator(feature_comparison_result.descriptions.end()));
   if (!feature_comparison_result.measurements.empty()) {
     drift_skew_info_.emplace();
     for (const auto& measurement : feature_comparison_result.measurements) {
@@ -282,44 +573,170 @@ tensorflow::metadata::v0::AnomalyInfo SchemaAnomaly::GetAnomalyInfo(
 DatasetSchemaAnomaly::DatasetSchemaAnomaly() : SchemaAnomalyBase() {}
 
 void DatasetSchemaAnomaly::Update(const DatasetStatsView& dataset_stats_view) {
-  const std::vector<Description> new_descriptions =
+  std::vector<Description> new_descriptions =
       schema_->UpdateDatasetConstraints(dataset_stats_view);
   if (!new_descriptions.empty()) {
     UpgradeSeverity(tensorflow::metadata::v0::AnomalyInfo::ERROR);
   }
-  descriptions_.insert(descriptions_.end(), new_descriptions.begin(),
-                       new_descriptions.end());
+  descriptions_.insert(descriptions_.end(),
+                       std::make_move_iterator(new_descriptions.begin()),
+                       std::make_move_iterator(new_descriptions.end()));
+}
+
+size_t SchemaAnomalies::GetMemoryUsage() const {
+  size_t result = 0;
+  for (const auto& pair : anomalies_) {
+    result += sizeof(pair) + pair.second.GetMemoryUsage();
+  }
+  for (const auto& pair : drift_skew_infos_) {
+    result += sizeof(pair) + pair.second.SpaceUsedLong();
+  }
+  for (const auto& pair : anomaly_infos_) {
+    result += pair.first.capacity() + pair.second.SpaceUsedLong();
+  }
+  for (const auto& pair : schema_changes_) {
+    result += pair.first.capacity() + pair.second.SpaceUsedLong();
+  }
+  if (dataset_anomalies_) {
+    result += dataset_anomalies_->GetMemoryUsage();
+  }
+  return result;
 }
 
 tensorflow::metadata::v0::Anomalies SchemaAnomalies::GetSchemaDiff(
     bool enable_diff_regions) const {
-  const tensorflow::metadata::v0::Schema& schema_proto = serialized_baseline_;
   tensorflow::metadata::v0::Anomalies result;
-  result.set_anomaly_name_format(
+  GetSchemaDiff(enable_diff_regions, &result);
+  return result;
+}
+
+void SchemaAnomalies::GetSchemaDiff(
+    bool enable_diff_regions,
+    tensorflow::metadata::v0::Anomalies* result) const {
+  result->Clear();
+  GetAnomaliesWithoutBaseline(
+      enable_diff_regions,
+      GetDroppedAnomalies(/*num_dropped_by_type=*/nullptr), result);
+  *result->mutable_baseline() = serialized_baseline_->schema();
+}
+
+AnomaliesDelta SchemaAnomalies::GetAnomaliesDelta(
+    bool enable_diff_regions) const {
+  AnomaliesDelta result;
+  std::map<string, int64> num_dropped_by_type;
+  const std::set<string> dropped = GetDroppedAnomalies(&num_dropped_by_type);
+  GetAnomaliesWithoutBaseline(enable_diff_regions, dropped,
+                              result.mutable_anomalies());
+  result.set_baseline_fingerprint(serialized_baseline_->fingerprint());
+  result.set_partial(partial_);
+  for (const Path& path : unchecked_features_) {
+    *result.add_unchecked_feature() = path.AsProto();
+  }
+  result.mutable_num_dropped_anomalies()->insert(num_dropped_by_type.begin(),
+                                                 num_dropped_by_type.end());
+  ::tensorflow::protobuf::Map<string, SchemaChanges>& schema_changes =
+      *result.mutable_schema_changes();
+  for (const auto& pair : anomalies_) {
+    const string path = pair.first.Serialize();
+    if (!ContainsKey(dropped, path)) {
+      schema_changes[path] = pair.second.GetSchemaChanges();
+    }
+  }
+  for (const auto& pair : schema_changes_) {
+    if (!ContainsKey(dropped, pair.first)) {
+      schema_changes[pair.first] = pair.second;
+    }
+  }
+  if (dataset_anomalies_) {
+    *result.mutable_dataset_schema_changes() =
+        dataset_anomalies_->GetSchemaChanges();
+  }
+  return result;
+}
+
+std::map<string, int64> SchemaAnomalies::GetNumDroppedAnomalies() const {
+  std::map<string, int64> result;
+  GetDroppedAnomalies(&result);
+  return result;
+}
+
+std::set<string> SchemaAnomalies::GetDroppedAnomalies(
+    std::map<string, int64>* num_dropped_by_type) const {
+  std::set<string> dropped;
+  const int num_anomalies = anomalies_.size() + anomaly_infos_.size();
+  if (max_anomalies_ <= 0 || num_anomalies <= max_anomalies_) {
+    return dropped;
+  }
+  // Only the severity and the type are needed to rank the anomalies, so none
+  // of them is materialized.
+  std::vector<RankedAnomaly> ranked;
+  ranked.reserve(num_anomalies);
+  for (const auto& pair : anomalies_) {
+    const SchemaAnomaly& anomaly = pair.second;
+    ranked.push_back(
+        {anomaly.severity(), anomaly.GetType(), pair.first.Serialize()});
+  }
+  for (const auto& pair : anomaly_infos_) {
+    const tensorflow::metadata::v0::AnomalyInfo& anomaly_info = pair.second;
+    ranked.push_back(
+        {anomaly_info.severity(),
+         anomaly_info.reason_size() > 0
+             ? anomaly_info.reason(0).type()
+             : tensorflow::metadata::v0::AnomalyInfo::UNKNOWN_TYPE,
+         pair.first});
+  }
+  // The paths are distinct, so the order is total, and the anomalies kept do
+  // not depend on the order of ranked.
+  std::nth_element(ranked.begin(), ranked.begin() + max_anomalies_,
+                   ranked.end(), HasHigherPriority);
+  for (auto iter = ranked.begin() + max_anomalies_; iter != ranked.end();
+       ++iter) {
+    if (num_dropped_by_type != nullptr) {
+      ++(*num_dropped_by_type)[tensorflow::metadata::v0::AnomalyInfo::Type_Name(
+          iter->type)];
+    }
+    dropped.insert(std::move(iter->path));
+  }
+  return dropped;
+}
+
+void SchemaAnomalies::GetAnomaliesWithoutBaseline(
+    bool enable_diff_regions, const std::set<string>& dropped,
+    tensorflow::metadata::v0::Anomalies* result) const {
+  const tensorflow::metadata::v0::Schema& schema_proto =
+      serialized_baseline_->schema();
+  result->set_anomaly_name_format(
       tensorflow::metadata::v0::Anomalies::SERIALIZED_PATH);
-  *result.mutable_baseline() = schema_proto;
   ::tensorflow::protobuf::Map<string, tensorflow::metadata::v0::AnomalyInfo>&
-      result_schemas = *result.mutable_anomaly_info();
+      result_schemas = *result->mutable_anomaly_info();
   for (const auto& pair : anomalies_) {
-    const Path& feature_path = pair.first;
-    const SchemaAnomaly& anomaly = pair.second;
-    result_schemas[feature_path.Serialize()] =
-        anomaly.GetAnomalyInfo(schema_proto, enable_diff_regions);
+    const string path = pair.first.Serialize();
+    if (!ContainsKey(dropped, path)) {
+      result_schemas[path] =
+          pair.second.GetAnomalyInfo(schema_proto, enable_diff_regions);
+    }
+  }
+  if (!anomaly_infos_.empty()) {
+    DCHECK_EQ(enable_diff_regions, anomaly_infos_enable_diff_regions_);
+    for (const auto& pair : anomaly_infos_) {
+      if (!ContainsKey(dropped, pair.first)) {
+        result_schemas[pair.first] = pair.second;
+      }
+    }
   }
   if (dataset_anomalies_) {
-    *result.mutable_dataset_anomaly_info() =
+    *result->mutable_dataset_anomaly_info() =
         dataset_anomalies_->GetAnomalyInfo(schema_proto, enable_diff_regions);
   }
   for (const auto& pair : drift_skew_infos_) {
-    auto* drift_skew_info = result.add_drift_skew_info();
+    auto* drift_skew_info = result->add_drift_skew_info();
     *drift_skew_info = pair.second;
     *drift_skew_info->mutable_path() = pair.first.AsProto();
   }
-  return result;
 }
 
 tensorflow::Status SchemaAnomalies::InitSchema(Schema* schema) const {
-  return schema->Init(serialized_baseline_);
+  return schema->InitOverlay(serialized_baseline_);
 }
 
 tensorflow::Status SchemaAnomalies::GenericUpdate(
@@ -337,6 +754,7 @@ tensorflow::Status SchemaAnomalies::GenericUpdate(
   } else {
     schema_anomaly = &new_schema_anomaly;
     TF_RETURN_IF_ERROR(schema_anomaly->InitSchema(serialized_baseline_));
+    ++num_schema_copies_;
     schema_anomaly->set_path(path);
     TF_RETURN_IF_ERROR(update(schema_anomaly));
     if (schema_anomaly->is_problem()) {
@@ -356,6 +774,7 @@ tensorflow::Status SchemaAnomalies::GenericDatasetUpdate(
         update) {
   DatasetSchemaAnomaly dataset_schema_anomaly;
   TF_RETURN_IF_ERROR(dataset_schema_anomaly.InitSchema(serialized_baseline_));
+  ++num_schema_copies_;
   TF_RETURN_IF_ERROR(update(&dataset_schema_anomaly));
   if (dataset_schema_anomaly.is_problem()) {
     dataset_anomalies_ = std::move(dataset_schema_anomaly);
@@ -366,34 +785,76 @@ tensorflow::Status SchemaAnomalies::GenericDatasetUpdate(
 tensorflow::Status SchemaAnomalies::FindChangesRecursively(
     const FeatureStatsView& feature_stats_view,
     const absl::optional<std::set<Path>>& features_needed,
-    const Schema::Updater& updater) {
-  Schema baseline;
-  TF_RETURN_IF_ERROR(InitSchema(&baseline));
-  if (baseline.FeatureExists(feature_stats_view.GetPath())) {
+    const PathsToVisit* paths_to_visit, const Schema::Updater& updater) {
+  if (deadline_ != nullptr && deadline_->Expired()) {
+    // The rest of the traversal only lists the features it reaches.
+    unchecked_features_.push_back(feature_stats_view.GetPath());
+    return Status::OK();
+  }
+  ++num_features_visited_;
+  if (serialized_baseline_->FeatureExists(feature_stats_view.GetPath())) {
     // TODO(b/148407751): Treat PLANNED separately.
-    if (baseline.FeatureIsDeprecated(feature_stats_view.GetPath())) {
+    if (serialized_baseline_->FeatureIsDeprecated(
+            feature_stats_view.GetPath())) {
+      return Status::OK();
+    }
+    bool comparators_skipped = false;
+    // The schema is only copied for the features whose check program may
+    // fire, as the others would have no anomaly to keep.
+    if (ContainsKey(anomalies_, feature_stats_view.GetPath()) ||
+        !serialized_baseline_->FeatureChecksPass(
+            feature_stats_view, updater.config().skip_comparators())) {
+      TF_RETURN_IF_ERROR(GenericUpdate(
+          [this, &feature_stats_view, &updater,
+           &comparators_skipped](SchemaAnomaly* schema_anomaly) {
+            return schema_anomaly->Update(updater, feature_stats_view,
+                                          feature_cost_tracker_, deadline_,
+                                          &comparators_skipped);
+          },
+          feature_stats_view.GetPath()));
+    }
+    if (comparators_skipped) {
+      // The anomalies found before the deadline are kept.
+      unchecked_features_.push_back(feature_stats_view.GetPath());
+      return Status::OK();
+    }
+    if (StopAtError(feature_stats_view.GetPath())) {
       return Status::OK();
     }
-    TF_RETURN_IF_ERROR(GenericUpdate(
-        [&feature_stats_view, &updater](SchemaAnomaly* schema_anomaly) {
-          return schema_anomaly->Update(updater, feature_stats_view);
-        },
-        feature_stats_view.GetPath()));
     if (ContainsKey(anomalies_, feature_stats_view.GetPath()) &&
         anomalies_[feature_stats_view.GetPath()].FeatureIsDeprecated(
             feature_stats_view.GetPath())) {
       return Status::OK();
     }
-    for (const FeatureStatsView& child : feature_stats_view.GetChildren()) {
-      TF_RETURN_IF_ERROR(
-          FindChangesRecursively(child, features_needed, updater));
+    if (paths_to_visit != nullptr &&
+        !ContainsKey(*features_needed, feature_stats_view.GetPath())) {
+      const auto iter = paths_to_visit->find(feature_stats_view.GetPath());
+      if (iter != paths_to_visit->end()) {
+        ArenaVector<FeatureStatsView> children(
+            (ArenaAllocator<FeatureStatsView>(arena_)));
+        children.reserve(iter->second.size());
+        for (const Path& child_path : iter->second) {
+          const absl::optional<FeatureStatsView> child =
+              feature_stats_view.parent_view().GetByPath(child_path);
+          if (child) {
+            children.push_back(*child);
+          }
+        }
+        return FindChangesInChildren(children, features_needed,
+                                     paths_to_visit, updater);
+      }
+      return Status::OK();
     }
+    return FindChangesInChildren(feature_stats_view.GetChildren(arena_),
+                                 features_needed, /*paths_to_visit=*/nullptr,
+                                 updater);
   } else if (ShouldCreateFeature(features_needed, feature_stats_view)) {
     // Feature doesn't exist. Need to recursively create it.
 
     if (!ContainsKey(anomalies_, feature_stats_view.GetPath())) {
       SchemaAnomaly anomaly;
       TF_RETURN_IF_ERROR(anomaly.InitSchema(serialized_baseline_));
+      ++num_schema_copies_;
       anomaly.set_path(feature_stats_view.GetPath());
       anomalies_[feature_stats_view.GetPath()] = std::move(anomaly);
     }
@@ -401,6 +862,237 @@ tensorflow::Status SchemaAnomalies::FindChangesRecursively(
     // features_needed == features_to_update.
     TF_RETURN_IF_ERROR(anomalies_[feature_stats_view.GetPath()].CreateNewField(
         updater, features_needed, feature_stats_view));
+    StopAtError(feature_stats_view.GetPath());
+  }
+  return Status::OK();
+}
+
+bool SchemaAnomalies::StopAtError(const Path& path) {
+  if (stop_at_error_ && !partial_) {
+    const auto iter = anomalies_.find(path);
+    partial_ = iter != anomalies_.end() &&
+               iter->second.severity() ==
+                   tensorflow::metadata::v0::AnomalyInfo::ERROR;
+  }
+  return partial_;
+}
+
+tensorflow::Status SchemaAnomalies::FindChangesInChildren(
+    const ArenaVector<FeatureStatsView>& children,
+    const absl::optional<std::set<Path>>& features_needed,
+    const PathsToVisit* paths_to_visit, const Schema::Updater& updater) {
+  if (deadline_ != nullptr && !feature_priorities_.empty()) {
+    // The traversal with a deadline has no task_queue_.
+    return FindChangesInOrder(PrioritizeFeatures(children), features_needed,
+                              paths_to_visit, updater);
+  }
+  if (task_queue_ == nullptr || children.size() <= kChildrenPerTask) {
+    for (const FeatureStatsView& child : children) {
+      TF_RETURN_IF_ERROR(FindChangesRecursively(child, features_needed,
+                                                paths_to_visit, updater));
+      if (partial_) {
+        break;
+      }
+    }
+    return Status::OK();
+  }
+  // The children are distinct features, so the partial results have disjoint
+  // keys.
+  const int num_tasks =
+      (children.size() + kChildrenPerTask - 1) / kChildrenPerTask;
+  std::vector<SchemaAnomalies> partial_results;
+  partial_results.reserve(num_tasks);
+  for (int i = 0; i < num_tasks; ++i) {
+    partial_results.push_back(SchemaAnomalies(serialized_baseline_, arena_));
+    partial_results.back().set_feature_cost_tracker(feature_cost_tracker_);
+    partial_results.back().task_queue_ = task_queue_;
+  }
+  std::vector<Status> statuses(num_tasks);
+  TaskQueue::Group group;
+  for (int i = 0; i < num_tasks; ++i) {
+    task_queue_->Schedule(&group, [&, i]() {
+      const int end =
+          std::min<int>(children.size(), (i + 1) * kChildrenPerTask);
+      for (int j = i * kChildrenPerTask; j < end && statuses[i].ok(); ++j) {
+        statuses[i] = partial_results[i].FindChangesRecursively(
+            children[j], features_needed, paths_to_visit, updater);
+      }
+    });
+  }
+  task_queue_->Wait(&group);
+  for (int i = 0; i < num_tasks; ++i) {
+    TF_RETURN_IF_ERROR(statuses[i]);
+    AddPartialResult(&partial_results[i]);
+  }
+  return Status::OK();
+}
+
+void SchemaAnomalies::AddPartialResult(SchemaAnomalies* partial_result) {
+  anomalies_.insert(
+      std::make_move_iterator(partial_result->anomalies_.begin()),
+      std::make_move_iterator(partial_result->anomalies_.end()));
+  drift_skew_infos_.insert(
+      std::make_move_iterator(partial_result->drift_skew_infos_.begin()),
+      std::make_move_iterator(partial_result->drift_skew_infos_.end()));
+  anomaly_infos_.insert(
+      std::make_move_iterator(partial_result->anomaly_infos_.begin()),
+      std::make_move_iterator(partial_result->anomaly_infos_.end()));
+  schema_changes_.insert(
+      std::make_move_iterator(partial_result->schema_changes_.begin()),
+      std::make_move_iterator(partial_result->schema_changes_.end()));
+  unchecked_features_.insert(unchecked_features_.end(),
+                             partial_result->unchecked_features_.begin(),
+                             partial_result->unchecked_features_.end());
+  num_features_visited_ += partial_result->num_features_visited_;
+  num_schema_copies_ += partial_result->num_schema_copies_;
+}
+
+bool InMemoryFeatureValidationCache::Get(uint64 fingerprint,
+                                         FeatureValidationResult* result) {
+  mutex_lock lock(mu_);
+  auto iter = results_.find(fingerprint);
+  if (iter == results_.end()) {
+    return false;
+  }
+  *result = iter->second;
+  return true;
+}
+
+void InMemoryFeatureValidationCache::Put(
+    uint64 fingerprint, const FeatureValidationResult& result) {
+  mutex_lock lock(mu_);
+  results_[fingerprint] = result;
+}
+
+tensorflow::Status SchemaAnomalies::FindChangesForRoot(
+    const FeatureStatsView& root_feature,
+    const absl::optional<std::set<Path>>& features_needed,
+    const PathsToVisit* paths_to_visit, const Schema::Updater& updater,
+    FeatureValidationCache* cache, uint64 context_fingerprint,
+    uint64 weight_fingerprint, bool enable_diff_regions, AnomaliesSink* sink) {
+  if (cache == nullptr && sink == nullptr) {
+    return FindChangesRecursively(root_feature, features_needed,
+                                  paths_to_visit, updater);
+  }
+  uint64 fingerprint = 0;
+  if (cache != nullptr) {
+    fingerprint = FingerprintCat64(
+        FingerprintCat64(context_fingerprint,
+                         GetFeatureTreeFingerprint(root_feature)),
+        GetEnvironmentFingerprint(*serialized_baseline_, root_feature));
+    if (!FeatureTreeIsWeightIndependent(*serialized_baseline_, root_feature)) {
+      fingerprint = FingerprintCat64(fingerprint, weight_fingerprint);
+    }
+  }
+  FeatureValidationResult result;
+  if (cache == nullptr || !cache->Get(fingerprint, &result)) {
+    SchemaAnomalies root_anomalies(serialized_baseline_, arena_);
+    root_anomalies.set_feature_cost_tracker(feature_cost_tracker_);
+    root_anomalies.task_queue_ = task_queue_;
+    TF_RETURN_IF_ERROR(root_anomalies.FindChangesRecursively(
+        root_feature, features_needed, paths_to_visit, updater));
+    num_features_visited_ += root_anomalies.num_features_visited_;
+    num_schema_copies_ += root_anomalies.num_schema_copies_;
+    for (const auto& pair : root_anomalies.anomalies_) {
+      const string path = pair.first.Serialize();
+      (*result.mutable_anomaly_info())[path] = pair.second.GetAnomalyInfo(
+          serialized_baseline_->schema(), enable_diff_regions);
+      (*result.mutable_schema_changes())[path] =
+          pair.second.GetSchemaChanges();
+    }
+    for (const auto& pair : root_anomalies.drift_skew_infos_) {
+      tensorflow::metadata::v0::DriftSkewInfo* drift_skew_info =
+          result.add_drift_skew_info();
+      *drift_skew_info = pair.second;
+      *drift_skew_info->mutable_path() = pair.first.AsProto();
+    }
+    if (cache != nullptr) {
+      cache->Put(fingerprint, result);
+    }
+  }
+  if (sink != nullptr) {
+    return SendFeatureValidationResult(result, sink);
+  }
+  AddFeatureValidationResult(result);
+  return Status::OK();
+}
+
+void SchemaAnomalies::AddFeatureValidationResult(
+    const FeatureValidationResult& result) {
+  anomaly_infos_.insert(result.anomaly_info().begin(),
+                        result.anomaly_info().end());
+  schema_changes_.insert(result.schema_changes().begin(),
+                         result.schema_changes().end());
+  for (const auto& drift_skew_info : result.drift_skew_info()) {
+    tensorflow::metadata::v0::DriftSkewInfo& merged =
+        drift_skew_infos_[Path(drift_skew_info.path())];
+    merged.MergeFrom(drift_skew_info);
+    merged.clear_path();
+  }
+}
+
+tensorflow::Status SchemaAnomalies::SendAnomalies(bool enable_diff_regions,
+                                                  AnomaliesSink* sink) {
+  const tensorflow::metadata::v0::Schema& schema_proto =
+      serialized_baseline_->schema();
+  for (const auto& pair : anomalies_) {
+    TF_RETURN_IF_ERROR(sink->OnAnomalyInfo(
+        pair.first.Serialize(),
+        pair.second.GetAnomalyInfo(schema_proto, enable_diff_regions)));
+  }
+  for (const auto& pair : anomaly_infos_) {
+    TF_RETURN_IF_ERROR(sink->OnAnomalyInfo(pair.first, pair.second));
+  }
+  if (dataset_anomalies_) {
+    TF_RETURN_IF_ERROR(sink->OnDatasetAnomalyInfo(
+        dataset_anomalies_->GetAnomalyInfo(schema_proto, enable_diff_regions)));
+  }
+  for (const auto& pair : drift_skew_infos_) {
+    tensorflow::metadata::v0::DriftSkewInfo drift_skew_info = pair.second;
+    *drift_skew_info.mutable_path() = pair.first.AsProto();
+    TF_RETURN_IF_ERROR(sink->OnDriftSkewInfo(drift_skew_info));
+  }
+  anomalies_.clear();
+  anomaly_infos_.clear();
+  schema_changes_.clear();
+  dataset_anomalies_.reset();
+  drift_skew_infos_.clear();
+  return Status::OK();
+}
+
+tensorflow::Status SchemaAnomalies::FindChangesInParallel(
+    const ArenaVector<FeatureStatsView>& root_features,
+    const absl::optional<std::set<Path>>& features_needed,
+    const PathsToVisit* paths_to_visit, const Schema::Updater& updater,
+    int num_threads, FeatureValidationCache* cache,
+    uint64 context_fingerprint, uint64 weight_fingerprint,
+    bool enable_diff_regions, AnomaliesSink* sink) {
+  // All the anomalies of a root feature are keyed by paths under that
+  // feature. So the partial results have disjoint keys, and merging them does
+  // not depend on the order in which the root features were checked.
+  std::vector<SchemaAnomalies> partial_results;
+  partial_results.reserve(root_features.size());
+  // This thread waits for the root features, running their tasks meanwhile,
+  // so num_threads - 1 more threads are enough.
+  TaskQueue task_queue("find_changes", num_threads - 1);
+  for (int i = 0; i < root_features.size(); ++i) {
+    partial_results.push_back(SchemaAnomalies(serialized_baseline_, arena_));
+    partial_results.back().set_feature_cost_tracker(feature_cost_tracker_);
+    partial_results.back().task_queue_ = &task_queue;
+  }
+  std::vector<Status> statuses(root_features.size());
+  TaskQueue::Group group;
+  for (int i = 0; i < root_features.size(); ++i) {
+    task_queue.Schedule(&group, [&, i]() {
+      statuses[i] = partial_results[i].FindChangesForRoot(
+          root_features[i], features_needed, paths_to_visit, updater, cache,
+          context_fingerprint, weight_fingerprint, enable_diff_regions, sink);
+    });
+  }
+  task_queue.Wait(&group);
+  for (int i = 0; i < root_features.size(); ++i) {
+    TF_RETURN_IF_ERROR(statuses[i]);
+    AddPartialResult(&partial_results[i]);
   }
   return Status::OK();
 }
@@ -409,7 +1101,41 @@ tensorflow::Status SchemaAnomalies::FindChanges(
     const DatasetStatsView& statistics,
     const absl::optional<FeaturesNeeded>& features_needed,
     const FeatureStatisticsToProtoConfig& feature_statistics_to_proto_config) {
-  Schema::Updater updater(feature_statistics_to_proto_config);
+  return FindChanges(statistics, features_needed,
+                     feature_statistics_to_proto_config, /*num_threads=*/1);
+}
+
+tensorflow::Status SchemaAnomalies::FindChanges(
+    const DatasetStatsView& statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    const FeatureStatisticsToProtoConfig& feature_statistics_to_proto_config,
+    int num_threads) {
+  const Schema::Updater updater(feature_statistics_to_proto_config);
+  return FindChanges(statistics, features_needed, updater, num_threads);
+}
+
+tensorflow::Status SchemaAnomalies::FindChanges(
+    const DatasetStatsView& statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    const Schema::Updater& updater, int num_threads) {
+  return FindChanges(statistics, features_needed, updater, num_threads,
+                     /*enable_diff_regions=*/false, /*cache=*/nullptr);
+}
+
+tensorflow::Status SchemaAnomalies::FindChanges(
+    const DatasetStatsView& statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    const Schema::Updater& updater, int num_threads, bool enable_diff_regions,
+    FeatureValidationCache* cache) {
+  return FindChanges(statistics, features_needed, updater, num_threads,
+                     enable_diff_regions, cache, /*sink=*/nullptr);
+}
+
+tensorflow::Status SchemaAnomalies::FindChanges(
+    const DatasetStatsView& statistics,
+    const absl::optional<FeaturesNeeded>& features_needed,
+    const Schema::Updater& updater, int num_threads, bool enable_diff_regions,
+    FeatureValidationCache* cache, AnomaliesSink* sink) {
   absl::optional<std::set<Path>> feature_set_to_create;
   if (features_needed) {
     feature_set_to_create = std::set<Path>();
@@ -419,25 +1145,112 @@ tensorflow::Status SchemaAnomalies::FindChanges(
     }
   }
 
-  for (const FeatureStatsView& feature_stats_view :
-       statistics.GetRootFeatures()) {
-    TF_RETURN_IF_ERROR(FindChangesRecursively(feature_stats_view,
-                                              feature_set_to_create, updater));
+  // If only the needed features are validated, the traversal starts from the
+  // needed features and goes up to the root features, so that the features
+  // that are neither needed nor ancestors of needed features are not visited.
+  absl::optional<PathsToVisit> paths_to_visit;
+  ArenaVector<FeatureStatsView> root_features(
+      (ArenaAllocator<FeatureStatsView>(arena_)));
+  if (features_needed && updater.config().only_validate_features_needed()) {
+    paths_to_visit = PathsToVisit();
+    for (const Path& path : *feature_set_to_create) {
+      for (Path child = path; !child.empty(); child = child.GetParent()) {
+        if (!(*paths_to_visit)[child.GetParent()].insert(child).second) {
+          // The ancestors of child were already added.
+          break;
+        }
+      }
+    }
+    const std::set<Path>& root_paths = (*paths_to_visit)[Path()];
+    root_features.reserve(root_paths.size());
+    for (const Path& root_path : root_paths) {
+      const absl::optional<FeatureStatsView> root =
+          statistics.GetByPath(root_path);
+      if (root) {
+        root_features.push_back(*root);
+      }
+    }
+  } else {
+    root_features = statistics.GetRootFeatures(arena_);
   }
-  Schema baseline;
-  TF_RETURN_IF_ERROR(InitSchema(&baseline));
-  for (const Path& path : baseline.GetMissingPaths(statistics)) {
-    TF_RETURN_IF_ERROR(GenericUpdate(
-        [&updater](SchemaAnomaly* schema_anomaly) {
-          schema_anomaly->ObserveMissing(updater);
-          return Status::OK();
-        },
-        path));
+  const PathsToVisit* paths_to_visit_ptr =
+      paths_to_visit ? &*paths_to_visit : nullptr;
+  if (deadline_ != nullptr) {
+    ComputeFeaturePriorities(statistics, feature_set_to_create);
+    if (!feature_priorities_.empty()) {
+      root_features = PrioritizeFeatures(root_features);
+    }
+  }
+  if (updater.config().fail_fast()) {
+    TF_RETURN_IF_ERROR(FindChangesFailFast(statistics, feature_set_to_create,
+                                           paths_to_visit_ptr, root_features,
+                                           updater));
+    return FinishFindChanges(enable_diff_regions, sink);
+  }
+  if (deadline_ != nullptr) {
+    TF_RETURN_IF_ERROR(FindChangesWithDeadline(
+        statistics, feature_set_to_create, paths_to_visit_ptr, root_features,
+        updater));
+    return FinishFindChanges(enable_diff_regions, sink);
+  }
+  // A single root feature is also checked in parallel, as its descendants are
+  // split into tasks.
+  const bool parallel = num_threads > 1 && !root_features.empty();
+  // Like parallel validation, incremental validation and passing the anomalies
+  // of each root feature to the sink need the anomalies of the root features
+  // to be independent, so the root features must have distinct paths.
+  // Otherwise, the anomalies are only passed to the sink at the end.
+  const bool distinct_paths =
+      (parallel || cache != nullptr || sink != nullptr) &&
+      HasDistinctPaths(root_features);
+  if (!distinct_paths) {
+    cache = nullptr;
+  }
+  absl::optional<LockedAnomaliesSink> locked_sink;
+  AnomaliesSink* root_sink = nullptr;
+  if (sink != nullptr && distinct_paths) {
+    if (parallel) {
+      locked_sink.emplace(sink);
+      root_sink = &*locked_sink;
+    } else {
+      root_sink = sink;
+    }
+  }
+  uint64 context_fingerprint = 0;
+  uint64 weight_fingerprint = 0;
+  if (cache != nullptr) {
+    context_fingerprint =
+        GetContextFingerprint(*serialized_baseline_, feature_set_to_create,
+                              updater, enable_diff_regions);
+    weight_fingerprint = GetWeightFingerprint(statistics);
+    anomaly_infos_enable_diff_regions_ = enable_diff_regions;
+  }
+  {
+    const ScopedValidationStage stage("find_feature_changes", profile_);
+    if (parallel && distinct_paths) {
+      TF_RETURN_IF_ERROR(FindChangesInParallel(
+          root_features, feature_set_to_create, paths_to_visit_ptr, updater,
+          num_threads, cache, context_fingerprint, weight_fingerprint,
+          enable_diff_regions, root_sink));
+    } else {
+      for (const FeatureStatsView& feature_stats_view : root_features) {
+        TF_RETURN_IF_ERROR(FindChangesForRoot(
+            feature_stats_view, feature_set_to_create, paths_to_visit_ptr,
+            updater, cache, context_fingerprint, weight_fingerprint,
+            enable_diff_regions, root_sink));
+      }
+    }
+  }
+  {
+    const ScopedValidationStage stage("find_missing_features", profile_);
+    TF_RETURN_IF_ERROR(FindMissingFeatures(statistics, feature_set_to_create,
+                                           paths_to_visit_ptr, updater));
   }
   if (features_needed) {
     for (const auto& p : *features_needed) {
       const Path& path = p.first;
-      if (!statistics.GetByPath(path) && !baseline.FeatureExists(path)) {
+      if (!statistics.GetByPath(path) &&
+          !serialized_baseline_->FeatureExists(path)) {
         // TODO(114770329): come up with a special error here, as this
         // indicates that a feature is required that is not in the data.
         LOG(ERROR) << "Required feature missing from data and schema: "
@@ -446,19 +1259,249 @@ tensorflow::Status SchemaAnomalies::FindChanges(
     }
   }
 
-  TF_RETURN_IF_ERROR(FindDatasetChanges(statistics));
+  {
+    const ScopedValidationStage stage("find_dataset_changes", profile_);
+    TF_RETURN_IF_ERROR(FindDatasetChanges(statistics));
+  }
+  return FinishFindChanges(enable_diff_regions, sink);
+}
+
+tensorflow::Status SchemaAnomalies::FindChangesFailFast(
+    const DatasetStatsView& statistics,
+    const absl::optional<std::set<Path>>& features_needed,
+    const PathsToVisit* paths_to_visit,
+    const ArenaVector<FeatureStatsView>& root_features,
+    const Schema::Updater& updater) {
+  stop_at_error_ = true;
+  {
+    const ScopedValidationStage stage("find_missing_features", profile_);
+    TF_RETURN_IF_ERROR(FindMissingFeatures(statistics, features_needed,
+                                           paths_to_visit, updater));
+  }
+  if (partial_) {
+    return Status::OK();
+  }
+  {
+    const ScopedValidationStage stage("find_dataset_changes", profile_);
+    TF_RETURN_IF_ERROR(FindDatasetChanges(statistics));
+  }
+  if (dataset_anomalies_ &&
+      dataset_anomalies_->severity() ==
+          tensorflow::metadata::v0::AnomalyInfo::ERROR) {
+    partial_ = true;
+    return Status::OK();
+  }
+  {
+    const ScopedValidationStage stage("find_cheap_feature_changes", profile_);
+    // The anomalies of the features are only kept if there is an error, as
+    // the comparators could add to them.
+    FeatureStatisticsToProtoConfig config = updater.config();
+    config.set_skip_comparators(true);
+    const Schema::Updater updater_without_comparators(config);
+    SchemaAnomalies feature_anomalies(serialized_baseline_, arena_);
+    feature_anomalies.set_feature_cost_tracker(feature_cost_tracker_);
+    feature_anomalies.stop_at_error_ = true;
+    feature_anomalies.deadline_ = deadline_;
+    feature_anomalies.feature_priorities_ = feature_priorities_;
+    TF_RETURN_IF_ERROR(feature_anomalies.FindChangesInOrder(
+        root_features, features_needed, paths_to_visit,
+        updater_without_comparators));
+    if (feature_anomalies.partial_ ||
+        !feature_anomalies.unchecked_features_.empty()) {
+      // The paths of the features in the statistics are distinct from the
+      // paths of the missing features.
+      AddPartialResult(&feature_anomalies);
+      partial_ = true;
+      return Status::OK();
+    }
+    if (!serialized_baseline_->HasFeatureComparators()) {
+      // Without comparators, the cheap checks were the full checks.
+      AddPartialResult(&feature_anomalies);
+      return Status::OK();
+    }
+    num_features_visited_ += feature_anomalies.num_features_visited_;
+    num_schema_copies_ += feature_anomalies.num_schema_copies_;
+  }
+  const ScopedValidationStage stage("find_feature_changes", profile_);
+  return FindChangesInOrder(root_features, features_needed, paths_to_visit,
+                            updater);
+}
+
+tensorflow::Status SchemaAnomalies::FindChangesWithDeadline(
+    const DatasetStatsView& statistics,
+    const absl::optional<std::set<Path>>& features_needed,
+    const PathsToVisit* paths_to_visit,
+    const ArenaVector<FeatureStatsView>& root_features,
+    const Schema::Updater& updater) {
+  {
+    const ScopedValidationStage stage("find_missing_features", profile_);
+    TF_RETURN_IF_ERROR(FindMissingFeatures(statistics, features_needed,
+                                           paths_to_visit, updater));
+  }
+  {
+    const ScopedValidationStage stage("find_dataset_changes", profile_);
+    TF_RETURN_IF_ERROR(FindDatasetChanges(statistics));
+  }
+  const ScopedValidationStage stage("find_feature_changes", profile_);
+  return FindChangesInOrder(root_features, features_needed, paths_to_visit,
+                            updater);
+}
 
+void SchemaAnomalies::ComputeFeaturePriorities(
+    const DatasetStatsView& statistics,
+    const absl::optional<std::set<Path>>& features_needed) {
+  feature_priorities_.clear();
+  // Inserting never lowers the priority of a path, so that the ancestors of
+  // a needed feature stay needed.
+  const auto add_with_ancestors = [this](const Path& path, int priority) {
+    for (Path ancestor = path; !ancestor.empty();
+         ancestor = ancestor.GetParent()) {
+      if (!feature_priorities_.insert({ancestor, priority}).second) {
+        break;
+      }
+    }
+  };
+  if (features_needed) {
+    for (const Path& path : *features_needed) {
+      add_with_ancestors(path, 0);
+    }
+  }
+  const int environment_id =
+      serialized_baseline_->GetEnvironmentId(statistics.environment());
+  for (const IndexedSchema::RequiredFeature& required :
+       serialized_baseline_->required_features()) {
+    if (serialized_baseline_->FeatureIdIsRequired(required.id,
+                                                  environment_id)) {
+      add_with_ancestors(required.path, 1);
+    }
+  }
+}
+
+ArenaVector<FeatureStatsView> SchemaAnomalies::PrioritizeFeatures(
+    const ArenaVector<FeatureStatsView>& features) const {
+  constexpr int kDefaultPriority = 2;
+  std::vector<std::pair<int, int>> priority_and_index;
+  priority_and_index.reserve(features.size());
+  for (int i = 0; i < features.size(); ++i) {
+    const auto iter = feature_priorities_.find(features[i].GetPath());
+    priority_and_index.emplace_back(
+        iter == feature_priorities_.end() ? kDefaultPriority : iter->second,
+        i);
+  }
+  // The pairs are distinct, so this is stable.
+  std::sort(priority_and_index.begin(), priority_and_index.end());
+  ArenaVector<FeatureStatsView> result(
+      (ArenaAllocator<FeatureStatsView>(arena_)));
+  result.reserve(features.size());
+  for (const auto& pair : priority_and_index) {
+    result.push_back(features[pair.second]);
+  }
+  return result;
+}
+
+tensorflow::Status SchemaAnomalies::FindChangesInOrder(
+    const ArenaVector<FeatureStatsView>& features,
+    const absl::optional<std::set<Path>>& features_needed,
+    const PathsToVisit* paths_to_visit, const Schema::Updater& updater) {
+  for (const FeatureStatsView& feature_stats_view : features) {
+    TF_RETURN_IF_ERROR(FindChangesRecursively(
+        feature_stats_view, features_needed, paths_to_visit, updater));
+    if (partial_) {
+      break;
+    }
+  }
+  return Status::OK();
+}
+
+tensorflow::Status SchemaAnomalies::FindMissingFeatures(
+    const DatasetStatsView& statistics,
+    const absl::optional<std::set<Path>>& features_needed,
+    const PathsToVisit* paths_to_visit, const Schema::Updater& updater) {
+  Schema baseline;
+  TF_RETURN_IF_ERROR(InitSchema(&baseline));
+  ++num_schema_copies_;
+  const std::vector<Path> missing_paths =
+      paths_to_visit ? baseline.GetMissingPaths(statistics, *features_needed)
+                     : baseline.GetMissingPaths(statistics);
+  for (const Path& path : missing_paths) {
+    TF_RETURN_IF_ERROR(GenericUpdate(
+        [&updater](SchemaAnomaly* schema_anomaly) {
+          schema_anomaly->ObserveMissing(updater);
+          return Status::OK();
+        },
+        path));
+    if (StopAtError(path)) {
+      break;
+    }
+  }
+  return Status::OK();
+}
+
+tensorflow::Status SchemaAnomalies::FinishFindChanges(bool enable_diff_regions,
+                                                      AnomaliesSink* sink) {
+  if (!unchecked_features_.empty()) {
+    partial_ = true;
+  }
+  if (sink != nullptr) {
+    TF_RETURN_IF_ERROR(SendAnomalies(enable_diff_regions, sink));
+  }
+  if (profile_ != nullptr) {
+    profile_->set_num_features_visited(profile_->num_features_visited() +
+                                       num_features_visited_);
+    profile_->set_num_schema_copies(profile_->num_schema_copies() +
+                                    num_schema_copies_);
+    num_features_visited_ = 0;
+    num_schema_copies_ = 0;
+    if (partial_) {
+      profile_->set_partial(true);
+    }
+    for (const Path& path : unchecked_features_) {
+      *profile_->add_unchecked_feature() = path.AsProto();
+    }
+  }
   return Status::OK();
 }
 
 tensorflow::Status SchemaAnomalies::FindSkew(
     const DatasetStatsView& dataset_stats_view) {
-  for (const FeatureStatsView& feature_stats_view :
-       dataset_stats_view.features()) {
+  // Only the features with a skew comparator can have skew.
+  for (const Path& path : serialized_baseline_->skew_comparator_paths()) {
     // This is a simplified version of finding skew, that ignores the feature
-    // if there is no training data for it.
+    // if there is no training data for it. The features of the schema are
+    // probed without logging misses, as many may have no statistics.
+    if (!dataset_stats_view.HasPath(path)) {
+      continue;
+    }
+    const FeatureStatsView feature_stats_view =
+        *dataset_stats_view.GetByPath(path);
+    if (!ContainsKey(anomalies_, path)) {
+      // The comparator is first run on a copy of the one of the baseline, so
+      // that the schema is only copied if there is an anomaly (the comparator
+      // is then updated). Otherwise, only the measurements are kept.
+      tensorflow::metadata::v0::FeatureComparator comparator =
+          serialized_baseline_->GetFeature(path)->skew_comparator();
+      FeatureComparisonResult result;
+      {
+        const ScopedFeatureCost cost("skew_comparator", feature_stats_view,
+                                     feature_cost_tracker_);
+        result = UpdateFeatureComparatorDirect(
+            feature_stats_view, FeatureComparatorType::SKEW, &comparator);
+      }
+      if (result.descriptions.empty()) {
+        if (!result.measurements.empty()) {
+          tensorflow::metadata::v0::DriftSkewInfo& drift_skew_info =
+              drift_skew_infos_[path];
+          for (const auto& measurement : result.measurements) {
+            *drift_skew_info.add_skew_measurements() = measurement;
+          }
+        }
+        continue;
+      }
+    }
     TF_RETURN_IF_ERROR(GenericUpdate(
-        [&feature_stats_view](SchemaAnomaly* schema_anomaly) {
+        [this, &feature_stats_view](SchemaAnomaly* schema_anomaly) {
+          const ScopedFeatureCost cost("skew_comparator", feature_stats_view,
+                                       feature_cost_tracker_);
           schema_anomaly->UpdateSkewComparator(feature_stats_view);
           return Status::OK();
         },
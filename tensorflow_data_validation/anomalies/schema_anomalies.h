@@ -19,15 +19,23 @@ limitations under the License.
 #include <functional>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "tensorflow_data_validation/anomalies/features_needed.h"
 #include "tensorflow_data_validation/anomalies/internal_types.h"
+#include "tensorflow_data_validation/anomalies/monotonic_arena.h"
 #include "tensorflow_data_validation/anomalies/proto/feature_statistics_to_proto.pb.h"
+#include "tensorflow_data_validation/anomalies/proto/validation_metadata.pb.h"
 #include "tensorflow_data_validation/anomalies/schema.h"
 #include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow_data_validation/anomalies/task_queue.h"
+#include "tensorflow_data_validation/anomalies/validation_deadline.h"
+#include "tensorflow_data_validation/anomalies/validation_profile.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_metadata/proto/v0/anomalies.pb.h"
 #include "tensorflow_metadata/proto/v0/schema.pb.h"
@@ -35,6 +43,63 @@ limitations under the License.
 namespace tensorflow {
 namespace data_validation {
 
+// A cache of the anomalies found under root features, for incremental
+// validation (see SchemaAnomalies::FindChanges()). A result is keyed by a
+// fingerprint of everything it depends on: the statistics of the feature and
+// its descendants (and of the same features in the control statistics), the
+// whole schema, the configuration, and the dataset-level context.
+// Implementations can persist the results between runs (e.g., by serializing
+// them), and must be thread-safe, as root features may be checked in parallel.
+class FeatureValidationCache {
+ public:
+  virtual ~FeatureValidationCache() {}
+
+  // Looks up the result with a fingerprint. Returns false if there is none.
+  virtual bool Get(uint64 fingerprint, FeatureValidationResult* result) = 0;
+
+  // Stores the result with a fingerprint.
+  virtual void Put(uint64 fingerprint,
+                   const FeatureValidationResult& result) = 0;
+};
+
+// A FeatureValidationCache that keeps all the results in memory.
+class InMemoryFeatureValidationCache : public FeatureValidationCache {
+ public:
+  bool Get(uint64 fingerprint, FeatureValidationResult* result) override;
+
+  void Put(uint64 fingerprint, const FeatureValidationResult& result) override;
+
+ private:
+  mutex mu_;
+  std::map<uint64, FeatureValidationResult> results_ TF_GUARDED_BY(mu_);
+};
+
+// Receives the anomalies of a validation one by one, as soon as they are known
+// (see SchemaAnomalies::FindChanges()), instead of in one Anomalies proto.
+// If a method returns an error, the validation stops with that error.
+class AnomaliesSink {
+ public:
+  virtual ~AnomaliesSink() {}
+
+  // Receives the anomaly of a feature. path is the key of the anomaly in
+  // Anomalies.anomaly_info (i.e., the serialized path of the feature).
+  virtual tensorflow::Status OnAnomalyInfo(
+      const string& path,
+      const tensorflow::metadata::v0::AnomalyInfo& anomaly_info) = 0;
+
+  // Receives the drift and skew measurements of a feature.
+  virtual tensorflow::Status OnDriftSkewInfo(
+      const tensorflow::metadata::v0::DriftSkewInfo& drift_skew_info) = 0;
+
+  // Receives the dataset-level anomaly, if there is one.
+  virtual tensorflow::Status OnDatasetAnomalyInfo(
+      const tensorflow::metadata::v0::AnomalyInfo& anomaly_info) = 0;
+
+  // Called instead of all the above if there is no data (see
+  // Anomalies.data_missing). Only called by the Validator.
+  virtual tensorflow::Status OnDataMissing() = 0;
+};
+
 // A base class for individual schema anomalies, which can identify problems
 // at the dataset or feature level.
 class SchemaAnomalyBase {
@@ -50,6 +115,10 @@ class SchemaAnomalyBase {
   // Initializes schema_.
   tensorflow::Status InitSchema(const tensorflow::metadata::v0::Schema& schema);
 
+  // Initializes schema_ as a copy-on-write overlay on baseline, so that only
+  // the parts of the schema changed by this anomaly are copied.
+  tensorflow::Status InitSchema(std::shared_ptr<const IndexedSchema> baseline);
+
   // If new_severity is more severe that current severity, increases
   // severity. Otherwise, does nothing.
   void UpgradeSeverity(
@@ -60,12 +129,27 @@ class SchemaAnomalyBase {
     return severity_ != tensorflow::metadata::v0::AnomalyInfo::UNKNOWN;
   }
 
+  tensorflow::metadata::v0::AnomalyInfo::Severity severity() const {
+    return severity_;
+  }
+
+  // Returns the type of the first reason of the anomaly (see GetAnomalyInfo()),
+  // or UNKNOWN_TYPE if there is none.
+  tensorflow::metadata::v0::AnomalyInfo::Type GetType() const;
+
   // Returns an AnomalyInfo representing the change.
-  // baseline is the original schema.
+  // baseline is the original schema. The changed schema is only materialized
+  // if enable_diff_regions is true.
   virtual tensorflow::metadata::v0::AnomalyInfo GetAnomalyInfo(
       const tensorflow::metadata::v0::Schema& baseline,
       bool enable_diff_regions) const;
 
+  // Returns the changes to the baseline that make the anomaly go away.
+  SchemaChanges GetSchemaChanges() const { return schema_->GetChanges(); }
+
+  // An estimate of the memory used by this anomaly, in bytes.
+  size_t GetMemoryUsage() const;
+
  protected:
   // A new schema that will make the anomaly go away.
   std::unique_ptr<Schema> schema_;
@@ -96,6 +180,21 @@ class SchemaAnomaly : public SchemaAnomalyBase {
   tensorflow::Status Update(const Schema::Updater& updater,
                             const FeatureStatsView& feature_stats_view);
 
+  // Same as above, but if tracker is not null, adds the cost of the update
+  // (and of each comparator of the feature) to tracker.
+  tensorflow::Status Update(const Schema::Updater& updater,
+                            const FeatureStatsView& feature_stats_view,
+                            FeatureCostTracker* tracker);
+
+  // Same as above, but if deadline is not null and expires before a
+  // comparator of the feature, the remaining comparators are skipped and
+  // *comparators_skipped is set to true.
+  tensorflow::Status Update(const Schema::Updater& updater,
+                            const FeatureStatsView& feature_stats_view,
+                            FeatureCostTracker* tracker,
+                            const ValidationDeadline* deadline,
+                            bool* comparators_skipped);
+
   // Updates recursively upon the relevant current feature statistics.
   // This is used to have all of the fields of a new sub-message appear
   // in the same anomaly.
@@ -142,7 +241,23 @@ class SchemaAnomaly : public SchemaAnomalyBase {
 class SchemaAnomalies {
  public:
   explicit SchemaAnomalies(const tensorflow::metadata::v0::Schema& schema)
-      : dataset_anomalies_(absl::nullopt), serialized_baseline_(schema) {}
+      : dataset_anomalies_(absl::nullopt),
+        serialized_baseline_(std::make_shared<const IndexedSchema>(schema)) {}
+
+  // Creates a SchemaAnomalies with a baseline that may be shared with other
+  // SchemaAnomalies (e.g., when validating many statistics against one schema).
+  explicit SchemaAnomalies(std::shared_ptr<const IndexedSchema> baseline)
+      : SchemaAnomalies(std::move(baseline), /*arena=*/nullptr) {}
+
+  // Same as above, but the anomalies, and the views of the features traversed,
+  // are allocated on arena (if not null), which must outlive this.
+  SchemaAnomalies(std::shared_ptr<const IndexedSchema> baseline,
+                  MonotonicArena* arena)
+      : anomalies_(ArenaAllocator<std::pair<const Path, SchemaAnomaly>>(arena)),
+        drift_skew_infos_(anomalies_.get_allocator()),
+        dataset_anomalies_(absl::nullopt),
+        serialized_baseline_(std::move(baseline)),
+        arena_(arena) {}
 
   // Finds any column- and dataset-level issues. For column-level issues,
   // creates a map where the key is the key of the column with an anomaly, and
@@ -151,7 +266,9 @@ class SchemaAnomalies {
   // creates a DatasetSchemaAnomaly object that contains a changed schema proto
   // that would allow the dataset to be valid. If features_needed is set, then a
   // field that is not present in the schema will only be created if it is
-  // present in that set.
+  // present in that set. If, in addition, the config has
+  // only_validate_features_needed, then only the features in that set, their
+  // ancestors and their descendants are checked.
   // TODO(b/148408297): If a field is in features_needed, but not in statistics
   // or in the schema, then come up with a special kind of anomaly.
   tensorflow::Status FindChanges(
@@ -159,13 +276,231 @@ class SchemaAnomalies {
       const absl::optional<FeaturesNeeded>& features_needed,
       const FeatureStatisticsToProtoConfig& feature_statistics_to_proto_config);
 
+  // Same as above, but if num_threads is greater than 1, the root features
+  // (and their descendants) are checked in parallel on num_threads threads.
+  // The anomalies found are the same as with a single thread.
+  tensorflow::Status FindChanges(
+      const DatasetStatsView& statistics,
+      const absl::optional<FeaturesNeeded>& features_needed,
+      const FeatureStatisticsToProtoConfig& feature_statistics_to_proto_config,
+      int num_threads);
+
+  // Same as above, but uses an existing updater, so that it can be shared
+  // between many calls.
+  tensorflow::Status FindChanges(
+      const DatasetStatsView& statistics,
+      const absl::optional<FeaturesNeeded>& features_needed,
+      const Schema::Updater& updater, int num_threads);
+
+  // Same as above, but validates incrementally: the anomalies under each root
+  // feature are looked up in cache, and only the root features that are not
+  // found are checked (and their anomalies are added to cache). The result of
+  // GetSchemaDiff(enable_diff_regions) is the same as without a cache.
+  // GetSchemaDiff() must then be called with the same enable_diff_regions.
+  tensorflow::Status FindChanges(
+      const DatasetStatsView& statistics,
+      const absl::optional<FeaturesNeeded>& features_needed,
+      const Schema::Updater& updater, int num_threads,
+      bool enable_diff_regions, FeatureValidationCache* cache);
+
+  // Same as above followed by GetSchemaDiff(enable_diff_regions), except
+  // that the anomalies are passed to sink instead of being kept (the baseline
+  // is not passed). The anomalies under a root feature are passed as soon as
+  // that root feature has been checked, and the anomalies of the missing
+  // features and of the dataset come last. Calls to sink are never
+  // concurrent, but if num_threads is greater than 1, they can come from any
+  // thread, and the root features can come in any order.
+  // If the config of updater has fail_fast, stops at the first anomaly with
+  // severity ERROR (see ValidationConfig.fail_fast and partial()), ignoring
+  // num_threads and cache, and the anomalies are only passed to sink at the
+  // end. The same goes for a deadline (see set_deadline(...)).
+  tensorflow::Status FindChanges(
+      const DatasetStatsView& statistics,
+      const absl::optional<FeaturesNeeded>& features_needed,
+      const Schema::Updater& updater, int num_threads,
+      bool enable_diff_regions, FeatureValidationCache* cache,
+      AnomaliesSink* sink);
+
+  // Finds the skew of the features with a skew comparator, against the
+  // serving statistics of dataset_stats_view. The schema is only copied for
+  // the features with a skew anomaly.
   tensorflow::Status FindSkew(const DatasetStatsView& dataset_stats_view);
 
+  // If profile is not null, FindChanges(...) adds the stages it runs to
+  // profile, and the features it visits and the schema copies it makes to the
+  // counts of profile. profile must outlive these calls.
+  void set_profile(ValidationProfile* profile) { profile_ = profile; }
+
+  // If tracker is not null, FindChanges(...) and FindSkew(...) add the cost of
+  // checking each feature to tracker. tracker must outlive these calls.
+  void set_feature_cost_tracker(FeatureCostTracker* tracker) {
+    feature_cost_tracker_ = tracker;
+  }
+
+  // If greater than 0, GetSchemaDiff(...) and GetAnomaliesDelta(...) only keep
+  // the max_anomalies feature anomalies with the highest priority (the most
+  // severe first, then by type, then by path), and the others are never
+  // materialized (see GetNumDroppedAnomalies()). The dataset anomaly and the
+  // drift and skew measurements are always kept, and the anomalies passed to
+  // an AnomaliesSink are not capped.
+  void set_max_anomalies(int max_anomalies) { max_anomalies_ = max_anomalies; }
+
+  // If deadline is not null, FindChanges(...) stops checking features once it
+  // has expired, and partial() is then true (see
+  // ValidationConfig.deadline_micros). The features needed come first, then
+  // the required ones, then the others. deadline must outlive these calls.
+  void set_deadline(const ValidationDeadline* deadline) {
+    deadline_ = deadline;
+  }
+
+  // The features that FindChanges(...) did not check because the deadline
+  // expired (see AnomaliesDelta.unchecked_feature).
+  const std::vector<Path>& unchecked_features() const {
+    return unchecked_features_;
+  }
+
+  // The number of feature anomalies dropped by set_max_anomalies(...), keyed
+  // by the name of their type (see SchemaAnomalyBase::GetType()).
+  std::map<string, int64> GetNumDroppedAnomalies() const;
+
+  // An estimate of the memory used by the anomalies and the other results
+  // found so far, in bytes, not counting the baseline.
+  size_t GetMemoryUsage() const;
+
   // Records current anomalies as a schema diff.
   tensorflow::metadata::v0::Anomalies GetSchemaDiff(
       bool enable_diff_regions) const;
 
+  // Same as above, but clears result and writes the schema diff into it, so
+  // that it can be built directly in an arena-allocated message.
+  void GetSchemaDiff(bool enable_diff_regions,
+                     tensorflow::metadata::v0::Anomalies* result) const;
+
+  // Same as GetSchemaDiff(enable_diff_regions), but without copying the
+  // baseline: each anomaly comes with the changes that fix it instead.
+  AnomaliesDelta GetAnomaliesDelta(bool enable_diff_regions) const;
+
+  // True iff FindChanges(...) stopped at an error or at the deadline before
+  // checking everything (see FeatureStatisticsToProtoConfig.fail_fast and
+  // set_deadline(...)).
+  bool partial() const { return partial_; }
+
  private:
+  // Maps the path of a feature to the paths of its children that lead to a
+  // needed feature (see ValidationConfig.only_validate_features_needed).
+  using PathsToVisit = std::map<Path, std::set<Path>>;
+
+  // A map keyed by path, allocated on arena_.
+  template <typename Value>
+  using PathMap =
+      std::map<Path, Value, std::less<Path>,
+               ArenaAllocator<std::pair<const Path, Value>>>;
+
+  // Runs FindChangesRecursively(...) for each of the root_features on
+  // num_threads threads. Each root feature is checked by its own
+  // SchemaAnomalies, and the results are merged into this one. Large sets of
+  // children are split into tasks of the same queue (see
+  // FindChangesInChildren(...)), so that a single large root feature is also
+  // checked in parallel. The paths of root_features must be distinct.
+  tensorflow::Status FindChangesInParallel(
+      const ArenaVector<FeatureStatsView>& root_features,
+      const absl::optional<std::set<Path>>& features_needed,
+      const PathsToVisit* paths_to_visit, const Schema::Updater& updater,
+      int num_threads, FeatureValidationCache* cache,
+      uint64 context_fingerprint, uint64 weight_fingerprint,
+      bool enable_diff_regions, AnomaliesSink* sink);
+
+  // Checks a root feature (and its descendants). If cache is not null, first
+  // looks up its anomalies in cache, and adds them to cache if they are not
+  // found. context_fingerprint is the fingerprint of everything the anomalies
+  // depend on, except for the statistics of the features, the environment and
+  // the weights. weight_fingerprint is the fingerprint of the weights, which
+  // is only used if the anomalies of root_feature depend on them. If sink is
+  // not null, the anomalies are passed to sink instead of being kept.
+  tensorflow::Status FindChangesForRoot(
+      const FeatureStatsView& root_feature,
+      const absl::optional<std::set<Path>>& features_needed,
+      const PathsToVisit* paths_to_visit, const Schema::Updater& updater,
+      FeatureValidationCache* cache, uint64 context_fingerprint,
+      uint64 weight_fingerprint, bool enable_diff_regions,
+      AnomaliesSink* sink);
+
+  // Fills result with the current anomalies, except for the baseline and the
+  // ones whose serialized paths are in dropped.
+  void GetAnomaliesWithoutBaseline(
+      bool enable_diff_regions, const std::set<string>& dropped,
+      tensorflow::metadata::v0::Anomalies* result) const;
+
+  // Returns the serialized paths of the feature anomalies dropped by
+  // max_anomalies_, and adds their counts by type to num_dropped_by_type.
+  std::set<string> GetDroppedAnomalies(
+      std::map<string, int64>* num_dropped_by_type) const;
+
+  // Adds the anomalies from a FeatureValidationResult.
+  void AddFeatureValidationResult(const FeatureValidationResult& result);
+
+  // Passes all the anomalies found so far to sink, and forgets them.
+  tensorflow::Status SendAnomalies(bool enable_diff_regions,
+                                   AnomaliesSink* sink);
+
+  // The part of FindChanges(...) with fail_fast: each check stops at the first
+  // error, and the cheap checks come first. The features are checked without
+  // their comparators, and then, if there is no error, with them (so that the
+  // result is the same as without fail_fast). If the schema has no feature
+  // comparators, the results of the first pass are kept instead. Otherwise,
+  // data without errors has its features checked twice, which costs up to
+  // twice as much as validating without fail_fast.
+  tensorflow::Status FindChangesFailFast(
+      const DatasetStatsView& statistics,
+      const absl::optional<std::set<Path>>& features_needed,
+      const PathsToVisit* paths_to_visit,
+      const ArenaVector<FeatureStatsView>& root_features,
+      const Schema::Updater& updater);
+
+  // Runs FindChangesRecursively(...) on each of features in order, stopping
+  // at the first error if stop_at_error_.
+  tensorflow::Status FindChangesInOrder(
+      const ArenaVector<FeatureStatsView>& features,
+      const absl::optional<std::set<Path>>& features_needed,
+      const PathsToVisit* paths_to_visit, const Schema::Updater& updater);
+
+  // The part of FindChanges(...) with a deadline: the missing features and
+  // the dataset are checked first, then root_features (which must already be
+  // prioritized) in order, on one thread.
+  tensorflow::Status FindChangesWithDeadline(
+      const DatasetStatsView& statistics,
+      const absl::optional<std::set<Path>>& features_needed,
+      const PathsToVisit* paths_to_visit,
+      const ArenaVector<FeatureStatsView>& root_features,
+      const Schema::Updater& updater);
+
+  // Fills feature_priorities_ with the features needed (and their ancestors),
+  // then the features whose existence is required in the environment of
+  // statistics (and their ancestors).
+  void ComputeFeaturePriorities(
+      const DatasetStatsView& statistics,
+      const absl::optional<std::set<Path>>& features_needed);
+
+  // Returns features sorted by feature_priorities_ (in a stable way).
+  ArenaVector<FeatureStatsView> PrioritizeFeatures(
+      const ArenaVector<FeatureStatsView>& features) const;
+
+  // Finds the features of the schema that are missing from statistics. If
+  // paths_to_visit is not null, only the features_needed are looked for.
+  tensorflow::Status FindMissingFeatures(
+      const DatasetStatsView& statistics,
+      const absl::optional<std::set<Path>>& features_needed,
+      const PathsToVisit* paths_to_visit, const Schema::Updater& updater);
+
+  // Adds the counts of the work done to profile_ (if any), and passes the
+  // anomalies to sink (if not null).
+  tensorflow::Status FinishFindChanges(bool enable_diff_regions,
+                                       AnomaliesSink* sink);
+
+  // If stop_at_error_ and the anomaly of path (if any) is an error, sets
+  // partial_. Returns partial_.
+  bool StopAtError(const Path& path);
+
   // Checks a particular column for any issues, and:
   // 1. If the column is not in the schema, creates a new Schema proto
   //    where the column and all its descendants are added.
@@ -173,10 +508,27 @@ class SchemaAnomalies {
   //    A. If it is deprecated after repair, do nothing.
   //    B. Otherwise, recursively check all its children, returning separate
   //       anomalies for each child.
+  // If paths_to_visit is not null, only checks the children in
+  // paths_to_visit, unless the column is needed. The descendants of a needed
+  // column are all checked.
   tensorflow::Status FindChangesRecursively(
       const FeatureStatsView& feature_stats_view,
       const absl::optional<std::set<Path>>& features_needed,
-      const Schema::Updater& updater);
+      const PathsToVisit* paths_to_visit, const Schema::Updater& updater);
+
+  // Runs FindChangesRecursively(...) on each of children. If task_queue_ is
+  // not null and there are many children, they are split into tasks, each
+  // checked by its own SchemaAnomalies, and the results are merged into this
+  // one in the order of children (so that the result, or the error returned,
+  // does not depend on the order in which the tasks ran).
+  tensorflow::Status FindChangesInChildren(
+      const ArenaVector<FeatureStatsView>& children,
+      const absl::optional<std::set<Path>>& features_needed,
+      const PathsToVisit* paths_to_visit, const Schema::Updater& updater);
+
+  // Moves the anomalies and counts of partial_result, whose paths must be
+  // distinct from the ones of this, into this.
+  void AddPartialResult(SchemaAnomalies* partial_result);
 
   // 1. If there is a SchemaAnomaly for feature_name, applies update,
   // 2. otherwise, creates a new SchemaAnomaly for the feature_name and
@@ -199,19 +551,55 @@ class SchemaAnomalies {
       const std::function<tensorflow::Status(DatasetSchemaAnomaly* anomaly)>&
           update);
 
-  // Initialize a schema from the serialized_baseline_.
+  // Initializes a schema as an overlay on serialized_baseline_.
   tensorflow::Status InitSchema(Schema* schema) const;
 
   // A map from feature columns to anomalies in that column.
-  std::map<Path, SchemaAnomaly> anomalies_;
+  PathMap<SchemaAnomaly> anomalies_;
+
+  PathMap<tensorflow::metadata::v0::DriftSkewInfo> drift_skew_infos_;
 
-  std::map<Path, tensorflow::metadata::v0::DriftSkewInfo> drift_skew_infos_;
+  // Anomalies found by incremental validation, keyed by serialized path. Their
+  // paths are distinct from the paths in anomalies_.
+  std::map<string, tensorflow::metadata::v0::AnomalyInfo> anomaly_infos_;
+  // The changes that fix anomaly_infos_, with the same keys.
+  std::map<string, SchemaChanges> schema_changes_;
+  // The enable_diff_regions with which anomaly_infos_ were created.
+  bool anomaly_infos_enable_diff_regions_ = false;
 
   // Dataset-level anomalies.
   absl::optional<DatasetSchemaAnomaly> dataset_anomalies_;
 
-  // The initial schema. Each SchemaAnomaly is initialized from this.
-  tensorflow::metadata::v0::Schema serialized_baseline_;
+  // The initial schema, indexed once for all lookups. Each SchemaAnomaly is an
+  // overlay on this.
+  std::shared_ptr<const IndexedSchema> serialized_baseline_;
+
+  // Where the anomalies are allocated, or null for the heap.
+  MonotonicArena* arena_ = nullptr;
+  // See set_profile().
+  ValidationProfile* profile_ = nullptr;
+  // See set_max_anomalies().
+  int max_anomalies_ = 0;
+  // See set_deadline().
+  const ValidationDeadline* deadline_ = nullptr;
+  // See unchecked_features().
+  std::vector<Path> unchecked_features_;
+  // The rank of the features checked first when there is a deadline: 0 for
+  // the needed ones, 1 for the required ones. The others are checked last.
+  std::map<Path, int> feature_priorities_;
+  // See set_feature_cost_tracker().
+  FeatureCostTracker* feature_cost_tracker_ = nullptr;
+  // The queue where large sets of children are split during a parallel
+  // traversal (see FindChangesInChildren(...)), or null.
+  TaskQueue* task_queue_ = nullptr;
+  // If true, the traversal stops at the first anomaly with severity ERROR, and
+  // partial_ is set.
+  bool stop_at_error_ = false;
+  // See partial().
+  bool partial_ = false;
+  // Counted even without a profile, as counting is cheaper than checking.
+  int64 num_features_visited_ = 0;
+  int64 num_schema_copies_ = 0;
 };
 
 }  // namespace data_validation
@@ -15,12 +15,17 @@ limitations under the License.
 
 #include "tensorflow_data_validation/anomalies/schema_anomalies.h"
 
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
 #include "tensorflow_data_validation/anomalies/feature_util.h"
+#include "tensorflow_data_validation/anomalies/monotonic_arena.h"
 #include "tensorflow_data_validation/anomalies/statistics_view_test_util.h"
 #include "tensorflow_data_validation/anomalies/test_util.h"
+#include "tensorflow_data_validation/anomalies/validation_deadline.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_metadata/proto/v0/anomalies.pb.h"
@@ -33,6 +38,7 @@ namespace {
 using ::tensorflow::metadata::v0::DatasetFeatureStatistics;
 using ::tensorflow::metadata::v0::FeatureNameStatistics;
 using ::tensorflow::metadata::v0::Schema;
+using testing::ExpectSameAnomalies;
 using testing::ParseTextProtoOrDie;
 
 void TestFindChanges(const Schema& schema, const DatasetStatsView& stats_view,
@@ -1734,6 +1740,12 @@ TEST(GetSchemaDiff, FindSelectedChanges) {
 
   TestAnomalies(result, initial, expected_anomalies);
 
+  // The out-param overload replaces whatever the message held before.
+  tensorflow::metadata::v0::Anomalies reused = result;
+  (*reused.mutable_anomaly_info())["stale"].set_description("stale");
+  anomalies.GetSchemaDiff(/*enable_diff_regions=*/false, &reused);
+  TestAnomalies(reused, initial, expected_anomalies);
+
   // Test that severity overrides affect severity in output anomalies.
   SchemaAnomalies anomalies_with_overrides(initial);
   TF_CHECK_OK(anomalies_with_overrides.FindChanges(
@@ -1751,6 +1763,142 @@ TEST(GetSchemaDiff, FindSelectedChanges) {
   TestAnomalies(result_with_overrides, initial, expected_anomalies);
 }
 
+// Only the needed features (struct.foo and new), their ancestors and their
+// descendants are checked.
+TEST(GetSchemaDiff, FindChangesOnlyInFeaturesNeeded) {
+  const Schema initial = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "struct"
+      type: STRUCT
+      value_count { max: 1 }
+      struct_domain {
+        feature {
+          name: "foo"
+          type: INT
+          value_count { max: 1 }
+          struct_domain { feature { name: "child" type: INT } }
+        }
+        feature {
+          name: "bar"
+          type: INT
+          value_count { max: 1 }
+        }
+        feature {
+          name: "missing"
+          type: INT
+          presence: { min_count: 1 }
+        }
+      }
+    }
+    feature {
+      name: "other"
+      type: INT
+      value_count { max: 1 }
+    }
+    feature {
+      name: "other_missing"
+      type: INT
+      presence: { min_count: 1 }
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          path { step: 'struct' }
+          type: STRUCT
+          struct_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        }
+        features: {
+          path { step: 'struct' step: 'foo' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        }
+        features: {
+          path { step: 'struct' step: 'foo' step: 'child' }
+          type: STRING
+          string_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        }
+        features: {
+          path { step: 'struct' step: 'bar' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        }
+        features: {
+          path { step: 'other' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        }
+        features: {
+          path { step: 'new' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })");
+  FeaturesNeeded features_needed;
+  features_needed[Path({"struct", "foo"})];
+  features_needed[Path({"new"})];
+  features_needed[Path({"not_in_data"})];
+  FeatureStatisticsToProtoConfig config;
+  config.set_only_validate_features_needed(true);
+  for (const int num_threads : {1, 2}) {
+    SchemaAnomalies anomalies(initial);
+    TF_ASSERT_OK(anomalies.FindChanges(DatasetStatsView(statistics),
+                                       features_needed, config, num_threads));
+    const tensorflow::metadata::v0::Anomalies result =
+        anomalies.GetSchemaDiff(/*enable_diff_regions=*/false);
+    std::vector<string> paths;
+    for (const auto& pair : result.anomaly_info()) {
+      paths.push_back(pair.first);
+    }
+    EXPECT_THAT(paths, ::testing::UnorderedElementsAre(
+                           "struct", "struct.foo", "struct.foo.child", "new"));
+  }
+  // Without only_validate_features_needed, all the features in the schema are
+  // checked.
+  SchemaAnomalies anomalies(initial);
+  TF_ASSERT_OK(anomalies.FindChanges(DatasetStatsView(statistics),
+                                     features_needed,
+                                     FeatureStatisticsToProtoConfig()));
+  EXPECT_EQ(anomalies.GetSchemaDiff(/*enable_diff_regions=*/false)
+                .anomaly_info_size(),
+            8);
+}
+
 TEST(GetSchemaDiff, ValidSparseFeature) {
   // Note: This schema is incomplete, as it does not fully define the index
   // and value features and we do not generate feature stats for them.
@@ -2588,6 +2736,917 @@ TEST(SchemaAnomalies, FindsMaxImageByteSizeExceeded) {
   }
 }
 
+TEST(SchemaAnomalies, FindChangesInParallel) {
+  const Schema initial = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "image/encoded"
+      presence: { min_count: 1 min_fraction: 1.0 }
+      value_count: { min: 1 max: 1 }
+      type: BYTES
+      image_domain: { max_image_byte_size: 100 }
+    }
+    feature {
+      name: "foo"
+      presence: { min_count: 1 min_fraction: 1.0 }
+      value_count: { min: 1 max: 1 }
+      type: INT
+    }
+    feature {
+      name: "missing"
+      presence: { min_count: 1 }
+      type: INT
+    })");
+
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'image/encoded'
+          type: BYTES
+          bytes_stats: {
+            max_num_bytes_int: 101
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        }
+        features: {
+          name: 'foo'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_missing: 3
+              num_non_missing: 7
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        }
+        features: {
+          name: 'bar'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })");
+  for (const auto& config : GetFeatureStatisticsToProtoConfigs()) {
+    const DatasetStatsView stats_view(statistics, /*by_weight=*/false);
+    SchemaAnomalies serial_anomalies(initial);
+    TF_ASSERT_OK(
+        serial_anomalies.FindChanges(stats_view, absl::nullopt, config));
+    SchemaAnomalies parallel_anomalies(initial);
+    TF_ASSERT_OK(parallel_anomalies.FindChanges(stats_view, absl::nullopt,
+                                                config, /*num_threads=*/4));
+    const tensorflow::metadata::v0::Anomalies serial_diff =
+        serial_anomalies.GetSchemaDiff(/*enable_diff_regions=*/false);
+    const tensorflow::metadata::v0::Anomalies parallel_diff =
+        parallel_anomalies.GetSchemaDiff(/*enable_diff_regions=*/false);
+    EXPECT_EQ(serial_diff.anomaly_info_size(), 4);
+    ExpectSameAnomalies(parallel_diff, serial_diff);
+  }
+}
+
+TEST(SchemaAnomalies, FindChangesInParallelLargeStruct) {
+  // A single root feature with many children, which are split into tasks.
+  Schema initial;
+  tensorflow::metadata::v0::Feature* parent = initial.add_feature();
+  parent->set_name("parent");
+  parent->set_type(tensorflow::metadata::v0::STRUCT);
+  DatasetFeatureStatistics statistics;
+  statistics.set_num_examples(10);
+  FeatureNameStatistics* parent_stats = statistics.add_features();
+  parent_stats->mutable_path()->add_step("parent");
+  parent_stats->set_type(FeatureNameStatistics::STRUCT);
+  parent_stats->mutable_struct_stats()
+      ->mutable_common_stats()
+      ->set_num_non_missing(10);
+  // Adds a child of parent (or of its child with the given name, if not
+  // empty) to the statistics with max_num_values values, and to the schema
+  // if in_schema, with at most one value.
+  const auto add_child = [&](const string& name, const string& struct_name,
+                             int max_num_values, bool in_schema) {
+    FeatureNameStatistics* child_stats = statistics.add_features();
+    *child_stats->mutable_path() = parent_stats->path();
+    if (!struct_name.empty()) {
+      child_stats->mutable_path()->add_step(struct_name);
+    }
+    child_stats->mutable_path()->add_step(name);
+    child_stats->set_type(FeatureNameStatistics::INT);
+    auto* common_stats =
+        child_stats->mutable_num_stats()->mutable_common_stats();
+    common_stats->set_num_non_missing(10);
+    common_stats->set_min_num_values(1);
+    common_stats->set_max_num_values(max_num_values);
+    if (in_schema) {
+      tensorflow::metadata::v0::StructDomain* struct_domain =
+          parent->mutable_struct_domain();
+      if (!struct_name.empty()) {
+        struct_domain = struct_domain->mutable_feature(
+                            struct_domain->feature_size() - 1)
+                            ->mutable_struct_domain();
+      }
+      tensorflow::metadata::v0::Feature* child = struct_domain->add_feature();
+      child->set_name(name);
+      child->set_type(tensorflow::metadata::v0::INT);
+      child->mutable_value_count()->set_max(1);
+    }
+  };
+  for (int i = 0; i < 200; ++i) {
+    add_child(absl::StrCat("child_", i), "", i % 3 == 0 ? 2 : 1, true);
+  }
+  add_child("new_child", "", 1, false);
+  // The descendants of a deprecated feature are not checked.
+  tensorflow::metadata::v0::Feature* deprecated =
+      parent->mutable_struct_domain()->add_feature();
+  deprecated->set_name("deprecated");
+  deprecated->set_type(tensorflow::metadata::v0::STRUCT);
+  deprecated->set_lifecycle_stage(tensorflow::metadata::v0::DEPRECATED);
+  FeatureNameStatistics* deprecated_stats = statistics.add_features();
+  *deprecated_stats->mutable_path() = parent_stats->path();
+  deprecated_stats->mutable_path()->add_step("deprecated");
+  deprecated_stats->set_type(FeatureNameStatistics::STRUCT);
+  deprecated_stats->mutable_struct_stats()
+      ->mutable_common_stats()
+      ->set_num_non_missing(10);
+  for (int i = 0; i < 100; ++i) {
+    add_child(absl::StrCat("child_", i), "deprecated", 2, true);
+  }
+
+  const DatasetStatsView stats_view(statistics, /*by_weight=*/false);
+  SchemaAnomalies serial_anomalies(initial);
+  TF_ASSERT_OK(serial_anomalies.FindChanges(stats_view, absl::nullopt,
+                                            FeatureStatisticsToProtoConfig()));
+  const tensorflow::metadata::v0::Anomalies serial_diff =
+      serial_anomalies.GetSchemaDiff(/*enable_diff_regions=*/false);
+  // The children with 2 values, and the new one.
+  EXPECT_EQ(serial_diff.anomaly_info_size(), 68);
+  for (const int num_threads : {2, 4}) {
+    SchemaAnomalies parallel_anomalies(initial);
+    TF_ASSERT_OK(parallel_anomalies.FindChanges(
+        stats_view, absl::nullopt, FeatureStatisticsToProtoConfig(),
+        num_threads));
+    const tensorflow::metadata::v0::Anomalies parallel_diff =
+        parallel_anomalies.GetSchemaDiff(/*enable_diff_regions=*/false);
+    ExpectSameAnomalies(parallel_diff, serial_diff);
+  }
+  // The anomalies are the same when allocated on an arena, which the tasks
+  // share.
+  MonotonicArena arena;
+  SchemaAnomalies arena_anomalies(
+      std::make_shared<const IndexedSchema>(initial), &arena);
+  TF_ASSERT_OK(arena_anomalies.FindChanges(stats_view, absl::nullopt,
+                                           FeatureStatisticsToProtoConfig(),
+                                           /*num_threads=*/4));
+  EXPECT_GT(arena.bytes_allocated(), 0);
+  const tensorflow::metadata::v0::Anomalies arena_diff =
+      arena_anomalies.GetSchemaDiff(/*enable_diff_regions=*/false);
+  ASSERT_EQ(arena_diff.anomaly_info_size(), serial_diff.anomaly_info_size());
+  for (const auto& pair : serial_diff.anomaly_info()) {
+    ASSERT_EQ(arena_diff.anomaly_info().count(pair.first), 1);
+    EXPECT_THAT(arena_diff.anomaly_info().at(pair.first),
+                testing::EqualsProto(pair.second));
+  }
+}
+
+// Counts the lookups in an InMemoryFeatureValidationCache. Not thread-safe.
+class CountingFeatureValidationCache : public InMemoryFeatureValidationCache {
+ public:
+  bool Get(uint64 fingerprint, FeatureValidationResult* result) override {
+    if (InMemoryFeatureValidationCache::Get(fingerprint, result)) {
+      ++hits;
+      return true;
+    }
+    ++misses;
+    return false;
+  }
+
+  int hits = 0;
+  int misses = 0;
+};
+
+TEST(SchemaAnomalies, FindChangesFailFast) {
+  const Schema initial = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      presence: { min_count: 1 min_fraction: 1.0 }
+      value_count: { min: 1 max: 1 }
+      type: INT
+    }
+    feature {
+      name: "missing"
+      presence: { min_count: 1 }
+      type: INT
+    })");
+  DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'foo'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        })");
+  FeatureStatisticsToProtoConfig config;
+  config.set_fail_fast(true);
+
+  // The missing features are checked first.
+  {
+    const DatasetStatsView stats_view(statistics, /*by_weight=*/false);
+    SchemaAnomalies anomalies(initial);
+    ValidationProfile profile;
+    anomalies.set_profile(&profile);
+    TF_ASSERT_OK(anomalies.FindChanges(stats_view, absl::nullopt, config));
+    EXPECT_TRUE(anomalies.partial());
+    EXPECT_TRUE(profile.partial());
+    EXPECT_EQ(profile.num_features_visited(), 0);
+    const tensorflow::metadata::v0::Anomalies diff =
+        anomalies.GetSchemaDiff(/*enable_diff_regions=*/false);
+    ASSERT_EQ(diff.anomaly_info_size(), 1);
+    EXPECT_EQ(diff.anomaly_info().count("missing"), 1);
+    EXPECT_TRUE(
+        anomalies.GetAnomaliesDelta(/*enable_diff_regions=*/false).partial());
+  }
+
+  // Warnings do not stop the validation, so the result is the same as without
+  // fail_fast.
+  statistics.mutable_features(0)
+      ->mutable_num_stats()
+      ->mutable_common_stats()
+      ->set_max_num_values(1);
+  tensorflow::data_validation::SeverityOverride* severity_override =
+      config.add_severity_overrides();
+  severity_override->set_type(
+      tensorflow::metadata::v0::AnomalyInfo::SCHEMA_MISSING_COLUMN);
+  severity_override->set_severity(
+      tensorflow::metadata::v0::AnomalyInfo::WARNING);
+  const DatasetStatsView stats_view(statistics, /*by_weight=*/false);
+  SchemaAnomalies anomalies(initial);
+  ValidationProfile profile;
+  anomalies.set_profile(&profile);
+  TF_ASSERT_OK(anomalies.FindChanges(stats_view, absl::nullopt, config));
+  EXPECT_FALSE(anomalies.partial());
+  // Without comparators, the features are only checked once.
+  EXPECT_EQ(profile.num_features_visited(), 1);
+  config.clear_fail_fast();
+  SchemaAnomalies expected(initial);
+  TF_ASSERT_OK(expected.FindChanges(stats_view, absl::nullopt, config));
+  EXPECT_THAT(anomalies.GetSchemaDiff(/*enable_diff_regions=*/false),
+              testing::EqualsProto(expected.GetSchemaDiff(
+                  /*enable_diff_regions=*/false)));
+}
+
+TEST(SchemaAnomalies, GetSchemaDiffWithMaxAnomalies) {
+  const Schema initial = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "c"
+      presence: { min_count: 1 }
+      type: INT
+    }
+    feature {
+      name: "b"
+      presence: { min_count: 1 }
+      type: INT
+    }
+    feature {
+      name: "a"
+      presence: { min_count: 1 }
+      type: INT
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'new'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })");
+  FeatureStatisticsToProtoConfig config;
+  tensorflow::data_validation::SeverityOverride* severity_override =
+      config.add_severity_overrides();
+  severity_override->set_type(
+      tensorflow::metadata::v0::AnomalyInfo::SCHEMA_NEW_COLUMN);
+  severity_override->set_severity(
+      tensorflow::metadata::v0::AnomalyInfo::WARNING);
+  const DatasetStatsView stats_view(statistics, /*by_weight=*/false);
+  SchemaAnomalies anomalies(initial);
+  TF_ASSERT_OK(anomalies.FindChanges(stats_view, absl::nullopt, config));
+  EXPECT_EQ(anomalies.GetSchemaDiff(/*enable_diff_regions=*/false)
+                .anomaly_info_size(),
+            4);
+
+  // The errors come before the warning, and then the paths are in order.
+  anomalies.set_max_anomalies(2);
+  const tensorflow::metadata::v0::Anomalies diff =
+      anomalies.GetSchemaDiff(/*enable_diff_regions=*/false);
+  ASSERT_EQ(diff.anomaly_info_size(), 2);
+  EXPECT_EQ(diff.anomaly_info().count("a"), 1);
+  EXPECT_EQ(diff.anomaly_info().count("b"), 1);
+  const std::map<string, int64> expected_num_dropped = {
+      {"SCHEMA_MISSING_COLUMN", 1}, {"SCHEMA_NEW_COLUMN", 1}};
+  EXPECT_EQ(anomalies.GetNumDroppedAnomalies(), expected_num_dropped);
+
+  const AnomaliesDelta delta =
+      anomalies.GetAnomaliesDelta(/*enable_diff_regions=*/false);
+  EXPECT_EQ(delta.anomalies().anomaly_info_size(), 2);
+  EXPECT_EQ(delta.schema_changes_size(), 2);
+  EXPECT_EQ(delta.num_dropped_anomalies_size(), 2);
+  EXPECT_EQ(delta.num_dropped_anomalies().at("SCHEMA_MISSING_COLUMN"), 1);
+  EXPECT_EQ(delta.num_dropped_anomalies().at("SCHEMA_NEW_COLUMN"), 1);
+}
+
+TEST(SchemaAnomalies, FindChangesWithDeadline) {
+  const Schema initial = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "optional"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    }
+    feature {
+      name: "required"
+      presence: { min_count: 1 }
+      value_count: { min: 1 max: 1 }
+      type: INT
+    }
+    feature {
+      name: "missing"
+      presence: { min_count: 1 }
+      type: INT
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          name: 'optional'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        }
+        features: {
+          name: 'required'
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        })");
+  const DatasetStatsView stats_view(statistics, /*by_weight=*/false);
+  const FeatureStatisticsToProtoConfig config;
+
+  // The missing features are still checked, and the required features come
+  // first in the unchecked features.
+  {
+    ValidationDeadline deadline;
+    deadline.Cancel();
+    SchemaAnomalies anomalies(initial);
+    ValidationProfile profile;
+    anomalies.set_profile(&profile);
+    anomalies.set_deadline(&deadline);
+    TF_ASSERT_OK(anomalies.FindChanges(stats_view, absl::nullopt, config));
+    EXPECT_TRUE(anomalies.partial());
+    EXPECT_EQ(anomalies.unchecked_features(),
+              std::vector<Path>({Path({"required"}), Path({"optional"})}));
+    EXPECT_TRUE(profile.partial());
+    EXPECT_EQ(profile.num_features_visited(), 0);
+    ASSERT_EQ(profile.unchecked_feature_size(), 2);
+    EXPECT_EQ(Path(profile.unchecked_feature(0)), Path({"required"}));
+    const tensorflow::metadata::v0::Anomalies diff =
+        anomalies.GetSchemaDiff(/*enable_diff_regions=*/false);
+    ASSERT_EQ(diff.anomaly_info_size(), 1);
+    EXPECT_EQ(diff.anomaly_info().count("missing"), 1);
+    const AnomaliesDelta delta =
+        anomalies.GetAnomaliesDelta(/*enable_diff_regions=*/false);
+    EXPECT_TRUE(delta.partial());
+    EXPECT_EQ(delta.unchecked_feature_size(), 2);
+  }
+
+  // A deadline that does not expire gives the same result as none.
+  const ValidationDeadline deadline;
+  SchemaAnomalies anomalies(initial);
+  anomalies.set_deadline(&deadline);
+  TF_ASSERT_OK(anomalies.FindChanges(stats_view, absl::nullopt, config));
+  EXPECT_FALSE(anomalies.partial());
+  EXPECT_TRUE(anomalies.unchecked_features().empty());
+  SchemaAnomalies expected(initial);
+  TF_ASSERT_OK(expected.FindChanges(stats_view, absl::nullopt, config));
+  // The anomalies are found in another order, so the serialized maps differ.
+  EXPECT_EQ(
+      anomalies.GetSchemaDiff(/*enable_diff_regions=*/false).DebugString(),
+      expected.GetSchemaDiff(/*enable_diff_regions=*/false).DebugString());
+}
+
+TEST(SchemaAnomalies, FindChangesWithCache) {
+  const Schema initial = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "struct"
+      type: STRUCT
+      struct_domain {
+        feature {
+          name: "foo"
+          value_count: { min: 1 max: 1 }
+          type: INT
+        }
+      }
+    }
+    feature {
+      name: "bar"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    }
+    feature {
+      name: "missing"
+      presence: { min_count: 1 }
+      type: INT
+    })");
+  DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          path: { step: 'struct' }
+          type: STRUCT
+          struct_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        }
+        features: {
+          path: { step: 'struct' step: 'foo' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        }
+        features: {
+          path: { step: 'bar' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        }
+        features: {
+          path: { step: 'new' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })");
+  const ::tensorflow::data_validation::Schema::Updater updater(
+      FeatureStatisticsToProtoConfig{});
+  const auto find_changes = [&](FeatureValidationCache* cache,
+                                tensorflow::metadata::v0::Anomalies* result) {
+    const DatasetStatsView stats_view(statistics, /*by_weight=*/false);
+    SchemaAnomalies anomalies(initial);
+    TF_RETURN_IF_ERROR(anomalies.FindChanges(
+        stats_view, absl::nullopt, updater, /*num_threads=*/1,
+        /*enable_diff_regions=*/false, cache));
+    *result = anomalies.GetSchemaDiff(/*enable_diff_regions=*/false);
+    return Status::OK();
+  };
+
+  CountingFeatureValidationCache cache;
+  tensorflow::metadata::v0::Anomalies expected;
+  TF_ASSERT_OK(find_changes(/*cache=*/nullptr, &expected));
+  // struct.foo, new and missing.
+  EXPECT_EQ(expected.anomaly_info_size(), 3);
+  tensorflow::metadata::v0::Anomalies actual;
+  TF_ASSERT_OK(find_changes(&cache, &actual));
+  EXPECT_EQ(cache.hits, 0);
+  EXPECT_EQ(cache.misses, 3);
+  ExpectSameAnomalies(actual, expected);
+
+  // Nothing changed, so the anomalies of all the root features are reused.
+  TF_ASSERT_OK(find_changes(&cache, &actual));
+  EXPECT_EQ(cache.hits, 3);
+  EXPECT_EQ(cache.misses, 3);
+  ExpectSameAnomalies(actual, expected);
+
+  // Only the statistics of bar changed, so only bar is checked again.
+  statistics.mutable_features(2)
+      ->mutable_num_stats()
+      ->mutable_common_stats()
+      ->set_max_num_values(3);
+  TF_ASSERT_OK(find_changes(/*cache=*/nullptr, &expected));
+  EXPECT_EQ(expected.anomaly_info_size(), 4);
+  TF_ASSERT_OK(find_changes(&cache, &actual));
+  EXPECT_EQ(cache.hits, 5);
+  EXPECT_EQ(cache.misses, 4);
+  ExpectSameAnomalies(actual, expected);
+}
+
+TEST(SchemaAnomalies, FindChangesWithCacheAcrossEnvironments) {
+  const Schema initial = ParseTextProtoOrDie<Schema>(R"(
+    default_environment: "TRAINING"
+    default_environment: "SERVING"
+    feature {
+      name: "foo"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    }
+    feature {
+      name: "label"
+      presence: { min_count: 1 }
+      not_in_environment: "SERVING"
+      type: INT
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          path: { step: 'foo' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        }
+        features: {
+          path: { step: 'label' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })");
+  const ::tensorflow::data_validation::Schema::Updater updater(
+      FeatureStatisticsToProtoConfig{});
+  const auto find_changes = [&](const absl::optional<string>& environment,
+                                FeatureValidationCache* cache,
+                                tensorflow::metadata::v0::Anomalies* result) {
+    const DatasetStatsView stats_view(statistics, /*by_weight=*/false,
+                                      environment, /*previous_span=*/nullptr,
+                                      /*serving=*/nullptr,
+                                      /*previous_version=*/nullptr);
+    SchemaAnomalies anomalies(initial);
+    TF_RETURN_IF_ERROR(anomalies.FindChanges(
+        stats_view, absl::nullopt, updater, /*num_threads=*/1,
+        /*enable_diff_regions=*/false, cache));
+    *result = anomalies.GetSchemaDiff(/*enable_diff_regions=*/false);
+    return Status::OK();
+  };
+
+  CountingFeatureValidationCache cache;
+  tensorflow::metadata::v0::Anomalies actual;
+  TF_ASSERT_OK(find_changes("TRAINING", &cache, &actual));
+  EXPECT_EQ(cache.misses, 2);
+  // foo is in all the environments, so its anomalies are reused, but label is
+  // not in SERVING, so it is checked again.
+  tensorflow::metadata::v0::Anomalies expected;
+  TF_ASSERT_OK(find_changes("SERVING", /*cache=*/nullptr, &expected));
+  // foo, and label, which is found in SERVING.
+  EXPECT_EQ(expected.anomaly_info_size(), 2);
+  TF_ASSERT_OK(find_changes("SERVING", &cache, &actual));
+  EXPECT_EQ(cache.hits, 1);
+  EXPECT_EQ(cache.misses, 3);
+  ExpectSameAnomalies(actual, expected);
+
+  // Without an environment, all the features are in the environment.
+  TF_ASSERT_OK(find_changes(absl::nullopt, /*cache=*/nullptr, &expected));
+  TF_ASSERT_OK(find_changes(absl::nullopt, &cache, &actual));
+  EXPECT_EQ(cache.hits, 3);
+  EXPECT_EQ(cache.misses, 3);
+  ExpectSameAnomalies(actual, expected);
+}
+
+// Collects the anomalies passed to an AnomaliesSink, with the order in which
+// they came. Not thread-safe, but the calls to a sink are never concurrent.
+class CollectingAnomaliesSink : public AnomaliesSink {
+ public:
+  Status OnAnomalyInfo(
+      const string& path,
+      const tensorflow::metadata::v0::AnomalyInfo& anomaly_info) override {
+    (*anomalies.mutable_anomaly_info())[path] = anomaly_info;
+    events.push_back(path);
+    return Status::OK();
+  }
+
+  Status OnDriftSkewInfo(const tensorflow::metadata::v0::DriftSkewInfo&
+                             drift_skew_info) override {
+    *anomalies.add_drift_skew_info() = drift_skew_info;
+    return Status::OK();
+  }
+
+  Status OnDatasetAnomalyInfo(
+      const tensorflow::metadata::v0::AnomalyInfo& anomaly_info) override {
+    *anomalies.mutable_dataset_anomaly_info() = anomaly_info;
+    events.push_back("dataset");
+    return Status::OK();
+  }
+
+  Status OnDataMissing() override {
+    anomalies.set_data_missing(true);
+    return Status::OK();
+  }
+
+  tensorflow::metadata::v0::Anomalies anomalies;
+  std::vector<string> events;
+};
+
+TEST(SchemaAnomalies, FindChangesWithSink) {
+  const Schema initial = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "bar"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    }
+    feature {
+      name: "missing"
+      presence: { min_count: 1 }
+      type: INT
+    }
+    dataset_constraints { min_examples_count: 100 })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          path: { step: 'bar' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        }
+        features: {
+          path: { step: 'new' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })");
+  const ::tensorflow::data_validation::Schema::Updater updater(
+      FeatureStatisticsToProtoConfig{});
+  const DatasetStatsView stats_view(statistics, /*by_weight=*/false);
+  SchemaAnomalies expected_anomalies(initial);
+  TF_ASSERT_OK(
+      expected_anomalies.FindChanges(stats_view, absl::nullopt, updater,
+                                     /*num_threads=*/1));
+  const tensorflow::metadata::v0::Anomalies expected =
+      expected_anomalies.GetSchemaDiff(/*enable_diff_regions=*/false);
+  EXPECT_EQ(expected.anomaly_info_size(), 3);
+  for (const int num_threads : {1, 2}) {
+    SchemaAnomalies anomalies(initial);
+    CollectingAnomaliesSink sink;
+    TF_ASSERT_OK(anomalies.FindChanges(stats_view, absl::nullopt, updater,
+                                       num_threads,
+                                       /*enable_diff_regions=*/false,
+                                       /*cache=*/nullptr, &sink));
+    *sink.anomalies.mutable_baseline() = initial;
+    sink.anomalies.set_anomaly_name_format(expected.anomaly_name_format());
+    ExpectSameAnomalies(sink.anomalies, expected);
+    EXPECT_THAT(sink.anomalies.dataset_anomaly_info(),
+                testing::EqualsProto(expected.dataset_anomaly_info()));
+    // The root features come first, then the missing features and the
+    // dataset.
+    EXPECT_THAT(sink.events,
+                ::testing::AnyOf(
+                    ::testing::ElementsAre("bar", "new", "missing", "dataset"),
+                    ::testing::ElementsAre("new", "bar", "missing",
+                                           "dataset")));
+    // Nothing is left for GetSchemaDiff().
+    EXPECT_EQ(anomalies.GetSchemaDiff(/*enable_diff_regions=*/false)
+                  .anomaly_info_size(),
+              0);
+  }
+}
+
+TEST(SchemaAnomalies, GetSchemaDiffWithDiffRegions) {
+  const Schema initial = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    }
+    feature {
+      name: "bar"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          path: { step: 'foo' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        }
+        features: {
+          path: { step: 'bar' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })");
+  SchemaAnomalies anomalies(initial);
+  TF_ASSERT_OK(anomalies.FindChanges(DatasetStatsView(statistics),
+                                     absl::nullopt,
+                                     FeatureStatisticsToProtoConfig()));
+  const tensorflow::metadata::v0::Anomalies result =
+      anomalies.GetSchemaDiff(/*enable_diff_regions=*/true);
+  ASSERT_EQ(result.anomaly_info_size(), 1);
+  // Only the changed line (and the lines around it) are shown, not bar.
+  EXPECT_THAT(result.anomaly_info().at("foo").diff_regions(),
+              ::testing::ElementsAre(testing::EqualsProto(R"(
+                                       hidden {
+                                         left_start: 1
+                                         left_end: 1
+                                         right_start: 1
+                                         right_end: 1
+                                       })"),
+                                     testing::EqualsProto(R"(
+                                       unchanged {
+                                         left_start: 2
+                                         left_end: 4
+                                         right_start: 2
+                                         right_end: 4
+                                         contents: "  name: \"foo\""
+                                         contents: "  value_count {"
+                                         contents: "    min: 1"
+                                       })"),
+                                     testing::EqualsProto(R"(
+                                       changed {
+                                         left_start: 5
+                                         left_end: 5
+                                         right_start: 5
+                                         right_end: 5
+                                         left_contents: "    max: 1"
+                                         right_contents: "    max: 2"
+                                       })"),
+                                     testing::EqualsProto(R"(
+                                       unchanged {
+                                         left_start: 6
+                                         left_end: 8
+                                         right_start: 6
+                                         right_end: 8
+                                         contents: "  }"
+                                         contents: "  type: INT"
+                                         contents: "}"
+                                       })"),
+                                     testing::EqualsProto(R"(
+                                       hidden {
+                                         left_start: 9
+                                         left_end: 16
+                                         right_start: 9
+                                         right_end: 16
+                                       })")));
+}
+TEST(SchemaAnomalies, GetAnomaliesDelta) {
+  const Schema initial = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    }
+    feature {
+      name: "bar"
+      value_count: { min: 1 max: 1 }
+      type: INT
+    })");
+  const DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        features: {
+          path: { step: 'foo' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 2
+            }
+          }
+        }
+        features: {
+          path: { step: 'bar' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        }
+        features: {
+          path: { step: 'new' }
+          type: INT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 10
+              min_num_values: 1
+              max_num_values: 1
+            }
+          }
+        })");
+  const ::tensorflow::data_validation::Schema::Updater updater(
+      FeatureStatisticsToProtoConfig{});
+  const DatasetStatsView stats_view(statistics, /*by_weight=*/false);
+  const auto get_delta = [&](FeatureValidationCache* cache,
+                             AnomaliesDelta* result) {
+    SchemaAnomalies anomalies(initial);
+    TF_RETURN_IF_ERROR(anomalies.FindChanges(
+        stats_view, absl::nullopt, updater, /*num_threads=*/1,
+        /*enable_diff_regions=*/false, cache));
+    *result = anomalies.GetAnomaliesDelta(/*enable_diff_regions=*/false);
+    return Status::OK();
+  };
+
+  SchemaAnomalies anomalies(initial);
+  TF_ASSERT_OK(anomalies.FindChanges(stats_view, absl::nullopt, updater,
+                                     /*num_threads=*/1));
+  tensorflow::metadata::v0::Anomalies expected =
+      anomalies.GetSchemaDiff(/*enable_diff_regions=*/false);
+  expected.clear_baseline();
+  ASSERT_EQ(expected.anomaly_info_size(), 2);
+
+  AnomaliesDelta delta;
+  TF_ASSERT_OK(get_delta(/*cache=*/nullptr, &delta));
+  ExpectSameAnomalies(delta.anomalies(), expected);
+  EXPECT_EQ(delta.baseline_fingerprint(), IndexedSchema(initial).fingerprint());
+  // bar is not changed, so only foo and new are.
+  ASSERT_EQ(delta.schema_changes_size(), 2);
+  const SchemaChanges& foo_changes = delta.schema_changes().at("foo");
+  ASSERT_EQ(foo_changes.feature_size(), 1);
+  EXPECT_EQ(foo_changes.feature(0).name(), "foo");
+  EXPECT_EQ(foo_changes.feature(0).value_count().max(), 2);
+  const SchemaChanges& new_changes = delta.schema_changes().at("new");
+  ASSERT_EQ(new_changes.feature_size(), 1);
+  EXPECT_EQ(new_changes.feature(0).name(), "new");
+
+  // The changes are also kept by incremental validation.
+  InMemoryFeatureValidationCache cache;
+  for (int i = 0; i < 2; ++i) {
+    AnomaliesDelta cached_delta;
+    TF_ASSERT_OK(get_delta(&cache, &cached_delta));
+    ExpectSameAnomalies(cached_delta.anomalies(), expected);
+    ASSERT_EQ(cached_delta.schema_changes_size(), 2);
+    for (const auto& pair : delta.schema_changes()) {
+      EXPECT_THAT(cached_delta.schema_changes().at(pair.first),
+                  testing::EqualsProto(pair.second));
+    }
+  }
+}
+
 }  // namespace
 
 }  // namespace data_validation
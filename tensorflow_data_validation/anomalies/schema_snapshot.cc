@@ -0,0 +1,88 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/schema_snapshot.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "tensorflow_data_validation/anomalies/schema.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+namespace {
+
+// Starts every snapshot, followed by the deterministic serialization of the
+// schema. Changing the format of snapshots requires changing the version.
+constexpr char kSchemaSnapshotMagic[] = "TFDV-SCHEMA-SNAPSHOT-1\n";
+
+}  // namespace
+
+Status WriteSchemaSnapshot(const tensorflow::metadata::v0::Schema& schema,
+                           const string& path) {
+  string contents = kSchemaSnapshotMagic;
+  string serialized;
+  if (!SerializeToStringDeterministic(schema, &serialized)) {
+    return errors::Internal("Failed to serialize the schema.");
+  }
+  contents.append(serialized);
+  Env* env = Env::Default();
+  string temp_path = path;
+  if (!env->CreateUniqueFileName(&temp_path, ".tmp")) {
+    return errors::Internal("Could not create a temporary file name for ",
+                            path);
+  }
+  Status status = WriteStringToFile(env, temp_path, contents);
+  if (status.ok()) {
+    status = env->RenameFile(temp_path, path);
+  }
+  if (!status.ok()) {
+    env->DeleteFile(temp_path).IgnoreError();
+  }
+  return status;
+}
+
+Status ReadSchemaSnapshot(const string& path,
+                          std::shared_ptr<const IndexedSchema>* result) {
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_RETURN_IF_ERROR(
+      Env::Default()->NewReadOnlyMemoryRegionFromFile(path, &region));
+  absl::string_view contents(static_cast<const char*>(region->data()),
+                             region->length());
+  if (!absl::ConsumePrefix(&contents, kSchemaSnapshotMagic)) {
+    return errors::InvalidArgument(path, " is not a schema snapshot.");
+  }
+  tensorflow::metadata::v0::Schema schema;
+  if (!schema.ParseFromArray(contents.data(), contents.size())) {
+    return errors::InvalidArgument("Failed to parse the schema snapshot ",
+                                   path);
+  }
+  *result =
+      std::make_shared<const IndexedSchema>(schema, Fingerprint64(contents));
+  return Status::OK();
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
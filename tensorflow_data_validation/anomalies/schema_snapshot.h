@@ -0,0 +1,49 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_SCHEMA_SNAPSHOT_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_SCHEMA_SNAPSHOT_H_
+
+#include <memory>
+#include <string>
+
+#include "tensorflow_data_validation/anomalies/schema.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// A schema snapshot is a file holding a schema that a validator can be created
+// from quickly (see Validator::CreateFromSchemaSnapshot()): the file is mapped
+// in memory (so the processes reading it share it through the page cache), and
+// the schema is parsed directly from the mapping. As the schema is stored with
+// a deterministic serialization, its fingerprint is that of the stored bytes,
+// and need not be computed by serializing the schema again.
+
+// Writes a snapshot of schema to path. The snapshot is written to a temporary
+// file first, so that readers never see a partial snapshot.
+Status WriteSchemaSnapshot(const tensorflow::metadata::v0::Schema& schema,
+                           const string& path);
+
+// Reads the snapshot at path, and indexes its schema.
+Status ReadSchemaSnapshot(const string& path,
+                          std::shared_ptr<const IndexedSchema>* result);
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_SCHEMA_SNAPSHOT_H_
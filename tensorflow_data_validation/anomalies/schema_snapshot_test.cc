@@ -0,0 +1,77 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/schema_snapshot.h"
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "tensorflow_data_validation/anomalies/schema.h"
+#include "tensorflow_data_validation/anomalies/test_util.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::Schema;
+using testing::EqualsProto;
+using testing::ParseTextProtoOrDie;
+
+TEST(SchemaSnapshotTest, WriteAndRead) {
+  const Schema schema = ParseTextProtoOrDie<Schema>(R"(
+    feature {
+      name: "foo"
+      type: BYTES
+      domain: "foo_domain"
+      presence: { min_count: 1 }
+    }
+    feature { name: "bar" type: INT }
+    string_domain { name: "foo_domain" value: "a" value: "b" })");
+  const string path = io::JoinPath(::tensorflow::testing::TmpDir(),
+                                   "schema_snapshot_write_and_read");
+  TF_ASSERT_OK(WriteSchemaSnapshot(schema, path));
+  std::shared_ptr<const IndexedSchema> indexed_schema;
+  TF_ASSERT_OK(ReadSchemaSnapshot(path, &indexed_schema));
+  EXPECT_THAT(indexed_schema->schema(), EqualsProto(schema));
+  EXPECT_NE(indexed_schema->GetFeature(Path({"foo"})), nullptr);
+  // The fingerprint read with the snapshot is the one computed from the
+  // schema.
+  EXPECT_EQ(indexed_schema->fingerprint(), IndexedSchema(schema).fingerprint());
+}
+
+TEST(SchemaSnapshotTest, ReadNotASnapshot) {
+  const string path = io::JoinPath(::tensorflow::testing::TmpDir(),
+                                   "schema_snapshot_not_a_snapshot");
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), path,
+                                 Schema().SerializeAsString() + "garbage"));
+  std::shared_ptr<const IndexedSchema> indexed_schema;
+  EXPECT_TRUE(errors::IsInvalidArgument(
+      ReadSchemaSnapshot(path, &indexed_schema)));
+  EXPECT_FALSE(ReadSchemaSnapshot(io::JoinPath(::tensorflow::testing::TmpDir(),
+                                               "schema_snapshot_missing"),
+                                  &indexed_schema)
+                   .ok());
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -15,11 +15,13 @@ limitations under the License.
 
 #include "tensorflow_data_validation/anomalies/schema.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
 #include "tensorflow_data_validation/anomalies/feature_util.h"
 #include "tensorflow_data_validation/anomalies/proto/validation_config.pb.h"
 #include "tensorflow_data_validation/anomalies/statistics_view_test_util.h"
@@ -246,6 +248,289 @@ TEST(SchemaTest, EmbeddedStringDomainTooLarge) {
                 })"));
 }
 
+// An overlay behaves like a copy of its baseline, even for the parts of the
+// baseline that it never copies.
+TEST(SchemaTest, OverlayStringDomainTooLarge) {
+  const auto initial = std::make_shared<const IndexedSchema>(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"(
+        string_domain {
+          name: "MyAloneEnum"
+          value: "4"
+          value: "5"
+          value: "6"
+          value: "ALONE_BUT_NORMAL"
+        }
+        string_domain { name: "OtherEnum" value: "a" }
+        feature {
+          name: "annotated_enum"
+          value_count: { min: 1 max: 1 }
+          type: BYTES
+          domain: "MyAloneEnum"
+        }
+        feature {
+          name: "other_enum"
+          value_count: { min: 1 max: 1 }
+          type: BYTES
+          domain: "MyAloneEnum"
+        }
+        feature {
+          name: "untouched"
+          type: BYTES
+          domain: "OtherEnum"
+        })"));
+
+  Schema schema;
+  TF_ASSERT_OK(schema.InitOverlay(initial));
+  FeatureStatisticsToProtoConfig config;
+  config.set_enum_threshold(4);
+  config.set_enum_delete_threshold(4);
+  const DatasetFeatureStatistics stats =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(
+          R"(
+            num_examples: 10
+            features {
+              name: 'annotated_enum'
+              type: STRING
+              string_stats: {
+                common_stats: {
+                  num_missing: 0
+                  num_non_missing: 10
+                  min_num_values: 1
+                  max_num_values: 1
+                }
+                rank_histogram {
+                  buckets { label: "a" sample_count: 1 }
+                  buckets { label: "b" sample_count: 2 }
+                  buckets { label: "c" sample_count: 7 }
+                }
+              }
+            })");
+  TF_ASSERT_OK(schema.Update(DatasetStatsView(stats), config,
+                             {Path({"annotated_enum"})}));
+  EXPECT_THAT(schema.GetSchema(), EqualsProto(R"(
+                string_domain { name: "OtherEnum" value: "a" }
+                feature {
+                  name: "annotated_enum"
+                  value_count: { min: 1 max: 1 }
+                  type: BYTES
+                }
+                feature {
+                  name: "other_enum"
+                  value_count: { min: 1 max: 1 }
+                  type: BYTES
+                }
+                feature {
+                  name: "untouched"
+                  type: BYTES
+                  domain: "OtherEnum"
+                })"));
+  // The baseline itself is never modified.
+  EXPECT_EQ(initial->schema().string_domain_size(), 2);
+  EXPECT_EQ(initial->schema().feature(0).domain(), "MyAloneEnum");
+}
+
+TEST(SchemaTest, OverlayCreateColumn) {
+  const auto initial = std::make_shared<const IndexedSchema>(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"(
+        string_domain { name: "new_enum" value: "a" }
+        feature { name: "existing" type: INT }
+        dataset_constraints { min_examples_count: 5 })"));
+  const DatasetFeatureStatistics stats =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(
+          R"(
+            num_examples: 10
+            features {
+              name: 'new_enum'
+              type: STRING
+              string_stats: {
+                common_stats: {
+                  num_missing: 0
+                  num_non_missing: 10
+                  min_num_values: 1
+                  max_num_values: 1
+                }
+                unique: 2
+                rank_histogram {
+                  buckets { label: "a" sample_count: 3 }
+                  buckets { label: "b" sample_count: 7 }
+                }
+              }
+            })");
+
+  FeatureStatisticsToProtoConfig config;
+  config.set_enum_threshold(400);
+
+  Schema full;
+  TF_ASSERT_OK(full.Init(initial->schema()));
+  TF_ASSERT_OK(full.Update(DatasetStatsView(stats), config));
+
+  Schema overlay;
+  TF_ASSERT_OK(overlay.InitOverlay(initial));
+  TF_ASSERT_OK(overlay.Update(DatasetStatsView(stats), config));
+  const tensorflow::metadata::v0::Schema actual = overlay.GetSchema();
+  EXPECT_THAT(actual, EqualsProto(full.GetSchema()));
+  // The new string domain does not reuse the name of the baseline's one.
+  ASSERT_EQ(actual.string_domain_size(), 2);
+  EXPECT_EQ(actual.string_domain(1).name(), "new_enum2");
+  EXPECT_TRUE(overlay.FeatureExists(Path({"existing"})));
+  EXPECT_FALSE(overlay.IsEmpty());
+}
+
+// Gets the lines of the text of the right schema from diff regions in which
+// all the unchanged lines are shown.
+std::vector<string> GetRightLines(
+    const std::vector<tensorflow::metadata::v0::DiffRegion>& regions) {
+  std::vector<string> lines;
+  for (const tensorflow::metadata::v0::DiffRegion& region : regions) {
+    EXPECT_FALSE(region.has_hidden());
+    const auto& contents =
+        region.has_unchanged()
+            ? region.unchanged().contents()
+            : region.has_changed() ? region.changed().right_contents()
+                                   : region.added().contents();
+    lines.insert(lines.end(), contents.begin(), contents.end());
+  }
+  return lines;
+}
+
+std::vector<string> GetLines(const tensorflow::metadata::v0::Schema& schema) {
+  const SchemaText text(schema);
+  return std::vector<string>(text.lines.begin(), text.lines.end());
+}
+
+TEST(SchemaTest, GetDiffRegions) {
+  const auto initial = std::make_shared<const IndexedSchema>(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"(
+        string_domain { name: "new_enum" value: "a" }
+        feature {
+          name: "existing"
+          value_count: { min: 1 max: 1 }
+          type: INT
+        }
+        feature { name: "untouched" type: INT }
+        dataset_constraints { min_examples_count: 20 })"));
+  const DatasetFeatureStatistics stats =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(
+          R"(
+            num_examples: 10
+            features {
+              name: 'existing'
+              type: INT
+              num_stats: {
+                common_stats: {
+                  num_non_missing: 10
+                  min_num_values: 1
+                  max_num_values: 2
+                }
+              }
+            }
+            features {
+              name: 'new_enum'
+              type: STRING
+              string_stats: {
+                common_stats: {
+                  num_missing: 0
+                  num_non_missing: 10
+                  min_num_values: 1
+                  max_num_values: 1
+                }
+                unique: 2
+                rank_histogram {
+                  buckets { label: "a" sample_count: 3 }
+                  buckets { label: "b" sample_count: 7 }
+                }
+              }
+            })");
+  FeatureStatisticsToProtoConfig config;
+  config.set_enum_threshold(400);
+
+  Schema overlay;
+  TF_ASSERT_OK(overlay.InitOverlay(initial));
+  TF_ASSERT_OK(overlay.Update(DatasetStatsView(stats), config));
+  EXPECT_FALSE(overlay.UpdateDatasetConstraints(DatasetStatsView(stats))
+                   .empty());
+  // The overlay changes existing, adds new_enum and new_enum2, and changes the
+  // dataset constraints.
+  const SchemaChanges changes = overlay.GetChanges();
+  EXPECT_EQ(changes.feature_size(), 2);
+  EXPECT_EQ(changes.string_domain_size(), 1);
+  EXPECT_TRUE(changes.has_dataset_constraints());
+
+  EXPECT_EQ(GetRightLines(overlay.GetDiffRegions(initial->schema(),
+                                                 /*context_lines=*/-1)),
+            GetLines(overlay.GetSchema()));
+  const std::vector<tensorflow::metadata::v0::DiffRegion> regions =
+      overlay.GetDiffRegions(initial->schema(), /*context_lines=*/0);
+  ASSERT_FALSE(regions.empty());
+  for (const tensorflow::metadata::v0::DiffRegion& region : regions) {
+    EXPECT_FALSE(region.has_unchanged());
+  }
+  // The lines of untouched are hidden.
+  const auto is_hidden_feature =
+      [](const tensorflow::metadata::v0::DiffRegion& region) {
+        return region.has_hidden() &&
+               region.hidden().left_end() >= region.hidden().left_start() + 3;
+      };
+  EXPECT_TRUE(std::any_of(regions.begin(), regions.end(), is_hidden_feature));
+
+  // The same diff without an overlay.
+  Schema full;
+  TF_ASSERT_OK(full.Init(initial->schema()));
+  TF_ASSERT_OK(full.Update(DatasetStatsView(stats), config));
+  full.UpdateDatasetConstraints(DatasetStatsView(stats));
+  EXPECT_EQ(GetRightLines(full.GetDiffRegions(initial->schema(),
+                                              /*context_lines=*/-1)),
+            GetLines(overlay.GetSchema()));
+}
+
+TEST(SchemaTest, GetDiffRegionsWithClearedStringDomain) {
+  const auto initial = std::make_shared<const IndexedSchema>(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"(
+        string_domain { name: "MyEnum" value: "4" value: "5" }
+        feature {
+          name: "annotated_enum"
+          value_count: { min: 1 max: 1 }
+          type: BYTES
+          domain: "MyEnum"
+        }
+        feature { name: "other_enum" type: BYTES domain: "MyEnum" })"));
+  const DatasetFeatureStatistics stats =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(
+          R"(
+            num_examples: 10
+            features {
+              name: 'annotated_enum'
+              type: STRING
+              string_stats: {
+                common_stats: {
+                  num_missing: 0
+                  num_non_missing: 10
+                  min_num_values: 1
+                  max_num_values: 1
+                }
+                unique: 5
+                rank_histogram {
+                  buckets { label: "a" sample_count: 1 }
+                  buckets { label: "b" sample_count: 1 }
+                  buckets { label: "c" sample_count: 1 }
+                  buckets { label: "d" sample_count: 1 }
+                  buckets { label: "e" sample_count: 6 }
+                }
+              }
+            })");
+  FeatureStatisticsToProtoConfig config;
+  config.set_enum_threshold(4);
+  config.set_enum_delete_threshold(4);
+
+  Schema overlay;
+  TF_ASSERT_OK(overlay.InitOverlay(initial));
+  TF_ASSERT_OK(overlay.Update(DatasetStatsView(stats), config));
+  EXPECT_EQ(overlay.GetChanges().removed_string_domain_size(), 1);
+  EXPECT_EQ(GetRightLines(overlay.GetDiffRegions(initial->schema(),
+                                                 /*context_lines=*/-1)),
+            GetLines(overlay.GetSchema()));
+}
+
 // Test that initializing from a schema proto, then exporting a schema proto,
 // does not change the schema proto. See
 // CreateFromProtoWithEmbeddedStringDomain for when this doesn't work.
@@ -1229,6 +1514,306 @@ TEST(SchemaTest, FeatureExists) {
   EXPECT_FALSE(schema.FeatureExists(Path({"##SEQUENCE##", "no_such_field"})));
 }
 
+TEST(IndexedSchemaTest, UsedControlStatistics) {
+  const IndexedSchema no_comparators(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"pb(
+        feature { name: "foo" }
+        dataset_constraints { min_examples_count: 1 })pb"));
+  EXPECT_FALSE(no_comparators.UsesPreviousSpan());
+  EXPECT_FALSE(no_comparators.UsesServing());
+  EXPECT_FALSE(no_comparators.UsesPreviousVersion());
+  EXPECT_TRUE(no_comparators.skew_comparator_paths().empty());
+
+  const IndexedSchema feature_comparators(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"pb(
+        feature {
+          name: "struct"
+          type: STRUCT
+          struct_domain {
+            feature: {
+              name: "foo"
+              skew_comparator { infinity_norm { threshold: 0.1 } }
+            }
+          }
+        }
+        # Only the first feature with a given name is used.
+        feature {
+          name: "struct"
+          drift_comparator { infinity_norm { threshold: 0.1 } }
+        })pb"));
+  EXPECT_FALSE(feature_comparators.UsesPreviousSpan());
+  EXPECT_TRUE(feature_comparators.UsesServing());
+  EXPECT_FALSE(feature_comparators.UsesPreviousVersion());
+  EXPECT_THAT(feature_comparators.skew_comparator_paths(),
+              ::testing::ElementsAre(Path({"struct", "foo"})));
+
+  const IndexedSchema dataset_comparators(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"pb(
+        dataset_constraints {
+          num_examples_drift_comparator { min_fraction_threshold: 0.5 }
+          num_examples_version_comparator { min_fraction_threshold: 0.5 }
+        })pb"));
+  EXPECT_TRUE(dataset_comparators.UsesPreviousSpan());
+  EXPECT_FALSE(dataset_comparators.UsesServing());
+  EXPECT_TRUE(dataset_comparators.UsesPreviousVersion());
+}
+
+TEST(IndexedSchemaTest, Lookups) {
+  const IndexedSchema indexed(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"pb(
+        feature {
+          name: "struct"
+          type: STRUCT
+          struct_domain {
+            feature: { name: "foo" lifecycle_stage: DEPRECATED }
+            feature: { name: "foo" }
+            sparse_feature: { name: "deep_sparse" }
+          }
+        }
+        feature { name: "struct" type: STRUCT }
+        sparse_feature: { name: "shallow_sparse" lifecycle_stage: DEPRECATED }
+        weighted_feature: { name: "weighted" }
+        string_domain: { name: "domain" value: "a" })pb"));
+
+  EXPECT_TRUE(indexed.FeatureExists(Path({"struct"})));
+  EXPECT_TRUE(indexed.FeatureExists(Path({"struct", "foo"})));
+  EXPECT_TRUE(indexed.FeatureExists(Path({"struct", "deep_sparse"})));
+  EXPECT_TRUE(indexed.FeatureExists(Path({"shallow_sparse"})));
+  EXPECT_TRUE(indexed.FeatureExists(Path({"weighted"})));
+  EXPECT_FALSE(indexed.FeatureExists(Path({"no_such_field"})));
+  EXPECT_FALSE(indexed.FeatureExists(Path({"struct", "no_such_field"})));
+  // Like Schema, only the first feature with a given name is found.
+  EXPECT_EQ(indexed.GetFeature(Path({"struct"})),
+            &indexed.schema().feature(0));
+  EXPECT_TRUE(indexed.FeatureIsDeprecated(Path({"struct", "foo"})));
+  EXPECT_TRUE(indexed.FeatureIsDeprecated(Path({"shallow_sparse"})));
+  EXPECT_FALSE(indexed.FeatureIsDeprecated(Path({"struct"})));
+  EXPECT_EQ(indexed.GetWeightedFeature(Path({"struct", "weighted"})),
+            nullptr);
+  ASSERT_NE(indexed.GetStringDomain("domain"), nullptr);
+  EXPECT_EQ(indexed.GetStringDomain("domain")->value(0), "a");
+  EXPECT_EQ(indexed.GetStringDomain("no_such_domain"), nullptr);
+}
+
+TEST(IndexedSchemaTest, StringDomainValues) {
+  const IndexedSchema indexed(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"pb(
+        string_domain { name: "domain" value: "a" value: "b" }
+        # Only the first string domain with a given name is used.
+        string_domain { name: "domain" value: "c" })pb"));
+  const StringDomainValueSet* values = indexed.GetStringDomainValues("domain");
+  ASSERT_NE(values, nullptr);
+  EXPECT_EQ(values->size(), 2);
+  EXPECT_TRUE(values->contains("a"));
+  EXPECT_TRUE(values->contains("b"));
+  EXPECT_FALSE(values->contains("c"));
+  // The values are only built once.
+  EXPECT_EQ(indexed.GetStringDomainValues("domain"), values);
+  EXPECT_EQ(indexed.GetStringDomainValues("no_such_domain"), nullptr);
+}
+
+TEST(IndexedSchemaTest, FeatureStringDomainValues) {
+  const IndexedSchema indexed(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"pb(
+        string_domain { name: "domain" value: "a" value: "b" }
+        feature { name: "shared" domain: "domain" }
+        feature { name: "inline" string_domain { value: "b" value: "c" } }
+        feature { name: "missing_domain" domain: "no_such_domain" }
+        feature { name: "int" int_domain { min: 0 } })pb"));
+  const StringDomainValueSet* shared =
+      indexed.GetFeatureStringDomainValues(Path({"shared"}));
+  EXPECT_EQ(shared, indexed.GetStringDomainValues("domain"));
+  const StringDomainValueSet* inline_values =
+      indexed.GetFeatureStringDomainValues(Path({"inline"}));
+  ASSERT_NE(inline_values, nullptr);
+  EXPECT_EQ(inline_values->size(), 2);
+  EXPECT_TRUE(inline_values->contains("c"));
+  EXPECT_FALSE(inline_values->contains("a"));
+  // The value in both domains is interned once.
+  ASSERT_NE(shared, nullptr);
+  EXPECT_EQ(shared->ids()[1], inline_values->ids()[0]);
+  EXPECT_EQ(indexed.GetFeatureStringDomainValues(Path({"missing_domain"})),
+            nullptr);
+  EXPECT_EQ(indexed.GetFeatureStringDomainValues(Path({"int"})), nullptr);
+  EXPECT_EQ(indexed.GetFeatureStringDomainValues(Path({"no_such_feature"})),
+            nullptr);
+}
+
+TEST(IndexedSchemaTest, Environments) {
+  const IndexedSchema indexed(
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"pb(
+        default_environment: "TRAINING"
+        feature { name: "default" presence: { min_count: 1 } }
+        feature {
+          name: "serving_only"
+          presence: { min_count: 1 }
+          in_environment: "SERVING"
+          not_in_environment: "TRAINING"
+        }
+        feature {
+          name: "optional"
+          in_environment: "SERVING"
+        })pb"));
+  const int no_environment = indexed.GetEnvironmentId(absl::nullopt);
+  const int training = indexed.GetEnvironmentId(string("TRAINING"));
+  const int serving = indexed.GetEnvironmentId(string("SERVING"));
+  const int other = indexed.GetEnvironmentId(string("OTHER"));
+  EXPECT_EQ(other, indexed.GetEnvironmentId(string("ANOTHER")));
+
+  // Features 0 and 1 may be required.
+  ASSERT_EQ(indexed.required_features().size(), 2);
+  EXPECT_EQ(indexed.required_features()[1].path, Path({"serving_only"}));
+  EXPECT_EQ(indexed.required_features()[1].id, 1);
+  EXPECT_TRUE(indexed.FeatureIdIsRequired(0, no_environment));
+  EXPECT_TRUE(indexed.FeatureIdIsRequired(1, no_environment));
+  EXPECT_TRUE(indexed.FeatureIdIsRequired(0, training));
+  EXPECT_FALSE(indexed.FeatureIdIsRequired(1, training));
+  EXPECT_FALSE(indexed.FeatureIdIsRequired(0, serving));
+  EXPECT_TRUE(indexed.FeatureIdIsRequired(1, serving));
+  EXPECT_FALSE(indexed.FeatureIdIsRequired(0, other));
+  EXPECT_FALSE(indexed.FeatureIdIsRequired(1, other));
+  // Feature 2 is in an environment, but never required.
+  EXPECT_TRUE(indexed.FeatureIdIsInEnvironment(2, serving));
+  EXPECT_FALSE(indexed.FeatureIdIsRequired(2, serving));
+  // in_environment adds to the default environments.
+  EXPECT_TRUE(indexed.FeatureIdIsInEnvironment(2, training));
+  EXPECT_FALSE(indexed.FeatureIdIsInEnvironment(2, other));
+
+  EXPECT_TRUE(indexed.FeatureIsInEnvironment(Path({"optional"}),
+                                             string("SERVING")));
+  EXPECT_FALSE(indexed.FeatureIsInEnvironment(Path({"optional"}),
+                                              string("OTHER")));
+  EXPECT_TRUE(indexed.FeatureIsInEnvironment(Path({"optional"}),
+                                             absl::nullopt));
+  // Features that are not in the schema are in every environment.
+  EXPECT_TRUE(indexed.FeatureIsInEnvironment(Path({"no_such_feature"}),
+                                             string("OTHER")));
+}
+
+// A string domain of the baseline is checked without being copied, and only
+// copied into the overlay by the features that change it.
+TEST(SchemaTest, OverlaySharedStringDomain) {
+  const tensorflow::metadata::v0::Schema schema_proto =
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"(
+        string_domain { name: "MyEnum" value: "a" value: "b" }
+        feature {
+          name: "in_domain"
+          value_count: { min: 1 max: 1 }
+          type: BYTES
+          domain: "MyEnum"
+        }
+        feature {
+          name: "off_domain"
+          value_count: { min: 1 max: 1 }
+          type: BYTES
+          domain: "MyEnum"
+        })");
+  const auto get_statistics = [](const string& name, const string& value) {
+    return ParseTextProtoOrDie<DatasetFeatureStatistics>(absl::StrCat(
+        "num_examples: 10 features { name: '", name,
+        "' type: STRING string_stats { common_stats { num_non_missing: 10 "
+        "min_num_values: 1 max_num_values: 1 } rank_histogram { buckets { "
+        "label: '",
+        value, "' sample_count: 10 } } } }"));
+  };
+  const auto initial = std::make_shared<const IndexedSchema>(schema_proto);
+  FeatureStatisticsToProtoConfig config;
+  config.set_enum_threshold(400);
+
+  Schema in_domain;
+  TF_ASSERT_OK(in_domain.InitOverlay(initial));
+  TF_ASSERT_OK(in_domain.Update(
+      DatasetStatsView(get_statistics("in_domain", "a")), config,
+      {Path({"in_domain"})}));
+  EXPECT_THAT(in_domain.GetSchema(), EqualsProto(schema_proto));
+
+  Schema off_domain;
+  TF_ASSERT_OK(off_domain.InitOverlay(initial));
+  const DatasetFeatureStatistics off_domain_statistics =
+      get_statistics("off_domain", "c");
+  TF_ASSERT_OK(off_domain.Update(DatasetStatsView(off_domain_statistics),
+                                 config, {Path({"off_domain"})}));
+  // The same as updating a copy of the baseline.
+  Schema copy;
+  TF_ASSERT_OK(copy.Init(schema_proto));
+  TF_ASSERT_OK(copy.Update(DatasetStatsView(off_domain_statistics), config,
+                           {Path({"off_domain"})}));
+  EXPECT_THAT(off_domain.GetSchema(), EqualsProto(copy.GetSchema()));
+  EXPECT_EQ(off_domain.GetSchema().string_domain(0).value_size(), 3);
+  // The baseline itself is never modified.
+  EXPECT_EQ(initial->schema().string_domain(0).value_size(), 2);
+}
+
+// Gets the statistics of a string feature with the values
+// (first, first + 1, ..., first + num_values - 1).
+FeatureNameStatistics GetStringFeatureStatistics(const string& name,
+                                                 int first, int num_values) {
+  FeatureNameStatistics result;
+  result.set_name(name);
+  result.set_type(FeatureNameStatistics::STRING);
+  auto* string_stats = result.mutable_string_stats();
+  string_stats->mutable_common_stats()->set_num_non_missing(10);
+  string_stats->mutable_common_stats()->set_min_num_values(1);
+  string_stats->mutable_common_stats()->set_max_num_values(1);
+  string_stats->set_unique(num_values);
+  for (int i = first; i < first + num_values; ++i) {
+    auto* bucket = string_stats->mutable_rank_histogram()->add_buckets();
+    bucket->set_label(absl::StrCat("value_", i));
+    bucket->set_sample_count(1);
+  }
+  return result;
+}
+
+TEST(SchemaTest, UpdateInParallel) {
+  // The features share string domains through the schema and through the
+  // column constraints, and new features have the names of string domains,
+  // so some updates depend on the earlier ones.
+  const tensorflow::metadata::v0::Schema initial =
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"(
+        feature { name: "shared_a" type: BYTES domain: "shared" }
+        feature { name: "shared_b" type: BYTES domain: "shared" }
+        feature { name: "big_a" type: BYTES domain: "big" }
+        feature { name: "big_b" type: BYTES domain: "big" }
+        feature { name: "int" type: INT }
+        string_domain { name: "shared" value: "value_0" }
+        string_domain { name: "big" value: "value_0" }
+        string_domain { name: "unused" value: "value_0" })");
+  DatasetFeatureStatistics statistics;
+  statistics.set_num_examples(10);
+  *statistics.add_features() = GetStringFeatureStatistics("shared_a", 0, 2);
+  *statistics.add_features() = GetStringFeatureStatistics("big_a", 0, 8);
+  for (int i = 0; i < 30; ++i) {
+    *statistics.add_features() =
+        GetStringFeatureStatistics(absl::StrCat("new_", i), i, 1 + i % 3);
+  }
+  *statistics.add_features() = GetStringFeatureStatistics("shared_b", 1, 2);
+  *statistics.add_features() = GetStringFeatureStatistics("big_b", 0, 2);
+  *statistics.add_features() = GetStringFeatureStatistics("shared", 0, 2);
+  *statistics.add_features() = GetStringFeatureStatistics("unused", 0, 2);
+  // Its string domain cannot be named after it, as the previous one is.
+  *statistics.add_features() = GetStringFeatureStatistics("unused2", 0, 2);
+  FeatureStatisticsToProtoConfig config =
+      ParseTextProtoOrDie<FeatureStatisticsToProtoConfig>(R"(
+        enum_threshold: 400
+        enum_delete_threshold: 5
+        column_constraint {
+          column_path { step: "new_3" }
+          column_path { step: "new_7" }
+          column_path { step: "new_11" }
+          enum_name: "grouped"
+        })");
+
+  Schema serial;
+  TF_ASSERT_OK(serial.Init(initial));
+  TF_ASSERT_OK(serial.Update(DatasetStatsView(statistics), config));
+  config.set_num_threads(4);
+  Schema parallel;
+  TF_ASSERT_OK(parallel.Init(initial));
+  TF_ASSERT_OK(parallel.Update(DatasetStatsView(statistics), config));
+  EXPECT_THAT(parallel.GetSchema(), EqualsProto(serial.GetSchema()));
+}
+
+
 // Tests the creation of a nested feature.
 TEST(SchemaTest, CreateColumnsDeepAll) {
   Schema schema;
@@ -1555,6 +2140,146 @@ TEST(SchemaTest, GetMissingPathsAllMissing) {
                   Path({"foo.bar"})));
 }
 
+// Test GetMissingPaths when only some paths are considered.
+TEST(SchemaTest, GetMissingPathsOfPaths) {
+  const tensorflow::metadata::v0::Schema initial =
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"pb(
+        feature {
+          name: "struct"
+          presence: { min_count: 1 }
+          type: STRUCT
+          struct_domain {
+            feature: {
+              presence: { min_count: 1 }
+              name: "foo"
+            }
+            feature: {
+              presence: { min_count: 1 }
+              name: "bar"
+            }
+          }
+        }
+        feature {
+          name: "deprecated"
+          lifecycle_stage: DEPRECATED
+          type: STRUCT
+          struct_domain {
+            feature: {
+              presence: { min_count: 1 }
+              name: "foo"
+            }
+          }
+        }
+        feature {
+          name: "other"
+          presence: { min_count: 1 }
+        })pb");
+  const tensorflow::metadata::v0::DatasetFeatureStatistics stats;
+  DatasetStatsView view(stats);
+
+  Schema schema;
+  TF_ASSERT_OK(schema.Init(initial));
+  Schema overlay;
+  TF_ASSERT_OK(
+      overlay.InitOverlay(std::make_shared<const IndexedSchema>(initial)));
+  for (Schema* schema_to_check : {&schema, &overlay}) {
+    // The ancestors of a path are considered, but not their other children.
+    EXPECT_THAT(schema_to_check->GetMissingPaths(
+                    view, {Path({"struct", "foo"}), Path({"deprecated", "foo"}),
+                           Path({"not_in_schema"})}),
+                ::testing::UnorderedElementsAre(Path({"struct"}),
+                                                Path({"struct", "foo"})));
+    // The descendants of a path are considered.
+    EXPECT_THAT(schema_to_check->GetMissingPaths(view, {Path({"struct"})}),
+                ::testing::UnorderedElementsAre(Path({"struct"}),
+                                                Path({"struct", "foo"}),
+                                                Path({"struct", "bar"})));
+  }
+}
+
+// Test GetMissingPaths on an overlay, which uses the required features of its
+// baseline.
+TEST(SchemaTest, GetMissingPathsOverlay) {
+  const tensorflow::metadata::v0::Schema initial =
+      ParseTextProtoOrDie<tensorflow::metadata::v0::Schema>(R"pb(
+        default_environment: "TRAINING"
+        default_environment: "SERVING"
+        feature {
+          name: "struct"
+          presence: { min_count: 1 }
+          type: STRUCT
+          struct_domain {
+            feature: {
+              presence: { min_fraction: 0.5 }
+              name: "foo"
+            }
+            feature: { name: "optional" }
+          }
+        }
+        feature {
+          name: "deprecated"
+          lifecycle_stage: DEPRECATED
+          presence: { min_count: 1 }
+          type: STRUCT
+          struct_domain {
+            feature: {
+              presence: { min_count: 1 }
+              name: "foo"
+            }
+          }
+        }
+        feature {
+          name: "label"
+          presence: { min_count: 1 }
+          not_in_environment: "SERVING"
+        }
+        feature {
+          name: "present"
+          presence: { min_count: 1 }
+        })pb");
+  const IndexedSchema indexed(initial);
+  std::vector<Path> required_paths;
+  for (const IndexedSchema::RequiredFeature& required :
+       indexed.required_features()) {
+    required_paths.push_back(required.path);
+  }
+  EXPECT_THAT(required_paths,
+              ::testing::ElementsAre(Path({"struct"}), Path({"struct", "foo"}),
+                                     Path({"label"}), Path({"present"})));
+
+  const tensorflow::metadata::v0::DatasetFeatureStatistics stats =
+      ParseTextProtoOrDie<tensorflow::metadata::v0::DatasetFeatureStatistics>(
+          R"(
+            num_examples: 1
+            features: {
+              name: 'present'
+              type: INT
+              num_stats: { common_stats: { num_non_missing: 1 } }
+            })");
+  Schema schema;
+  TF_ASSERT_OK(schema.Init(initial));
+  for (const absl::optional<string>& environment :
+       {absl::optional<string>(), absl::optional<string>("SERVING")}) {
+    const DatasetStatsView view(stats, /*by_weight=*/false, environment,
+                                nullptr, nullptr, nullptr);
+    Schema overlay;
+    TF_ASSERT_OK(
+        overlay.InitOverlay(std::make_shared<const IndexedSchema>(initial)));
+    const std::vector<Path> missing_paths = overlay.GetMissingPaths(view);
+    EXPECT_EQ(missing_paths, schema.GetMissingPaths(view));
+    if (environment) {
+      EXPECT_THAT(missing_paths,
+                  ::testing::ElementsAre(Path({"struct"}),
+                                         Path({"struct", "foo"})));
+    } else {
+      EXPECT_THAT(missing_paths,
+                  ::testing::ElementsAre(Path({"struct"}),
+                                         Path({"struct", "foo"}),
+                                         Path({"label"})));
+    }
+  }
+}
+
 // Test when GetMissingPaths when all paths in a schema are in the data.
 TEST(SchemaTest, GetMissingPathsAllPresent) {
   const tensorflow::metadata::v0::Schema initial =
@@ -3551,6 +4276,44 @@ TEST(SchemaTest, UpdateUniqueConstraints) {
                 })"));
 }
 
+TEST(SchemaUpdater, UpdateSeverityForAnomaly) {
+  const FeatureStatisticsToProtoConfig config =
+      ParseTextProtoOrDie<FeatureStatisticsToProtoConfig>(R"(
+        new_features_are_warnings: true
+        severity_overrides: { type: ENUM_TYPE_UNEXPECTED_STRING_VALUES
+                              severity: ERROR }
+        severity_overrides: { type: ENUM_TYPE_UNEXPECTED_STRING_VALUES
+                              severity: WARNING }
+        severity_overrides: { type: FEATURE_TYPE_LOW_NUMBER_VALUES
+                              severity: UNKNOWN })");
+  const Schema::Updater updater(config);
+  const auto severity_for = [&updater](
+      tensorflow::metadata::v0::AnomalyInfo::Type type) {
+    tensorflow::metadata::v0::AnomalyInfo::Severity severity =
+        tensorflow::metadata::v0::AnomalyInfo::UNKNOWN;
+    updater.UpdateSeverityForAnomaly({{type, "short", "long"}}, &severity);
+    return severity;
+  };
+  EXPECT_EQ(tensorflow::metadata::v0::AnomalyInfo::WARNING,
+            severity_for(tensorflow::metadata::v0::AnomalyInfo::
+                             SCHEMA_NEW_COLUMN));
+  // The last override of a type wins.
+  EXPECT_EQ(tensorflow::metadata::v0::AnomalyInfo::WARNING,
+            severity_for(tensorflow::metadata::v0::AnomalyInfo::
+                             ENUM_TYPE_UNEXPECTED_STRING_VALUES));
+  EXPECT_EQ(tensorflow::metadata::v0::AnomalyInfo::UNKNOWN,
+            severity_for(tensorflow::metadata::v0::AnomalyInfo::
+                             FEATURE_TYPE_LOW_NUMBER_VALUES));
+  EXPECT_EQ(tensorflow::metadata::v0::AnomalyInfo::ERROR,
+            severity_for(tensorflow::metadata::v0::AnomalyInfo::
+                             FEATURE_TYPE_HIGH_NUMBER_VALUES));
+  // Types outside of the table default to ERROR.
+  EXPECT_EQ(tensorflow::metadata::v0::AnomalyInfo::ERROR,
+            severity_for(
+                static_cast<tensorflow::metadata::v0::AnomalyInfo::Type>(
+                    tensorflow::metadata::v0::AnomalyInfo::Type_ARRAYSIZE)));
+}
+
 }  // namespace
 }  // namespace data_validation
 }  // namespace tensorflow
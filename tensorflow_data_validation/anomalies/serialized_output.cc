@@ -0,0 +1,74 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/serialized_output.h"
+
+#include <cstring>
+#include <limits>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+// Gets a buffer of size bytes from output, or an error.
+Status Allocate(size_t size, SerializedOutput* output, char** buffer) {
+  *buffer = output->Allocate(size);
+  if (*buffer == nullptr) {
+    return errors::ResourceExhausted("Could not allocate ", size,
+                                     " bytes for the output proto.");
+  }
+  return Status::OK();
+}
+
+}  // namespace
+
+StringOutput::StringOutput(string* result) : result_(result) {}
+
+char* StringOutput::Allocate(size_t size) {
+  result_->resize(size);
+  return &(*result_)[0];
+}
+
+Status SerializeToOutput(const protobuf::MessageLite& message,
+                         absl::string_view type_name,
+                         SerializedOutput* output) {
+  const size_t size = message.ByteSizeLong();
+  // Same limit as MessageLite::SerializeToString().
+  if (size > static_cast<size_t>(std::numeric_limits<int>::max())) {
+    return errors::Internal("Could not serialize ", type_name,
+                            " output proto of ", size, " bytes.");
+  }
+  char* buffer;
+  TF_RETURN_IF_ERROR(Allocate(size, output, &buffer));
+  // The sizes were cached by ByteSizeLong().
+  message.SerializeWithCachedSizesToArray(reinterpret_cast<uint8*>(buffer));
+  return Status::OK();
+}
+
+Status CopyToOutput(absl::string_view serialized, SerializedOutput* output) {
+  char* buffer;
+  TF_RETURN_IF_ERROR(Allocate(serialized.size(), output, &buffer));
+  std::memcpy(buffer, serialized.data(), serialized.size());
+  return Status::OK();
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -0,0 +1,67 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_SERIALIZED_OUTPUT_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_SERIALIZED_OUTPUT_H_
+
+#include <cstddef>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// Where a serialized proto is written. The memory is provided by the
+// implementation, so that a result can be serialized straight into the object
+// that is finally returned (e.g., a Python bytes object) instead of being
+// copied out of a string.
+class SerializedOutput {
+ public:
+  virtual ~SerializedOutput() = default;
+
+  // Returns a buffer of size bytes for the serialized proto, or null if it
+  // cannot be allocated. Called at most once.
+  virtual char* Allocate(size_t size) = 0;
+};
+
+// A SerializedOutput writing to a string.
+class StringOutput : public SerializedOutput {
+ public:
+  // Does not take ownership of result, which must outlive this.
+  explicit StringOutput(string* result);
+
+  char* Allocate(size_t size) override;
+
+ private:
+  string* const result_;
+};
+
+// Serializes message to output, with a single pass over message after its
+// size is computed. type_name (e.g., "Anomalies") is used in errors.
+Status SerializeToOutput(const protobuf::MessageLite& message,
+                         absl::string_view type_name,
+                         SerializedOutput* output);
+
+// Copies an already serialized proto to output.
+Status CopyToOutput(absl::string_view serialized, SerializedOutput* output);
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_SERIALIZED_OUTPUT_H_
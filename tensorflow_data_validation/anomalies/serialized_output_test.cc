@@ -0,0 +1,77 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/serialized_output.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+// A SerializedOutput that cannot allocate anything.
+class FailingOutput : public SerializedOutput {
+ public:
+  char* Allocate(size_t size) override { return nullptr; }
+};
+
+tensorflow::metadata::v0::Schema GetSchema() {
+  tensorflow::metadata::v0::Schema schema;
+  schema.add_feature()->set_name("foo");
+  schema.add_feature()->set_name("bar");
+  return schema;
+}
+
+TEST(SerializedOutputTest, SerializeToString) {
+  const tensorflow::metadata::v0::Schema schema = GetSchema();
+  string result = "overwritten";
+  StringOutput output(&result);
+  TF_ASSERT_OK(SerializeToOutput(schema, "Schema", &output));
+  EXPECT_EQ(result, schema.SerializeAsString());
+}
+
+TEST(SerializedOutputTest, SerializeEmpty) {
+  string result = "overwritten";
+  StringOutput output(&result);
+  TF_ASSERT_OK(
+      SerializeToOutput(tensorflow::metadata::v0::Schema(), "Schema", &output));
+  EXPECT_EQ(result, "");
+}
+
+TEST(SerializedOutputTest, CopyToString) {
+  string result;
+  StringOutput output(&result);
+  TF_ASSERT_OK(CopyToOutput("serialized", &output));
+  EXPECT_EQ(result, "serialized");
+}
+
+TEST(SerializedOutputTest, AllocationFailure) {
+  FailingOutput output;
+  EXPECT_EQ(SerializeToOutput(GetSchema(), "Schema", &output).code(),
+            error::RESOURCE_EXHAUSTED);
+  EXPECT_EQ(CopyToOutput("serialized", &output).code(),
+            error::RESOURCE_EXHAUSTED);
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
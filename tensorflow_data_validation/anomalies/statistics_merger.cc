@@ -0,0 +1,853 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/statistics_merger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "tensorflow_data_validation/anomalies/metrics.h"
+#include "tensorflow_data_validation/anomalies/path.h"
+#include "tensorflow_data_validation/anomalies/task_queue.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+namespace {
+
+using ::tensorflow::metadata::v0::BytesStatistics;
+using ::tensorflow::metadata::v0::CommonStatistics;
+using ::tensorflow::metadata::v0::DatasetFeatureStatistics;
+using ::tensorflow::metadata::v0::FeatureNameStatistics;
+using ::tensorflow::metadata::v0::Histogram;
+using ::tensorflow::metadata::v0::NumericStatistics;
+using ::tensorflow::metadata::v0::PresenceAndValencyStatistics;
+using ::tensorflow::metadata::v0::RankHistogram;
+using ::tensorflow::metadata::v0::StringStatistics;
+using ::tensorflow::metadata::v0::StructStatistics;
+using ::tensorflow::metadata::v0::WeightedCommonStatistics;
+using ::tensorflow::metadata::v0::WeightedNumericStatistics;
+using ::tensorflow::metadata::v0::WeightedStringStatistics;
+
+using HistogramList = ::tensorflow::protobuf::RepeatedPtrField<Histogram>;
+
+// The examples of the shards that do not have a feature, which are all
+// missing it.
+struct MissingExamples {
+  uint64 num_examples = 0;
+  double weighted_num_examples = 0.0;
+};
+
+// A mean of values weighted by the sizes of their shards, along with the
+// mean of their squares if they are means of values with standard deviations.
+class WeightedMean {
+ public:
+  void Add(double mean, double weight) { Add(mean, /*std_dev=*/0.0, weight); }
+
+  void Add(double mean, double std_dev, double weight) {
+    if (weight <= 0) {
+      return;
+    }
+    sum_ += mean * weight;
+    sum_of_squares_ += (std_dev * std_dev + mean * mean) * weight;
+    weight_ += weight;
+  }
+
+  double mean() const { return weight_ > 0 ? sum_ / weight_ : 0.0; }
+
+  double std_dev() const {
+    if (weight_ <= 0) {
+      return 0.0;
+    }
+    const double variance = sum_of_squares_ / weight_ - mean() * mean();
+    return variance > 0 ? std::sqrt(variance) : 0.0;
+  }
+
+ private:
+  double sum_ = 0.0;
+  double sum_of_squares_ = 0.0;
+  double weight_ = 0.0;
+};
+
+// The counts of values summed over shards, by value, in the order in which
+// the values were first seen.
+class ValueCounts {
+ public:
+  void Add(absl::string_view value, double count) {
+    const auto inserted = index_.emplace(value, counts_.size());
+    if (inserted.second) {
+      counts_.emplace_back(value, count);
+    } else {
+      counts_[inserted.first->second].second += count;
+    }
+  }
+
+  int num_values() const { return counts_.size(); }
+
+  // Returns the max_values most frequent values, by decreasing count (and by
+  // first appearance, among the values with the same count).
+  std::vector<std::pair<absl::string_view, double>> GetMostFrequent(
+      int max_values) {
+    std::stable_sort(counts_.begin(), counts_.end(),
+                     [](const std::pair<absl::string_view, double>& a,
+                        const std::pair<absl::string_view, double>& b) {
+                       return a.second > b.second;
+                     });
+    if (counts_.size() > max_values) {
+      counts_.resize(max_values);
+    }
+    return counts_;
+  }
+
+ private:
+  absl::flat_hash_map<absl::string_view, int> index_;
+  std::vector<std::pair<absl::string_view, double>> counts_;
+};
+
+// Returns true if the two histograms have the same buckets.
+bool HaveSameBuckets(const Histogram& a, const Histogram& b) {
+  if (a.buckets_size() != b.buckets_size()) {
+    return false;
+  }
+  for (int i = 0; i < a.buckets_size(); ++i) {
+    if (a.buckets(i).low_value() != b.buckets(i).low_value() ||
+        a.buckets(i).high_value() != b.buckets(i).high_value()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the value below which lie target of the counts of the buckets
+// between consecutive boundaries, assuming a uniform distribution of the
+// values within each bucket.
+double GetValueAtCount(const std::vector<double>& boundaries,
+                       const std::vector<double>& counts, double target) {
+  double cumulative = 0.0;
+  for (int i = 0; i < counts.size(); ++i) {
+    if (counts[i] > 0 && cumulative + counts[i] >= target) {
+      return boundaries[i] + (boundaries[i + 1] - boundaries[i]) *
+                                 (target - cumulative) / counts[i];
+    }
+    cumulative += counts[i];
+  }
+  return boundaries.back();
+}
+
+// Returns the median of the values of a histogram, assuming a uniform
+// distribution of the values within each bucket, or nullopt if it is empty.
+absl::optional<double> GetMedian(const Histogram& histogram) {
+  double total = 0.0;
+  for (const Histogram::Bucket& bucket : histogram.buckets()) {
+    total += bucket.sample_count();
+  }
+  if (total <= 0) {
+    return absl::nullopt;
+  }
+  double cumulative = 0.0;
+  for (const Histogram::Bucket& bucket : histogram.buckets()) {
+    if (bucket.sample_count() > 0 &&
+        cumulative + bucket.sample_count() >= total / 2) {
+      return bucket.low_value() +
+             (bucket.high_value() - bucket.low_value()) *
+                 (total / 2 - cumulative) / bucket.sample_count();
+    }
+    cumulative += bucket.sample_count();
+  }
+  return histogram.buckets(histogram.buckets_size() - 1).high_value();
+}
+
+// Merges histograms of the same type (see MergeDatasetFeatureStatistics()).
+void MergeHistograms(const std::vector<const Histogram*>& histograms,
+                     Histogram* result) {
+  result->set_type(histograms.front()->type());
+  result->set_name(histograms.front()->name());
+  uint64 num_nan = 0;
+  uint64 num_undefined = 0;
+  const Histogram* first_with_buckets = nullptr;
+  bool same_buckets = true;
+  int max_num_buckets = 0;
+  double low_value = std::numeric_limits<double>::infinity();
+  double high_value = -std::numeric_limits<double>::infinity();
+  double total_count = 0.0;
+  for (const Histogram* histogram : histograms) {
+    num_nan += histogram->num_nan();
+    num_undefined += histogram->num_undefined();
+    if (histogram->buckets_size() == 0) {
+      continue;
+    }
+    if (first_with_buckets == nullptr) {
+      first_with_buckets = histogram;
+    } else {
+      same_buckets =
+          same_buckets && HaveSameBuckets(*first_with_buckets, *histogram);
+    }
+    max_num_buckets = std::max(max_num_buckets, histogram->buckets_size());
+    for (const Histogram::Bucket& bucket : histogram->buckets()) {
+      low_value = std::min(low_value, bucket.low_value());
+      high_value = std::max(high_value, bucket.high_value());
+      total_count += bucket.sample_count();
+    }
+  }
+  result->set_num_nan(num_nan);
+  result->set_num_undefined(num_undefined);
+  if (first_with_buckets == nullptr) {
+    return;
+  }
+  if (same_buckets) {
+    // As in AlignHistograms(), histograms with the same buckets need no
+    // rebucketing.
+    *result->mutable_buckets() = first_with_buckets->buckets();
+    std::vector<double> counts(max_num_buckets, 0.0);
+    for (const Histogram* histogram : histograms) {
+      for (int i = 0; i < histogram->buckets_size(); ++i) {
+        counts[i] += histogram->buckets(i).sample_count();
+      }
+    }
+    for (int i = 0; i < max_num_buckets; ++i) {
+      result->mutable_buckets(i)->set_sample_count(counts[i]);
+    }
+    return;
+  }
+  if (low_value == high_value) {
+    Histogram::Bucket* bucket = result->add_buckets();
+    bucket->set_low_value(low_value);
+    bucket->set_high_value(high_value);
+    bucket->set_sample_count(total_count);
+    return;
+  }
+  std::vector<double> boundaries;
+  if (result->type() == Histogram::QUANTILES) {
+    // The boundaries of all the buckets, so that the counts of the shards are
+    // added without spreading them further.
+    for (const Histogram* histogram : histograms) {
+      for (const Histogram::Bucket& bucket : histogram->buckets()) {
+        boundaries.push_back(bucket.low_value());
+        boundaries.push_back(bucket.high_value());
+      }
+    }
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()),
+                     boundaries.end());
+  } else {
+    boundaries.reserve(max_num_buckets + 1);
+    for (int i = 0; i < max_num_buckets; ++i) {
+      boundaries.push_back(low_value +
+                           (high_value - low_value) * i / max_num_buckets);
+    }
+    boundaries.push_back(high_value);
+  }
+  std::vector<double> counts(boundaries.size() - 1, 0.0);
+  for (const Histogram* histogram : histograms) {
+    if (histogram->buckets_size() == 0) {
+      continue;
+    }
+    const std::vector<double> histogram_counts =
+        GetCountsOnBoundaries(*histogram, boundaries);
+    for (int i = 0; i < counts.size(); ++i) {
+      counts[i] += histogram_counts[i];
+    }
+  }
+  if (result->type() != Histogram::QUANTILES) {
+    for (int i = 0; i < counts.size(); ++i) {
+      Histogram::Bucket* bucket = result->add_buckets();
+      bucket->set_low_value(boundaries[i]);
+      bucket->set_high_value(boundaries[i + 1]);
+      bucket->set_sample_count(counts[i]);
+    }
+    return;
+  }
+  // Splits the merged distribution into buckets of equal mass.
+  double previous = low_value;
+  for (int i = 1; i <= max_num_buckets; ++i) {
+    const double next =
+        i == max_num_buckets
+            ? high_value
+            : GetValueAtCount(boundaries, counts,
+                              total_count * i / max_num_buckets);
+    Histogram::Bucket* bucket = result->add_buckets();
+    bucket->set_low_value(previous);
+    bucket->set_high_value(next);
+    bucket->set_sample_count(total_count / max_num_buckets);
+    previous = next;
+  }
+}
+
+// Merges lists of histograms, matching the histograms by type and name.
+void MergeHistogramLists(const std::vector<const HistogramList*>& lists,
+                         HistogramList* result) {
+  std::map<std::pair<int, string>, int> index;
+  std::vector<std::vector<const Histogram*>> groups;
+  for (const HistogramList* list : lists) {
+    for (const Histogram& histogram : *list) {
+      const auto inserted = index.emplace(
+          std::make_pair(histogram.type(), histogram.name()), groups.size());
+      if (inserted.second) {
+        groups.emplace_back();
+      }
+      groups[inserted.first->second].push_back(&histogram);
+    }
+  }
+  for (const std::vector<const Histogram*>& group : groups) {
+    MergeHistograms(group, result->Add());
+  }
+}
+
+// Returns the median of the QUANTILES histogram of histograms, if any.
+absl::optional<double> GetQuantilesMedian(const HistogramList& histograms) {
+  for (const Histogram& histogram : histograms) {
+    if (histogram.type() == Histogram::QUANTILES) {
+      return GetMedian(histogram);
+    }
+  }
+  return absl::nullopt;
+}
+
+void MergeWeightedCommonStatistics(
+    const std::vector<const WeightedCommonStatistics*>& stats,
+    double weighted_missing_examples, WeightedCommonStatistics* result) {
+  double num_non_missing = 0.0;
+  double num_missing = weighted_missing_examples;
+  double tot_num_values = 0.0;
+  for (const WeightedCommonStatistics* shard : stats) {
+    num_non_missing += shard->num_non_missing();
+    num_missing += shard->num_missing();
+    tot_num_values += shard->tot_num_values();
+  }
+  result->set_num_non_missing(num_non_missing);
+  result->set_num_missing(num_missing);
+  result->set_tot_num_values(tot_num_values);
+  result->set_avg_num_values(
+      num_non_missing > 0 ? tot_num_values / num_non_missing : 0.0);
+}
+
+void MergePresenceAndValency(
+    const std::vector<const PresenceAndValencyStatistics*>& stats,
+    uint64 missing_examples, PresenceAndValencyStatistics* result) {
+  bool has_values = false;
+  result->set_num_missing(missing_examples);
+  for (const PresenceAndValencyStatistics* shard : stats) {
+    result->set_num_non_missing(result->num_non_missing() +
+                                shard->num_non_missing());
+    result->set_num_missing(result->num_missing() + shard->num_missing());
+    result->set_tot_num_values(result->tot_num_values() +
+                               shard->tot_num_values());
+    if (shard->num_non_missing() == 0) {
+      continue;
+    }
+    if (!has_values || shard->min_num_values() < result->min_num_values()) {
+      result->set_min_num_values(shard->min_num_values());
+    }
+    if (!has_values || shard->max_num_values() > result->max_num_values()) {
+      result->set_max_num_values(shard->max_num_values());
+    }
+    has_values = true;
+  }
+}
+
+void MergeCommonStatistics(const std::vector<const CommonStatistics*>& stats,
+                           const MissingExamples& missing,
+                           CommonStatistics* result) {
+  // CommonStatistics has the fields of the outermost level of presence and
+  // valency, which are merged the same way.
+  std::vector<PresenceAndValencyStatistics> outermost(stats.size());
+  std::vector<const PresenceAndValencyStatistics*> outermost_levels;
+  for (int i = 0; i < stats.size(); ++i) {
+    outermost[i].set_num_non_missing(stats[i]->num_non_missing());
+    outermost[i].set_num_missing(stats[i]->num_missing());
+    outermost[i].set_min_num_values(stats[i]->min_num_values());
+    outermost[i].set_max_num_values(stats[i]->max_num_values());
+    outermost[i].set_tot_num_values(stats[i]->tot_num_values());
+    outermost_levels.push_back(&outermost[i]);
+  }
+  PresenceAndValencyStatistics first_level;
+  MergePresenceAndValency(outermost_levels, missing.num_examples,
+                          &first_level);
+  result->set_num_non_missing(first_level.num_non_missing());
+  result->set_num_missing(first_level.num_missing());
+  result->set_min_num_values(first_level.min_num_values());
+  result->set_max_num_values(first_level.max_num_values());
+  result->set_tot_num_values(first_level.tot_num_values());
+  result->set_avg_num_values(
+      first_level.num_non_missing() > 0
+          ? static_cast<double>(first_level.tot_num_values()) /
+                first_level.num_non_missing()
+          : 0.0);
+
+  std::vector<const Histogram*> num_values_histograms;
+  std::vector<const Histogram*> feature_list_length_histograms;
+  std::vector<const WeightedCommonStatistics*> weighted;
+  int num_levels = 0;
+  int num_weighted_levels = 0;
+  for (const CommonStatistics* shard : stats) {
+    if (shard->has_num_values_histogram()) {
+      num_values_histograms.push_back(&shard->num_values_histogram());
+    }
+    if (shard->has_feature_list_length_histogram()) {
+      feature_list_length_histograms.push_back(
+          &shard->feature_list_length_histogram());
+    }
+    if (shard->has_weighted_common_stats()) {
+      weighted.push_back(&shard->weighted_common_stats());
+    }
+    num_levels = std::max(num_levels, shard->presence_and_valency_stats_size());
+    num_weighted_levels = std::max(
+        num_weighted_levels, shard->weighted_presence_and_valency_stats_size());
+  }
+  if (!num_values_histograms.empty()) {
+    MergeHistograms(num_values_histograms,
+                    result->mutable_num_values_histogram());
+  }
+  if (!feature_list_length_histograms.empty()) {
+    MergeHistograms(feature_list_length_histograms,
+                    result->mutable_feature_list_length_histogram());
+  }
+  if (!weighted.empty()) {
+    MergeWeightedCommonStatistics(weighted, missing.weighted_num_examples,
+                                  result->mutable_weighted_common_stats());
+  }
+  // Only the outermost level is missing from the examples without the
+  // feature.
+  for (int level = 0; level < num_levels; ++level) {
+    std::vector<const PresenceAndValencyStatistics*> levels;
+    for (const CommonStatistics* shard : stats) {
+      if (level < shard->presence_and_valency_stats_size()) {
+        levels.push_back(&shard->presence_and_valency_stats(level));
+      }
+    }
+    MergePresenceAndValency(levels, level == 0 ? missing.num_examples : 0,
+                            result->add_presence_and_valency_stats());
+  }
+  for (int level = 0; level < num_weighted_levels; ++level) {
+    std::vector<const WeightedCommonStatistics*> levels;
+    for (const CommonStatistics* shard : stats) {
+      if (level < shard->weighted_presence_and_valency_stats_size()) {
+        levels.push_back(&shard->weighted_presence_and_valency_stats(level));
+      }
+    }
+    MergeWeightedCommonStatistics(
+        levels, level == 0 ? missing.weighted_num_examples : 0.0,
+        result->add_weighted_presence_and_valency_stats());
+  }
+}
+
+void MergeWeightedNumericStatistics(
+    const std::vector<const NumericStatistics*>& stats,
+    WeightedNumericStatistics* result) {
+  WeightedMean mean;
+  std::vector<const HistogramList*> histograms;
+  for (const NumericStatistics* shard : stats) {
+    if (!shard->has_weighted_numeric_stats()) {
+      continue;
+    }
+    const WeightedNumericStatistics& weighted = shard->weighted_numeric_stats();
+    mean.Add(weighted.mean(), weighted.std_dev(),
+             shard->common_stats().weighted_common_stats().tot_num_values());
+    histograms.push_back(&weighted.histograms());
+  }
+  result->set_mean(mean.mean());
+  result->set_std_dev(mean.std_dev());
+  MergeHistogramLists(histograms, result->mutable_histograms());
+  result->set_median(GetQuantilesMedian(result->histograms()).value_or(0.0));
+}
+
+void MergeNumericStatistics(const std::vector<const NumericStatistics*>& stats,
+                            const MissingExamples& missing,
+                            NumericStatistics* result) {
+  std::vector<const CommonStatistics*> common_stats;
+  std::vector<const HistogramList*> histograms;
+  WeightedMean mean;
+  bool has_values = false;
+  bool has_weighted_stats = false;
+  for (const NumericStatistics* shard : stats) {
+    common_stats.push_back(&shard->common_stats());
+    histograms.push_back(&shard->histograms());
+    has_weighted_stats =
+        has_weighted_stats || shard->has_weighted_numeric_stats();
+    result->set_num_zeros(result->num_zeros() + shard->num_zeros());
+    const uint64 num_values = shard->common_stats().tot_num_values();
+    mean.Add(shard->mean(), shard->std_dev(), num_values);
+    if (num_values == 0) {
+      continue;
+    }
+    if (!has_values || shard->min() < result->min()) {
+      result->set_min(shard->min());
+    }
+    if (!has_values || shard->max() > result->max()) {
+      result->set_max(shard->max());
+    }
+    has_values = true;
+  }
+  MergeCommonStatistics(common_stats, missing, result->mutable_common_stats());
+  result->set_mean(mean.mean());
+  result->set_std_dev(mean.std_dev());
+  MergeHistogramLists(histograms, result->mutable_histograms());
+  result->set_median(GetQuantilesMedian(result->histograms()).value_or(0.0));
+  if (has_weighted_stats) {
+    MergeWeightedNumericStatistics(stats,
+                                   result->mutable_weighted_numeric_stats());
+  }
+}
+
+// Merges the rank histograms, and returns the number of distinct values they
+// have.
+int MergeRankHistograms(const std::vector<const RankHistogram*>& histograms,
+                        RankHistogram* result) {
+  ValueCounts counts;
+  int max_num_buckets = 0;
+  for (const RankHistogram* histogram : histograms) {
+    if (result->name().empty()) {
+      result->set_name(histogram->name());
+    }
+    max_num_buckets = std::max(max_num_buckets, histogram->buckets_size());
+    for (const RankHistogram::Bucket& bucket : histogram->buckets()) {
+      counts.Add(bucket.label(), bucket.sample_count());
+    }
+  }
+  const int num_values = counts.num_values();
+  int rank = 0;
+  for (const auto& value_count : counts.GetMostFrequent(max_num_buckets)) {
+    RankHistogram::Bucket* bucket = result->add_buckets();
+    bucket->set_low_rank(rank);
+    bucket->set_high_rank(rank);
+    bucket->set_label(string(value_count.first));
+    bucket->set_sample_count(value_count.second);
+    ++rank;
+  }
+  return num_values;
+}
+
+// Merges the top values, and returns the number of distinct values they
+// have.
+int MergeTopValues(
+    const std::vector<const ::tensorflow::protobuf::RepeatedPtrField<
+        StringStatistics::FreqAndValue>*>& top_values,
+    ::tensorflow::protobuf::RepeatedPtrField<StringStatistics::FreqAndValue>*
+        result) {
+  ValueCounts counts;
+  int max_num_values = 0;
+  for (const auto* shard : top_values) {
+    max_num_values = std::max(max_num_values, shard->size());
+    for (const StringStatistics::FreqAndValue& value : *shard) {
+      counts.Add(value.value(), value.frequency());
+    }
+  }
+  const int num_values = counts.num_values();
+  for (const auto& value_count : counts.GetMostFrequent(max_num_values)) {
+    StringStatistics::FreqAndValue* value = result->Add();
+    value->set_value(string(value_count.first));
+    value->set_frequency(value_count.second);
+  }
+  return num_values;
+}
+
+void MergeStringStatistics(const std::vector<const StringStatistics*>& stats,
+                           const MissingExamples& missing,
+                           StringStatistics* result) {
+  std::vector<const CommonStatistics*> common_stats;
+  std::vector<const RankHistogram*> rank_histograms;
+  std::vector<const ::tensorflow::protobuf::RepeatedPtrField<
+      StringStatistics::FreqAndValue>*>
+      top_values;
+  std::vector<const RankHistogram*> weighted_rank_histograms;
+  std::vector<const ::tensorflow::protobuf::RepeatedPtrField<
+      StringStatistics::FreqAndValue>*>
+      weighted_top_values;
+  WeightedMean avg_length;
+  uint64 unique = 0;
+  for (const StringStatistics* shard : stats) {
+    common_stats.push_back(&shard->common_stats());
+    rank_histograms.push_back(&shard->rank_histogram());
+    top_values.push_back(&shard->top_values());
+    if (shard->has_weighted_string_stats()) {
+      weighted_rank_histograms.push_back(
+          &shard->weighted_string_stats().rank_histogram());
+      weighted_top_values.push_back(
+          &shard->weighted_string_stats().top_values());
+    }
+    avg_length.Add(shard->avg_length(),
+                   shard->common_stats().tot_num_values());
+    unique = std::max<uint64>(unique, shard->unique());
+    if (result->vocabulary_file().empty()) {
+      result->set_vocabulary_file(shard->vocabulary_file());
+    }
+    result->set_invalid_utf8_count(result->invalid_utf8_count() +
+                                   shard->invalid_utf8_count());
+  }
+  MergeCommonStatistics(common_stats, missing, result->mutable_common_stats());
+  result->set_avg_length(avg_length.mean());
+  const int num_ranked_values =
+      MergeRankHistograms(rank_histograms, result->mutable_rank_histogram());
+  const int num_top_values =
+      MergeTopValues(top_values, result->mutable_top_values());
+  result->set_unique(std::max<uint64>(
+      unique, std::max(num_ranked_values, num_top_values)));
+  if (!weighted_rank_histograms.empty()) {
+    WeightedStringStatistics* weighted =
+        result->mutable_weighted_string_stats();
+    MergeRankHistograms(weighted_rank_histograms,
+                        weighted->mutable_rank_histogram());
+    MergeTopValues(weighted_top_values, weighted->mutable_top_values());
+  }
+}
+
+void MergeBytesStatistics(const std::vector<const BytesStatistics*>& stats,
+                          const MissingExamples& missing,
+                          BytesStatistics* result) {
+  std::vector<const CommonStatistics*> common_stats;
+  WeightedMean avg_num_bytes;
+  bool has_values = false;
+  for (const BytesStatistics* shard : stats) {
+    common_stats.push_back(&shard->common_stats());
+    result->set_unique(std::max<uint64>(result->unique(), shard->unique()));
+    const uint64 num_values = shard->common_stats().tot_num_values();
+    avg_num_bytes.Add(shard->avg_num_bytes(), num_values);
+    if (num_values == 0) {
+      continue;
+    }
+    if (!has_values || shard->min_num_bytes() < result->min_num_bytes()) {
+      result->set_min_num_bytes(shard->min_num_bytes());
+    }
+    if (!has_values || shard->max_num_bytes() > result->max_num_bytes()) {
+      result->set_max_num_bytes(shard->max_num_bytes());
+    }
+    result->set_max_num_bytes_int(
+        std::max(result->max_num_bytes_int(), shard->max_num_bytes_int()));
+    has_values = true;
+  }
+  MergeCommonStatistics(common_stats, missing, result->mutable_common_stats());
+  result->set_avg_num_bytes(avg_num_bytes.mean());
+}
+
+void MergeStructStatistics(const std::vector<const StructStatistics*>& stats,
+                           const MissingExamples& missing,
+                           StructStatistics* result) {
+  std::vector<const CommonStatistics*> common_stats;
+  for (const StructStatistics* shard : stats) {
+    common_stats.push_back(&shard->common_stats());
+  }
+  MergeCommonStatistics(common_stats, missing, result->mutable_common_stats());
+}
+
+// Returns the key by which the statistics of a feature are matched across
+// shards, which differs between a name and a path with the same steps.
+string GetFeatureKey(const FeatureNameStatistics& feature) {
+  if (feature.field_id_case() == FeatureNameStatistics::kPath) {
+    return absl::StrCat("path:", Path(feature.path()).Serialize());
+  }
+  return absl::StrCat("name:", feature.name());
+}
+
+// Returns a name of a feature for error messages.
+string GetFeatureName(const FeatureNameStatistics& feature) {
+  return feature.field_id_case() == FeatureNameStatistics::kPath
+             ? Path(feature.path()).Serialize()
+             : feature.name();
+}
+
+// Collects the statistics of type T among stats, with get.
+template <typename T, typename Get>
+std::vector<const T*> Collect(
+    const std::vector<const FeatureNameStatistics*>& stats, Get get) {
+  std::vector<const T*> result;
+  result.reserve(stats.size());
+  for (const FeatureNameStatistics* feature : stats) {
+    result.push_back(&get(*feature));
+  }
+  return result;
+}
+
+// Merges the statistics of a feature in the shards that have it, given the
+// examples of the other shards.
+Status MergeFeature(const std::vector<const FeatureNameStatistics*>& stats,
+                    const MissingExamples& missing,
+                    FeatureNameStatistics* result) {
+  const FeatureNameStatistics& first = *stats.front();
+  if (first.field_id_case() == FeatureNameStatistics::kPath) {
+    *result->mutable_path() = first.path();
+  } else {
+    result->set_name(first.name());
+  }
+  result->set_type(first.type());
+  // The shards with statistics of some kind, which must all be the same.
+  std::vector<const FeatureNameStatistics*> with_stats;
+  absl::flat_hash_set<string> custom_stats_seen;
+  for (const FeatureNameStatistics* feature : stats) {
+    if (feature->type() != first.type()) {
+      return errors::InvalidArgument(
+          "Feature ", GetFeatureName(first),
+          " has statistics of different types in different shards.");
+    }
+    if (feature->stats_case() != FeatureNameStatistics::STATS_NOT_SET) {
+      if (!with_stats.empty() &&
+          feature->stats_case() != with_stats.front()->stats_case()) {
+        return errors::InvalidArgument(
+            "Feature ", GetFeatureName(first),
+            " has statistics of different kinds in different shards.");
+      }
+      with_stats.push_back(feature);
+    }
+    for (const auto& custom_stat : feature->custom_stats()) {
+      if (custom_stats_seen.insert(custom_stat.name()).second) {
+        *result->add_custom_stats() = custom_stat;
+      }
+    }
+  }
+  if (with_stats.empty()) {
+    return Status::OK();
+  }
+  switch (with_stats.front()->stats_case()) {
+    case FeatureNameStatistics::kNumStats:
+      MergeNumericStatistics(
+          Collect<NumericStatistics>(
+              with_stats,
+              [](const FeatureNameStatistics& f) -> const NumericStatistics& {
+                return f.num_stats();
+              }),
+          missing, result->mutable_num_stats());
+      break;
+    case FeatureNameStatistics::kStringStats:
+      MergeStringStatistics(
+          Collect<StringStatistics>(
+              with_stats,
+              [](const FeatureNameStatistics& f) -> const StringStatistics& {
+                return f.string_stats();
+              }),
+          missing, result->mutable_string_stats());
+      break;
+    case FeatureNameStatistics::kBytesStats:
+      MergeBytesStatistics(
+          Collect<BytesStatistics>(
+              with_stats,
+              [](const FeatureNameStatistics& f) -> const BytesStatistics& {
+                return f.bytes_stats();
+              }),
+          missing, result->mutable_bytes_stats());
+      break;
+    case FeatureNameStatistics::kStructStats:
+      MergeStructStatistics(
+          Collect<StructStatistics>(
+              with_stats,
+              [](const FeatureNameStatistics& f) -> const StructStatistics& {
+                return f.struct_stats();
+              }),
+          missing, result->mutable_struct_stats());
+      break;
+    case FeatureNameStatistics::STATS_NOT_SET:
+      break;
+  }
+  return Status::OK();
+}
+
+// The statistics of a feature in the shards that have it.
+struct FeatureInShards {
+  std::vector<const FeatureNameStatistics*> stats;
+  // The index of the last shard that has the feature.
+  int last_shard = -1;
+  // The examples of the shards that have the feature.
+  MissingExamples present;
+};
+
+}  // namespace
+
+Status MergeDatasetFeatureStatistics(
+    const std::vector<const DatasetFeatureStatistics*>& shards,
+    int num_threads, DatasetFeatureStatistics* result) {
+  result->Clear();
+  // The features in the order in which they are first seen.
+  std::vector<FeatureInShards> features;
+  absl::flat_hash_map<string, int> feature_indices;
+  for (int i = 0; i < shards.size(); ++i) {
+    const DatasetFeatureStatistics& shard = *shards[i];
+    if (result->name().empty()) {
+      result->set_name(shard.name());
+    }
+    result->set_num_examples(result->num_examples() + shard.num_examples());
+    result->set_weighted_num_examples(result->weighted_num_examples() +
+                                      shard.weighted_num_examples());
+    for (const FeatureNameStatistics& feature : shard.features()) {
+      const auto inserted =
+          feature_indices.emplace(GetFeatureKey(feature), features.size());
+      if (inserted.second) {
+        features.emplace_back();
+      }
+      FeatureInShards& feature_in_shards = features[inserted.first->second];
+      if (feature_in_shards.last_shard == i) {
+        return errors::InvalidArgument("Feature ", GetFeatureName(feature),
+                                       " appears twice in shard ", i, ".");
+      }
+      feature_in_shards.last_shard = i;
+      feature_in_shards.stats.push_back(&feature);
+      feature_in_shards.present.num_examples += shard.num_examples();
+      feature_in_shards.present.weighted_num_examples +=
+          shard.weighted_num_examples();
+    }
+  }
+
+  std::vector<FeatureNameStatistics*> merged;
+  merged.reserve(features.size());
+  for (int i = 0; i < features.size(); ++i) {
+    merged.push_back(result->add_features());
+  }
+  std::vector<Status> statuses(features.size());
+  const auto merge = [&](int i) {
+    MissingExamples missing;
+    missing.num_examples =
+        result->num_examples() - features[i].present.num_examples;
+    missing.weighted_num_examples = result->weighted_num_examples() -
+                                    features[i].present.weighted_num_examples;
+    statuses[i] = MergeFeature(features[i].stats, missing, merged[i]);
+  };
+  if (num_threads > 1 && features.size() > 1) {
+    // This thread waits for the features, running their tasks meanwhile, so
+    // num_threads - 1 more threads are enough.
+    TaskQueue task_queue("merge_statistics", num_threads - 1);
+    TaskQueue::Group group;
+    for (int i = 0; i < features.size(); ++i) {
+      task_queue.Schedule(&group, [&merge, i]() { merge(i); });
+    }
+    task_queue.Wait(&group);
+  } else {
+    for (int i = 0; i < features.size(); ++i) {
+      merge(i);
+    }
+  }
+  for (const Status& status : statuses) {
+    TF_RETURN_IF_ERROR(status);
+  }
+  return Status::OK();
+}
+
+Status MergeDatasetFeatureStatistics(
+    const std::vector<const DatasetFeatureStatistics*>& shards,
+    DatasetFeatureStatistics* result) {
+  return MergeDatasetFeatureStatistics(shards, /*num_threads=*/1, result);
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
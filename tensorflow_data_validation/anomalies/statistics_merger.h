@@ -0,0 +1,65 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_STATISTICS_MERGER_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_STATISTICS_MERGER_H_
+
+#include <vector>
+
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow_metadata/proto/v0/statistics.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// Merges the statistics of the shards of a dataset, i.e., of disjoint sets of
+// its examples, into the statistics of the whole dataset, which can be
+// validated directly.
+//
+// The features are matched by name or path, and the statistics of a feature
+// are merged as they would have been computed over all the examples:
+// - counts (examples, values, zeros, NaNs, ...) are summed, and a shard
+//   without the feature counts all its examples as missing;
+// - minimums and maximums are combined, and averages (including means and
+//   standard deviations) are weighted by the number of values of each shard;
+// - the counts of the rank histograms and top values are summed by value,
+//   and the most frequent values are kept, as many as the largest shard has;
+// - the histograms of each type and name are summed bucket by bucket if they
+//   have the same buckets in all the shards. Otherwise, like the histograms
+//   aligned to compute the Jensen-Shannon divergence, their values are taken
+//   to be uniform within each bucket: STANDARD histograms are rebucketed into
+//   equal-width buckets, and QUANTILES histograms into equal-mass buckets,
+//   as many as the largest shard has.
+// Some statistics can only be approximated: the median comes from the merged
+// QUANTILES histogram (and is cleared without one), the number of unique
+// values is a lower bound (the largest of the shards, or the number of
+// distinct values seen), and the custom statistics of a feature are those of
+// the first shard that has each of them.
+//
+// Returns an error if a feature has statistics of different types in
+// different shards. The features are merged on num_threads threads.
+Status MergeDatasetFeatureStatistics(
+    const std::vector<const metadata::v0::DatasetFeatureStatistics*>& shards,
+    int num_threads, metadata::v0::DatasetFeatureStatistics* result);
+
+// Same as above, on a single thread.
+Status MergeDatasetFeatureStatistics(
+    const std::vector<const metadata::v0::DatasetFeatureStatistics*>& shards,
+    metadata::v0::DatasetFeatureStatistics* result);
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_STATISTICS_MERGER_H_
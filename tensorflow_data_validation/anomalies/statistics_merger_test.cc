@@ -0,0 +1,286 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/statistics_merger.h"
+
+#include <cmath>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow_data_validation/anomalies/test_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow_metadata/proto/v0/statistics.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::DatasetFeatureStatistics;
+using testing::EqualsProto;
+using testing::ParseTextProtoOrDie;
+
+// Three shards, where "x" is missing from the last one and "s" from the
+// second one.
+std::vector<DatasetFeatureStatistics> GetShards() {
+  return {ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+            name: "shard"
+            num_examples: 4
+            features {
+              name: "x"
+              type: FLOAT
+              num_stats {
+                common_stats {
+                  num_non_missing: 4
+                  min_num_values: 1
+                  max_num_values: 1
+                  avg_num_values: 1
+                  tot_num_values: 4
+                }
+                mean: 1
+                std_dev: 1
+                num_zeros: 1
+                min: 0
+                max: 2
+                histograms {
+                  buckets { low_value: 0 high_value: 1 sample_count: 2 }
+                  buckets { low_value: 1 high_value: 2 sample_count: 2 }
+                }
+              }
+            }
+            features {
+              name: "s"
+              type: STRING
+              string_stats {
+                common_stats {
+                  num_non_missing: 4
+                  min_num_values: 1
+                  max_num_values: 1
+                  avg_num_values: 1
+                  tot_num_values: 4
+                }
+                unique: 2
+                avg_length: 1
+                rank_histogram {
+                  buckets { label: "a" sample_count: 3 }
+                  buckets {
+                    low_rank: 1 high_rank: 1 label: "b" sample_count: 1
+                  }
+                }
+              }
+            })"),
+          ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+            num_examples: 6
+            features {
+              name: "x"
+              type: FLOAT
+              num_stats {
+                common_stats {
+                  num_non_missing: 4
+                  num_missing: 2
+                  min_num_values: 1
+                  max_num_values: 2
+                  avg_num_values: 1.5
+                  tot_num_values: 6
+                }
+                mean: 3
+                min: 3
+                max: 3
+                histograms {
+                  buckets { low_value: 0 high_value: 1 sample_count: 1 }
+                  buckets { low_value: 1 high_value: 2 sample_count: 5 }
+                }
+              }
+            })"),
+          ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+            num_examples: 5
+            features {
+              name: "s"
+              type: STRING
+              string_stats {
+                common_stats {
+                  num_non_missing: 5
+                  min_num_values: 1
+                  max_num_values: 2
+                  avg_num_values: 1.2
+                  tot_num_values: 6
+                }
+                unique: 5
+                avg_length: 2
+                rank_histogram {
+                  buckets { label: "b" sample_count: 4 }
+                  buckets {
+                    low_rank: 1 high_rank: 1 label: "c" sample_count: 2
+                  }
+                }
+              }
+            })")};
+}
+
+std::vector<const DatasetFeatureStatistics*> GetPointers(
+    const std::vector<DatasetFeatureStatistics>& shards) {
+  std::vector<const DatasetFeatureStatistics*> result;
+  for (const DatasetFeatureStatistics& shard : shards) {
+    result.push_back(&shard);
+  }
+  return result;
+}
+
+TEST(MergeDatasetFeatureStatisticsTest, MergesShards) {
+  const std::vector<DatasetFeatureStatistics> shards = GetShards();
+  DatasetFeatureStatistics result;
+  TF_ASSERT_OK(MergeDatasetFeatureStatistics(GetPointers(shards), &result));
+  // sqrt((4 * (1 + 1) + 6 * 9) / 10 - 2.2 * 2.2)
+  EXPECT_NEAR(result.features(0).num_stats().std_dev(), std::sqrt(1.36),
+              1e-9);
+  result.mutable_features(0)->mutable_num_stats()->clear_std_dev();
+  EXPECT_THAT(result, EqualsProto(R"(
+    name: "shard"
+    num_examples: 15
+    features {
+      name: "x"
+      type: FLOAT
+      num_stats {
+        common_stats {
+          num_non_missing: 8
+          num_missing: 7
+          min_num_values: 1
+          max_num_values: 2
+          avg_num_values: 1.25
+          tot_num_values: 10
+        }
+        mean: 2.2
+        num_zeros: 1
+        min: 0
+        max: 3
+        histograms {
+          buckets { low_value: 0 high_value: 1 sample_count: 3 }
+          buckets { low_value: 1 high_value: 2 sample_count: 7 }
+        }
+      }
+    }
+    features {
+      name: "s"
+      type: STRING
+      string_stats {
+        common_stats {
+          num_non_missing: 9
+          num_missing: 6
+          min_num_values: 1
+          max_num_values: 2
+          avg_num_values: 1.11111116
+          tot_num_values: 10
+        }
+        unique: 5
+        avg_length: 1.6
+        rank_histogram {
+          buckets { label: "b" sample_count: 5 }
+          buckets { low_rank: 1 high_rank: 1 label: "a" sample_count: 3 }
+        }
+      }
+    })"));
+}
+
+TEST(MergeDatasetFeatureStatisticsTest, ParallelMergeIsTheSame) {
+  const std::vector<DatasetFeatureStatistics> shards = GetShards();
+  DatasetFeatureStatistics expected;
+  TF_ASSERT_OK(MergeDatasetFeatureStatistics(GetPointers(shards), &expected));
+  DatasetFeatureStatistics result;
+  TF_ASSERT_OK(MergeDatasetFeatureStatistics(GetPointers(shards),
+                                             /*num_threads=*/4, &result));
+  EXPECT_THAT(result, EqualsProto(expected));
+}
+
+TEST(MergeDatasetFeatureStatisticsTest, RebucketsHistograms) {
+  const std::vector<DatasetFeatureStatistics> shards = {
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 4
+        features {
+          name: "x"
+          type: FLOAT
+          num_stats {
+            common_stats { num_non_missing: 4 tot_num_values: 4 }
+            histograms {
+              buckets { low_value: 0 high_value: 1 sample_count: 2 }
+              buckets { low_value: 1 high_value: 2 sample_count: 2 }
+            }
+            histograms {
+              buckets { low_value: 0 high_value: 1 sample_count: 2 }
+              buckets { low_value: 1 high_value: 2 sample_count: 2 }
+              type: QUANTILES
+            }
+          }
+        })"),
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 4
+        features {
+          name: "x"
+          type: FLOAT
+          num_stats {
+            common_stats { num_non_missing: 4 tot_num_values: 4 }
+            histograms {
+              num_nan: 1
+              buckets { low_value: 0 high_value: 2 sample_count: 4 }
+            }
+            histograms {
+              buckets { low_value: 2 high_value: 3 sample_count: 2 }
+              buckets { low_value: 3 high_value: 4 sample_count: 2 }
+              type: QUANTILES
+            }
+          }
+        })")};
+  DatasetFeatureStatistics result;
+  TF_ASSERT_OK(MergeDatasetFeatureStatistics(GetPointers(shards), &result));
+  const auto& num_stats = result.features(0).num_stats();
+  ASSERT_EQ(num_stats.histograms_size(), 2);
+  // The standard histograms are rebucketed into equal-width buckets.
+  EXPECT_THAT(num_stats.histograms(0), EqualsProto(R"(
+    num_nan: 1
+    buckets { low_value: 0 high_value: 1 sample_count: 4 }
+    buckets { low_value: 1 high_value: 2 sample_count: 4 }
+  )"));
+  // The quantiles histograms are rebucketed into equal-mass buckets.
+  EXPECT_THAT(num_stats.histograms(1), EqualsProto(R"(
+    buckets { low_value: 0 high_value: 2 sample_count: 4 }
+    buckets { low_value: 2 high_value: 4 sample_count: 4 }
+    type: QUANTILES
+  )"));
+  EXPECT_DOUBLE_EQ(num_stats.median(), 2.0);
+}
+
+TEST(MergeDatasetFeatureStatisticsTest, DifferentTypes) {
+  const std::vector<DatasetFeatureStatistics> shards = {
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        features { name: "x" type: INT num_stats {} })"),
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        features { name: "x" type: FLOAT num_stats {} })")};
+  DatasetFeatureStatistics result;
+  EXPECT_FALSE(
+      MergeDatasetFeatureStatistics(GetPointers(shards), &result).ok());
+}
+
+TEST(MergeDatasetFeatureStatisticsTest, DuplicateFeature) {
+  const std::vector<DatasetFeatureStatistics> shards = {
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        features { name: "x" type: INT }
+        features { name: "x" type: INT })")};
+  DatasetFeatureStatistics result;
+  EXPECT_FALSE(
+      MergeDatasetFeatureStatistics(GetPointers(shards), &result).ok());
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -15,13 +15,26 @@ limitations under the License.
 
 #include "tensorflow_data_validation/anomalies/statistics_view.h"
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <limits>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
-#include "absl/algorithm/container.h"
+#include "google/protobuf/any.pb.h"
+#include "google/protobuf/io/coded_stream.h"
+#include "google/protobuf/wire_format_lite.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
 #include "tensorflow_data_validation/anomalies/map_util.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/types.h"
@@ -31,13 +44,21 @@ namespace tensorflow {
 namespace data_validation {
 
 namespace {
+using ::tensorflow::metadata::v0::CommonStatistics;
+using ::tensorflow::metadata::v0::CustomStatistic;
 using ::tensorflow::metadata::v0::DatasetFeatureStatistics;
+using ::tensorflow::metadata::v0::DatasetFeatureStatisticsList;
 using ::tensorflow::metadata::v0::FeatureNameStatistics;
 using ::tensorflow::metadata::v0::Histogram;
+using ::tensorflow::metadata::v0::NumericStatistics;
+using ::tensorflow::metadata::v0::RankHistogram;
+using ::tensorflow::metadata::v0::StringStatistics;
 using ::tensorflow::protobuf::RepeatedPtrField;
+using ::tensorflow::protobuf::internal::WireFormatLite;
+using ::tensorflow::protobuf::io::CodedInputStream;
 
 // Returns true if a is a strict prefix of b.
-const bool IsStrictPrefix(const string& a, const string& b) {
+const bool IsStrictPrefix(absl::string_view a, absl::string_view b) {
   return a.length() < b.length() && b.substr(0, a.length()) == a;
 }
 
@@ -50,54 +71,379 @@ const bool HasEmptyStats(const FeatureNameStatistics& feature) {
   return false;
 }
 
+// Reads the serialized fields of a message one at a time.
+class FieldReader {
+ public:
+  explicit FieldReader(absl::string_view serialized)
+      : serialized_(serialized),
+        input_(reinterpret_cast<const uint8*>(serialized.data()),
+               serialized.size()) {}
+
+  // Reads the next field. Returns false at the end of the message, or if the
+  // message is malformed (in which case, ok() is false).
+  bool Next() {
+    const int start = input_.CurrentPosition();
+    const uint32 tag = input_.ReadTag();
+    if (tag == 0) {
+      ok_ = input_.ConsumedEntireMessage();
+      return false;
+    }
+    field_number_ = WireFormatLite::GetTagFieldNumber(tag);
+    payload_ = absl::string_view();
+    if (WireFormatLite::GetTagWireType(tag) ==
+        WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+      uint32 length;
+      if (!input_.ReadVarint32(&length) ||
+          length > serialized_.size() - input_.CurrentPosition()) {
+        ok_ = false;
+        return false;
+      }
+      payload_ = serialized_.substr(input_.CurrentPosition(), length);
+      input_.Skip(length);
+    } else if (!WireFormatLite::SkipField(&input_, tag)) {
+      ok_ = false;
+      return false;
+    }
+    field_ = serialized_.substr(start, input_.CurrentPosition() - start);
+    return true;
+  }
+
+  bool ok() const { return ok_; }
+
+  int field_number() const { return field_number_; }
+
+  // The serialized field, including its tag.
+  absl::string_view field() const { return field_; }
+
+  // The payload of a length-delimited field (e.g., a message), or empty.
+  absl::string_view payload() const { return payload_; }
+
+ private:
+  const absl::string_view serialized_;
+  CodedInputStream input_;
+  bool ok_ = true;
+  int field_number_ = 0;
+  absl::string_view field_;
+  absl::string_view payload_;
+};
+
+// Copies the fields of a serialized CommonStatistics to common_stats, except
+// for the histograms. Returns false if it is malformed.
+bool ParseCommonStatisticsSummary(absl::string_view serialized,
+                                  CommonStatistics* common_stats) {
+  string fields;
+  FieldReader reader(serialized);
+  while (reader.Next()) {
+    if (reader.field_number() !=
+            CommonStatistics::kNumValuesHistogramFieldNumber &&
+        reader.field_number() !=
+            CommonStatistics::kFeatureListLengthHistogramFieldNumber) {
+      fields.append(reader.field().data(), reader.field().size());
+    }
+  }
+  return reader.ok() && common_stats->ParseFromString(fields);
+}
+
+// Parses the summary of a serialized FeatureNameStatistics (see
+// LazyDatasetFeatureStatistics::summary()). Returns false if it is malformed.
+bool ParseFeatureSummary(absl::string_view serialized,
+                         FeatureNameStatistics* summary) {
+  string fields;
+  int stats_field_number = 0;
+  absl::string_view stats;
+  bool has_custom_stats = false;
+  FieldReader reader(serialized);
+  while (reader.Next()) {
+    switch (reader.field_number()) {
+      case FeatureNameStatistics::kNameFieldNumber:
+      case FeatureNameStatistics::kPathFieldNumber:
+      case FeatureNameStatistics::kTypeFieldNumber:
+        fields.append(reader.field().data(), reader.field().size());
+        break;
+      case FeatureNameStatistics::kNumStatsFieldNumber:
+      case FeatureNameStatistics::kStringStatsFieldNumber:
+      case FeatureNameStatistics::kBytesStatsFieldNumber:
+      case FeatureNameStatistics::kStructStatsFieldNumber:
+        // As with any oneof, the last one wins.
+        stats_field_number = reader.field_number();
+        stats = reader.payload();
+        break;
+      case FeatureNameStatistics::kCustomStatsFieldNumber:
+        has_custom_stats = true;
+        break;
+      default:
+        break;
+    }
+  }
+  if (!reader.ok() || !summary->ParseFromString(fields)) {
+    return false;
+  }
+  int common_stats_field_number = 0;
+  CommonStatistics* common_stats = nullptr;
+  switch (stats_field_number) {
+    case FeatureNameStatistics::kNumStatsFieldNumber:
+      common_stats_field_number =
+          tensorflow::metadata::v0::NumericStatistics::
+              kCommonStatsFieldNumber;
+      common_stats = summary->mutable_num_stats()->mutable_common_stats();
+      break;
+    case FeatureNameStatistics::kStringStatsFieldNumber:
+      common_stats_field_number = tensorflow::metadata::v0::StringStatistics::
+          kCommonStatsFieldNumber;
+      common_stats = summary->mutable_string_stats()->mutable_common_stats();
+      break;
+    case FeatureNameStatistics::kBytesStatsFieldNumber:
+      common_stats_field_number =
+          tensorflow::metadata::v0::BytesStatistics::kCommonStatsFieldNumber;
+      common_stats = summary->mutable_bytes_stats()->mutable_common_stats();
+      break;
+    case FeatureNameStatistics::kStructStatsFieldNumber:
+      common_stats_field_number = tensorflow::metadata::v0::StructStatistics::
+          kCommonStatsFieldNumber;
+      common_stats = summary->mutable_struct_stats()->mutable_common_stats();
+      break;
+    default:
+      break;
+  }
+  if (common_stats != nullptr) {
+    // The scalar statistics in StatisticsColumns, other than the common ones.
+    string scalar_fields;
+    FieldReader stats_reader(stats);
+    while (stats_reader.Next()) {
+      const int field_number = stats_reader.field_number();
+      if (field_number == common_stats_field_number) {
+        if (!ParseCommonStatisticsSummary(stats_reader.payload(),
+                                          common_stats)) {
+          return false;
+        }
+      } else if ((stats_field_number ==
+                      FeatureNameStatistics::kNumStatsFieldNumber &&
+                  (field_number == NumericStatistics::kMinFieldNumber ||
+                   field_number == NumericStatistics::kMaxFieldNumber)) ||
+                 (stats_field_number ==
+                      FeatureNameStatistics::kStringStatsFieldNumber &&
+                  field_number == StringStatistics::kUniqueFieldNumber)) {
+        scalar_fields.append(stats_reader.field().data(),
+                             stats_reader.field().size());
+      }
+    }
+    if (!stats_reader.ok()) {
+      return false;
+    }
+    if (!scalar_fields.empty()) {
+      const bool merged =
+          stats_field_number == FeatureNameStatistics::kNumStatsFieldNumber
+              ? summary->mutable_num_stats()->MergeFromString(scalar_fields)
+              : summary->mutable_string_stats()->MergeFromString(
+                    scalar_fields);
+      if (!merged) {
+        return false;
+      }
+    }
+  }
+  if (has_custom_stats) {
+    summary->add_custom_stats();
+  }
+  return true;
+}
+
+// Returns the common statistics of a feature. The feature must have stats.
+const CommonStatistics& GetCommonStatistics(
+    const FeatureNameStatistics& feature) {
+  if (feature.has_num_stats()) {
+    return feature.num_stats().common_stats();
+  } else if (feature.has_string_stats()) {
+    return feature.string_stats().common_stats();
+  } else if (feature.has_bytes_stats()) {
+    return feature.bytes_stats().common_stats();
+  } else if (feature.has_struct_stats()) {
+    return feature.struct_stats().common_stats();
+  }
+  LOG(FATAL) << "Unknown statistics (or missing stats): "
+             << feature.DebugString();
+}
+
+// Returns true if there are weighted statistics with parity with the
+// unweighted statistics.
+bool WeightedStatisticsExist(const CommonStatistics& common_stats) {
+  return common_stats.has_weighted_common_stats() &&
+         (common_stats.presence_and_valency_stats().size() ==
+          common_stats.weighted_presence_and_valency_stats().size());
+}
+
 }  // namespace
 
+Status LazyDatasetFeatureStatistics::Create(
+    absl::string_view serialized,
+    std::shared_ptr<const LazyDatasetFeatureStatistics>* result) {
+  // The constructor is private, so absl::make_unique can't call it.
+  std::unique_ptr<LazyDatasetFeatureStatistics> lazy(
+      new LazyDatasetFeatureStatistics());
+  string header;
+  FieldReader reader(serialized);
+  while (reader.Next()) {
+    if (reader.field_number() ==
+        DatasetFeatureStatistics::kFeaturesFieldNumber) {
+      lazy->features_.emplace_back(reader.payload());
+      if (!ParseFeatureSummary(reader.payload(),
+                               &lazy->features_.back().summary)) {
+        return errors::InvalidArgument(
+            "Failed to parse the FeatureNameStatistics at index ",
+            lazy->features_.size() - 1);
+      }
+    } else {
+      header.append(reader.field().data(), reader.field().size());
+    }
+  }
+  if (!reader.ok() || !lazy->header_.ParseFromString(header)) {
+    return errors::InvalidArgument(
+        "Failed to parse DatasetFeatureStatistics proto.");
+  }
+  *result = std::move(lazy);
+  return Status::OK();
+}
+
+Status SplitDatasetFeatureStatisticsList(
+    absl::string_view serialized, std::vector<absl::string_view>* datasets,
+    std::vector<string>* names) {
+  datasets->clear();
+  names->clear();
+  FieldReader list_reader(serialized);
+  while (list_reader.Next()) {
+    if (list_reader.field_number() !=
+        DatasetFeatureStatisticsList::kDatasetsFieldNumber) {
+      continue;
+    }
+    datasets->push_back(list_reader.payload());
+    names->emplace_back();
+    FieldReader reader(list_reader.payload());
+    while (reader.Next()) {
+      // As when parsing, the last name wins.
+      if (reader.field_number() == DatasetFeatureStatistics::kNameFieldNumber) {
+        names->back() = string(reader.payload());
+      }
+    }
+    if (!reader.ok()) {
+      return errors::InvalidArgument(
+          "Failed to parse the DatasetFeatureStatistics at index ",
+          datasets->size() - 1);
+    }
+  }
+  if (!list_reader.ok()) {
+    return errors::InvalidArgument(
+        "Failed to parse DatasetFeatureStatisticsList proto.");
+  }
+  return Status::OK();
+}
+
+const FeatureNameStatistics& LazyDatasetFeatureStatistics::feature(
+    int index) const {
+  const Feature& feature = features_[index];
+  absl::call_once(feature.parse_once, [this, &feature, index]() {
+    feature.parsed = absl::make_unique<FeatureNameStatistics>();
+    if (!feature.parsed->ParseFromArray(feature.serialized.data(),
+                                        feature.serialized.size())) {
+      // The feature was already scanned by Create(), so this is unexpected.
+      LOG(ERROR) << "Failed to parse FeatureNameStatistics: "
+                 << feature.summary.DebugString();
+      *feature.parsed = feature.summary;
+      mutex_lock lock(mu_);
+      if (status_.ok()) {
+        status_ = errors::InvalidArgument(
+            "Failed to parse the FeatureNameStatistics at index ", index);
+      }
+    }
+  });
+  return *feature.parsed;
+}
+
+Status LazyDatasetFeatureStatistics::status() const {
+  mutex_lock lock(mu_);
+  return status_;
+}
+
+size_t LazyDatasetFeatureStatistics::GetMemoryUsage() const {
+  size_t result = header_.SpaceUsedLong();
+  for (const Feature& feature : features_) {
+    result += sizeof(Feature) + feature.summary.SpaceUsedLong() -
+              sizeof(feature.summary);
+    if (feature.parsed != nullptr) {
+      result += feature.parsed->SpaceUsedLong();
+    }
+  }
+  return result;
+}
+
 // Context of a feature.
 struct FeatureContext {
   // Index of the parent feature.
   absl::optional<int> parent_index;
   // Index of children of the feature.
   std::vector<int> child_indices;
-  Path path;
+  PathId path_id = PathInterner::kEmptyPathId;
 };
 
 // A class that summarizes the information from the DatasetFeatureStatistics.
-// Takes O(#features log #features) time to initialize,
+// Takes O(#features log #features) time to initialize if the features have
+// names, or time linear in the total size of their paths if they have paths,
 // O(# features) space, and:
 // GetRootFeatures() takes O(# features) time
 // GetChildren() takes O(# children) time
 // GetParent() takes O(1) time
-// GetByPath() takes O(log # features) time.
+// GetByPath() takes time proportional to the size of the path.
 class DatasetStatsViewImpl {
  public:
   DatasetStatsViewImpl(
-      const DatasetFeatureStatistics& data, bool by_weight,
+      std::shared_ptr<const DatasetFeatureStatistics> data, bool by_weight,
       const absl::optional<string>& environment,
       const std::shared_ptr<DatasetStatsView>& previous_span,
       const std::shared_ptr<DatasetStatsView>& serving,
       const std::shared_ptr<DatasetStatsView>& previous_version)
-      : data_(data),
+      : data_owner_(std::move(data)),
+        data_(*data_owner_),
+        by_weight_(by_weight),
+        environment_(environment),
+        previous_span_(previous_span),
+        serving_(serving),
+        previous_version_(previous_version) {
+    Initialize();
+  }
+
+  DatasetStatsViewImpl(
+      std::shared_ptr<const LazyDatasetFeatureStatistics> lazy_data,
+      bool by_weight, const absl::optional<string>& environment,
+      const std::shared_ptr<DatasetStatsView>& previous_span,
+      const std::shared_ptr<DatasetStatsView>& serving,
+      const std::shared_ptr<DatasetStatsView>& previous_version)
+      : lazy_data_(std::move(lazy_data)),
+        data_(lazy_data_->header()),
         by_weight_(by_weight),
         environment_(environment),
         previous_span_(previous_span),
         serving_(serving),
         previous_version_(previous_version) {
-    const auto& features = data_.features();
-    if (std::all_of(features.begin(), features.end(),
-                    [](const FeatureNameStatistics& f) {
-                      // The case of empty feature name is covered by
-                      // FIELD_ID_NOT_SET.
-                      return f.field_id_case() ==
-                                 FeatureNameStatistics::kName ||
-                             f.field_id_case() ==
-                                 FeatureNameStatistics::FIELD_ID_NOT_SET;
-                    })) {
+    Initialize();
+  }
+
+  void Initialize() {
+    context_.resize(features_size());
+    for (int i = 0; i < features_size(); ++i) {
+      feature_caches_.emplace_back();
+    }
+    bool all_names = true;
+    bool all_paths = true;
+    for (int i = 0; i < features_size(); ++i) {
+      // The case of empty feature name is covered by FIELD_ID_NOT_SET.
+      const FeatureNameStatistics::FieldIdCase field_id_case =
+          summary(i).field_id_case();
+      all_names = all_names &&
+                  (field_id_case == FeatureNameStatistics::kName ||
+                   field_id_case == FeatureNameStatistics::FIELD_ID_NOT_SET);
+      all_paths = all_paths && field_id_case == FeatureNameStatistics::kPath;
+    }
+    if (all_names) {
       InitializeWithFeatureName();
-    } else if (std::all_of(features.begin(), features.end(),
-                           [](const FeatureNameStatistics& f) {
-                             return f.field_id_case() ==
-                                    FeatureNameStatistics::kPath;
-                           })) {
+    } else if (all_paths) {
       InitializeWithFeaturePath();
     } else {
       LOG(QFATAL) << "Some features had .name and some features had .path. "
@@ -107,47 +453,80 @@ class DatasetStatsViewImpl {
   }
 
   void InitializeWithFeaturePath() {
-    for (int i = 0; i < data_.features_size(); ++i) {
-      const FeatureNameStatistics& feature = data_.features(i);
-      path_location_[Path(feature.path())] = i;
-      context_[i] = FeatureContext();
-    }
-    for (const auto& path_and_index : path_location_) {
-      const Path& path = path_and_index.first;
-      const int index = path_and_index.second;
+    for (int i = 0; i < features_size(); ++i) {
+      // Interning a path step by step also interns its ancestors, without
+      // copying the path.
+      PathId path_id = PathInterner::kEmptyPathId;
+      for (const string& step : summary(i).path().step()) {
+        path_id = paths_.InternChild(path_id, step);
+      }
+      context_[i].path_id = path_id;
+    }
+    path_location_.assign(paths_.size(), -1);
+    for (int i = 0; i < features_size(); ++i) {
+      // If a path appears more than once, the last statistics are used.
+      path_location_[context_[i].path_id] = i;
+    }
+    for (PathId path_id = 0; path_id < paths_.size(); ++path_id) {
+      const int index = path_location_[path_id];
+      if (index < 0) {
+        continue;
+      }
       FeatureContext& context = context_[index];
-      context.path = path;
-      if (!path.empty()) {
-        const Path parent_path = path.GetParent();
-        auto iter = path_location_.find(parent_path);
-        if (iter != path_location_.end()) {
-          context.parent_index = iter->second;
-          context_[iter->second].child_indices.push_back(index);
-        }
+      context.path_id = path_id;
+      const PathId parent_id = paths_.GetParent(path_id);
+      if (parent_id != PathInterner::kNoPathId &&
+          path_location_[parent_id] >= 0) {
+        context.parent_index = path_location_[parent_id];
+        context_[*context.parent_index].child_indices.push_back(index);
       }
     }
+    // The children are in the order of their paths.
+    for (FeatureContext& context : context_) {
+      std::vector<int>& child_indices = context.child_indices;
+      std::sort(child_indices.begin(), child_indices.end(),
+                [this](int a, int b) {
+                  return paths_.GetPath(context_[a].path_id).last_step() <
+                         paths_.GetPath(context_[b].path_id).last_step();
+                });
+    }
   }
 
   void InitializeWithFeatureName() {
-    // It takes O(n log n) time to construct location, a BST from the name
-    // of a feature to its location in data_.features().
-    // Map from name to location.
-    // data_.features(location[foo]).name() == foo
-    std::map<string, int> location;
+    // It takes O(n log n) time to construct location, the names of the
+    // features sorted alphabetically, each with its location in summary().
+    // The names are not copied.
+    std::vector<std::pair<absl::string_view, int>> location;
+    location.reserve(features_size());
 
-    for (int i = 0; i < data_.features_size(); ++i) {
+    for (int i = 0; i < features_size(); ++i) {
       // TODO(b/124192588): This is a short term fix to ignore features with
       // empty stats. Remove this once we have added a unknown_stats message
       // in the stats proto which would keep track of common_stats for
       // completely missing features.
-      if (HasEmptyStats(data_.features(i))) {
+      if (HasEmptyStats(summary(i))) {
         continue;
       }
-      location[data_.features(i).name()] = i;
-      context_[i] = FeatureContext();
+      location.emplace_back(summary(i).name(), i);
     }
-
-    // After we construct the map, we iterate over the names of features
+    // If a name appears more than once, the last statistics are used.
+    std::stable_sort(location.begin(), location.end(),
+                     [](const std::pair<absl::string_view, int>& a,
+                        const std::pair<absl::string_view, int>& b) {
+                       return a.first < b.first;
+                     });
+    // Unique on the reversed range keeps the last of equal names, and moves
+    // the names that are kept to the end.
+    location.erase(
+        location.begin(),
+        std::unique(location.rbegin(), location.rend(),
+                    [](const std::pair<absl::string_view, int>& a,
+                       const std::pair<absl::string_view, int>& b) {
+                      return a.first == b.first;
+                    })
+            .base());
+
+    // After we construct location, we iterate over the names of features
     // alphabetically. Note that:
     // If feature a is right after feature b alphabetically, the ancestors
     // of feature b are a subset of the ancestors of feature a and possibly
@@ -159,53 +538,251 @@ class DatasetStatsViewImpl {
     // is O(# features)
     std::vector<int> current_ancestors;
 
+    path_location_.reserve(location.size());
     for (const auto& pair : location) {
-      const string& name = pair.first;
+      const absl::string_view name = pair.first;
       int index = pair.second;
       while (!current_ancestors.empty() &&
-             !IsStrictPrefix(data_.features()[current_ancestors.back()].name(),
+             !IsStrictPrefix(summary(current_ancestors.back()).name(),
                              name)) {
         current_ancestors.pop_back();
       }
       if (!current_ancestors.empty()) {
         int parent_index = current_ancestors.back();
-        const string& parent_name = data_.features(parent_index).name();
-        const string& name = data_.features(index).name();
+        const string& parent_name = summary(parent_index).name();
         context_.at(index).parent_index = parent_index;
-        context_.at(index).path = context_.at(parent_index).path.GetChild(
+        context_.at(index).path_id = paths_.InternChild(
+            context_.at(parent_index).path_id,
             name.substr(parent_name.size() + 1));
         context_.at(parent_index).child_indices.push_back(index);
       } else {
-        context_.at(index).path = Path({data_.features(index).name()});
+        context_.at(index).path_id =
+            paths_.InternChild(PathInterner::kEmptyPathId, name);
       }
-      path_location_[context_.at(index).path] = index;
-      if (data_.features(index).type() ==
+      path_location_.resize(paths_.size(), -1);
+      path_location_[context_.at(index).path_id] = index;
+      if (summary(index).type() ==
           tensorflow::metadata::v0::FeatureNameStatistics::STRUCT) {
         current_ancestors.push_back(index);
       }
     }
   }
 
+  // All the fields of the DatasetFeatureStatistics except (possibly) features.
   const DatasetFeatureStatistics& data() const { return data_; }
 
+  int features_size() const {
+    return lazy_data_ ? lazy_data_->features_size() : data_.features_size();
+  }
+
+  // The name (or path) and type of a feature, and whether it has empty stats.
+  // Unlike feature(), this never parses the statistics of the feature.
+  const FeatureNameStatistics& summary(int index) const {
+    return lazy_data_ ? lazy_data_->summary(index) : data_.features(index);
+  }
+
+  const FeatureNameStatistics& feature(int index) const {
+    return lazy_data_ ? lazy_data_->feature(index) : data_.features(index);
+  }
+
   absl::optional<FeatureStatsView> GetByPath(const DatasetStatsView& view,
                                              const Path& path) const {
-    auto ref = path_location_.find(path);
-    if (ref == path_location_.end()) {
-      VLOG(0) << "DatasetStatsViewImpl::GetByPath() can't find: "
-              << path.Serialize();
-      for (const FeatureStatsView& feature_view : view.features()) {
-        VLOG(0) << "  DatasetStatsViewImpl::GetByPath(): path: "
-                << feature_view.GetPath().Serialize();
-      }
+    const PathId path_id = paths_.Find(path);
+    if (path_id == PathInterner::kNoPathId || path_location_[path_id] < 0) {
+      LogMiss(path);
       return absl::nullopt;
     } else {
-      return FeatureStatsView(ref->second, view);
+      return FeatureStatsView(path_location_[path_id], view);
+    }
+  }
+
+  bool HasPath(const Path& path) const {
+    const PathId path_id = paths_.Find(path);
+    return path_id != PathInterner::kNoPathId && path_location_[path_id] >= 0;
+  }
+
+  // Logs that path was not found, with a few of the paths that were. Misses
+  // are expected (e.g. for a feature of the schema that is not in the
+  // statistics), so only the first ones and then one in
+  // kLogEveryNMisses are logged.
+  void LogMiss(const Path& path) const {
+    static constexpr int64 kLogFirstNMisses = 10;
+    static constexpr int64 kLogEveryNMisses = 1000;
+    static constexpr int kMaxPathsLogged = 10;
+    static std::atomic<int64> num_misses(0);
+    const int64 miss = num_misses.fetch_add(1, std::memory_order_relaxed);
+    if (miss >= kLogFirstNMisses && miss % kLogEveryNMisses != 0) {
+      return;
     }
+    int num_paths = 0;
+    string paths;
+    for (PathId path_id = 0;
+         path_id < path_location_.size() && num_paths < kMaxPathsLogged;
+         ++path_id) {
+      if (path_location_[path_id] >= 0) {
+        absl::StrAppend(&paths, num_paths == 0 ? "" : ", ",
+                        paths_.GetSerializedPath(path_id));
+        ++num_paths;
+      }
+    }
+    VLOG(0) << "DatasetStatsViewImpl::GetByPath() can't find: "
+            << path.Serialize() << " (miss " << miss + 1 << ") among "
+            << features_size() << " features, e.g. " << paths;
   }
 
   const Path& GetPath(const FeatureStatsView& view) const {
-    return context_.at(view.index_).path;
+    return paths_.GetPath(context_.at(view.index_).path_id);
+  }
+
+  const string& GetSerializedPath(const FeatureStatsView& view) const {
+    return paths_.GetSerializedPath(context_.at(view.index_).path_id);
+  }
+
+  const StringValueTable& string_value_table(int index) const {
+    FeatureCache& cache = feature_caches_[index];
+    absl::call_once(cache.string_value_table_once, [this, index, &cache]() {
+      const FeatureNameStatistics& stats = feature(index);
+      cache.string_value_table = absl::make_unique<StringValueTable>(
+          by_weight_
+              ? stats.string_stats().weighted_string_stats().rank_histogram()
+              : stats.string_stats().rank_histogram());
+    });
+    return *cache.string_value_table;
+  }
+
+  int custom_stat_index(int index, absl::string_view name, int* count) const {
+    const RepeatedPtrField<CustomStatistic>& custom_stats =
+        feature(index).custom_stats();
+    *count = 0;
+    if (custom_stats.size() < kMinIndexedCustomStats) {
+      int result = -1;
+      for (int i = 0; i < custom_stats.size(); ++i) {
+        if (custom_stats.Get(i).name() == name) {
+          if (result < 0) {
+            result = i;
+          }
+          ++*count;
+        }
+      }
+      return result;
+    }
+    FeatureCache& cache = feature_caches_[index];
+    absl::call_once(cache.custom_stat_index_once, [&custom_stats, &cache]() {
+      cache.custom_stat_index.reserve(custom_stats.size());
+      for (int i = 0; i < custom_stats.size(); ++i) {
+        // emplace keeps the index of the first custom stat with a name.
+        ++cache.custom_stat_index.emplace(custom_stats.Get(i).name(),
+                                          CustomStatLocation{i, 0})
+              .first->second.count;
+      }
+    });
+    const auto iter = cache.custom_stat_index.find(name);
+    if (iter == cache.custom_stat_index.end()) {
+      return -1;
+    }
+    *count = iter->second.count;
+    return iter->second.index;
+  }
+
+  const NaturalLanguageStatsTable& natural_language_stats_table(
+      int index) const {
+    FeatureCache& cache = feature_caches_[index];
+    absl::call_once(
+        cache.natural_language_stats_table_once, [this, index, &cache]() {
+          int count;
+          const int custom_stat = custom_stat_index(index, "nl_statistics",
+                                                    &count);
+          cache.natural_language_stats_table =
+              absl::make_unique<NaturalLanguageStatsTable>(
+                  custom_stat < 0 ? nullptr
+                                  : &feature(index).custom_stats(custom_stat));
+        });
+    return *cache.natural_language_stats_table;
+  }
+
+  const Histogram* histogram(int index, Histogram::HistogramType type) const {
+    FeatureCache& cache = feature_caches_[index];
+    absl::call_once(cache.histograms_once, [this, index, &cache]() {
+      const FeatureNameStatistics& stats = feature(index);
+      if (!stats.has_num_stats()) {
+        return;
+      }
+      const RepeatedPtrField<Histogram>& histograms =
+          by_weight_ ? stats.num_stats().weighted_numeric_stats().histograms()
+                     : stats.num_stats().histograms();
+      // The first histogram of each type is used.
+      for (const Histogram& histogram : histograms) {
+        if (histogram.type() == Histogram::STANDARD) {
+          if (cache.standard_histogram == nullptr) {
+            cache.standard_histogram = &histogram;
+          }
+        } else if (histogram.type() == Histogram::QUANTILES) {
+          if (cache.quantiles_histogram == nullptr) {
+            cache.quantiles_histogram = &histogram;
+          }
+        }
+      }
+    });
+    switch (type) {
+      case Histogram::STANDARD:
+        return cache.standard_histogram;
+      case Histogram::QUANTILES:
+        return cache.quantiles_histogram;
+      default:
+        return nullptr;
+    }
+  }
+
+  const StatisticsColumns& columns() const {
+    absl::call_once(columns_once_, [this]() {
+      auto columns = absl::make_unique<StatisticsColumns>();
+      const int size = features_size();
+      columns->num_present.resize(size, 0.0);
+      columns->num_missing.resize(size, 0.0);
+      columns->min_num_values.resize(size, 0);
+      columns->max_num_values.resize(size, 0);
+      columns->min.resize(size, std::numeric_limits<double>::quiet_NaN());
+      columns->max.resize(size, std::numeric_limits<double>::quiet_NaN());
+      columns->num_unique.resize(size, -1);
+      for (int i = 0; i < size; ++i) {
+        const FeatureNameStatistics& feature = summary(i);
+        if (HasEmptyStats(feature) ||
+            feature.stats_case() == FeatureNameStatistics::STATS_NOT_SET) {
+          continue;
+        }
+        const CommonStatistics& common_stats =
+            data_validation::GetCommonStatistics(feature);
+        if (by_weight_) {
+          columns->num_present[i] =
+              common_stats.weighted_common_stats().num_non_missing();
+          columns->num_missing[i] =
+              common_stats.weighted_common_stats().num_missing();
+        } else {
+          columns->num_present[i] = common_stats.num_non_missing();
+          columns->num_missing[i] = common_stats.num_missing();
+        }
+        if (common_stats.presence_and_valency_stats_size() > 0) {
+          const auto& presence_and_valency_stats =
+              common_stats.presence_and_valency_stats(0);
+          columns->min_num_values[i] =
+              std::max<int>(presence_and_valency_stats.min_num_values(), 0);
+          columns->max_num_values[i] =
+              presence_and_valency_stats.max_num_values();
+        } else {
+          columns->min_num_values[i] =
+              std::max<int>(common_stats.min_num_values(), 0);
+          columns->max_num_values[i] = common_stats.max_num_values();
+        }
+        if (feature.has_num_stats()) {
+          columns->min[i] = feature.num_stats().min();
+          columns->max[i] = feature.num_stats().max();
+        } else if (feature.has_string_stats()) {
+          columns->num_unique[i] = feature.string_stats().unique();
+        }
+      }
+      columns_ = std::move(columns);
+    });
+    return *columns_;
   }
 
   absl::optional<FeatureStatsView> GetParent(
@@ -219,11 +796,41 @@ class DatasetStatsViewImpl {
     }
   }
 
-  std::vector<FeatureStatsView> GetChildren(
-      const FeatureStatsView& view) const {
-    std::vector<FeatureStatsView> result;
-    for (int i : context_.at(view.index_).child_indices) {
-      result.emplace_back(i, view.parent_view_);
+  template <typename Allocator>
+  void AppendChildren(const FeatureStatsView& view,
+                      std::vector<FeatureStatsView, Allocator>* result) const {
+    const std::vector<int>& child_indices =
+        context_.at(view.index_).child_indices;
+    result->reserve(result->size() + child_indices.size());
+    for (int i : child_indices) {
+      result->emplace_back(i, view.parent_view_);
+    }
+  }
+
+  // See DatasetStatsView::GetMemoryUsage(). Does not count the control views.
+  size_t GetMemoryUsage() const {
+    size_t result = sizeof(*this) +
+                    context_.capacity() * sizeof(FeatureContext) +
+                    paths_.GetMemoryUsage() +
+                    path_location_.capacity() * sizeof(int) +
+                    feature_caches_.size() * sizeof(FeatureCache);
+    for (const FeatureContext& context : context_) {
+      result += context.child_indices.capacity() * sizeof(int);
+    }
+    for (const FeatureCache& cache : feature_caches_) {
+      if (cache.string_value_table != nullptr) {
+        result += cache.string_value_table->GetMemoryUsage();
+      }
+      result += cache.custom_stat_index.capacity() *
+                sizeof(*cache.custom_stat_index.begin());
+      if (cache.natural_language_stats_table != nullptr) {
+        result += cache.natural_language_stats_table->GetMemoryUsage();
+      }
+    }
+    if (columns_ != nullptr) {
+      // Four columns of doubles, two of ints and one of int64s.
+      result += columns_->size() *
+                (4 * sizeof(double) + 2 * sizeof(int) + sizeof(int64));
     }
     return result;
   }
@@ -231,8 +838,15 @@ class DatasetStatsViewImpl {
  private:
   friend DatasetStatsView;
 
-  // Underlying data.
-  const DatasetFeatureStatistics data_;
+  // Owns (or shares the ownership of) the underlying data, if it is owned.
+  const std::shared_ptr<const DatasetFeatureStatistics> data_owner_;
+
+  // The underlying data, if it is parsed lazily.
+  const std::shared_ptr<const LazyDatasetFeatureStatistics> lazy_data_;
+
+  // Underlying data. If lazy_data_ is set, this is its header, and the
+  // features are in lazy_data_.
+  const DatasetFeatureStatistics& data_;
 
   // Whether DatasetFeatureStatistics is accessed by weight or not.
   const bool by_weight_;
@@ -255,57 +869,253 @@ class DatasetStatsViewImpl {
 
   // Context of each feature: parents and children.
   // parallel to features() array in data.
-  std::map<int, FeatureContext> context_;
-
-  // Map from path to the index of the FeatureStatistics containing the
-  // statistics for that path.
-  std::map<Path, int> path_location_;
+  std::vector<FeatureContext> context_;
+
+  // The paths of the features, and of their ancestors.
+  PathInterner paths_;
+
+  // By path id, the index of the FeatureStatistics containing the statistics
+  // for that path, or -1 if there is none.
+  std::vector<int> path_location_;
+
+  // Features with fewer custom stats are searched linearly.
+  static constexpr int kMinIndexedCustomStats = 8;
+
+  // The first occurrence of a custom stat name, and its number of occurrences.
+  struct CustomStatLocation {
+    int index;
+    int count;
+  };
+
+  // Information about a feature that is computed the first time it is needed.
+  struct FeatureCache {
+    absl::once_flag custom_stat_index_once;
+    absl::flat_hash_map<absl::string_view, CustomStatLocation>
+        custom_stat_index;
+    absl::once_flag string_value_table_once;
+    std::unique_ptr<const StringValueTable> string_value_table;
+    absl::once_flag natural_language_stats_table_once;
+    std::unique_ptr<const NaturalLanguageStatsTable>
+        natural_language_stats_table;
+    // The (weighted) histograms of each type, or nullptr.
+    absl::once_flag histograms_once;
+    const Histogram* standard_histogram = nullptr;
+    const Histogram* quantiles_histogram = nullptr;
+  };
+
+  // Parallel to features() array in data. A deque, since a FeatureCache can
+  // be neither copied nor moved.
+  mutable std::deque<FeatureCache> feature_caches_;
+
+  // The columnar summary of the features, built the first time it is needed.
+  mutable absl::once_flag columns_once_;
+  mutable std::unique_ptr<const StatisticsColumns> columns_;
 };
 
+StringValueTable::StringValueTable(const RankHistogram& histogram) {
+  entries_.reserve(histogram.buckets_size());
+  for (const RankHistogram::Bucket& bucket : histogram.buckets()) {
+    entries_.emplace_back(bucket.label(), bucket.sample_count());
+  }
+  const auto value_less = [](const Entry& a, const Entry& b) {
+    return a.first < b.first;
+  };
+  const auto value_equal = [](const Entry& a, const Entry& b) {
+    return a.first == b.first;
+  };
+  // The sort is stable, so that the first count of a value is kept.
+  std::stable_sort(entries_.begin(), entries_.end(), value_less);
+  entries_.erase(std::unique(entries_.begin(), entries_.end(), value_equal),
+                 entries_.end());
+  if (size() >= kMinIndexedSize) {
+    index_.reserve(size());
+    for (int i = 0; i < size(); ++i) {
+      index_.emplace(entries_[i].first, i);
+    }
+  }
+}
+
+size_t StringValueTable::GetMemoryUsage() const {
+  return entries_.capacity() * sizeof(Entry) +
+         index_.capacity() * sizeof(*index_.begin());
+}
+
+NaturalLanguageStatsTable::NaturalLanguageStatsTable(
+    const CustomStatistic* custom_stat) {
+  if (custom_stat == nullptr) {
+    return;
+  }
+  found_ = true;
+  if (!custom_stat->any().UnpackTo(&stats_)) {
+    stats_.Clear();
+    return;
+  }
+  decoded_ = true;
+  for (const TokenStatistics& token_stats : stats_.token_statistics()) {
+    switch (token_stats.token_case()) {
+      case TokenStatistics::kIntToken:
+        int_tokens_.emplace(token_stats.int_token(), &token_stats);
+        break;
+      case TokenStatistics::kStringToken:
+        string_tokens_.emplace(token_stats.string_token(), &token_stats);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+const NaturalLanguageStatsTable::TokenStatistics*
+NaturalLanguageStatsTable::FindToken(int64 int_token) const {
+  const auto iter = int_tokens_.find(int_token);
+  return iter == int_tokens_.end() ? nullptr : iter->second;
+}
+
+const NaturalLanguageStatsTable::TokenStatistics*
+NaturalLanguageStatsTable::FindToken(absl::string_view string_token) const {
+  const auto iter = string_tokens_.find(string_token);
+  return iter == string_tokens_.end() ? nullptr : iter->second;
+}
+
+size_t NaturalLanguageStatsTable::GetMemoryUsage() const {
+  return stats_.SpaceUsedLong() +
+         int_tokens_.capacity() * sizeof(*int_tokens_.begin()) +
+         string_tokens_.capacity() * sizeof(*string_tokens_.begin());
+}
+
+const double* StringValueTable::Find(absl::string_view value) const {
+  if (!index_.empty()) {
+    const auto iter = index_.find(value);
+    return iter == index_.end() ? nullptr : &entries_[iter->second].second;
+  }
+  const auto iter = std::lower_bound(
+      entries_.begin(), entries_.end(), value,
+      [](const Entry& entry, absl::string_view value) {
+        return entry.first < value;
+      });
+  if (iter == entries_.end() || iter->first != value) {
+    return nullptr;
+  }
+  return &iter->second;
+}
+
 DatasetStatsView::DatasetStatsView(
     const DatasetFeatureStatistics& data, bool by_weight,
     const absl::optional<string>& environment,
     std::shared_ptr<DatasetStatsView> previous_span,
     std::shared_ptr<DatasetStatsView> serving,
     std::shared_ptr<DatasetStatsView> previous_version)
-    : impl_(new DatasetStatsViewImpl(data, by_weight, environment,
-                                     previous_span, serving,
+    : impl_(new DatasetStatsViewImpl(
+          std::make_shared<const DatasetFeatureStatistics>(data), by_weight,
+          environment, previous_span, serving, previous_version)) {}
+
+DatasetStatsView::DatasetStatsView(
+    std::shared_ptr<const DatasetFeatureStatistics> data, bool by_weight,
+    const absl::optional<string>& environment,
+    std::shared_ptr<DatasetStatsView> previous_span,
+    std::shared_ptr<DatasetStatsView> serving,
+    std::shared_ptr<DatasetStatsView> previous_version)
+    : impl_(new DatasetStatsViewImpl(CHECK_NOTNULL(std::move(data)), by_weight,
+                                     environment, previous_span, serving,
+                                     previous_version)) {}
+
+DatasetStatsView::DatasetStatsView(
+    std::shared_ptr<const LazyDatasetFeatureStatistics> data, bool by_weight,
+    const absl::optional<string>& environment,
+    std::shared_ptr<DatasetStatsView> previous_span,
+    std::shared_ptr<DatasetStatsView> serving,
+    std::shared_ptr<DatasetStatsView> previous_version)
+    : impl_(new DatasetStatsViewImpl(CHECK_NOTNULL(std::move(data)), by_weight,
+                                     environment, previous_span, serving,
                                      previous_version)) {}
 
 DatasetStatsView::DatasetStatsView(const DatasetFeatureStatistics& data,
                                    bool by_weight)
-    : impl_(new DatasetStatsViewImpl(data, by_weight, absl::nullopt,
-                                     std::shared_ptr<DatasetStatsView>(),
-                                     std::shared_ptr<DatasetStatsView>(),
-                                     std::shared_ptr<DatasetStatsView>())) {}
+    : impl_(new DatasetStatsViewImpl(
+          std::make_shared<const DatasetFeatureStatistics>(data), by_weight,
+          absl::nullopt, std::shared_ptr<DatasetStatsView>(),
+          std::shared_ptr<DatasetStatsView>(),
+          std::shared_ptr<DatasetStatsView>())) {}
 
 DatasetStatsView::DatasetStatsView(
     const tensorflow::metadata::v0::DatasetFeatureStatistics& data)
-    : impl_(new DatasetStatsViewImpl(data, false, absl::nullopt,
-                                     std::shared_ptr<DatasetStatsView>(),
-                                     std::shared_ptr<DatasetStatsView>(),
-                                     std::shared_ptr<DatasetStatsView>())) {}
-
-std::vector<FeatureStatsView> DatasetStatsView::features() const {
-  std::vector<FeatureStatsView> result;
-  for (int i = 0; i < impl_->data().features_size(); ++i) {
+    : impl_(new DatasetStatsViewImpl(
+          std::make_shared<const DatasetFeatureStatistics>(data), false,
+          absl::nullopt, std::shared_ptr<DatasetStatsView>(),
+          std::shared_ptr<DatasetStatsView>(),
+          std::shared_ptr<DatasetStatsView>())) {}
+
+template <typename Allocator>
+void DatasetStatsView::AppendFeatures(
+    bool only_roots, std::vector<FeatureStatsView, Allocator>* result) const {
+  // On an arena, growing the result would leave its previous buffers behind.
+  result->reserve(result->size() + impl_->features_size());
+  for (int i = 0; i < impl_->features_size(); ++i) {
     // TODO(b/124192588): This is a short term fix to ignore features with
     // empty stats. Remove this once we have added a unknown_stats message
     // in the stats proto which would keep track of common_stats for
     // completely missing features.
-    if (HasEmptyStats(impl_->data().features(i))) {
+    if (HasEmptyStats(impl_->summary(i))) {
       continue;
     }
-    result.push_back(FeatureStatsView(i, *this));
+    FeatureStatsView feature(i, *this);
+    if (only_roots && feature.GetParent()) {
+      continue;
+    }
+    result->push_back(std::move(feature));
   }
+}
+
+std::vector<FeatureStatsView> DatasetStatsView::features() const {
+  std::vector<FeatureStatsView> result;
+  AppendFeatures(/*only_roots=*/false, &result);
+  return result;
+}
+
+ArenaVector<FeatureStatsView> DatasetStatsView::features(
+    MonotonicArena* arena) const {
+  ArenaVector<FeatureStatsView> result(
+      (ArenaAllocator<FeatureStatsView>(arena)));
+  AppendFeatures(/*only_roots=*/false, &result);
   return result;
 }
 
 const tensorflow::metadata::v0::FeatureNameStatistics&
 DatasetStatsView::feature_name_statistics(int index) const {
   CHECK_GE(index, 0);
-  CHECK_LT(index, impl_->data().features_size());
-  return impl_->data().features(index);
+  CHECK_LT(index, impl_->features_size());
+  return impl_->feature(index);
+}
+
+const StringValueTable& DatasetStatsView::string_value_table(int index) const {
+  CHECK_GE(index, 0);
+  CHECK_LT(index, impl_->features_size());
+  return impl_->string_value_table(index);
+}
+
+int DatasetStatsView::custom_stat_index(int index, absl::string_view name,
+                                        int* count) const {
+  CHECK_GE(index, 0);
+  CHECK_LT(index, impl_->features_size());
+  return impl_->custom_stat_index(index, name, count);
+}
+
+const NaturalLanguageStatsTable&
+DatasetStatsView::natural_language_stats_table(int index) const {
+  CHECK_GE(index, 0);
+  CHECK_LT(index, impl_->features_size());
+  return impl_->natural_language_stats_table(index);
+}
+
+const StatisticsColumns& DatasetStatsView::GetColumns() const {
+  return impl_->columns();
+}
+
+const Histogram* DatasetStatsView::histogram(
+    int index, Histogram::HistogramType type) const {
+  CHECK_GE(index, 0);
+  CHECK_LT(index, impl_->features_size());
+  return impl_->histogram(index, type);
 }
 
 double DatasetStatsView::GetNumExamples() const {
@@ -321,6 +1131,10 @@ absl::optional<FeatureStatsView> DatasetStatsView::GetByPath(
   return impl_->GetByPath(*this, path);
 }
 
+bool DatasetStatsView::HasPath(const Path& path) const {
+  return impl_->HasPath(path);
+}
+
 absl::optional<FeatureStatsView> DatasetStatsView::GetParent(
     const FeatureStatsView& view) const {
   return impl_->GetParent(view);
@@ -330,18 +1144,37 @@ const Path& DatasetStatsView::GetPath(const FeatureStatsView& view) const {
   return impl_->GetPath(view);
 }
 
+const string& DatasetStatsView::GetSerializedPath(
+    const FeatureStatsView& view) const {
+  return impl_->GetSerializedPath(view);
+}
+
 std::vector<FeatureStatsView> DatasetStatsView::GetChildren(
     const FeatureStatsView& view) const {
-  return impl_->GetChildren(view);
+  std::vector<FeatureStatsView> result;
+  impl_->AppendChildren(view, &result);
+  return result;
+}
+
+ArenaVector<FeatureStatsView> DatasetStatsView::GetChildren(
+    const FeatureStatsView& view, MonotonicArena* arena) const {
+  ArenaVector<FeatureStatsView> result(
+      (ArenaAllocator<FeatureStatsView>(arena)));
+  impl_->AppendChildren(view, &result);
+  return result;
 }
 
 std::vector<FeatureStatsView> DatasetStatsView::GetRootFeatures() const {
   std::vector<FeatureStatsView> result;
-  for (const FeatureStatsView& feature : features()) {
-    if (!feature.GetParent()) {
-      result.push_back(feature);
-    }
-  }
+  AppendFeatures(/*only_roots=*/true, &result);
+  return result;
+}
+
+ArenaVector<FeatureStatsView> DatasetStatsView::GetRootFeatures(
+    MonotonicArena* arena) const {
+  ArenaVector<FeatureStatsView> result(
+      (ArenaAllocator<FeatureStatsView>(arena)));
+  AppendFeatures(/*only_roots=*/true, &result);
   return result;
 }
 
@@ -350,8 +1183,12 @@ bool DatasetStatsView::WeightedStatisticsExist() const {
   if (impl_->data().weighted_num_examples() == 0.0) {
     return false;
   }
-  for (const FeatureStatsView& feature_stats_view : features()) {
-    if (!feature_stats_view.WeightedStatisticsExist()) {
+  // Uses the summaries, so that lazily parsed features are not parsed.
+  for (int i = 0; i < impl_->features_size(); ++i) {
+    const FeatureNameStatistics& summary = impl_->summary(i);
+    if (!HasEmptyStats(summary) &&
+        !data_validation::WeightedStatisticsExist(
+            data_validation::GetCommonStatistics(summary))) {
       return false;
     }
   }
@@ -360,6 +1197,30 @@ bool DatasetStatsView::WeightedStatisticsExist() const {
 
 bool DatasetStatsView::by_weight() const { return impl_->by_weight_; }
 
+size_t DatasetStatsView::GetMemoryUsage() const {
+  size_t result = impl_->GetMemoryUsage();
+  for (const std::shared_ptr<DatasetStatsView>* control :
+       {&impl_->previous_span_, &impl_->serving_, &impl_->previous_version_}) {
+    if (*control != nullptr) {
+      result += (*control)->GetMemoryUsage();
+    }
+  }
+  return result;
+}
+
+Status DatasetStatsView::GetParseStatus() const {
+  if (impl_->lazy_data_ != nullptr) {
+    TF_RETURN_IF_ERROR(impl_->lazy_data_->status());
+  }
+  for (const std::shared_ptr<DatasetStatsView>* control :
+       {&impl_->previous_span_, &impl_->serving_, &impl_->previous_version_}) {
+    if (*control != nullptr) {
+      TF_RETURN_IF_ERROR((*control)->GetParseStatus());
+    }
+  }
+  return Status::OK();
+}
+
 const absl::optional<string>& DatasetStatsView::environment() const {
   return impl_->environment_;
 }
@@ -392,10 +1253,7 @@ double FeatureStatsView::GetNumExamples() const {
 }
 
 double FeatureStatsView::GetNumMissing() const {
-  if (parent_view_.by_weight()) {
-    return GetCommonStatistics().weighted_common_stats().num_missing();
-  }
-  return GetCommonStatistics().num_missing();
+  return parent_view_.GetColumns().num_missing[index_];
 }
 
 std::vector<double> FeatureStatsView::GetNumMissingNested() const {
@@ -432,17 +1290,7 @@ absl::optional<double> FeatureStatsView::GetFractionPresent() const {
 
 const tensorflow::metadata::v0::CommonStatistics&
 FeatureStatsView::GetCommonStatistics() const {
-  if (data().has_num_stats()) {
-    return data().num_stats().common_stats();
-  } else if (data().has_string_stats()) {
-    return data().string_stats().common_stats();
-  } else if (data().has_bytes_stats()) {
-    return data().bytes_stats().common_stats();
-  } else if (data().has_struct_stats()) {
-    return data().struct_stats().common_stats();
-  }
-  LOG(FATAL) << "Unknown statistics (or missing stats): "
-             << data().DebugString();
+  return data_validation::GetCommonStatistics(data());
 }
 
 std::vector<std::pair<int, int>> FeatureStatsView::GetMinMaxNumValues() const {
@@ -465,48 +1313,73 @@ std::vector<std::pair<int, int>> FeatureStatsView::GetMinMaxNumValues() const {
 
 // Get the number of examples in which this field is present.
 double FeatureStatsView::GetNumPresent() const {
-  if (parent_view_.by_weight()) {
-    return GetCommonStatistics().weighted_common_stats().num_non_missing();
+  return parent_view_.GetColumns().num_present[index_];
+}
+
+bool FeatureStatsView::WeightedCountsHaveSameZeros() const {
+  const CommonStatistics& common_stats = GetCommonStatistics();
+  const tensorflow::metadata::v0::WeightedCommonStatistics&
+      weighted_common_stats = common_stats.weighted_common_stats();
+  if ((common_stats.num_non_missing() == 0) !=
+          (weighted_common_stats.num_non_missing() == 0) ||
+      (common_stats.num_missing() == 0) !=
+          (weighted_common_stats.num_missing() == 0)) {
+    return false;
+  }
+  const auto& levels = common_stats.presence_and_valency_stats();
+  const auto& weighted_levels =
+      common_stats.weighted_presence_and_valency_stats();
+  if (levels.size() != weighted_levels.size()) {
+    return false;
   }
-  return GetCommonStatistics().num_non_missing();
+  for (int i = 0; i < levels.size(); ++i) {
+    if ((levels.Get(i).num_missing() == 0) !=
+        (weighted_levels.Get(i).num_missing() == 0)) {
+      return false;
+    }
+  }
+  return true;
 }
 
 std::map<string, double> FeatureStatsView::GetStringValuesWithCounts() const {
   std::map<string, double> result;
-  const tensorflow::metadata::v0::RankHistogram& histogram =
-      (parent_view_.by_weight())
-          ? data().string_stats().weighted_string_stats().rank_histogram()
-          : data().string_stats().rank_histogram();
-  for (const tensorflow::metadata::v0::RankHistogram::Bucket& bucket :
-       histogram.buckets()) {
-    result.insert({bucket.label(), bucket.sample_count()});
+  for (const StringValueTable::Entry& entry : GetStringValueTable()) {
+    result.emplace_hint(result.end(), string(entry.first), entry.second);
   }
   return result;
 }
 
+const StringValueTable& FeatureStatsView::GetStringValueTable() const {
+  return parent_view_.string_value_table(index_);
+}
+
+const NaturalLanguageStatsTable&
+FeatureStatsView::GetNaturalLanguageStatsTable() const {
+  return parent_view_.natural_language_stats_table(index_);
+}
+
 absl::optional<Histogram> FeatureStatsView::GetStandardHistogram() const {
-  if (!data().has_num_stats()) {
+  const Histogram* histogram = GetStandardHistogramOrNull();
+  if (histogram == nullptr) {
     return absl::nullopt;
   }
-  RepeatedPtrField<Histogram> histograms =
-      (parent_view_.by_weight())
-          ? data().num_stats().weighted_numeric_stats().histograms()
-          : data().num_stats().histograms();
-  for (const auto& histogram : histograms) {
-    if (histogram.type() ==
-        Histogram::HistogramType::Histogram_HistogramType_STANDARD) {
-      return histogram;
-    }
-  }
-  return absl::nullopt;
+  return *histogram;
+}
+
+const Histogram* FeatureStatsView::GetStandardHistogramOrNull() const {
+  return parent_view_.histogram(index_, Histogram::STANDARD);
+}
+
+const Histogram* FeatureStatsView::GetQuantilesHistogramOrNull() const {
+  return parent_view_.histogram(index_, Histogram::QUANTILES);
 }
 
 std::vector<string> FeatureStatsView::GetStringValues() const {
+  const StringValueTable& table = GetStringValueTable();
   std::vector<string> result;
-  std::map<string, double> counts = GetStringValuesWithCounts();
-  for (const auto& pair : counts) {
-    const string& string_value = pair.first;
-    result.push_back(string_value);
+  result.reserve(table.size());
+  for (const StringValueTable::Entry& entry : table) {
+    result.emplace_back(entry.first);
   }
   return result;
 }
@@ -520,7 +1393,7 @@ bool FeatureStatsView::HasInvalidUTF8Strings() const {
   static constexpr char kInvalidString[] = "__BYTES_VALUE__";
   // LINT.ThenChange(../constants.py:invalid_utf8_placeholder)
 
-  return ContainsKey(GetStringValuesWithCounts(), kInvalidString);
+  return GetStringValueTable().Contains(kInvalidString);
 }
 
 const tensorflow::metadata::v0::NumericStatistics& FeatureStatsView::num_stats()
@@ -556,10 +1429,7 @@ double FeatureStatsView::GetTotalValueCountInExamples() const {
 
 // Returns true if the weighted statistics exist.
 bool FeatureStatsView::WeightedStatisticsExist() const {
-  const auto& common_stats = GetCommonStatistics();
-  return common_stats.has_weighted_common_stats() &&
-         (common_stats.presence_and_valency_stats().size() ==
-          common_stats.weighted_presence_and_valency_stats().size());
+  return data_validation::WeightedStatisticsExist(GetCommonStatistics());
 }
 
 absl::optional<FeatureStatsView> FeatureStatsView::GetServing() const {
@@ -604,27 +1474,72 @@ std::vector<FeatureStatsView> FeatureStatsView::GetChildren() const {
   return parent_view_.GetChildren(*this);
 }
 
+ArenaVector<FeatureStatsView> FeatureStatsView::GetChildren(
+    MonotonicArena* arena) const {
+  return parent_view_.GetChildren(*this, arena);
+}
+
 const Path& FeatureStatsView::GetPath() const {
   return parent_view_.GetPath(*this);
 }
 
+const string& FeatureStatsView::GetSerializedPath() const {
+  return parent_view_.GetSerializedPath(*this);
+}
+
 const absl::optional<uint64> FeatureStatsView::GetNumUnique() const {
-  if (data().has_string_stats()) {
-    return data().string_stats().unique();
+  const int64 num_unique = parent_view_.GetColumns().num_unique[index_];
+  if (num_unique >= 0) {
+    return num_unique;
   }
   return absl::nullopt;
 }
 
+uint64 FeatureStatsView::GetFingerprint() const {
+  string serialized;
+  CHECK(SerializeToStringDeterministic(data(), &serialized));
+  return Fingerprint64(serialized);
+}
+
+size_t FeatureStatsView::GetByteSize() const { return data().ByteSizeLong(); }
+
 const tensorflow::metadata::v0::CustomStatistic*
 FeatureStatsView::GetCustomStatByName(
-    const std::string& custom_stat_name) const {
-  auto it = absl::c_find_if(
-      data().custom_stats(),
-      [&custom_stat_name](
-          const tensorflow::metadata::v0::CustomStatistic& stat) {
-        return stat.name() == custom_stat_name;
-      });
-  return it == data().custom_stats().end() ? nullptr : &(*it);
+    absl::string_view custom_stat_name) const {
+  int count;
+  const int custom_stat =
+      parent_view_.custom_stat_index(index_, custom_stat_name, &count);
+  return custom_stat < 0 ? nullptr : &data().custom_stats(custom_stat);
+}
+
+int FeatureStatsView::GetCustomStatCount(
+    absl::string_view custom_stat_name) const {
+  int count;
+  parent_view_.custom_stat_index(index_, custom_stat_name, &count);
+  return count;
+}
+
+std::vector<const tensorflow::metadata::v0::CustomStatistic*>
+FeatureStatsView::GetCustomStatsByNames(
+    std::initializer_list<absl::string_view> custom_stat_names) const {
+  std::vector<int> indices;
+  for (absl::string_view custom_stat_name : custom_stat_names) {
+    int count;
+    const int custom_stat =
+        parent_view_.custom_stat_index(index_, custom_stat_name, &count);
+    if (custom_stat >= 0) {
+      indices.push_back(custom_stat);
+    }
+  }
+  std::sort(indices.begin(), indices.end());
+  // A name may be given more than once.
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+  std::vector<const tensorflow::metadata::v0::CustomStatistic*> result;
+  result.reserve(indices.size());
+  for (int custom_stat : indices) {
+    result.push_back(&data().custom_stats(custom_stat));
+  }
+  return result;
 }
 
 }  // namespace data_validation
@@ -17,13 +17,22 @@ limitations under the License.
 #define TENSORFLOW_DATA_VALIDATION_ANOMALIES_STATISTICS_VIEW_H_
 
 #include <algorithm>
+#include <deque>
+#include <initializer_list>
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/base/call_once.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
 #include "absl/types/optional.h"
+#include "tensorflow_data_validation/anomalies/monotonic_arena.h"
 #include "tensorflow_data_validation/anomalies/path.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_metadata/proto/v0/schema.pb.h"
 #include "tensorflow_metadata/proto/v0/statistics.pb.h"
@@ -35,6 +44,189 @@ class FeatureStatsView;
 
 class DatasetStatsViewImpl;
 
+// The string values of a feature, along with their (weighted) counts, from its
+// rank histogram. The entries are sorted by value, and point into the
+// statistics of the feature, so a table must not outlive them. If a value
+// occurs more than once in the histogram, its first count is used.
+class StringValueTable {
+ public:
+  using Entry = std::pair<absl::string_view, double>;
+
+  explicit StringValueTable(
+      const tensorflow::metadata::v0::RankHistogram& histogram);
+
+  StringValueTable(const StringValueTable&) = delete;
+  StringValueTable& operator=(const StringValueTable&) = delete;
+
+  const std::vector<Entry>& entries() const { return entries_; }
+
+  std::vector<Entry>::const_iterator begin() const { return entries_.begin(); }
+  std::vector<Entry>::const_iterator end() const { return entries_.end(); }
+
+  bool empty() const { return entries_.empty(); }
+
+  int size() const { return entries_.size(); }
+
+  // Returns the count of value, or nullptr if it does not occur.
+  const double* Find(absl::string_view value) const;
+
+  bool Contains(absl::string_view value) const {
+    return Find(value) != nullptr;
+  }
+
+  // An estimate of the memory used by the table, in bytes.
+  size_t GetMemoryUsage() const;
+
+ private:
+  // Tables with fewer entries are searched with a binary search.
+  static constexpr int kMinIndexedSize = 64;
+
+  std::vector<Entry> entries_;
+  // The index of each value in entries_, if it has at least kMinIndexedSize
+  // entries.
+  absl::flat_hash_map<absl::string_view, int> index_;
+};
+
+// The NaturalLanguageStatistics of a feature, decoded from its "nl_statistics"
+// custom stat, with its token statistics indexed by token. The index points
+// into the decoded message. If a token occurs more than once, its first
+// statistics are used.
+class NaturalLanguageStatsTable {
+ public:
+  using TokenStatistics =
+      tensorflow::metadata::v0::NaturalLanguageStatistics::TokenStatistics;
+
+  // custom_stat is nullptr if the feature has no "nl_statistics".
+  explicit NaturalLanguageStatsTable(
+      const tensorflow::metadata::v0::CustomStatistic* custom_stat);
+
+  NaturalLanguageStatsTable(const NaturalLanguageStatsTable&) = delete;
+  NaturalLanguageStatsTable& operator=(const NaturalLanguageStatsTable&) =
+      delete;
+
+  // True if the feature has an "nl_statistics" custom stat.
+  bool found() const { return found_; }
+
+  // True if the custom stat was found, and holds a NaturalLanguageStatistics.
+  bool decoded() const { return decoded_; }
+
+  // The decoded statistics, or an empty message if !decoded().
+  const tensorflow::metadata::v0::NaturalLanguageStatistics& stats() const {
+    return stats_;
+  }
+
+  // Returns the statistics of a token, or nullptr if there are none.
+  const TokenStatistics* FindToken(int64 int_token) const;
+  const TokenStatistics* FindToken(absl::string_view string_token) const;
+
+  // An estimate of the memory used by the table, in bytes.
+  size_t GetMemoryUsage() const;
+
+ private:
+  bool found_ = false;
+  bool decoded_ = false;
+  tensorflow::metadata::v0::NaturalLanguageStatistics stats_;
+  absl::flat_hash_map<int64, const TokenStatistics*> int_tokens_;
+  absl::flat_hash_map<absl::string_view, const TokenStatistics*>
+      string_tokens_;
+};
+
+// A serialized DatasetFeatureStatistics, where the statistics of a feature are
+// only parsed the first time they are accessed. Creating one scans the
+// serialized bytes once, recording where each feature is, along with its name
+// (or path) and type. This makes reading a few features of a large
+// DatasetFeatureStatistics proportional to the features read.
+// Thread-safe.
+class LazyDatasetFeatureStatistics {
+ public:
+  // serialized must outlive the result.
+  static tensorflow::Status Create(
+      absl::string_view serialized,
+      std::shared_ptr<const LazyDatasetFeatureStatistics>* result);
+
+  // All the fields of the DatasetFeatureStatistics except features.
+  const tensorflow::metadata::v0::DatasetFeatureStatistics& header() const {
+    return header_;
+  }
+
+  int features_size() const { return features_.size(); }
+
+  // A summary of a feature, that is cheap to parse: its name (or path), its
+  // type, its common statistics without the histograms, and the other scalar
+  // statistics of StatisticsColumns. custom_stats is non-empty iff it is
+  // non-empty in the feature, but its elements are empty.
+  const tensorflow::metadata::v0::FeatureNameStatistics& summary(
+      int index) const {
+    return features_[index].summary;
+  }
+
+  // The fully parsed feature. Parses it if this is the first access. If it
+  // fails to parse, returns its summary instead, and status() is an error.
+  const tensorflow::metadata::v0::FeatureNameStatistics& feature(
+      int index) const;
+
+  // OK unless some feature returned by feature() so far failed to parse, and
+  // was replaced by its summary. As Create() scanned every feature, this only
+  // happens if the nested statistics of a feature are corrupt.
+  tensorflow::Status status() const;
+
+  // An estimate of the memory used by the header, the summaries and the
+  // features parsed so far, in bytes (not counting the serialized bytes). Must
+  // not be called while features are parsed.
+  size_t GetMemoryUsage() const;
+
+ private:
+  struct Feature {
+    explicit Feature(absl::string_view serialized) : serialized(serialized) {}
+
+    const absl::string_view serialized;
+    tensorflow::metadata::v0::FeatureNameStatistics summary;
+    mutable absl::once_flag parse_once;
+    mutable std::unique_ptr<tensorflow::metadata::v0::FeatureNameStatistics>
+        parsed;
+  };
+
+  LazyDatasetFeatureStatistics() = default;
+
+  tensorflow::metadata::v0::DatasetFeatureStatistics header_;
+  // A deque, since a Feature can be neither copied nor moved.
+  std::deque<Feature> features_;
+
+  mutable mutex mu_;
+  // The first failure to parse a feature.
+  mutable tensorflow::Status status_ TF_GUARDED_BY(mu_);
+};
+
+// Splits a serialized DatasetFeatureStatisticsList into its serialized
+// datasets (e.g., slices), without parsing them, and reads their names. The
+// datasets view the memory of serialized.
+tensorflow::Status SplitDatasetFeatureStatisticsList(
+    absl::string_view serialized, std::vector<absl::string_view>* datasets,
+    std::vector<string>* names);
+
+// A columnar summary of the scalar statistics of all the features of a
+// DatasetStatsView, so that checks across many features can run over
+// contiguous arrays rather than nested protos. Each array is indexed by the
+// index of a feature (see FeatureStatsView::index()). Counts are weighted if
+// the view is.
+struct StatisticsColumns {
+  int size() const { return num_present.size(); }
+
+  std::vector<double> num_present;
+  std::vector<double> num_missing;
+  // The minimum and maximum number of values at the outermost nestedness
+  // level, as in FeatureStatsView::GetMinMaxNumValues().
+  std::vector<int> min_num_values;
+  std::vector<int> max_num_values;
+  // The numeric minimum and maximum, or NaN if the feature has no numeric
+  // statistics.
+  std::vector<double> min;
+  std::vector<double> max;
+  // The number of unique values, or -1 if the feature has no string
+  // statistics.
+  std::vector<int64> num_unique;
+};
+
 // Wrapper for statistics.
 // Designed to be passed by const reference.
 class DatasetStatsView {
@@ -50,6 +242,25 @@ class DatasetStatsView {
       std::shared_ptr<DatasetStatsView> serving,
       std::shared_ptr<DatasetStatsView> previous_version);
 
+  // Same as above, but shares data instead of copying it. To view data that
+  // outlives the view without owning it (e.g., a message on an arena), data
+  // can be a non-owning shared_ptr (constructed with the aliasing constructor
+  // from an empty shared_ptr).
+  DatasetStatsView(
+      std::shared_ptr<const tensorflow::metadata::v0::DatasetFeatureStatistics>
+          data,
+      bool by_weight, const absl::optional<string>& environment,
+      std::shared_ptr<DatasetStatsView> previous_span,
+      std::shared_ptr<DatasetStatsView> serving,
+      std::shared_ptr<DatasetStatsView> previous_version);
+
+  // Same as above, but for lazily parsed data.
+  DatasetStatsView(std::shared_ptr<const LazyDatasetFeatureStatistics> data,
+                   bool by_weight, const absl::optional<string>& environment,
+                   std::shared_ptr<DatasetStatsView> previous_span,
+                   std::shared_ptr<DatasetStatsView> serving,
+                   std::shared_ptr<DatasetStatsView> previous_version);
+
   // Default value of by_weight is false, there is no environment,
   // previous_span, previous_version, or serving.
   explicit DatasetStatsView(
@@ -66,20 +277,64 @@ class DatasetStatsView {
   // Only includes FeatureStatsViews without parents.
   std::vector<FeatureStatsView> GetRootFeatures() const;
 
+  // Same as features() and GetRootFeatures(), but the result is allocated on
+  // arena (or on the heap if arena is null).
+  ArenaVector<FeatureStatsView> features(MonotonicArena* arena) const;
+  ArenaVector<FeatureStatsView> GetRootFeatures(MonotonicArena* arena) const;
+
   // If returns zero, it could just be the default value.
   double GetNumExamples() const;
 
+  // Gets the columnar summary of the features. It is built the first time it
+  // is needed, from the summaries of the features, so that lazily parsed
+  // features are not parsed.
+  const StatisticsColumns& GetColumns() const;
+
+  // An estimate of the memory used by this view and by its control views, in
+  // bytes, not counting the statistics they view. This grows as information
+  // about the features is cached, so it must not be called while the view is
+  // used by other threads.
+  size_t GetMemoryUsage() const;
+
+  // OK unless the statistics of a lazily parsed feature of this view, or of
+  // its control views, failed to parse (see
+  // LazyDatasetFeatureStatistics::status()). Results computed from the view
+  // may then miss anomalies, and must not be returned.
+  tensorflow::Status GetParseStatus() const;
+
   bool by_weight() const;
 
   // If the path does not exist, returns absl::nullopt.
   absl::optional<FeatureStatsView> GetByPath(const Path& path) const;
 
+  // Returns true if there are statistics for the path. Unlike GetByPath(),
+  // this does not log misses, which are expected when probing for the
+  // features of a schema.
+  bool HasPath(const Path& path) const;
+
   // Only call from FeatureStatsView::data().
   // check-fails if index is out of range. However, should never fail if
   // called from FeatureStatsView::data().
   const tensorflow::metadata::v0::FeatureNameStatistics&
   feature_name_statistics(int index) const;
 
+  // Only call from FeatureStatsView::GetStringValueTable().
+  const StringValueTable& string_value_table(int index) const;
+
+  // Only call from FeatureStatsView. Returns the index of the first custom
+  // stat of the feature called name, or -1 if there is none, and sets *count
+  // to the number of custom stats called name.
+  int custom_stat_index(int index, absl::string_view name, int* count) const;
+
+  // Only call from FeatureStatsView::GetNaturalLanguageStatsTable().
+  const NaturalLanguageStatsTable& natural_language_stats_table(
+      int index) const;
+
+  // Only call from FeatureStatsView. Returns the (weighted) histogram of the
+  // type, or nullptr.
+  const tensorflow::metadata::v0::Histogram* histogram(
+      int index, tensorflow::metadata::v0::Histogram::HistogramType type) const;
+
   // Returns true if the weighted statistics exist.
   // Weighted stats must have feature parity with unweighted stats.
   // Note: this is independent of by_weight_.
@@ -98,9 +353,17 @@ class DatasetStatsView {
 
   const Path& GetPath(const FeatureStatsView& view) const;
 
+  // Same as GetPath(view).Serialize(), computed once per feature.
+  const string& GetSerializedPath(const FeatureStatsView& view) const;
+
   // Gets the children of a FeatureStatsView.
   std::vector<FeatureStatsView> GetChildren(const FeatureStatsView& view) const;
 
+  // Same as above, but the result is allocated on arena (or on the heap if
+  // arena is null).
+  ArenaVector<FeatureStatsView> GetChildren(const FeatureStatsView& view,
+                                            MonotonicArena* arena) const;
+
   const absl::optional<string>& environment() const;
 
   const absl::optional<DatasetStatsView> GetPreviousSpan() const;
@@ -113,6 +376,12 @@ class DatasetStatsView {
   // Guaranteed not to be null. This being a shared_ptr makes this object
   // lightweight.
   std::shared_ptr<const DatasetStatsViewImpl> impl_;
+
+  // Appends the features (only the ones without parents if only_roots) to
+  // result.
+  template <typename Allocator>
+  void AppendFeatures(bool only_roots,
+                      std::vector<FeatureStatsView, Allocator>* result) const;
 };
 
 // Provides a view into the DatasetFeatureStatistics from a particular column.
@@ -125,6 +394,9 @@ class FeatureStatsView {
 
   const Path& GetPath() const;
 
+  // Same as GetPath().Serialize(), computed once per feature.
+  const string& GetSerializedPath() const;
+
   const absl::optional<string>& environment() const {
     return parent_view_.environment();
   }
@@ -142,6 +414,13 @@ class FeatureStatsView {
   // feature is present.
   double GetNumPresent() const;
 
+  // Returns true if the weighted counts of the examples where the feature is
+  // present, where it is missing, and where it is missing at each nestedness
+  // level, are zero exactly when the unweighted ones are. Then the checks that
+  // only test these counts for zero see the same data by weight or not.
+  // Note: this is independent of by_weight_.
+  bool WeightedCountsHaveSameZeros() const;
+
   // Returns the minimum and maximum number of values for the feature at each
   // nestedness level.
   std::vector<std::pair<int, int>> GetMinMaxNumValues() const;
@@ -160,14 +439,33 @@ class FeatureStatsView {
   // counts. If there are no string stats, then it returns an empty map.
   std::map<string, double> GetStringValuesWithCounts() const;
 
+  // Same as above, but without copying the strings. The table is built the
+  // first time it is needed, and shared by all the views of the feature.
+  const StringValueTable& GetStringValueTable() const;
+
   // Returns the (weighted) standard histogram, if it exists for the feature.
   absl::optional<tensorflow::metadata::v0::Histogram> GetStandardHistogram()
       const;
 
+  // Same as above, but without copying the histogram. Returns nullptr if it
+  // does not exist. The histograms of a feature are looked up once, and
+  // shared by all the views of the feature.
+  const tensorflow::metadata::v0::Histogram* GetStandardHistogramOrNull() const;
+
+  // Returns the (weighted) quantiles histogram without copying it, or nullptr
+  // if it does not exist for the feature.
+  const tensorflow::metadata::v0::Histogram* GetQuantilesHistogramOrNull()
+      const;
+
   // Returns the strings that occur in the data.
   // If there are no string stats, then it returns an empty map.
   std::vector<string> GetStringValues() const;
 
+  // Returns the natural language statistics of the feature. They are decoded
+  // the first time they are needed, and shared by all the views of the
+  // feature.
+  const NaturalLanguageStatsTable& GetNaturalLanguageStatsTable() const;
+
   // Returns true if the column is a string column and there are some invalid
   // UTF8 strings present.
   bool HasInvalidUTF8Strings() const;
@@ -206,12 +504,27 @@ class FeatureStatsView {
 
   // Returns the custom stat for the underlying FeatureNameStatistics, of a
   // given custom_stat_name. Returns `nullptr` if the custom stat is not
-  // found.
+  // found. If there is more than one, returns the first. Features with many
+  // custom stats are looked up through an index of their names, built the
+  // first time it is needed.
   const tensorflow::metadata::v0::CustomStatistic* GetCustomStatByName(
-      const std::string& custom_stat_name) const;
+      absl::string_view custom_stat_name) const;
+
+  // Returns the number of custom stats called custom_stat_name.
+  int GetCustomStatCount(absl::string_view custom_stat_name) const;
+
+  // Returns the first custom stat of each of custom_stat_names that exists,
+  // in the order in which they occur in the underlying FeatureNameStatistics.
+  std::vector<const tensorflow::metadata::v0::CustomStatistic*>
+  GetCustomStatsByNames(
+      std::initializer_list<absl::string_view> custom_stat_names) const;
 
   std::vector<FeatureStatsView> GetChildren() const;
 
+  // Same as above, but the result is allocated on arena (or on the heap if
+  // arena is null).
+  ArenaVector<FeatureStatsView> GetChildren(MonotonicArena* arena) const;
+
   absl::optional<FeatureStatsView> GetParent() const;
 
   bool is_struct() const {
@@ -222,10 +535,21 @@ class FeatureStatsView {
   // Otherwise, returns nullopt.
   const absl::optional<uint64> GetNumUnique() const;
 
+  // Returns a fingerprint of the underlying FeatureNameStatistics, which is the
+  // same for statistics that are equal.
+  uint64 GetFingerprint() const;
+
+  // Returns the size of the underlying FeatureNameStatistics, serialized.
+  size_t GetByteSize() const;
+
   // Object is assumed to be created from DatasetStatsView::features().
   FeatureStatsView(int index, const DatasetStatsView& parent_view)
       : parent_view_(parent_view), index_(index) {}
 
+  // The index of the feature in the statistics, and in the columns of
+  // parent_view().GetColumns().
+  int index() const { return index_; }
+
  private:
   // Made a friend to access private constructor.
   friend std::vector<FeatureStatsView> DatasetStatsView::features() const;
@@ -0,0 +1,118 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+// Benchmarks of the construction of views of statistics.
+// Run with --benchmarks=all.
+
+#include "tensorflow_data_validation/anomalies/statistics_view.h"
+
+#include <memory>
+
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "tensorflow_data_validation/anomalies/allocation_counter.h"
+#include "tensorflow_data_validation/anomalies/path.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/statistics.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::DatasetFeatureStatistics;
+using ::tensorflow::metadata::v0::FeatureNameStatistics;
+
+// Gets statistics with num_features features, one in ten of which is a struct
+// with the next nine features as children. If use_paths, the features are
+// identified by path, and otherwise by name.
+DatasetFeatureStatistics GetStatistics(int num_features, bool use_paths) {
+  DatasetFeatureStatistics statistics;
+  statistics.set_num_examples(10);
+  string parent;
+  for (int i = 0; i < num_features; ++i) {
+    FeatureNameStatistics* feature = statistics.add_features();
+    const string name = absl::StrCat("feature_", i);
+    if (i % 10 == 0) {
+      parent = name;
+      feature->set_type(FeatureNameStatistics::STRUCT);
+      feature->mutable_struct_stats();
+      if (use_paths) {
+        feature->mutable_path()->add_step(name);
+      } else {
+        feature->set_name(name);
+      }
+    } else {
+      feature->set_type(FeatureNameStatistics::INT);
+      feature->mutable_num_stats();
+      if (use_paths) {
+        feature->mutable_path()->add_step(parent);
+        feature->mutable_path()->add_step(name);
+      } else {
+        feature->set_name(absl::StrCat(parent, ".", name));
+      }
+    }
+  }
+  return statistics;
+}
+
+void RunConstruction(int iters, int num_features, bool use_paths) {
+  ::tensorflow::testing::StopTiming();
+  // Shares the statistics, so that copying them is not timed.
+  const auto statistics = std::make_shared<const DatasetFeatureStatistics>(
+      GetStatistics(num_features, use_paths));
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    const DatasetStatsView view(statistics, /*by_weight=*/false,
+                                /*environment=*/absl::nullopt,
+                                /*previous_span=*/nullptr,
+                                /*serving=*/nullptr,
+                                /*previous_version=*/nullptr);
+    CHECK(view.GetByPath(Path({"feature_0"})));
+  }
+  SetAllocationLabel(start, iters);
+}
+
+void BM_ConstructionWithNames(int iters, int num_features) {
+  RunConstruction(iters, num_features, /*use_paths=*/false);
+}
+BENCHMARK(BM_ConstructionWithNames)->Arg(1000)->Arg(100000);
+
+void BM_ConstructionWithPaths(int iters, int num_features) {
+  RunConstruction(iters, num_features, /*use_paths=*/true);
+}
+BENCHMARK(BM_ConstructionWithPaths)->Arg(1000)->Arg(100000);
+
+// Looks up paths that are not in the statistics.
+void BM_GetByPathMiss(int iters, int num_features) {
+  ::tensorflow::testing::StopTiming();
+  const DatasetFeatureStatistics statistics =
+      GetStatistics(num_features, /*use_paths=*/true);
+  const DatasetStatsView view(statistics);
+  const Path missing({"missing"});
+  ::tensorflow::testing::StartTiming();
+  const AllocationCounts start = GetAllocationCounts();
+  for (int i = 0; i < iters; ++i) {
+    CHECK(!view.GetByPath(missing));
+  }
+  SetAllocationLabel(start, iters);
+}
+BENCHMARK(BM_GetByPathMiss)->Arg(1000)->Arg(100000);
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
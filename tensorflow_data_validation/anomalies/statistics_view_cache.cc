@@ -0,0 +1,111 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/statistics_view_cache.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/mutex.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+// Lazily parsed statistics, along with the serialized statistics they point
+// into.
+struct OwnedStatistics {
+  string serialized;
+  std::shared_ptr<const LazyDatasetFeatureStatistics> statistics;
+};
+
+}  // namespace
+
+StatisticsViewCache::StatisticsViewCache(int max_statistics)
+    : max_statistics_(max_statistics) {}
+
+Status StatisticsViewCache::GetStatistics(
+    absl::string_view serialized,
+    std::shared_ptr<const LazyDatasetFeatureStatistics>* result) {
+  mutex_lock lock(mu_);
+  EntryList::iterator entry;
+  TF_RETURN_IF_ERROR(GetEntry(serialized, &entry));
+  *result = entry->second.statistics;
+  return Status::OK();
+}
+
+Status StatisticsViewCache::GetControlView(
+    absl::string_view serialized, bool by_weight,
+    const absl::optional<string>& environment,
+    std::shared_ptr<DatasetStatsView>* result) {
+  mutex_lock lock(mu_);
+  EntryList::iterator entry;
+  TF_RETURN_IF_ERROR(GetEntry(serialized, &entry));
+  std::shared_ptr<DatasetStatsView>& view =
+      entry->second.control_views[std::make_pair(by_weight, environment)];
+  if (view == nullptr) {
+    view = std::make_shared<DatasetStatsView>(
+        entry->second.statistics, by_weight, environment,
+        /*previous_span=*/nullptr, /*serving=*/nullptr,
+        /*previous_version=*/nullptr);
+  }
+  *result = view;
+  return Status::OK();
+}
+
+StatisticsViewCache::Stats StatisticsViewCache::GetStats() const {
+  mutex_lock lock(mu_);
+  return stats_;
+}
+
+Status StatisticsViewCache::GetEntry(absl::string_view serialized,
+                                     EntryList::iterator* result) {
+  const Fprint128 key = Fingerprint128(serialized);
+  const auto iter = entries_by_key_.find(key);
+  if (iter != entries_by_key_.end()) {
+    entries_.splice(entries_.begin(), entries_, iter->second);
+    ++stats_.hits;
+    *result = iter->second;
+    return Status::OK();
+  }
+  ++stats_.misses;
+  // The statistics point into their own copy of serialized, which they keep
+  // alive, so that they can outlive the cache (and its entry).
+  auto owned = std::make_shared<OwnedStatistics>();
+  owned->serialized = string(serialized);
+  TF_RETURN_IF_ERROR(LazyDatasetFeatureStatistics::Create(
+      owned->serialized, &owned->statistics));
+  Entry entry;
+  entry.statistics = std::shared_ptr<const LazyDatasetFeatureStatistics>(
+      owned, owned->statistics.get());
+  entries_.emplace_front(key, std::move(entry));
+  entries_by_key_[key] = entries_.begin();
+  while (entries_.size() > max_statistics_) {
+    entries_by_key_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  *result = entries_.begin();
+  return Status::OK();
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
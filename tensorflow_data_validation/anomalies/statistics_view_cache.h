@@ -0,0 +1,99 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_STATISTICS_VIEW_CACHE_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_STATISTICS_VIEW_CACHE_H_
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// A cache of lazily parsed statistics and of their views, keyed by a
+// fingerprint of the serialized statistics. This is for statistics that are
+// validated more than once, e.g., the training statistics of a span, which
+// are the previous span statistics of the next span: the features parsed by
+// one validation, and the tables built by the views of control statistics,
+// are reused by the next ones. The
+// statistics are copied, so the serialized statistics need not outlive the
+// cache. At most max_statistics (which must be positive) statistics are kept,
+// evicting the least recently used ones.
+// Thread-safe.
+class StatisticsViewCache {
+ public:
+  struct Stats {
+    int64 hits = 0;
+    int64 misses = 0;
+  };
+
+  explicit StatisticsViewCache(int max_statistics);
+
+  // Gets the statistics serialized as serialized, parsing them lazily if they
+  // are not in the cache.
+  Status GetStatistics(
+      absl::string_view serialized,
+      std::shared_ptr<const LazyDatasetFeatureStatistics>* result);
+
+  // Gets a view of the statistics serialized as serialized, without control
+  // statistics (as the views of control statistics are). The view is built
+  // once for each by_weight and environment.
+  Status GetControlView(absl::string_view serialized, bool by_weight,
+                        const absl::optional<string>& environment,
+                        std::shared_ptr<DatasetStatsView>* result);
+
+  Stats GetStats() const;
+
+ private:
+  struct Entry {
+    std::shared_ptr<const LazyDatasetFeatureStatistics> statistics;
+    // The views built from statistics, by by_weight and environment.
+    std::map<std::pair<bool, absl::optional<string>>,
+             std::shared_ptr<DatasetStatsView>>
+        control_views;
+  };
+  using EntryList = std::list<std::pair<Fprint128, Entry>>;
+
+  // Gets the entry of serialized, adding it (and evicting the least recently
+  // used entries) if needed.
+  Status GetEntry(absl::string_view serialized, EntryList::iterator* result)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int max_statistics_;
+
+  mutable mutex mu_;
+  // The entries, the most recently used first.
+  EntryList entries_ TF_GUARDED_BY(mu_);
+  std::unordered_map<Fprint128, EntryList::iterator, Fprint128Hasher>
+      entries_by_key_ TF_GUARDED_BY(mu_);
+  Stats stats_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_STATISTICS_VIEW_CACHE_H_
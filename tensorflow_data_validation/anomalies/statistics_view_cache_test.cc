@@ -0,0 +1,112 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/statistics_view_cache.h"
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow_data_validation/anomalies/test_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/statistics.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::DatasetFeatureStatistics;
+using testing::ParseTextProtoOrDie;
+
+string SerializedStatistics(int num_examples) {
+  DatasetFeatureStatistics statistics =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        features: {
+          name: 'foo'
+          type: INT
+          num_stats: { common_stats: { num_non_missing: 1 } }
+        })");
+  statistics.set_num_examples(num_examples);
+  return statistics.SerializeAsString();
+}
+
+TEST(StatisticsViewCacheTest, ReusesStatisticsAndViews) {
+  StatisticsViewCache cache(/*max_statistics=*/2);
+  std::shared_ptr<const LazyDatasetFeatureStatistics> statistics;
+  {
+    // The cache keeps its own copy of the serialized statistics.
+    const string serialized = SerializedStatistics(10);
+    TF_ASSERT_OK(cache.GetStatistics(serialized, &statistics));
+  }
+  EXPECT_EQ(statistics->header().num_examples(), 10);
+  EXPECT_EQ(statistics->features_size(), 1);
+  EXPECT_EQ(statistics->feature(0).name(), "foo");
+
+  std::shared_ptr<DatasetStatsView> view;
+  TF_ASSERT_OK(cache.GetControlView(SerializedStatistics(10),
+                                    /*by_weight=*/false,
+                                    /*environment=*/absl::nullopt, &view));
+  EXPECT_EQ(view->GetNumExamples(), 10);
+  std::shared_ptr<DatasetStatsView> same_view;
+  TF_ASSERT_OK(cache.GetControlView(SerializedStatistics(10),
+                                    /*by_weight=*/false,
+                                    /*environment=*/absl::nullopt,
+                                    &same_view));
+  EXPECT_EQ(view, same_view);
+  std::shared_ptr<DatasetStatsView> other_view;
+  TF_ASSERT_OK(cache.GetControlView(SerializedStatistics(10),
+                                    /*by_weight=*/false, string("serving"),
+                                    &other_view));
+  EXPECT_NE(view, other_view);
+
+  const StatisticsViewCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 3);
+  EXPECT_EQ(stats.misses, 1);
+}
+
+TEST(StatisticsViewCacheTest, EvictsLeastRecentlyUsed) {
+  StatisticsViewCache cache(/*max_statistics=*/2);
+  std::shared_ptr<const LazyDatasetFeatureStatistics> a;
+  std::shared_ptr<const LazyDatasetFeatureStatistics> result;
+  TF_ASSERT_OK(cache.GetStatistics(SerializedStatistics(1), &a));
+  TF_ASSERT_OK(cache.GetStatistics(SerializedStatistics(2), &result));
+  TF_ASSERT_OK(cache.GetStatistics(SerializedStatistics(1), &result));
+  EXPECT_EQ(result, a);
+  // 2 is now the least recently used.
+  TF_ASSERT_OK(cache.GetStatistics(SerializedStatistics(3), &result));
+  TF_ASSERT_OK(cache.GetStatistics(SerializedStatistics(1), &result));
+  EXPECT_EQ(result, a);
+  EXPECT_EQ(cache.GetStats().misses, 3);
+  TF_ASSERT_OK(cache.GetStatistics(SerializedStatistics(2), &result));
+  EXPECT_EQ(cache.GetStats().misses, 4);
+  // Evicted statistics stay valid while they are used.
+  TF_ASSERT_OK(cache.GetStatistics(SerializedStatistics(3), &result));
+  TF_ASSERT_OK(cache.GetStatistics(SerializedStatistics(2), &result));
+  EXPECT_EQ(a->header().num_examples(), 1);
+  EXPECT_EQ(a->feature(0).name(), "foo");
+}
+
+TEST(StatisticsViewCacheTest, InvalidStatistics) {
+  StatisticsViewCache cache(/*max_statistics=*/1);
+  std::shared_ptr<const LazyDatasetFeatureStatistics> result;
+  EXPECT_FALSE(cache.GetStatistics("not a proto", &result).ok());
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
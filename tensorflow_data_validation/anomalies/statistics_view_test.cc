@@ -15,13 +15,17 @@ limitations under the License.
 
 #include "tensorflow_data_validation/anomalies/statistics_view.h"
 
+#include <cmath>
+#include <memory>
 #include <string>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
 #include "absl/types/optional.h"
 #include "tensorflow_data_validation/anomalies/statistics_view_test_util.h"
 #include "tensorflow_data_validation/anomalies/test_util.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_metadata/proto/v0/statistics.pb.h"
 
@@ -29,9 +33,14 @@ namespace tensorflow {
 namespace data_validation {
 
 using ::tensorflow::data_validation::testing::DatasetForTesting;
+using ::tensorflow::data_validation::testing::EqualsProto;
 using ::tensorflow::data_validation::testing::ParseTextProtoOrDie;
+using ::tensorflow::metadata::v0::CustomStatistic;
 using ::tensorflow::metadata::v0::DatasetFeatureStatistics;
+using ::tensorflow::metadata::v0::DatasetFeatureStatisticsList;
 using ::tensorflow::metadata::v0::FeatureNameStatistics;
+using ::tensorflow::metadata::v0::NaturalLanguageStatistics;
+using ::tensorflow::metadata::v0::NumericStatistics;
 using ::testing::ContainerEq;
 using ::testing::ElementsAre;
 using ::testing::IsEmpty;
@@ -60,6 +69,234 @@ TEST(DatasetStatsView, Environment) {
   EXPECT_FALSE(view_no_environment.environment());
 }
 
+TEST(DatasetStatsView, SharedData) {
+  const auto current = std::make_shared<const DatasetFeatureStatistics>(
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        features {
+          name: 'bar'
+          type: FLOAT
+          num_stats: {
+            common_stats: { num_missing: 3 min_num_values: 3 max_num_values: 7 }
+          }
+        })"));
+
+  DatasetStatsView view(
+      current, false, "environment_name", std::shared_ptr<DatasetStatsView>(),
+      std::shared_ptr<DatasetStatsView>(), std::shared_ptr<DatasetStatsView>());
+
+  // The view shares the data rather than copying it.
+  EXPECT_EQ(current.use_count(), 2);
+  EXPECT_EQ(view.GetByPath(Path({"bar"}))->GetNumMissing(), 3);
+  EXPECT_EQ(*view.environment(), "environment_name");
+}
+
+TEST(LazyDatasetFeatureStatistics, ParsesFeaturesOnDemand) {
+  const DatasetFeatureStatistics current =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        weighted_num_examples: 5
+        features {
+          name: 'foo'
+          type: STRUCT
+          struct_stats: {
+            common_stats: {
+              num_missing: 2
+              weighted_common_stats: { num_missing: 1 }
+            }
+          }
+        }
+        features {
+          name: 'foo.bar'
+          type: FLOAT
+          num_stats: {
+            common_stats: {
+              num_missing: 3
+              num_values_histogram: { buckets: { sample_count: 7 } }
+              weighted_common_stats: { num_missing: 1.5 }
+            }
+            mean: 4
+          }
+        }
+        features { name: 'empty' })");
+  const string serialized = current.SerializeAsString();
+
+  std::shared_ptr<const LazyDatasetFeatureStatistics> lazy;
+  TF_ASSERT_OK(LazyDatasetFeatureStatistics::Create(serialized, &lazy));
+  EXPECT_THAT(lazy->header(), EqualsProto(R"(num_examples: 10
+                                             weighted_num_examples: 5)"));
+  ASSERT_EQ(lazy->features_size(), 3);
+  EXPECT_THAT(lazy->summary(1), EqualsProto(R"(
+                name: 'foo.bar'
+                type: FLOAT
+                num_stats: {
+                  common_stats: {
+                    num_missing: 3
+                    weighted_common_stats: { num_missing: 1.5 }
+                  }
+                })"));
+  EXPECT_THAT(lazy->summary(2), EqualsProto("name: 'empty'"));
+  EXPECT_THAT(lazy->feature(1), EqualsProto(current.features(1)));
+
+  DatasetStatsView view(lazy, /*by_weight=*/false,
+                        /*environment=*/absl::nullopt,
+                        /* previous_span= */ nullptr,
+                        /* serving= */ nullptr,
+                        /* previous_version= */ nullptr);
+  EXPECT_TRUE(view.WeightedStatisticsExist());
+  EXPECT_EQ(view.features().size(), 2);
+  const absl::optional<FeatureStatsView> bar =
+      view.GetByPath(Path({"foo", "bar"}));
+  ASSERT_TRUE(bar);
+  EXPECT_EQ(bar->GetNumMissing(), 3);
+  EXPECT_EQ(bar->num_stats().mean(), 4);
+  EXPECT_EQ(bar->GetParent()->GetPath(), Path({"foo"}));
+}
+
+TEST(DatasetStatsView, GetColumns) {
+  const DatasetFeatureStatistics current =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        num_examples: 10
+        weighted_num_examples: 5
+        features {
+          name: 'float'
+          type: FLOAT
+          num_stats: {
+            common_stats: {
+              num_non_missing: 7
+              num_missing: 3
+              min_num_values: 1
+              max_num_values: 2
+              weighted_common_stats: { num_non_missing: 4 num_missing: 1 }
+            }
+            min: -1
+            max: 3
+            mean: 1
+          }
+        }
+        features { name: 'empty' }
+        features {
+          name: 'string'
+          type: STRING
+          string_stats: {
+            common_stats: {
+              num_non_missing: 10
+              presence_and_valency_stats {
+                min_num_values: 2
+                max_num_values: 4
+              }
+              weighted_common_stats: { num_non_missing: 5 }
+            }
+            unique: 5
+          }
+        })");
+  const string serialized = current.SerializeAsString();
+  std::shared_ptr<const LazyDatasetFeatureStatistics> lazy;
+  TF_ASSERT_OK(LazyDatasetFeatureStatistics::Create(serialized, &lazy));
+  // The summaries have the scalar statistics of the columns.
+  EXPECT_EQ(lazy->summary(0).num_stats().min(), -1);
+  EXPECT_EQ(lazy->summary(0).num_stats().max(), 3);
+  EXPECT_EQ(lazy->summary(0).num_stats().mean(), 0);
+  EXPECT_EQ(lazy->summary(2).string_stats().unique(), 5);
+
+  const DatasetStatsView view(lazy, /*by_weight=*/false,
+                              /*environment=*/absl::nullopt,
+                              /* previous_span= */ nullptr,
+                              /* serving= */ nullptr,
+                              /* previous_version= */ nullptr);
+  const StatisticsColumns& columns = view.GetColumns();
+  ASSERT_EQ(columns.size(), 3);
+  EXPECT_THAT(columns.num_present, ElementsAre(7, 0, 10));
+  EXPECT_THAT(columns.num_missing, ElementsAre(3, 0, 0));
+  EXPECT_THAT(columns.min_num_values, ElementsAre(1, 0, 2));
+  EXPECT_THAT(columns.max_num_values, ElementsAre(2, 0, 4));
+  EXPECT_EQ(columns.min[0], -1);
+  EXPECT_EQ(columns.max[0], 3);
+  EXPECT_TRUE(std::isnan(columns.min[2]));
+  EXPECT_TRUE(std::isnan(columns.max[2]));
+  EXPECT_THAT(columns.num_unique, ElementsAre(-1, -1, 5));
+  // The columns are built once.
+  EXPECT_EQ(&columns, &view.GetColumns());
+
+  const DatasetStatsView weighted_view(current, /*by_weight=*/true);
+  EXPECT_THAT(weighted_view.GetColumns().num_present, ElementsAre(4, 0, 5));
+  EXPECT_THAT(weighted_view.GetColumns().num_missing, ElementsAre(1, 0, 0));
+}
+
+TEST(LazyDatasetFeatureStatistics, MalformedStatistics) {
+  const DatasetFeatureStatistics current =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+        features { name: 'bar' type: FLOAT num_stats: { mean: 4 } })");
+  const string serialized = current.SerializeAsString();
+
+  std::shared_ptr<const LazyDatasetFeatureStatistics> lazy;
+  EXPECT_FALSE(LazyDatasetFeatureStatistics::Create(
+                   absl::string_view(serialized).substr(
+                       0, serialized.size() - 1),
+                   &lazy)
+                   .ok());
+  EXPECT_FALSE(LazyDatasetFeatureStatistics::Create("\xff\xff", &lazy).ok());
+}
+
+TEST(LazyDatasetFeatureStatistics, CorruptNestedStatistics) {
+  // A length-delimited field, whose tag and length fit in one byte each.
+  const auto field = [](int field_number, const string& payload) {
+    return string(1, static_cast<char>(field_number << 3 | 2)) +
+           string(1, static_cast<char>(payload.size())) + payload;
+  };
+  // The histogram is truncated, which only a full parse notices.
+  const string num_stats =
+      ParseTextProtoOrDie<NumericStatistics>("mean: 4").SerializeAsString() +
+      field(NumericStatistics::kHistogramsFieldNumber, "\x08");
+  const string feature =
+      ParseTextProtoOrDie<FeatureNameStatistics>("name: 'bar' type: FLOAT")
+          .SerializeAsString() +
+      field(FeatureNameStatistics::kNumStatsFieldNumber, num_stats);
+  const string serialized =
+      ParseTextProtoOrDie<DatasetFeatureStatistics>("num_examples: 10")
+          .SerializeAsString() +
+      field(DatasetFeatureStatistics::kFeaturesFieldNumber, feature);
+
+  std::shared_ptr<const LazyDatasetFeatureStatistics> lazy;
+  TF_ASSERT_OK(LazyDatasetFeatureStatistics::Create(serialized, &lazy));
+  const DatasetStatsView view(lazy, /*by_weight=*/false,
+                              /*environment=*/absl::nullopt,
+                              /*previous_span=*/nullptr, /*serving=*/nullptr,
+                              /*previous_version=*/nullptr);
+  TF_EXPECT_OK(view.GetParseStatus());
+  EXPECT_EQ(lazy->feature(0).name(), "bar");
+  EXPECT_FALSE(lazy->status().ok());
+  EXPECT_FALSE(view.GetParseStatus().ok());
+}
+
+TEST(SplitDatasetFeatureStatisticsList, SplitsDatasets) {
+  const DatasetFeatureStatisticsList list =
+      ParseTextProtoOrDie<DatasetFeatureStatisticsList>(R"(
+        datasets {
+          name: 'a'
+          num_examples: 3
+          features { name: 'bar' type: FLOAT num_stats: { mean: 4 } }
+        }
+        datasets { num_examples: 5 })");
+  const string serialized = list.SerializeAsString();
+  std::vector<absl::string_view> datasets;
+  std::vector<string> names;
+  TF_ASSERT_OK(
+      SplitDatasetFeatureStatisticsList(serialized, &datasets, &names));
+  EXPECT_THAT(names, ElementsAre("a", ""));
+  ASSERT_EQ(datasets.size(), 2);
+  for (int i = 0; i < datasets.size(); ++i) {
+    DatasetFeatureStatistics dataset;
+    ASSERT_TRUE(dataset.ParseFromArray(datasets[i].data(), datasets[i].size()));
+    EXPECT_THAT(dataset, EqualsProto(list.datasets(i)));
+  }
+
+  EXPECT_FALSE(SplitDatasetFeatureStatisticsList(
+                   absl::string_view(serialized).substr(
+                       0, serialized.size() - 1),
+                   &datasets, &names)
+                   .ok());
+}
+
 TEST(FeatureStatsView, Environment) {
   const DatasetFeatureStatistics current =
       ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
@@ -381,6 +618,21 @@ TEST(DatasetStatsView, GetParentGetPath) {
   EXPECT_EQ(actual->GetPath(), Path({"foo", "bar"}));
 }
 
+// If a feature appears more than once, its last statistics are used.
+TEST(DatasetStatsView, GetByPathDuplicateFeature) {
+  for (const string& field_id : {"name: 'foo'", "path: { step: 'foo' }"}) {
+    const DatasetFeatureStatistics input =
+        ParseTextProtoOrDie<DatasetFeatureStatistics>(absl::StrCat(
+            "features: { ", field_id, " type: INT num_stats: {} }",
+            "features: { ", field_id, " type: FLOAT num_stats: {} }"));
+    DatasetStatsView stats(input);
+    absl::optional<FeatureStatsView> actual = stats.GetByPath(Path({"foo"}));
+    ASSERT_TRUE(actual);
+    EXPECT_EQ(actual->type(), FeatureNameStatistics::FLOAT);
+    EXPECT_EQ(actual->GetPath(), Path({"foo"}));
+  }
+}
+
 // foo is not a parent of foo.bar, as they are both floats.
 TEST(DatasetStatsView, GetParentFalsePositiveGetPath) {
   const DatasetFeatureStatistics input =
@@ -633,6 +885,113 @@ TEST(FeatureStatsView, GetStringValuesWithCountsWeighted) {
   EXPECT_THAT(result, ElementsAre(Pair("alpha", 123), Pair("beta", 234)));
 }
 
+TEST(FeatureStatsView, GetStringValueTable) {
+  const FeatureNameStatistics input =
+      ParseTextProtoOrDie<FeatureNameStatistics>(R"(
+        name: 'bar'
+        type: STRING
+        string_stats: {
+          common_stats: { num_missing: 3 max_num_values: 2 }
+          unique: 3
+          rank_histogram: {
+            buckets: { label: "foo" sample_count: 1.5 }
+            buckets: { label: "bar" sample_count: 2 }
+            buckets: { label: "foo" sample_count: 4 }
+            buckets: { label: "baz" sample_count: 3 }
+          }
+        })");
+  const DatasetForTesting dataset(input);
+  const StringValueTable& table =
+      dataset.feature_stats_view().GetStringValueTable();
+  // The first count of a repeated value is kept.
+  EXPECT_THAT(table.entries(), ElementsAre(Pair("bar", 2), Pair("baz", 3),
+                                           Pair("foo", 1.5)));
+  ASSERT_NE(table.Find("baz"), nullptr);
+  EXPECT_EQ(*table.Find("baz"), 3);
+  EXPECT_FALSE(table.Contains("ba"));
+  EXPECT_FALSE(table.Contains("qux"));
+  // The table is built once, and shared by the views of the feature.
+  EXPECT_EQ(&table, &dataset.feature_stats_view().GetStringValueTable());
+}
+
+TEST(FeatureStatsView, GetStringValueTableIndexed) {
+  FeatureNameStatistics input = ParseTextProtoOrDie<FeatureNameStatistics>(R"(
+    name: 'bar'
+    type: STRING)");
+  for (int i = 0; i < 100; ++i) {
+    auto* bucket = input.mutable_string_stats()
+                       ->mutable_rank_histogram()
+                       ->add_buckets();
+    bucket->set_label(absl::StrCat("value_", i));
+    bucket->set_sample_count(i);
+  }
+  const DatasetForTesting dataset(input);
+  const StringValueTable& table =
+      dataset.feature_stats_view().GetStringValueTable();
+  EXPECT_EQ(table.size(), 100);
+  for (int i = 0; i < 100; ++i) {
+    const double* count = table.Find(absl::StrCat("value_", i));
+    ASSERT_NE(count, nullptr);
+    EXPECT_EQ(*count, i);
+  }
+  EXPECT_FALSE(table.Contains("value_100"));
+}
+
+TEST(FeatureStatsView, GetNaturalLanguageStatsTable) {
+  const NaturalLanguageStatistics nl_stats =
+      ParseTextProtoOrDie<NaturalLanguageStatistics>(R"(
+        feature_coverage: 0.5
+        token_statistics: { int_token: 1 frequency: 2 }
+        token_statistics: { string_token: "foo" frequency: 3 }
+        token_statistics: { string_token: "foo" frequency: 4 }
+        token_statistics: { frequency: 5 })");
+  FeatureNameStatistics input = ParseTextProtoOrDie<FeatureNameStatistics>(R"(
+    name: 'bar'
+    type: STRING
+    string_stats: { common_stats: { num_non_missing: 1 } }
+    custom_stats: { name: 'other' num: 1 })");
+  CustomStatistic* custom_stat = input.add_custom_stats();
+  custom_stat->set_name("nl_statistics");
+  custom_stat->mutable_any()->PackFrom(nl_stats);
+  const DatasetForTesting dataset(input);
+  const NaturalLanguageStatsTable& table =
+      dataset.feature_stats_view().GetNaturalLanguageStatsTable();
+  EXPECT_TRUE(table.found());
+  EXPECT_TRUE(table.decoded());
+  EXPECT_EQ(table.stats().feature_coverage(), 0.5);
+  ASSERT_NE(table.FindToken(int64{1}), nullptr);
+  EXPECT_EQ(table.FindToken(int64{1})->frequency(), 2);
+  // The first statistics of a repeated token are kept.
+  ASSERT_NE(table.FindToken(absl::string_view("foo")), nullptr);
+  EXPECT_EQ(table.FindToken(absl::string_view("foo"))->frequency(), 3);
+  EXPECT_EQ(table.FindToken(int64{2}), nullptr);
+  EXPECT_EQ(table.FindToken(absl::string_view("1")), nullptr);
+  // The table is decoded once, and shared by the views of the feature.
+  EXPECT_EQ(&table,
+            &dataset.feature_stats_view().GetNaturalLanguageStatsTable());
+}
+
+TEST(FeatureStatsView, GetNaturalLanguageStatsTableMissing) {
+  const DatasetForTesting missing(ParseTextProtoOrDie<FeatureNameStatistics>(R"(
+    name: 'bar'
+    type: STRING
+    string_stats: { common_stats: { num_non_missing: 1 } })"));
+  EXPECT_FALSE(missing.feature_stats_view().GetNaturalLanguageStatsTable()
+                   .found());
+
+  const DatasetForTesting malformed(
+      ParseTextProtoOrDie<FeatureNameStatistics>(R"(
+        name: 'bar'
+        type: STRING
+        string_stats: { common_stats: { num_non_missing: 1 } }
+        custom_stats: { name: 'nl_statistics' num: 1 })"));
+  const NaturalLanguageStatsTable& table =
+      malformed.feature_stats_view().GetNaturalLanguageStatsTable();
+  EXPECT_TRUE(table.found());
+  EXPECT_FALSE(table.decoded());
+  EXPECT_EQ(table.FindToken(absl::string_view("foo")), nullptr);
+}
+
 // Return the numeric stats, or an empty object if no numeric stats exist.
 TEST(FeatureStatsView, NumStats) {
   const FeatureNameStatistics input =
@@ -944,6 +1303,53 @@ TEST(FeatureStatsView, GetStandardHistogram) {
             absl::nullopt);
 }
 
+TEST(FeatureStatsView, GetHistogramOrNull) {
+  const FeatureNameStatistics statistics =
+      ParseTextProtoOrDie<FeatureNameStatistics>(
+          R"(
+            name: 'integer'
+            type: INT
+            num_stats {
+              common_stats {
+                num_non_missing: 3
+                weighted_common_stats { num_non_missing: 6.0 }
+              }
+              histograms {
+                buckets { low_value: 2.0 high_value: 2.0 sample_count: 3.0 }
+                type: STANDARD
+              }
+              histograms {
+                buckets { low_value: 2.0 high_value: 2.0 sample_count: 3.0 }
+                type: QUANTILES
+              }
+              weighted_numeric_stats {
+                histograms {
+                  buckets { low_value: 2.0 high_value: 2.0 sample_count: 6.0 }
+                  type: QUANTILES
+                }
+              }
+            }
+          )");
+
+  const DatasetForTesting dataset(statistics);
+  const FeatureNameStatistics& feature =
+      dataset.dataset_stats_view().feature_name_statistics(0);
+  EXPECT_EQ(dataset.feature_stats_view().GetStandardHistogramOrNull(),
+            &feature.num_stats().histograms(0));
+  EXPECT_EQ(dataset.feature_stats_view().GetQuantilesHistogramOrNull(),
+            &feature.num_stats().histograms(1));
+
+  const DatasetForTesting weighted_dataset(statistics, /*by_weight=*/true);
+  const FeatureStatsView& weighted_view = weighted_dataset.feature_stats_view();
+  EXPECT_EQ(weighted_view.GetStandardHistogramOrNull(), nullptr);
+  EXPECT_EQ(weighted_view.GetQuantilesHistogramOrNull(),
+            &weighted_dataset.dataset_stats_view()
+                 .feature_name_statistics(0)
+                 .num_stats()
+                 .weighted_numeric_stats()
+                 .histograms(0));
+}
+
 // Return the custom stat by name, or an empty object if no custom stat exists.
 TEST(FeatureStatsView, GetCustomStatsByName) {
   const FeatureNameStatistics input =
@@ -980,6 +1386,37 @@ TEST(FeatureStatsView, GetCustomStatsByName) {
             expected);
 }
 
+TEST(FeatureStatsView, GetCustomStatsByNameIndexed) {
+  // Too few custom stats for their names to be indexed, and enough, each name
+  // occurring twice.
+  for (const int num_custom_stats : {4, 20}) {
+    FeatureNameStatistics input = ParseTextProtoOrDie<FeatureNameStatistics>(R"(
+      name: 'bar'
+      type: FLOAT
+      num_stats: { common_stats: { num_non_missing: 1 } })");
+    for (int i = 0; i < num_custom_stats; ++i) {
+      CustomStatistic* custom_stat = input.add_custom_stats();
+      custom_stat->set_name(
+          absl::StrCat("custom_", i % (num_custom_stats / 2)));
+      custom_stat->set_num(i);
+    }
+    const DatasetForTesting dataset(input);
+    const FeatureStatsView& view = dataset.feature_stats_view();
+    // The first custom stat of a name is returned.
+    ASSERT_NE(view.GetCustomStatByName("custom_1"), nullptr);
+    EXPECT_EQ(view.GetCustomStatByName("custom_1")->num(), 1);
+    EXPECT_EQ(view.GetCustomStatByName("custom"), nullptr);
+    EXPECT_EQ(view.GetCustomStatCount("custom_1"), 2);
+    EXPECT_EQ(view.GetCustomStatCount("custom"), 0);
+    // The custom stats are in the order of the feature, not of the names.
+    const std::vector<const CustomStatistic*> custom_stats =
+        view.GetCustomStatsByNames({"custom_1", "missing", "custom_0"});
+    ASSERT_EQ(custom_stats.size(), 2);
+    EXPECT_EQ(custom_stats[0]->num(), 0);
+    EXPECT_EQ(custom_stats[1]->num(), 1);
+  }
+}
+
 TEST(DatasetStatsView, Features) {
   const FeatureNameStatistics input =
       ParseTextProtoOrDie<FeatureNameStatistics>(R"(
@@ -24,10 +24,12 @@ limitations under the License.
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include "absl/strings/str_cat.h"
 #include "tensorflow_data_validation/anomalies/internal_types.h"
 #include "tensorflow_data_validation/anomalies/proto/feature_statistics_to_proto.pb.h"
 #include "tensorflow_data_validation/anomalies/statistics_view_test_util.h"
 #include "tensorflow_data_validation/anomalies/test_util.h"
+#include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/types.h"
 #include "tensorflow_metadata/proto/v0/schema.pb.h"
 #include "tensorflow_metadata/proto/v0/statistics.pb.h"
@@ -47,8 +49,8 @@ FeatureStatisticsToProtoConfig GetDefaultFeatureStatisticsToProtoConfig() {
 using ::tensorflow::metadata::v0::FeatureNameStatistics;
 using ::tensorflow::metadata::v0::StringDomain;
 using ::testing::ElementsAre;
-using ::testing::Field;
 using ::testing::HasSubstr;
+using ::testing::Property;
 using testing::EqualsProto;
 using testing::ParseTextProtoOrDie;
 
@@ -397,8 +399,8 @@ TEST(EnumType, SurfaceFrequenciesOfMissingValues) {
                                .feature_stats_view(),
                            0, &string_domain);
     EXPECT_THAT(summary.descriptions,
-                ElementsAre(Field(&Description::long_description,
-                                  HasSubstr("gamma (~30%)"))));
+                ElementsAre(Property(&Description::GetLongDescription,
+                                     HasSubstr("gamma (~30%)"))));
   }
 
   // Case: percentage of value < 1%.
@@ -433,8 +435,8 @@ TEST(EnumType, SurfaceFrequenciesOfMissingValues) {
                                .feature_stats_view(),
                            0, &string_domain);
     EXPECT_THAT(summary.descriptions,
-                ElementsAre(Field(&Description::long_description,
-                                  HasSubstr("gamma (<1%)"))));
+                ElementsAre(Property(&Description::GetLongDescription,
+                                     HasSubstr("gamma (<1%)"))));
   }
 }
 
@@ -475,10 +477,10 @@ TEST(EnumType, DomainSizeLimit) {
     EXPECT_TRUE(summary.clear_field);
     EXPECT_THAT(summary.descriptions,
                 ElementsAre(
-                    Field(&Description::long_description,
-                                  HasSubstr("gamma (~30%)")),
-                    Field(&Description::long_description,
-                                  HasSubstr("too many values"))
+                    Property(&Description::GetLongDescription,
+                             HasSubstr("gamma (~30%)")),
+                    Property(&Description::GetLongDescription,
+                             HasSubstr("too many values"))
                     ));
   }
   // Don't delete.
@@ -516,8 +518,8 @@ TEST(EnumType, DomainSizeLimit) {
                            0, &string_domain);
     EXPECT_FALSE(summary.clear_field);
     EXPECT_THAT(summary.descriptions,
-                ElementsAre(Field(&Description::long_description,
-                                  HasSubstr("gamma (~30%)"))));
+                ElementsAre(Property(&Description::GetLongDescription,
+                                     HasSubstr("gamma (~30%)"))));
   }
 }
 
@@ -619,6 +621,56 @@ TEST(Enum, IsSimilar) {
   EXPECT_TRUE(IsSimilarStringDomain(domain, domain, EnumsSimilarConfig()));
 }
 
+// Compares GetSimilarStringDomains() with IsSimilarStringDomain() on every
+// pair of domains.
+void ExpectSameSimilarStringDomains(
+    const tensorflow::protobuf::RepeatedPtrField<StringDomain>& domains,
+    const EnumsSimilarConfig& config) {
+  const std::vector<std::vector<int>> actual =
+      GetSimilarStringDomains(domains, config);
+  ASSERT_EQ(actual.size(), domains.size());
+  for (int a = 0; a < domains.size(); ++a) {
+    std::vector<int> expected;
+    for (int b = a + 1; b < domains.size(); ++b) {
+      if (IsSimilarStringDomain(domains[a], domains[b], config)) {
+        expected.push_back(b);
+      }
+    }
+    EXPECT_EQ(actual[a], expected) << "domain " << a;
+  }
+}
+
+TEST(Enum, GetSimilarStringDomains) {
+  // Domains of 1 to 40 values out of 60, some of them with repeated values,
+  // so that there are identical, similar, and small domains.
+  tensorflow::protobuf::RepeatedPtrField<StringDomain> domains;
+  for (int i = 0; i < 100; ++i) {
+    StringDomain* domain = domains.Add();
+    domain->set_name(absl::StrCat("domain_", i));
+    const int size = 1 + (i * 7) % 40;
+    const int offset = (i * 13) % 20;
+    for (int j = 0; j < size; ++j) {
+      domain->add_value(absl::StrCat("value_", offset + j));
+      if (j % 9 == 0) {
+        domain->add_value(absl::StrCat("value_", offset + j));
+      }
+    }
+  }
+  domains.Add()->set_name("empty");
+  domains.Add()->set_name("empty_too");
+
+  EnumsSimilarConfig config;
+  ExpectSameSimilarStringDomains(domains, config);
+  config.set_min_jaccard_similarity(0.0);
+  ExpectSameSimilarStringDomains(domains, config);
+  config.set_min_jaccard_similarity(0.9);
+  ExpectSameSimilarStringDomains(domains, config);
+  config.set_min_count(0);
+  ExpectSameSimilarStringDomains(domains, config);
+  config.set_min_jaccard_similarity(-1.0);
+  ExpectSameSimilarStringDomains(domains, config);
+}
+
 TEST(Enum, IsCandidate) {
   const FeatureNameStatistics stats =
       ParseTextProtoOrDie<FeatureNameStatistics>(R"(
@@ -16,20 +16,25 @@ limitations under the License.
 #include "tensorflow_data_validation/anomalies/string_domain_util.h"
 
 #include <math.h>
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <map>
+#include <numeric>
 #include <set>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "absl/algorithm/container.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/types/optional.h"
-#include "tensorflow_data_validation/anomalies/map_util.h"
 #include "tensorflow_data_validation/anomalies/proto/feature_statistics_to_proto.pb.h"
 #include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow_data_validation/anomalies/string_pool.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/types.h"
@@ -43,24 +48,15 @@ namespace {
 using ::tensorflow::metadata::v0::StringDomain;
 using ::tensorflow::strings::Printf;
 
-std::set<string> GetStringDomainValues(const StringDomain& string_domain) {
-  std::set<string> result;
-  for (const string& value : string_domain.value()) {
-    result.insert(value);
-  }
-  return result;
-}
-
 std::map<string, double> StringDomainGetMissing(
-    const FeatureStatsView& stats, const StringDomain& string_domain) {
+    const FeatureStatsView& stats, const StringDomainValueSet& valid) {
   // Missing values and their frequencies.
-  const std::set<string> valid = GetStringDomainValues(string_domain);
   std::map<string, double> missing;
-  // Iterate over values in <stats> and mark those that are missing.
-  for (const auto& p : stats.GetStringValuesWithCounts()) {
-    const string& value = p.first;
-    if (!ContainsKey(valid, value)) {
-      missing.insert(p);
+  // Iterate over values in <stats> and mark those that are missing. They are
+  // sorted, so each one is inserted at the end.
+  for (const StringValueTable::Entry& entry : stats.GetStringValueTable()) {
+    if (!valid.contains(entry.first)) {
+      missing.emplace_hint(missing.end(), string(entry.first), entry.second);
     }
   }
   return missing;
@@ -97,16 +93,147 @@ bool IsSimilarStringDomain(const StringDomain& a, const StringDomain& b,
   // Check the overlap between the valid values in the two enums.
   int overlap = 0;
 
-  const std::set<string> set_a = GetStringDomainValues(a);
-  const std::set<string> set_b = GetStringDomainValues(b);
+  // Both domains are interned in the same pool, so that their values are
+  // compared by id.
+  StringPool pool;
+  const StringDomainValueSet set_a = InternStrings(a.value(), &pool);
+  const StringDomainValueSet set_b = InternStrings(b.value(), &pool);
 
-  for (const auto& value : set_b) {
-    if (ContainsKey(set_a, value)) {
+  for (const int32 id : set_b.ids()) {
+    if (set_a.contains_id(id)) {
       ++overlap;
     }
   }
-  const int count_a = set_a.size();
-  const int count_b = set_b.size();
+  return IsSimilarStringDomainOverlap(set_a.size(), set_b.size(), overlap,
+                                      config);
+}
+
+std::vector<std::vector<int>> GetSimilarStringDomains(
+    const tensorflow::protobuf::RepeatedPtrField<StringDomain>&
+        string_domains,
+    const EnumsSimilarConfig& config) {
+  const int num_domains = string_domains.size();
+  // Each domain becomes the sorted set of the ids of its distinct values. The
+  // ids are ordered by increasing number of domains containing the value, so
+  // that the prefixes below hold the rarest values.
+  absl::flat_hash_map<absl::string_view, int> value_ids;
+  std::vector<std::vector<int>> domain_values(num_domains);
+  std::vector<int> frequencies;
+  for (int index = 0; index < num_domains; ++index) {
+    std::vector<int>& values = domain_values[index];
+    for (const string& value : string_domains[index].value()) {
+      const auto inserted = value_ids.emplace(value, value_ids.size());
+      if (inserted.second) {
+        frequencies.push_back(0);
+      }
+      values.push_back(inserted.first->second);
+    }
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    for (const int id : values) {
+      ++frequencies[id];
+    }
+  }
+  std::vector<int> ranks(frequencies.size());
+  {
+    std::vector<int> ids(frequencies.size());
+    std::iota(ids.begin(), ids.end(), 0);
+    std::stable_sort(ids.begin(), ids.end(), [&frequencies](int a, int b) {
+      return frequencies[a] < frequencies[b];
+    });
+    for (int rank = 0; rank < ids.size(); ++rank) {
+      ranks[ids[rank]] = rank;
+    }
+  }
+  for (std::vector<int>& values : domain_values) {
+    for (int& value : values) {
+      value = ranks[value];
+    }
+    std::sort(values.begin(), values.end());
+  }
+
+  // Prefix filtering: if |a & b| >= k, then the first |a| - k + 1 values of
+  // a and the first |b| - k + 1 values of b (in the same order) intersect.
+  // For similar domains, |a & b| >= floor(|a| * min_jaccard_similarity),
+  // since the jaccard similarity is at most |a & b| / |a|. Small domains are
+  // only similar to identical domains, so |a & b| = |a| and only their
+  // rarest value is indexed. Candidate pairs are checked exactly, so the
+  // result is the same as comparing every pair.
+  // A negative (or NaN) threshold makes disjoint domains similar, and then
+  // every pair is a candidate.
+  const double min_jaccard_similarity =
+      std::min(config.min_jaccard_similarity(), 1.0);
+  const bool compare_all = !(min_jaccard_similarity >= 0.0);
+  std::vector<int> prefix_sizes(num_domains);
+  std::vector<std::vector<int>> domains_by_prefix_value(frequencies.size());
+  if (!compare_all) {
+    for (int index = 0; index < num_domains; ++index) {
+      const std::vector<int>& values = domain_values[index];
+      const int size = values.size();
+      const int min_overlap =
+          size > config.min_count()
+              ? static_cast<int>(std::floor(size * min_jaccard_similarity))
+              : size;
+      prefix_sizes[index] = std::min(size, size - min_overlap + 1);
+      for (int i = 0; i < prefix_sizes[index]; ++i) {
+        domains_by_prefix_value[values[i]].push_back(index);
+      }
+    }
+  }
+
+  std::vector<std::vector<int>> result(num_domains);
+  std::vector<int> candidates;
+  // The last domain for which each domain was a candidate.
+  std::vector<int> last_seen(num_domains, -1);
+  for (int index_a = 0; index_a < num_domains; ++index_a) {
+    const std::vector<int>& values_a = domain_values[index_a];
+    candidates.clear();
+    if (compare_all) {
+      for (int index_b = index_a + 1; index_b < num_domains; ++index_b) {
+        candidates.push_back(index_b);
+      }
+    } else {
+      for (int i = 0; i < prefix_sizes[index_a]; ++i) {
+        const std::vector<int>& domains = domains_by_prefix_value[values_a[i]];
+        // The domains are in increasing order of index.
+        for (auto iter = std::upper_bound(domains.begin(), domains.end(),
+                                          index_a);
+             iter != domains.end(); ++iter) {
+          if (last_seen[*iter] != index_a) {
+            last_seen[*iter] = index_a;
+            candidates.push_back(*iter);
+          }
+        }
+      }
+      std::sort(candidates.begin(), candidates.end());
+    }
+    for (const int index_b : candidates) {
+      const std::vector<int>& values_b = domain_values[index_b];
+      int overlap = 0;
+      auto iter_a = values_a.begin();
+      auto iter_b = values_b.begin();
+      while (iter_a != values_a.end() && iter_b != values_b.end()) {
+        if (*iter_a < *iter_b) {
+          ++iter_a;
+        } else if (*iter_b < *iter_a) {
+          ++iter_b;
+        } else {
+          ++overlap;
+          ++iter_a;
+          ++iter_b;
+        }
+      }
+      if (IsSimilarStringDomainOverlap(values_a.size(), values_b.size(),
+                                       overlap, config)) {
+        result[index_a].push_back(index_b);
+      }
+    }
+  }
+  return result;
+}
+
+bool IsSimilarStringDomainOverlap(int count_a, int count_b, int overlap,
+                                  const EnumsSimilarConfig& config) {
   double jaccard_similarity = static_cast<double>(overlap) /
                               static_cast<double>(count_a + count_b - overlap);
   // For smaller enums, it has to be a perfect match.
@@ -117,13 +244,12 @@ bool IsSimilarStringDomain(const StringDomain& a, const StringDomain& b,
 
 bool IsStringDomainCandidate(const FeatureStatsView& feature_stats,
                              const int enum_threshold) {
-  // HasInvalidUTF8Strings() and GetStringValues() both create a map
-  // of all the tokens in feature_stats to their frequency. Theoretically, we
-  // could do this once, but we sacrifice speed for simplicity.
+  // Both HasInvalidUTF8Strings() and the size use the cached value table of
+  // feature_stats, so none of the values are copied.
   if (feature_stats.HasInvalidUTF8Strings()) {
     return false;
   }
-  const std::vector<string> values = feature_stats.GetStringValues();
+  const StringValueTable& values = feature_stats.GetStringValueTable();
   return values.size() <= enum_threshold && !values.empty();
 }
 
@@ -146,16 +272,28 @@ std::vector<Description> UpdateStringDomainSelf(
   if (repeats.empty()) {
     return {};
   }
-  return {{tensorflow::metadata::v0::AnomalyInfo::INVALID_DOMAIN_SPECIFICATION,
-           "Malformed StringDomain",
-           absl::StrCat("Repeated values in StringDomain:",
-                        absl::StrJoin(repeats, ", "))}};
+  return {Description::FromTemplate(
+      tensorflow::metadata::v0::AnomalyInfo::INVALID_DOMAIN_SPECIFICATION,
+      "Malformed StringDomain", "Repeated values in StringDomain:$0",
+      {absl::StrJoin(repeats, ", ")})};
 }
 
 UpdateSummary UpdateStringDomain(const Schema::Updater& updater,
                                  const FeatureStatsView& stats,
                                  double max_off_domain,
                                  StringDomain* string_domain) {
+  StringPool pool;
+  return UpdateSharedStringDomain(
+      updater, stats, max_off_domain, *string_domain,
+      InternStrings(string_domain->value(), &pool),
+      [string_domain]() { return string_domain; });
+}
+
+UpdateSummary UpdateSharedStringDomain(
+    const Schema::Updater& updater, const FeatureStatsView& stats,
+    double max_off_domain, const StringDomain& string_domain,
+    const StringDomainValueSet& values,
+    const std::function<StringDomain*()>& get_string_domain) {
   UpdateSummary summary;
   if (stats.HasInvalidUTF8Strings()) {
     summary.descriptions.push_back(
@@ -168,7 +306,7 @@ UpdateSummary UpdateStringDomain(const Schema::Updater& updater,
     return summary;
   }
   const std::map<string, double> missing =
-      StringDomainGetMissing(stats, *string_domain);
+      StringDomainGetMissing(stats, values);
   // Total number of values in the dataset that do not appear in the schema.
   const double missing_count = absl::c_accumulate(
       missing, /*init=*/0.0,
@@ -176,15 +314,15 @@ UpdateSummary UpdateStringDomain(const Schema::Updater& updater,
         return count + p.second;
       });
   const double total_value_count = stats.GetTotalValueCountInExamples();
+  int domain_size = string_domain.value().size();
   if ((missing_count / total_value_count) > max_off_domain ||
       (max_off_domain == 0 && !missing.empty())) {
-    const Description description = {
+    summary.descriptions.push_back(Description::FromTemplate(
         tensorflow::metadata::v0::AnomalyInfo::
             ENUM_TYPE_UNEXPECTED_STRING_VALUES,
         "Unexpected string values",
-        absl::StrCat(
-            "Examples contain values missing from the schema: ",
-            absl::StrJoin(
+        "Examples contain values missing from the schema: $0. ",
+        {absl::StrJoin(
                 missing, ", ",
                 [total_value_count](
                     string* out,
@@ -197,19 +335,18 @@ UpdateSummary UpdateStringDomain(const Schema::Updater& updater,
                           PercentageAsString(value_and_freq.second,
                                              total_value_count)
                               .c_str()));
-                }),
-            ". ")};
-    summary.descriptions.push_back(description);
-    StringDomainAddMissing(missing, string_domain);
+                })}));
+    StringDomain* updated_string_domain = get_string_domain();
+    StringDomainAddMissing(missing, updated_string_domain);
+    domain_size = updated_string_domain->value().size();
   }
-  const int domain_size = string_domain->value().size();
   if (updater.string_domain_too_big(domain_size)) {
     summary.clear_field = true;
 
-    summary.descriptions.push_back(
-        {tensorflow::metadata::v0::AnomalyInfo::INVALID_DOMAIN_SPECIFICATION,
-         "String domain has too many values",
-         Printf("String domain has too many values (%d).", domain_size)});
+    summary.descriptions.push_back(Description::FromTemplate(
+        tensorflow::metadata::v0::AnomalyInfo::INVALID_DOMAIN_SPECIFICATION,
+        "String domain has too many values",
+        "String domain has too many values ($0).", {domain_size}));
   }
   return summary;
 }
@@ -16,12 +16,14 @@ limitations under the License.
 #ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_STRING_DOMAIN_UTIL_H_
 #define TENSORFLOW_DATA_VALIDATION_ANOMALIES_STRING_DOMAIN_UTIL_H_
 
+#include <functional>
 #include <vector>
 
 #include "tensorflow_data_validation/anomalies/internal_types.h"
 #include "tensorflow_data_validation/anomalies/proto/feature_statistics_to_proto.pb.h"
 #include "tensorflow_data_validation/anomalies/schema.h"
 #include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow_metadata/proto/v0/schema.pb.h"
 
 namespace tensorflow {
@@ -34,6 +36,20 @@ bool IsSimilarStringDomain(const tensorflow::metadata::v0::StringDomain& a,
                            const tensorflow::metadata::v0::StringDomain& b,
                            const EnumsSimilarConfig& config);
 
+// Same as IsSimilarStringDomain(), for two domains with count_a and count_b
+// distinct values, overlap of which are in both.
+bool IsSimilarStringDomainOverlap(int count_a, int count_b, int overlap,
+                                  const EnumsSimilarConfig& config);
+
+// For each string domain, returns the (increasing) indices of the later
+// domains that are similar to it according to IsSimilarStringDomain().
+// Only the pairs of domains sharing one of their rarest values are compared,
+// which gives the same result as comparing every pair.
+std::vector<std::vector<int>> GetSimilarStringDomains(
+    const tensorflow::protobuf::RepeatedPtrField<
+        tensorflow::metadata::v0::StringDomain>& string_domains,
+    const EnumsSimilarConfig& config);
+
 // Returns true if this feature_stats has less than enum_threshold number of
 // unique string values.
 bool IsStringDomainCandidate(const FeatureStatsView& feature_stats,
@@ -55,6 +71,18 @@ UpdateSummary UpdateStringDomain(
     const FeatureStatsView& stats, double max_off_domain,
     tensorflow::metadata::v0::StringDomain* string_domain);
 
+// Same as above, for a string domain shared by many features, whose values
+// are given as a set (see IndexedSchema::GetStringDomainValues()). The stats
+// are checked against values, and get_string_domain is only called, to get
+// the string domain to modify, if the string domain has to change.
+UpdateSummary UpdateSharedStringDomain(
+    const Schema::Updater& updater, const FeatureStatsView& stats,
+    double max_off_domain,
+    const tensorflow::metadata::v0::StringDomain& string_domain,
+    const StringDomainValueSet& values,
+    const std::function<tensorflow::metadata::v0::StringDomain*()>&
+        get_string_domain);
+
 }  // namespace data_validation
 }  // namespace tensorflow
 
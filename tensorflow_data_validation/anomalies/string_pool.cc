@@ -0,0 +1,60 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/string_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace tensorflow {
+namespace data_validation {
+
+int32 StringPool::Intern(absl::string_view value) {
+  return ids_.emplace(value, ids_.size()).first->second;
+}
+
+int32 StringPool::Find(absl::string_view value) const {
+  const auto iter = ids_.find(value);
+  return iter == ids_.end() ? -1 : iter->second;
+}
+
+StringIdSet::StringIdSet(const StringPool* pool, std::vector<int32> ids)
+    : pool_(pool), ids_(std::move(ids)) {
+  std::sort(ids_.begin(), ids_.end());
+  ids_.erase(std::unique(ids_.begin(), ids_.end()), ids_.end());
+  ids_.shrink_to_fit();
+}
+
+bool StringIdSet::contains(absl::string_view value) const {
+  return pool_ != nullptr && contains_id(pool_->Find(value));
+}
+
+bool StringIdSet::contains_id(int32 id) const {
+  return id >= 0 && std::binary_search(ids_.begin(), ids_.end(), id);
+}
+
+StringIdSet InternStrings(
+    const ::tensorflow::protobuf::RepeatedPtrField<string>& values,
+    StringPool* pool) {
+  std::vector<int32> ids;
+  ids.reserve(values.size());
+  for (const string& value : values) {
+    ids.push_back(pool->Intern(value));
+  }
+  return StringIdSet(pool, std::move(ids));
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -0,0 +1,90 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_STRING_POOL_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_STRING_POOL_H_
+
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// Interns strings: each distinct string gets a small id, so that the sets of
+// strings drawn from the pool (see StringIdSet) store ids instead of strings,
+// and a string is hashed once to be looked up in all of them. The pool does
+// not copy the strings, which must outlive it. Find() is thread-safe once
+// the pool is no longer modified.
+class StringPool {
+ public:
+  StringPool() = default;
+
+  // Not copyable, as the sets of the pool point to it.
+  StringPool(const StringPool&) = delete;
+  StringPool& operator=(const StringPool&) = delete;
+
+  // Returns the id of value, adding it to the pool if it is new.
+  int32 Intern(absl::string_view value);
+
+  // Returns the id of value, or -1 if it is not in the pool.
+  int32 Find(absl::string_view value) const;
+
+  // The number of distinct strings in the pool.
+  int size() const { return ids_.size(); }
+
+ private:
+  absl::flat_hash_map<absl::string_view, int32> ids_;
+};
+
+// A set of strings of a StringPool, stored as their sorted ids.
+class StringIdSet {
+ public:
+  // Creates an empty set.
+  StringIdSet() = default;
+
+  // Creates the set of the strings of pool with ids, which need not be
+  // sorted or distinct. pool must outlive the set.
+  StringIdSet(const StringPool* pool, std::vector<int32> ids);
+
+  // Returns true if value is in the set: it is looked up in the pool, then
+  // its id in the set.
+  bool contains(absl::string_view value) const;
+
+  // Returns true if the string with the id is in the set.
+  bool contains_id(int32 id) const;
+
+  // The sorted, distinct ids of the strings in the set.
+  const std::vector<int32>& ids() const { return ids_; }
+
+  int size() const { return ids_.size(); }
+
+ private:
+  const StringPool* pool_ = nullptr;
+  std::vector<int32> ids_;
+};
+
+// Interns values into pool, and returns the set of them.
+StringIdSet InternStrings(
+    const ::tensorflow::protobuf::RepeatedPtrField<string>& values,
+    StringPool* pool);
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_STRING_POOL_H_
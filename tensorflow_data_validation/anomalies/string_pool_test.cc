@@ -0,0 +1,75 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/string_pool.h"
+
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::testing::ElementsAre;
+
+TEST(StringPoolTest, InternAndFind) {
+  const std::vector<string> values = {"a", "b", "a"};
+  StringPool pool;
+  EXPECT_EQ(pool.Intern(values[0]), 0);
+  EXPECT_EQ(pool.Intern(values[1]), 1);
+  // The same string, elsewhere, has the same id.
+  EXPECT_EQ(pool.Intern(values[2]), 0);
+  EXPECT_EQ(pool.size(), 2);
+  EXPECT_EQ(pool.Find("b"), 1);
+  EXPECT_EQ(pool.Find("c"), -1);
+}
+
+TEST(StringPoolTest, SetsShareThePool) {
+  ::tensorflow::protobuf::RepeatedPtrField<string> first;
+  *first.Add() = "c";
+  *first.Add() = "a";
+  *first.Add() = "c";
+  ::tensorflow::protobuf::RepeatedPtrField<string> second;
+  *second.Add() = "b";
+  *second.Add() = "a";
+  StringPool pool;
+  const StringIdSet first_set = InternStrings(first, &pool);
+  const StringIdSet second_set = InternStrings(second, &pool);
+  EXPECT_EQ(pool.size(), 3);
+  EXPECT_THAT(first_set.ids(), ElementsAre(0, 1));
+  EXPECT_EQ(first_set.size(), 2);
+  EXPECT_THAT(second_set.ids(), ElementsAre(1, 2));
+  EXPECT_TRUE(first_set.contains("a"));
+  EXPECT_TRUE(first_set.contains("c"));
+  EXPECT_FALSE(first_set.contains("b"));
+  EXPECT_FALSE(first_set.contains("d"));
+  EXPECT_TRUE(second_set.contains_id(pool.Find("a")));
+  EXPECT_FALSE(second_set.contains_id(pool.Find("c")));
+  EXPECT_FALSE(second_set.contains_id(-1));
+}
+
+TEST(StringPoolTest, EmptySet) {
+  const StringIdSet set;
+  EXPECT_EQ(set.size(), 0);
+  EXPECT_FALSE(set.contains("a"));
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
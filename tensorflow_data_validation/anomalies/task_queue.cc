@@ -0,0 +1,84 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/task_queue.h"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/threadpool.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+TaskQueue::TaskQueue(const string& name, int num_threads)
+    : thread_pool_(absl::make_unique<thread::ThreadPool>(
+          Env::Default(), name, std::max(num_threads, 1))) {}
+
+TaskQueue::~TaskQueue() {}
+
+void TaskQueue::Schedule(Group* group, std::function<void()> task) {
+  {
+    mutex_lock lock(mu_);
+    ++group->pending_;
+    tasks_.push_back({group, std::move(task)});
+  }
+  changed_.notify_all();
+  // The task may be run by a waiting thread first, in which case this finds
+  // nothing to run.
+  thread_pool_->Schedule([this]() { RunOne(); });
+}
+
+void TaskQueue::Wait(Group* group) {
+  while (true) {
+    {
+      mutex_lock lock(mu_);
+      while (group->pending_ > 0 && tasks_.empty()) {
+        changed_.wait(lock);
+      }
+      if (group->pending_ == 0) {
+        return;
+      }
+    }
+    RunOne();
+  }
+}
+
+bool TaskQueue::RunOne() {
+  Task task;
+  {
+    mutex_lock lock(mu_);
+    if (tasks_.empty()) {
+      return false;
+    }
+    task = std::move(tasks_.back());
+    tasks_.pop_back();
+  }
+  task.run();
+  {
+    mutex_lock lock(mu_);
+    --task.group->pending_;
+  }
+  changed_.notify_all();
+  return true;
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -0,0 +1,90 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_TASK_QUEUE_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_TASK_QUEUE_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// Runs tasks on a pool of threads, where tasks may schedule more tasks and
+// wait for them (e.g., to split a large subtree of features). The queue is
+// shared by all the threads, so idle threads take the tasks that busy ones
+// queued, and the most recently queued tasks (the deepest subtrees) are run
+// first. A thread waiting for a group of tasks runs queued tasks meanwhile, so
+// that waiting never needs a free thread. Thread-safe.
+class TaskQueue {
+ public:
+  // Tasks that are waited for together.
+  class Group {
+   public:
+    Group() = default;
+    Group(const Group&) = delete;
+    Group& operator=(const Group&) = delete;
+
+   private:
+    friend class TaskQueue;
+    // The number of tasks of the group that have not finished.
+    int pending_ = 0;
+  };
+
+  // Runs the tasks on num_threads threads, besides the threads waiting in
+  // Wait(...).
+  TaskQueue(const string& name, int num_threads);
+
+  // All the groups must have been waited for.
+  ~TaskQueue();
+
+  TaskQueue(const TaskQueue&) = delete;
+  TaskQueue& operator=(const TaskQueue&) = delete;
+
+  // Queues task, as part of group. group must outlive the task.
+  void Schedule(Group* group, std::function<void()> task);
+
+  // Waits for all the tasks of group to finish, running queued tasks
+  // meanwhile.
+  void Wait(Group* group);
+
+ private:
+  struct Task {
+    Group* group;
+    std::function<void()> run;
+  };
+
+  // Runs the most recently queued task, if any. Returns false if there was
+  // none.
+  bool RunOne();
+
+  mutex mu_;
+  // Signaled when a task is queued or finishes.
+  condition_variable changed_;
+  std::vector<Task> tasks_ TF_GUARDED_BY(mu_);
+  // Destroyed first, waiting for its threads.
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+};
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_TASK_QUEUE_H_
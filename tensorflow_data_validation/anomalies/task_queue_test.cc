@@ -0,0 +1,77 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/task_queue.h"
+
+#include <atomic>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+// Sums the numbers from begin to end (excluded), splitting the range into
+// tasks until it is small, and waiting for them in each task.
+int64 SumRange(TaskQueue* task_queue, int64 begin, int64 end) {
+  if (end - begin <= 4) {
+    int64 sum = 0;
+    for (int64 i = begin; i < end; ++i) {
+      sum += i;
+    }
+    return sum;
+  }
+  const int64 middle = begin + (end - begin) / 2;
+  int64 left = 0;
+  int64 right = 0;
+  TaskQueue::Group group;
+  task_queue->Schedule(&group, [&]() {
+    left = SumRange(task_queue, begin, middle);
+  });
+  task_queue->Schedule(&group, [&]() {
+    right = SumRange(task_queue, middle, end);
+  });
+  task_queue->Wait(&group);
+  return left + right;
+}
+
+TEST(TaskQueueTest, NestedTasks) {
+  for (const int num_threads : {1, 2, 8}) {
+    TaskQueue task_queue("task_queue_test", num_threads);
+    // All the threads end up waiting in tasks, which only works if waiting
+    // threads run the queued tasks.
+    EXPECT_EQ(SumRange(&task_queue, 0, 1000), 999 * 1000 / 2);
+  }
+}
+
+TEST(TaskQueueTest, RunsAllTasksOfGroup) {
+  TaskQueue task_queue("task_queue_test", 4);
+  std::atomic<int> num_runs(0);
+  TaskQueue::Group group;
+  for (int i = 0; i < 100; ++i) {
+    task_queue.Schedule(&group, [&num_runs]() { ++num_runs; });
+  }
+  task_queue.Wait(&group);
+  EXPECT_EQ(num_runs, 100);
+  // Waiting for a group without tasks returns at once.
+  TaskQueue::Group empty_group;
+  task_queue.Wait(&empty_group);
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow_data_validation/anomalies/test_util.h"
 
 #include <stddef.h>
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
@@ -94,6 +95,43 @@ void TestAnomalyInfo(const tensorflow::metadata::v0::AnomalyInfo& actual,
       << comment;
 }
 
+namespace {
+
+// Returns anomalies without anomaly_info, and with drift_skew_info sorted by
+// path, so that the result can be compared with EqualsProto.
+tensorflow::metadata::v0::Anomalies CanonicalizeForComparison(
+    const tensorflow::metadata::v0::Anomalies& anomalies) {
+  tensorflow::metadata::v0::Anomalies result = anomalies;
+  result.clear_anomaly_info();
+  std::vector<tensorflow::metadata::v0::DriftSkewInfo> drift_skew_infos(
+      result.drift_skew_info().begin(), result.drift_skew_info().end());
+  std::stable_sort(drift_skew_infos.begin(), drift_skew_infos.end(),
+                   [](const tensorflow::metadata::v0::DriftSkewInfo& a,
+                      const tensorflow::metadata::v0::DriftSkewInfo& b) {
+                     return Path(a.path()) < Path(b.path());
+                   });
+  result.clear_drift_skew_info();
+  for (tensorflow::metadata::v0::DriftSkewInfo& drift_skew_info :
+       drift_skew_infos) {
+    *result.add_drift_skew_info() = std::move(drift_skew_info);
+  }
+  return result;
+}
+
+}  // namespace
+
+void ExpectSameAnomalies(const tensorflow::metadata::v0::Anomalies& actual,
+                         const tensorflow::metadata::v0::Anomalies& expected) {
+  EXPECT_THAT(CanonicalizeForComparison(actual),
+              EqualsProto(CanonicalizeForComparison(expected)));
+  ASSERT_EQ(actual.anomaly_info_size(), expected.anomaly_info_size());
+  for (const auto& pair : expected.anomaly_info()) {
+    ASSERT_EQ(actual.anomaly_info().count(pair.first), 1) << pair.first;
+    EXPECT_THAT(actual.anomaly_info().at(pair.first),
+                EqualsProto(pair.second));
+  }
+}
+
 }  // namespace testing
 }  // namespace data_validation
 }  // namespace tensorflow
@@ -125,6 +125,12 @@ void TestAnomalyInfo(const tensorflow::metadata::v0::AnomalyInfo& actual,
                      const ExpectedAnomalyInfo& expected,
                      const string& comment);
 
+// Expects actual to be the same as expected. As anomaly_info is a map, whose
+// serialization is not deterministic, it is compared entry by entry, and
+// drift_skew_info is compared regardless of the order of its entries.
+void ExpectSameAnomalies(const tensorflow::metadata::v0::Anomalies& actual,
+                         const tensorflow::metadata::v0::Anomalies& expected);
+
 }  // namespace testing
 }  // namespace data_validation
 }  // namespace tensorflow
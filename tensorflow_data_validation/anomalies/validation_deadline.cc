@@ -0,0 +1,41 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/validation_deadline.h"
+
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+ValidationDeadline::ValidationDeadline()
+    : deadline_micros_(0), cancelled_(false) {}
+
+ValidationDeadline::ValidationDeadline(int64 timeout_micros)
+    : deadline_micros_(timeout_micros > 0
+                           ? Env::Default()->NowMicros() + timeout_micros
+                           : 0),
+      cancelled_(false) {}
+
+bool ValidationDeadline::Expired() const {
+  if (cancelled_.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  return deadline_micros_ != 0 &&
+         Env::Default()->NowMicros() >= deadline_micros_;
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
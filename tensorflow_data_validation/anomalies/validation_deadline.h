@@ -0,0 +1,57 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_VALIDATION_DEADLINE_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_VALIDATION_DEADLINE_H_
+
+#include <atomic>
+
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// The time by which a validation must return, and a token to stop it earlier
+// (e.g., when its caller gives up). A validation checks Expired() between
+// features and between comparators, and returns the anomalies found so far
+// once it is true. Thread-safe: Cancel() may be called from any thread.
+class ValidationDeadline {
+ public:
+  // A deadline that only expires when cancelled.
+  ValidationDeadline();
+
+  // Expires timeout_micros from now (or never if timeout_micros is 0 or
+  // less), or when cancelled.
+  explicit ValidationDeadline(int64 timeout_micros);
+
+  ValidationDeadline(const ValidationDeadline&) = delete;
+  ValidationDeadline& operator=(const ValidationDeadline&) = delete;
+
+  // Expires the deadline now.
+  void Cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+  // True iff the deadline has passed, or it was cancelled.
+  bool Expired() const;
+
+ private:
+  // In Env::Default()->NowMicros(), or 0 if there is no deadline.
+  const uint64 deadline_micros_;
+  std::atomic<bool> cancelled_;
+};
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_VALIDATION_DEADLINE_H_
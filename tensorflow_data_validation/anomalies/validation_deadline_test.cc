@@ -0,0 +1,52 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/validation_deadline.h"
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/platform/env.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+TEST(ValidationDeadlineTest, WithoutTimeoutOnlyExpiresWhenCancelled) {
+  ValidationDeadline deadline;
+  EXPECT_FALSE(deadline.Expired());
+  deadline.Cancel();
+  EXPECT_TRUE(deadline.Expired());
+}
+
+TEST(ValidationDeadlineTest, ExpiresAfterTimeout) {
+  ValidationDeadline deadline(/*timeout_micros=*/1000);
+  Env::Default()->SleepForMicroseconds(2000);
+  EXPECT_TRUE(deadline.Expired());
+}
+
+TEST(ValidationDeadlineTest, DoesNotExpireBeforeTimeout) {
+  ValidationDeadline deadline(/*timeout_micros=*/int64{3600} * 1000 * 1000);
+  EXPECT_FALSE(deadline.Expired());
+  deadline.Cancel();
+  EXPECT_TRUE(deadline.Expired());
+}
+
+TEST(ValidationDeadlineTest, NonPositiveTimeoutMeansNoDeadline) {
+  ValidationDeadline deadline(/*timeout_micros=*/0);
+  EXPECT_FALSE(deadline.Expired());
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
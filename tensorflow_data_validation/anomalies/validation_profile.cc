@@ -0,0 +1,161 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/validation_profile.h"
+
+#include <algorithm>
+#include <ctime>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow_data_validation/anomalies/path.h"
+#include "tensorflow_data_validation/anomalies/proto/validation_metadata.pb.h"
+#include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+ScopedValidationStage::ScopedValidationStage(const char* name,
+                                             ValidationProfile* profile)
+    : name_(name), profile_(profile) {
+  if (profile_ != nullptr) {
+    start_wall_micros_ = Env::Default()->NowMicros();
+    start_cpu_clock_ = std::clock();
+  }
+}
+
+ScopedValidationStage::~ScopedValidationStage() {
+  if (profile_ == nullptr) {
+    return;
+  }
+  const std::clock_t end_cpu_clock = std::clock();
+  const uint64 end_wall_micros = Env::Default()->NowMicros();
+  ValidationProfile::Stage* stage = profile_->add_stage();
+  stage->set_name(name_);
+  stage->set_wall_time_micros(end_wall_micros - start_wall_micros_);
+  stage->set_cpu_time_micros(static_cast<int64>(
+      (end_cpu_clock - start_cpu_clock_) * (1e6 / CLOCKS_PER_SEC)));
+}
+
+FeatureCostTracker::FeatureCostTracker(int max_entries)
+    : max_entries_(max_entries) {
+  entries_.reserve(max_entries_);
+}
+
+void FeatureCostTracker::Add(const FeatureStatsView& view, const char* stage,
+                             int64 wall_time_nanos) {
+  if (max_entries_ <= 0) {
+    return;
+  }
+  mutex_lock lock(mu_);
+  if (entries_.size() == max_entries_) {
+    if (wall_time_nanos <= entries_.front().wall_time_nanos) {
+      return;
+    }
+    std::pop_heap(entries_.begin(), entries_.end(), MoreExpensive);
+    entries_.pop_back();
+  }
+  entries_.push_back(
+      {wall_time_nanos, stage, view.GetPath(),
+       static_cast<int64>(view.GetByteSize())});
+  std::push_heap(entries_.begin(), entries_.end(), MoreExpensive);
+}
+
+void FeatureCostTracker::AddTo(ValidationProfile* profile) const {
+  std::vector<Entry> sorted;
+  {
+    mutex_lock lock(mu_);
+    sorted = entries_;
+  }
+  std::sort(sorted.begin(), sorted.end(), MoreExpensive);
+  for (const Entry& entry : sorted) {
+    ValidationProfile::FeatureCost* cost = profile->add_slowest_feature();
+    *cost->mutable_path() = entry.path.AsProto();
+    cost->set_stage(entry.stage);
+    cost->set_wall_time_nanos(entry.wall_time_nanos);
+    cost->set_input_size(entry.input_size);
+  }
+}
+
+ScopedFeatureCost::ScopedFeatureCost(const char* stage,
+                                     const FeatureStatsView& view,
+                                     FeatureCostTracker* tracker)
+    : stage_(stage), view_(view), tracker_(tracker) {
+  if (tracker_ != nullptr) {
+    start_nanos_ = Env::Default()->NowNanos();
+  }
+}
+
+ScopedFeatureCost::~ScopedFeatureCost() {
+  if (tracker_ != nullptr) {
+    tracker_->Add(view_, stage_, Env::Default()->NowNanos() - start_nanos_);
+  }
+}
+
+ValidationMemoryAccount::ValidationMemoryAccount(int64 budget_bytes)
+    : budget_bytes_(budget_bytes) {}
+
+void ValidationMemoryAccount::set_input_bytes(int64 bytes) {
+  memory_.set_input_bytes(bytes);
+  UpdatePeak();
+}
+
+void ValidationMemoryAccount::set_view_bytes(int64 bytes) {
+  memory_.set_view_bytes(bytes);
+  UpdatePeak();
+}
+
+void ValidationMemoryAccount::set_anomaly_bytes(int64 bytes) {
+  memory_.set_anomaly_bytes(bytes);
+  UpdatePeak();
+}
+
+void ValidationMemoryAccount::set_output_bytes(int64 bytes) {
+  memory_.set_output_bytes(bytes);
+  UpdatePeak();
+}
+
+bool ValidationMemoryAccount::OverBudget() const {
+  return budget_bytes_ > 0 && total_bytes() > budget_bytes_;
+}
+
+Status ValidationMemoryAccount::CheckBudget(absl::string_view stage) const {
+  if (!OverBudget()) {
+    return Status::OK();
+  }
+  return errors::ResourceExhausted(
+      "Validation needs about ", total_bytes(), " bytes after ", stage,
+      " (inputs: ", memory_.input_bytes(), ", views: ", memory_.view_bytes(),
+      ", anomalies: ", memory_.anomaly_bytes(),
+      ", output: ", memory_.output_bytes(), "), over the memory budget of ",
+      budget_bytes_, " bytes (see ValidationConfig.memory_budget_bytes).");
+}
+
+int64 ValidationMemoryAccount::total_bytes() const {
+  return memory_.input_bytes() + memory_.view_bytes() +
+         memory_.anomaly_bytes() + memory_.output_bytes();
+}
+
+void ValidationMemoryAccount::UpdatePeak() {
+  memory_.set_peak_bytes(std::max(memory_.peak_bytes(), total_bytes()));
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
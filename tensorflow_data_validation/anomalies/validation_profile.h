@@ -0,0 +1,148 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_VALIDATION_PROFILE_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_VALIDATION_PROFILE_H_
+
+#include <ctime>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow_data_validation/anomalies/path.h"
+#include "tensorflow_data_validation/anomalies/proto/validation_metadata.pb.h"
+#include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// Times a stage of a validation, from its construction to its destruction,
+// and then adds it to profile. If profile is null, does nothing (not even
+// reading the clocks), so that profiling costs nothing when it is disabled.
+// Not thread-safe: the stages of a profile are timed by the thread that
+// validates.
+class ScopedValidationStage {
+ public:
+  // name must outlive this object (e.g., be a literal).
+  ScopedValidationStage(const char* name, ValidationProfile* profile);
+  ~ScopedValidationStage();
+
+  ScopedValidationStage(const ScopedValidationStage&) = delete;
+  ScopedValidationStage& operator=(const ScopedValidationStage&) = delete;
+
+ private:
+  const char* const name_;
+  ValidationProfile* const profile_;
+  uint64 start_wall_micros_ = 0;
+  std::clock_t start_cpu_clock_ = 0;
+};
+
+// Keeps the max_entries most expensive checks of single features, so that the
+// few features that dominate the time of a validation (e.g., with huge
+// vocabularies or histograms) can be found. Thread-safe.
+class FeatureCostTracker {
+ public:
+  explicit FeatureCostTracker(int max_entries);
+
+  FeatureCostTracker(const FeatureCostTracker&) = delete;
+  FeatureCostTracker& operator=(const FeatureCostTracker&) = delete;
+
+  // Records that stage took wall_time_nanos on the feature of view. The path
+  // and the size of the statistics are only computed if the entry is kept.
+  // stage must outlive this object (e.g., be a literal).
+  void Add(const FeatureStatsView& view, const char* stage,
+           int64 wall_time_nanos);
+
+  // Adds the entries kept, most expensive first, to profile->slowest_feature.
+  void AddTo(ValidationProfile* profile) const;
+
+ private:
+  struct Entry {
+    int64 wall_time_nanos;
+    const char* stage;
+    Path path;
+    int64 input_size;
+  };
+
+  // The comparator of the heap, so that its front is the cheapest entry.
+  static bool MoreExpensive(const Entry& a, const Entry& b) {
+    return a.wall_time_nanos > b.wall_time_nanos;
+  }
+
+  const int max_entries_;
+  mutable mutex mu_;
+  // A heap whose front is the cheapest entry kept, which is replaced first.
+  std::vector<Entry> entries_ TF_GUARDED_BY(mu_);
+};
+
+// Times a check of the feature of view, from its construction to its
+// destruction, and then adds it to tracker. If tracker is null, does nothing.
+// view must outlive this object.
+class ScopedFeatureCost {
+ public:
+  ScopedFeatureCost(const char* stage, const FeatureStatsView& view,
+                    FeatureCostTracker* tracker);
+  ~ScopedFeatureCost();
+
+  ScopedFeatureCost(const ScopedFeatureCost&) = delete;
+  ScopedFeatureCost& operator=(const ScopedFeatureCost&) = delete;
+
+ private:
+  const char* const stage_;
+  const FeatureStatsView& view_;
+  FeatureCostTracker* const tracker_;
+  uint64 start_nanos_ = 0;
+};
+
+// Accounts for the estimated memory of a validation, by kind (see
+// ValidationProfile.Memory), and checks its total against a budget. Setting
+// the bytes of a kind replaces its previous estimate. Not thread-safe.
+class ValidationMemoryAccount {
+ public:
+  // If budget_bytes is not greater than 0, there is no budget.
+  explicit ValidationMemoryAccount(int64 budget_bytes);
+
+  void set_input_bytes(int64 bytes);
+  void set_view_bytes(int64 bytes);
+  void set_anomaly_bytes(int64 bytes);
+  void set_output_bytes(int64 bytes);
+  void set_diff_regions_dropped() { memory_.set_diff_regions_dropped(true); }
+  void set_schema_changes_dropped() {
+    memory_.set_schema_changes_dropped(true);
+  }
+
+  // True if the current total is over the budget.
+  bool OverBudget() const;
+
+  // Returns RESOURCE_EXHAUSTED, naming stage, if the current total is over
+  // the budget.
+  Status CheckBudget(absl::string_view stage) const;
+
+  const ValidationProfile::Memory& memory() const { return memory_; }
+
+ private:
+  int64 total_bytes() const;
+  void UpdatePeak();
+
+  const int64 budget_bytes_;
+  ValidationProfile::Memory memory_;
+};
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_VALIDATION_PROFILE_H_
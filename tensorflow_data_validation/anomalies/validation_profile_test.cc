@@ -0,0 +1,173 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/validation_profile.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow_data_validation/anomalies/path.h"
+#include "tensorflow_data_validation/anomalies/proto/validation_metadata.pb.h"
+#include "tensorflow_data_validation/anomalies/statistics_view.h"
+#include "tensorflow_data_validation/anomalies/statistics_view_test_util.h"
+#include "tensorflow_data_validation/anomalies/test_util.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/statistics.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::DatasetFeatureStatistics;
+using testing::EqualsProto;
+using testing::ParseTextProtoOrDie;
+
+TEST(ScopedValidationStageTest, AddsStage) {
+  ValidationProfile profile;
+  {
+    const ScopedValidationStage stage("first", &profile);
+  }
+  {
+    const ScopedValidationStage stage("second", &profile);
+  }
+  ASSERT_EQ(profile.stage_size(), 2);
+  EXPECT_EQ(profile.stage(0).name(), "first");
+  EXPECT_EQ(profile.stage(1).name(), "second");
+  EXPECT_GE(profile.stage(0).wall_time_micros(), 0);
+  EXPECT_GE(profile.stage(0).cpu_time_micros(), 0);
+}
+
+TEST(ScopedValidationStageTest, NullProfile) {
+  // Does nothing.
+  const ScopedValidationStage stage("stage", /*profile=*/nullptr);
+}
+
+DatasetFeatureStatistics GetStatistics() {
+  return ParseTextProtoOrDie<DatasetFeatureStatistics>(R"(
+    num_examples: 10
+    features {
+      name: "a"
+      type: INT
+      num_stats { common_stats { num_non_missing: 10 } }
+    }
+    features {
+      name: "b"
+      type: INT
+      num_stats { common_stats { num_non_missing: 10 } }
+    }
+    features {
+      name: "c"
+      type: INT
+      num_stats { common_stats { num_non_missing: 10 } }
+    }
+    features {
+      name: "d"
+      type: INT
+      num_stats { common_stats { num_non_missing: 10 } }
+    })");
+}
+
+TEST(FeatureCostTrackerTest, KeepsMostExpensive) {
+  const testing::DatasetForTesting dataset(GetStatistics(),
+                                           /*by_weight=*/false);
+  const std::vector<FeatureStatsView> features =
+      dataset.dataset_stats_view().features();
+  FeatureCostTracker tracker(/*max_entries=*/2);
+  tracker.Add(features[0], "update", 5);
+  tracker.Add(features[1], "update", 1);
+  tracker.Add(features[2], "drift_comparator", 7);
+  tracker.Add(features[3], "update", 3);
+  ValidationProfile profile;
+  tracker.AddTo(&profile);
+  ValidationProfile expected =
+      ParseTextProtoOrDie<ValidationProfile>(R"(
+        slowest_feature {
+          path { step: "c" }
+          stage: "drift_comparator"
+          wall_time_nanos: 7
+        }
+        slowest_feature {
+          path { step: "a" }
+          stage: "update"
+          wall_time_nanos: 5
+        })");
+  expected.mutable_slowest_feature(0)->set_input_size(
+      features[2].GetByteSize());
+  expected.mutable_slowest_feature(1)->set_input_size(
+      features[0].GetByteSize());
+  EXPECT_THAT(profile, EqualsProto(expected));
+}
+
+TEST(FeatureCostTrackerTest, NoEntries) {
+  const testing::DatasetForTesting dataset(GetStatistics(),
+                                           /*by_weight=*/false);
+  FeatureCostTracker tracker(/*max_entries=*/0);
+  tracker.Add(dataset.dataset_stats_view().features()[0], "update", 5);
+  ValidationProfile profile;
+  tracker.AddTo(&profile);
+  EXPECT_EQ(profile.slowest_feature_size(), 0);
+}
+
+TEST(ScopedFeatureCostTest, AddsCost) {
+  const testing::DatasetForTesting dataset(GetStatistics(),
+                                           /*by_weight=*/false);
+  const std::vector<FeatureStatsView> features =
+      dataset.dataset_stats_view().features();
+  FeatureCostTracker tracker(/*max_entries=*/10);
+  {
+    const ScopedFeatureCost cost("update", features[1], &tracker);
+  }
+  {
+    // Does nothing.
+    const ScopedFeatureCost cost("update", features[2], /*tracker=*/nullptr);
+  }
+  ValidationProfile profile;
+  tracker.AddTo(&profile);
+  ASSERT_EQ(profile.slowest_feature_size(), 1);
+  EXPECT_EQ(Path(profile.slowest_feature(0).path()), Path({"b"}));
+  EXPECT_EQ(profile.slowest_feature(0).stage(), "update");
+  EXPECT_GE(profile.slowest_feature(0).wall_time_nanos(), 0);
+}
+
+TEST(ValidationMemoryAccountTest, TracksPeak) {
+  ValidationMemoryAccount memory(/*budget_bytes=*/100);
+  memory.set_input_bytes(40);
+  memory.set_view_bytes(30);
+  TF_EXPECT_OK(memory.CheckBudget("build_views"));
+  memory.set_view_bytes(10);
+  memory.set_anomaly_bytes(20);
+  EXPECT_FALSE(memory.OverBudget());
+  memory.set_output_bytes(40);
+  EXPECT_TRUE(memory.OverBudget());
+  EXPECT_EQ(memory.CheckBudget("get_schema_diff").code(),
+            error::RESOURCE_EXHAUSTED);
+  memory.set_output_bytes(20);
+  TF_EXPECT_OK(memory.CheckBudget("get_schema_diff"));
+  EXPECT_EQ(memory.memory().peak_bytes(), 110);
+}
+
+TEST(ValidationMemoryAccountTest, NoBudget) {
+  ValidationMemoryAccount memory(/*budget_bytes=*/0);
+  memory.set_input_bytes(1 << 30);
+  EXPECT_FALSE(memory.OverBudget());
+  TF_EXPECT_OK(memory.CheckBudget("parse"));
+  EXPECT_EQ(memory.memory().peak_bytes(), 1 << 30);
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
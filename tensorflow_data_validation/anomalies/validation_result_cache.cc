@@ -0,0 +1,156 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/validation_result_cache.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+ValidationResultCache::ValidationResultCache(int64 max_bytes,
+                                             const string& directory)
+    : max_bytes_(max_bytes), directory_(directory) {}
+
+constexpr int64 ValidationResultCache::kResultVersion;
+
+Fprint128 ValidationResultCache::GetKey(
+    const std::vector<absl::string_view>& inputs) {
+  return GetKey(kResultVersion, inputs);
+}
+
+Fprint128 ValidationResultCache::GetKey(
+    int64 result_version, const std::vector<absl::string_view>& inputs) {
+  // Fingerprinting the fingerprints of the inputs (rather than their
+  // concatenation) avoids copying them, and keeps their boundaries.
+  string fingerprints;
+  fingerprints.reserve(sizeof(result_version) +
+                       inputs.size() * 2 * sizeof(uint64));
+  fingerprints.append(reinterpret_cast<const char*>(&result_version),
+                      sizeof(result_version));
+  for (const absl::string_view input : inputs) {
+    const Fprint128 fingerprint = Fingerprint128(input);
+    fingerprints.append(reinterpret_cast<const char*>(&fingerprint.low64),
+                        sizeof(fingerprint.low64));
+    fingerprints.append(reinterpret_cast<const char*>(&fingerprint.high64),
+                        sizeof(fingerprint.high64));
+  }
+  return Fingerprint128(fingerprints);
+}
+
+bool ValidationResultCache::Get(const Fprint128& key, string* result) {
+  {
+    mutex_lock lock(mu_);
+    const auto iter = results_by_key_.find(key);
+    if (iter != results_by_key_.end()) {
+      results_.splice(results_.begin(), results_, iter->second);
+      *result = iter->second->second;
+      ++stats_.memory_hits;
+      return true;
+    }
+    if (directory_.empty()) {
+      ++stats_.misses;
+      return false;
+    }
+  }
+  // Reads the file without holding the lock.
+  string contents;
+  const Status status =
+      ReadFileToString(Env::Default(), GetFilePath(key), &contents);
+  mutex_lock lock(mu_);
+  if (!status.ok()) {
+    ++stats_.misses;
+    return false;
+  }
+  ++stats_.disk_hits;
+  *result = contents;
+  PutInMemory(key, std::move(contents));
+  return true;
+}
+
+void ValidationResultCache::Put(const Fprint128& key, const string& result) {
+  {
+    mutex_lock lock(mu_);
+    PutInMemory(key, result);
+  }
+  if (directory_.empty()) {
+    return;
+  }
+  // Writes a temporary file first, so that readers never see a partial
+  // result.
+  Env* env = Env::Default();
+  const string path = GetFilePath(key);
+  string temp_path = path;
+  if (!env->CreateUniqueFileName(&temp_path, ".tmp")) {
+    LOG(WARNING) << "Could not create a temporary file name for " << path;
+    return;
+  }
+  Status status = WriteStringToFile(env, temp_path, result);
+  if (status.ok()) {
+    status = env->RenameFile(temp_path, path);
+  }
+  if (!status.ok()) {
+    LOG(WARNING) << "Could not write the validation result to " << path
+                 << ": " << status;
+    env->DeleteFile(temp_path).IgnoreError();
+  }
+}
+
+ValidationResultCache::Stats ValidationResultCache::GetStats() const {
+  mutex_lock lock(mu_);
+  return stats_;
+}
+
+string ValidationResultCache::GetFilePath(const Fprint128& key) const {
+  return io::JoinPath(
+      directory_, absl::StrCat(absl::Hex(key.high64, absl::kZeroPad16),
+                               absl::Hex(key.low64, absl::kZeroPad16)));
+}
+
+void ValidationResultCache::PutInMemory(const Fprint128& key, string result) {
+  const int64 size = result.size();
+  if (size > max_bytes_) {
+    return;
+  }
+  const auto iter = results_by_key_.find(key);
+  if (iter != results_by_key_.end()) {
+    bytes_ -= iter->second->second.size();
+    results_.erase(iter->second);
+    results_by_key_.erase(iter);
+  }
+  while (bytes_ + size > max_bytes_) {
+    bytes_ -= results_.back().second.size();
+    results_by_key_.erase(results_.back().first);
+    results_.pop_back();
+  }
+  results_.emplace_front(key, std::move(result));
+  results_by_key_[key] = results_.begin();
+  bytes_ += size;
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
@@ -0,0 +1,106 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_VALIDATION_RESULT_CACHE_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_VALIDATION_RESULT_CACHE_H_
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// A cache of serialized validation results (e.g., Anomalies protos), keyed by
+// a fingerprint of the serialized inputs of the validation. Results are kept
+// in memory, up to a total size, evicting the least recently used ones. If a
+// directory is given, results are also written there, one file per result, and
+// results that are not in memory are looked up there, so they can be shared
+// across processes and survive restarts (but not an upgrade that changes the
+// results, see kResultVersion).
+// Thread-safe.
+class ValidationResultCache {
+ public:
+  struct Stats {
+    // Results found in memory.
+    int64 memory_hits = 0;
+    // Results found in the directory (but not in memory).
+    int64 disk_hits = 0;
+    int64 misses = 0;
+  };
+
+  // Keeps at most max_bytes of results in memory. If directory is not empty,
+  // it must exist, and results are also stored there.
+  ValidationResultCache(int64 max_bytes, const string& directory);
+
+  // The version of the results, which is part of every key. It must be
+  // incremented whenever the result of a validation can change for the same
+  // inputs (e.g., checks are added, or the format of the anomalies changes),
+  // so that the results written to a directory by an older build are never
+  // served by a newer one.
+  static constexpr int64 kResultVersion = 1;
+
+  // Gets the key of a validation with the serialized inputs, for results of
+  // kResultVersion. The key depends on the order of the inputs, and on where
+  // each input starts and ends.
+  static Fprint128 GetKey(const std::vector<absl::string_view>& inputs);
+
+  // Same as above, but for results of result_version.
+  static Fprint128 GetKey(int64 result_version,
+                          const std::vector<absl::string_view>& inputs);
+
+  // If there is a result for key, sets *result to it and returns true.
+  bool Get(const Fprint128& key, string* result);
+
+  // Stores result for key. Errors writing to the directory are logged, but
+  // otherwise ignored.
+  void Put(const Fprint128& key, const string& result);
+
+  Stats GetStats() const;
+
+ private:
+  // Gets the path of the file holding the result of key in directory_.
+  string GetFilePath(const Fprint128& key) const;
+
+  // Puts result in memory, evicting least recently used results if needed.
+  void PutInMemory(const Fprint128& key, string result)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int64 max_bytes_;
+  const string directory_;
+
+  mutable mutex mu_;
+  // The results in memory, the most recently used first.
+  std::list<std::pair<Fprint128, string>> results_ TF_GUARDED_BY(mu_);
+  std::unordered_map<Fprint128,
+                     std::list<std::pair<Fprint128, string>>::iterator,
+                     Fprint128Hasher>
+      results_by_key_ TF_GUARDED_BY(mu_);
+  // The total size of the results in memory.
+  int64 bytes_ TF_GUARDED_BY(mu_) = 0;
+  Stats stats_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_VALIDATION_RESULT_CACHE_H_
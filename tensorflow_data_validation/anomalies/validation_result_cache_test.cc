@@ -0,0 +1,100 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/validation_result_cache.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+TEST(ValidationResultCacheTest, GetKey) {
+  EXPECT_TRUE(ValidationResultCache::GetKey({"ab", "c"}) ==
+              ValidationResultCache::GetKey({"ab", "c"}));
+  // The boundaries of the inputs matter.
+  EXPECT_FALSE(ValidationResultCache::GetKey({"ab", "c"}) ==
+               ValidationResultCache::GetKey({"a", "bc"}));
+  EXPECT_FALSE(ValidationResultCache::GetKey({"ab", "c"}) ==
+               ValidationResultCache::GetKey({"c", "ab"}));
+  // So does the version of the results.
+  EXPECT_TRUE(ValidationResultCache::GetKey({"ab", "c"}) ==
+              ValidationResultCache::GetKey(
+                  ValidationResultCache::kResultVersion, {"ab", "c"}));
+  EXPECT_FALSE(ValidationResultCache::GetKey({"ab", "c"}) ==
+               ValidationResultCache::GetKey(
+                   ValidationResultCache::kResultVersion + 1, {"ab", "c"}));
+}
+
+TEST(ValidationResultCacheTest, EvictsLeastRecentlyUsed) {
+  ValidationResultCache cache(/*max_bytes=*/6, /*directory=*/"");
+  const Fprint128 key_a = ValidationResultCache::GetKey({"a"});
+  const Fprint128 key_b = ValidationResultCache::GetKey({"b"});
+  const Fprint128 key_c = ValidationResultCache::GetKey({"c"});
+  cache.Put(key_a, "aaa");
+  cache.Put(key_b, "bbb");
+  string result;
+  ASSERT_TRUE(cache.Get(key_a, &result));
+  EXPECT_EQ(result, "aaa");
+  // b is now the least recently used result.
+  cache.Put(key_c, "ccc");
+  EXPECT_FALSE(cache.Get(key_b, &result));
+  ASSERT_TRUE(cache.Get(key_a, &result));
+  EXPECT_EQ(result, "aaa");
+  ASSERT_TRUE(cache.Get(key_c, &result));
+  EXPECT_EQ(result, "ccc");
+  // Too large to be kept.
+  cache.Put(key_b, "bbbbbbb");
+  EXPECT_FALSE(cache.Get(key_b, &result));
+
+  const ValidationResultCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.memory_hits, 3);
+  EXPECT_EQ(stats.disk_hits, 0);
+  EXPECT_EQ(stats.misses, 2);
+}
+
+TEST(ValidationResultCacheTest, Directory) {
+  const string directory =
+      io::JoinPath(::tensorflow::testing::TmpDir(), "validation_result_cache");
+  TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(directory));
+  const Fprint128 key = ValidationResultCache::GetKey({"a", "b"});
+  {
+    // Does not keep anything in memory.
+    ValidationResultCache cache(/*max_bytes=*/0, directory);
+    cache.Put(key, "result");
+  }
+  ValidationResultCache cache(/*max_bytes=*/100, directory);
+  string result;
+  ASSERT_TRUE(cache.Get(key, &result));
+  EXPECT_EQ(result, "result");
+  ASSERT_TRUE(cache.Get(key, &result));
+  EXPECT_EQ(result, "result");
+  EXPECT_FALSE(cache.Get(ValidationResultCache::GetKey({"a"}), &result));
+
+  const ValidationResultCache::Stats stats = cache.GetStats();
+  EXPECT_EQ(stats.memory_hits, 1);
+  EXPECT_EQ(stats.disk_hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
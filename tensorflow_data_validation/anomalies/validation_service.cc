@@ -0,0 +1,256 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/validation_service.h"
+
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow_data_validation/anomalies/feature_statistics_validator.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// A call of Validate(...), waiting for its result.
+struct ValidationService::Request {
+  absl::string_view feature_statistics_proto_string;
+  absl::string_view previous_span_statistics_proto_string;
+  absl::string_view serving_statistics_proto_string;
+  absl::string_view previous_version_statistics_proto_string;
+  absl::string_view features_needed_string;
+  bool enable_diff_regions = false;
+  string* anomalies_proto_string = nullptr;
+  int64 queued_micros = 0;
+  Status status;
+  bool done = false;
+};
+
+// A registered schema. All the fields are guarded by mu_.
+struct ValidationService::SchemaEntry {
+  string schema_proto_string;
+  string environment;
+  string validation_config_string;
+  // Incremented each time the schema is registered, so that a Validator
+  // created from a replaced schema is not kept.
+  int64 version = 0;
+  // Null if the Validator is not resident.
+  std::shared_ptr<const Validator> validator;
+  bool resident = false;
+  std::list<SchemaEntry*>::iterator resident_position;
+  std::deque<Request*> queue;
+  // The number of workers running RunBatches(...) on this schema.
+  int workers = 0;
+  SchemaStats stats;
+};
+
+ValidationService::ValidationService(const Options& options)
+    : options_(options),
+      thread_pool_(absl::make_unique<thread::ThreadPool>(
+          Env::Default(), "validation_service",
+          std::max(options.num_threads, 1))) {}
+
+ValidationService::~ValidationService() {}
+
+Status ValidationService::RegisterSchema(
+    const string& schema_id, absl::string_view schema_proto_string,
+    const string& environment, absl::string_view validation_config_string) {
+  std::unique_ptr<Validator> validator;
+  TF_RETURN_IF_ERROR(Validator::Create(schema_proto_string, environment,
+                                       validation_config_string, &validator));
+  mutex_lock lock(mu_);
+  std::shared_ptr<SchemaEntry>& entry = entries_[schema_id];
+  if (entry == nullptr) {
+    entry = std::make_shared<SchemaEntry>();
+  }
+  entry->schema_proto_string = string(schema_proto_string);
+  entry->environment = environment;
+  entry->validation_config_string = string(validation_config_string);
+  ++entry->version;
+  entry->validator = std::move(validator);
+  ++entry->stats.validator_creations;
+  MarkResident(entry);
+  return Status::OK();
+}
+
+Status ValidationService::Validate(
+    const string& schema_id, absl::string_view feature_statistics_proto_string,
+    absl::string_view previous_span_statistics_proto_string,
+    absl::string_view serving_statistics_proto_string,
+    absl::string_view previous_version_statistics_proto_string,
+    absl::string_view features_needed_string, bool enable_diff_regions,
+    string* anomalies_proto_string) {
+  Request request;
+  request.feature_statistics_proto_string = feature_statistics_proto_string;
+  request.previous_span_statistics_proto_string =
+      previous_span_statistics_proto_string;
+  request.serving_statistics_proto_string = serving_statistics_proto_string;
+  request.previous_version_statistics_proto_string =
+      previous_version_statistics_proto_string;
+  request.features_needed_string = features_needed_string;
+  request.enable_diff_regions = enable_diff_regions;
+  request.anomalies_proto_string = anomalies_proto_string;
+
+  mutex_lock lock(mu_);
+  while (pending_requests_ >= options_.max_pending_requests) {
+    request_done_.wait(lock);
+  }
+  const auto iter = entries_.find(schema_id);
+  if (iter == entries_.end()) {
+    return errors::NotFound("Schema not registered: ", schema_id);
+  }
+  const std::shared_ptr<SchemaEntry>& entry = iter->second;
+  ++pending_requests_;
+  request.queued_micros = Env::Default()->NowMicros();
+  entry->queue.push_back(&request);
+  // Each worker takes up to max_batch_size requests at once, so more workers
+  // are only needed if there are more queued requests than that.
+  if (entry->queue.size() > entry->workers * options_.max_batch_size) {
+    ++entry->workers;
+    thread_pool_->Schedule([this, entry]() { RunBatches(entry); });
+  }
+  while (!request.done) {
+    request_done_.wait(lock);
+  }
+  return request.status;
+}
+
+Status ValidationService::GetSchemaStats(const string& schema_id,
+                                         SchemaStats* stats) const {
+  mutex_lock lock(mu_);
+  const auto iter = entries_.find(schema_id);
+  if (iter == entries_.end()) {
+    return errors::NotFound("Schema not registered: ", schema_id);
+  }
+  *stats = iter->second->stats;
+  return Status::OK();
+}
+
+void ValidationService::RunBatches(const std::shared_ptr<SchemaEntry>& entry) {
+  Env* env = Env::Default();
+  while (true) {
+    std::vector<Request*> batch;
+    std::shared_ptr<const Validator> validator;
+    // A copy of the registered schema, if the Validator must be created.
+    std::unique_ptr<SchemaEntry> spec;
+    {
+      mutex_lock lock(mu_);
+      if (entry->queue.empty()) {
+        --entry->workers;
+        return;
+      }
+      while (!entry->queue.empty() && batch.size() < options_.max_batch_size) {
+        batch.push_back(entry->queue.front());
+        entry->queue.pop_front();
+      }
+      ++entry->stats.batches;
+      validator = entry->validator;
+      if (validator != nullptr) {
+        MarkResident(entry);
+      } else {
+        spec = absl::make_unique<SchemaEntry>();
+        spec->schema_proto_string = entry->schema_proto_string;
+        spec->environment = entry->environment;
+        spec->validation_config_string = entry->validation_config_string;
+        spec->version = entry->version;
+      }
+    }
+
+    Status status;
+    if (spec != nullptr) {
+      // Creates the Validator without holding the lock, as it indexes the
+      // schema.
+      std::unique_ptr<Validator> created;
+      status = Validator::Create(spec->schema_proto_string, spec->environment,
+                                 spec->validation_config_string, &created);
+      if (status.ok()) {
+        validator = std::move(created);
+        mutex_lock lock(mu_);
+        ++entry->stats.validator_creations;
+        if (entry->version == spec->version) {
+          entry->validator = validator;
+          MarkResident(entry);
+        }
+      }
+    }
+
+    const int64 start_micros = env->NowMicros();
+    std::vector<int64> finish_micros;
+    finish_micros.reserve(batch.size());
+    for (Request* request : batch) {
+      if (status.ok()) {
+        request->status = validator->ValidateWithSerializedInputs(
+            request->feature_statistics_proto_string,
+            request->previous_span_statistics_proto_string,
+            request->serving_statistics_proto_string,
+            request->previous_version_statistics_proto_string,
+            request->features_needed_string, request->enable_diff_regions,
+            request->anomalies_proto_string);
+      } else {
+        request->status = status;
+      }
+      finish_micros.push_back(env->NowMicros());
+    }
+
+    mutex_lock lock(mu_);
+    SchemaStats& stats = entry->stats;
+    for (int i = 0; i < batch.size(); ++i) {
+      Request* request = batch[i];
+      const int64 latency_micros = finish_micros[i] - request->queued_micros;
+      ++stats.requests;
+      if (!request->status.ok()) {
+        ++stats.failed_requests;
+      }
+      stats.total_queue_micros += start_micros - request->queued_micros;
+      stats.total_latency_micros += latency_micros;
+      stats.max_latency_micros =
+          std::max(stats.max_latency_micros, latency_micros);
+      request->done = true;
+      --pending_requests_;
+    }
+    request_done_.notify_all();
+  }
+}
+
+void ValidationService::MarkResident(
+    const std::shared_ptr<SchemaEntry>& entry) {
+  if (entry->resident) {
+    resident_.erase(entry->resident_position);
+  }
+  resident_.push_front(entry.get());
+  entry->resident_position = resident_.begin();
+  entry->resident = true;
+  while (resident_.size() > std::max(options_.max_resident_schemas, 1)) {
+    SchemaEntry* least_recently_used = resident_.back();
+    least_recently_used->validator.reset();
+    least_recently_used->resident = false;
+    resident_.pop_back();
+  }
+}
+
+}  // namespace data_validation
+}  // namespace tensorflow
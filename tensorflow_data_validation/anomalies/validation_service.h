@@ -0,0 +1,137 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_DATA_VALIDATION_ANOMALIES_VALIDATION_SERVICE_H_
+#define TENSORFLOW_DATA_VALIDATION_ANOMALIES_VALIDATION_SERVICE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow_data_validation/anomalies/feature_statistics_validator.h"
+#include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/platform/types.h"
+
+namespace tensorflow {
+namespace data_validation {
+
+// A long-running service validating statistics against registered schemas,
+// for callers that validate often against the same schemas (e.g., monitors).
+// The Validator of a schema (with its indexed schema and compiled config) is
+// created once and kept resident, for the most recently used schemas.
+// Concurrent requests for the same schema are queued, and validated in batches
+// by a bounded pool of workers, so that a schema only occupies as many workers
+// as its load requires. When too many requests are pending, new requests wait
+// for room (backpressure). Thread-safe.
+class ValidationService {
+ public:
+  struct Options {
+    // The number of schemas whose Validator is kept resident. The Validators
+    // of the least recently used schemas are dropped, and created again when
+    // they are used.
+    int max_resident_schemas = 8;
+    // The number of workers validating requests.
+    int num_threads = 4;
+    // The number of requests queued or being validated, over all the schemas,
+    // beyond which Validate(...) waits for a request to finish.
+    int max_pending_requests = 256;
+    // The maximum number of requests of a schema that a worker takes at once.
+    // A schema with more queued requests gets another worker.
+    int max_batch_size = 16;
+  };
+
+  // Statistics on the requests of a schema.
+  struct SchemaStats {
+    int64 requests = 0;
+    int64 failed_requests = 0;
+    int64 batches = 0;
+    // The number of times the Validator was created (once, unless it was
+    // dropped by max_resident_schemas or the schema was registered again).
+    int64 validator_creations = 0;
+    // From the time a request was queued to the time its validation started
+    // (resp. finished).
+    int64 total_queue_micros = 0;
+    int64 total_latency_micros = 0;
+    int64 max_latency_micros = 0;
+  };
+
+  explicit ValidationService(const Options& options);
+
+  // Must not be destroyed while Validate(...) calls are in progress.
+  ~ValidationService();
+
+  ValidationService(const ValidationService&) = delete;
+  ValidationService& operator=(const ValidationService&) = delete;
+
+  // Registers a serialized schema, environment and ValidationConfig (as in
+  // Validator::Create(...)) as schema_id, replacing the previous ones if
+  // schema_id is already registered (without resetting its statistics).
+  // Creates the Validator, so that invalid inputs are rejected here.
+  Status RegisterSchema(const string& schema_id,
+                        absl::string_view schema_proto_string,
+                        const string& environment,
+                        absl::string_view validation_config_string);
+
+  // Validates the serialized statistics against the schema registered as
+  // schema_id, like Validator::ValidateWithSerializedInputs(...), waiting for
+  // the result. Returns NotFound if schema_id is not registered.
+  Status Validate(const string& schema_id,
+                  absl::string_view feature_statistics_proto_string,
+                  absl::string_view previous_span_statistics_proto_string,
+                  absl::string_view serving_statistics_proto_string,
+                  absl::string_view previous_version_statistics_proto_string,
+                  absl::string_view features_needed_string,
+                  bool enable_diff_regions, string* anomalies_proto_string);
+
+  // Gets the statistics of the requests of schema_id. Returns NotFound if
+  // schema_id is not registered.
+  Status GetSchemaStats(const string& schema_id, SchemaStats* stats) const;
+
+ private:
+  struct Request;
+  struct SchemaEntry;
+
+  // Validates the queued requests of entry, a batch at a time, until there are
+  // none left. Runs on a worker.
+  void RunBatches(const std::shared_ptr<SchemaEntry>& entry);
+
+  // Marks entry as the most recently used resident schema, and drops the
+  // Validators of the least recently used ones beyond max_resident_schemas.
+  void MarkResident(const std::shared_ptr<SchemaEntry>& entry)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const Options options_;
+
+  mutable mutex mu_;
+  // Signaled when a request finishes.
+  condition_variable request_done_;
+  absl::flat_hash_map<string, std::shared_ptr<SchemaEntry>> entries_
+      TF_GUARDED_BY(mu_);
+  // The schemas whose Validator is resident, the most recently used first.
+  std::list<SchemaEntry*> resident_ TF_GUARDED_BY(mu_);
+  int pending_requests_ TF_GUARDED_BY(mu_) = 0;
+
+  // Destroyed first, waiting for the workers.
+  std::unique_ptr<thread::ThreadPool> thread_pool_;
+};
+
+}  // namespace data_validation
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_DATA_VALIDATION_ANOMALIES_VALIDATION_SERVICE_H_
@@ -0,0 +1,220 @@
+/* Copyright 2018 Google LLC
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow_data_validation/anomalies/validation_service.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow_data_validation/anomalies/feature_statistics_validator.h"
+#include "tensorflow_data_validation/anomalies/proto/validation_config.pb.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/threadpool.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow_metadata/proto/v0/schema.pb.h"
+#include "tensorflow_metadata/proto/v0/statistics.pb.h"
+
+namespace tensorflow {
+namespace data_validation {
+namespace {
+
+using ::tensorflow::metadata::v0::DatasetFeatureStatistics;
+using ::tensorflow::metadata::v0::Schema;
+
+// Gets a schema expecting feature to have at most max_num_values values.
+string GetSchema(const string& feature, int max_num_values) {
+  Schema schema;
+  tensorflow::metadata::v0::Feature* schema_feature = schema.add_feature();
+  schema_feature->set_name(feature);
+  schema_feature->set_type(tensorflow::metadata::v0::INT);
+  schema_feature->mutable_value_count()->set_max(max_num_values);
+  return schema.SerializeAsString();
+}
+
+// Gets statistics where feature has max_num_values values.
+string GetStatistics(const string& feature, int max_num_values) {
+  DatasetFeatureStatistics statistics;
+  statistics.set_num_examples(10);
+  auto* feature_statistics = statistics.add_features();
+  feature_statistics->set_name(feature);
+  feature_statistics->set_type(
+      tensorflow::metadata::v0::FeatureNameStatistics::INT);
+  auto* common_stats =
+      feature_statistics->mutable_num_stats()->mutable_common_stats();
+  common_stats->set_num_non_missing(10);
+  common_stats->set_max_num_values(max_num_values);
+  return statistics.SerializeAsString();
+}
+
+// Validates statistics against schema with a Validator.
+string ValidateDirectly(const string& schema, const string& statistics) {
+  std::unique_ptr<Validator> validator;
+  TF_CHECK_OK(Validator::Create(schema, /*environment=*/"",
+                                ValidationConfig().SerializeAsString(),
+                                &validator));
+  string result;
+  TF_CHECK_OK(validator->ValidateWithSerializedInputs(
+      statistics, /*previous_span_statistics_proto_string=*/"",
+      /*serving_statistics_proto_string=*/"",
+      /*previous_version_statistics_proto_string=*/"",
+      /*features_needed_string=*/"", /*enable_diff_regions=*/false, &result));
+  return result;
+}
+
+TEST(ValidationServiceTest, ValidatesConcurrentRequests) {
+  ValidationService::Options options;
+  options.num_threads = 2;
+  options.max_pending_requests = 3;
+  options.max_batch_size = 2;
+  ValidationService service(options);
+  const string schema = GetSchema("foo", 1);
+  TF_ASSERT_OK(service.RegisterSchema("foo_schema", schema,
+                                      /*environment=*/"",
+                                      ValidationConfig().SerializeAsString()));
+  const int kNumRequests = 20;
+  std::vector<string> statistics;
+  std::vector<string> expected;
+  for (int i = 0; i < kNumRequests; ++i) {
+    statistics.push_back(GetStatistics("foo", 1 + i % 2));
+    expected.push_back(ValidateDirectly(schema, statistics.back()));
+  }
+  std::vector<string> results(kNumRequests);
+  std::vector<Status> statuses(kNumRequests);
+  {
+    thread::ThreadPool callers(Env::Default(), "callers", 8);
+    for (int i = 0; i < kNumRequests; ++i) {
+      callers.Schedule([&, i]() {
+        statuses[i] = service.Validate(
+            "foo_schema", statistics[i],
+            /*previous_span_statistics_proto_string=*/"",
+            /*serving_statistics_proto_string=*/"",
+            /*previous_version_statistics_proto_string=*/"",
+            /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+            &results[i]);
+      });
+    }
+  }
+  for (int i = 0; i < kNumRequests; ++i) {
+    TF_EXPECT_OK(statuses[i]);
+    EXPECT_EQ(results[i], expected[i]);
+  }
+  ValidationService::SchemaStats stats;
+  TF_ASSERT_OK(service.GetSchemaStats("foo_schema", &stats));
+  EXPECT_EQ(stats.requests, kNumRequests);
+  EXPECT_EQ(stats.failed_requests, 0);
+  EXPECT_GE(stats.batches, kNumRequests / options.max_batch_size);
+  EXPECT_LE(stats.batches, kNumRequests);
+  EXPECT_EQ(stats.validator_creations, 1);
+  EXPECT_GE(stats.total_latency_micros, stats.total_queue_micros);
+  EXPECT_GE(stats.total_latency_micros, stats.max_latency_micros);
+}
+
+TEST(ValidationServiceTest, KeepsRecentlyUsedSchemasResident) {
+  ValidationService::Options options;
+  options.max_resident_schemas = 1;
+  options.num_threads = 1;
+  ValidationService service(options);
+  TF_ASSERT_OK(service.RegisterSchema("foo_schema", GetSchema("foo", 1),
+                                      /*environment=*/"",
+                                      ValidationConfig().SerializeAsString()));
+  TF_ASSERT_OK(service.RegisterSchema("bar_schema", GetSchema("bar", 1),
+                                      /*environment=*/"",
+                                      ValidationConfig().SerializeAsString()));
+  const string foo_statistics = GetStatistics("foo", 2);
+  const string bar_statistics = GetStatistics("bar", 2);
+  string result;
+  for (int i = 0; i < 2; ++i) {
+    TF_ASSERT_OK(service.Validate(
+        "foo_schema", foo_statistics,
+        /*previous_span_statistics_proto_string=*/"",
+        /*serving_statistics_proto_string=*/"",
+        /*previous_version_statistics_proto_string=*/"",
+        /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+        &result));
+    EXPECT_EQ(result, ValidateDirectly(GetSchema("foo", 1), foo_statistics));
+    TF_ASSERT_OK(service.Validate(
+        "bar_schema", bar_statistics,
+        /*previous_span_statistics_proto_string=*/"",
+        /*serving_statistics_proto_string=*/"",
+        /*previous_version_statistics_proto_string=*/"",
+        /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+        &result));
+    EXPECT_EQ(result, ValidateDirectly(GetSchema("bar", 1), bar_statistics));
+  }
+  // Only one schema is resident at a time, so each request indexes its schema
+  // again, as the other schema was used last.
+  ValidationService::SchemaStats stats;
+  TF_ASSERT_OK(service.GetSchemaStats("foo_schema", &stats));
+  EXPECT_EQ(stats.validator_creations, 3);
+  TF_ASSERT_OK(service.GetSchemaStats("bar_schema", &stats));
+  EXPECT_EQ(stats.validator_creations, 3);
+  EXPECT_EQ(stats.requests, 2);
+
+  // With both schemas resident, they are not indexed again.
+  options.max_resident_schemas = 2;
+  ValidationService resident_service(options);
+  for (const string& schema_id : {"foo_schema", "bar_schema"}) {
+    TF_ASSERT_OK(resident_service.RegisterSchema(
+        schema_id, GetSchema(schema_id == "foo_schema" ? "foo" : "bar", 1),
+        /*environment=*/"", ValidationConfig().SerializeAsString()));
+  }
+  for (int i = 0; i < 2; ++i) {
+    TF_ASSERT_OK(resident_service.Validate(
+        "foo_schema", foo_statistics,
+        /*previous_span_statistics_proto_string=*/"",
+        /*serving_statistics_proto_string=*/"",
+        /*previous_version_statistics_proto_string=*/"",
+        /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+        &result));
+    TF_ASSERT_OK(resident_service.Validate(
+        "bar_schema", bar_statistics,
+        /*previous_span_statistics_proto_string=*/"",
+        /*serving_statistics_proto_string=*/"",
+        /*previous_version_statistics_proto_string=*/"",
+        /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+        &result));
+  }
+  TF_ASSERT_OK(resident_service.GetSchemaStats("foo_schema", &stats));
+  EXPECT_EQ(stats.validator_creations, 1);
+  TF_ASSERT_OK(resident_service.GetSchemaStats("bar_schema", &stats));
+  EXPECT_EQ(stats.validator_creations, 1);
+}
+
+TEST(ValidationServiceTest, Errors) {
+  ValidationService service((ValidationService::Options()));
+  EXPECT_FALSE(service
+                   .RegisterSchema("invalid", "\xff\xff\xff",
+                                   /*environment=*/"",
+                                   ValidationConfig().SerializeAsString())
+                   .ok());
+  string result;
+  EXPECT_TRUE(errors::IsNotFound(service.Validate(
+      "invalid", GetStatistics("foo", 1),
+      /*previous_span_statistics_proto_string=*/"",
+      /*serving_statistics_proto_string=*/"",
+      /*previous_version_statistics_proto_string=*/"",
+      /*features_needed_string=*/"", /*enable_diff_regions=*/false,
+      &result)));
+  ValidationService::SchemaStats stats;
+  EXPECT_TRUE(errors::IsNotFound(service.GetSchemaStats("invalid", &stats)));
+}
+
+}  // namespace
+}  // namespace data_validation
+}  // namespace tensorflow
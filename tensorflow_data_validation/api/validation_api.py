@@ -430,6 +430,8 @@ def validate_statistics_internal(
         validation_options.new_features_are_warnings)
     for override in validation_options.severity_overrides:
       validation_config.severity_overrides.append(override)
+    validation_config.only_validate_features_needed = (
+        validation_options.only_validate_features_needed)
   serialized_validation_config = validation_config.SerializeToString()
 
   anomalies_proto_string = (
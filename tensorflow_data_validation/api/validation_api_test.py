@@ -19,6 +19,8 @@ from __future__ import absolute_import
 from __future__ import division
 from __future__ import print_function
 
+from concurrent import futures
+
 from absl.testing import absltest
 from absl.testing import parameterized
 import apache_beam as beam
@@ -1166,6 +1168,32 @@ class ValidationApiTest(ValidationTestCase):
     anomalies = validation_api.validate_statistics(statistics, schema)
     self._assert_equal_anomalies(anomalies, expected_anomalies)
 
+  def test_validate_stats_from_many_threads(self):
+    # The C++ validation releases the GIL, so concurrent calls run in parallel.
+    # They must return the same anomalies as a single call.
+    schema = schema_pb2.Schema()
+    statistics = statistics_pb2.DatasetFeatureStatisticsList()
+    dataset = statistics.datasets.add(num_examples=10)
+    for i in range(100):
+      feature = schema.feature.add(name='feature_%d' % i, type=schema_pb2.INT)
+      feature.presence.min_fraction = 1.0
+      feature_stats = dataset.features.add(
+          type=statistics_pb2.FeatureNameStatistics.INT)
+      feature_stats.path.step.append('feature_%d' % i)
+      feature_stats.num_stats.common_stats.num_non_missing = 6 + i % 5
+      feature_stats.num_stats.common_stats.num_missing = 4 - i % 5
+      feature_stats.num_stats.common_stats.min_num_values = 1
+      feature_stats.num_stats.common_stats.max_num_values = 1
+    expected_anomalies = validation_api.validate_statistics(statistics, schema)
+    with futures.ThreadPoolExecutor(max_workers=4) as executor:
+      all_anomalies = list(
+          executor.map(
+              lambda _: validation_api.validate_statistics(statistics, schema),
+              range(16)))
+    self.assertLen(expected_anomalies.anomaly_info, 80)
+    for anomalies in all_anomalies:
+      self.assertEqual(anomalies, expected_anomalies)
+
   def test_validate_stats_weighted_feature(self):
     schema = text_format.Parse(
         """
@@ -43,10 +43,12 @@ class ValidationOptions(object):
                                         List[ReasonFeatureNeeded]]] = None,
       new_features_are_warnings: Optional[bool] = False,
       severity_overrides: Optional[List[
-          validation_config_pb2.SeverityOverride]] = None):
+          validation_config_pb2.SeverityOverride]] = None,
+      only_validate_features_needed: Optional[bool] = False):
     self._features_needed = features_needed
     self._new_features_are_warnings = new_features_are_warnings
     self._severity_overrides = severity_overrides or []
+    self._only_validate_features_needed = only_validate_features_needed
 
   @property
   def features_needed(
@@ -60,3 +62,7 @@ class ValidationOptions(object):
   @property
   def severity_overrides(self) -> List[validation_config_pb2.SeverityOverride]:
     return self._severity_overrides
+
+  @property
+  def only_validate_features_needed(self) -> bool:
+    return self._only_validate_features_needed
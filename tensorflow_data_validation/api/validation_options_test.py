@@ -34,15 +34,18 @@ class ValidationOptionsTest(absltest.TestCase):
     }
     new_features_are_warnings = True
     severity_overrides = []
-    options = validation_options.ValidationOptions(features_needed,
-                                                   new_features_are_warnings,
-                                                   severity_overrides)
+    only_validate_features_needed = True
+    options = validation_options.ValidationOptions(
+        features_needed, new_features_are_warnings, severity_overrides,
+        only_validate_features_needed)
 
     # Test getters
     self.assertEqual(features_needed, options.features_needed)
     self.assertEqual(new_features_are_warnings,
                      options.new_features_are_warnings)
     self.assertEqual(severity_overrides, options.severity_overrides)
+    self.assertEqual(only_validate_features_needed,
+                     options.only_validate_features_needed)
 
 
 if __name__ == '__main__':
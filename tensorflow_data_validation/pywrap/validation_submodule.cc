@@ -13,71 +13,897 @@
 // limitations under the License.
 #include "tensorflow_data_validation/pywrap/validation_submodule.h"
 
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow_data_validation/anomalies/async_validation_queue.h"
 #include "tensorflow_data_validation/anomalies/feature_statistics_validator.h"
+#include "tensorflow_data_validation/anomalies/proto/validation_metadata.pb.h"
+#include "tensorflow_data_validation/anomalies/schema_anomalies.h"
+#include "tensorflow_data_validation/anomalies/schema_snapshot.h"
+#include "tensorflow_data_validation/anomalies/serialized_output.h"
+#include "tensorflow_data_validation/anomalies/validation_deadline.h"
+#include "tensorflow_data_validation/anomalies/validation_result_cache.h"
 #include "include/pybind11/pybind11.h"
+#include "include/pybind11/stl.h"
 
 
 namespace tensorflow {
 namespace data_validation {
 namespace py = pybind11;
 
+namespace {
+
+// A read-only view of the memory of a Python object supporting the buffer
+// protocol (e.g., bytes or memoryview), so that protos can be parsed without
+// first copying them into a std::string. The memory is valid as long as the
+// BufferView is alive.
+class BufferView {
+ public:
+  explicit BufferView(const py::buffer& buffer) : info_(buffer.request()) {
+    if (info_.ndim > 1 || (info_.ndim == 1 && info_.strides[0] != 1) ||
+        info_.itemsize != 1) {
+      throw std::invalid_argument(
+          "Expected a contiguous buffer of bytes (e.g., bytes or memoryview).");
+    }
+  }
+
+  absl::string_view view() const {
+    return absl::string_view(static_cast<const char*>(info_.ptr), info_.size);
+  }
+
+ private:
+  py::buffer_info info_;
+};
+
+// Runs fn without holding the GIL, so that other Python threads can run while
+// the (pure C++) fn is busy. fn must not touch any Python object.
+template <typename Fn>
+tensorflow::Status RunWithoutGil(Fn fn) {
+  py::gil_scoped_release release_gil;
+  return fn();
+}
+
+// A SerializedOutput writing to a new Python bytes object, so that a result is
+// serialized once, straight into the object returned to Python, instead of
+// being serialized to a string and then copied. Allocate() is called without
+// the GIL (see RunWithoutGil), so it only takes the GIL to create the object,
+// which is then written without it: no other Python code can refer to the
+// object yet.
+class BytesOutput : public SerializedOutput {
+ public:
+  char* Allocate(size_t size) override {
+    py::gil_scoped_acquire acquire_gil;
+    PyObject* bytes = PyBytes_FromStringAndSize(nullptr, size);
+    if (bytes == nullptr) {
+      PyErr_Clear();
+      return nullptr;
+    }
+    bytes_ = py::reinterpret_steal<py::bytes>(bytes);
+    return PyBytes_AS_STRING(bytes);
+  }
+
+  // The serialized proto, once it is written. Must be called with the GIL.
+  py::bytes bytes() const { return bytes_; }
+
+ private:
+  py::bytes bytes_;
+};
+
+// Runs a validation on its own thread, and passes the anomalies it finds to
+// Python through a bounded queue, so that they can be consumed (and freed)
+// while the validation goes on. Each item is a (kind, path, serialized proto)
+// tuple, where kind is "anomaly_info", "drift_skew_info",
+// "dataset_anomaly_info" or "data_missing" (with an empty proto), and path is
+// only set for "anomaly_info". If the iterator is deleted before the end, the
+// validation is cancelled.
+class StreamingValidation : public AnomaliesSink {
+ public:
+  struct Item {
+    std::string kind;
+    std::string path;
+    std::string serialized;
+  };
+
+  // Runs validate(views, this) on a new thread, where views are the views of
+  // inputs, which are kept alive until the validation is done.
+  StreamingValidation(
+      std::vector<BufferView> inputs,
+      std::function<tensorflow::Status(const std::vector<absl::string_view>&,
+                                       AnomaliesSink*)>
+          validate)
+      : inputs_(std::move(inputs)) {
+    std::vector<absl::string_view> views;
+    for (const BufferView& input : inputs_) {
+      views.push_back(input.view());
+    }
+    thread_.reset(tensorflow::Env::Default()->StartThread(
+        tensorflow::ThreadOptions(), "streaming_validation",
+        [this, views, validate]() {
+          const tensorflow::Status status = validate(views, this);
+          tensorflow::mutex_lock lock(mu_);
+          status_ = status;
+          done_ = true;
+          item_added_.notify_all();
+        }));
+  }
+
+  // Cancels the validation if it is not done, and waits for its thread. Must
+  // be called with the GIL held (the inputs are released with it).
+  ~StreamingValidation() override {
+    py::gil_scoped_release release_gil;
+    {
+      tensorflow::mutex_lock lock(mu_);
+      cancelled_ = true;
+      item_removed_.notify_all();
+    }
+    // The destructor of the thread joins it.
+    thread_.reset();
+  }
+
+  // Waits for the next item. Returns false if there are no more items, and
+  // then sets *status to the status of the validation.
+  bool Next(Item* item, tensorflow::Status* status) {
+    tensorflow::mutex_lock lock(mu_);
+    while (items_.empty() && !done_) {
+      item_added_.wait(lock);
+    }
+    if (items_.empty()) {
+      *status = status_;
+      return false;
+    }
+    *item = std::move(items_.front());
+    items_.pop_front();
+    item_removed_.notify_all();
+    return true;
+  }
+
+  tensorflow::Status OnAnomalyInfo(
+      const std::string& path,
+      const tensorflow::metadata::v0::AnomalyInfo& anomaly_info) override {
+    return Add({"anomaly_info", path, anomaly_info.SerializeAsString()});
+  }
+
+  tensorflow::Status OnDriftSkewInfo(
+      const tensorflow::metadata::v0::DriftSkewInfo& drift_skew_info)
+      override {
+    return Add({"drift_skew_info", "", drift_skew_info.SerializeAsString()});
+  }
+
+  tensorflow::Status OnDatasetAnomalyInfo(
+      const tensorflow::metadata::v0::AnomalyInfo& anomaly_info) override {
+    return Add({"dataset_anomaly_info", "", anomaly_info.SerializeAsString()});
+  }
+
+  tensorflow::Status OnDataMissing() override {
+    return Add({"data_missing", "", ""});
+  }
+
+ private:
+  // The number of items that can wait in the queue before the validation
+  // waits for them to be consumed.
+  static constexpr size_t kMaxQueuedItems = 1024;
+
+  // Waits for room in the queue, and adds item to it.
+  tensorflow::Status Add(Item item) {
+    tensorflow::mutex_lock lock(mu_);
+    while (items_.size() >= kMaxQueuedItems && !cancelled_) {
+      item_removed_.wait(lock);
+    }
+    if (cancelled_) {
+      return tensorflow::errors::Cancelled(
+          "The anomalies are no longer consumed.");
+    }
+    items_.push_back(std::move(item));
+    item_added_.notify_all();
+    return tensorflow::Status::OK();
+  }
+
+  const std::vector<BufferView> inputs_;
+  tensorflow::mutex mu_;
+  tensorflow::condition_variable item_added_;
+  tensorflow::condition_variable item_removed_;
+  std::deque<Item> items_ TF_GUARDED_BY(mu_);
+  bool done_ TF_GUARDED_BY(mu_) = false;
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  tensorflow::Status status_ TF_GUARDED_BY(mu_);
+  std::unique_ptr<tensorflow::Thread> thread_;
+};
+
+// The queue running the validations of Validator.ValidateAsync, shared by all
+// the validators, and created on first use.
+struct AsyncValidationState {
+  tensorflow::mutex mu;
+  int num_threads TF_GUARDED_BY(mu) = 4;
+  int max_pending TF_GUARDED_BY(mu) = 256;
+  std::shared_ptr<AsyncValidationQueue> queue TF_GUARDED_BY(mu);
+};
+
+AsyncValidationState* GetAsyncValidationState() {
+  static AsyncValidationState* state = new AsyncValidationState();
+  return state;
+}
+
+std::shared_ptr<AsyncValidationQueue> GetAsyncValidationQueue() {
+  AsyncValidationState* state = GetAsyncValidationState();
+  tensorflow::mutex_lock lock(state->mu);
+  if (state->queue == nullptr) {
+    state->queue = std::make_shared<AsyncValidationQueue>(
+        "async_validation", state->num_threads, state->max_pending);
+  }
+  return state->queue;
+}
+
+// Drops a reference to queue without the GIL: if it was the last one, the
+// queue waits for its validations, which take the GIL when they are done.
+void ReleaseAsyncValidationQueue(std::shared_ptr<AsyncValidationQueue> queue) {
+  py::gil_scoped_release release_gil;
+  queue.reset();
+}
+
+// The Python objects of a validation run by ValidateAsync. They are released
+// with the GIL when the validation is done (see FinishAsyncValidation), since
+// the last reference to the request may be dropped on a thread of the queue.
+struct AsyncValidationRequest {
+  // Keeps the validator alive while it is used.
+  py::object validator;
+  py::object loop;
+  py::object future;
+  std::vector<BufferView> inputs;
+  std::unique_ptr<BytesOutput> anomalies_output;
+};
+
+// Returns the event loop running in the current thread, to which the future
+// of ValidateAsync is bound. Unlike asyncio.get_event_loop(), this never
+// returns (or creates) a loop that is not running, whose callbacks would never
+// run.
+py::object GetRunningEventLoop() {
+  try {
+    return py::module::import("asyncio").attr("get_running_loop")();
+  } catch (py::error_already_set& e) {
+    if (!e.matches(PyExc_RuntimeError)) {
+      throw;
+    }
+    throw std::runtime_error(
+        "ValidateAsync must be called from a coroutine or a callback run by "
+        "an asyncio event loop, but no event loop is running.");
+  }
+}
+
+// Completes future with result (the serialized anomalies), unless it is done
+// already (e.g., cancelled). If error is not empty, raises it instead. Runs on
+// the thread of the event loop of future (see FinishAsyncValidation).
+void SetAsyncValidationResult(py::object future, py::object result,
+                              const std::string& error) {
+  if (future.attr("done")().cast<bool>()) {
+    return;
+  }
+  if (!error.empty()) {
+    future.attr("set_exception")(
+        py::reinterpret_borrow<py::object>(PyExc_RuntimeError)(error));
+  } else {
+    future.attr("set_result")(result);
+  }
+}
+
+// Passes the result of request to its future, through its event loop, and
+// releases the Python objects of request. Called without the GIL, on a thread
+// of the queue.
+void FinishAsyncValidation(AsyncValidationRequest* request,
+                           const tensorflow::Status& status) {
+  py::gil_scoped_acquire acquire_gil;
+  // A cancelled future is already done.
+  if (!tensorflow::errors::IsCancelled(status)) {
+    py::object result = py::none();
+    if (status.ok()) {
+      result = request->anomalies_output->bytes();
+    }
+    try {
+      request->loop.attr("call_soon_threadsafe")(
+          py::cpp_function(&SetAsyncValidationResult), request->future,
+          result, status.ok() ? std::string() : status.ToString());
+    } catch (py::error_already_set& e) {
+      // The event loop is closed, so nobody waits for the result.
+    }
+  }
+  request->validator = py::object();
+  request->loop = py::object();
+  request->future = py::object();
+  request->inputs.clear();
+  request->anomalies_output.reset();
+}
+
+}  // namespace
+
 void DefineValidationSubmodule(py::module main_module) {
   auto m = main_module.def_submodule("validation");
   m.doc() = "Validation API.";
 
-  m.def("InferSchema",
-        [](const std::string& statistics_proto_string,
-           int max_string_domain_size, bool infer_feature_shape) -> py::object {
-          std::string schema_proto_string;
-          const tensorflow::Status status =
-              InferSchema(statistics_proto_string, max_string_domain_size,
-                          infer_feature_shape, &schema_proto_string);
+  m.def(
+      "InferSchema",
+      [](const py::buffer& statistics_proto_string, int max_string_domain_size,
+         bool infer_feature_shape, int num_threads) -> py::object {
+        const BufferView statistics(statistics_proto_string);
+        BytesOutput schema_output;
+        const tensorflow::Status status = RunWithoutGil([&]() {
+          return InferSchema(statistics.view(), max_string_domain_size,
+                             infer_feature_shape, num_threads, &schema_output);
+        });
+        if (!status.ok()) {
+          throw std::runtime_error(status.ToString());
+        }
+        return schema_output.bytes();
+      },
+      py::arg("statistics_proto_string"), py::arg("max_string_domain_size"),
+      py::arg("infer_feature_shape"), py::arg("num_threads") = 1);
+
+  m.def(
+      "UpdateSchema",
+      [](const py::buffer& schema_proto_string,
+         const py::buffer& statistics_proto_string, int max_string_domain_size,
+         int num_threads) -> py::object {
+        const BufferView schema(schema_proto_string);
+        const BufferView statistics(statistics_proto_string);
+        BytesOutput schema_output;
+        const tensorflow::Status status = RunWithoutGil([&]() {
+          return UpdateSchema(schema.view(), statistics.view(),
+                              max_string_domain_size, num_threads,
+                              &schema_output);
+        });
+        if (!status.ok()) {
+          throw std::runtime_error(status.ToString());
+        }
+        return schema_output.bytes();
+      },
+      py::arg("schema_proto_string"), py::arg("statistics_proto_string"),
+      py::arg("max_string_domain_size"), py::arg("num_threads") = 1);
+
+  m.def(
+      "UpdateSchemaIncrementally",
+      [](const py::buffer& schema_proto_string,
+         const py::buffer& previous_statistics_proto_string,
+         const py::buffer& statistics_proto_string, int max_string_domain_size,
+         int num_threads) -> py::object {
+        const BufferView schema(schema_proto_string);
+        const BufferView previous_statistics(previous_statistics_proto_string);
+        const BufferView statistics(statistics_proto_string);
+        BytesOutput schema_output;
+        const tensorflow::Status status = RunWithoutGil([&]() {
+          return UpdateSchemaIncrementally(
+              schema.view(), previous_statistics.view(), statistics.view(),
+              max_string_domain_size, num_threads, &schema_output);
+        });
+        if (!status.ok()) {
+          throw std::runtime_error(status.ToString());
+        }
+        return schema_output.bytes();
+      },
+      py::arg("schema_proto_string"),
+      py::arg("previous_statistics_proto_string"),
+      py::arg("statistics_proto_string"), py::arg("max_string_domain_size"),
+      py::arg("num_threads") = 1);
+
+  m.def("ValidateFeatureStatistics",
+        [](const py::buffer& statistics_proto_string,
+           const py::buffer& schema_proto_string,
+           const std::string& environment,
+           const py::buffer& previous_span_statistics_proto_string,
+           const py::buffer& serving_statistics_proto_string,
+           const py::buffer& previous_version_statistics_proto_string,
+           const py::buffer& feature_needed_string,
+           const py::buffer& validation_config_string,
+           const bool enable_diff_regions) -> py::object {
+          const BufferView statistics(statistics_proto_string);
+          const BufferView schema(schema_proto_string);
+          const BufferView previous_span_statistics(
+              previous_span_statistics_proto_string);
+          const BufferView serving_statistics(serving_statistics_proto_string);
+          const BufferView previous_version_statistics(
+              previous_version_statistics_proto_string);
+          const BufferView feature_needed(feature_needed_string);
+          const BufferView validation_config(validation_config_string);
+          BytesOutput anomalies_output;
+          const tensorflow::Status status = RunWithoutGil([&]() {
+            return ValidateFeatureStatisticsWithSerializedInputs(
+                statistics.view(), schema.view(), environment,
+                previous_span_statistics.view(), serving_statistics.view(),
+                previous_version_statistics.view(), feature_needed.view(),
+                validation_config.view(), enable_diff_regions,
+                &anomalies_output, /*profile=*/nullptr);
+          });
           if (!status.ok()) {
             throw std::runtime_error(status.ToString());
           }
-          return py::bytes(schema_proto_string);
+          return anomalies_output.bytes();
         });
 
-  m.def("UpdateSchema",
-        [](const std::string& schema_proto_string,
-           const std::string& statistics_proto_string,
-           int max_string_domain_size) -> py::object {
-          std::string output_schema_proto_string;
-          const tensorflow::Status status =
-              UpdateSchema(
-                  schema_proto_string, statistics_proto_string,
-                  max_string_domain_size, &output_schema_proto_string);
+  // Same as ValidateFeatureStatistics, but reads the statistics and the schema
+  // from files, which are mapped in memory rather than read into Python. An
+  // empty path means the corresponding input is absent.
+  m.def("ValidateFeatureStatisticsFromFiles",
+        [](const std::string& statistics_path, const std::string& schema_path,
+           const std::string& environment,
+           const std::string& previous_span_statistics_path,
+           const std::string& serving_statistics_path,
+           const std::string& previous_version_statistics_path,
+           const py::buffer& feature_needed_string,
+           const py::buffer& validation_config_string,
+           const bool enable_diff_regions) -> py::object {
+          const BufferView feature_needed(feature_needed_string);
+          const BufferView validation_config(validation_config_string);
+          BytesOutput anomalies_output;
+          const tensorflow::Status status = RunWithoutGil([&]() {
+            return ValidateFeatureStatisticsFromFiles(
+                statistics_path, schema_path, environment,
+                previous_span_statistics_path, serving_statistics_path,
+                previous_version_statistics_path, feature_needed.view(),
+                validation_config.view(), enable_diff_regions,
+                &anomalies_output, /*profile=*/nullptr);
+          });
           if (!status.ok()) {
             throw std::runtime_error(status.ToString());
           }
-          return py::bytes(output_schema_proto_string);
+          return anomalies_output.bytes();
         });
 
-  m.def("ValidateFeatureStatistics",
-        [](const std::string& statistics_proto_string,
-           const std::string& schema_proto_string,
+  // Same as ValidateFeatureStatistics, but returns a (serialized anomalies,
+  // serialized ValidationProfile) tuple, with the time of each stage of the
+  // validation and the work it did.
+  m.def("ValidateFeatureStatisticsWithProfile",
+        [](const py::buffer& statistics_proto_string,
+           const py::buffer& schema_proto_string,
            const std::string& environment,
-           const std::string& previous_span_statistics_proto_string,
-           const std::string& serving_statistics_proto_string,
-           const std::string& previous_version_statistics_proto_string,
-           const std::string& feature_needed_string,
-           const std::string& validation_config_string,
-           const bool enable_diff_regions) -> py::object {
-          std::string anomalies_proto_string;
-          const tensorflow::Status status = \
-              ValidateFeatureStatisticsWithSerializedInputs(
-                  statistics_proto_string, schema_proto_string, environment,
-                  previous_span_statistics_proto_string,
-                  serving_statistics_proto_string,
-                  previous_version_statistics_proto_string,
-                  feature_needed_string, validation_config_string,
-                  enable_diff_regions, &anomalies_proto_string);
+           const py::buffer& previous_span_statistics_proto_string,
+           const py::buffer& serving_statistics_proto_string,
+           const py::buffer& previous_version_statistics_proto_string,
+           const py::buffer& feature_needed_string,
+           const py::buffer& validation_config_string,
+           const bool enable_diff_regions) -> py::tuple {
+          const BufferView statistics(statistics_proto_string);
+          const BufferView schema(schema_proto_string);
+          const BufferView previous_span_statistics(
+              previous_span_statistics_proto_string);
+          const BufferView serving_statistics(serving_statistics_proto_string);
+          const BufferView previous_version_statistics(
+              previous_version_statistics_proto_string);
+          const BufferView feature_needed(feature_needed_string);
+          const BufferView validation_config(validation_config_string);
+          BytesOutput anomalies_output;
+          ValidationProfile profile;
+          const tensorflow::Status status = RunWithoutGil([&]() {
+            return ValidateFeatureStatisticsWithSerializedInputs(
+                statistics.view(), schema.view(), environment,
+                previous_span_statistics.view(), serving_statistics.view(),
+                previous_version_statistics.view(), feature_needed.view(),
+                validation_config.view(), enable_diff_regions,
+                &anomalies_output, &profile);
+          });
+          if (!status.ok()) {
+            throw std::runtime_error(status.ToString());
+          }
+          return py::make_tuple(anomalies_output.bytes(),
+                                py::bytes(profile.SerializeAsString()));
+        });
+
+  m.def(
+      "SetValidationResultCache",
+      [](int64 max_bytes, const std::string& directory) {
+        SetValidationResultCache(
+            std::make_shared<ValidationResultCache>(max_bytes, directory));
+      },
+      py::arg("max_bytes"), py::arg("directory") = "");
+
+  // Sets the number of threads running the validations of
+  // Validator.ValidateAsync, and the number of validations that can be queued
+  // or running at once, beyond which ValidateAsync raises. Waits for the
+  // validations submitted before.
+  m.def(
+      "SetAsyncValidationOptions",
+      [](int num_threads, int max_pending_validations) {
+        AsyncValidationState* state = GetAsyncValidationState();
+        std::shared_ptr<AsyncValidationQueue> queue;
+        {
+          tensorflow::mutex_lock lock(state->mu);
+          state->num_threads = num_threads;
+          state->max_pending = max_pending_validations;
+          queue = std::move(state->queue);
+          state->queue = nullptr;
+        }
+        ReleaseAsyncValidationQueue(std::move(queue));
+      },
+      py::arg("num_threads"), py::arg("max_pending_validations"));
+
+  m.def("DisableValidationResultCache",
+        []() { SetValidationResultCache(nullptr); });
+
+  m.def("GetValidationResultCacheStats", []() -> py::dict {
+    py::dict result;
+    const std::shared_ptr<ValidationResultCache> cache =
+        GetValidationResultCache();
+    if (cache != nullptr) {
+      const ValidationResultCache::Stats stats = cache->GetStats();
+      result["memory_hits"] = stats.memory_hits;
+      result["disk_hits"] = stats.disk_hits;
+      result["misses"] = stats.misses;
+    }
+    return result;
+  });
+
+  m.def("WriteSchemaSnapshot",
+        [](const py::buffer& schema_proto_string, const std::string& path) {
+          const BufferView schema_view(schema_proto_string);
+          tensorflow::metadata::v0::Schema schema;
+          if (!schema.ParseFromArray(schema_view.view().data(),
+                                     schema_view.view().size())) {
+            throw std::runtime_error("Failed to parse Schema proto.");
+          }
+          const tensorflow::Status status = RunWithoutGil(
+              [&]() { return WriteSchemaSnapshot(schema, path); });
           if (!status.ok()) {
             throw std::runtime_error(status.ToString());
           }
-          return py::bytes(anomalies_proto_string);
         });
+
+  m.def("ValidateFeatureStatisticsBatch",
+        [](const py::buffer& schema_proto_string,
+           const std::string& environment,
+           const std::vector<py::buffer>& statistics_proto_strings,
+           const std::vector<py::buffer>&
+               previous_span_statistics_proto_strings,
+           const std::vector<py::buffer>& serving_statistics_proto_strings,
+           const std::vector<py::buffer>&
+               previous_version_statistics_proto_strings,
+           const py::buffer& feature_needed_string,
+           const py::buffer& validation_config_string,
+           const bool enable_diff_regions) -> py::list {
+          const BufferView schema(schema_proto_string);
+          const BufferView feature_needed(feature_needed_string);
+          const BufferView validation_config(validation_config_string);
+          // Holds the buffers of all the statistics while they are viewed.
+          std::vector<BufferView> buffers;
+          const auto get_views = [&buffers](
+                                     const std::vector<py::buffer>& inputs) {
+            std::vector<absl::string_view> views;
+            for (const py::buffer& input : inputs) {
+              buffers.emplace_back(input);
+              views.push_back(buffers.back().view());
+            }
+            return views;
+          };
+          buffers.reserve(statistics_proto_strings.size() +
+                          previous_span_statistics_proto_strings.size() +
+                          serving_statistics_proto_strings.size() +
+                          previous_version_statistics_proto_strings.size());
+          const std::vector<absl::string_view> statistics =
+              get_views(statistics_proto_strings);
+          const std::vector<absl::string_view> previous_span_statistics =
+              get_views(previous_span_statistics_proto_strings);
+          const std::vector<absl::string_view> serving_statistics =
+              get_views(serving_statistics_proto_strings);
+          const std::vector<absl::string_view> previous_version_statistics =
+              get_views(previous_version_statistics_proto_strings);
+          std::vector<std::string> anomalies_proto_strings;
+          const tensorflow::Status status = RunWithoutGil([&]() {
+            return ValidateFeatureStatisticsBatch(
+                schema.view(), environment, statistics,
+                previous_span_statistics, serving_statistics,
+                previous_version_statistics, feature_needed.view(),
+                validation_config.view(), enable_diff_regions,
+                &anomalies_proto_strings);
+          });
+          if (!status.ok()) {
+            throw std::runtime_error(status.ToString());
+          }
+          py::list result;
+          for (const std::string& anomalies_proto_string :
+               anomalies_proto_strings) {
+            result.append(py::bytes(anomalies_proto_string));
+          }
+          return result;
+        });
+
+  // Validates each slice of a serialized DatasetFeatureStatisticsList (see
+  // ValidateFeatureStatisticsList), and returns a dict from the name of each
+  // slice to its serialized anomalies.
+  m.def("ValidateFeatureStatisticsList",
+        [](const py::buffer& schema_proto_string,
+           const std::string& environment,
+           const py::buffer& statistics_list_proto_string,
+           const py::buffer& previous_span_statistics_list_proto_string,
+           const py::buffer& serving_statistics_list_proto_string,
+           const py::buffer& previous_version_statistics_list_proto_string,
+           const py::buffer& feature_needed_string,
+           const py::buffer& validation_config_string,
+           const bool enable_diff_regions) -> py::dict {
+          const BufferView schema(schema_proto_string);
+          const BufferView statistics_list(statistics_list_proto_string);
+          const BufferView previous_span_statistics_list(
+              previous_span_statistics_list_proto_string);
+          const BufferView serving_statistics_list(
+              serving_statistics_list_proto_string);
+          const BufferView previous_version_statistics_list(
+              previous_version_statistics_list_proto_string);
+          const BufferView feature_needed(feature_needed_string);
+          const BufferView validation_config(validation_config_string);
+          std::map<std::string, std::string> anomalies_proto_strings;
+          const tensorflow::Status status = RunWithoutGil([&]() {
+            return ValidateFeatureStatisticsList(
+                schema.view(), environment, statistics_list.view(),
+                previous_span_statistics_list.view(),
+                serving_statistics_list.view(),
+                previous_version_statistics_list.view(), feature_needed.view(),
+                validation_config.view(), enable_diff_regions,
+                &anomalies_proto_strings);
+          });
+          if (!status.ok()) {
+            throw std::runtime_error(status.ToString());
+          }
+          py::dict result;
+          for (const auto& pair : anomalies_proto_strings) {
+            result[py::str(pair.first)] = py::bytes(pair.second);
+          }
+          return result;
+        });
+
+  py::class_<Validator>(m, "Validator")
+      .def(py::init([](const py::buffer& schema_proto_string,
+                       const std::string& environment,
+                       const py::buffer& validation_config_string) {
+        const BufferView schema(schema_proto_string);
+        const BufferView validation_config(validation_config_string);
+        std::unique_ptr<Validator> validator;
+        const tensorflow::Status status = RunWithoutGil([&]() {
+          return Validator::Create(schema.view(), environment,
+                                   validation_config.view(), &validator);
+        });
+        if (!status.ok()) {
+          throw std::runtime_error(status.ToString());
+        }
+        return validator;
+      }))
+      // Creates a validator from a schema snapshot written by
+      // WriteSchemaSnapshot().
+      .def_static("FromSchemaSnapshot",
+                  [](const std::string& schema_snapshot_path,
+                     const std::string& environment,
+                     const py::buffer& validation_config_string) {
+                    const BufferView validation_config(
+                        validation_config_string);
+                    std::unique_ptr<Validator> validator;
+                    const tensorflow::Status status = RunWithoutGil([&]() {
+                      return Validator::CreateFromSchemaSnapshot(
+                          schema_snapshot_path, environment,
+                          validation_config.view(), &validator);
+                    });
+                    if (!status.ok()) {
+                      throw std::runtime_error(status.ToString());
+                    }
+                    return validator;
+                  })
+      .def("Validate",
+           [](const Validator& validator,
+              const py::buffer& statistics_proto_string,
+              const py::buffer& previous_span_statistics_proto_string,
+              const py::buffer& serving_statistics_proto_string,
+              const py::buffer& previous_version_statistics_proto_string,
+              const py::buffer& feature_needed_string,
+              const bool enable_diff_regions) -> py::object {
+             const BufferView statistics(statistics_proto_string);
+             const BufferView previous_span_statistics(
+                 previous_span_statistics_proto_string);
+             const BufferView serving_statistics(
+                 serving_statistics_proto_string);
+             const BufferView previous_version_statistics(
+                 previous_version_statistics_proto_string);
+             const BufferView feature_needed(feature_needed_string);
+             BytesOutput anomalies_output;
+             // Validator is thread-safe, so this can run concurrently with
+             // other calls of the same validator.
+             const tensorflow::Status status = RunWithoutGil([&]() {
+               return validator.ValidateWithSerializedInputs(
+                   statistics.view(), previous_span_statistics.view(),
+                   serving_statistics.view(),
+                   previous_version_statistics.view(), feature_needed.view(),
+                   enable_diff_regions, &anomalies_output,
+                   /*profile=*/nullptr);
+             });
+             if (!status.ok()) {
+               throw std::runtime_error(status.ToString());
+             }
+             return anomalies_output.bytes();
+           })
+      // Returns the serialized drift of the statistics against each of the
+      // previous spans, computed in one pass.
+      .def("ComputeDrift",
+           [](const Validator& validator,
+              const py::buffer& statistics_proto_string,
+              const std::vector<py::buffer>&
+                  previous_span_statistics_proto_strings) -> py::list {
+             const BufferView statistics(statistics_proto_string);
+             std::vector<BufferView> buffers;
+             buffers.reserve(previous_span_statistics_proto_strings.size());
+             std::vector<absl::string_view> previous_span_statistics;
+             for (const py::buffer& input :
+                  previous_span_statistics_proto_strings) {
+               buffers.emplace_back(input);
+               previous_span_statistics.push_back(buffers.back().view());
+             }
+             std::vector<std::string> anomalies_proto_strings;
+             const tensorflow::Status status = RunWithoutGil([&]() {
+               return validator.ComputeDriftWithSerializedInputs(
+                   statistics.view(), previous_span_statistics,
+                   &anomalies_proto_strings);
+             });
+             if (!status.ok()) {
+               throw std::runtime_error(status.ToString());
+             }
+             py::list result;
+             for (const std::string& anomalies_proto_string :
+                  anomalies_proto_strings) {
+               result.append(py::bytes(anomalies_proto_string));
+             }
+             return result;
+           })
+      // Same as Validate, but validates against each of the environments (an
+      // empty one meaning no environment) instead of the environment of the
+      // validator, and returns the serialized anomalies in each of them. The
+      // work that does not depend on the environment is shared.
+      .def("ValidateInEnvironments",
+           [](const Validator& validator,
+              const py::buffer& statistics_proto_string,
+              const py::buffer& previous_span_statistics_proto_string,
+              const py::buffer& serving_statistics_proto_string,
+              const py::buffer& previous_version_statistics_proto_string,
+              const py::buffer& feature_needed_string,
+              const std::vector<std::string>& environments,
+              const bool enable_diff_regions) -> py::list {
+             const BufferView statistics(statistics_proto_string);
+             const BufferView previous_span_statistics(
+                 previous_span_statistics_proto_string);
+             const BufferView serving_statistics(
+                 serving_statistics_proto_string);
+             const BufferView previous_version_statistics(
+                 previous_version_statistics_proto_string);
+             const BufferView feature_needed(feature_needed_string);
+             std::vector<std::string> anomalies_proto_strings;
+             const tensorflow::Status status = RunWithoutGil([&]() {
+               return validator.ValidateInEnvironmentsWithSerializedInputs(
+                   statistics.view(), previous_span_statistics.view(),
+                   serving_statistics.view(),
+                   previous_version_statistics.view(), feature_needed.view(),
+                   environments, enable_diff_regions,
+                   &anomalies_proto_strings);
+             });
+             if (!status.ok()) {
+               throw std::runtime_error(status.ToString());
+             }
+             py::list result;
+             for (const std::string& anomalies_proto_string :
+                  anomalies_proto_strings) {
+               result.append(py::bytes(anomalies_proto_string));
+             }
+             return result;
+           })
+      // Same as Validate, but returns an asyncio.Future of the serialized
+      // anomalies, bound to the running event loop, instead of waiting for
+      // them. The validation runs on the threads of a queue shared by all the
+      // validators (see SetAsyncValidationOptions), without the GIL, so that
+      // many validations can be in flight at once. Cancelling the future
+      // cancels the validation (before it starts, or at its next check of its
+      // deadline). Raises if too many validations are already pending, or if
+      // no event loop is running in the calling thread.
+      .def("ValidateAsync",
+           [](py::object self, const py::buffer& statistics_proto_string,
+              const py::buffer& previous_span_statistics_proto_string,
+              const py::buffer& serving_statistics_proto_string,
+              const py::buffer& previous_version_statistics_proto_string,
+              const py::buffer& feature_needed_string,
+              const bool enable_diff_regions) -> py::object {
+             const Validator* validator = &self.cast<const Validator&>();
+             auto request = std::make_shared<AsyncValidationRequest>();
+             request->validator = self;
+             request->loop = GetRunningEventLoop();
+             request->future = request->loop.attr("create_future")();
+             request->inputs.emplace_back(statistics_proto_string);
+             request->inputs.emplace_back(
+                 previous_span_statistics_proto_string);
+             request->inputs.emplace_back(serving_statistics_proto_string);
+             request->inputs.emplace_back(
+                 previous_version_statistics_proto_string);
+             request->inputs.emplace_back(feature_needed_string);
+             request->anomalies_output.reset(new BytesOutput());
+             std::shared_ptr<AsyncValidationQueue> queue =
+                 GetAsyncValidationQueue();
+             std::shared_ptr<AsyncValidationQueue::Handle> handle;
+             const tensorflow::Status status = queue->Submit(
+                 validator->deadline_micros(),
+                 [validator, request,
+                  enable_diff_regions](const ValidationDeadline* deadline) {
+                   const std::vector<BufferView>& inputs = request->inputs;
+                   return validator->ValidateWithSerializedInputs(
+                       inputs[0].view(), inputs[1].view(), inputs[2].view(),
+                       inputs[3].view(), inputs[4].view(),
+                       enable_diff_regions, request->anomalies_output.get(),
+                       /*profile=*/nullptr, deadline);
+                 },
+                 [request](const tensorflow::Status& status) {
+                   FinishAsyncValidation(request.get(), status);
+                 },
+                 &handle);
+             ReleaseAsyncValidationQueue(std::move(queue));
+             if (!status.ok()) {
+               throw std::runtime_error(status.ToString());
+             }
+             const py::object future = request->future;
+             future.attr("add_done_callback")(
+                 py::cpp_function([handle](py::object done_future) {
+                   if (done_future.attr("cancelled")().cast<bool>()) {
+                     handle->Cancel();
+                   }
+                 }));
+             return future;
+           })
+      // Same as Validate, but returns an iterator over the anomalies, which
+      // are found on another thread while the iterator is consumed (see
+      // StreamingValidation).
+      .def(
+          "ValidateStreaming",
+          [](const Validator& validator,
+             const py::buffer& statistics_proto_string,
+             const py::buffer& previous_span_statistics_proto_string,
+             const py::buffer& serving_statistics_proto_string,
+             const py::buffer& previous_version_statistics_proto_string,
+             const py::buffer& feature_needed_string,
+             const bool enable_diff_regions) {
+            std::vector<BufferView> inputs;
+            inputs.emplace_back(statistics_proto_string);
+            inputs.emplace_back(previous_span_statistics_proto_string);
+            inputs.emplace_back(serving_statistics_proto_string);
+            inputs.emplace_back(previous_version_statistics_proto_string);
+            inputs.emplace_back(feature_needed_string);
+            return std::unique_ptr<StreamingValidation>(new StreamingValidation(
+                std::move(inputs),
+                [&validator, enable_diff_regions](
+                    const std::vector<absl::string_view>& views,
+                    AnomaliesSink* sink) {
+                  return validator.ValidateWithSerializedInputs(
+                      views[0], views[1], views[2], views[3], views[4],
+                      enable_diff_regions, sink);
+                }));
+          },
+          // The iterator keeps the validator alive.
+          py::keep_alive<0, 1>());
+
+  py::class_<StreamingValidation>(m, "AnomaliesIterator")
+      .def("__iter__", [](py::object self) { return self; })
+      .def("__next__", [](StreamingValidation& self) -> py::tuple {
+        StreamingValidation::Item item;
+        tensorflow::Status status;
+        bool has_item;
+        {
+          py::gil_scoped_release release_gil;
+          has_item = self.Next(&item, &status);
+        }
+        if (!has_item) {
+          if (!status.ok()) {
+            throw std::runtime_error(status.ToString());
+          }
+          throw py::stop_iteration();
+        }
+        return py::make_tuple(item.kind, item.path,
+                              py::bytes(item.serialized));
+      });
 }
 
 }  // namespace data_validation